@@ -0,0 +1,125 @@
+/**
+ * CHRONOS-Rb Host Micro-Benchmarks
+ *
+ * Runs each case long enough to time, several times over, and reports
+ * ns per operation (median and best sample). Firmware console output is
+ * sent to /dev/null while a case runs so it does not end up in the
+ * numbers twice; its cost on the host is still counted.
+ *
+ * Usage: chronos_bench [-t ms] [-n samples] [name-filter]
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sim.h"
+#include "bench.h"
+
+/*============================================================================
+ * CASES
+ *============================================================================*/
+
+static const bench_case_t cases[] = {
+    { "ntp_request",        bench_ntp_setup,        bench_ntp_run },
+    { "discipline_update",  bench_discipline_setup, bench_discipline_run },
+    { "calendar_step",      NULL,                   bench_calendar_step_run },
+    { "calendar_convert",   NULL,                   bench_calendar_convert_run },
+    { "dcf77_encode",       NULL,                   bench_dcf77_run },
+    { "wwvb_encode",        NULL,                   bench_wwvb_run },
+    { "jjy_encode",         NULL,                   bench_jjy_run },
+    { "irig_frame",         NULL,                   bench_irig_run },
+    { "gnss_burst",         bench_gnss_setup,       bench_gnss_run },
+    { "roughtime_single",   bench_roughtime_setup,  bench_roughtime_run },
+    { "roughtime_batch16",  bench_roughtime_setup,  bench_roughtime_batch_run },
+};
+
+#define CASE_COUNT      (sizeof(cases) / sizeof(cases[0]))
+#define MAX_SAMPLES     32
+
+volatile uint32_t bench_sink = 0;
+
+/*============================================================================
+ * TIMING
+ *============================================================================*/
+
+static uint64_t time_run(const bench_case_t *c, uint32_t n) {
+    uint64_t t0 = host_wall_ns();
+    c->run(n);
+    return host_wall_ns() - t0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Double n until one sample takes target_ns, then take the samples
+ */
+static void bench_case(const bench_case_t *c, uint64_t target_ns, int samples) {
+    double ns_op[MAX_SAMPLES];
+    uint32_t n = 1;
+
+    host_console_mute(true);
+    if (c->setup) {
+        c->setup();
+    }
+    while (n < (1u << 30) && time_run(c, n) < target_ns) {
+        n *= 2;
+    }
+    for (int i = 0; i < samples; i++) {
+        ns_op[i] = (double)time_run(c, n) / n;
+    }
+    host_console_mute(false);
+
+    qsort(ns_op, samples, sizeof(ns_op[0]), cmp_double);
+    printf("%-20s %10u %12.1f %12.1f\n", c->name, n, ns_op[samples / 2], ns_op[0]);
+}
+
+/*============================================================================
+ * MAIN
+ *============================================================================*/
+
+int main(int argc, char *argv[]) {
+    uint64_t target_ns = 20000000;      /* 20ms per sample */
+    int samples = 7;
+    const char *filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            target_ns = strtoull(argv[++i], NULL, 10) * 1000000ULL;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            samples = atoi(argv[++i]);
+            if (samples < 1) samples = 1;
+            if (samples > MAX_SAMPLES) samples = MAX_SAMPLES;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [-t ms] [-n samples] [name-filter]\n", argv[0]);
+            return 2;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    host_console_mute(true);
+    host_sim_init();
+    host_console_mute(false);
+
+    printf("%-20s %10s %12s %12s\n", "case", "ops/sample", "ns/op med", "ns/op min");
+    for (size_t i = 0; i < CASE_COUNT; i++) {
+        if (filter == NULL || strstr(cases[i].name, filter) != NULL) {
+            bench_case(&cases[i], target_ns, samples);
+        }
+    }
+
+    /* Every reply path must have freed what it allocated */
+    int32_t leaked = host_pbuf_outstanding();
+    if (leaked != 0) {
+        fprintf(stderr, "pbufs outstanding after the run: %d\n", (int)leaked);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+/**
+ * CHRONOS-Rb Host Micro-Benchmarks
+ *
+ * Each case runs its operation n times per call; the harness picks n so
+ * one sample takes long enough to time, then reports ns per operation.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);        /* Once before timing, may be NULL */
+    void (*run)(uint32_t n);    /* n operations */
+} bench_case_t;
+
+/* NTP seconds the cases run at: 2025-06-15 12:00:00 UTC */
+#define BENCH_NTP_SECONDS   3958977600UL
+
+/* Keep a result live so the work is not optimised away */
+extern volatile uint32_t bench_sink;
+
+/* bench_proto.c */
+void bench_ntp_setup(void);
+void bench_ntp_run(uint32_t n);
+void bench_roughtime_setup(void);
+void bench_roughtime_run(uint32_t n);
+void bench_roughtime_batch_run(uint32_t n);
+
+/* bench_timing.c */
+void bench_discipline_setup(void);
+void bench_discipline_run(uint32_t n);
+void bench_gnss_setup(void);
+void bench_gnss_run(uint32_t n);
+void bench_calendar_step_run(uint32_t n);
+void bench_calendar_convert_run(uint32_t n);
+
+/* bench_radio.c */
+void bench_dcf77_run(uint32_t n);
+void bench_wwvb_run(uint32_t n);
+void bench_jjy_run(uint32_t n);
+
+/* bench_irig.c */
+void bench_irig_run(uint32_t n);
+
+#endif /* BENCH_H */
@@ -0,0 +1,25 @@
+/**
+ * CHRONOS-Rb IRIG-B Benchmark
+ *
+ * encode_irig_frame() is static, so this file builds irig_b.c into
+ * itself to reach it.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include "../../src/irig_b.c"
+
+#include "bench.h"
+
+/* One 100-bit frame per operation, a new second each time (stepped,
+ * as the calendar cache is) */
+void bench_irig_run(uint32_t n) {
+    calendar_t c;
+    calendar_from_ntp(BENCH_NTP_SECONDS, &c);
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_step(&c);
+        encode_irig_frame(&c);
+        bench_sink += irig_frame[i % IRIG_BITS];
+    }
+}
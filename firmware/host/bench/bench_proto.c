@@ -0,0 +1,116 @@
+/**
+ * CHRONOS-Rb Protocol Benchmarks
+ *
+ * NTP and Roughtime requests delivered to the servers' lwIP receive
+ * callbacks, reply built and sent, exactly as on the network core.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+
+#include "host_sim.h"
+#include "chronos_rb.h"
+#include "roughtime.h"
+
+#include "bench.h"
+
+#define ROUGHTIME_PORT      2002
+#define ROUGHTIME_REQ_SIZE  1024
+
+/* Clients the NTP requests rotate over, each staying under the rate limit */
+#define BENCH_NTP_CLIENTS   16
+
+/*============================================================================
+ * NTP
+ *============================================================================*/
+
+/* Serve as a locked stratum 1 */
+void bench_ntp_setup(void) {
+    timestamp_t ts = { BENCH_NTP_SECONDS, 0 };
+
+    ntp_server_init();
+    set_time(&ts);
+    g_time_state.sync_state = SYNC_STATE_LOCKED;
+    g_time_state.time_valid = true;
+}
+
+/* One client request and reply per operation, 100ms apart */
+void bench_ntp_run(uint32_t n) {
+    ntp_packet_t req;
+
+    memset(&req, 0, sizeof(req));
+    req.li_vn_mode = (4 << 3) | 3;      /* NTPv4 client */
+    req.poll = 6;
+
+    for (uint32_t i = 0; i < n; i++) {
+        host_time_advance_us(100000);
+        req.tx_ts_sec = htonl(BENCH_NTP_SECONDS + i);
+        req.tx_ts_frac = get_rand_32();
+        host_udp_deliver(NTP_PORT, &req, sizeof(req),
+                         htonl(0x0A000001u + i % BENCH_NTP_CLIENTS), 49152);
+    }
+    bench_sink += host_udp_tx_count();
+}
+
+/*============================================================================
+ * ROUGHTIME
+ *============================================================================*/
+
+/* NONC then PAD, the minimum request size */
+static uint8_t rt_request[ROUGHTIME_REQ_SIZE];
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+void bench_roughtime_setup(void) {
+    static bool started = false;
+    timestamp_t ts = { BENCH_NTP_SECONDS, 0 };
+
+    /* Shared by both Roughtime cases */
+    if (!started) {
+        roughtime_init();
+        started = true;
+    }
+    set_time(&ts);
+
+    memset(rt_request, 0, sizeof(rt_request));
+    put_le32(rt_request, 2);            /* Tags */
+    put_le32(rt_request + 4, 64);       /* PAD starts after the nonce */
+    put_le32(rt_request + 8, 0x434E4F4E);   /* "NONC" */
+    put_le32(rt_request + 12, 0xFF444150);  /* "PAD\xff" */
+}
+
+static void roughtime_send(uint32_t seq) {
+    put_le32(rt_request + 16, seq);
+    put_le32(rt_request + 20, get_rand_32());
+    host_udp_deliver(ROUGHTIME_PORT, rt_request, sizeof(rt_request),
+                     htonl(0x0A000001u + seq % 64), 49152);
+}
+
+/* A lone request: waits out the batch window, one signature per reply */
+void bench_roughtime_run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        roughtime_send(i);
+        host_time_advance_us(10001);
+        roughtime_task();
+    }
+    bench_sink += roughtime_get_requests();
+}
+
+/* A full batch of 16: one signature and Merkle tree shared by all */
+void bench_roughtime_batch_run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < 16; j++) {
+            roughtime_send(i * 16 + j);
+        }
+        roughtime_task();
+        host_time_advance_us(1000);
+    }
+    bench_sink += roughtime_get_requests();
+}
@@ -0,0 +1,45 @@
+/**
+ * CHRONOS-Rb Radio Timecode Benchmarks
+ *
+ * The frame encoders are static, so this file builds radio_timecode.c
+ * into itself to reach them.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include "../../src/radio_timecode.c"
+
+#include "bench.h"
+
+/* One minute frame per operation, a new minute each time, converted
+ * as radio_bit() does */
+void bench_dcf77_run(uint32_t n) {
+    uint8_t bits[60];
+    calendar_t c;
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_from_ntp(BENCH_NTP_SECONDS + 60 * i, &c);
+        dcf77_encode(bits, &c);
+        bench_sink += bits[i % 60];
+    }
+}
+
+void bench_wwvb_run(uint32_t n) {
+    uint8_t bits[60];
+    calendar_t c;
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_from_ntp(BENCH_NTP_SECONDS + 60 * i, &c);
+        wwvb_encode(bits, &c);
+        bench_sink += bits[i % 60];
+    }
+}
+
+void bench_jjy_run(uint32_t n) {
+    uint8_t bits[60];
+    calendar_t c;
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_from_ntp(BENCH_NTP_SECONDS + 60 * i, &c);
+        jjy_encode(bits, &c);
+        bench_sink += bits[i % 60];
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * CHRONOS-Rb Timing Path Benchmarks
+ *
+ * The discipline loop step, the GNSS receive path (DMA ring scan, NMEA
+ * and UBX parsers) and the per-second calendar as the timing core runs
+ * them.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+
+#include "host_sim.h"
+#include "chronos_rb.h"
+#include "gnss_input.h"
+#include "calendar.h"
+
+#include "bench.h"
+
+/*============================================================================
+ * DISCIPLINE
+ *============================================================================*/
+
+void bench_discipline_setup(void) {
+    discipline_reset();
+}
+
+/* One PPS worth of loop: the clock moves 1s, offsets wander +/-60ns */
+void bench_discipline_run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        host_time_advance_us(1000000);
+        discipline_update((int64_t)(get_rand_32() % 121) - 60);
+    }
+    bench_sink += (uint32_t)discipline_get_correction();
+}
+
+/*============================================================================
+ * GNSS RECEIVE
+ *============================================================================*/
+
+/* One second of receiver output: the four parsed sentences plus a
+ * NAV-PVT the UBX state machine has to frame and skip */
+static uint8_t gnss_burst[1024];
+static size_t gnss_burst_len = 0;
+
+void bench_gnss_setup(void) {
+    static const char *const sentences[] = {
+        "GNRMC,120000.00,A,5130.00000,N,00007.00000,W,0.010,,150625,,,A",
+        "GNGGA,120000.00,5130.00000,N,00007.00000,W,1,12,0.80,45.0,M,47.0,M,,",
+        "GNGSA,A,3,01,02,03,04,05,06,07,08,09,10,11,12,1.20,0.80,0.90",
+        "GNZDA,120000.00,15,06,2025,00,00",
+    };
+    uint8_t pvt[92];
+
+    gnss_burst_len = 0;
+    for (size_t i = 0; i < sizeof(sentences) / sizeof(sentences[0]); i++) {
+        gnss_burst_len += host_nmea_format((char *)gnss_burst + gnss_burst_len,
+                                           sizeof(gnss_burst) - gnss_burst_len, sentences[i]);
+    }
+    memset(pvt, 0x5A, sizeof(pvt));
+    gnss_burst_len += host_ubx_format(gnss_burst + gnss_burst_len,
+                                      sizeof(gnss_burst) - gnss_burst_len,
+                                      0x01, 0x07, pvt, sizeof(pvt));
+}
+
+/* One burst through the ring and one task pass per operation */
+void bench_gnss_run(uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        host_time_advance_us(1000000);
+        host_gnss_rx(gnss_burst, gnss_burst_len);
+        gnss_input_task();
+    }
+    bench_sink += gnss_get_state()->nmea_count;
+}
+
+/*============================================================================
+ * CALENDAR
+ *============================================================================*/
+
+/* The per-PPS advance */
+void bench_calendar_step_run(uint32_t n) {
+    calendar_t c;
+    calendar_from_ntp(BENCH_NTP_SECONDS, &c);
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_step(&c);
+    }
+    bench_sink += c.second;
+}
+
+/* A rebuild after a step, a day apart each time */
+void bench_calendar_convert_run(uint32_t n) {
+    calendar_t c;
+    for (uint32_t i = 0; i < n; i++) {
+        calendar_from_ntp(BENCH_NTP_SECONDS + 86400 * (i % 4096), &c);
+        bench_sink += c.day;
+    }
+}
@@ -0,0 +1,494 @@
+/**
+ * CHRONOS-Rb Host HAL Shim
+ *
+ * Implementation of host_hal.h. Single threaded: "interrupts" are
+ * whatever the harness calls between steps, so masking them is a no-op.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#define _POSIX_C_SOURCE 199309L  /* clock_gettime */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_hal.h"
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+#define HOST_GPIO_COUNT     48
+#define HOST_UDP_MAX        1500
+#define HOST_DMA_CHANNELS   16
+#define HOST_UDP_PCBS       8
+
+static uint64_t now_us = 0;
+static bool gpio_level[HOST_GPIO_COUNT];
+static uint32_t gpio_irq_mask[HOST_GPIO_COUNT];
+static gpio_irq_callback_t gpio_callback = NULL;
+
+pio_hw_t host_pio[HOST_PIO_COUNT];
+
+static dma_hw_t dma_regs;
+dma_hw_t *dma_hw = &dma_regs;
+static pwm_hw_t pwm_regs;
+pwm_hw_t *pwm_hw = &pwm_regs;
+static int dma_next_channel = 0;
+
+/* What dma_channel_configure() was given, for the receive ring model */
+typedef struct {
+    uint8_t *base;
+    uint32_t offset;
+    uint dreq;
+    uint ring_bits;
+    bool active;
+} host_dma_chan_t;
+static host_dma_chan_t dma_chan[HOST_DMA_CHANNELS];
+
+struct uart_inst { uart_hw_t hw; };
+static struct uart_inst uart_regs[2];
+uart_inst_t *uart0 = &uart_regs[0];
+uart_inst_t *uart1 = &uart_regs[1];
+
+const ip_addr_t ip_addr_any = { 0 };
+struct netif *netif_default = NULL;
+
+static uint8_t udp_last[HOST_UDP_MAX];
+static uint16_t udp_last_len = 0;
+static uint32_t udp_tx_count = 0;
+static struct udp_pcb *udp_pcbs[HOST_UDP_PCBS];
+static int32_t pbufs_outstanding = 0;
+
+static uint64_t rand_state = 0x9E3779B97F4A7C15ULL;
+
+/*============================================================================
+ * TIME
+ *============================================================================*/
+
+uint64_t time_us_64(void) { return now_us; }
+uint32_t time_us_32(void) { return (uint32_t)now_us; }
+absolute_time_t get_absolute_time(void) { return now_us; }
+uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+
+/* Sleeping moves the virtual clock, so wait loops terminate */
+void sleep_us(uint64_t us) { now_us += us; }
+void sleep_ms(uint32_t ms) { now_us += (uint64_t)ms * 1000; }
+void busy_wait_us(uint64_t us) { now_us += us; }
+
+void host_time_set_us(uint64_t us) { now_us = us; }
+void host_time_advance_us(uint64_t us) { now_us += us; }
+
+uint64_t host_wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*============================================================================
+ * SYNC
+ *============================================================================*/
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) { (void)status; }
+uint get_core_num(void) { return 1; }
+
+/*============================================================================
+ * GPIO AND IRQ
+ *============================================================================*/
+
+void gpio_init(uint gpio) { (void)gpio; }
+void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+void gpio_pull_up(uint gpio) { (void)gpio; }
+void gpio_pull_down(uint gpio) { (void)gpio; }
+void gpio_disable_pulls(uint gpio) { (void)gpio; }
+void gpio_set_function(uint gpio, enum gpio_function fn) { (void)gpio; (void)fn; }
+void gpio_set_inover(uint gpio, uint value) { (void)gpio; (void)value; }
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (gpio >= HOST_GPIO_COUNT) {
+        return;
+    }
+    if (enabled) {
+        gpio_irq_mask[gpio] |= event_mask;
+    } else {
+        gpio_irq_mask[gpio] &= ~event_mask;
+    }
+}
+
+/* One callback per core, as on the Pico */
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_callback = callback;
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+}
+
+void gpio_put(uint gpio, bool value) {
+    if (gpio < HOST_GPIO_COUNT) {
+        gpio_level[gpio] = value;
+    }
+}
+
+bool gpio_get(uint gpio) {
+    return gpio < HOST_GPIO_COUNT && gpio_level[gpio];
+}
+
+void host_gpio_set(uint gpio, bool level) {
+    gpio_put(gpio, level);
+}
+
+void host_gpio_edge(uint gpio, bool rising) {
+    uint32_t event = rising ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+
+    gpio_put(gpio, rising);
+    if (gpio < HOST_GPIO_COUNT && gpio_callback != NULL && (gpio_irq_mask[gpio] & event)) {
+        gpio_callback(gpio, event);
+    }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { (void)num; (void)handler; }
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void)num; (void)handler; (void)order_priority;
+}
+void irq_set_enabled(uint num, bool enabled) { (void)num; (void)enabled; }
+void irq_set_priority(uint num, uint8_t hardware_priority) { (void)num; (void)hardware_priority; }
+
+/*============================================================================
+ * PIO
+ *============================================================================*/
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    return pio->rx_head[sm] == pio->rx_tail[sm];
+}
+
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm) {
+    return pio->rx_head[sm] - pio->rx_tail[sm];
+}
+
+/* Empty FIFO reads as 0, as the hardware does */
+uint32_t pio_sm_get(PIO pio, uint sm) {
+    if (pio_sm_is_rx_fifo_empty(pio, sm)) {
+        return 0;
+    }
+    return pio->rxf[sm][pio->rx_tail[sm]++ % HOST_PIO_FIFO_DEPTH];
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) { (void)pio; (void)sm; (void)data; }
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) { (void)pio; (void)sm; (void)enabled; }
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    pio->rx_tail[sm] = pio->rx_head[sm];
+}
+
+bool host_pio_push(PIO pio, uint sm, uint32_t word) {
+    if (pio_sm_get_rx_fifo_level(pio, sm) >= HOST_PIO_FIFO_DEPTH) {
+        return false;
+    }
+    pio->rxf[sm][pio->rx_head[sm]++ % HOST_PIO_FIFO_DEPTH] = word;
+    return true;
+}
+
+/*============================================================================
+ * DMA AND PWM
+ *============================================================================*/
+
+int dma_claim_unused_channel(bool required) {
+    (void)required;
+    return dma_next_channel < HOST_DMA_CHANNELS ? dma_next_channel++ : -1;
+}
+
+int dma_claim_unused_timer(bool required) { (void)required; return 0; }
+void dma_timer_set_fraction(uint timer, uint16_t numerator, uint16_t denominator) {
+    (void)timer; (void)numerator; (void)denominator;
+}
+uint dma_get_timer_dreq(uint timer) { return 59 + timer; }
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config c = { .ctrl = channel };
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~0xCu) | ((uint32_t)size << 2);
+}
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { (void)c; (void)incr; }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { (void)c; (void)incr; }
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) {
+    c->ring_bits = write ? size_bits : 0;
+}
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) { (void)c; (void)chain_to; }
+uint32_t channel_config_get_ctrl_value(const dma_channel_config *c) { return c->ctrl; }
+
+/**
+ * The register keeps the low 32 bits of the address, so code computing
+ * (write_addr - base) & mask gets the right ring index on a 64-bit host
+ */
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint32_t transfer_count, bool trigger) {
+    (void)read_addr; (void)transfer_count;
+    if (channel >= HOST_DMA_CHANNELS) {
+        return;
+    }
+    host_dma_chan_t *hc = &dma_chan[channel];
+    hc->base = (uint8_t *)write_addr;
+    hc->offset = 0;
+    hc->dreq = config->dreq;
+    hc->ring_bits = config->ring_bits;
+    hc->active = trigger;
+    dma_hw->ch[channel].write_addr = (uint32_t)(uintptr_t)write_addr;
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    (void)channel; (void)read_addr; (void)trigger;
+}
+void dma_channel_abort(uint channel) {
+    if (channel < HOST_DMA_CHANNELS) {
+        dma_chan[channel].active = false;
+    }
+}
+bool dma_channel_is_busy(uint channel) { (void)channel; return false; }
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) { return &dma_hw->ch[channel & 15]; }
+uint32_t dma_encode_endless_transfer_count(void) { return 0xF0000000u; }
+
+uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1) % 12; }
+uint pwm_gpio_to_channel(uint gpio) { return gpio & 1; }
+void pwm_set_wrap(uint slice, uint16_t wrap) { pwm_hw->slice[slice].top = wrap; }
+void pwm_set_clkdiv(uint slice, float divider) { (void)slice; (void)divider; }
+void pwm_set_chan_level(uint slice, uint chan, uint16_t level) {
+    (void)chan;
+    pwm_hw->slice[slice].cc = level;
+}
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+void pwm_set_enabled(uint slice, bool enabled) { (void)slice; (void)enabled; }
+
+/*============================================================================
+ * UART
+ *============================================================================*/
+
+uint uart_init(uart_inst_t *uart, uint baudrate) { (void)uart; return baudrate; }
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate) { (void)uart; return baudrate; }
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uint parity) {
+    (void)uart; (void)data_bits; (void)stop_bits; (void)parity;
+}
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts) { (void)uart; (void)cts; (void)rts; }
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) { (void)uart; (void)enabled; }
+void uart_putc_raw(uart_inst_t *uart, char c) { (void)uart; (void)c; }
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len) {
+    (void)uart; (void)src; (void)len;
+}
+bool uart_is_readable(uart_inst_t *uart) { (void)uart; return false; }
+char uart_getc(uart_inst_t *uart) { (void)uart; return 0; }
+uart_hw_t *uart_get_hw(uart_inst_t *uart) { return &uart->hw; }
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx) { return (uart == uart1 ? 2 : 0) + is_tx; }
+
+/**
+ * Do what the receive DMA would: copy into the ring of the channel paced
+ * by this UART's RX DREQ and move its write address on
+ */
+size_t host_uart_rx(uart_inst_t *uart, const uint8_t *data, size_t len) {
+    uint dreq = uart_get_dreq(uart, false);
+
+    for (int c = 0; c < HOST_DMA_CHANNELS; c++) {
+        host_dma_chan_t *hc = &dma_chan[c];
+        if (!hc->active || hc->dreq != dreq || hc->ring_bits == 0) {
+            continue;
+        }
+        uint32_t mask = (1u << hc->ring_bits) - 1;
+        for (size_t i = 0; i < len; i++) {
+            hc->base[hc->offset] = data[i];
+            hc->offset = (hc->offset + 1) & mask;
+        }
+        dma_hw->ch[c].write_addr = (uint32_t)((uintptr_t)hc->base + hc->offset);
+        return len;
+    }
+    return 0;
+}
+
+/*============================================================================
+ * BOARD ID AND RANDOM
+ *============================================================================*/
+
+void pico_get_unique_board_id(pico_unique_board_id_t *id) {
+    static const uint8_t host_id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES] = "HOSTSIM";
+    memcpy(id->id, host_id, sizeof(id->id));
+}
+
+/* xorshift64*: repeatable runs, not for keys that leave the host */
+uint64_t get_rand_64(void) {
+    rand_state ^= rand_state >> 12;
+    rand_state ^= rand_state << 25;
+    rand_state ^= rand_state >> 27;
+    return rand_state * 0x2545F4914F6CDD1DULL;
+}
+
+uint32_t get_rand_32(void) {
+    return (uint32_t)(get_rand_64() >> 32);
+}
+
+/*============================================================================
+ * LWIP
+ *============================================================================*/
+
+uint32_t htonl(uint32_t x) { return __builtin_bswap32(x); }
+uint16_t htons(uint16_t x) { return __builtin_bswap16(x); }
+uint32_t ntohl(uint32_t x) { return __builtin_bswap32(x); }
+uint16_t ntohs(uint16_t x) { return __builtin_bswap16(x); }
+
+int ipaddr_aton(const char *cp, ip_addr_t *addr) {
+    unsigned a, b, c, d;
+    if (sscanf(cp, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 ||
+        a > 255 || b > 255 || c > 255 || d > 255) {
+        return 0;
+    }
+    addr->addr = htonl((a << 24) | (b << 16) | (c << 8) | d);
+    return 1;
+}
+
+/**
+ * One contiguous block per pbuf: header, then payload
+ */
+struct pbuf *pbuf_alloc(pbuf_layer layer, uint16_t length, pbuf_type type) {
+    (void)type;
+    struct pbuf *p = malloc(sizeof(struct pbuf) + layer + length);
+    if (p == NULL) {
+        return NULL;
+    }
+    p->next = NULL;
+    p->payload = (uint8_t *)(p + 1) + layer;
+    p->tot_len = length;
+    p->len = length;
+    p->ref = 1;
+    pbufs_outstanding++;
+    return p;
+}
+
+uint8_t pbuf_free(struct pbuf *p) {
+    if (p == NULL || --p->ref != 0) {
+        return 0;
+    }
+    free(p);
+    pbufs_outstanding--;
+    return 1;
+}
+
+/* Shrink only, as lwIP does */
+void pbuf_realloc(struct pbuf *p, uint16_t new_len) {
+    if (new_len < p->tot_len) {
+        p->tot_len = new_len;
+        p->len = new_len;
+    }
+}
+
+struct pbuf *pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p) {
+    struct pbuf *q = pbuf_alloc(layer, p->tot_len, type);
+    if (q != NULL) {
+        pbuf_copy_partial(p, q->payload, p->tot_len, 0);
+    }
+    return q;
+}
+
+uint16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, uint16_t len, uint16_t offset) {
+    uint16_t copied = 0;
+    for (; p != NULL && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset -= p->len;
+            continue;
+        }
+        uint16_t n = p->len - offset;
+        if (n > len - copied) {
+            n = len - copied;
+        }
+        memcpy((uint8_t *)dataptr + copied, (const uint8_t *)p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+err_t pbuf_take(struct pbuf *p, const void *dataptr, uint16_t len) {
+    if (len > p->tot_len) {
+        return ERR_MEM;
+    }
+    memcpy(p->payload, dataptr, len);
+    return ERR_OK;
+}
+
+int32_t host_pbuf_outstanding(void) {
+    return pbufs_outstanding;
+}
+
+struct udp_pcb *udp_new(void) {
+    return calloc(1, sizeof(struct udp_pcb));
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, uint16_t port) {
+    for (int i = 0; i < HOST_UDP_PCBS; i++) {
+        if (udp_pcbs[i] == NULL || udp_pcbs[i] == pcb) {
+            udp_pcbs[i] = pcb;
+            pcb->local_ip = *ipaddr;
+            pcb->local_port = port;
+            return ERR_OK;
+        }
+    }
+    return ERR_MEM;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, uint16_t dst_port) {
+    (void)pcb; (void)dst_ip; (void)dst_port;
+    udp_last_len = pbuf_copy_partial(p, udp_last, sizeof(udp_last), 0);
+    udp_tx_count++;
+    return ERR_OK;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+    for (int i = 0; i < HOST_UDP_PCBS; i++) {
+        if (udp_pcbs[i] == pcb) {
+            udp_pcbs[i] = NULL;
+        }
+    }
+    free(pcb);
+}
+
+/* The receive callback owns the pbuf, as in lwIP */
+bool host_udp_deliver(uint16_t port, const void *data, uint16_t len,
+                      uint32_t src_addr, uint16_t src_port) {
+    for (int i = 0; i < HOST_UDP_PCBS; i++) {
+        struct udp_pcb *pcb = udp_pcbs[i];
+        if (pcb == NULL || pcb->local_port != port || pcb->recv == NULL) {
+            continue;
+        }
+        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+        if (p == NULL) {
+            return false;
+        }
+        pbuf_take(p, data, len);
+        ip_addr_t src = { src_addr };
+        pcb->recv(pcb->recv_arg, pcb, p, &src, src_port);
+        return true;
+    }
+    return false;
+}
+
+const uint8_t *host_udp_last_tx(uint16_t *len) {
+    *len = udp_last_len;
+    return udp_last;
+}
+
+uint32_t host_udp_tx_count(void) {
+    return udp_tx_count;
+}
+
+void cyw43_arch_lwip_begin(void) {}
+void cyw43_arch_lwip_end(void) {}
@@ -0,0 +1,370 @@
+/**
+ * CHRONOS-Rb Host HAL Shim
+ *
+ * Just enough of the Pico SDK, CYW43 and lwIP surface to build the
+ * timing and protocol modules on a PC. Every SDK header the firmware
+ * includes (pico/stdlib.h, hardware/gpio.h, lwip/udp.h, ...) is a stub
+ * under host/hal that includes this file, so the sources build
+ * unmodified.
+ *
+ * The shim is a model, not an emulator:
+ *   - time_us_64() reads a virtual clock the harness drives
+ *   - GPIO inputs are levels the harness sets
+ *   - GPIO inputs and edges are driven by the harness; an edge runs the
+ *     callback registered with gpio_set_irq_enabled_with_callback()
+ *   - PIO RX FIFOs are queues the harness pushes captures into
+ *   - UART receive DMA rings are filled by the harness, as the DMA would
+ *   - pbufs are heap blocks; udp_sendto() keeps the last payload sent and
+ *     datagrams are delivered to bound pcbs on request
+ *   - other peripheral setup (PWM, IRQ, DMA timers) is accepted and ignored
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/*============================================================================
+ * PICO TYPES AND COMPILER HELPERS
+ *============================================================================*/
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define __not_in_flash_func(f)      f
+#define __time_critical_func(f)     f
+#define __aligned(x)                __attribute__((aligned(x)))
+#define __packed                    __attribute__((packed))
+#define __force_inline              inline
+#define __compiler_memory_barrier() __asm__ volatile("" ::: "memory")
+#define __dmb()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __dsb()                     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __sev()                     do {} while (0)
+#define __wfe()                     do {} while (0)
+#define tight_loop_contents()       do {} while (0)
+
+#define PICO_OK                     0
+#define PICO_ERROR_GENERIC          (-1)
+#define PICO_ERROR_TIMEOUT          (-1)
+
+#define SYS_CLK_HZ                  150000000
+#define PICO_DEFAULT_LED_PIN        25
+#define PICO_UNIQUE_BOARD_ID_SIZE_BYTES 8
+#define PICO_HIGHEST_IRQ_PRIORITY   0
+#define PICO_DEFAULT_IRQ_PRIORITY   0x80
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+/*============================================================================
+ * TIME (virtual clock)
+ *============================================================================*/
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+uint64_t to_us_since_boot(absolute_time_t t);
+uint32_t to_ms_since_boot(absolute_time_t t);
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+
+/*============================================================================
+ * SYNC AND MULTICORE
+ *============================================================================*/
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+uint get_core_num(void);
+
+/*============================================================================
+ * GPIO
+ *============================================================================*/
+
+#define GPIO_IN                 false
+#define GPIO_OUT                true
+#define GPIO_IRQ_EDGE_FALL      0x4u
+#define GPIO_IRQ_EDGE_RISE      0x8u
+#define GPIO_OVERRIDE_NORMAL    0
+#define GPIO_OVERRIDE_INVERT    1
+
+enum gpio_function {
+    GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_PIO2 = 8, GPIO_FUNC_NULL = 0x1f
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_inover(uint gpio, uint value);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback);
+
+/*============================================================================
+ * IRQ
+ *============================================================================*/
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_priority(uint num, uint8_t hardware_priority);
+
+/*============================================================================
+ * PIO (RX FIFOs as queues)
+ *============================================================================*/
+
+#define HOST_PIO_COUNT          3
+#define HOST_PIO_SM_COUNT       4
+#define HOST_PIO_FIFO_DEPTH     64
+
+typedef struct pio_hw {
+    uint32_t ctrl;
+    uint32_t rxf[HOST_PIO_SM_COUNT][HOST_PIO_FIFO_DEPTH];
+    uint32_t rx_head[HOST_PIO_SM_COUNT];
+    uint32_t rx_tail[HOST_PIO_SM_COUNT];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t host_pio[HOST_PIO_COUNT];
+#define pio0    (&host_pio[0])
+#define pio1    (&host_pio[1])
+#define pio2    (&host_pio[2])
+
+typedef struct { uint32_t clkdiv, execctrl, shiftctrl, pinctrl; } pio_sm_config;
+typedef struct { const uint16_t *instructions; uint8_t length; int8_t origin; } pio_program_t;
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+
+/*============================================================================
+ * DMA AND PWM (only UART receive rings move, see host_uart_rx())
+ *============================================================================*/
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint32_t ctrl;
+    uint dreq;
+    uint ring_bits;             /* Write ring size, log2 bytes; 0 = none */
+} dma_channel_config;
+
+typedef struct {
+    volatile uint32_t read_addr, write_addr, transfer_count, ctrl_trig;
+    volatile uint32_t al1_ctrl, al1_read_addr, al1_write_addr, al1_transfer_count_trig;
+} dma_channel_hw_t;
+
+typedef struct { dma_channel_hw_t ch[16]; } dma_hw_t;
+extern dma_hw_t *dma_hw;
+
+int dma_claim_unused_channel(bool required);
+int dma_claim_unused_timer(bool required);
+void dma_timer_set_fraction(uint timer, uint16_t numerator, uint16_t denominator);
+uint dma_get_timer_dreq(uint timer);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+uint32_t channel_config_get_ctrl_value(const dma_channel_config *c);
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint32_t transfer_count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+dma_channel_hw_t *dma_channel_hw_addr(uint channel);
+uint32_t dma_encode_endless_transfer_count(void);
+
+typedef struct { struct { uint32_t csr, div, ctr, cc, top; } slice[12]; } pwm_hw_t;
+extern pwm_hw_t *pwm_hw;
+
+uint pwm_gpio_to_slice_num(uint gpio);
+uint pwm_gpio_to_channel(uint gpio);
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_clkdiv(uint slice, float divider);
+void pwm_set_chan_level(uint slice, uint chan, uint16_t level);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_enabled(uint slice, bool enabled);
+
+/*============================================================================
+ * UART (transmit discarded, receive through DMA only)
+ *============================================================================*/
+
+typedef struct uart_inst uart_inst_t;
+typedef struct { uint32_t dr, rsr, _pad[4], fr; } uart_hw_t;
+
+extern uart_inst_t *uart0;
+extern uart_inst_t *uart1;
+
+#define UART_PARITY_NONE    0
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uint parity);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_putc_raw(uart_inst_t *uart, char c);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx);
+
+/*============================================================================
+ * BOARD ID AND RANDOM
+ *============================================================================*/
+
+typedef struct { uint8_t id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES]; } pico_unique_board_id_t;
+
+void pico_get_unique_board_id(pico_unique_board_id_t *id);
+uint64_t get_rand_64(void);
+uint32_t get_rand_32(void);
+
+/*============================================================================
+ * MBEDTLS (type only: no AES on the host, so no symmetric key, see stubs.c)
+ *============================================================================*/
+
+typedef struct { uint32_t unused; } mbedtls_aes_context;
+
+/*============================================================================
+ * LWIP (pbufs on the heap, UDP captured)
+ *============================================================================*/
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t s8_t;
+
+#define ERR_OK      0
+#define ERR_MEM     (-1)
+#define ERR_BUF     (-2)
+#define ERR_VAL     (-6)
+
+typedef struct { uint32_t addr; } ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY                     (&ip_addr_any)
+#define ip_addr_get_ip4_u32(a)          ((a)->addr)
+#define ip4_addr_get_u32(a)             ((a)->addr)
+#define ip_addr_set_ip4_u32(a, v)       ((a)->addr = (v))
+#define ip_addr_copy(dst, src)          ((dst) = (src))
+
+uint32_t htonl(uint32_t x);
+uint16_t htons(uint16_t x);
+uint32_t ntohl(uint32_t x);
+uint16_t ntohs(uint16_t x);
+
+typedef enum { PBUF_TRANSPORT = 74, PBUF_IP = 54, PBUF_LINK = 14, PBUF_RAW = 0 } pbuf_layer;
+typedef enum { PBUF_RAM = 0, PBUF_ROM = 1, PBUF_REF = 2, PBUF_POOL = 3 } pbuf_type;
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    uint16_t tot_len;
+    uint16_t len;
+    uint16_t ref;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, uint16_t length, pbuf_type type);
+uint8_t pbuf_free(struct pbuf *p);
+void pbuf_realloc(struct pbuf *p, uint16_t new_len);
+struct pbuf *pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p);
+uint16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, uint16_t len, uint16_t offset);
+err_t pbuf_take(struct pbuf *p, const void *dataptr, uint16_t len);
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            const ip_addr_t *addr, uint16_t port);
+
+struct udp_pcb {
+    ip_addr_t local_ip;
+    uint16_t local_port;
+    udp_recv_fn recv;
+    void *recv_arg;
+};
+
+struct udp_pcb *udp_new(void);
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, uint16_t port);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, uint16_t dst_port);
+void udp_remove(struct udp_pcb *pcb);
+
+#define SOF_BROADCAST                   0x20
+#define ip_set_option(pcb, opt)         ((void)(pcb), (void)(opt))
+
+int ipaddr_aton(const char *cp, ip_addr_t *addr);
+
+/* No interface: broadcasts to the subnet find no destination */
+struct netif {
+    ip_addr_t ip_addr;
+    ip_addr_t netmask;
+    bool up;
+};
+
+extern struct netif *netif_default;
+#define netif_is_up(n)                  ((n)->up)
+#define netif_ip4_addr(n)               (&(n)->ip_addr)
+#define netif_ip4_netmask(n)            (&(n)->netmask)
+
+void cyw43_arch_lwip_begin(void);
+void cyw43_arch_lwip_end(void);
+
+/*============================================================================
+ * HARNESS CONTROL
+ *============================================================================*/
+
+/* Virtual clock */
+void host_time_set_us(uint64_t us);
+void host_time_advance_us(uint64_t us);
+
+/* Monotonic wall clock for benchmarks (ns) */
+uint64_t host_wall_ns(void);
+
+/* Drive a GPIO input level */
+void host_gpio_set(uint gpio, bool level);
+
+/* Drive an edge: sets the level and runs the GPIO IRQ callback if enabled */
+void host_gpio_edge(uint gpio, bool rising);
+
+/* Queue a word in a PIO RX FIFO; false if it is full */
+bool host_pio_push(PIO pio, uint sm, uint32_t word);
+
+/* Bytes arriving on a UART, written into its receive DMA ring */
+size_t host_uart_rx(uart_inst_t *uart, const uint8_t *data, size_t len);
+
+/* Hand a datagram to the pcb bound to port; false if none is */
+bool host_udp_deliver(uint16_t port, const void *data, uint16_t len,
+                      uint32_t src_addr, uint16_t src_port);
+
+/* Last UDP datagram sent (length 0 if none yet) */
+const uint8_t *host_udp_last_tx(uint16_t *len);
+uint32_t host_udp_tx_count(void);
+
+/* pbufs allocated and not yet freed (leak check) */
+int32_t host_pbuf_outstanding(void);
+
+#endif /* HOST_HAL_H */
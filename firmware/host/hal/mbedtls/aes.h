@@ -0,0 +1,2 @@
+/* Host build stand-in for the mbedtls header: see host_hal.h */
+#include "host_hal.h"
@@ -0,0 +1,96 @@
+/**
+ * CHRONOS-Rb Host Simulation
+ *
+ * Stand-ins for the modules that are all hardware (pps_capture.c,
+ * freq_counter.c, timing_core.c, the logger, NTS, flash) so the timing
+ * and protocol modules build and run on a PC against host_hal.h.
+ *
+ * The reference inputs are driven from the harness: each call is one
+ * hardware event at the current virtual time, delivered the way the
+ * capture path would deliver it on the board.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "host_hal.h"
+
+/*============================================================================
+ * SETUP
+ *============================================================================*/
+
+/**
+ * Bring up the timing modules in timing_core_init() order: time base,
+ * discipline, reference manager, sync state machine, GNSS input
+ */
+void host_sim_init(void);
+
+/**
+ * Print LOG_* records as they are written (off by default)
+ */
+void host_sim_set_verbose(bool verbose);
+
+/**
+ * Send stdout (firmware printf) to /dev/null, or back to the console
+ */
+void host_console_mute(bool mute);
+
+/*============================================================================
+ * REFERENCE INPUTS
+ *============================================================================*/
+
+/**
+ * Rb PPS edge at edge_ns (time_us_64() base, ns), as the PIO edge
+ * counter reports it; runs pps_irq_handler()
+ */
+void host_rb_pps_edge(uint64_t edge_ns);
+
+/**
+ * GNSS PPS edge at edge_ns: runs the GPIO callback and queues the edge
+ * stamp for host_pps_fifo_task(), as the PIO edge counter does
+ */
+void host_gnss_pps_edge(uint64_t edge_ns);
+
+/**
+ * freq_counter_pps_task() stand-in, on its 10ms poll: takes a queued
+ * GNSS edge, folds its offset against the last Rb edge and passes it to
+ * ref_gnss_edge(). Returns true with the edge if there was one.
+ */
+bool host_pps_fifo_task(uint64_t *gnss_edge_ns);
+
+/**
+ * One 1s 10MHz gate closing: the integer count, and when have_reg the
+ * regression result (crystal against the 10MHz)
+ */
+void host_freq_gate(uint32_t count, bool have_reg, double local_ppb, double sigma_ppb);
+
+/**
+ * Rb lock status line level
+ */
+void host_rb_lock(bool locked);
+
+/**
+ * Serial data from the GNSS module, through the UART receive DMA ring
+ */
+void host_gnss_rx(const void *data, size_t len);
+
+/**
+ * Frame body (the text between '$' and '*') as a full NMEA sentence
+ * with checksum and CR LF. Returns its length, 0 if it does not fit.
+ */
+size_t host_nmea_format(char *out, size_t max, const char *body);
+
+/**
+ * Frame a UBX message with sync bytes and checksum. Returns its length,
+ * 0 if it does not fit.
+ */
+size_t host_ubx_format(uint8_t *out, size_t max, uint8_t cls, uint8_t id,
+                       const uint8_t *payload, uint16_t len);
+
+#endif /* HOST_SIM_H */
@@ -0,0 +1,406 @@
+/**
+ * CHRONOS-Rb Capture Replay
+ *
+ * Feeds a recorded (or synthesised) run of reference events through the
+ * sync state machine and discipline loop on the host, with the timing
+ * core's task cadence, and reports how long lock took and how far the
+ * disciplined time base sits from the GNSS PPS once locked. Rerun the
+ * same capture after a discipline change to compare.
+ *
+ * Capture format, one event per line, '#' starts a comment. Times are
+ * ns on the local clock (time_us_64() base) from the start of capture:
+ *
+ *   <ns> rb                            Rb PPS edge
+ *   <ns> gnss                          GNSS PPS edge (marks the UTC second)
+ *   <ns> nmea <sentence>               GNSS serial line, with or without
+ *                                      the leading '$' and checksum
+ *   <ns> lock <0|1>                    Rb lock status line
+ *   <ns> gate <count> [ppb sigma]      10MHz gate, with optional regression
+ *                                      result (crystal against the 10MHz)
+ *
+ * Usage:
+ *   chronos_replay [-v] capture.txt
+ *   chronos_replay [-v] [--dump] --synth SECONDS [--crystal-ppb P]
+ *                  [--jitter-ns J] [--gnss-offset-ns O] [--seed S]
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#define _POSIX_C_SOURCE 200809L  /* gmtime_r */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "host_sim.h"
+#include "chronos_rb.h"
+#include "gnss_input.h"
+#include "ref_manager.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define SYNC_TASK_US        100000      /* rubidium_sync_task, as TIMING_SLOW_US */
+#define POLL_TASK_US        10000       /* pps_fifo and gnss tasks, as TIMING_POLL_US */
+#define NMEA_DELAY_NS       300000000LL /* Sentences follow their PPS by ~300ms */
+#define RB_PHASE_NS         250000LL    /* Rb PPS phase against UTC (synth) */
+#define RB_WARMUP_S         5           /* Rb lock line rises after (synth) */
+#define SYNTH_UNIX_START    1749988800L /* 2025-06-15 12:00:00 UTC */
+#define LINE_MAX_LEN        256
+
+static const char *const state_names[] = {
+    "INIT", "FREQ_CAL", "COARSE", "FINE", "LOCKED", "HOLDOVER", "ERROR"
+};
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+typedef struct {
+    uint32_t seconds;
+    double crystal_ppb;
+    double jitter_ns;
+    double gnss_offset_ns;
+    uint64_t seed;
+} synth_config_t;
+
+/* Replay clock: capture time 0 maps to base_us on the virtual clock */
+static uint64_t base_us = 0;
+static uint64_t next_sync_us = 0;
+static uint64_t next_poll_us = 0;
+static uint8_t last_state = SYNC_STATE_INIT;
+static bool quiet = true;           /* Firmware console muted */
+
+/* Results */
+static uint32_t events = 0;
+static uint64_t last_event_ns = 0;
+static int64_t lock_ns = -1;
+static uint32_t err_count = 0;
+static double err_sum_sq = 0.0;
+static double err_max = 0.0;
+
+/*============================================================================
+ * TASK CADENCE
+ *============================================================================*/
+
+static const char *state_name(uint8_t state) {
+    return state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "?";
+}
+
+static void note_state(void) {
+    uint8_t state = g_time_state.sync_state;
+    if (state == last_state) {
+        return;
+    }
+
+    uint64_t t_us = time_us_64() - base_us;
+    host_console_mute(false);
+    printf("%10.3fs  %s -> %s\n", (double)t_us * 1e-6, state_name(last_state), state_name(state));
+    host_console_mute(quiet);
+    if (state == SYNC_STATE_LOCKED && lock_ns < 0) {
+        lock_ns = (int64_t)t_us * 1000;
+    }
+    last_state = state;
+}
+
+/**
+ * Disciplined time at a GNSS PPS against the UTC second it marks, as a
+ * client asking at that instant would see it
+ */
+static void measure_gnss_edge(uint64_t edge_ns) {
+    if (lock_ns < 0) {
+        return;
+    }
+    timestamp_t ts = timestamp_from_us(edge_ns / 1000);
+    double err = (double)ts.fraction * (1e9 / 4294967296.0) + (double)(edge_ns % 1000);
+    if (err >= 5e8) {
+        err -= 1e9;
+    }
+    err_count++;
+    err_sum_sq += err * err;
+    if (fabs(err) > err_max) {
+        err_max = fabs(err);
+    }
+}
+
+/**
+ * Run the timing tasks that fall due up to until_us, in time order
+ */
+static void run_tasks_until(uint64_t until_us) {
+    for (;;) {
+        uint64_t next = next_poll_us < next_sync_us ? next_poll_us : next_sync_us;
+        if (next > until_us) {
+            break;
+        }
+        if (next > time_us_64()) {
+            host_time_set_us(next);
+        }
+        if (next == next_poll_us) {
+            host_pps_fifo_task(NULL);
+            gnss_input_task();
+            next_poll_us += POLL_TASK_US;
+        } else {
+            rubidium_sync_task();
+            next_sync_us += SYNC_TASK_US;
+            note_state();
+        }
+    }
+    if (until_us > time_us_64()) {
+        host_time_set_us(until_us);
+    }
+}
+
+/*============================================================================
+ * EVENTS
+ *============================================================================*/
+
+static bool replay_line(const char *line, int lineno) {
+    unsigned long long t_ns;
+    char kind[16];
+    int used = 0;
+
+    while (*line == ' ' || *line == '\t') line++;
+    if (*line == '#' || *line == '\n' || *line == '\0') {
+        return true;
+    }
+    if (sscanf(line, "%llu %15s %n", &t_ns, kind, &used) < 2) {
+        fprintf(stderr, "line %d: expected '<ns> <event> ...'\n", lineno);
+        return false;
+    }
+    const char *args = line + used;
+
+    if (t_ns < last_event_ns) {
+        fprintf(stderr, "line %d: time goes backwards\n", lineno);
+        return false;
+    }
+    last_event_ns = t_ns;
+
+    uint64_t edge_ns = base_us * 1000 + t_ns;
+    run_tasks_until(edge_ns / 1000);
+    events++;
+
+    if (strcmp(kind, "rb") == 0) {
+        host_rb_pps_edge(edge_ns);
+    } else if (strcmp(kind, "gnss") == 0) {
+        measure_gnss_edge(edge_ns);
+        host_gnss_pps_edge(edge_ns);
+    } else if (strcmp(kind, "lock") == 0) {
+        host_rb_lock(atoi(args) != 0);
+    } else if (strcmp(kind, "gate") == 0) {
+        unsigned long count;
+        double ppb, sigma;
+        int n = sscanf(args, "%lu %lf %lf", &count, &ppb, &sigma);
+        if (n < 1) {
+            fprintf(stderr, "line %d: gate needs a count\n", lineno);
+            return false;
+        }
+        host_freq_gate((uint32_t)count, n == 3, n == 3 ? ppb : 0.0, n == 3 ? sigma : 0.0);
+    } else if (strcmp(kind, "nmea") == 0) {
+        char body[LINE_MAX_LEN], out[LINE_MAX_LEN + 8];
+        size_t len = strcspn(args, "\r\n");
+        if (len >= sizeof(body)) {
+            len = sizeof(body) - 1;
+        }
+        memcpy(body, args, len);
+        body[len] = '\0';
+        if (body[0] == '$') {
+            len = (size_t)snprintf(out, sizeof(out), "%s\r\n", body);
+        } else {
+            len = host_nmea_format(out, sizeof(out), body);
+        }
+        host_gnss_rx(out, len);
+    } else {
+        fprintf(stderr, "line %d: unknown event '%s'\n", lineno, kind);
+        return false;
+    }
+    return true;
+}
+
+static bool replay_file(FILE *f) {
+    char line[LINE_MAX_LEN + 64];
+    int lineno = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (!replay_line(line, ++lineno)) {
+            return false;
+        }
+    }
+    /* Let the state machine see the end of the last second */
+    run_tasks_until(time_us_64() + 1000000);
+    return true;
+}
+
+/*============================================================================
+ * SYNTHESISED CAPTURE
+ *============================================================================*/
+
+static uint64_t synth_rand_state;
+
+/* Standard normal, Box-Muller on xorshift64* */
+static double synth_gauss(void) {
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        synth_rand_state ^= synth_rand_state >> 12;
+        synth_rand_state ^= synth_rand_state << 25;
+        synth_rand_state ^= synth_rand_state >> 27;
+        u[i] = ((double)((synth_rand_state * 0x2545F4914F6CDD1DULL) >> 11) + 0.5) / 9007199254740992.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2.0 * 3.14159265358979323846 * u[1]);
+}
+
+/**
+ * UTC second k, true time in ns, seen on a crystal crystal_ppb fast
+ */
+static uint64_t synth_local_ns(const synth_config_t *c, double true_ns) {
+    return (uint64_t)llround(true_ns * (1.0 + c->crystal_ppb * 1e-9));
+}
+
+/**
+ * A rubidium locked after RB_WARMUP_S, a GNSS receiver with white PPS
+ * jitter and a fixed offset, and a local crystal crystal_ppb fast. The
+ * Rb 10MHz is exact, so gates count 10,000,000 and the regression sees
+ * the crystal against it.
+ */
+static void synth_write(FILE *f, const synth_config_t *c) {
+    fprintf(f, "# synth: %lu s, crystal %+.1f ppb, GNSS jitter %.1f ns, offset %+.1f ns\n",
+            (unsigned long)c->seconds, c->crystal_ppb, c->jitter_ns, c->gnss_offset_ns);
+    fprintf(f, "0 lock 0\n");
+
+    for (uint32_t k = 1; k <= c->seconds; k++) {
+        double utc_ns = (double)k * 1e9;
+        uint64_t gnss_ns = synth_local_ns(c, utc_ns + c->gnss_offset_ns + c->jitter_ns * synth_gauss());
+        uint64_t rb_ns = synth_local_ns(c, utc_ns + RB_PHASE_NS);
+
+        fprintf(f, "%llu gnss\n", (unsigned long long)gnss_ns);
+        fprintf(f, "%llu rb\n", (unsigned long long)rb_ns);
+        fprintf(f, "%llu gate 10000000 %.3f 0.1\n", (unsigned long long)rb_ns + 1000, c->crystal_ppb);
+        if (k == RB_WARMUP_S) {
+            fprintf(f, "%llu lock 1\n", (unsigned long long)rb_ns + 2000);
+        }
+
+        /* Sentences for the second this PPS began */
+        time_t unix_s = (time_t)(SYNTH_UNIX_START + k);
+        struct tm tm;
+        gmtime_r(&unix_s, &tm);
+        uint64_t nmea_ns = synth_local_ns(c, utc_ns + NMEA_DELAY_NS);
+        fprintf(f, "%llu nmea GNRMC,%02d%02d%02d.00,A,5130.00000,N,00007.00000,W,0.010,,%02d%02d%02d,,,A\n",
+                (unsigned long long)nmea_ns, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+        fprintf(f, "%llu nmea GNGGA,%02d%02d%02d.00,5130.00000,N,00007.00000,W,1,12,0.80,45.0,M,47.0,M,,\n",
+                (unsigned long long)nmea_ns + 20000000, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        fprintf(f, "%llu nmea GNZDA,%02d%02d%02d.00,%02d,%02d,%04d,00,00\n",
+                (unsigned long long)nmea_ns + 40000000, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
+    }
+}
+
+/*============================================================================
+ * MAIN
+ *============================================================================*/
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-v] capture.txt\n"
+            "       %s [-v] [--dump] --synth SECONDS [--crystal-ppb P] [--jitter-ns J]\n"
+            "                 [--gnss-offset-ns O] [--seed S]\n", prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    synth_config_t synth = { 0, 2500.0, 20.0, 0.0, 1 };
+    const char *path = NULL;
+    bool dump = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_val = i + 1 < argc;
+        if (strcmp(a, "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(a, "--dump") == 0) {
+            dump = true;
+        } else if (strcmp(a, "--synth") == 0 && has_val) {
+            synth.seconds = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(a, "--crystal-ppb") == 0 && has_val) {
+            synth.crystal_ppb = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--jitter-ns") == 0 && has_val) {
+            synth.jitter_ns = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--gnss-offset-ns") == 0 && has_val) {
+            synth.gnss_offset_ns = strtod(argv[++i], NULL);
+        } else if (strcmp(a, "--seed") == 0 && has_val) {
+            synth.seed = strtoull(argv[++i], NULL, 10);
+        } else if (a[0] != '-' && path == NULL) {
+            path = a;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((path == NULL) == (synth.seconds == 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE *f;
+    if (synth.seconds > 0) {
+        synth_rand_state = synth.seed * 0x9E3779B97F4A7C15ULL + 1;
+        if (dump) {
+            synth_write(stdout, &synth);
+            return 0;
+        }
+        f = tmpfile();
+        if (f == NULL) {
+            perror("tmpfile");
+            return 1;
+        }
+        synth_write(f, &synth);
+        rewind(f);
+    } else {
+        f = fopen(path, "r");
+        if (f == NULL) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    /* Firmware console output only with -v */
+    quiet = !verbose;
+    host_sim_set_verbose(verbose);
+    host_console_mute(quiet);
+    host_sim_init();
+
+    /* Capture time 0 on the next whole virtual second */
+    base_us = (time_us_64() / 1000000 + 1) * 1000000;
+    next_poll_us = base_us;
+    next_sync_us = base_us;
+    last_state = g_time_state.sync_state;
+
+    bool ok = replay_file(f);
+    fclose(f);
+    host_console_mute(false);
+    if (!ok) {
+        return 1;
+    }
+
+    printf("\nevents          %lu over %.1f s\n", (unsigned long)events, (double)last_event_ns * 1e-9);
+    printf("final state     %s, primary %s\n", state_name(g_time_state.sync_state),
+           ref_source_name(ref_get_primary()));
+    if (lock_ns >= 0) {
+        printf("lock time       %.1f s\n", (double)lock_ns * 1e-9);
+    } else {
+        printf("lock time       never\n");
+    }
+    if (err_count > 0) {
+        printf("time error      %lu GNSS edges after lock, rms %.1f ns, max %.1f ns\n",
+               (unsigned long)err_count, sqrt(err_sum_sq / err_count), err_max);
+    }
+    printf("correction      %+.3f ppb", discipline_get_correction());
+    if (synth.seconds > 0) {
+        printf(" (crystal %+.3f ppb)", synth.crystal_ppb);
+    }
+    printf("\nerror bound     %.1f ns\n", discipline_get_time_error_ns());
+    return 0;
+}
@@ -0,0 +1,239 @@
+/**
+ * CHRONOS-Rb Host Reference Inputs
+ *
+ * The public API of pps_capture.c and freq_counter.c, fed from the
+ * harness instead of the PIO edge counters. Edges arrive already in ns
+ * on the time_us_64() base, which is what the PIO path produces after
+ * edge_ticks_to_ns(), so everything downstream runs unmodified.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "host_sim.h"
+#include "chronos_rb.h"
+#include "ref_manager.h"
+#include "clock_model.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define EXPECTED_COUNT          10000000UL
+#define FREQ_REG_MIN_SIGMA_PPB  0.05        /* As freq_counter.c */
+#define FREQ_REG_STALE_US       2000000
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static uint64_t rb_edge_ns = 0;
+static uint64_t rb_edge_us = 0;
+static int64_t rb_interval_ns = 0;
+static uint64_t gnss_edge_ns = 0;
+static bool gnss_edge_pending = false;
+
+static uint32_t last_count = 0;
+static uint32_t measurement_count = 0;
+static bool new_measurement = false;
+static uint64_t last_measurement_us = 0;
+static int32_t count_error = 0;
+
+static freq_regression_t reg_result;
+static uint64_t reg_result_us = 0;
+
+/*============================================================================
+ * HARNESS INPUTS
+ *============================================================================*/
+
+void host_rb_pps_edge(uint64_t edge_ns) {
+    rb_interval_ns = (rb_edge_ns != 0) ? (int64_t)(edge_ns - rb_edge_ns) : 0;
+    rb_edge_ns = edge_ns;
+    rb_edge_us = edge_ns / 1000;
+    pps_irq_handler();
+}
+
+void host_gnss_pps_edge(uint64_t edge_ns) {
+    host_gpio_edge(GPIO_GNSS_PPS_INPUT, true);
+    host_gpio_edge(GPIO_GNSS_PPS_INPUT, false);
+    gnss_edge_ns = edge_ns;
+    gnss_edge_pending = true;
+}
+
+bool host_pps_fifo_task(uint64_t *edge_out) {
+    if (!gnss_edge_pending) {
+        return false;
+    }
+    gnss_edge_pending = false;
+    uint64_t edge_ns = gnss_edge_ns;
+
+    /* Same fold as freq_counter_pps_task(): the edges may fall either
+     * side of a second boundary */
+    bool have_offset = false;
+    int32_t offset_ns = 0;
+    if (rb_edge_ns != 0 && is_pps_valid()) {
+        int64_t offset = (int64_t)(edge_ns - rb_edge_ns) % 1000000000LL;
+        if (offset > 500000000LL) {
+            offset -= 1000000000LL;
+        } else if (offset < -500000000LL) {
+            offset += 1000000000LL;
+        }
+        offset_ns = (int32_t)offset;
+        have_offset = true;
+    }
+    ref_gnss_edge(edge_ns, have_offset ? &offset_ns : NULL);
+
+    if (edge_out != NULL) {
+        *edge_out = edge_ns;
+    }
+    return true;
+}
+
+void host_freq_gate(uint32_t count, bool have_reg, double local_ppb, double sigma_ppb) {
+    last_count = count;
+    measurement_count++;
+    new_measurement = true;
+    last_measurement_us = time_us_64();
+    count_error = (int32_t)count - (int32_t)EXPECTED_COUNT;
+    g_time_state.last_freq_count = count;
+    g_stats.freq_measurements = measurement_count;
+
+    if (!have_reg) {
+        return;
+    }
+    if (sigma_ppb < FREQ_REG_MIN_SIGMA_PPB) {
+        sigma_ppb = FREQ_REG_MIN_SIGMA_PPB;
+    }
+    if (ref_get_primary() == REF_RB_PPS) {
+        discipline_frequency_update(local_ppb, sigma_ppb);
+    }
+
+    clock_model_t model;
+    discipline_get_model(&model);
+    reg_result.local_ppb = local_ppb;
+    reg_result.sigma_ppb = sigma_ppb;
+    reg_result.referenced = model.initialized;
+    reg_result.rb_offset_ppb = model.initialized ? model.x[1] - local_ppb : 0.0;
+    reg_result.gates++;
+    reg_result_us = time_us_64();
+}
+
+void host_rb_lock(bool locked) {
+    host_gpio_set(GPIO_RB_LOCK_STATUS, locked);
+}
+
+/*============================================================================
+ * GNSS SERIAL
+ *============================================================================*/
+
+void host_gnss_rx(const void *data, size_t len) {
+    host_uart_rx(uart1, (const uint8_t *)data, len);
+}
+
+size_t host_nmea_format(char *out, size_t max, const char *body) {
+    uint8_t sum = 0;
+    for (const char *c = body; *c; c++) {
+        sum ^= (uint8_t)*c;
+    }
+    int len = snprintf(out, max, "$%s*%02X\r\n", body, sum);
+    return (len > 0 && (size_t)len < max) ? (size_t)len : 0;
+}
+
+size_t host_ubx_format(uint8_t *out, size_t max, uint8_t cls, uint8_t id,
+                       const uint8_t *payload, uint16_t len) {
+    if ((size_t)len + 8 > max) {
+        return 0;
+    }
+    out[0] = 0xB5;
+    out[1] = 0x62;
+    out[2] = cls;
+    out[3] = id;
+    out[4] = (uint8_t)len;
+    out[5] = (uint8_t)(len >> 8);
+    if (len > 0) {
+        memcpy(out + 6, payload, len);
+    }
+
+    /* 8-bit Fletcher over class, id, length and payload */
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < (size_t)len + 6; i++) {
+        ck_a += out[i];
+        ck_b += ck_a;
+    }
+    out[len + 6] = ck_a;
+    out[len + 7] = ck_b;
+    return (size_t)len + 8;
+}
+
+/*============================================================================
+ * PPS CAPTURE API
+ *============================================================================*/
+
+uint64_t get_last_pps_timestamp(void) {
+    return rb_edge_us;
+}
+
+uint64_t get_last_pps_timestamp_ns(void) {
+    return rb_edge_ns;
+}
+
+int64_t get_last_pps_interval_ns(void) {
+    return rb_interval_ns;
+}
+
+bool is_pps_valid(void) {
+    return rb_edge_us != 0 && time_us_64() - rb_edge_us < 2000000;
+}
+
+/*============================================================================
+ * FREQUENCY COUNTER API
+ *============================================================================*/
+
+bool freq_counter_new_measurement(void) {
+    if (new_measurement) {
+        new_measurement = false;
+        return true;
+    }
+    return false;
+}
+
+int32_t freq_counter_get_error(void) {
+    return count_error;
+}
+
+bool freq_counter_signal_present(void) {
+    return measurement_count != 0 &&
+           time_us_64() - last_measurement_us <= 2000000 &&
+           last_count > 9000000 && last_count < 11000000;
+}
+
+double get_frequency_offset_ppb(void) {
+    bool fresh = reg_result.gates > 0 && time_us_64() - reg_result_us < FREQ_REG_STALE_US;
+    double offset;
+
+    if (fresh && reg_result.referenced) {
+        offset = reg_result.rb_offset_ppb;
+    } else if (fresh && rb_interval_ns != 0) {
+        offset = (double)(rb_interval_ns - 1000000000LL) - reg_result.local_ppb;
+    } else if (last_count != 0) {
+        offset = ((double)last_count - (double)EXPECTED_COUNT) / (double)EXPECTED_COUNT * 1e9;
+    } else {
+        return 0.0;
+    }
+
+    g_time_state.frequency_offset = offset;
+    return offset;
+}
+
+void freq_counter_get_regression(freq_regression_t *out) {
+    *out = reg_result;
+    out->valid = reg_result.gates > 0 && time_us_64() - reg_result_us < FREQ_REG_STALE_US;
+}
+
+/* The GPIO callback calls this first on the board; the PIO stamp is what
+ * counts, and here that is the edge_ns the harness passes */
+void freq_counter_capture_gnss_pps(void) {
+}
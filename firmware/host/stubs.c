@@ -0,0 +1,243 @@
+/**
+ * CHRONOS-Rb Host Stubs
+ *
+ * Everything else the built modules link against: globals from main.c,
+ * the logger, scheduler, network timestamps, NTS, flash warm start and
+ * the reference waveform engine, config. Single-core, no flash, no NTS
+ * or symmetric keys.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#define _POSIX_C_SOURCE 200809L  /* dup, fileno */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "host_sim.h"
+#include "chronos_rb.h"
+#include "gnss_input.h"
+#include "timing_core.h"
+#include "ref_manager.h"
+#include "log_buffer.h"
+#include "net_timestamp.h"
+#include "nts.h"
+#include "aes_siv.h"
+#include "config.h"
+#include "ref_wave.h"
+#include "sched.h"
+#include "warm_start.h"
+
+/*============================================================================
+ * GLOBALS (main.c)
+ *============================================================================*/
+
+volatile time_state_t g_time_state;
+volatile statistics_t g_stats;
+
+static bool verbose = false;
+static int console_fd = -1;
+
+/*============================================================================
+ * SETUP
+ *============================================================================*/
+
+void host_sim_init(void) {
+    memset((void *)&g_time_state, 0, sizeof(g_time_state));
+    memset((void *)&g_stats, 0, sizeof(g_stats));
+
+    time_init();
+    discipline_init();
+    ref_init();
+    rubidium_sync_init();
+    gnss_input_init();
+}
+
+void host_sim_set_verbose(bool enable) {
+    verbose = enable;
+}
+
+void host_console_mute(bool mute) {
+    fflush(stdout);
+    if (mute && console_fd < 0) {
+        console_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+    } else if (!mute && console_fd >= 0) {
+        dup2(console_fd, STDOUT_FILENO);
+        close(console_fd);
+        console_fd = -1;
+    }
+}
+
+/*============================================================================
+ * LOGGER AND BOARD
+ *============================================================================*/
+
+/* Records carry integers and pointers only, so printf takes them as is */
+void log_write(log_module_t module, log_level_t level, const char *fmt,
+               uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3) {
+    (void)module; (void)level;
+    if (verbose) {
+        printf("%10.3f ", (double)time_us_64() * 1e-6);
+        printf(fmt, a0, a1, a2, a3);
+    }
+}
+
+void led_blink_activity(void) {}
+
+/*============================================================================
+ * SCHEDULER (the harness calls the tasks itself)
+ *============================================================================*/
+
+void sched_post(uint32_t events) { (void)events; }
+void sched_wake_at(uint32_t when_us) { (void)when_us; }
+void sched_wake_in(uint32_t delay_us) { (void)delay_us; }
+
+/*============================================================================
+ * TIMING CORE
+ *============================================================================*/
+
+/* One core, so the "snapshot" is the live state. The board publishes on
+ * every PPS; counting virtual seconds keeps caches keyed on the publish
+ * count (the NTP reply template) refreshing at that rate. */
+void timing_core_get_snapshot(timing_snapshot_t *out) {
+    memcpy(&out->state, (const void *)&g_time_state, sizeof(time_state_t));
+    out->min_offset_ns = g_stats.min_offset_ns;
+    out->max_offset_ns = g_stats.max_offset_ns;
+    out->avg_offset_ns = g_stats.avg_offset_ns;
+    out->freq_measurements = g_stats.freq_measurements;
+    out->discipline_integral = discipline_get_integral();
+    double err_ns = discipline_get_time_error_ns();
+    out->time_error_ns = (err_ns < (double)UINT32_MAX) ? (uint32_t)err_ns : UINT32_MAX;
+    ref_get_status(&out->ref);
+    freq_counter_get_regression(&out->freq);
+    out->publish_count = timing_core_publish_count();
+}
+
+uint32_t timing_core_publish_count(void) {
+    return (uint32_t)(time_us_64() / 1000000) + 1;
+}
+
+bool warm_start_check(bool rb_locked, uint32_t uptime_s, double *integral_ppb) {
+    (void)rb_locked; (void)uptime_s; (void)integral_ppb;
+    return false;
+}
+
+/*============================================================================
+ * NETWORK
+ *============================================================================*/
+
+/* No WiFi link: nothing to correct for */
+int32_t wifi_latency_ns(void) { return 0; }
+
+/* No driver hook: frames are stamped when the callback runs */
+void net_ts_attach(void) {}
+uint64_t net_ts_rx_us(void) { return time_us_64(); }
+uint32_t net_ts_tx_count(void) { return host_udp_tx_count(); }
+uint64_t net_ts_tx_since(uint32_t tx_count_before) {
+    (void)tx_count_before;
+    return time_us_64();
+}
+
+/* One interface, no wired link */
+struct netif *net_ts_time_netif(void) { return netif_default; }
+bool net_ts_bind_pcb(struct udp_pcb *pcb) { (void)pcb; return false; }
+int32_t net_ts_link_latency_ns(void) { return 0; }
+struct netif *eth_time_netif(void) { return NULL; }
+
+bool nts_is_enabled(void) { return false; }
+
+nts_status_t nts_verify_request(const uint8_t *pkt, size_t len, nts_request_t *req) {
+    (void)pkt; (void)len;
+    req->status = NTS_NONE;
+    return NTS_NONE;
+}
+
+size_t nts_finish_response(const nts_request_t *req, uint8_t *pkt, size_t max_len) {
+    (void)req; (void)pkt; (void)max_len;
+    return 0;
+}
+
+/* No AES: MACed requests are dropped as unverifiable */
+bool aes_cmac_setkey(aes_siv_key_t *key, const uint8_t raw[AES_CMAC_KEY_SIZE]) {
+    (void)raw;
+    memset(key, 0, sizeof(*key));
+    return false;
+}
+
+void aes_cmac(const aes_siv_key_t *key, const uint8_t *data, size_t len,
+              uint8_t out[AES_SIV_TAG_SIZE]) {
+    (void)key; (void)data; (void)len;
+    memset(out, 0, AES_SIV_TAG_SIZE);
+}
+
+/*============================================================================
+ * CONFIG (defaults of zero: broadcast off)
+ *============================================================================*/
+
+static config_t host_config;
+
+config_t *config_get(void) {
+    return &host_config;
+}
+
+bool config_save_secret(const uint8_t secret[CONFIG_SECRET_SIZE]) {
+    memcpy(host_config.unit_secret, secret, CONFIG_SECRET_SIZE);
+    host_config.unit_secret_flags = CONFIG_SECRET_VALID;
+    return false;   /* No flash */
+}
+
+/*============================================================================
+ * REFERENCE WAVEFORMS (lists are built, nothing plays)
+ *============================================================================*/
+
+bool ref_wave_init(ref_wave_t *w, uint sm, uint out_pin,
+                   ref_wave_block_t *lists, uint32_t blocks) {
+    (void)out_pin;
+    memset(w, 0, sizeof(*w));
+    w->sm = sm;
+    w->list[0] = lists;
+    w->list[1] = lists + blocks;
+    w->blocks = blocks;
+    return true;
+}
+
+ref_wave_block_t *ref_wave_put(const ref_wave_t *w, ref_wave_block_t *b,
+                               const uint32_t *words, uint32_t count) {
+    b->ctrl = w->ctrl_table;
+    b->read = words;
+    b->write = NULL;
+    b->count = count;
+    return b + 1;
+}
+
+ref_wave_block_t *ref_wave_put_ring(const ref_wave_t *w, ref_wave_block_t *b,
+                                    const uint32_t *table, uint32_t count) {
+    b->ctrl = w->ctrl_ring;
+    b->read = table;
+    b->write = NULL;
+    b->count = count;
+    return b + 1;
+}
+
+void ref_wave_end(const ref_wave_t *w, int idx, ref_wave_block_t *b) {
+    (void)w; (void)idx;
+    b->count = 0;
+}
+
+bool ref_wave_service(ref_wave_t *w, uint32_t now, ref_wave_build_fn build) {
+    build(0, now + 1);
+    w->label[0] = now + 1;
+    w->frames++;
+    return false;
+}
+
+void ref_wave_invalidate(ref_wave_t *w) { (void)w; }
+void ref_wave_output(uint out_pin, bool enable) { (void)out_pin; (void)enable; }
@@ -4,7 +4,12 @@
  * Measures local AC mains frequency from zero-crossing detector input.
  * The zero-crossing detector (H11AA1 or similar) produces a pulse at
  * each AC zero crossing, resulting in 2x the mains frequency (100Hz for
- * 50Hz mains, 120Hz for 60Hz mains).
+ * 50Hz mains, 120Hz for 60Hz mains) unless only one half-wave drives it;
+ * set AC_FREQ_EDGES_PER_CYCLE to match.
+ *
+ * Each pulse is stamped by a PIO edge counter and every period corrected
+ * to the rubidium, giving per-cycle frequency, ROCOF and grid time error
+ * (what a synchronous clock on the grid shows minus Rb time).
  *
  * Typical mains frequency ranges:
  *   - 50 Hz regions: 49.5 - 50.5 Hz nominal (Europe, Asia, Africa, Australia)
@@ -32,11 +37,17 @@
 #define AC_FREQ_MIN_HZ              45.0f   /* Minimum valid frequency */
 #define AC_FREQ_MAX_HZ              65.0f   /* Maximum valid frequency */
 #define AC_FREQ_TIMEOUT_MS          100     /* Timeout for signal loss */
+#define AC_FREQ_EDGES_PER_CYCLE     1       /* Detector pulses per mains cycle */
+
+/* Grid reporting */
+#define AC_REPORT_CYCLES            10      /* Cycles per report (200ms at 50Hz) */
+#define AC_REPORT_HISTORY           64      /* Reports kept (~13s at 50Hz) */
+#define AC_GTE_MAX_GAP_CYCLES       10      /* Dropout bridged without restarting grid time */
 
 /* History buffer sizes */
 #define AC_FREQ_HISTORY_SIZE        60      /* Short-term samples for instant average */
-#define AC_FREQ_MINUTE_HISTORY      60      /* Last 60 minutes at minute resolution */
-#define AC_FREQ_HOUR_HISTORY        48      /* Last 48 hours at hour resolution */
+#define AC_FREQ_MINUTE_HISTORY      60      /* Minutes the history getters return */
+#define AC_FREQ_HOUR_HISTORY        48      /* Hours the history getters return */
 
 /*============================================================================
  * DATA STRUCTURES
@@ -52,8 +63,23 @@ typedef struct {
     uint32_t period_us;             /* Measured period (us) */
     bool signal_present;            /* Zero-crossing signal detected */
     bool frequency_valid;           /* Frequency within valid range */
+    bool rb_referenced;             /* Periods corrected to the Rb 10MHz */
+    uint32_t nominal_hz;            /* 50 or 60, 0 until the first valid cycle */
+    float rocof_hz_s;               /* Rate of change of frequency, last report */
+    int64_t grid_time_error_ns;     /* Grid time minus Rb time */
+    uint32_t grid_time_cycles;      /* Cycles the grid time error covers */
+    uint32_t missed_cycles;         /* Dropouts bridged */
+    uint32_t glitches;              /* Pulses rejected as too close */
 } ac_freq_state_t;
 
+/* One report: AC_REPORT_CYCLES cycles */
+typedef struct {
+    uint64_t unix_us;               /* Time of the closing crossing */
+    uint32_t freq_uhz;              /* Mean frequency over the window (µHz) */
+    int32_t rocof_mhz_s;            /* Against the previous window (mHz/s) */
+    int64_t grid_time_error_ns;     /* At the closing crossing */
+} ac_grid_report_t;
+
 /*============================================================================
  * PUBLIC API
  *============================================================================*/
@@ -64,15 +90,9 @@ typedef struct {
  */
 void ac_freq_init(void);
 
-/**
- * AC zero-crossing IRQ handler
- * Called from shared GPIO callback in gps_input.c
- */
-void ac_zero_cross_irq_handler(void);
-
 /**
  * Process AC frequency measurements
- * Call from main loop to update averaging
+ * Drains the zero-crossing stamps and updates averaging (timing core)
  */
 void ac_freq_task(void);
 
@@ -112,7 +132,13 @@ const ac_freq_state_t* ac_freq_get_state(void);
 void ac_freq_print_status(void);
 
 /**
- * Get minute history buffer
+ * Mean frequency of the last completed second in µHz, 0 when it had no
+ * valid cycles (the time-series store's "ac" series)
+ */
+uint32_t ac_freq_get_second_uhz(void);
+
+/**
+ * Get minute history buffer, from the time-series store's 1 min tier
  * @param buf Output buffer for minute averages (oldest first)
  * @param max_samples Maximum samples to return
  * @return Number of valid samples copied
@@ -120,7 +146,7 @@ void ac_freq_print_status(void);
 int ac_freq_get_minute_history(float *buf, int max_samples);
 
 /**
- * Get hour history buffer
+ * Get hour history buffer, from the time-series store's 1 h tier
  * @param buf Output buffer for hour averages (oldest first)
  * @param max_samples Maximum samples to return
  * @return Number of valid samples copied
@@ -128,8 +154,20 @@ int ac_freq_get_minute_history(float *buf, int max_samples);
 int ac_freq_get_hour_history(float *buf, int max_samples);
 
 /**
- * Get current accumulator status for diagnostics
+ * Get current accumulator status for diagnostics: cycles in this second
+ */
+void ac_freq_get_accum_status(uint32_t *sec_count);
+
+/**
+ * Number of grid reports written since boot
+ */
+uint32_t ac_freq_report_count(void);
+
+/**
+ * Copy report number seq (0-based, from ac_freq_report_count()). Safe
+ * from either core.
+ * @return false if it is not written yet or already overwritten
  */
-void ac_freq_get_accum_status(uint32_t *sec_count, uint32_t *min_count);
+bool ac_freq_get_report(uint32_t seq, ac_grid_report_t *out);
 
 #endif /* AC_FREQ_MONITOR_H */
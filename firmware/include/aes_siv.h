@@ -0,0 +1,73 @@
+/**
+ * CHRONOS-Rb AES-SIV-CMAC-256
+ *
+ * RFC 5297 deterministic authenticated encryption with one associated
+ * data string and a nonce, as used by NTS (AEAD_AES_SIV_CMAC_256, RFC
+ * 8915). Keys are expanded once into an aes_siv_key_t and reused, so a
+ * seal or open costs only block encryptions. The CMAC underneath is
+ * also exported for NTP symmetric key MACs (AES-128-CMAC, RFC 8573).
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef AES_SIV_H
+#define AES_SIV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <mbedtls/aes.h>
+
+#define AES_SIV_KEY_SIZE    32      /* K1 (S2V) || K2 (CTR) */
+#define AES_SIV_TAG_SIZE    16
+#define AES_CMAC_KEY_SIZE   16
+
+typedef struct {
+    mbedtls_aes_context mac;    /* K1, encrypt schedule */
+    mbedtls_aes_context ctr;    /* K2, encrypt schedule */
+    uint8_t sub1[16];           /* CMAC subkeys of K1 */
+    uint8_t sub2[16];
+} aes_siv_key_t;
+
+/**
+ * Expand a 32-byte key. Returns false if mbedtls rejects it.
+ */
+bool aes_siv_setkey(aes_siv_key_t *key, const uint8_t raw[AES_SIV_KEY_SIZE]);
+
+/**
+ * Wipe an expanded key
+ */
+void aes_siv_free(aes_siv_key_t *key);
+
+/**
+ * out = V || C, AES_SIV_TAG_SIZE + len bytes. out may equal pt + 16
+ * for in-place use but must not overlap ad or nonce.
+ */
+void aes_siv_seal(const aes_siv_key_t *key,
+                  const uint8_t *ad, size_t ad_len,
+                  const uint8_t *nonce, size_t nonce_len,
+                  const uint8_t *pt, size_t len, uint8_t *out);
+
+/**
+ * Decrypt in = V || C (in_len >= AES_SIV_TAG_SIZE) into pt and check the
+ * tag. Returns false, with pt zeroed, if it does not authenticate.
+ */
+bool aes_siv_open(const aes_siv_key_t *key,
+                  const uint8_t *ad, size_t ad_len,
+                  const uint8_t *nonce, size_t nonce_len,
+                  const uint8_t *in, size_t in_len, uint8_t *pt);
+
+/**
+ * Expand a 16-byte AES-128-CMAC key into the K1 half of key (the CTR
+ * half stays unset). Free with aes_siv_free().
+ */
+bool aes_cmac_setkey(aes_siv_key_t *key, const uint8_t raw[AES_CMAC_KEY_SIZE]);
+
+/**
+ * AES-CMAC (RFC 4493) of data under K1
+ */
+void aes_cmac(const aes_siv_key_t *key, const uint8_t *data, size_t len,
+              uint8_t out[AES_SIV_TAG_SIZE]);
+
+#endif /* AES_SIV_H */
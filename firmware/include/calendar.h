@@ -0,0 +1,105 @@
+/**
+ * CHRONOS-Rb Calendar
+ *
+ * One broken-down UTC time shared by every output that labels a second.
+ * On each PPS the timing core advances the cached calendar by one second
+ * (carrying into minutes, days, months and years, recomputing the US DST
+ * change days once a year) instead of every encoder dividing the NTP
+ * seconds down and walking the years from 1970. When the time base has
+ * stepped, the cache is rebuilt with an O(1) days-to-civil conversion.
+ *
+ * The cache holds the second that started at the last edge and the one
+ * that starts at the next, so frames built ahead of the edge (IRIG-B,
+ * radio timecodes) find theirs without converting. After each advance
+ * the task posts SCHED_EV_SECOND; the NMEA, radio and IRIG-B tasks wake
+ * on it.
+ *
+ * Leap second: a pending leap reported by the GNSS (UBX-NAV-TIMELS) is
+ * flagged through the UTC month it ends, with the NTP second it comes
+ * before, so each encoder can raise its own warning window.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define CALENDAR_GPS_TAI_S      19      /* TAI - GPS time */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    uint32_t ntp_secs;          /* The second described */
+    uint16_t year;
+    uint8_t month;              /* 1-12 */
+    uint8_t day;                /* 1-31 */
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t wday;               /* 0 = Sunday */
+    uint16_t yday;              /* 1-366 */
+    bool leap_year;
+    bool dst_us_at_0h;          /* US DST in effect at 00:00 UTC today */
+    bool dst_us_at_24h;         /* ... and at 24:00 UTC today */
+    int8_t leap_pending;        /* +1/-1 at the end of this month, 0 = none
+                                   (still set on leap_ntp itself) */
+    uint32_t leap_ntp;          /* Second the leap comes before (when pending) */
+    int16_t tai_utc;            /* TAI - UTC (s), 0 = not known */
+} calendar_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Build the cache from the current time (timing core, before the
+ * outputs are initialized)
+ */
+void calendar_init(void);
+
+/**
+ * Advance the cache when the second changes and post SCHED_EV_SECOND
+ * (timing core, woken by the PPS)
+ */
+void calendar_task(void);
+
+/**
+ * The second that started at the last edge, and the one that starts at
+ * the next (timing core only)
+ */
+const calendar_t *calendar_now(void);
+const calendar_t *calendar_next(void);
+
+/**
+ * Broken-down time for any second (any core): a copy of the cache when
+ * it holds that second, otherwise converted
+ */
+void calendar_at(uint32_t ntp_secs, calendar_t *out);
+
+/**
+ * Convert without the cache. Leap second and TAI fields come from the
+ * GNSS state known to the service.
+ */
+void calendar_from_ntp(uint32_t ntp_secs, calendar_t *out);
+
+/**
+ * Advance a calendar by one second
+ */
+void calendar_step(calendar_t *c);
+
+/**
+ * NTP seconds of a UTC date and time (year 1970-2036)
+ */
+uint32_t calendar_to_ntp(int year, int month, int day, int hour, int minute, int second);
+
+#endif /* CALENDAR_H */
@@ -24,6 +24,28 @@
 #define CHRONOS_BUILD_DATE      __DATE__
 #define CHRONOS_BUILD_TIME      __TIME__
 
+/*============================================================================
+ * BUILD OPTIONS
+ *============================================================================*/
+
+/* Run the timing path (PPS, discipline, outputs) on core1 and the network
+ * stack/web/CLI on core0. Set by CMake option CHRONOS_MULTICORE. */
+#ifndef CHRONOS_MULTICORE
+#define CHRONOS_MULTICORE       1
+#endif
+
+/* Cycle tracing of IRQs and superloop tasks (perf_trace.h, `perf` CLI
+ * command). Set by CMake option CHRONOS_PERF_TRACE; costs nothing when 0. */
+#ifndef CHRONOS_PERF_TRACE
+#define CHRONOS_PERF_TRACE      0
+#endif
+
+/* WIZnet W5500 wired Ethernet for NTP/PTP (eth_w5500.h). Set by CMake
+ * option CHRONOS_ETH_W5500; WiFi stays the management interface. */
+#ifndef CHRONOS_ETH_W5500
+#define CHRONOS_ETH_W5500       0
+#endif
+
 /*============================================================================
  * GPIO PIN DEFINITIONS - Raspberry Pi Pico 2-W
  *============================================================================*/
@@ -51,9 +73,8 @@
 /* GNSS Receiver Input (u-blox NEO-M8N, M9N, or similar) */
 #define GPIO_GNSS_PPS_INPUT     11      /* GP11 - GNSS 1PPS input (backup time source) */
 
-/* UART for Debug (optional) */
-#define GPIO_UART_TX            0       /* GP0 - UART0 TX */
-#define GPIO_UART_RX            1       /* GP1 - UART0 RX */
+/* NMEA Time Output (console is USB only) */
+#define GPIO_NMEA_TX            28      /* GP28 - UART0 TX */
 
 /* I2C for optional OLED display */
 #define GPIO_I2C_SDA            12      /* GP12 - I2C0 SDA */
@@ -82,6 +103,16 @@
 #define GPIO_GNSS_TX            4       /* GP4 - UART1 TX (commands to GNSS module) */
 #define GPIO_GNSS_RX            5       /* GP5 - UART1 RX (NMEA from GNSS module) */
 
+/* W5500 Ethernet (SPI1, CHRONOS_ETH_W5500 builds). No free pins can
+ * carry SPI, so it takes the optional OLED's I2C pins and the default
+ * 0.5 s/1 s/6 s pulse pins; pulse_output_pin_allowed() then refuses
+ * them. */
+#define GPIO_ETH_MISO           12      /* GP12 - SPI1 RX */
+#define GPIO_ETH_CS             13      /* GP13 - Chip select (active low) */
+#define GPIO_ETH_SCK            14      /* GP14 - SPI1 SCK */
+#define GPIO_ETH_MOSI           15      /* GP15 - SPI1 TX */
+#define GPIO_ETH_INT            16      /* GP16 - INTn (active low) */
+
 /* Interval pulse timing */
 #define PULSE_WIDTH_MS          10      /* Output pulse width in milliseconds */
 
@@ -109,6 +140,8 @@
 #define DISCIPLINE_TAU_SLOW     1024            /* Slow time constant (seconds) */
 #define DISCIPLINE_GAIN_P       0.7             /* Proportional gain */
 #define DISCIPLINE_GAIN_I       0.3             /* Integral gain */
+#define DISCIPLINE_KALMAN_DEFAULT 1             /* Steer from the clock model, not PI */
+#define DISCIPLINE_HOLDOVER_MAX_ERR_NS 1000000  /* Time invalid past 1 ms predicted error */
 
 /* GNSS receiver parameters */
 #define GPS_UART_BAUD           115200          /* GNSS module baud rate */
@@ -133,6 +166,8 @@
 #define NTP_POLL_MAX            10              /* 1024 seconds maximum */
 #define NTP_PRECISION           -20             /* ~1 microsecond precision */
 #define NTP_REFID               "RBDM"          /* Rubidium reference ID */
+#define NTP_BCAST_LOG_DEFAULT   6               /* Broadcast every 64 seconds */
+#define NTP_BCAST_KEY_ID        1               /* Symmetric key ID of the broadcasts */
 
 /* PTP (IEEE 1588) Configuration */
 #define PTP_EVENT_PORT          319
@@ -141,7 +176,16 @@
 #define PTP_PRIORITY1           128
 #define PTP_PRIORITY2           128
 #define PTP_CLOCK_CLASS         6               /* Primary reference source */
-#define PTP_CLOCK_ACCURACY      0x21            /* 100ns accuracy class */
+#define PTP_CLOCK_ACCURACY      0x21            /* Best class claimed (100ns) */
+#define PTP_SYNC_LOG_DEFAULT    0               /* Multicast Sync once a second */
+#define PTP_SYNC_LOG_MIN        -7              /* Fastest Sync: 128/s */
+#define PTP_SYNC_LOG_MAX        4               /* Slowest Sync: every 16s */
+#define PTP_ANNOUNCE_LOG        1               /* Multicast Announce every 2s */
+
+/* WiFi power management */
+#define WIFI_LISTEN_DTIM_DEFAULT 1              /* Wake for every DTIM beacon */
+#define WIFI_LISTEN_DTIM_MAX    10
+#define WIFI_PM2_SLEEP_MS_DEFAULT 200           /* PM2 idle time before dozing */
 
 /* Web Interface */
 #define WEB_PORT                80
@@ -186,6 +230,18 @@ typedef struct {
     uint8_t sync_state;         /* Synchronization state machine */
 } time_state_t;
 
+/* 10MHz regression counter, one 1s gate (freq_counter.c, timing core) */
+typedef struct {
+    bool valid;                 /* A gate completed within the last 2s */
+    bool referenced;            /* rb_offset_ppb from the clock model */
+    double local_ppb;           /* Local crystal against the 10MHz */
+    double sigma_ppb;           /* 1 sigma of local_ppb, from the fit residuals */
+    double rb_offset_ppb;       /* 10MHz against the reference */
+    uint32_t gates;             /* Gates completed */
+    uint32_t lost;              /* Stamps missed by the ring (fit thinned) */
+    uint32_t gaps;              /* Gates restarted after a signal gap */
+} freq_regression_t;
+
 /* Synchronization states */
 typedef enum {
     SYNC_STATE_INIT = 0,        /* Initial state, waiting for lock */
@@ -216,6 +272,108 @@ typedef struct __attribute__((packed)) {
     uint32_t tx_ts_frac;        /* Transmit timestamp fraction */
 } ntp_packet_t;
 
+/* PTP egress latency model state (for CLI reporting) */
+typedef struct {
+    bool enabled;               /* Link probing active */
+    bool valid;                 /* Latency has been measured */
+    int32_t latency_ns;         /* Filtered one-way latency */
+    int32_t trim_ns;            /* Manual asymmetry trim */
+    uint32_t last_rtt_us;       /* Last link probe round trip */
+    uint32_t samples;           /* Link probes accepted */
+} ptp_egress_info_t;
+
+/* PTP unicast slave (for CLI reporting). Arrays are indexed
+ * Announce, Sync, Delay_Resp. */
+typedef struct {
+    uint32_t addr;              /* Slave IPv4 address (network order) */
+    int8_t log_interval[3];     /* Granted logInterMessagePeriod */
+    uint32_t remaining_s[3];    /* Grant time left (0 = none) */
+    uint32_t syncs_sent;        /* Unicast Sync messages sent */
+} ptp_slave_info_t;
+
+/* PTP best master clock state (for CLI reporting) */
+typedef struct {
+    bool master;                /* Sending multicast Sync/Announce */
+    uint8_t priority1;
+    uint8_t priority2;
+    uint8_t clock_class;        /* As announced now */
+    uint8_t clock_accuracy;
+    int8_t sync_log;            /* Multicast Sync logMessageInterval */
+    int8_t announce_log;
+    uint32_t role_changes;      /* MASTER <-> PASSIVE transitions */
+    uint32_t tx_pbuf_allocs;    /* Pooled TX pbufs (re)allocated */
+} ptp_bmca_info_t;
+
+/* Another master heard on the PTP domain (for CLI reporting) */
+typedef struct {
+    uint32_t addr;              /* IPv4 address (network order) */
+    uint8_t clock_id[8];        /* Grandmaster identity */
+    uint8_t priority1;
+    uint8_t clock_class;
+    uint8_t clock_accuracy;
+    uint8_t priority2;
+    uint16_t log_variance;
+    uint16_t steps_removed;
+    bool qualified;             /* Enough Announces to take part in the BMCA */
+    bool best;                  /* The master deferred to */
+    uint32_t age_ms;            /* Since its last Announce */
+} ptp_foreign_info_t;
+
+/* NTP client table entry (for CLI / web reporting) */
+typedef struct {
+    uint32_t addr;              /* Client IPv4 address (network order) */
+    uint32_t requests;          /* Requests received */
+    uint32_t limited;           /* Requests over the rate limit */
+    uint32_t kod_sent;          /* RATE Kiss-o'-Death packets sent */
+    uint32_t avg_interval_ms;   /* Average request interval */
+    uint32_t idle_ms;           /* Time since last request */
+    uint32_t interleaved;       /* Interleaved responses sent */
+} ntp_client_info_t;
+
+/* NTP broadcast server state (for CLI / web reporting) */
+typedef struct {
+    bool enabled;
+    bool multicast;             /* 224.0.1.1, else the subnet broadcast */
+    bool xleave;                /* Interleaved broadcast */
+    bool auth;                  /* AES-CMAC MAC on broadcasts */
+    int8_t log_interval;        /* Broadcast interval, log2 s */
+    uint32_t dest;              /* Last destination (network order) */
+    uint32_t sent;              /* Broadcasts sent */
+    uint32_t errors;            /* Broadcasts that failed to send */
+    uint32_t auth_replies;      /* Authenticated client/server replies */
+    uint32_t auth_failed;       /* Requests dropped for a bad MAC */
+} ntp_bcast_info_t;
+
+/* WiFi power management modes */
+typedef enum {
+    WIFI_PM_LOW_LATENCY = 0,    /* Power save off */
+    WIFI_PM_BALANCED,           /* PM2: dozes after an idle timeout */
+    WIFI_PM_POWERSAVE,          /* PM1: PS-Poll, wakes each listen interval */
+    WIFI_PM_ADAPTIVE,           /* Low latency while serving, balanced when idle */
+    WIFI_PM_MODE_COUNT
+} wifi_pm_mode_t;
+
+/* WiFi power management and link latency (for CLI / web reporting) */
+typedef struct {
+    uint8_t mode;               /* wifi_pm_mode_t selected */
+    uint8_t applied;            /* Mode in the driver (adaptive picks one) */
+    uint8_t listen_dtim;        /* Listen interval, DTIM beacons */
+    uint16_t pm2_sleep_ms;      /* PM2 idle time before dozing */
+    float load_per_s;           /* NTP + PTP client requests/s (EWMA) */
+    uint32_t switches;          /* Adaptive mode changes */
+    bool probing;               /* Link probe running */
+    bool valid;                 /* one_way_ns has been measured */
+    int32_t one_way_ns;         /* Filtered driver-to-air latency */
+    uint32_t rtt_last_us;       /* Last link probe round trip */
+    uint32_t rtt_mean_us;       /* Round trip mean (EWMA) */
+    uint32_t rtt_jitter_us;     /* Round trip jitter (RFC 3550 style) */
+    uint32_t rx_wake_us;        /* Host wake to lwIP delivery, mean */
+    uint32_t rx_jitter_us;
+    uint32_t tx_driver_us;      /* Frame write to the chip, mean */
+    uint32_t tx_jitter_us;
+    uint32_t samples;           /* Probes accepted */
+} wifi_latency_info_t;
+
 /* Statistics */
 typedef struct {
     uint32_t ntp_requests;      /* Total NTP requests served */
@@ -233,6 +391,8 @@ typedef struct {
  * GLOBAL VARIABLES (extern declarations)
  *============================================================================*/
 
+/* g_time_state and the discipline fields of g_stats are owned by the timing
+ * core. Code on the network core reads them via timing_core_get_snapshot(). */
 extern volatile time_state_t g_time_state;
 extern volatile statistics_t g_stats;
 extern volatile bool g_wifi_connected;
@@ -250,6 +410,7 @@ void led_init(void);
 /* Time management */
 void time_init(void);
 timestamp_t get_current_time(void);
+timestamp_t timestamp_from_us(uint64_t timer_us);  /* time_us_64() -> NTP time, lock-free */
 void set_time(timestamp_t *ts);
 uint64_t get_time_us(void);
 
@@ -262,10 +423,18 @@ void force_time_resync(void);
 /* PPS capture */
 void pps_capture_init(void);
 void pps_irq_handler(void);
+void time_pps_edge(uint64_t edge_us, int64_t interval_ns, int32_t phase_ns);  /* Anchor on the primary edge */
 uint64_t get_last_pps_timestamp(void);
 bool is_pps_valid(void);
-uint64_t get_active_pps_timestamp(void);  /* Get primary (GNSS) or backup (Rb) PPS */
-bool is_active_pps_valid(void);           /* Check if any PPS source available */
+uint64_t get_active_pps_timestamp(void);  /* Last edge of the primary reference */
+bool is_active_pps_valid(void);           /* Check if a primary reference is selected */
+uint64_t get_last_pps_timestamp_ns(void); /* Rb PPS edge from PIO counter (ns) */
+int64_t get_last_pps_interval_ns(void);   /* Rb PPS period in local ns, 0 if unknown */
+bool pps_capture_take_gnss_edge_ns(uint64_t *edge_ns);  /* New GNSS PPS edge (ns) */
+int pps_capture_take_ac_edges_ns(uint64_t *edges_ns, int max);  /* AC zero crossings (ns) */
+uint32_t pps_capture_resolution_ps(void); /* Edge counter resolution */
+void pps_capture_get_edge_stats(uint32_t *coarse, uint32_t *overruns);
+int32_t calculate_pps_jitter_ns(void);    /* Period std deviation since `jitter reset`, -1 = unknown */
 
 /* Frequency counter - hardware PPS validation */
 void freq_counter_init(void);
@@ -274,15 +443,16 @@ uint32_t freq_counter_read_legacy(void);     /* Get last count */
 uint32_t freq_counter_read_count(void);      /* Get last count (preferred) */
 int32_t freq_counter_get_error(void);        /* Get deviation from 10,000,000 */
 bool freq_counter_new_measurement(void);     /* Check if new measurement available */
-double get_frequency_offset_ppb(void);
+double get_frequency_offset_ppb(void);       /* 10MHz against the reference */
 bool freq_counter_signal_present(void);
+void freq_counter_get_regression(freq_regression_t *out);
 
-/* PPS offset measurement (FE PPS vs GPS PPS, 10MHz locked) */
+/* PPS offset measurement (FE PPS vs GPS PPS, PIO edge counter) */
 void freq_counter_pps_task(void);            /* Poll PIO FIFOs - call from main loop */
 void freq_counter_capture_gnss_pps(void);    /* Legacy no-op */
-int32_t freq_counter_get_pps_offset(void);   /* Get offset in 10MHz ticks */
-double freq_counter_get_pps_drift(void);     /* Get drift rate (ticks/sec) */
-double freq_counter_get_pps_stddev(void);    /* Get offset std deviation */
+int32_t freq_counter_get_pps_offset(void);   /* Get offset GPS - FE in ns */
+double freq_counter_get_pps_drift(void);     /* Get drift rate (ns/sec) */
+double freq_counter_get_pps_stddev(void);    /* Get offset std deviation (ns) */
 bool freq_counter_pps_offset_valid(void);    /* Check if offset is valid */
 uint32_t freq_counter_get_fe_pps_count(void);  /* Debug: FE PPS capture count */
 uint32_t freq_counter_get_gnss_pps_count(void); /* Debug: GNSS PPS capture count */
@@ -295,16 +465,50 @@ void discipline_update(int64_t offset_ns);
 double discipline_get_correction(void);
 bool discipline_is_locked(void);
 void discipline_reset(void);
+double discipline_get_integral(void);        /* Integrator, s/s */
+void discipline_warm_start(double integral_ppb);
+bool discipline_holdover_update(void);       /* Model-only step, no PPS */
+void discipline_frequency_update(double freq_ppb, double sigma_ppb);  /* Time base vs reference */
+void discipline_refit_noise(void);           /* Process noise from ADEV */
+double discipline_get_time_error_ns(void);   /* Predicted time error bound */
+void discipline_set_kalman(bool enable);
+bool discipline_is_kalman(void);
 
 /* NTP server */
 void ntp_server_init(void);
 void ntp_server_task(void);
+void ntp_get_statistics(uint32_t *requests, uint32_t *errors);
+uint32_t ntp_get_interleaved_count(void);
+uint32_t ntp_get_nts_count(void);
+void ntp_get_rates(float *plain_per_s, float *nts_per_s);
+void ntp_get_limit_stats(uint32_t *kod_sent, uint32_t *dropped);
+int ntp_get_clients(ntp_client_info_t *out, int max);
+void ntp_set_limit_exempt(uint32_t addr, uint32_t seconds);
+void ntp_broadcast_task(void);
+void ntp_broadcast_enable(bool enable);
+bool ntp_broadcast_set_interval(int8_t log_interval);
+void ntp_broadcast_set_multicast(bool multicast);
+void ntp_broadcast_set_xleave(bool xleave);
+void ntp_broadcast_set_auth(bool auth);
+void ntp_broadcast_get_info(ntp_bcast_info_t *info);
+void ntp_get_symmetric_key(uint8_t key[16]);
 
 /* PTP server */
 void ptp_server_init(void);
 void ptp_server_task(void);
 void ptp_send_sync(void);
 void ptp_send_announce(void);
+void ptp_get_statistics(uint32_t *syncs, uint32_t *delay_resps);
+uint32_t ptp_get_delay_requests(void);
+void ptp_get_egress_info(ptp_egress_info_t *info);
+int ptp_get_slaves(ptp_slave_info_t *out, int max);
+uint32_t ptp_get_grants_denied(void);
+void ptp_set_egress_calibration(bool enable);
+void ptp_set_egress_trim(int32_t trim_ns);
+bool ptp_set_sync_log_interval(int8_t log_interval);
+void ptp_set_priority(uint8_t priority1, uint8_t priority2);
+void ptp_get_bmca_info(ptp_bmca_info_t *info);
+int ptp_get_foreign_masters(ptp_foreign_info_t *out, int max);
 
 /* WiFi management */
 void wifi_init(void);
@@ -312,6 +516,14 @@ bool wifi_connect(const char *ssid, const char *password);
 bool wifi_is_connected(void);
 void wifi_task(void);
 void get_ip_address_str(char *buf, size_t len);
+bool wifi_set_power_mode(wifi_pm_mode_t mode);
+bool wifi_set_listen_interval(uint8_t dtims);
+bool wifi_set_pm2_sleep(uint16_t ms);
+const char *wifi_pm_mode_name(uint8_t mode);
+void wifi_set_latency_probe(bool enable);
+void wifi_get_latency(wifi_latency_info_t *info);
+int32_t wifi_latency_ns(void);              /* One-way stamp correction, 0 until measured */
+int32_t wifi_get_rssi(void);                /* dBm, 0 if unavailable */
 
 /* Web interface */
 void web_init(void);
@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /* Initialize CLI */
 void cli_init(void);
@@ -20,12 +21,32 @@ void cli_init(void);
 void cli_task(void);
 
 /**
- * Execute a CLI command and capture output to buffer
- * @param cmd Command string to execute
- * @param out_buf Buffer to write output (NULL to use printf)
- * @param out_len Size of output buffer
- * @return Number of characters written to buffer, or 0 if using printf
+ * Run a command for the web. Its output goes to a stream instead of
+ * stdout; a command that becomes a job keeps writing to it from
+ * cli_task() until it finishes. Returns false while a previous web
+ * command's stream is still open.
  */
-int cli_execute(const char *cmd, char *out_buf, size_t out_len);
+bool cli_stream_start(const char *cmd);
+
+/**
+ * Copy stream output from absolute position pos (no terminator).
+ * Returns bytes copied; 0 when nothing new has been written yet.
+ */
+size_t cli_stream_copy(uint32_t pos, char *buf, size_t len);
+
+/**
+ * Reader is done with everything before pos: the space may be reused
+ */
+void cli_stream_release(uint32_t pos);
+
+/**
+ * True once the command has finished and pos has reached the end
+ */
+bool cli_stream_done(uint32_t pos);
+
+/**
+ * End the web command, stopping its job if it is still running
+ */
+void cli_stream_close(void);
 
 #endif /* CLI_H */
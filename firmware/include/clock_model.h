@@ -0,0 +1,96 @@
+/**
+ * CHRONOS-Rb Clock Model
+ *
+ * Three-state Kalman filter for the local clock against the reference
+ * PPS: phase error of the disciplined time base (ns), free-running
+ * frequency offset (ppb = ns/s) and frequency drift (ppb/s). The applied
+ * discipline correction is a known control input, so the model tracks
+ * the oscillator whichever law steers it and keeps predicting when the
+ * PPS is gone.
+ *
+ * Process noise uses the usual clock model:
+ *   q1  white FM         ADEV^2(tau) = q1 / tau
+ *   q2  random-walk FM   ADEV^2(tau) = q2 * tau / 3
+ *   q3  random-walk drift ADEV^2(tau) = q3 * tau^3 / 20
+ * Each is bounded from the measured Allan profile by the smallest value
+ * any tau allows (clock_model_fit_noise()), never below the floors here,
+ * since the profile is measured inside the loop, which hides wander.
+ *
+ * Not thread-safe: the timing core owns it (PPS IRQ and, with IRQs
+ * masked, its tasks).
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef CLOCK_MODEL_H
+#define CLOCK_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stability.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define CLOCK_MODEL_MEAS_NOISE_NS   10.0    /* PPS edge timing, 1 sigma */
+#define CLOCK_MODEL_Q1_FLOOR        1.0     /* ns^2/s   (ADEV 1e-9 at 1 s) */
+#define CLOCK_MODEL_Q2_FLOOR        1e-4    /* ns^2/s^3 */
+#define CLOCK_MODEL_Q3_FLOOR        1e-10   /* ns^2/s^5 */
+#define CLOCK_MODEL_GATE_SIGMA      5.0     /* Innovation outlier gate */
+#define CLOCK_MODEL_MAX_OUTLIERS    8       /* Consecutive, then re-acquire */
+#define CLOCK_MODEL_FIT_MIN_N       16      /* ADEV samples to use a tau */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    double x[3];                /* Phase (ns), frequency (ppb), drift (ppb/s) */
+    double p[3][3];             /* Covariance */
+    double q1, q2, q3;          /* Process noise, ns units */
+    double r;                   /* Measurement variance (ns^2) */
+    bool initialized;
+    uint32_t outlier_run;       /* Consecutive gated measurements */
+    uint32_t updates;
+    uint32_t predictions;       /* Steps without a measurement (holdover) */
+    uint32_t outliers;
+    uint32_t freq_updates;      /* Frequency measurements folded in */
+} clock_model_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* Forget all state (noise parameters drop to the floors) */
+void clock_model_reset(clock_model_t *m);
+
+/* Start from a known frequency (warm start); phase from the next sample */
+void clock_model_seed(clock_model_t *m, double freq_ppb, double freq_sigma_ppb);
+
+/* Advance dt seconds with correction u_ppb applied to the time base */
+void clock_model_predict(clock_model_t *m, double dt, double u_ppb);
+
+/* Fold in a phase measurement (ns). Returns false if it was gated out. */
+bool clock_model_update(clock_model_t *m, double phase_ns);
+
+/* Fold in a measurement of the free-running frequency (ppb) with
+ * variance var. Ignored until the model has a phase; false if gated out. */
+bool clock_model_update_freq(clock_model_t *m, double freq_ppb, double var);
+
+/* Correction that removes the predicted frequency over the next dt and
+ * pulls the phase in with time constant tau_s */
+double clock_model_steer(const clock_model_t *m, double dt, double tau_s);
+
+/* Time error bound: |phase| + 1 sigma (ns) */
+double clock_model_time_error_ns(const clock_model_t *m);
+
+/* Refit q1..q3 from an Allan profile (stability_get() output) */
+void clock_model_fit_noise(clock_model_t *m, const stability_point_t *pts, int n);
+
+/* Copy of the discipline loop's model (time_discipline.c, timing core) */
+void discipline_get_model(clock_model_t *out);
+
+#endif /* CLOCK_MODEL_H */
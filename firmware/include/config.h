@@ -2,7 +2,9 @@
  * CHRONOS-Rb Configuration Storage
  *
  * Persistent configuration stored in flash memory.
- * Uses the last sector of flash for non-volatile storage.
+ * Uses the reserved area at the end of flash as an append-only journal:
+ * saves append the changed bytes, a sector is erased only when the
+ * active one fills.
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -19,7 +21,7 @@
  *============================================================================*/
 
 #define CONFIG_MAGIC        0x4352424E  /* "CRBN" */
-#define CONFIG_VERSION      4           /* Bumped for pulse output storage */
+#define CONFIG_VERSION      10          /* Bumped for the unit secret */
 
 #define CONFIG_SSID_MAX     33  /* 32 chars + null */
 #define CONFIG_PASS_MAX     65  /* 64 chars + null */
@@ -40,6 +42,24 @@ typedef struct __attribute__((packed)) {
     uint16_t interval_ds;       /* Interval in deciseconds (0.1s units, max 6553.5s) */
 } pulse_config_stored_t;        /* 14 bytes per config */
 
+/* Discipline state for warm start (warm_start.c), saved while locked */
+#define CONFIG_WARM_VALID       0x01    /* Record holds a saved state */
+
+typedef struct {
+    uint32_t saved_unix;        /* Wall time of the save */
+    int32_t integral_ppt;       /* Discipline integrator (1e-12, ppt) */
+    int32_t drift_ppt_day;      /* Integrator drift between saves (ppt/day) */
+    uint32_t lock_unix;         /* When the saving lock was acquired */
+    uint32_t lock_seconds;      /* Lock duration at save */
+    uint16_t saves;             /* Saves into this record (wraps) */
+    uint8_t flags;              /* CONFIG_WARM_* */
+    uint8_t reserved;
+} config_warm_t;                /* 24 bytes */
+
+/* Unit secret (unit_secret.c), drawn from the hardware RNG at first boot */
+#define CONFIG_SECRET_SIZE      32
+#define CONFIG_SECRET_VALID     0x01    /* Field holds a generated secret */
+
 typedef struct {
     uint32_t magic;                     /* Magic number for validation */
     uint32_t version;                   /* Config version */
@@ -64,8 +84,36 @@ typedef struct {
     /* Pulse output configurations (8 slots × 14 bytes = 112 bytes) */
     pulse_config_stored_t pulse_configs[CONFIG_MAX_PULSE_OUTPUTS];
 
+    /* Learned oscillator state (not user settings) */
+    config_warm_t warm;
+
+    /* NMEA output format (taken from the reserved bytes) */
+    uint16_t nmea_baud_100;             /* Baud rate / 100 */
+    uint8_t nmea_sentences;             /* NMEA_SENT_* bits */
+
+    /* PTP master (taken from the reserved bytes) */
+    int8_t ptp_sync_log;                /* Multicast Sync logMessageInterval */
+    uint8_t ptp_priority1;              /* BMCA priority1 (lower wins) */
+    uint8_t ptp_priority2;              /* BMCA priority2 (lower wins) */
+
+    /* NTP broadcast (v8, grows the record) */
+    bool ntp_bcast_enabled;             /* Mode 5 broadcasts */
+    bool ntp_bcast_multicast;           /* 224.0.1.1, else subnet broadcast */
+    bool ntp_bcast_xleave;              /* Interleaved broadcast */
+    bool ntp_bcast_auth;                /* AES-CMAC MAC (RFC 8573) */
+    int8_t ntp_bcast_log;               /* Interval, log2 seconds */
+
+    /* WiFi power management (v9) */
+    uint8_t wifi_pm_mode;               /* wifi_pm_mode_t */
+    uint8_t wifi_listen_dtim;           /* Listen interval, DTIM beacons */
+    uint8_t wifi_pm2_sleep_10ms;        /* PM2 idle time before dozing / 10 ms */
+
+    /* Unit secret (v10, not a user setting; survives config_reset()) */
+    uint8_t unit_secret[CONFIG_SECRET_SIZE];
+    uint8_t unit_secret_flags;          /* CONFIG_SECRET_* */
+
     /* Future expansion */
-    uint8_t reserved[7];                /* Reserved for future use */
+    uint8_t reserved[1];                /* Reserved for future use */
 
     uint32_t crc32;                     /* CRC32 checksum */
 } config_t;
@@ -81,19 +129,34 @@ typedef struct {
 void config_init(void);
 
 /**
- * Save current configuration to flash
+ * Save current configuration to flash (appends a journal record for the
+ * changed bytes; no write if nothing changed)
  * @return true on success
  */
 bool config_save(void);
 
 /**
- * Load configuration from flash
+ * Save only the warm-start record, leaving unsaved settings changes
+ * out of flash
+ * @return true on success
+ */
+bool config_save_warm(const config_warm_t *warm);
+
+/**
+ * Save only the unit secret, leaving unsaved settings changes out of
+ * flash
+ * @return true on success
+ */
+bool config_save_secret(const uint8_t secret[CONFIG_SECRET_SIZE]);
+
+/**
+ * Load configuration from flash (replays the journal)
  * @return true if valid config found
  */
 bool config_load(void);
 
 /**
- * Reset configuration to defaults
+ * Reset configuration to defaults (the unit secret is kept)
  */
 void config_reset(void);
 
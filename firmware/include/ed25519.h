@@ -0,0 +1,40 @@
+/**
+ * CHRONOS-Rb Ed25519 Signing
+ *
+ * RFC 8032 Ed25519 signatures (sign only, no verify) for the Roughtime
+ * server. Keys are expanded once from their 32-byte seed so each
+ * signature costs one base-point multiplication and two SHA-512 passes.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef ED25519_H
+#define ED25519_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ED25519_SEED_SIZE       32
+#define ED25519_PUBKEY_SIZE     32
+#define ED25519_SIG_SIZE        64
+
+typedef struct {
+    uint8_t pub[ED25519_PUBKEY_SIZE];
+    uint8_t scalar[32];         /* Clamped secret scalar */
+    uint8_t prefix[32];         /* Nonce derivation key */
+} ed25519_key_t;
+
+/**
+ * Expand a secret seed into a signing key and its public key
+ */
+void ed25519_key_from_seed(ed25519_key_t *key, const uint8_t seed[ED25519_SEED_SIZE]);
+
+/**
+ * Sign len bytes of msg. Constant time in the key; takes a few tens of
+ * milliseconds on the Cortex-M33, so callers batch what they sign.
+ */
+void ed25519_sign(const ed25519_key_t *key, const void *msg, size_t len,
+                  uint8_t sig[ED25519_SIG_SIZE]);
+
+#endif /* ED25519_H */
@@ -0,0 +1,109 @@
+/**
+ * CHRONOS-Rb Wired Ethernet (WIZnet W5500)
+ *
+ * A second lwIP netif on a W5500 over SPI1. Socket 0 runs in MACRAW
+ * mode, so the chip only moves whole Ethernet frames and lwIP does
+ * ARP/IP/UDP/TCP exactly as on WiFi. Once the link is up and DHCP has
+ * given it an address, NTP and PTP are bound to it (net_ts_bind_pcb())
+ * and WiFi is left to the web interface, CLI and OTA. If the link drops,
+ * the time services fall back to WiFi.
+ *
+ * Frames are stamped at the SPI boundary and handed to net_timestamp.c:
+ *   RX - the INTn falling edge that announces a frame (first frame of a
+ *        burst), else the start of the frame's SPI read
+ *   TX - the end of the SEND command write, after which the chip puts
+ *        the frame on the (full duplex) wire without waiting
+ * Payloads move by DMA at ETH_SPI_HZ, so what is left between a stamp
+ * and the wire is the chip's own MAC/PHY latency, which is fixed and can
+ * be trimmed out with `eth latency`, instead of WiFi's air time.
+ *
+ * Built with CMake option CHRONOS_ETH_W5500 (default OFF); without it
+ * the functions are stubs and eth_time_netif() is always NULL.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef ETH_W5500_H
+#define ETH_W5500_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct netif;
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define ETH_SPI_HZ              33000000    /* W5500 rated SPI clock */
+#define ETH_RX_BUF_KB           16          /* Socket 0 buffers: all of the chip's 16 KB */
+#define ETH_TX_BUF_KB           16
+#define ETH_RX_BURST            8           /* Frames handed to lwIP per task call */
+#define ETH_LINK_POLL_US        250000      /* PHY status poll */
+#define ETH_SEND_TIMEOUT_US     2000        /* Previous frame still not sent: reopen */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    bool present;               /* Chip found at init */
+    bool link_up;
+    bool speed_100;             /* 100 Mbit/s, else 10 */
+    bool full_duplex;
+    bool serving;               /* NTP/PTP bound to the wired netif */
+    uint32_t ip_addr;           /* Network byte order, 0 = none */
+    uint8_t mac[6];
+    uint32_t rx_frames;         /* Frames delivered to lwIP */
+    uint32_t rx_irq_stamped;    /* Frames stamped from the INTn edge */
+    uint32_t rx_dropped;        /* No pbuf for the frame */
+    uint32_t rx_errors;         /* Bad length headers (socket reopened) */
+    uint32_t tx_frames;
+    uint32_t tx_errors;         /* No buffer space or SEND timeout */
+    uint32_t irq_latency_us;    /* Last INTn edge to frame read */
+    uint32_t tx_spi_us;         /* Last frame: linkoutput to SEND */
+    uint32_t link_changes;
+    int32_t latency_ns;         /* Stamp to wire correction */
+} eth_status_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Reset the chip, add its netif and start DHCP (core0, after wifi_init()
+ * has brought up lwIP). Does nothing if no W5500 answers.
+ */
+void eth_init(void);
+
+/**
+ * Hand received frames to lwIP and follow the PHY link (core0, woken by
+ * SCHED_EV_ETH from the INTn edge)
+ */
+void eth_task(void);
+
+/**
+ * The wired netif while it can carry NTP/PTP (link up, address, serving
+ * enabled), else NULL
+ */
+struct netif *eth_time_netif(void);
+
+/**
+ * Let NTP/PTP use the wired link (default) or keep them on WiFi
+ */
+void eth_set_serving(bool enable);
+
+/**
+ * One-way stamp to wire correction applied while serving on the wired
+ * link (ns, default 0)
+ */
+int32_t eth_latency_ns(void);
+void eth_set_latency_ns(int32_t ns);
+
+/**
+ * Get status and statistics
+ */
+void eth_get_status(eth_status_t *status);
+
+#endif /* ETH_W5500_H */
@@ -117,5 +117,7 @@ const char* gnss_get_firmware_version(void);
 const char* gnss_get_hardware_version(void);
 int8_t gnss_get_leap_seconds(void);
 bool gnss_leap_seconds_is_valid(void);
+/* Announced leap (+1/-1) and the UTC second it comes before; false if none */
+bool gnss_get_leap_event(int8_t *change, uint32_t *event_unix);
 
 #endif /* GNSS_INPUT_H */
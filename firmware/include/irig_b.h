@@ -1,7 +1,9 @@
 /**
  * CHRONOS-Rb IRIG-B Timecode Output
  *
- * Generates IRIG-B timecode for aerospace/military/test equipment
+ * Generates IRIG-B timecode for aerospace/military/test equipment.
+ * Frames are played by PIO and DMA, locked to the 10MHz reference and
+ * started on the PPS edge; the CPU encodes one frame per second.
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -19,7 +21,7 @@
 void irig_b_init(void);
 
 /**
- * IRIG-B task - call frequently from main loop
+ * IRIG-B task - run on each PPS event to encode the frame after next
  */
 void irig_b_task(void);
 
@@ -29,8 +31,8 @@ void irig_b_task(void);
 void irig_b_enable(bool enable);
 
 /**
- * Set IRIG-B mode
- * @param modulated  true = IRIG-B120 (1kHz AM), false = IRIG-B000 (DC level shift)
+ * Set IRIG-B mode (takes effect from the next frame encoded)
+ * @param modulated  true = IRIG-B124 (1kHz AM), false = IRIG-B004 (DC level shift)
  */
 void irig_b_set_mode(bool modulated);
 
@@ -44,4 +46,11 @@ bool irig_b_is_enabled(void);
  */
 bool irig_b_is_modulated(void);
 
+/**
+ * Get IRIG-B statistics
+ * @param frames   Frames encoded
+ * @param resyncs  Restarts after a time step or lost PPS
+ */
+void irig_b_get_stats(uint32_t *frames, uint32_t *resyncs);
+
 #endif /* IRIG_B_H */
@@ -0,0 +1,105 @@
+/**
+ * CHRONOS-Rb PPS Jitter Statistics
+ *
+ * Running statistics of the rubidium PPS period error (period minus 1 s,
+ * from the PIO edge stamps) and of the GNSS minus Rb PPS offset. Each
+ * observation updates Welford's mean and variance, min/max and a
+ * log-spaced histogram (JITTER_SUB_BUCKETS per octave of |ns|, both
+ * signs) in constant time, so the tails - p99, p99.9 - cost no more
+ * than the mean.
+ *
+ * Every series has two sets: the total since boot, and a window that
+ * restarts on jitter_stats_reset() (`jitter reset`, POST /api/jitter)
+ * so a change can be measured from a known point.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef JITTER_STATS_H
+#define JITTER_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define JITTER_SUB_BITS         2       /* 4 buckets per octave, <= 25% wide */
+#define JITTER_SUB_BUCKETS      (1u << JITTER_SUB_BITS)
+#define JITTER_MAX_LOG2         24      /* |ns| up to 2^24 (~16.8 ms), then clamped */
+
+/* Buckets per sign: magnitudes below JITTER_SUB_BUCKETS exactly, then
+ * JITTER_SUB_BUCKETS per octave */
+#define JITTER_HALF_BUCKETS     ((JITTER_MAX_LOG2 - JITTER_SUB_BITS + 1) * JITTER_SUB_BUCKETS)
+#define JITTER_BUCKETS          (2 * JITTER_HALF_BUCKETS)
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef enum {
+    JITTER_PPS_PERIOD = 0,      /* Rb PPS period minus 1 s (ns) */
+    JITTER_GNSS_OFFSET,         /* GNSS PPS minus Rb PPS (ns) */
+    JITTER_SERIES_COUNT
+} jitter_series_t;
+
+typedef enum {
+    JITTER_TOTAL = 0,           /* Since boot */
+    JITTER_WINDOW,              /* Since the last reset */
+    JITTER_SET_COUNT
+} jitter_set_t;
+
+/* Consistent copy of one set */
+typedef struct {
+    uint32_t count;
+    double mean;                /* ns */
+    double m2;                  /* Sum of squared deviations (ns^2) */
+    int32_t min;
+    int32_t max;
+    int32_t last;
+    uint64_t start_us;          /* When the set started (time_us_64) */
+    uint32_t buckets[JITTER_BUCKETS];  /* Ascending by value */
+} jitter_snapshot_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Record one value (ns). One writer per series: the PPS capture IRQ for
+ * the period, the frequency counter task for the GNSS offset, both on
+ * the timing core.
+ */
+void jitter_stats_observe(jitter_series_t series, int32_t value);
+
+/**
+ * Restart the window of one series, or of all with JITTER_SERIES_COUNT
+ * (timing core - use timing_core_call())
+ */
+void jitter_stats_reset(jitter_series_t series);
+
+/**
+ * Copy one set (any core, any context)
+ */
+void jitter_stats_read(jitter_series_t series, jitter_set_t set, jitter_snapshot_t *out);
+
+/**
+ * Standard deviation of a copy in ns, 0 with fewer than two values
+ */
+double jitter_stats_stddev(const jitter_snapshot_t *s);
+
+/**
+ * Quantile q (0..1) of a copy in ns, interpolated linearly inside its
+ * bucket and bounded by the observed min/max; 0 when empty
+ */
+double jitter_stats_quantile(const jitter_snapshot_t *s, double q);
+
+/**
+ * Series names as used by the CLI and JSON ("pps", "gnss")
+ */
+const char *jitter_series_name(int series);
+int jitter_series_from_name(const char *name);
+
+#endif /* JITTER_STATS_H */
@@ -0,0 +1,102 @@
+/**
+ * CHRONOS-Rb Load Benchmark
+ *
+ * Measures how much NTP/PTP traffic one unit can serve. A host load
+ * generator (tools/load_gen.py) sends requests at stepped rates and,
+ * through the CLI, opens each step with the rate it is offering. The
+ * device closes the previous step and records what that window cost:
+ * requests received and answered, failures, pbuf allocation failures,
+ * and the NTP/PTP service time, PPS IRQ latency and main loop time
+ * histograms over the window.
+ *
+ * A step passes when its NTP p99 service time is within the target, at
+ * most BENCH_FAIL_MAX_PPM of the requests went unanswered, no pbuf
+ * allocation failed and the PPS IRQ p99 stayed within BENCH_PPS_P99_NS.
+ * The capacity is the highest answered rate of a passing step. While a
+ * benchmark runs the NTP rate limiter answers the generator's address
+ * regardless of rate, since that one host stands in for many clients;
+ * every other client is limited as usual.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef LOAD_BENCH_H
+#define LOAD_BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define BENCH_MAX_STEPS         16
+#define BENCH_P99_DEFAULT_US    1000    /* NTP service time target */
+#define BENCH_FAIL_MAX_PPM      1000    /* Unanswered requests allowed (0.1%) */
+#define BENCH_PPS_P99_NS        10000   /* PPS IRQ latency still "not degraded" */
+#define BENCH_EXEMPT_S          120     /* Generator stays exempt after a step opens */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    uint32_t offered;           /* Generator rate for the step (req/s) */
+    uint32_t duration_ms;
+    uint32_t ntp_rx;            /* NTP requests received */
+    uint32_t ntp_served;        /* NTP replies sent */
+    uint32_t ptp_rx;            /* Delay_Req received */
+    uint32_t ptp_served;        /* Delay_Resp sent */
+    uint32_t pbuf_errors;       /* Pool and heap allocation failures */
+    float ntp_p50_us;
+    float ntp_p99_us;
+    float ptp_p99_us;
+    float pps_p99_ns;           /* PPS edge to IRQ handler */
+    float loop_p99_us;          /* Core0 main loop pass */
+    bool passed;
+} bench_step_t;
+
+typedef struct {
+    bool running;
+    bool open;                  /* A step is collecting */
+    uint32_t p99_target_us;
+    uint32_t generator_addr;    /* Exempt from rate limits (network order), 0 = none */
+    uint32_t steps;             /* Closed steps */
+    uint32_t capacity;          /* Highest passing answered rate (req/s), 0 = none */
+} bench_status_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Clear the step table and start a benchmark (core0). The NTP rate
+ * limiter exempts generator_addr (network byte order) while steps run;
+ * 0 exempts no one.
+ */
+void load_bench_start(uint32_t p99_target_us, uint32_t generator_addr);
+
+/**
+ * Close the current step and open the next at the offered rate.
+ * Returns false if no benchmark is running or the table is full.
+ */
+bool load_bench_step(uint32_t offered_per_s);
+
+/**
+ * Close the current step, end the benchmark and end the generator's
+ * rate limit exemption
+ */
+void load_bench_stop(void);
+
+/**
+ * Benchmark state and the capacity found so far
+ */
+void load_bench_get_status(bench_status_t *status);
+
+/**
+ * Copy the closed steps. Returns the number written.
+ */
+int load_bench_get_steps(bench_step_t *out, int max);
+
+#endif /* LOAD_BENCH_H */
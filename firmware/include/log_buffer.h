@@ -3,6 +3,17 @@
  *
  * Ring buffer for capturing log output for web interface display.
  *
+ * Code that must not block (IRQ handlers, the timing core) logs through
+ * LOG_ERR/LOG_WARN/LOG_INFO/LOG_DBG instead of printf. These store a
+ * binary record - format pointer, up to LOG_RECORD_ARGS word-sized
+ * arguments, timestamp, level - in a lock-free ring that any core or
+ * IRQ may write. Formatting happens later on core0, when log_drain()
+ * prints the records to stdio (and so into the text buffer above).
+ *
+ * Record rules: the format must be a string literal, %s arguments must
+ * be static strings, and every argument must fit in a word (no %llu or
+ * %f; scale or split such values).
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
@@ -16,6 +27,100 @@
 
 /* LOG_BUFFER_SIZE is defined in chronos_rb.h */
 
+/*============================================================================
+ * DEFERRED RECORDS
+ *============================================================================*/
+
+#define LOG_RECORD_SLOTS        128     /* Power of 2 */
+#define LOG_RECORD_ARGS         4
+
+typedef enum {
+    LOG_MOD_PPS = 0,            /* PPS capture */
+    LOG_MOD_FREQ,               /* Frequency counter */
+    LOG_MOD_RB,                 /* Rubidium sync state machine */
+    LOG_MOD_GNSS,               /* GNSS receiver */
+    LOG_MOD_OUTPUT,             /* Pulse, radio, IRIG-B, NMEA outputs */
+    LOG_MOD_NET,                /* Network services */
+    LOG_MOD_COUNT
+} log_module_t;
+
+typedef enum {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+} log_level_t;
+
+/* One record as stored in the ring */
+typedef struct {
+    volatile uint32_t seq;      /* Record number + 1 once complete, 0 while written */
+    uint32_t time_us;           /* time_us_32() when logged */
+    const char *fmt;
+    uint8_t module;
+    uint8_t level;
+    uint8_t core;
+    uintptr_t args[LOG_RECORD_ARGS];
+} log_record_t;
+
+typedef struct {
+    uint32_t written;           /* Records ever logged */
+    uint32_t drained;           /* Records formatted by log_drain() */
+    uint32_t lost;              /* Overwritten before they were drained */
+} log_record_stats_t;
+
+/**
+ * Store a record if level passes the module's filter. IRQ and
+ * multicore safe, never blocks. Use the LOG_* macros.
+ */
+void log_write(log_module_t module, log_level_t level, const char *fmt,
+               uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3);
+
+#define LOG_RECORD_(module, level, fmt, a0, a1, a2, a3, ...) \
+    log_write(module, level, fmt, (uintptr_t)(a0), (uintptr_t)(a1), \
+              (uintptr_t)(a2), (uintptr_t)(a3))
+
+#define LOG_ERR(module, ...)    LOG_RECORD_(module, LOG_LEVEL_ERROR, __VA_ARGS__, 0, 0, 0, 0, 0)
+#define LOG_WARN(module, ...)   LOG_RECORD_(module, LOG_LEVEL_WARN,  __VA_ARGS__, 0, 0, 0, 0, 0)
+#define LOG_INFO(module, ...)   LOG_RECORD_(module, LOG_LEVEL_INFO,  __VA_ARGS__, 0, 0, 0, 0, 0)
+#define LOG_DBG(module, ...)    LOG_RECORD_(module, LOG_LEVEL_DEBUG, __VA_ARGS__, 0, 0, 0, 0, 0)
+
+/**
+ * Format and print pending records (core0 only)
+ */
+void log_drain(void);
+
+/**
+ * Format record number seq into buf if it is still in the ring
+ * Returns false if it was overwritten or is not complete yet
+ */
+bool log_record_format(uint32_t seq, log_record_t *rec, char *buf, size_t buf_size);
+
+/**
+ * Number of the next record to be written
+ */
+uint32_t log_record_head(void);
+
+void log_record_get_stats(log_record_stats_t *stats);
+
+/**
+ * Per-module level filter; records above it are not stored
+ */
+void log_set_level(log_module_t module, log_level_t level);
+log_level_t log_get_level(log_module_t module);
+
+const char *log_module_name(log_module_t module);
+const char *log_level_name(log_level_t level);
+
+/**
+ * Look up a module or level by name; returns -1 if unknown
+ */
+int log_module_from_name(const char *name);
+int log_level_from_name(const char *name);
+
+/*============================================================================
+ * TEXT BUFFER
+ *============================================================================*/
+
 /**
  * Initialize log buffer and hook into stdio
  */
@@ -28,6 +133,12 @@ void log_buffer_init(void);
  */
 size_t log_buffer_read(char *buf, size_t buf_size, uint32_t *read_pos);
 
+/**
+ * Copy log contents forward from an absolute position (no terminator)
+ * Returns bytes copied; advances *from past them, skipping lost data
+ */
+size_t log_buffer_copy(char *buf, size_t buf_size, uint32_t *from);
+
 /**
  * Get current write position (for tracking new data)
  */
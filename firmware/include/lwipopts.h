@@ -52,6 +52,7 @@
 #define LWIP_RAW                    0
 #define LWIP_IPV4                   1
 #define LWIP_IPV6                   0
+#define LWIP_IGMP                   1   /* PTP multicast: other masters' Announces */
 
 /*============================================================================
  * UDP CONFIGURATION (for NTP/PTP)
@@ -92,7 +93,12 @@
  * NETWORK INTERFACE
  *============================================================================*/
 
+/* The W5500 adds a second netif (CHRONOS_ETH_W5500, set by CMake) */
+#if defined(CHRONOS_ETH_W5500) && CHRONOS_ETH_W5500
+#define LWIP_SINGLE_NETIF           0
+#else
 #define LWIP_SINGLE_NETIF           1
+#endif
 #define LWIP_NETIF_STATUS_CALLBACK  1
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
@@ -110,11 +116,22 @@
 #define LWIP_DEBUG                  0
 
 /*============================================================================
- * STATISTICS (disabled to save memory)
+ * STATISTICS (memory pools only, for the load benchmark's pbuf failures)
  *============================================================================*/
 
-#define LWIP_STATS                  0
+#define LWIP_STATS                  1
 #define LWIP_STATS_DISPLAY          0
+#define MEM_STATS                   1
+#define MEMP_STATS                  1
+#define LINK_STATS                  0
+#define ETHARP_STATS                0
+#define IP_STATS                    0
+#define IPFRAG_STATS                0
+#define ICMP_STATS                  0
+#define IGMP_STATS                  0
+#define UDP_STATS                   0
+#define TCP_STATS                   0
+#define SYS_STATS                   0
 
 /*============================================================================
  * CHECKSUM CONFIGURATION
@@ -0,0 +1,91 @@
+/**
+ * CHRONOS-Rb mbedTLS Configuration
+ *
+ * Picked up by pico_mbedtls (MBEDTLS_CONFIG_FILE). Covers the OTA image
+ * decryption and NTS AEAD (AES-ECB only) and the NTS-KE server: TLS 1.3
+ * server side only, ephemeral ECDHE (X25519, P-256), ECDSA P-256
+ * certificate, AES-GCM suites and the RFC 5705 exporter. Every
+ * allocation goes to the NTS-KE arena (nts_ke.c).
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef MBEDTLS_CONFIG_H
+#define MBEDTLS_CONFIG_H
+
+/*============================================================================
+ * PLATFORM
+ *============================================================================*/
+
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY             /* mbedtls_platform_set_calloc_free() */
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ENTROPY_HARDWARE_ALT        /* pico_mbedtls: mbedtls_hardware_poll() */
+#define MBEDTLS_ENTROPY_C
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_HMAC_DRBG_C                 /* Deterministic ECDSA */
+
+/*============================================================================
+ * SYMMETRIC CRYPTO AND HASHES
+ *============================================================================*/
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_CIPHER_C
+#define MBEDTLS_GCM_C
+#define MBEDTLS_MD_C
+#define MBEDTLS_SHA224_C
+#define MBEDTLS_SHA256_C
+#define MBEDTLS_SHA384_C
+#define MBEDTLS_SHA512_C
+#define MBEDTLS_HKDF_C
+
+/*============================================================================
+ * PUBLIC KEY
+ *============================================================================*/
+
+#define MBEDTLS_BIGNUM_C
+#define MBEDTLS_ECP_C
+#define MBEDTLS_ECP_DP_SECP256R1_ENABLED
+#define MBEDTLS_ECP_DP_CURVE25519_ENABLED
+#define MBEDTLS_ECP_NIST_OPTIM
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_ECDSA_C
+#define MBEDTLS_ECDSA_DETERMINISTIC
+#define MBEDTLS_ASN1_PARSE_C
+#define MBEDTLS_ASN1_WRITE_C
+#define MBEDTLS_OID_C
+#define MBEDTLS_PK_C
+#define MBEDTLS_PK_PARSE_C
+#define MBEDTLS_PK_WRITE_C
+#define MBEDTLS_BASE64_C
+#define MBEDTLS_PEM_WRITE_C
+
+/* Self-signed server certificate, built at boot */
+#define MBEDTLS_X509_USE_C
+#define MBEDTLS_X509_CRT_PARSE_C
+#define MBEDTLS_X509_CREATE_C
+#define MBEDTLS_X509_CRT_WRITE_C
+
+/* TLS 1.3 runs its crypto through PSA */
+#define MBEDTLS_PSA_CRYPTO_C
+#define MBEDTLS_PSA_KEY_SLOT_COUNT          8
+
+/*============================================================================
+ * TLS
+ *============================================================================*/
+
+#define MBEDTLS_SSL_TLS_C
+#define MBEDTLS_SSL_SRV_C
+#define MBEDTLS_SSL_PROTO_TLS1_3
+#define MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+#define MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE
+#define MBEDTLS_SSL_ALPN                    /* "ntske/1" */
+#define MBEDTLS_SSL_KEYING_MATERIAL_EXPORT  /* NTS C2S/S2C keys */
+
+/* Record buffers: a ClientHello with post-quantum key shares fits the
+ * input side; our largest flight and the 8-cookie reply fit the output */
+#define MBEDTLS_SSL_IN_CONTENT_LEN          4096
+#define MBEDTLS_SSL_OUT_CONTENT_LEN         2048
+
+#endif /* MBEDTLS_CONFIG_H */
@@ -0,0 +1,74 @@
+/**
+ * CHRONOS-Rb Latency Histograms
+ *
+ * Fixed-bucket histograms for the hot paths (NTP/PTP service time, PPS IRQ
+ * latency, discipline offset, main loop time). Observing is a bucket
+ * search and three increments - no allocation, safe from IRQs and from
+ * either core. They are exposed with the module counters on /metrics in
+ * Prometheus text format.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define METRICS_MAX_BOUNDS      12      /* Finite buckets per histogram */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef enum {
+    METRIC_NTP_SERVICE = 0,     /* NTP RX stamp to reply sent (us) */
+    METRIC_PPS_IRQ_LATENCY,     /* PPS edge to IRQ handler (ns) */
+    METRIC_DISCIPLINE_OFFSET,   /* Discipline input offset (ns) */
+    METRIC_MAIN_LOOP,           /* Core0 main loop pass (us) */
+    METRIC_NTS_SERVICE,         /* NTS RX stamp to reply sent (us) */
+    METRIC_PTP_SERVICE,         /* PTP Delay_Req RX stamp to Delay_Resp sent (us) */
+    METRIC_WIFI_PROBE_RTT,      /* WiFi link probe round trip (us) */
+    METRIC_HIST_COUNT
+} metrics_hist_id_t;
+
+/* Consistent copy of one histogram */
+typedef struct {
+    const char *name;           /* Exposition name, in base units */
+    const char *help;
+    double scale;               /* Observed unit to base unit */
+    uint8_t nbounds;
+    const int32_t *bounds;      /* Upper bounds in observed units, ascending */
+    uint32_t buckets[METRICS_MAX_BOUNDS + 1];  /* Per bucket; last is +Inf */
+    int64_t sum;                /* In observed units */
+    uint32_t count;
+} metrics_hist_snapshot_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Record one observation (any core, any context)
+ */
+void metrics_observe(metrics_hist_id_t id, int32_t value);
+
+/**
+ * Copy a histogram for exposition
+ */
+void metrics_hist_read(metrics_hist_id_t id, metrics_hist_snapshot_t *out);
+
+/**
+ * Quantile q (0..1) of a histogram copy in observed units, interpolated
+ * linearly inside the bucket it falls in. Observations above the last
+ * bound report that bound; an empty histogram reports 0.
+ */
+double metrics_hist_quantile(const metrics_hist_snapshot_t *h, double q);
+
+#endif /* METRICS_H */
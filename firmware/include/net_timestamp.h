@@ -0,0 +1,108 @@
+/**
+ * CHRONOS-Rb Network Timestamping
+ *
+ * Captures packet receive and transmit times at the CYW43 driver boundary
+ * instead of in the UDP callbacks:
+ *   RX - the WL_HOST_WAKE interrupt that announces a frame (first frame
+ *        after a wake), else the moment the driver hands the frame to
+ *        lwIP, before ARP/IP/UDP processing
+ *   TX - the moment the driver has clocked the frame out over SPI
+ *
+ * All timestamps are time_us_64() values; convert with timestamp_from_us().
+ *
+ * A link round-trip probe (ARP request to the gateway, reply stamped on
+ * the same RX path) lets wifi_manager.c calibrate the latency between
+ * these driver stamps and the frame actually being on the air.
+ *
+ * A driver that takes its own stamps (the W5500, eth_w5500.h) reports
+ * them with net_ts_driver_rx()/net_ts_driver_tx(), and while its netif
+ * carries time the NTP/PTP sockets are bound to it with net_ts_bind_pcb().
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef NET_TIMESTAMP_H
+#define NET_TIMESTAMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct netif;
+struct udp_pcb;
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+/* Use the CYW43 host-wake interrupt as the RX stamp when it is recent */
+#define NET_TS_USE_HOST_WAKE    1
+#define NET_TS_WAKE_MAX_US      5000    /* Ignore wakes older than this */
+
+/* Link probe gives up if no reply arrives within this time */
+#define NET_TS_PROBE_TIMEOUT_US 100000
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    bool attached;              /* Hooks installed on the default netif */
+    uint32_t rx_frames;         /* Frames delivered to lwIP */
+    uint32_t rx_wake_stamped;   /* Frames stamped from the host-wake IRQ */
+    uint32_t wake_latency_us;   /* Last host-wake to lwIP delivery latency */
+    uint32_t tx_frames;         /* Frames handed to a driver (all netifs) */
+    uint32_t tx_latency_us;     /* Last frame's write to the chip */
+    uint32_t probes_sent;       /* Link probes sent */
+    uint32_t probes_answered;   /* Link probes with a reply */
+} net_ts_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* Hook the default netif (idempotent; re-hooks after the netif is re-added) */
+void net_ts_attach(void);
+
+/* Receive time of the frame currently being processed by lwIP.
+ * Only meaningful inside an lwIP receive callback. */
+uint64_t net_ts_rx_us(void);
+
+/* Number of frames handed to the driver so far */
+uint32_t net_ts_tx_count(void);
+
+/* Driver completion time of the last transmitted frame */
+uint64_t net_ts_tx_us(void);
+
+/* Completion time of a frame sent after tx_count_before was sampled,
+ * or the current time if the driver did not see it */
+uint64_t net_ts_tx_since(uint32_t tx_count_before);
+
+/* Send a link round-trip probe (ARP request to the gateway). Returns
+ * false if there is no gateway or a probe is still outstanding. */
+bool net_ts_probe_start(void);
+
+/* Fetch the result of the last probe: true once per answered probe with
+ * the driver-TX-done to host-wake/RX round trip in microseconds */
+bool net_ts_probe_result(uint32_t *rtt_us);
+
+/* Stamps from a driver that takes its own: RX for the frame it is about
+ * to pass to netif->input, TX for the frame it has just sent */
+void net_ts_driver_rx(uint64_t stamp_us);
+void net_ts_driver_tx(uint64_t stamp_us);
+
+/* Interface NTP/PTP serve on: the wired netif when it can, else the
+ * default (WiFi) netif */
+struct netif *net_ts_time_netif(void);
+
+/* Bind a time service socket to the wired netif, or release it back to
+ * all interfaces (task context, idempotent). Returns true on a change. */
+bool net_ts_bind_pcb(struct udp_pcb *pcb);
+
+/* One-way stamp correction of the time interface (ns) */
+int32_t net_ts_link_latency_ns(void);
+
+/* Get timestamping statistics */
+void net_ts_get_stats(net_ts_stats_t *stats);
+
+#endif /* NET_TIMESTAMP_H */
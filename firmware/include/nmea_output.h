@@ -1,7 +1,11 @@
 /**
  * CHRONOS-Rb NMEA 0183 Output
  *
- * GPS-compatible time sentences over UART
+ * GPS-compatible time sentences on GP28, one burst per second. The
+ * burst for a second is formatted during the second before, and the PPS
+ * interrupt starts a DMA transfer into the UART0 TX FIFO, so the
+ * first start bit leaves at the PPS IRQ latency after the edge (a few
+ * µs, METRIC_PPS_IRQ_LATENCY) and the CPU never waits on the line.
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -13,16 +17,41 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+/* Sentence set bits */
+#define NMEA_SENT_ZDA           0x01    /* $GPZDA time and date */
+#define NMEA_SENT_RMC           0x02    /* $GPRMC recommended minimum */
+#define NMEA_SENT_GGA           0x04    /* $GPGGA fix data (time only) */
+#define NMEA_SENT_ALL           (NMEA_SENT_ZDA | NMEA_SENT_RMC | NMEA_SENT_GGA)
+
+#define NMEA_BAUD_DEFAULT       115200
+
+/* A burst must end this long before the next PPS; sentences that would
+ * not fit at the selected baud rate are dropped */
+#define NMEA_TX_BUDGET_MS       900
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
 /**
- * Initialize NMEA output on UART1 (GP28)
+ * Initialize NMEA output (UART0 TX on GP28)
  */
 void nmea_output_init(void);
 
 /**
- * NMEA task - call from main loop to output sentences
+ * NMEA task - woken each second to format the next second's burst
  */
 void nmea_output_task(void);
 
+/**
+ * Rubidium PPS edge, from the capture IRQ: start the prepared burst
+ */
+void nmea_output_pps_edge(void);
+
 /**
  * Enable/disable NMEA output
  */
@@ -33,9 +62,29 @@ void nmea_output_enable(bool enable);
  */
 bool nmea_output_is_enabled(void);
 
+/**
+ * Select the sentences sent each second (NMEA_SENT_* bits)
+ */
+void nmea_output_set_sentences(uint8_t mask);
+uint8_t nmea_output_get_sentences(void);
+
+/**
+ * Set the baud rate (4800-921600, see nmea_output_baud_valid()).
+ * Returns false for an unsupported rate.
+ */
+bool nmea_output_set_baud(uint32_t baud);
+uint32_t nmea_output_get_baud(void);
+bool nmea_output_baud_valid(uint32_t baud);
+
 /**
  * Get number of sentences sent
  */
 uint32_t nmea_output_get_count(void);
 
+/**
+ * Get statistics: sentences sent, bursts still running at the next PPS,
+ * sentences dropped for airtime
+ */
+void nmea_output_get_stats(uint32_t *sent, uint32_t *overruns, uint32_t *dropped);
+
 #endif /* NMEA_OUTPUT_H */
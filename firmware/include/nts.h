@@ -12,10 +12,53 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define NTS_KEY_SIZE        32      /* AEAD_AES_SIV_CMAC_256 */
+#define NTS_COOKIE_SIZE     100     /* Key ID, nonce, SIV(C2S || S2C) */
+#define NTS_UID_MAX         64      /* Longest Unique Identifier echoed */
+#define NTS_MAX_COOKIES     8       /* Cookies returned per response */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef enum {
+    NTS_NONE = 0,               /* No NTS fields: plain NTP */
+    NTS_OK,                     /* Authenticated, answer with nts_finish_response() */
+    NTS_NAK,                    /* Bad cookie or authenticator: send an NTSN kiss */
+    NTS_DROP                    /* Malformed, no reply */
+} nts_status_t;
+
+/* What the response needs from a verified request */
+typedef struct {
+    nts_status_t status;
+    int session;                /* Key cache slot holding C2S/S2C */
+    uint8_t cookies;            /* Cookies to return (1 + placeholders) */
+    uint16_t uid_len;
+    uint8_t uid[NTS_UID_MAX];
+} nts_request_t;
+
+typedef struct {
+    uint32_t requests;          /* Authenticated requests */
+    uint32_t naks;              /* NTSN kisses sent for */
+    uint32_t malformed;         /* Dropped without a reply */
+    uint32_t cache_hits;        /* Session keys already expanded */
+    uint32_t cache_misses;
+    uint32_t rotations;         /* Master key rotations */
+    uint32_t master_id;         /* Current master key ID */
+} nts_auth_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
 
 /**
- * Initialize NTS support
- * Note: Full NTS requires TLS 1.3 (mbedTLS)
+ * Initialize NTS support, including the NTS-KE server
  */
 void nts_init(void);
 
@@ -25,11 +68,25 @@ void nts_init(void);
 bool nts_is_protected_request(const uint8_t *pkt, size_t len);
 
 /**
- * Process NTS-protected NTP request
- * Returns response length, 0 if cannot process
+ * Parse and authenticate an NTP request with extension fields. pkt is
+ * the whole request; req carries what the response needs.
+ */
+nts_status_t nts_verify_request(const uint8_t *pkt, size_t len, nts_request_t *req);
+
+/**
+ * Append the NTS fields after the 48-byte header already written at
+ * pkt: the Unique Identifier, then for NTS_OK an authenticator holding
+ * fresh cookies under the S2C key. Returns the packet length, 0 if it
+ * would exceed max_len.
+ */
+size_t nts_finish_response(const nts_request_t *req, uint8_t *pkt, size_t max_len);
+
+/**
+ * Build a cookie holding the session keys, under the current master key
+ * (core0 task context; takes the lwIP lock)
  */
-int nts_process_request(const uint8_t *req, size_t req_len,
-                        uint8_t *resp, size_t max_resp_len);
+void nts_make_cookie(const uint8_t c2s[NTS_KEY_SIZE], const uint8_t s2c[NTS_KEY_SIZE],
+                     uint8_t cookie[NTS_COOKIE_SIZE]);
 
 /**
  * Enable/disable NTS
@@ -47,7 +104,12 @@ bool nts_is_enabled(void);
 void nts_get_stats(uint32_t *ke_conns, uint32_t *ntp_reqs);
 
 /**
- * Check if full NTS is available (requires TLS)
+ * Get authentication and key cache statistics
+ */
+void nts_get_auth_stats(nts_auth_stats_t *stats);
+
+/**
+ * Check if full NTS is available (NTS-KE listening)
  */
 bool nts_is_fully_implemented(void);
 
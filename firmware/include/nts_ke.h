@@ -0,0 +1,74 @@
+/**
+ * CHRONOS-Rb NTS Key Establishment Server
+ *
+ * RFC 8915 NTS-KE over TLS 1.3 (mbedTLS), TCP port 4460
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef NTS_KE_H
+#define NTS_KE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define NTS_KE_PORT             4460
+#define NTS_KE_MAX_SESSIONS     2           /* Concurrent handshakes (of MEMP_NUM_TCP_PCB) */
+#define NTS_KE_ARENA_SIZE       (36 * 1024) /* All mbedTLS allocations */
+#define NTS_KE_TIMEOUT_MS       10000       /* Whole exchange, accept to close */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    uint32_t accepted;
+    uint32_t refused;           /* All session slots busy */
+    uint32_t completed;         /* Cookies delivered */
+    uint32_t tls_failures;      /* Handshake or record errors */
+    uint32_t bad_requests;      /* NTS-KE records rejected */
+    uint32_t timeouts;
+    uint32_t max_step_us;       /* Longest single handshake step */
+    uint32_t arena_used;        /* Bytes allocated now */
+    uint32_t arena_peak;
+    uint32_t arena_failures;    /* Allocations refused */
+} nts_ke_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Build the server certificate and TLS configuration, and listen.
+ * Returns false if NTS-KE is unavailable.
+ */
+bool nts_ke_init(void);
+
+/**
+ * Advance open sessions (core0 main loop, SCHED_EV_NTS_KE)
+ */
+void nts_ke_task(void);
+
+/**
+ * Check if the KE server is listening
+ */
+bool nts_ke_is_ready(void);
+
+/**
+ * Write the self-signed server certificate as PEM. Returns its length,
+ * 0 if it does not fit or there is none.
+ */
+size_t nts_ke_cert_pem(char *buf, size_t max_len);
+
+/**
+ * Get NTS-KE statistics
+ */
+void nts_ke_get_stats(nts_ke_stats_t *stats);
+
+#endif /* NTS_KE_H */
@@ -28,6 +28,13 @@
 /* OTA upload timeout in seconds (auto-abort if no data received) */
 #define OTA_TIMEOUT_SEC         60
 
+/* Streaming upload: decrypted input buffer, and the input held back
+ * until more arrives so a deflate block never runs dry mid-page. Deflate
+ * needs under 1.2KB of input per 256-byte page (a dynamic block header
+ * plus 256 worst-case codes); the margin leaves room for short blocks. */
+#define OTA_STREAM_BUF_SIZE     8192
+#define OTA_STREAM_MARGIN       4096
+
 /*============================================================================
  * OTA STATUS CODES
  *============================================================================*/
@@ -62,7 +69,9 @@ typedef struct {
     size_t total_size;          /* Expected total firmware size */
     size_t bytes_received;      /* Bytes received so far */
     size_t bytes_written;       /* Bytes written to flash */
-    uint32_t expected_crc;      /* Expected CRC32 (optional) */
+    uint32_t expected_crc;      /* Expected CRC32 of the upload (0 = none) */
+    uint32_t crc;               /* CRC32 of the bytes received (streaming) */
+    bool streaming;             /* Single-request upload in progress */
     ota_error_t last_error;
     bool is_after_update;       /* True if this boot is after an update */
     bool is_after_rollback;     /* True if bootloader performed rollback */
@@ -104,9 +113,37 @@ ota_error_t ota_begin(size_t total_size, uint32_t expected_crc);
  */
 ota_error_t ota_write_chunk(const uint8_t *data, size_t len);
 
+/**
+ * Start a streaming update: the whole image arrives in one request and
+ * is decrypted, decompressed and programmed as it arrives, with no
+ * staging copy, erasing the download slot one sector at a time
+ *
+ * @param total_size Upload size in bytes
+ * @param expected_crc CRC32 of the upload (0 to skip the check)
+ * @return OTA_OK on success, error code on failure
+ */
+ota_error_t ota_stream_begin(size_t total_size, uint32_t expected_crc);
+
+/**
+ * Feed upload bytes to a streaming update. len must not exceed
+ * ota_stream_space(); the bytes are consumed (and flash programmed)
+ * before it returns, so the caller can acknowledge them to the sender.
+ *
+ * @param data Pointer to data buffer
+ * @param len Length of data
+ * @return OTA_OK on success, error code on failure
+ */
+ota_error_t ota_stream_write(const uint8_t *data, size_t len);
+
+/**
+ * Bytes ota_stream_write() accepts now (never 0 while streaming)
+ */
+size_t ota_stream_space(void);
+
 /**
  * Finalize the firmware update
- * Validates SHA256 (if enabled), marks slot as valid
+ * Drains a streaming update and checks its CRC32, then
+ * validates SHA256 (if enabled), marks slot as valid
  *
  * @return OTA_OK on success, error code on failure
  */
@@ -0,0 +1,122 @@
+/**
+ * CHRONOS-Rb Cycle Tracing
+ *
+ * PERF_BEGIN/PERF_END (or PERF_CALL) bracket hot code with reads of the
+ * core's DWT cycle counter. Every span updates per-probe min/max/sum and
+ * a log-linear histogram (for p99), and is appended to a per-core binary
+ * ring that the `perf` CLI command reports and dumps.
+ *
+ * Built only with CMake option CHRONOS_PERF_TRACE. Otherwise the macros
+ * expand to the bare code and no tracing code or RAM is linked.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef PERF_TRACE_H
+#define PERF_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chronos_rb.h"
+
+/*============================================================================
+ * PROBES
+ *============================================================================*/
+
+typedef enum {
+    /* Interrupt handlers */
+    PERF_PPS_IRQ = 0,           /* Rubidium PPS PIO IRQ */
+    PERF_FREQ_STAMPS,           /* 10 MHz regression stamp drain */
+    PERF_GNSS_PPS_IRQ,          /* GNSS PPS GPIO edge */
+    PERF_AC_CYCLES,             /* AC mains zero crossing stamps */
+    /* Request and receive paths */
+    PERF_NTP_REQUEST,           /* ntp_handle_request() */
+    PERF_GNSS_RX,               /* GNSS UART DMA ring scan */
+    /* Scheduled tasks */
+    PERF_TASK_TIMING,           /* Timing core dispatch pass */
+    PERF_TASK_WIFI_AUTO,
+    PERF_TASK_WIFI,
+    PERF_TASK_NTP,
+    PERF_TASK_PTP,
+    PERF_TASK_WEB,
+    PERF_TASK_OTA,
+    PERF_TASK_LEDS,
+    PERF_TASK_CLI,
+    PERF_TASK_STATUS,
+    PERF_TASK_LOG,
+    PERF_TASK_ROUGHTIME,
+    PERF_TASK_NTS_KE,
+    PERF_TASK_WARM,
+    PERF_TASK_HISTORY,
+    PERF_TASK_ETH,
+    PERF_PROBE_COUNT
+} perf_probe_t;
+
+#if CHRONOS_PERF_TRACE
+
+#include "hardware/structs/m33.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define PERF_RING_SIZE          256     /* Events per core, power of 2 */
+#define PERF_SUB_BITS           2       /* Histogram buckets per octave = 4 */
+#define PERF_BUCKETS            96      /* Up to 2^24 cycles (~110 ms) */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+/* One traced span as stored in the ring */
+typedef struct {
+    uint32_t start;             /* Cycle counter at PERF_BEGIN */
+    uint32_t info;              /* probe << 24 | cycles (saturated to 24 bits) */
+} perf_event_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;               /* Cycles */
+    uint32_t max;
+    uint64_t sum;
+    uint32_t p99;               /* Upper edge of the p99 bucket */
+} perf_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+static inline uint32_t perf_cycles(void) {
+    return m33_hw->dwt_cyccnt;
+}
+
+/* Enable the cycle counter on the calling core */
+void perf_init_core(void);
+
+/* Close a span opened at start (any context) */
+void perf_record(perf_probe_t probe, uint32_t start);
+
+const char *perf_probe_name(perf_probe_t probe);
+void perf_get_stats(perf_probe_t probe, perf_stats_t *out);
+
+/* Copy the newest events recorded on a core, oldest first */
+int perf_ring_read(uint32_t core, perf_event_t *out, int max);
+
+void perf_reset(void);
+
+#define PERF_INIT_CORE()        perf_init_core()
+#define PERF_BEGIN(probe)       uint32_t perf_start_##probe = perf_cycles()
+#define PERF_END(probe)         perf_record(probe, perf_start_##probe)
+#define PERF_CALL(probe, call)  do { PERF_BEGIN(probe); call; PERF_END(probe); } while (0)
+
+#else
+
+#define PERF_INIT_CORE()        do { } while (0)
+#define PERF_BEGIN(probe)       do { } while (0)
+#define PERF_END(probe)         do { } while (0)
+#define PERF_CALL(probe, call)  do { call; } while (0)
+
+#endif /* CHRONOS_PERF_TRACE */
+
+#endif /* PERF_TRACE_H */
@@ -31,6 +31,7 @@
  *============================================================================*/
 
 #define MAX_PULSE_OUTPUTS   8
+#define PULSE_GPIO_MAX      28      /* Highest user GPIO */
 
 /*============================================================================
  * PULSE TRIGGER TYPES
@@ -60,13 +61,15 @@ typedef struct {
     uint16_t pulse_gap_ms;      /* Gap between pulses in burst (ms) */
     bool active;                /* Configuration is active */
 
-    /* Runtime state for burst generation */
-    uint32_t last_trigger_pps;  /* PPS count at last trigger */
-    uint8_t last_trigger_ds;    /* Decisecond (0-9) within second at last trigger */
-    uint32_t pulse_off_time;    /* Time to turn off current pulse (0 = off) */
-    uint32_t next_pulse_time;   /* Time to start next pulse in burst (0 = none) */
-    uint16_t burst_remaining;   /* Pulses remaining in current burst */
-    bool triggered_this_period; /* Already triggered in current period */
+    /* Runtime state, owned by the event queue (10MHz ticks since the
+     * NTP epoch) */
+    uint64_t next_fire;         /* Start of the next pulse to place */
+    uint64_t due;               /* Queue key: load it into the SM / next CPU edge */
+    uint64_t queued_start;      /* Last pulse handed to the SM */
+    uint64_t queued_end;
+    uint16_t burst_index;       /* Pulse of the current burst at next_fire */
+    bool cpu_high;              /* CPU fallback pulse in progress */
+    uint32_t missed;            /* Pulses dropped because they could not be placed */
     int8_t pio_index;           /* PIO allocation index (-1 = CPU fallback) */
 } pulse_config_t;
 
@@ -77,9 +80,14 @@ typedef struct {
 /* Initialize pulse output system */
 void pulse_output_init(void);
 
-/* Process pulse outputs - call from main loop */
+/* Place due pulses - run on PPS and at the deadline it requests */
 void pulse_output_task(void);
 
+/* Whether a pin may carry a pulse output: GP0-28, less the pins a build
+ * reserves (the W5500 bus with CHRONOS_ETH_W5500). Every setter and the
+ * config load check it. */
+bool pulse_output_pin_allowed(uint8_t gpio_pin);
+
 /* Configure interval-based pulse
  * interval_ds: interval in deciseconds (0.1s units), e.g., 5 = 0.5s, 10 = 1.0s
  * Returns slot index (0-7) on success, -1 on failure */
@@ -33,10 +33,15 @@ typedef enum {
 void radio_timecode_init(void);
 
 /**
- * Radio timecode task - call frequently from main loop
+ * Radio timecode task - run once per PPS to encode the next second
  */
 void radio_timecode_task(void);
 
+/**
+ * Start the queued second's WWVB/JJY keying - call from the PPS IRQ
+ */
+void radio_timecode_pps_edge(void);
+
 /**
  * Enable/disable individual signal outputs
  */
@@ -52,4 +57,14 @@ bool radio_timecode_is_enabled(radio_signal_t signal);
  */
 uint8_t radio_timecode_get_gpio(radio_signal_t signal);
 
+/**
+ * Enable/disable the DCF77 pseudo-random phase modulation
+ */
+void radio_timecode_set_dcf77_pm(bool enable);
+
+/**
+ * Check if DCF77 phase modulation is on
+ */
+bool radio_timecode_get_dcf77_pm(void);
+
 #endif /* RADIO_TIMECODE_H */
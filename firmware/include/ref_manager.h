@@ -0,0 +1,120 @@
+/**
+ * CHRONOS-Rb Reference Manager
+ *
+ * Scores the four references - FE-5680A PPS, GNSS PPS, the Rb 10 MHz
+ * count and GNSS NMEA time - on availability, their own lock signal and
+ * measured jitter, and combines them into one time solution:
+ *
+ *   - One PPS source is primary and drives the time base and the
+ *     discipline loop. The Rb PPS is preferred for its short-term
+ *     stability; the GNSS PPS takes over when the Rb is unlocked or
+ *     missing, and with neither the sync state machine holds over.
+ *   - While both PPS are healthy, the GNSS minus Rb phase is filtered
+ *     over REF_STEER_TAU_S and sets the phase of the Rb edges within the
+ *     UTC second, so GNSS steers the long term.
+ *   - The primary edge carries a phase (UTC at the edge minus the whole
+ *     second). On a switch it starts at whatever the time base already
+ *     reads at the new edge, then slews to its target at
+ *     REF_SLEW_NS_PER_S, so switchover never steps the time served.
+ *     Before time is valid the phase steps straight to its target.
+ *
+ * Hardware outputs derived from the Rb divider keep the Rb phase.
+ *
+ * Timing core only: the edge hooks run in the PPS IRQ and the PPS FIFO
+ * task, ref_task() in the scheduler. Core0 reads ref_status_t from the
+ * timing snapshot.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef REF_MANAGER_H
+#define REF_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define REF_SCORE_MIN           50          /* Usable as primary */
+#define REF_SWITCH_S            3           /* Seconds degraded before leaving a primary */
+#define REF_RETURN_S            10          /* Seconds healthy before returning to the Rb */
+#define REF_STALE_US            2000000     /* Source unavailable after 2s silence */
+#define REF_STEER_TAU_S         300         /* GNSS minus Rb phase filter */
+#define REF_STEER_MIN_SAMPLES   16          /* Offsets before GNSS may steer */
+#define REF_SLEW_NS_PER_S       100         /* Phase slew limit once time is valid */
+
+/* Jitter at which a source still scores full marks (ns) */
+#define REF_RB_PPS_JITTER_NS    20.0f
+#define REF_GNSS_PPS_JITTER_NS  50.0f
+#define REF_10MHZ_JITTER_NS     200.0f      /* 2 counts */
+#define REF_NMEA_JITTER_NS      10e6f       /* Sentence latency after PPS */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef enum {
+    REF_RB_PPS = 0,
+    REF_GNSS_PPS,
+    REF_RB_10MHZ,
+    REF_GNSS_NMEA,
+    REF_COUNT
+} ref_source_t;
+
+#define REF_NONE    REF_COUNT               /* No primary: holdover */
+
+typedef struct {
+    bool available;             /* Samples within REF_STALE_US */
+    bool locked;                /* Source's own lock or fix signal */
+    uint8_t score;              /* 0..100 */
+    float jitter_ns;            /* RMS short-term noise */
+    uint32_t samples;
+    uint32_t faults;            /* Samples rejected */
+} ref_health_t;
+
+typedef struct {
+    ref_health_t src[REF_COUNT];
+    uint8_t primary;            /* ref_source_t of the edge source, REF_NONE */
+    bool steering;              /* GNSS phase steering the Rb edges */
+    int32_t gnss_offset_ns;     /* Filtered GNSS minus Rb PPS */
+    int32_t phase_ns;           /* UTC at the primary edge minus the second */
+    int32_t target_ns;          /* Phase the slew is heading for */
+    uint32_t switches;          /* Primary changes since boot */
+} ref_status_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* Reset all source state (timing core init) */
+void ref_init(void);
+
+/**
+ * Rb PPS edge (PPS IRQ). Returns true if the Rb is primary and the edge
+ * should drive the time base; *phase_ns is the phase to anchor it at.
+ */
+bool ref_rb_edge(int64_t interval_ns, int32_t *phase_ns);
+
+/**
+ * GNSS PPS edge stamp (PPS FIFO task). offset_ns is GNSS minus Rb,
+ * folded to +/-0.5s, or NULL without a Rb edge. Anchors the time base
+ * itself when GNSS is primary.
+ */
+void ref_gnss_edge(uint64_t edge_ns, const int32_t *offset_ns);
+
+/* Scoring, selection and phase slew (timing core, ~10 Hz) */
+void ref_task(void);
+
+/* Current primary (ref_source_t or REF_NONE) */
+uint8_t ref_get_primary(void);
+
+/* Status copy (timing core; core0 uses timing_snapshot_t.ref) */
+void ref_get_status(ref_status_t *out);
+
+/* Short lower-case name for metrics labels and the CLI */
+const char *ref_source_name(uint8_t src);
+
+#endif /* REF_MANAGER_H */
@@ -0,0 +1,122 @@
+/**
+ * CHRONOS-Rb Reference-Locked Waveform Engine
+ *
+ * Plays waveforms whose every edge falls on a 10MHz reference edge, one
+ * frame per second, each frame starting on the PPS rising edge. A frame
+ * is a stream of {high, low} tick counts (see ref_wave.pio) that DMA
+ * feeds from a control block list. Each instance has two lists that
+ * jump to each other, so playback never stops and the owner rewrites
+ * the idle list once per second while the other one plays.
+ *
+ * Instances: IRIG-B on PIO2 SM1, the DCF77 carrier on PIO2 SM2.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef REF_WAVE_H
+#define REF_WAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/types.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define REF_WAVE_TICKS_PER_US   10      /* 10MHz reference */
+#define REF_WAVE_SYNC_US        100     /* Frames end this early, then wait for PPS */
+
+/* Tables repeated with ref_wave_put_ring() hold this many words and
+ * must be aligned to REF_WAVE_RING_ALIGN */
+#define REF_WAVE_RING_WORDS     64
+#define REF_WAVE_RING_ALIGN     (REF_WAVE_RING_WORDS * 4)
+
+/* FIFO word for a high or low time (a zero word is the PPS sync) */
+#define REF_WAVE_WORD(ticks)    ((uint32_t)(ticks) - 1)
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+/* One DMA transfer; the control channel writes it to the data channel's
+ * alias 1 registers, the count last so it triggers the transfer */
+typedef struct {
+    uint32_t ctrl;
+    const void *read;
+    volatile void *write;
+    uint32_t count;
+} ref_wave_block_t;
+
+typedef struct {
+    uint sm;
+    int ctrl_chan;
+    int data_chan;
+    uint32_t ctrl_table;        /* Data channel CTRL, linear read */
+    uint32_t ctrl_ring;         /* Data channel CTRL, ring read */
+    uint32_t ctrl_jump;         /* Data channel CTRL, list jump */
+    ref_wave_block_t *list[2];
+    const ref_wave_block_t *list_addr[2];   /* Read by the jump blocks */
+    uint32_t blocks;            /* Capacity of each list */
+    uint32_t label[2];          /* NTP second each list carries */
+    bool running;
+    uint32_t frames;            /* Lists rebuilt */
+    uint32_t resyncs;           /* Restarts after a time step or lost PPS */
+} ref_wave_t;
+
+/**
+ * Frame builder: encode the frame for second into list idx, ending it
+ * with ref_wave_end()
+ */
+typedef void (*ref_wave_build_fn)(int idx, uint32_t second);
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Claim PIO2 state machine sm and two DMA channels for a waveform on
+ * out_pin. lists holds 2 * blocks entries. Returns false if the program
+ * does not fit; the output does not run until ref_wave_service().
+ */
+bool ref_wave_init(ref_wave_t *w, uint sm, uint out_pin,
+                   ref_wave_block_t *lists, uint32_t blocks);
+
+/**
+ * Append a block that sends count words from words
+ */
+ref_wave_block_t *ref_wave_put(const ref_wave_t *w, ref_wave_block_t *b,
+                               const uint32_t *words, uint32_t count);
+
+/**
+ * Append a block that sends count words cycling through a
+ * REF_WAVE_RING_WORDS table
+ */
+ref_wave_block_t *ref_wave_put_ring(const ref_wave_t *w, ref_wave_block_t *b,
+                                    const uint32_t *table, uint32_t count);
+
+/**
+ * Close list idx at b: PPS sync, then jump to the other list. Lists
+ * need two blocks spare for this.
+ */
+void ref_wave_end(const ref_wave_t *w, int idx, ref_wave_block_t *b);
+
+/**
+ * Once per PPS: keep the idle list one frame ahead of the playing one,
+ * restarting on the next PPS if the frame on air is not for now/now+1
+ * Returns true if it restarted.
+ */
+bool ref_wave_service(ref_wave_t *w, uint32_t now, ref_wave_build_fn build);
+
+/**
+ * Have the next ref_wave_service() rebuild the queued list (format change)
+ */
+void ref_wave_invalidate(ref_wave_t *w);
+
+/**
+ * Hand out_pin to the state machine, or drive it low
+ */
+void ref_wave_output(uint out_pin, bool enable);
+
+#endif /* REF_WAVE_H */
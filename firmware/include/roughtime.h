@@ -13,11 +13,27 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+typedef struct {
+    uint32_t requests;          /* Replies sent */
+    uint32_t batches;           /* Signatures made for replies */
+    uint32_t dropped;           /* Requests refused with the batch full */
+    uint32_t malformed;         /* Short requests or no 64-byte NONC */
+    uint32_t delegations;       /* Online keys issued */
+    uint32_t max_batch;         /* Largest batch answered */
+    uint32_t sign_us;           /* Last SREP signing time */
+} roughtime_stats_t;
+
 /**
  * Initialize Roughtime server on UDP port 2002
  */
 void roughtime_init(void);
 
+/**
+ * Sign and answer the queued batch: woken by SCHED_EV_ROUGHTIME, runs
+ * once the collection window closes (core0 scheduler task)
+ */
+void roughtime_task(void);
+
 /**
  * Enable/disable Roughtime server
  */
@@ -34,7 +50,12 @@ bool roughtime_is_enabled(void);
 uint32_t roughtime_get_requests(void);
 
 /**
- * Get public key (32 bytes)
+ * Get batching statistics
+ */
+void roughtime_get_stats(roughtime_stats_t *stats);
+
+/**
+ * Get long-term public key (32 bytes)
  */
 const uint8_t *roughtime_get_pubkey(void);
 
@@ -0,0 +1,115 @@
+/**
+ * CHRONOS-Rb Task Scheduler
+ *
+ * Each core runs its own table of tasks. A task names a period, a set
+ * of events that should wake it, or both, and is called only when one
+ * of those is due. While running, a task may also ask to be called
+ * again by a deadline (end of an output pulse, next bit edge), which
+ * replaces polling the clock from a busy loop.
+ *
+ * Between passes the core sleeps in WFE until the earliest deadline,
+ * an event post, or any interrupt. Events are posted from IRQ handlers
+ * or from the other core and are latched per core, so a post made
+ * while tasks are running is seen on the next pass.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define SCHED_MAX_TASKS         16      /* Per core */
+#define SCHED_MAX_SLEEP_US      100000  /* Cap on one idle sleep */
+
+/*============================================================================
+ * EVENTS
+ *============================================================================*/
+
+#define SCHED_EV_PPS            (1u << 0)   /* Rubidium PPS edge captured */
+#define SCHED_EV_GNSS_PPS       (1u << 1)   /* GNSS PPS edge captured */
+#define SCHED_EV_PUBLISH        (1u << 2)   /* Timing snapshot published */
+#define SCHED_EV_CALL           (1u << 3)   /* Timing core mailbox call posted */
+#define SCHED_EV_STDIO          (1u << 4)   /* Console input available */
+#define SCHED_EV_LOG            (1u << 5)   /* Deferred log record written */
+#define SCHED_EV_ROUGHTIME      (1u << 6)   /* Roughtime request queued */
+#define SCHED_EV_NTS_KE         (1u << 7)   /* NTS-KE connection has work */
+#define SCHED_EV_SECOND         (1u << 8)   /* Calendar advanced to a new second */
+#define SCHED_EV_ETH            (1u << 9)   /* W5500 INTn: frames received */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef void (*sched_fn_t)(void);
+
+/* Per-task statistics */
+typedef struct {
+    const char *name;
+    uint32_t period_us;         /* 0 = event/deadline driven only */
+    uint32_t events;            /* SCHED_EV_* mask that wakes the task */
+    uint32_t runs;
+    uint32_t max_us;            /* Longest single call */
+} sched_task_stats_t;
+
+/* Per-core statistics */
+typedef struct {
+    uint8_t tasks;              /* Registered tasks */
+    uint32_t passes;            /* Dispatch passes that ran at least one task */
+    uint32_t sleeps;            /* WFE sleeps entered */
+    uint64_t busy_us;           /* Time spent in tasks */
+    uint64_t since_us;          /* Start of the busy_us window */
+} sched_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Register a task on the calling core. The task is first called on the
+ * next pass and then every period_us, and whenever one of events is
+ * posted. Returns the task index or -1 if the table is full.
+ */
+int sched_add(const char *name, sched_fn_t fn, uint32_t period_us, uint32_t events);
+
+/**
+ * Latch events for both cores and wake them (any core, any context)
+ */
+void sched_post(uint32_t events);
+
+/**
+ * From inside a task: call it again no later than when_us (time_us_32
+ * timebase). The earliest request made during one call wins.
+ */
+void sched_wake_at(uint32_t when_us);
+
+/**
+ * From inside a task: call it again within delay_us
+ */
+void sched_wake_in(uint32_t delay_us);
+
+/**
+ * Call every task on this core that is due or has a pending event
+ * Returns true if any task ran.
+ */
+bool sched_dispatch(void);
+
+/**
+ * Sleep until the next deadline on this core, an event or an interrupt
+ */
+void sched_idle(void);
+
+/**
+ * Statistics for a core's scheduler (readable from either core)
+ */
+void sched_get_stats(uint32_t core, sched_stats_t *stats);
+bool sched_get_task_stats(uint32_t core, int index, sched_task_stats_t *stats);
+
+#endif /* SCHED_H */
@@ -0,0 +1,36 @@
+/**
+ * CHRONOS-Rb SHA-512
+ *
+ * Self-contained SHA-512 (FIPS 180-4) for Ed25519 signing and the
+ * Roughtime Merkle tree.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef SHA512_H
+#define SHA512_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA512_DIGEST_SIZE  64
+#define SHA512_BLOCK_SIZE   128
+
+typedef struct {
+    uint64_t state[8];
+    uint64_t length;            /* Bytes hashed so far */
+    uint8_t block[SHA512_BLOCK_SIZE];
+    uint32_t fill;              /* Bytes waiting in block */
+} sha512_ctx_t;
+
+void sha512_init(sha512_ctx_t *ctx);
+void sha512_update(sha512_ctx_t *ctx, const void *data, size_t len);
+void sha512_final(sha512_ctx_t *ctx, uint8_t digest[SHA512_DIGEST_SIZE]);
+
+/**
+ * One-shot digest of len bytes
+ */
+void sha512(const void *data, size_t len, uint8_t digest[SHA512_DIGEST_SIZE]);
+
+#endif /* SHA512_H */
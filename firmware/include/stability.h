@@ -0,0 +1,62 @@
+/**
+ * CHRONOS-Rb Frequency Stability Estimator
+ *
+ * Streaming overlapping Allan (ADEV), modified Allan (MDEV) and time
+ * (TDEV) deviation at octave-spaced taus from 1 s to 65536 s (~18 h).
+ *
+ * Each octave keeps a short ring of phase and phase prefix-sum samples
+ * decimated to a stride of tau / STAB_OVERLAP, so every PPS costs a
+ * fixed amount of work and memory does not grow with tau. The first
+ * taus are fully overlapping; longer taus overlap STAB_OVERLAP times.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef STABILITY_H
+#define STABILITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define STAB_LEVELS             17      /* tau = 2^0 .. 2^16 seconds */
+#define STAB_OVERLAP_LOG2       2       /* Overlapping estimates per tau */
+#define STAB_OVERLAP            (1u << STAB_OVERLAP_LOG2)
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+/* Stability at one tau. Deviations are dimensionless (ADEV/MDEV) or in
+ * seconds (TDEV); they are 0 until the sample count is non-zero. */
+typedef struct {
+    uint32_t tau_s;             /* Averaging time in seconds */
+    double adev;                /* Overlapping Allan deviation */
+    double mdev;                /* Modified Allan deviation */
+    double tdev;                /* Time deviation (seconds) */
+    uint32_t adev_n;            /* Second differences in ADEV */
+    uint32_t mdev_n;            /* Second differences in MDEV */
+} stability_point_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* Clear all estimates (timing core) */
+void stability_reset(void);
+
+/* Add one 1 s phase sample in nanoseconds (timing core, PPS context) */
+void stability_add_phase(int64_t phase_ns);
+
+/* Compute the current estimates (any core). Returns the number of taus
+ * written, up to max. */
+int stability_get(stability_point_t *out, int max);
+
+/* Number of phase samples since the last reset */
+uint32_t stability_get_samples(void);
+
+#endif /* STABILITY_H */
@@ -0,0 +1,137 @@
+/**
+ * CHRONOS-Rb Timing Core
+ *
+ * Splits the firmware across the two RP2350 cores:
+ *   core0 - lwIP/CYW43, NTP/PTP/web servers, CLI, LEDs, flash writes
+ *   core1 - PPS/frequency IRQs, discipline, sync state machine, GNSS
+ *           input, pulse/radio/NMEA/IRIG outputs
+ *
+ * The cores share state through two lock-free mechanisms:
+ *   - A sequence-counted snapshot of the time state published by core1.
+ *     Readers on either core copy it without masking interrupts or
+ *     taking a spinlock, retrying only if they raced with a publish.
+ *   - A single-slot call mailbox used by core0 to run configuration
+ *     changes (pulse, RF, NMEA, GNSS) on core1 between timing tasks.
+ *     Posting a call wakes core1 with SCHED_EV_CALL.
+ *
+ * With CHRONOS_MULTICORE=0 everything runs on core0 as before and the
+ * same API is used, so callers do not need to care which mode is built.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef TIMING_CORE_H
+#define TIMING_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/sync.h"
+
+#include "chronos_rb.h"
+#include "ref_manager.h"
+
+/*============================================================================
+ * SEQUENCE LOCK
+ *============================================================================*/
+
+/* Single-writer sequence lock. The counter is odd while a write is in
+ * progress. Writers running at task level must mask local interrupts
+ * around the write so an IRQ reader on the same core can never spin on
+ * a half-finished update. */
+typedef struct {
+    volatile uint32_t seq;
+} seqlock_t;
+
+static inline void seqlock_write_begin(seqlock_t *s) {
+    s->seq++;
+    __dmb();
+}
+
+static inline void seqlock_write_end(seqlock_t *s) {
+    __dmb();
+    s->seq++;
+}
+
+static inline uint32_t seqlock_read_begin(const seqlock_t *s) {
+    uint32_t seq;
+    while ((seq = s->seq) & 1u) {
+        tight_loop_contents();
+    }
+    __dmb();
+    return seq;
+}
+
+static inline bool seqlock_read_retry(const seqlock_t *s, uint32_t seq) {
+    __dmb();
+    return s->seq != seq;
+}
+
+/*============================================================================
+ * SHARED SNAPSHOT
+ *============================================================================*/
+
+/* Time state as seen by the network core */
+typedef struct {
+    time_state_t state;         /* Copy of the timing core's g_time_state */
+    int32_t min_offset_ns;      /* Discipline statistics (from g_stats) */
+    int32_t max_offset_ns;
+    double avg_offset_ns;
+    uint32_t freq_measurements;
+    double discipline_integral; /* Discipline integrator (s/s), for warm start */
+    uint32_t time_error_ns;     /* Clock model time error bound, UINT32_MAX = unknown */
+    ref_status_t ref;           /* Reference health and selection */
+    freq_regression_t freq;     /* 10MHz regression counter */
+    uint32_t publish_count;     /* Number of snapshots published */
+} timing_snapshot_t;
+
+/* Timing core loop statistics */
+typedef struct {
+    bool multicore;             /* Timing path running on core1 */
+    uint32_t loops;             /* Timing loop iterations */
+    uint32_t max_loop_us;       /* Longest timing loop iteration */
+    uint32_t calls;             /* Mailbox calls executed */
+} timing_core_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* Called on the timing core with a caller-supplied argument */
+typedef void (*timing_call_fn_t)(void *arg);
+
+/* Initialize the timing modules (PPS, freq counter, discipline, sync,
+ * outputs, GNSS) and register their tasks with the scheduler. In
+ * multicore mode this launches core1, which performs the initialization
+ * and then runs its scheduler; returns once core1 reports ready. In
+ * single-core mode the tasks join core0's scheduler. config_init() must
+ * have been called before. */
+void timing_core_init(void);
+
+/* Publish g_time_state/g_stats to the shared snapshot (timing core only,
+ * rate limited internally to once per PPS or every 50ms) */
+void timing_core_publish(void);
+
+/* Copy the latest published snapshot (any core, any context) */
+void timing_core_get_snapshot(timing_snapshot_t *out);
+
+/* Number of snapshots published so far - a cheap change check for
+ * callers that cache values derived from the snapshot */
+uint32_t timing_core_publish_count(void);
+
+/* Run fn(arg) on the timing core and wait for it to finish. Runs inline
+ * in single-core mode or when called from the timing core itself. */
+void timing_core_call(timing_call_fn_t fn, void *arg);
+
+/* Check the timing core is still making progress (core0 watchdog feed) */
+bool timing_core_is_alive(void);
+
+/* Park the timing core while core0 writes flash outside
+ * flash_safe_execute() (OTA). No-op in single-core mode. */
+void timing_core_pause(void);
+void timing_core_resume(void);
+
+/* Get timing loop statistics */
+void timing_core_get_stats(timing_core_stats_t *stats);
+
+#endif /* TIMING_CORE_H */
@@ -0,0 +1,152 @@
+/**
+ * CHRONOS-Rb Time-Series Store
+ *
+ * Long-term history for a fixed set of series: discipline offset, 10 MHz
+ * frequency error, GNSS-vs-Rb PPS offset, NTP load, WiFi RSSI, die
+ * temperature and AC mains frequency. Each is sampled once a second on
+ * core0 (woken by SCHED_EV_SECOND) and rolled up into 1 min, 1 h and
+ * 1 day min/avg/max records on UTC boundaries.
+ *
+ * Every tier of every series is a ring of TSDB_BLOCK_SIZE blocks. A
+ * block starts at a Unix time and holds varint records - the zigzag
+ * delta of the average from the previous record, then avg-min and
+ * max-avg in the rollup tiers - so a record's time is implicit. A span
+ * without samples is a single gap record. A slowly moving series costs
+ * 1-2 bytes a second and 3-5 bytes a rollup, so the default rings keep
+ * about 10 minutes of seconds, 8 hours of minutes, 4 weeks of hours and
+ * 3 months of days per series in 7 KB.
+ *
+ * With CHRONOS_HISTORY_FLASH_KB set at build time, rollup blocks leaving
+ * RAM are written to a flash ring below the config journal instead of
+ * being dropped, and survive reboots. Queries read flash first, then
+ * RAM, oldest first.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef TSDB_H
+#define TSDB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define TSDB_BLOCK_SIZE         256     /* One flash page when spilled */
+
+/* RAM blocks per tier, for each series */
+#define TSDB_BLOCKS_SEC         4
+#define TSDB_BLOCKS_MIN         10
+#define TSDB_BLOCKS_HOUR        12
+#define TSDB_BLOCKS_DAY         2
+
+#define TSDB_SPILL_QUEUE        4       /* Blocks waiting for a flash write */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef enum {
+    TSDB_OFFSET = 0,            /* Discipline phase offset (ns) */
+    TSDB_FREQ,                  /* 10 MHz against the reference (ppt) */
+    TSDB_GNSS,                  /* GNSS PPS minus Rb PPS (ns) */
+    TSDB_NTP_LOAD,              /* NTP requests answered (per s) */
+    TSDB_RSSI,                  /* WiFi signal (dBm) */
+    TSDB_TEMP,                  /* RP2350 die temperature (m°C) */
+    TSDB_AC_FREQ,               /* AC mains frequency (µHz) */
+    TSDB_SERIES_COUNT
+} tsdb_series_t;
+
+typedef enum {
+    TSDB_TIER_SEC = 0,
+    TSDB_TIER_MIN,
+    TSDB_TIER_HOUR,
+    TSDB_TIER_DAY,
+    TSDB_TIER_COUNT
+} tsdb_tier_t;
+
+/* One record; min = avg = max in the seconds tier */
+typedef struct {
+    uint32_t t;                 /* Unix time of the interval start */
+    int32_t min;
+    int32_t avg;
+    int32_t max;
+} tsdb_point_t;
+
+/* A query: series, tier and Unix time range [from, to) */
+typedef struct {
+    uint8_t series;
+    uint8_t tier;
+    bool binary;                /* Raw blocks instead of CSV rows */
+    uint32_t from;
+    uint32_t to;
+} tsdb_query_t;
+
+typedef struct {
+    uint32_t records[TSDB_TIER_COUNT];  /* In RAM */
+    uint32_t bytes[TSDB_TIER_COUNT];
+    uint32_t first_t[TSDB_TIER_COUNT];  /* Oldest in RAM, 0 = none */
+    uint32_t samples;                   /* Seconds sampled since boot */
+} tsdb_series_stats_t;
+
+typedef struct {
+    uint32_t flash_pages;       /* 0 = RAM only */
+    uint32_t flash_used;        /* Pages holding blocks */
+    uint32_t spilled;           /* Blocks written since boot */
+    uint32_t spill_dropped;     /* Blocks lost with the queue full */
+    uint32_t ram_bytes;
+} tsdb_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Find the flash ring head and set up the temperature sensor (core0)
+ */
+void tsdb_init(void);
+
+/**
+ * Sample every series for the new second, close finished rollups and
+ * write queued blocks to flash (core0, on SCHED_EV_SECOND)
+ */
+void tsdb_task(void);
+
+/**
+ * Names as used in queries ("offset", "ac", ...; "1s", "1m", "1h", "1d")
+ * and the unit of a series' values
+ */
+const char *tsdb_series_name(int series);
+const char *tsdb_series_unit(int series);
+const char *tsdb_tier_name(int tier);
+int tsdb_series_from_name(const char *name);
+int tsdb_tier_from_name(const char *name);
+
+/**
+ * Newest records of a tier still in RAM, oldest first. Returns the
+ * number written to out.
+ */
+int tsdb_recent(tsdb_series_t series, tsdb_tier_t tier, tsdb_point_t *out, int max);
+
+/**
+ * Stream a query. *blk and *pos are the cursor (both 0 to start) and
+ * only move past output that was written, so a reader can repeat a call
+ * from a saved cursor. CSV output is "time,avg" (seconds) or
+ * "time,min,avg,max" rows; binary output is each matching block, header
+ * and records as stored, whole, so len must be at least TSDB_BLOCK_SIZE.
+ * Sets *done at the end.
+ */
+size_t tsdb_read(const tsdb_query_t *q, uint32_t *blk, uint32_t *pos,
+                 char *buf, size_t len, bool *done);
+
+/**
+ * Statistics
+ */
+void tsdb_get_series_stats(tsdb_series_t series, tsdb_series_stats_t *out);
+void tsdb_get_stats(tsdb_stats_t *out);
+
+#endif /* TSDB_H */
@@ -0,0 +1,39 @@
+/**
+ * CHRONOS-Rb Unit Secret
+ *
+ * One 256-bit secret per unit, drawn from the hardware RNG at first
+ * boot and kept in the config journal (config_save_secret()). Every
+ * long-term key the unit serves with - the Roughtime long-term key, the
+ * NTS-KE server key, the NTP symmetric key - is SHA-512 of a label and
+ * this secret, so keys survive reboots and OTA updates, differ between
+ * units and depend on nothing that leaves the unit. The secret itself
+ * is never printed; `config reset` keeps it.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef UNIT_SECRET_H
+#define UNIT_SECRET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Generate and store the secret if the loaded config has none (core0,
+ * after config_init(), before timing_core_init() so the flash write
+ * needs no core1 lockout)
+ */
+void unit_secret_init(void);
+
+/**
+ * Derive len bytes (at most 64) of key material for label, a string
+ * naming the key's use. Calls unit_secret_init() if it has not run.
+ */
+void unit_secret_derive(const char *label, uint8_t *out, size_t len);
+
+#endif /* UNIT_SECRET_H */
@@ -0,0 +1,90 @@
+/**
+ * CHRONOS-Rb Warm Start
+ *
+ * Keeps the learned discipline state across reboots and OTA updates.
+ * While the sync state machine is LOCKED, core0 saves the discipline
+ * integrator, its drift and the lock metadata to the config journal
+ * (config_save_warm()). At boot the timing core checks the saved state:
+ * if the FE-5680A reports lock and the state is fresh, it preloads the
+ * integrator and skips FREQ_CAL/COARSE, going straight to FINE.
+ *
+ * A state is fresh when its age, known once GNSS has time, is within
+ * WARM_START_MAX_AGE_S. Without wall time the Rb itself vouches for it:
+ * an FE-5680A needs minutes to lock from cold, so lock within
+ * WARM_START_RB_LOCK_S of boot means it stayed powered while we rebooted.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define WARM_START_SETTLE_S     300     /* Lock held before the first save */
+#define WARM_START_SAVE_S       3600    /* Save interval while locked */
+#define WARM_START_MAX_AGE_S    86400   /* Oldest state used when age is known */
+#define WARM_START_RB_LOCK_S    120     /* Rb lock this soon after boot = warm Rb */
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    bool saved_valid;           /* Flash holds a state */
+    bool restored;              /* This boot started warm */
+    uint32_t restored_age_s;    /* Age of the state used (0 = unknown) */
+    double integral_ppb;        /* Last saved integrator */
+    double drift_ppb_day;       /* Last saved integrator drift */
+    uint32_t saved_unix;
+    uint32_t lock_seconds;      /* Lock duration at last save */
+    uint32_t saves;             /* Saves since boot */
+    uint32_t save_failures;
+} warm_start_stats_t;
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Take the saved state from the loaded config (core0, after
+ * config_init(), before timing_core_init())
+ */
+void warm_start_init(void);
+
+/**
+ * Decide whether to start warm (timing core, from the INIT state).
+ * Returns true and the integrator to preload (ppb) if the saved state
+ * is usable now.
+ */
+bool warm_start_check(bool rb_locked, uint32_t uptime_s, double *integral_ppb);
+
+/**
+ * Save the state periodically while locked (core0 main loop)
+ */
+void warm_start_task(void);
+
+/**
+ * Save the state now if locked (core0, e.g. before a reboot).
+ * Returns false if not locked or the write failed; the previous state
+ * is kept.
+ */
+bool warm_start_save(void);
+
+/**
+ * Forget the saved state so the next boot calibrates from scratch
+ */
+void warm_start_clear(void);
+
+/**
+ * Get warm start status
+ */
+void warm_start_get_stats(warm_start_stats_t *stats);
+
+#endif /* WARM_START_H */
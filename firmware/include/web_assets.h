@@ -0,0 +1,36 @@
+/**
+ * CHRONOS-Rb Embedded Web Assets
+ *
+ * Static pages gzipped at build time by tools/gen_web_assets.py into a
+ * const table in flash. The data is served in place (XIP), so it must
+ * never be copied or modified.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    const char *path;           /* URL path, e.g. "/" or "/config" */
+    const char *content_type;
+    const uint8_t *data;        /* gzip stream */
+    uint32_t len;
+    const char *etag;           /* Quoted strong ETag */
+} web_asset_t;
+
+/*============================================================================
+ * GENERATED TABLE
+ *============================================================================*/
+
+extern const web_asset_t web_assets[];
+extern const int web_asset_count;
+
+#endif /* WEB_ASSETS_H */
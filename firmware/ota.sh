@@ -6,7 +6,6 @@ set -e
 
 FILE="$1"
 HOST="${2:-172.16.13.40}"
-CHUNK_SIZE=1024  # Must be multiple of 256, matches web interface
 
 if [ ! -f "$FILE" ]; then
     echo "Usage: $0 <firmware_fota_image_encrypted.bin> [host]"
@@ -14,10 +13,11 @@ if [ ! -f "$FILE" ]; then
 fi
 
 SIZE=$(stat -c%s "$FILE")
-CHUNKS=$(( (SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE ))
+# CRC32 of the file, from the trailer gzip writes for it
+CRC=$(gzip -c < "$FILE" | tail -c8 | od -An -N4 -tx4 | tr -d ' ')
 
 echo "=== CHRONOS-Rb OTA Update ==="
-echo "File: $FILE ($SIZE bytes, $CHUNKS chunks)"
+echo "File: $FILE ($SIZE bytes, CRC32 $CRC)"
 echo "Host: $HOST"
 echo ""
 
@@ -31,49 +31,15 @@ OLD_VERSION=$(curl -s "http://$HOST/api/status" | grep -o '"version":"[^"]*"' |
 echo "Current version: $OLD_VERSION"
 echo ""
 
-# Begin OTA
-echo "Starting OTA upload..."
-RESP=$(curl -s -X POST "http://$HOST/api/ota/begin" -H "X-OTA-Size: $SIZE")
-if [[ "$RESP" != *"OK"* ]]; then
-    echo "ERROR: Failed to begin OTA: $RESP"
-    exit 1
-fi
-
-# Send chunks
+# Stream the image in one request; the device decompresses and programs
+# it as it arrives and answers once it is validated
 echo "Uploading firmware..."
-OFFSET=0
-CHUNK_NUM=0
-while [ $OFFSET -lt $SIZE ]; do
-    REMAINING=$((SIZE - OFFSET))
-    if [ $REMAINING -lt $CHUNK_SIZE ]; then
-        BYTES=$REMAINING
-    else
-        BYTES=$CHUNK_SIZE
-    fi
-
-    # Extract chunk and send
-    RESP=$(dd if="$FILE" bs=$CHUNK_SIZE skip=$CHUNK_NUM count=1 2>/dev/null | \
-        curl -s -X POST "http://$HOST/api/ota/chunk" \
-        -H "Content-Type: application/octet-stream" \
-        --data-binary @-)
-
-    if [[ "$RESP" != *"OK"* ]]; then
-        echo -e "\nERROR at chunk $CHUNK_NUM: $RESP"
-        exit 1
-    fi
-
-    OFFSET=$((OFFSET + BYTES))
-    CHUNK_NUM=$((CHUNK_NUM + 1))
-    PERCENT=$((OFFSET * 100 / SIZE))
-    printf "\r  Progress: %d/%d bytes (%d%%)" $OFFSET $SIZE $PERCENT
-done
-echo ""
-
-# Finish and validate
-echo "Validating firmware..."
-RESP=$(curl -s -X POST "http://$HOST/api/ota/finish")
+RESP=$(curl -s -X POST "http://$HOST/api/ota/stream" \
+    -H "Content-Type: application/octet-stream" \
+    -H "X-OTA-CRC: $CRC" \
+    --data-binary @"$FILE")
 if [[ "$RESP" != *"OK"* ]]; then
-    echo "ERROR: Validation failed: $RESP"
+    echo "ERROR: Upload failed: $RESP"
     exit 1
 fi
 echo "  Validation OK"
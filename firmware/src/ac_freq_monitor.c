@@ -2,10 +2,17 @@
  * CHRONOS-Rb AC Mains Frequency Monitor
  *
  * Measures local AC mains frequency from zero-crossing detector input.
- * Implements hierarchical averaging:
- *   - Instant: ~1 second rolling average
- *   - Minute history: 60 samples (1 per minute, averaged from 60 seconds)
- *   - Hour history: 48 samples (1 per hour, averaged from 60 minutes)
+ * Crossings are stamped by the PIO edge counter in pps_capture.c (PIO2
+ * SM3, 13.3ns), and each period is corrected from the local crystal to
+ * the rubidium with the 10MHz regression counter. Everything is
+ * accumulated as integer ns and cycles, so long averages do not drift:
+ *   - Per cycle: period and frequency
+ *   - Reports every AC_REPORT_CYCLES cycles: frequency, ROCOF and grid
+ *     time error, kept in a ring for `acfreq report`
+ *   - Instant: rolling average over AC_FREQ_HISTORY_SIZE cycles
+ *   - Per second: mean of the whole cycles, picked up by the time-series
+ *     store (tsdb.c) as its "ac" series, which keeps the minute, hour
+ *     and day rollups the history getters read back
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -16,173 +23,250 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
 
 #include "chronos_rb.h"
 #include "ac_freq_monitor.h"
+#include "perf_trace.h"
+#include "tsdb.h"
 
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
 
+/* Valid cycle length, and the closest two pulses may be */
+#define AC_MIN_PERIOD_NS    (1000000000LL / 65)
+#define AC_MAX_PERIOD_NS    (1000000000LL / 45)
+#define AC_GLITCH_NS        (AC_MIN_PERIOD_NS / AC_FREQ_EDGES_PER_CYCLE / 2)
+
 static ac_freq_state_t ac_state = {0};
 static bool ac_initialized = false;
 
-/* Short-term history for instant average (~1 second) */
-static float freq_history[AC_FREQ_HISTORY_SIZE];
-static uint32_t freq_history_index = 0;
+/* Crystal against the Rb from the regression counter (ppt) */
+static int32_t rb_ppt = 0;
+
+/* Cycle assembly from edges (local ns) */
+static uint64_t last_edge_ns = 0;       /* Last accepted pulse */
+static uint64_t cycle_start_ns = 0;     /* Pulse that opened the cycle, 0 = none */
+static uint32_t cycle_edges = 0;        /* Pulses since cycle_start_ns */
 
-/* Hierarchical averaging accumulators */
-static float second_accum = 0.0f;       /* Accumulator for current second */
-static uint32_t second_count = 0;       /* Samples in current second */
-static float minute_accum = 0.0f;       /* Accumulator for current minute */
-static uint32_t minute_count = 0;       /* Seconds in current minute */
+/* Short-term history for instant average: periods in Rb ns */
+static int32_t period_history[AC_FREQ_HISTORY_SIZE];
+static uint32_t period_history_index = 0;
+static uint32_t period_history_count = 0;
+static int64_t period_history_sum = 0;
 
-/* Minute history (last 60 minutes) */
-static float minute_history[AC_FREQ_MINUTE_HISTORY];
-static uint32_t minute_history_index = 0;
-static uint32_t minute_history_count = 0;  /* Valid samples in buffer */
+/* Second accumulator: whole cycles and their Rb ns */
+static uint32_t second_cycles = 0;
+static int64_t second_ns = 0;
+static uint64_t last_second_ms = 0;
 
-/* Hour history (last 48 hours) */
-static float hour_history[AC_FREQ_HOUR_HISTORY];
-static uint32_t hour_history_index = 0;
-static uint32_t hour_history_count = 0;    /* Valid samples in buffer */
+/* Mean of the last completed second (µHz, 0 = no cycles), read by core0 */
+static volatile uint32_t second_uhz = 0;
 
-/* Hour accumulator */
-static float hour_accum = 0.0f;         /* Accumulator for current hour */
-static uint32_t hour_minute_count = 0;  /* Minutes in current hour */
+/* Grid time: cycles and Rb ns since it (re)started */
+static bool gte_running = false;
+static uint64_t gte_cycles = 0;
+static int64_t gte_ns = 0;
 
-/* Timing for hierarchical rollover */
-static uint32_t last_second_time = 0;
-static uint32_t last_minute_time = 0;
-static uint32_t last_hour_time = 0;
+/* Report window */
+static uint32_t window_cycles = 0;
+static int64_t window_ns = 0;
+static int64_t prev_window_ns = 0;      /* 0 = no previous window for ROCOF */
+static uint32_t prev_window_uhz = 0;
 
-/* Edge timing for frequency calculation */
-static volatile uint32_t last_edge_us = 0;
-static volatile uint32_t edge_period_us = 0;
-static volatile uint32_t edge_count = 0;
+/* Report ring: one writer (timing core), seq counts reports written */
+static ac_grid_report_t reports[AC_REPORT_HISTORY];
+static volatile uint32_t report_seq = 0;
 
 /*============================================================================
- * INTERRUPT HANDLER
+ * PRIVATE FUNCTIONS
  *============================================================================*/
 
 /**
- * AC zero-crossing IRQ handler - called from shared GPIO callback
+ * Mean frequency of whole cycles in µHz
  */
-void ac_zero_cross_irq_handler(void) {
-    uint32_t now = time_us_32();
-
-    /* Calculate period from previous edge */
-    if (last_edge_us != 0) {
-        edge_period_us = now - last_edge_us;
+static uint32_t cycles_to_uhz(uint64_t cycles, int64_t ns) {
+    if (ns <= 0) {
+        return 0;
     }
+    return (uint32_t)((cycles * 1000000000000000ULL + (uint64_t)ns / 2) / (uint64_t)ns);
+}
 
-    last_edge_us = now;
-    edge_count++;
+/**
+ * Time base (time_us_64) nanoseconds to Unix microseconds
+ */
+static uint64_t edge_to_unix_us(uint64_t edge_ns) {
+    timestamp_t ts = timestamp_from_us(edge_ns / 1000);
+    uint32_t unix_sec = ts.seconds - 2208988800UL;  /* Convert NTP to Unix */
+    return (uint64_t)unix_sec * 1000000ULL +
+           (((uint64_t)ts.fraction * 1000000ULL) >> 32);
 }
 
-/*============================================================================
- * PRIVATE FUNCTIONS
- *============================================================================*/
+static void window_reset(void) {
+    window_cycles = 0;
+    window_ns = 0;
+    prev_window_ns = 0;
+}
+
+static void gte_restart(void) {
+    gte_running = ac_state.nominal_hz != 0;
+    gte_cycles = 0;
+    gte_ns = 0;
+    ac_state.grid_time_error_ns = 0;
+    ac_state.grid_time_cycles = 0;
+}
 
 /**
- * Calculate frequency from period
+ * Grid time minus Rb time: cycles at the nominal rate against the Rb ns
+ * they took
  */
-static float period_to_frequency(uint32_t period_us) {
-    if (period_us == 0) {
-        return 0.0f;
+static void gte_add(uint32_t cycles, int64_t ns) {
+    if (!gte_running) {
+        return;
     }
-    float period_sec = (float)period_us / 1000000.0f;
-    return 1.0f / period_sec;
+    gte_cycles += cycles;
+    gte_ns += ns;
+    ac_state.grid_time_error_ns =
+        (int64_t)(gte_cycles * 1000000000ULL / ac_state.nominal_hz) - gte_ns;
+    ac_state.grid_time_cycles = (uint32_t)gte_cycles;
 }
 
 /**
- * Update short-term running average
+ * Close a report window: mean frequency, ROCOF against the previous
+ * window (centre to centre), grid time error
  */
-static void update_instant_average(float new_freq) {
-    freq_history[freq_history_index] = new_freq;
-    freq_history_index = (freq_history_index + 1) % AC_FREQ_HISTORY_SIZE;
-
-    /* Calculate average */
-    float sum = 0.0f;
-    int count = 0;
-    for (int i = 0; i < AC_FREQ_HISTORY_SIZE; i++) {
-        if (freq_history[i] > 0.0f) {
-            sum += freq_history[i];
-            count++;
-        }
+static void window_close(uint64_t edge_ns) {
+    uint32_t uhz = cycles_to_uhz(window_cycles, window_ns);
+    int32_t rocof_mhz_s = 0;
+
+    if (prev_window_ns > 0) {
+        int64_t span_ns = (window_ns + prev_window_ns) / 2;
+        int64_t dif_uhz = (int64_t)uhz - (int64_t)prev_window_uhz;
+        rocof_mhz_s = (int32_t)(dif_uhz * 1000000LL / span_ns);
+    }
+    ac_state.rocof_hz_s = rocof_mhz_s * 1e-3f;
+
+    uint32_t seq = report_seq;
+    ac_grid_report_t *r = &reports[seq % AC_REPORT_HISTORY];
+    r->unix_us = edge_to_unix_us(edge_ns);
+    r->freq_uhz = uhz;
+    r->rocof_mhz_s = rocof_mhz_s;
+    r->grid_time_error_ns = ac_state.grid_time_error_ns;
+    __dmb();
+    report_seq = seq + 1;
+
+    prev_window_ns = window_ns;
+    prev_window_uhz = uhz;
+    window_cycles = 0;
+    window_ns = 0;
+}
+
+/**
+ * One valid cycle of period_ns (Rb time) ending at edge_ns
+ */
+static void cycle_add(int64_t period_ns, uint64_t edge_ns) {
+    uint32_t uhz = cycles_to_uhz(1, period_ns);
+    float freq = uhz * 1e-6f;
+
+    ac_state.frequency_hz = freq;
+    ac_state.period_us = (uint32_t)(period_ns / 1000);
+    ac_state.frequency_valid = true;
+
+    if (ac_state.nominal_hz == 0) {
+        ac_state.nominal_hz = (freq > 55.0f) ? 60 : 50;
+        gte_restart();
+    }
+
+    /* Instant average: running integer sum, exact however long it runs */
+    if (period_history_count == AC_FREQ_HISTORY_SIZE) {
+        period_history_sum -= period_history[period_history_index];
+    } else {
+        period_history_count++;
+    }
+    period_history[period_history_index] = (int32_t)period_ns;
+    period_history_sum += period_ns;
+    period_history_index = (period_history_index + 1) % AC_FREQ_HISTORY_SIZE;
+    ac_state.frequency_avg_hz = cycles_to_uhz(period_history_count, period_history_sum) * 1e-6f;
+
+    /* Update min/max tracking */
+    if (freq < ac_state.frequency_min_hz) {
+        ac_state.frequency_min_hz = freq;
+    }
+    if (freq > ac_state.frequency_max_hz) {
+        ac_state.frequency_max_hz = freq;
     }
 
-    if (count > 0) {
-        ac_state.frequency_avg_hz = sum / (float)count;
+    second_cycles++;
+    second_ns += period_ns;
+    gte_add(1, period_ns);
+
+    window_cycles++;
+    window_ns += period_ns;
+    if (window_cycles >= AC_REPORT_CYCLES) {
+        window_close(edge_ns);
     }
 }
 
 /**
- * Process hierarchical averaging
- * Called with each valid frequency measurement
+ * One detector pulse (local ns)
  */
-static void update_hierarchical(float freq, uint32_t now_ms) {
-    /* Accumulate for second average */
-    second_accum += freq;
-    second_count++;
-
-    /* Check for second rollover (every 1000ms) */
-    if (now_ms - last_second_time >= 1000) {
-        if (second_count > 0) {
-            float sec_avg = second_accum / (float)second_count;
-
-            /* Add to minute accumulator */
-            minute_accum += sec_avg;
-            minute_count++;
-        }
+static void edge_add(uint64_t edge_ns) {
+    if (last_edge_ns != 0 && edge_ns - last_edge_ns < AC_GLITCH_NS) {
+        ac_state.glitches++;
+        return;
+    }
+    last_edge_ns = edge_ns;
+    ac_state.zero_cross_count++;
+    ac_state.last_edge_time_us = (uint32_t)(edge_ns / 1000);
 
-        /* Reset second accumulator */
-        second_accum = 0.0f;
-        second_count = 0;
-        last_second_time = now_ms;
+    if (cycle_start_ns == 0) {
+        cycle_start_ns = edge_ns;
+        cycle_edges = 0;
+        return;
+    }
+    if (++cycle_edges < AC_FREQ_EDGES_PER_CYCLE) {
+        return;
     }
 
-    /* Check for minute rollover (every 60 seconds) */
-    if (now_ms - last_minute_time >= 60000) {
-        if (minute_count > 0) {
-            float min_avg = minute_accum / (float)minute_count;
-
-            /* Store in minute history */
-            minute_history[minute_history_index] = min_avg;
-            minute_history_index = (minute_history_index + 1) % AC_FREQ_MINUTE_HISTORY;
-            if (minute_history_count < AC_FREQ_MINUTE_HISTORY) {
-                minute_history_count++;
-            }
-
-            /* Add to hour accumulator */
-            hour_accum += min_avg;
-            hour_minute_count++;
-        }
+    /* Local crystal to Rb time */
+    int64_t local_ns = (int64_t)(edge_ns - cycle_start_ns);
+    int64_t period_ns = local_ns - local_ns * rb_ppt / 1000000000000LL;
+    cycle_start_ns = edge_ns;
+    cycle_edges = 0;
 
-        /* Reset minute accumulator */
-        minute_accum = 0.0f;
-        minute_count = 0;
-        last_minute_time = now_ms;
+    if (period_ns >= AC_MIN_PERIOD_NS && period_ns <= AC_MAX_PERIOD_NS) {
+        cycle_add(period_ns, edge_ns);
+        return;
     }
 
-    /* Check for hour rollover (every 60 minutes) */
-    if (now_ms - last_hour_time >= 3600000) {
-        if (hour_minute_count > 0) {
-            float hour_avg = hour_accum / (float)hour_minute_count;
-
-            /* Store in hour history */
-            hour_history[hour_history_index] = hour_avg;
-            hour_history_index = (hour_history_index + 1) % AC_FREQ_HOUR_HISTORY;
-            if (hour_history_count < AC_FREQ_HOUR_HISTORY) {
-                hour_history_count++;
-            }
+    /* Out of range: a dropout of whole cycles keeps grid time running if
+     * short enough to count them, anything else restarts it */
+    ac_state.frequency_valid = false;
+    window_reset();
+    if (gte_running && period_ns > AC_MAX_PERIOD_NS) {
+        int64_t nominal_ns = 1000000000LL / ac_state.nominal_hz;
+        int64_t k = (period_ns + nominal_ns / 2) / nominal_ns;
+        if (k <= AC_GTE_MAX_GAP_CYCLES) {
+            gte_add((uint32_t)k, period_ns);
+            ac_state.missed_cycles += (uint32_t)k - 1;
+            return;
         }
+    }
+    gte_restart();
+}
 
-        /* Reset hour accumulator */
-        hour_accum = 0.0f;
-        hour_minute_count = 0;
-        last_hour_time = now_ms;
+/**
+ * Publish the second's mean frequency and restart the accumulator
+ */
+static void update_second(uint64_t now_ms) {
+    if (now_ms - last_second_ms < 1000) {
+        return;
     }
+    second_uhz = (second_cycles > 0) ? cycles_to_uhz(second_cycles, second_ns) : 0;
+    second_cycles = 0;
+    second_ns = 0;
+    last_second_ms = now_ms;
 }
 
 /*============================================================================
@@ -195,30 +279,24 @@ static void update_hierarchical(float freq, uint32_t now_ms) {
 void ac_freq_init(void) {
     /* Initialize state */
     memset(&ac_state, 0, sizeof(ac_state));
-    memset(freq_history, 0, sizeof(freq_history));
-    memset(minute_history, 0, sizeof(minute_history));
-    memset(hour_history, 0, sizeof(hour_history));
+    memset(period_history, 0, sizeof(period_history));
     ac_state.frequency_min_hz = 999.0f;
     ac_state.frequency_max_hz = 0.0f;
 
     /* Initialize timing */
-    uint32_t now = time_us_32() / 1000;
-    last_second_time = now;
-    last_minute_time = now;
-    last_hour_time = now;
+    last_second_ms = time_us_64() / 1000;
 
-    /* Configure GPIO for zero-crossing input */
+    /* Configure GPIO for zero-crossing input. The detector pulls low at
+     * the crossing; inverted, the PIO counter stamps that falling edge. */
     gpio_init(GPIO_AC_ZERO_CROSS);
     gpio_set_dir(GPIO_AC_ZERO_CROSS, GPIO_IN);
     gpio_pull_up(GPIO_AC_ZERO_CROSS);
-
-    /* Enable interrupt on falling edge */
-    gpio_set_irq_enabled(GPIO_AC_ZERO_CROSS, GPIO_IRQ_EDGE_FALL, true);
+    gpio_set_inover(GPIO_AC_ZERO_CROSS, GPIO_OVERRIDE_INVERT);
 
     ac_initialized = true;
     printf("[AC_FREQ] AC frequency monitor initialized on GP%d\n", GPIO_AC_ZERO_CROSS);
-    printf("[AC_FREQ] History: %d min + %d hour samples\n",
-           AC_FREQ_MINUTE_HISTORY, AC_FREQ_HOUR_HISTORY);
+    printf("[AC_FREQ] Reports every %d cycles, history in the time-series store\n",
+           AC_REPORT_CYCLES);
 }
 
 /**
@@ -229,53 +307,36 @@ void ac_freq_task(void) {
         return;
     }
 
-    uint32_t now = time_us_32();
-    uint32_t now_ms = now / 1000;
+    uint64_t now_us = time_us_64();
 
-    /* Copy volatile values atomically */
-    uint32_t period = edge_period_us;
-    uint32_t last_edge = last_edge_us;
-    uint32_t count = edge_count;
+    /* Periods go to Rb time once the regression counter has a gate */
+    freq_regression_t reg;
+    freq_counter_get_regression(&reg);
+    ac_state.rb_referenced = reg.valid;
+    rb_ppt = reg.valid ? (int32_t)(reg.local_ppb * 1000.0) : 0;
 
-    /* Check for signal timeout */
-    if (last_edge != 0 && (now - last_edge) > (AC_FREQ_TIMEOUT_MS * 1000)) {
-        ac_state.signal_present = false;
-        ac_state.frequency_valid = false;
-        ac_state.frequency_hz = 0.0f;
-        return;
+    PERF_BEGIN(PERF_AC_CYCLES);
+    uint64_t edges[8];
+    int n;
+    while ((n = pps_capture_take_ac_edges_ns(edges, 8)) > 0) {
+        for (int i = 0; i < n; i++) {
+            edge_add(edges[i]);
+        }
     }
+    PERF_END(PERF_AC_CYCLES);
+
+    update_second(now_us / 1000);
 
-    /* Check if we have valid measurements */
-    if (period == 0 || last_edge == 0) {
+    /* Check for signal timeout. The open cycle is kept, so a short
+     * dropout is bridged when the pulses return. */
+    if (last_edge_ns == 0 ||
+        now_us - last_edge_ns / 1000 > (AC_FREQ_TIMEOUT_MS * 1000)) {
         ac_state.signal_present = false;
+        ac_state.frequency_valid = false;
+        ac_state.frequency_hz = 0.0f;
         return;
     }
-
     ac_state.signal_present = true;
-    ac_state.zero_cross_count = count;
-    ac_state.last_edge_time_us = last_edge;
-    ac_state.period_us = period;
-
-    /* Calculate frequency */
-    float freq = period_to_frequency(period);
-    ac_state.frequency_hz = freq;
-
-    /* Validate frequency range */
-    if (freq >= AC_FREQ_MIN_HZ && freq <= AC_FREQ_MAX_HZ) {
-        ac_state.frequency_valid = true;
-        update_instant_average(freq);
-        update_hierarchical(freq, now_ms);
-
-        /* Update min/max tracking */
-        if (freq < ac_state.frequency_min_hz) {
-            ac_state.frequency_min_hz = freq;
-        }
-        if (freq > ac_state.frequency_max_hz) {
-            ac_state.frequency_max_hz = freq;
-        }
-    } else {
-        ac_state.frequency_valid = false;
-    }
 }
 
 /**
@@ -320,65 +381,70 @@ const ac_freq_state_t* ac_freq_get_state(void) {
 }
 
 /**
- * Get minute history (oldest first)
+ * Mean of the last completed second in µHz, 0 without cycles
  */
-int ac_freq_get_minute_history(float *buf, int max_samples) {
-    if (minute_history_count == 0) {
-        return 0;
-    }
-
-    int count = (minute_history_count < max_samples) ? minute_history_count : max_samples;
-    int start;
+uint32_t ac_freq_get_second_uhz(void) {
+    return second_uhz;
+}
 
-    if (minute_history_count < AC_FREQ_MINUTE_HISTORY) {
-        /* Buffer not full yet, start from 0 */
-        start = 0;
-    } else {
-        /* Buffer full, oldest is at current index */
-        start = minute_history_index;
-    }
+/**
+ * Newest averages of a store tier in Hz (oldest first). Called from the
+ * web server's callbacks only, which never run concurrently.
+ */
+static int history_hz(tsdb_tier_t tier, float *buf, int max_samples) {
+    static tsdb_point_t points[AC_FREQ_MINUTE_HISTORY > AC_FREQ_HOUR_HISTORY ?
+                               AC_FREQ_MINUTE_HISTORY : AC_FREQ_HOUR_HISTORY];
+    int max = (int)(sizeof(points) / sizeof(points[0]));
+    int count = tsdb_recent(TSDB_AC_FREQ, tier, points,
+                            (max_samples < max) ? max_samples : max);
 
     for (int i = 0; i < count; i++) {
-        int idx = (start + i) % AC_FREQ_MINUTE_HISTORY;
-        buf[i] = minute_history[idx];
+        buf[i] = points[i].avg * 1e-6f;
     }
-
     return count;
 }
 
+/**
+ * Get minute history (oldest first)
+ */
+int ac_freq_get_minute_history(float *buf, int max_samples) {
+    return history_hz(TSDB_TIER_MIN, buf, max_samples);
+}
+
 /**
  * Get hour history (oldest first)
  */
 int ac_freq_get_hour_history(float *buf, int max_samples) {
-    if (hour_history_count == 0) {
-        return 0;
-    }
-
-    int count = (hour_history_count < max_samples) ? hour_history_count : max_samples;
-    int start;
-
-    if (hour_history_count < AC_FREQ_HOUR_HISTORY) {
-        /* Buffer not full yet, start from 0 */
-        start = 0;
-    } else {
-        /* Buffer full, oldest is at current index */
-        start = hour_history_index;
-    }
+    return history_hz(TSDB_TIER_HOUR, buf, max_samples);
+}
 
-    for (int i = 0; i < count; i++) {
-        int idx = (start + i) % AC_FREQ_HOUR_HISTORY;
-        buf[i] = hour_history[idx];
-    }
+/**
+ * Get accumulator status for diagnostics: cycles in the current second
+ */
+void ac_freq_get_accum_status(uint32_t *sec_count_out) {
+    if (sec_count_out) *sec_count_out = second_cycles;
+}
 
-    return count;
+/**
+ * Number of grid reports written since boot
+ */
+uint32_t ac_freq_report_count(void) {
+    return report_seq;
 }
 
 /**
- * Get accumulator status for diagnostics
+ * Copy one report. The slot is re-checked after the copy, so a report
+ * overwritten meanwhile is refused rather than returned torn.
  */
-void ac_freq_get_accum_status(uint32_t *sec_count_out, uint32_t *min_count_out) {
-    if (sec_count_out) *sec_count_out = second_count;
-    if (min_count_out) *min_count_out = minute_count;
+bool ac_freq_get_report(uint32_t seq, ac_grid_report_t *out) {
+    uint32_t written = report_seq;
+    if (seq >= written || written - seq >= AC_REPORT_HISTORY) {
+        return false;
+    }
+    __dmb();
+    *out = reports[seq % AC_REPORT_HISTORY];
+    __dmb();
+    return report_seq - seq < AC_REPORT_HISTORY;
 }
 
 /**
@@ -397,14 +463,22 @@ void ac_freq_print_status(void) {
             printf("  Min:         %.3f Hz\n", ac_state.frequency_min_hz);
             printf("  Max:         %.3f Hz\n", ac_state.frequency_max_hz);
 
-            float nominal = (ac_state.frequency_avg_hz > 55.0f) ? 60.0f : 50.0f;
+            float nominal = (float)ac_state.nominal_hz;
             float deviation = ac_state.frequency_avg_hz - nominal;
             printf("  Deviation:   %+.3f Hz from %.0f Hz nominal\n", deviation, nominal);
+            printf("  ROCOF:       %+.3f Hz/s\n", ac_state.rocof_hz_s);
         }
 
-        printf("  Crossings:   %lu\n", ac_state.zero_cross_count);
-        printf("  History:     %u min, %u hour samples\n",
-               minute_history_count, hour_history_count);
+        printf("  Grid time:   %+.3f s over %lu cycles\n",
+               ac_state.grid_time_error_ns * 1e-9, ac_state.grid_time_cycles);
+        printf("  Reference:   %s\n", ac_state.rb_referenced ?
+               "Rb 10MHz" : "local crystal (no regression gate)");
+        printf("  Crossings:   %lu (%lu glitches, %lu cycles bridged)\n",
+               ac_state.zero_cross_count, ac_state.glitches, ac_state.missed_cycles);
+        tsdb_series_stats_t hist;
+        tsdb_get_series_stats(TSDB_AC_FREQ, &hist);
+        printf("  History:     %lu min, %lu hour samples (see 'history')\n",
+               hist.records[TSDB_TIER_MIN], hist.records[TSDB_TIER_HOUR]);
     }
     printf("\n");
 }
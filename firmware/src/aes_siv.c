@@ -0,0 +1,246 @@
+/**
+ * CHRONOS-Rb AES-SIV-CMAC-256
+ *
+ * Only single-block AES-ECB encryption is taken from mbedtls; CMAC, S2V
+ * and CTR are built on it here, so nothing depends on which cipher
+ * modes the bootloader's mbedtls configuration enables.
+ *
+ * S2V over (AD, nonce, plaintext):
+ *   D = CMAC(<zero>), D = dbl(D) ^ CMAC(AD), D = dbl(D) ^ CMAC(nonce)
+ *   V = CMAC(P xorend D) if |P| >= 16, else CMAC(dbl(D) ^ pad(P))
+ * then C = P ^ CTR(K2, V with bits 31 and 63 cleared).
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+
+#include "aes_siv.h"
+
+/*============================================================================
+ * BLOCK HELPERS
+ *============================================================================*/
+
+#define BLOCK   16
+
+static void block_encrypt(const mbedtls_aes_context *ctx, const uint8_t in[BLOCK],
+                          uint8_t out[BLOCK]) {
+    mbedtls_aes_crypt_ecb((mbedtls_aes_context *)ctx, MBEDTLS_AES_ENCRYPT, in, out);
+}
+
+static void block_xor(uint8_t *d, const uint8_t *s, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        d[i] ^= s[i];
+    }
+}
+
+/* Multiply by x in GF(2^128) */
+static void block_dbl(uint8_t b[BLOCK]) {
+    uint8_t carry = b[0] >> 7;
+    for (int i = 0; i < BLOCK - 1; i++) {
+        b[i] = (uint8_t)((b[i] << 1) | (b[i + 1] >> 7));
+    }
+    b[BLOCK - 1] = (uint8_t)((b[BLOCK - 1] << 1) ^ (carry ? 0x87 : 0));
+}
+
+/*============================================================================
+ * CMAC
+ *============================================================================*/
+
+typedef struct {
+    uint8_t x[BLOCK];           /* Chaining value */
+    uint8_t buf[BLOCK];         /* Last, possibly partial, block */
+    size_t fill;
+} cmac_t;
+
+static void cmac_start(cmac_t *c) {
+    memset(c, 0, sizeof(cmac_t));
+}
+
+static void cmac_update(cmac_t *c, const aes_siv_key_t *key,
+                        const uint8_t *data, size_t len) {
+    while (len > 0) {
+        /* Hold back a full block: it may be the last one */
+        if (c->fill == BLOCK) {
+            block_xor(c->x, c->buf, BLOCK);
+            block_encrypt(&key->mac, c->x, c->x);
+            c->fill = 0;
+        }
+        size_t take = BLOCK - c->fill;
+        if (take > len) take = len;
+        memcpy(c->buf + c->fill, data, take);
+        c->fill += take;
+        data += take;
+        len -= take;
+    }
+}
+
+static void cmac_finish(cmac_t *c, const aes_siv_key_t *key, uint8_t out[BLOCK]) {
+    if (c->fill == BLOCK) {
+        block_xor(c->buf, key->sub1, BLOCK);
+    } else {
+        c->buf[c->fill] = 0x80;
+        memset(c->buf + c->fill + 1, 0, BLOCK - c->fill - 1);
+        block_xor(c->buf, key->sub2, BLOCK);
+    }
+    block_xor(c->x, c->buf, BLOCK);
+    block_encrypt(&key->mac, c->x, out);
+}
+
+static void cmac(const aes_siv_key_t *key, const uint8_t *data, size_t len,
+                 uint8_t out[BLOCK]) {
+    cmac_t c;
+    cmac_start(&c);
+    cmac_update(&c, key, data, len);
+    cmac_finish(&c, key, out);
+}
+
+/*============================================================================
+ * SIV
+ *============================================================================*/
+
+static void s2v(const aes_siv_key_t *key,
+                const uint8_t *ad, size_t ad_len,
+                const uint8_t *nonce, size_t nonce_len,
+                const uint8_t *pt, size_t len, uint8_t v[BLOCK]) {
+    static const uint8_t zero[BLOCK] = {0};
+    uint8_t d[BLOCK], t[BLOCK];
+    cmac_t c;
+
+    cmac(key, zero, BLOCK, d);
+
+    block_dbl(d);
+    cmac(key, ad, ad_len, t);
+    block_xor(d, t, BLOCK);
+
+    block_dbl(d);
+    cmac(key, nonce, nonce_len, t);
+    block_xor(d, t, BLOCK);
+
+    cmac_start(&c);
+    if (len >= BLOCK) {
+        /* P xorend D: only the last 16 bytes change */
+        cmac_update(&c, key, pt, len - BLOCK);
+        memcpy(t, pt + len - BLOCK, BLOCK);
+        block_xor(t, d, BLOCK);
+        cmac_update(&c, key, t, BLOCK);
+    } else {
+        block_dbl(d);
+        memset(t, 0, BLOCK);
+        memcpy(t, pt, len);
+        t[len] = 0x80;
+        block_xor(t, d, BLOCK);
+        cmac_update(&c, key, t, BLOCK);
+    }
+    cmac_finish(&c, key, v);
+}
+
+static void siv_ctr(const aes_siv_key_t *key, const uint8_t v[BLOCK],
+                    const uint8_t *in, size_t len, uint8_t *out) {
+    uint8_t ctr[BLOCK], ks[BLOCK];
+
+    memcpy(ctr, v, BLOCK);
+    ctr[8] &= 0x7f;
+    ctr[12] &= 0x7f;
+
+    while (len > 0) {
+        size_t n = len < BLOCK ? len : BLOCK;
+        block_encrypt(&key->ctr, ctr, ks);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = in[i] ^ ks[i];
+        }
+        in += n;
+        out += n;
+        len -= n;
+
+        for (int i = BLOCK - 1; i >= 0 && ++ctr[i] == 0; i--) {
+        }
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/* CMAC subkeys: L = E(0), K1 = dbl(L), K2 = dbl(K1) */
+static void cmac_subkeys(aes_siv_key_t *key) {
+    static const uint8_t zero[BLOCK] = {0};
+
+    block_encrypt(&key->mac, zero, key->sub1);
+    block_dbl(key->sub1);
+    memcpy(key->sub2, key->sub1, BLOCK);
+    block_dbl(key->sub2);
+}
+
+bool aes_siv_setkey(aes_siv_key_t *key, const uint8_t raw[AES_SIV_KEY_SIZE]) {
+    mbedtls_aes_init(&key->mac);
+    mbedtls_aes_init(&key->ctr);
+    if (mbedtls_aes_setkey_enc(&key->mac, raw, 128) != 0 ||
+        mbedtls_aes_setkey_enc(&key->ctr, raw + BLOCK, 128) != 0) {
+        aes_siv_free(key);
+        return false;
+    }
+
+    cmac_subkeys(key);
+    return true;
+}
+
+bool aes_cmac_setkey(aes_siv_key_t *key, const uint8_t raw[AES_CMAC_KEY_SIZE]) {
+    mbedtls_aes_init(&key->mac);
+    mbedtls_aes_init(&key->ctr);
+    if (mbedtls_aes_setkey_enc(&key->mac, raw, 128) != 0) {
+        aes_siv_free(key);
+        return false;
+    }
+
+    cmac_subkeys(key);
+    return true;
+}
+
+void aes_cmac(const aes_siv_key_t *key, const uint8_t *data, size_t len,
+              uint8_t out[AES_SIV_TAG_SIZE]) {
+    cmac(key, data, len, out);
+}
+
+void aes_siv_free(aes_siv_key_t *key) {
+    mbedtls_aes_free(&key->mac);
+    mbedtls_aes_free(&key->ctr);
+    memset(key, 0, sizeof(aes_siv_key_t));
+}
+
+void aes_siv_seal(const aes_siv_key_t *key,
+                  const uint8_t *ad, size_t ad_len,
+                  const uint8_t *nonce, size_t nonce_len,
+                  const uint8_t *pt, size_t len, uint8_t *out) {
+    uint8_t v[BLOCK];
+
+    s2v(key, ad, ad_len, nonce, nonce_len, pt, len, v);
+    siv_ctr(key, v, pt, len, out + BLOCK);
+    memcpy(out, v, BLOCK);
+}
+
+bool aes_siv_open(const aes_siv_key_t *key,
+                  const uint8_t *ad, size_t ad_len,
+                  const uint8_t *nonce, size_t nonce_len,
+                  const uint8_t *in, size_t in_len, uint8_t *pt) {
+    uint8_t v[BLOCK];
+    uint8_t diff = 0;
+
+    if (in_len < BLOCK) {
+        return false;
+    }
+    size_t len = in_len - BLOCK;
+
+    siv_ctr(key, in, in + BLOCK, len, pt);
+    s2v(key, ad, ad_len, nonce, nonce_len, pt, len, v);
+
+    for (int i = 0; i < BLOCK; i++) {
+        diff |= v[i] ^ in[i];
+    }
+    if (diff != 0) {
+        memset(pt, 0, len);
+        return false;
+    }
+    return true;
+}
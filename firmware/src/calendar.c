@@ -0,0 +1,266 @@
+/**
+ * CHRONOS-Rb Calendar
+ *
+ * Cached broken-down UTC time, advanced one second per PPS. See
+ * calendar.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "chronos_rb.h"
+#include "calendar.h"
+#include "gnss_input.h"
+#include "sched.h"
+#include "timing_core.h"
+
+/*============================================================================
+ * CONSTANTS
+ *============================================================================*/
+
+#define NTP_UNIX_OFFSET     2208988800UL
+#define SECS_PER_DAY        86400u
+
+/* Days 1970-01-01 is after 0000-03-01 in the proleptic Gregorian calendar */
+#define CIVIL_EPOCH_DAYS    719468u
+
+static const uint8_t month_days[12] = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+/* Days before each month in a common year */
+static const uint16_t month_yday[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+/* Written by the timing core only; readers elsewhere copy under the lock */
+static seqlock_t cache_lock;
+static calendar_t cache_now;
+static calendar_t cache_next;
+
+/*============================================================================
+ * CALENDAR ARITHMETIC
+ *============================================================================*/
+
+static inline bool is_leap_year(uint32_t y) {
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+static inline uint8_t days_in_month(const calendar_t *c) {
+    return (c->month == 2 && c->leap_year) ? 29 : month_days[c->month - 1];
+}
+
+/**
+ * Day of year of the nth Sunday (n >= 1) on or after a day of year,
+ * given the weekday of a reference day of year
+ */
+static uint16_t nth_sunday(uint16_t from_yday, int n, uint16_t ref_yday, uint8_t ref_wday) {
+    int wday = ((int)ref_wday + (int)from_yday - (int)ref_yday) % 7;
+    if (wday < 0) {
+        wday += 7;
+    }
+    return (uint16_t)(from_yday + (7 - wday) % 7 + 7 * (n - 1));
+}
+
+/**
+ * US DST flags for the day: in effect from the second Sunday in March to
+ * the first Sunday in November (the change itself is at 02:00 local, so
+ * it is in effect at 24:00 UTC of the first and 00:00 UTC of the last)
+ */
+static void calendar_set_dst(calendar_t *c) {
+    uint16_t leap = c->leap_year ? 1 : 0;
+    uint16_t start = nth_sunday(month_yday[2] + leap + 1, 2, c->yday, c->wday);
+    uint16_t end = nth_sunday(month_yday[10] + leap + 1, 1, c->yday, c->wday);
+
+    c->dst_us_at_24h = c->yday >= start && c->yday < end;
+    c->dst_us_at_0h = c->yday > start && c->yday <= end;
+}
+
+/**
+ * Leap second and TAI offset from the GNSS. A leap is pending from the
+ * start of the UTC month it ends up to the second it comes before, so a
+ * frame labelled with that second still carries the warning.
+ */
+static void calendar_set_leap(calendar_t *c) {
+    int8_t change;
+    uint32_t event_unix;
+
+    c->leap_pending = 0;
+    c->leap_ntp = 0;
+    if (gnss_get_leap_event(&change, &event_unix)) {
+        uint32_t event_ntp = event_unix + NTP_UNIX_OFFSET;
+        uint32_t sod = (uint32_t)c->hour * 3600 + (uint32_t)c->minute * 60 + c->second;
+        uint32_t month_left = (uint32_t)(days_in_month(c) - c->day) * SECS_PER_DAY +
+                              (SECS_PER_DAY - sod);
+        if (event_ntp >= c->ntp_secs && event_ntp - c->ntp_secs <= month_left) {
+            c->leap_pending = change;
+            c->leap_ntp = event_ntp;
+        }
+    }
+
+    c->tai_utc = gnss_leap_seconds_is_valid() ?
+                 (int16_t)(gnss_get_leap_seconds() + CALENDAR_GPS_TAI_S) : 0;
+}
+
+void calendar_from_ntp(uint32_t ntp_secs, calendar_t *out) {
+    uint32_t unix_time = (ntp_secs >= NTP_UNIX_OFFSET) ? ntp_secs - NTP_UNIX_OFFSET : 0;
+    uint32_t days = unix_time / SECS_PER_DAY;
+    uint32_t sod = unix_time % SECS_PER_DAY;
+
+    memset(out, 0, sizeof(*out));
+    out->ntp_secs = ntp_secs;
+    out->hour = (uint8_t)(sod / 3600);
+    out->minute = (uint8_t)((sod % 3600) / 60);
+    out->second = (uint8_t)(sod % 60);
+    out->wday = (uint8_t)((days + 4) % 7);  /* 1970-01-01 was a Thursday */
+
+    /* Days to civil date over 400-year eras, years starting in March */
+    uint32_t z = days + CIVIL_EPOCH_DAYS;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t month = (mp < 10) ? mp + 3 : mp - 9;
+    uint32_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    out->year = (uint16_t)year;
+    out->month = (uint8_t)month;
+    out->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    out->leap_year = is_leap_year(year);
+    out->yday = (uint16_t)(month_yday[month - 1] + out->day +
+                           ((out->leap_year && month > 2) ? 1 : 0));
+
+    calendar_set_dst(out);
+    calendar_set_leap(out);
+}
+
+void calendar_step(calendar_t *c) {
+    c->ntp_secs++;
+
+    if (++c->second < 60) {
+        goto leap;
+    }
+    c->second = 0;
+    if (++c->minute < 60) {
+        goto leap;
+    }
+    c->minute = 0;
+    if (++c->hour < 24) {
+        goto leap;
+    }
+    c->hour = 0;
+
+    /* New day */
+    c->wday = (uint8_t)((c->wday + 1) % 7);
+    c->yday++;
+    if (++c->day > days_in_month(c)) {
+        c->day = 1;
+        if (++c->month > 12) {
+            c->month = 1;
+            c->year++;
+            c->yday = 1;
+            c->leap_year = is_leap_year(c->year);
+        }
+    }
+    calendar_set_dst(c);
+
+leap:
+    calendar_set_leap(c);
+}
+
+uint32_t calendar_to_ntp(int year, int month, int day, int hour, int minute, int second) {
+    /* Civil date to days, inverse of calendar_from_ntp() */
+    uint32_t y = (uint32_t)year - (month <= 2 ? 1 : 0);
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t mp = (uint32_t)(month > 2 ? month - 3 : month + 9);
+    uint32_t doy = (153 * mp + 2) / 5 + (uint32_t)day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = era * 146097 + doe - CIVIL_EPOCH_DAYS;
+
+    return NTP_UNIX_OFFSET + days * SECS_PER_DAY +
+           (uint32_t)hour * 3600 + (uint32_t)minute * 60 + (uint32_t)second;
+}
+
+/*============================================================================
+ * CACHE
+ *============================================================================*/
+
+/**
+ * Replace the cached pair (timing core). Local IRQs are masked as the
+ * seqlock requires.
+ */
+static void cache_store(const calendar_t *now) {
+    calendar_t next = *now;
+    calendar_step(&next);
+
+    uint32_t irq = save_and_disable_interrupts();
+    seqlock_write_begin(&cache_lock);
+    cache_now = *now;
+    cache_next = next;
+    seqlock_write_end(&cache_lock);
+    restore_interrupts(irq);
+}
+
+void calendar_init(void) {
+    calendar_t now;
+    calendar_from_ntp(get_current_time().seconds, &now);
+    cache_store(&now);
+}
+
+void calendar_task(void) {
+    uint32_t secs = get_current_time().seconds;
+    if (secs == cache_now.ntp_secs) {
+        return;
+    }
+
+    if (secs == cache_next.ntp_secs) {
+        /* The usual case: one edge, one second */
+        calendar_t now = cache_next;
+        cache_store(&now);
+    } else {
+        /* Time stepped, or a second was missed */
+        calendar_t now;
+        calendar_from_ntp(secs, &now);
+        cache_store(&now);
+    }
+
+    sched_post(SCHED_EV_SECOND);
+}
+
+const calendar_t *calendar_now(void) {
+    return &cache_now;
+}
+
+const calendar_t *calendar_next(void) {
+    return &cache_next;
+}
+
+void calendar_at(uint32_t ntp_secs, calendar_t *out) {
+    uint32_t seq;
+    bool hit;
+    do {
+        seq = seqlock_read_begin(&cache_lock);
+        hit = true;
+        if (cache_now.ntp_secs == ntp_secs) {
+            *out = cache_now;
+        } else if (cache_next.ntp_secs == ntp_secs) {
+            *out = cache_next;
+        } else {
+            hit = false;
+        }
+    } while (seqlock_read_retry(&cache_lock, seq));
+
+    if (!hit) {
+        calendar_from_ntp(ntp_secs, out);
+    }
+}
@@ -11,6 +11,14 @@
  *   wifi <SSID> <PWD> - Set WiFi (quote args with spaces)
  *   pulse ...         - Configure GPIO pulse outputs
  *
+ * Commands that run for longer than one call (watch, acfreq report, sync,
+ * log dump) are jobs: the command prints its header and registers a step
+ * function, which cli_task() calls again each time it asks to be, so the
+ * other core0 tasks keep running in between. One job runs at a time. On
+ * the console Ctrl+C stops it; for the web its output goes to a ring the
+ * web server streams from while the job is still going, and the job
+ * waits when the reader falls behind.
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
@@ -20,10 +28,13 @@
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <math.h>
 #include "pico/stdlib.h"
 #include "pico/bootrom.h"
 #include "pico/cyw43_arch.h"
+#include "lwip/ip4_addr.h"
 #include "hardware/watchdog.h"
+#include "hardware/clocks.h"
 
 #include "chronos_rb.h"
 #include "cli.h"
@@ -32,7 +43,23 @@
 #include "config.h"
 #include "radio_timecode.h"
 #include "nmea_output.h"
+#include "irig_b.h"
 #include "gnss_input.h"
+#include "timing_core.h"
+#include "net_timestamp.h"
+#include "stability.h"
+#include "perf_trace.h"
+#include "sched.h"
+#include "log_buffer.h"
+#include "metrics.h"
+#include "nts.h"
+#include "nts_ke.h"
+#include "warm_start.h"
+#include "clock_model.h"
+#include "load_bench.h"
+#include "tsdb.h"
+#include "jitter_stats.h"
+#include "eth_w5500.h"
 
 /*============================================================================
  * CONFIGURATION
@@ -42,6 +69,13 @@
 #define CLI_MAX_ARGS        8
 #define CLI_PROMPT          "chronos> "
 
+#define CLI_LINE_MAX        256     /* Longest single cli_printf() */
+#define CLI_STREAM_SIZE     4096    /* Web output ring */
+#define CLI_JOB_ROOM        1024    /* Ring space a web job step needs */
+#define CLI_JOB_RETRY_US    20000   /* Step delay while the reader catches up */
+#define CLI_JOB_DONE        UINT32_MAX
+#define CLI_LOG_LINES       8       /* Log dump records per step */
+
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -50,31 +84,73 @@ static char cli_buffer[CLI_BUFFER_SIZE];
 static uint32_t cli_buffer_pos = 0;
 static bool cli_initialized = false;
 
-/* Output buffer for web CLI (NULL = use printf) */
-static char *cli_out_buf = NULL;
-static size_t cli_out_len = 0;
-static int cli_out_pos = 0;
+/* Web output. Read from absolute positions so the web server can
+ * produce again what a failed tcp_write dropped; space is reclaimed up
+ * to the position it has released. */
+static struct {
+    char buf[CLI_STREAM_SIZE];
+    uint32_t head;              /* Bytes written since the command started */
+    uint32_t released;          /* Reader is done with everything before */
+    bool open;                  /* A web command owns the stream */
+} cli_stream;
+
+static bool cli_to_stream = false;  /* cli_printf() goes to the stream */
+
+/* A command still running. step() prints what is new and returns the
+ * delay to its next call in us, or CLI_JOB_DONE. */
+typedef struct cli_job cli_job_t;
+typedef uint32_t (*cli_step_fn)(cli_job_t *job);
+
+struct cli_job {
+    cli_step_fn step;           /* NULL = no job */
+    const char *name;
+    bool web;                   /* Output goes to the stream */
+    uint32_t due_us;            /* Next step (time_us_32) */
+    uint64_t end_us;            /* Timed commands */
+    uint32_t seq;               /* Command cursor: report, record, line */
+    uint32_t limit;
+    uint32_t last;
+};
+
+static cli_job_t cli_job;
 
 /*============================================================================
  * OUTPUT FUNCTIONS
  *============================================================================*/
 
 /**
- * CLI printf - outputs to buffer if set, otherwise to stdout
+ * Append to the web stream. Output that does not fit is dropped (a
+ * command that is not a job cannot wait for the reader).
+ */
+static void cli_stream_put(const char *s, size_t n) {
+    if (cli_stream.head - cli_stream.released + n > CLI_STREAM_SIZE) {
+        return;
+    }
+
+    uint32_t at = cli_stream.head % CLI_STREAM_SIZE;
+    size_t first = CLI_STREAM_SIZE - at;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(cli_stream.buf + at, s, first);
+    memcpy(cli_stream.buf, s + first, n - first);
+    cli_stream.head += n;
+}
+
+/**
+ * CLI printf - outputs to the web stream if it is the target, otherwise
+ * to stdout
  */
 static int cli_printf(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
     int ret;
 
-    if (cli_out_buf != NULL) {
-        /* Output to buffer */
-        ret = vsnprintf(cli_out_buf + cli_out_pos, cli_out_len - cli_out_pos, fmt, args);
+    if (cli_to_stream) {
+        char line[CLI_LINE_MAX];
+        ret = vsnprintf(line, sizeof(line), fmt, args);
         if (ret > 0) {
-            cli_out_pos += ret;
-            if (cli_out_pos >= (int)cli_out_len) {
-                cli_out_pos = cli_out_len - 1;
-            }
+            cli_stream_put(line, (ret < (int)sizeof(line)) ? (size_t)ret : sizeof(line) - 1);
         }
     } else {
         /* Output to stdout */
@@ -85,6 +161,69 @@ static int cli_printf(const char *fmt, ...) {
     return ret;
 }
 
+/*============================================================================
+ * JOBS
+ *============================================================================*/
+
+/**
+ * Make the command being run a job, first stepped after first_us. Fails
+ * (and says so) while another job runs.
+ */
+static bool cli_job_start(const char *name, cli_step_fn step, uint32_t first_us) {
+    if (cli_job.step != NULL) {
+        cli_printf("Busy: '%s' is running\n", cli_job.name);
+        return false;
+    }
+
+    memset(&cli_job, 0, sizeof(cli_job));
+    cli_job.step = step;
+    cli_job.name = name;
+    cli_job.web = cli_to_stream;
+    cli_job.due_us = time_us_32() + first_us;
+    return true;
+}
+
+static void cli_job_end(void) {
+    bool console = (cli_job.step != NULL && !cli_job.web);
+    cli_job.step = NULL;
+    if (console) {
+        printf(CLI_PROMPT);
+    }
+}
+
+/**
+ * Step the job when it is due (from cli_task)
+ */
+static void cli_job_run(void) {
+    if (cli_job.step == NULL) {
+        return;
+    }
+
+    uint32_t now = time_us_32();
+    if ((int32_t)(now - cli_job.due_us) < 0) {
+        sched_wake_at(cli_job.due_us);
+        return;
+    }
+
+    if (cli_job.web && CLI_STREAM_SIZE - (cli_stream.head - cli_stream.released) < CLI_JOB_ROOM) {
+        /* The web server has not sent the last steps yet */
+        cli_job.due_us = now + CLI_JOB_RETRY_US;
+        sched_wake_at(cli_job.due_us);
+        return;
+    }
+
+    cli_to_stream = cli_job.web;
+    uint32_t delay = cli_job.step(&cli_job);
+    cli_to_stream = false;
+
+    if (delay == CLI_JOB_DONE) {
+        cli_job_end();
+        return;
+    }
+    cli_job.due_us = now + delay;
+    sched_wake_at(cli_job.due_us);
+}
+
 /*============================================================================
  * HELPER FUNCTIONS
  *============================================================================*/
@@ -162,6 +301,7 @@ static void cmd_help(void) {
     cli_printf("  status              - Show system status\n");
     cli_printf("  pins                - Show GPIO pin assignments\n");
     cli_printf("  acfreq              - Show AC mains frequency\n");
+    cli_printf("  acfreq report [s]   - Stream frequency, ROCOF, grid time\n");
     cli_printf("  debug on|off        - Enable/disable periodic debug output\n");
     cli_printf("  config show         - Show current configuration\n");
     cli_printf("  config save         - Save configuration to flash\n");
@@ -169,6 +309,17 @@ static void cmd_help(void) {
     cli_printf("  reboot              - Reboot the device\n");
     cli_printf("  reboot bl           - Reboot into USB bootloader\n");
     cli_printf("  wifi <SSID> <PWD>   - Connect to WiFi (quote SSID if spaces)\n");
+    cli_printf("  link                - WiFi power mode and link latency\n");
+    cli_printf("  link pm <latency|balanced|powersave|adaptive>\n");
+    cli_printf("                      - Power save off / PM2 / PM1 / off while serving\n");
+    cli_printf("  link dtim <1-10>    - Listen interval in DTIM beacons\n");
+    cli_printf("  link sleep <ms>     - PM2 idle time before dozing (10-2550)\n");
+    cli_printf("  link probe <on|off> - Link latency probe (corrects NTP/PTP stamps)\n");
+#if CHRONOS_ETH_W5500
+    cli_printf("  eth                 - Wired Ethernet status and stamps\n");
+    cli_printf("  eth serve <on|off>  - NTP/PTP on the wired link when up, or WiFi\n");
+    cli_printf("  eth latency <ns>    - Stamp to wire correction for the wired link\n");
+#endif
     cli_printf("\n");
     cli_printf("Pulse Output Commands:\n");
     cli_printf("  pulse <pin> P <interval> <width_ms>  (interval in sec, e.g. 0.5, 1, 10)\n");
@@ -195,20 +346,71 @@ static void cmd_help(void) {
     cli_printf("Radio Timecode Commands:\n");
     cli_printf("  rf                        - Show RF output status\n");
     cli_printf("  rf <signal> <on|off>      - Enable/disable output\n");
+    cli_printf("  rf pm <on|off>            - DCF77 phase modulation\n");
     cli_printf("  Signals: dcf77, wwvb, jjy40, jjy60, all\n");
     cli_printf("\n");
     cli_printf("NMEA Output:\n");
     cli_printf("  nmea                      - Show NMEA status\n");
     cli_printf("  nmea <on|off>             - Enable/disable NMEA output\n");
+    cli_printf("  nmea baud <rate>          - 4800-921600 baud\n");
+    cli_printf("  nmea set <zda,rmc,gga>    - Sentences sent each second\n");
+    cli_printf("  irig                      - Show IRIG-B status\n");
+    cli_printf("  irig <on|off|dc|am>       - IRIG-B output / format\n");
     cli_printf("\n");
     cli_printf("GNSS Receiver:\n");
     cli_printf("  gnss                      - Show GNSS status\n");
     cli_printf("  gnss <on|off>             - Enable/disable GNSS input\n");
     cli_printf("  gnss debug <on|off>       - Show incoming NMEA timestamps\n");
     cli_printf("\n");
+    cli_printf("NTP Server:\n");
+    cli_printf("  ntp                       - Show NTP clients and rate limiting\n");
+    cli_printf("  ntp bcast <on|off>        - Mode 5 broadcast, half way between PPS edges\n");
+    cli_printf("  ntp bcast interval <log2> - Broadcast interval (4..10, default 6)\n");
+    cli_printf("  ntp bcast dest <subnet|mcast> - Subnet broadcast or 224.0.1.1\n");
+    cli_printf("  ntp bcast xleave <on|off> - Interleaved broadcast\n");
+    cli_printf("  ntp bcast auth <on|off>   - AES-CMAC MAC on broadcasts\n");
+    cli_printf("  ntp key                   - Show the symmetric key (USB console only)\n");
+    cli_printf("  nts                       - Show NTS-KE and NTS statistics\n");
+    cli_printf("  nts cert                  - Print the NTS-KE server certificate (PEM)\n");
+    cli_printf("\n");
+    cli_printf("PTP Server:\n");
+    cli_printf("  ptp                       - Show PTP status and egress model\n");
+    cli_printf("  ptp cal <on|off>          - Enable/disable link latency probing\n");
+    cli_printf("  ptp trim <ns>             - Set egress asymmetry trim\n");
+    cli_printf("  ptp sync <log2>           - Multicast Sync interval (-7..4, -4 = 16/s)\n");
+    cli_printf("  ptp prio <p1> [p2]        - BMCA priorities (lower wins)\n");
+    cli_printf("\n");
+    cli_printf("Stability:\n");
+    cli_printf("  adev                      - Show ADEV/MDEV/TDEV at octave taus\n");
+    cli_printf("  adev reset                - Clear stability estimates\n");
+    cli_printf("  jitter                    - PPS period error and GNSS offset percentiles\n");
+    cli_printf("  jitter reset [pps|gnss]   - Restart the measurement window\n");
+    cli_printf("  disc                      - Clock model and time error\n");
+    cli_printf("  disc <pi|kalman>          - Select the discipline steering law\n");
+    cli_printf("  ref                       - Reference health and selection\n");
+    cli_printf("  history                   - Time-series store contents\n");
+    cli_printf("  history <series> [t] [n]  - Newest n records of tier t (default 1m, 10)\n");
+    cli_printf("\n");
     cli_printf("Time Sync:\n");
     cli_printf("  sync                      - Force time resync from GNSS\n");
-    cli_printf("  watch                     - Live time display (serial only)\n");
+    cli_printf("  warm                      - Show saved discipline state\n");
+    cli_printf("  warm save|clear           - Save now (when locked) / forget it\n");
+    cli_printf("  watch                     - Live time display for 30 s (Ctrl+C stops)\n");
+    cli_printf("\n");
+    cli_printf("Diagnostics:\n");
+    cli_printf("  perf                      - Cycle counts per traced probe\n");
+    cli_printf("  perf dump [core] [n]      - Last n raw trace events (default 0 32)\n");
+    cli_printf("  perf reset                - Clear trace statistics\n");
+    cli_printf("  sched                     - Scheduled tasks and core load\n");
+    cli_printf("  log                       - Log levels and record counts\n");
+    cli_printf("  log <module|all> <level>  - Set level (error|warn|info|debug)\n");
+    cli_printf("  log dump [n]              - Last n log records (default 20)\n");
+    cli_printf("  bench                     - Load benchmark steps and capacity\n");
+    cli_printf("  bench start [p99_us] [ip] - Start (NTP p99 target, default %d;\n", BENCH_P99_DEFAULT_US);
+    cli_printf("                              generator ip exempt from rate limits)\n");
+    cli_printf("  bench step <req/s>        - Open the next step at the offered rate\n");
+    cli_printf("  bench stop                - Close the last step, end the exemption\n");
+    cli_printf("  bench csv                 - Steps as CSV (for tools/load_gen.py)\n");
     cli_printf("\n");
 }
 
@@ -226,19 +428,39 @@ static void cmd_status(void) {
     cli_printf("╚══════════════════════════════════════════════════════════════╝\n");
     cli_printf("\n");
 
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    const time_state_t *ts = &snap.state;
+
     /* Sync Status */
     cli_printf("Synchronization:\n");
-    cli_printf("  State:          %s\n", sync_states[g_time_state.sync_state]);
-    cli_printf("  Rb Lock:        %s\n", g_time_state.rb_locked ? "YES" : "NO");
-    cli_printf("  Time Valid:     %s\n", g_time_state.time_valid ? "YES" : "NO");
-    cli_printf("  PPS Count:      %lu\n", g_time_state.pps_count);
+    cli_printf("  State:          %s\n", sync_states[ts->sync_state]);
+    cli_printf("  Rb Lock:        %s\n", ts->rb_locked ? "YES" : "NO");
+    cli_printf("  Time Valid:     %s\n", ts->time_valid ? "YES" : "NO");
+    cli_printf("  PPS Count:      %lu\n", ts->pps_count);
     cli_printf("\n");
 
     /* Timing */
     cli_printf("Timing:\n");
-    cli_printf("  Offset:         %lld ns\n", g_time_state.offset_ns);
-    cli_printf("  Freq Offset:    %.3f ppb\n", g_time_state.frequency_offset);
-    cli_printf("  Freq Count:     %lu Hz\n", g_time_state.last_freq_count);
+    cli_printf("  Offset:         %lld ns\n", ts->offset_ns);
+    cli_printf("  Freq Offset:    %.3f ppb\n", ts->frequency_offset);
+    cli_printf("  Freq Count:     %lu Hz\n", ts->last_freq_count);
+    if (snap.freq.valid) {
+        cli_printf("  10MHz vs XTAL:  %.3f ppb (sigma %.3f)\n",
+                   snap.freq.local_ppb, snap.freq.sigma_ppb);
+        if (snap.freq.referenced) {
+            cli_printf("  10MHz Offset:   %.3f ppb\n", snap.freq.rb_offset_ppb);
+        }
+    }
+    cli_printf("\n");
+
+    /* Timing engine */
+    timing_core_stats_t tc;
+    timing_core_get_stats(&tc);
+    cli_printf("Timing Engine:\n");
+    cli_printf("  Mode:           %s\n", tc.multicore ? "core1 (multicore)" : "core0 (single-core)");
+    cli_printf("  Loop Count:     %lu\n", tc.loops);
+    cli_printf("  Max Loop:       %lu us\n", tc.max_loop_us);
     cli_printf("\n");
 
     /* Network */
@@ -253,12 +475,13 @@ static void cmd_status(void) {
 
     /* Statistics */
     cli_printf("Statistics:\n");
-    cli_printf("  NTP Requests:   %lu\n", g_stats.ntp_requests);
+    cli_printf("  NTP Requests:   %lu (%lu interleaved)\n", g_stats.ntp_requests,
+               ntp_get_interleaved_count());
     cli_printf("  PTP Sync Sent:  %lu\n", g_stats.ptp_sync_sent);
     cli_printf("  Errors:         %lu\n", g_stats.errors);
-    cli_printf("  Min Offset:     %ld ns\n", g_stats.min_offset_ns);
-    cli_printf("  Max Offset:     %ld ns\n", g_stats.max_offset_ns);
-    cli_printf("  Avg Offset:     %.1f ns\n", g_stats.avg_offset_ns);
+    cli_printf("  Min Offset:     %ld ns\n", snap.min_offset_ns);
+    cli_printf("  Max Offset:     %ld ns\n", snap.max_offset_ns);
+    cli_printf("  Avg Offset:     %.1f ns\n", snap.avg_offset_ns);
     cli_printf("\n");
 
     /* AC Mains Frequency */
@@ -266,6 +489,9 @@ static void cmd_status(void) {
     if (ac_freq_signal_present()) {
         cli_printf("  Frequency:      %.3f Hz\n", ac_freq_get_hz());
         cli_printf("  Average:        %.3f Hz\n", ac_freq_get_avg_hz());
+        const ac_freq_state_t *ac = ac_freq_get_state();
+        cli_printf("  ROCOF:          %+.3f Hz/s\n", ac->rocof_hz_s);
+        cli_printf("  Grid Time Err:  %+.3f s\n", ac->grid_time_error_ns * 1e-9);
     } else {
         cli_printf("  Signal:         Not detected\n");
     }
@@ -306,18 +532,31 @@ static void cmd_pins(void) {
     cli_printf("\n");
 
     cli_printf("Outputs - Fixed Interval Pulses:\n");
+#if !CHRONOS_ETH_W5500
+    /* These pins carry the W5500 bus in Ethernet builds */
     cli_printf("  GP%-2d  Pulse 0.5s         500ms interval\n", GPIO_PULSE_500MS);
     cli_printf("  GP%-2d  Pulse 1s           1 second interval\n", GPIO_PULSE_1S);
     cli_printf("  GP%-2d  Pulse 6s           6 second interval\n", GPIO_PULSE_6S);
+#endif
     cli_printf("  GP%-2d  Pulse 30s          30 second interval\n", GPIO_PULSE_30S);
     cli_printf("  GP%-2d  Pulse 60s          60 second interval\n", GPIO_PULSE_60S);
     cli_printf("\n");
 
     cli_printf("Peripherals:\n");
-    cli_printf("  GP%-2d  UART TX            Debug serial output\n", GPIO_UART_TX);
-    cli_printf("  GP%-2d  UART RX            Debug serial input\n", GPIO_UART_RX);
+    cli_printf("  GP%-2d  NMEA TX (UART0)    ZDA/RMC/GGA each second\n", GPIO_NMEA_TX);
+#if CHRONOS_ETH_W5500
+    cli_printf("\n");
+
+    cli_printf("Wired Ethernet (W5500, SPI1):\n");
+    cli_printf("  GP%-2d  ETH MISO           SPI1 RX\n", GPIO_ETH_MISO);
+    cli_printf("  GP%-2d  ETH CS             Chip select\n", GPIO_ETH_CS);
+    cli_printf("  GP%-2d  ETH SCK            SPI1 clock\n", GPIO_ETH_SCK);
+    cli_printf("  GP%-2d  ETH MOSI           SPI1 TX\n", GPIO_ETH_MOSI);
+    cli_printf("  GP%-2d  ETH INT            INTn, RX timestamps\n", GPIO_ETH_INT);
+#else
     cli_printf("  GP%-2d  I2C SDA            Optional OLED display\n", GPIO_I2C_SDA);
     cli_printf("  GP%-2d  I2C SCL            Optional OLED display\n", GPIO_I2C_SCL);
+#endif
     cli_printf("\n");
 
 }
@@ -352,6 +591,9 @@ static void cmd_reboot(int argc, char **argv) {
         sleep_ms(100);
         reset_usb_boot(0, 0);
     } else {
+        if (warm_start_save()) {
+            cli_printf("Discipline state saved for warm start\n");
+        }
         cli_printf("Rebooting...\n");
         sleep_ms(100);
         watchdog_reboot(0, 0, 0);
@@ -414,6 +656,134 @@ static void cmd_wifi(int argc, char **argv) {
     }
 }
 
+/**
+ * WiFi power management and link latency
+ */
+static void cmd_link(int argc, char **argv) {
+    config_t *cfg = config_get();
+
+    if (argc >= 3 && strcmp(argv[1], "pm") == 0) {
+        int mode = -1;
+        for (int i = 0; i < WIFI_PM_MODE_COUNT; i++) {
+            if (strcmp(argv[2], wifi_pm_mode_name((uint8_t)i)) == 0) {
+                mode = i;
+            }
+        }
+        if (mode < 0 || !wifi_set_power_mode((wifi_pm_mode_t)mode)) {
+            cli_printf("Usage: link pm <latency|balanced|powersave|adaptive>\n");
+            return;
+        }
+        cfg->wifi_pm_mode = (uint8_t)mode;
+        cli_printf("Power mode %s\n", argv[2]);
+        cli_printf("Use 'config save' to persist settings\n");
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "dtim") == 0) {
+        int dtims = atoi(argv[2]);
+        if (dtims < 1 || dtims > WIFI_LISTEN_DTIM_MAX || !wifi_set_listen_interval((uint8_t)dtims)) {
+            cli_printf("Listen interval must be 1-%d DTIMs\n", WIFI_LISTEN_DTIM_MAX);
+            return;
+        }
+        cfg->wifi_listen_dtim = (uint8_t)dtims;
+        cli_printf("Listen interval %d DTIM\n", dtims);
+        cli_printf("Use 'config save' to persist settings\n");
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "sleep") == 0) {
+        int ms = atoi(argv[2]);
+        if (ms < 10 || ms > 2550 || !wifi_set_pm2_sleep((uint16_t)(ms / 10 * 10))) {
+            cli_printf("PM2 sleep must be 10-2550 ms\n");
+            return;
+        }
+        cfg->wifi_pm2_sleep_10ms = (uint8_t)(ms / 10);
+        cli_printf("PM2 sleep %d ms\n", ms / 10 * 10);
+        cli_printf("Use 'config save' to persist settings\n");
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "probe") == 0) {
+        wifi_set_latency_probe(strcmp(argv[2], "on") == 0 || strcmp(argv[2], "1") == 0);
+        return;
+    }
+    if (argc >= 2) {
+        cli_printf("Usage: link [pm <mode>|dtim <n>|sleep <ms>|probe <on|off>]\n");
+        return;
+    }
+
+    wifi_latency_info_t lat;
+    wifi_get_latency(&lat);
+    cli_printf("WiFi Power:\n");
+    cli_printf("  Mode:           %s (driver: %s)\n", wifi_pm_mode_name(lat.mode),
+               wifi_pm_mode_name(lat.applied));
+    cli_printf("  Listen:         %u DTIM, PM2 sleep %u ms\n", lat.listen_dtim, lat.pm2_sleep_ms);
+    cli_printf("  Client load:    %.2f req/s\n", lat.load_per_s);
+    if (lat.mode == WIFI_PM_ADAPTIVE) {
+        cli_printf("  Switches:       %lu\n", lat.switches);
+    }
+    cli_printf("\n");
+    cli_printf("Link Latency:\n");
+    cli_printf("  Probe:          %s (%lu samples)\n", lat.probing ? "ON" : "OFF", lat.samples);
+    if (lat.valid) {
+        cli_printf("  One-way:        %ld ns (applied to NTP and PTP stamps)\n", lat.one_way_ns);
+    } else {
+        cli_printf("  One-way:        not yet measured\n");
+    }
+    cli_printf("  Probe RTT:      %lu us last, %lu us mean, %lu us jitter\n",
+               lat.rtt_last_us, lat.rtt_mean_us, lat.rtt_jitter_us);
+    cli_printf("  RX wake:        %lu us mean, %lu us jitter\n", lat.rx_wake_us, lat.rx_jitter_us);
+    cli_printf("  TX driver:      %lu us mean, %lu us jitter\n", lat.tx_driver_us, lat.tx_jitter_us);
+}
+
+#if CHRONOS_ETH_W5500
+/**
+ * Wired Ethernet status
+ */
+static void cmd_eth(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "serve") == 0) {
+        eth_set_serving(strcmp(argv[2], "on") == 0 || strcmp(argv[2], "1") == 0);
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "latency") == 0) {
+        eth_set_latency_ns(atoi(argv[2]));
+        cli_printf("Wired stamp correction %ld ns\n", eth_latency_ns());
+        return;
+    }
+    if (argc >= 2) {
+        cli_printf("Usage: eth [serve <on|off>|latency <ns>]\n");
+        return;
+    }
+
+    eth_status_t st;
+    eth_get_status(&st);
+    if (!st.present) {
+        cli_printf("Wired Ethernet: no W5500 found\n");
+        return;
+    }
+
+    uint32_t ip = st.ip_addr;
+    cli_printf("Wired Ethernet (W5500):\n");
+    cli_printf("  MAC:            %02x:%02x:%02x:%02x:%02x:%02x\n",
+               st.mac[0], st.mac[1], st.mac[2], st.mac[3], st.mac[4], st.mac[5]);
+    if (st.link_up) {
+        cli_printf("  Link:           up, %s %s duplex (%lu changes)\n",
+                   st.speed_100 ? "100 Mbit/s" : "10 Mbit/s",
+                   st.full_duplex ? "full" : "half", st.link_changes);
+    } else {
+        cli_printf("  Link:           down (%lu changes)\n", st.link_changes);
+    }
+    cli_printf("  IP:             %lu.%lu.%lu.%lu\n",
+               ip & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, (ip >> 24) & 0xFF);
+    cli_printf("  NTP/PTP:        %s\n", st.serving ? "wired" : "WiFi");
+    cli_printf("  Correction:     %ld ns\n", st.latency_ns);
+    cli_printf("\n");
+    cli_printf("Frames:\n");
+    cli_printf("  RX:             %lu (%lu INTn stamped, %lu dropped, %lu errors)\n",
+               st.rx_frames, st.rx_irq_stamped, st.rx_dropped, st.rx_errors);
+    cli_printf("  TX:             %lu (%lu errors)\n", st.tx_frames, st.tx_errors);
+    cli_printf("  INTn to read:   %lu us last\n", st.irq_latency_us);
+    cli_printf("  TX to SEND:     %lu us last\n", st.tx_spi_us);
+}
+#endif
+
 /**
  * Configuration commands
  */
@@ -478,6 +848,9 @@ static void cmd_pulse(int argc, char **argv) {
             if (cfg->pulse_count > 1) {
                 cli_printf(" x%u (gap %u ms)", cfg->pulse_count, cfg->pulse_gap_ms);
             }
+            if (cfg->missed > 0) {
+                cli_printf(" [missed: %lu]", (unsigned long)cfg->missed);
+            }
             cli_printf("\n");
         }
         if (!any_active) {
@@ -494,8 +867,12 @@ static void cmd_pulse(int argc, char **argv) {
 
     /* Parse GPIO pin */
     int pin = atoi(argv[1]);
-    if (pin < 0 || pin > 28) {
-        cli_printf("Error: Invalid GPIO pin (0-28)\n");
+    if (pin < 0 || pin > PULSE_GPIO_MAX) {
+        cli_printf("Error: Invalid GPIO pin (0-%d)\n", PULSE_GPIO_MAX);
+        return;
+    }
+    if (!pulse_output_pin_allowed((uint8_t)pin)) {
+        cli_printf("Error: GP%d is reserved (see 'pins')\n", pin);
         return;
     }
 
@@ -633,7 +1010,17 @@ static void cmd_rf(int argc, char **argv) {
                    radio_timecode_is_enabled(RADIO_JJY40) ? "ON" : "OFF");
         cli_printf("  JJY60  (GP%d,   60kHz): %s\n", GPIO_JJY60,
                    radio_timecode_is_enabled(RADIO_JJY60) ? "ON" : "OFF");
+        cli_printf("  DCF77 phase modulation: %s\n",
+                   radio_timecode_get_dcf77_pm() ? "ON" : "OFF");
         cli_printf("\nUsage: rf <dcf77|wwvb|jjy40|jjy60|all> <on|off>\n");
+        cli_printf("       rf pm <on|off>\n");
+        return;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "pm") == 0) {
+        bool enable = (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "1") == 0);
+        radio_timecode_set_dcf77_pm(enable);
+        cli_printf("DCF77 phase modulation %s\n", enable ? "enabled" : "disabled");
         return;
     }
 
@@ -687,35 +1074,831 @@ static void cmd_nmea(int argc, char **argv) {
     config_t *cfg = config_get();
 
     if (argc < 2) {
-        cli_printf("NMEA Output: %s (GP28)\n",
-                   nmea_output_is_enabled() ? "ON" : "OFF");
-        cli_printf("Usage: nmea <on|off>\n");
+        uint32_t sent, overruns, dropped;
+        uint8_t set = nmea_output_get_sentences();
+        nmea_output_get_stats(&sent, &overruns, &dropped);
+        cli_printf("NMEA Output: %s (GP28, %lu baud)\n",
+                   nmea_output_is_enabled() ? "ON" : "OFF", nmea_output_get_baud());
+        cli_printf("  Sentences: %s%s%s\n",
+                   (set & NMEA_SENT_ZDA) ? "ZDA " : "",
+                   (set & NMEA_SENT_RMC) ? "RMC " : "",
+                   (set & NMEA_SENT_GGA) ? "GGA " : "");
+        cli_printf("  Sent: %lu, overruns: %lu, dropped for airtime: %lu\n",
+                   sent, overruns, dropped);
+        cli_printf("Usage: nmea <on|off> | baud <rate> | set <zda,rmc,gga>\n");
         return;
     }
 
-    bool enable = (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "1") == 0);
-    nmea_output_enable(enable);
-    cfg->nmea_enabled = enable;
-    cli_printf("NMEA %s\n", enable ? "enabled" : "disabled");
+    if (strcmp(argv[1], "baud") == 0) {
+        uint32_t baud = (argc >= 3) ? (uint32_t)strtoul(argv[2], NULL, 10) : 0;
+        if (!nmea_output_set_baud(baud)) {
+            cli_printf("Baud: 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600\n");
+            return;
+        }
+        cfg->nmea_baud_100 = (uint16_t)(baud / 100);
+        cli_printf("NMEA at %lu baud\n", baud);
+    } else if (strcmp(argv[1], "set") == 0) {
+        if (argc < 3) {
+            cli_printf("Usage: nmea set <zda,rmc,gga>\n");
+            return;
+        }
+        uint8_t mask = 0;
+        char *save = NULL;
+        for (char *t = strtok_r(argv[2], ",", &save); t; t = strtok_r(NULL, ",", &save)) {
+            if (strcasecmp(t, "zda") == 0) mask |= NMEA_SENT_ZDA;
+            else if (strcasecmp(t, "rmc") == 0) mask |= NMEA_SENT_RMC;
+            else if (strcasecmp(t, "gga") == 0) mask |= NMEA_SENT_GGA;
+            else {
+                cli_printf("Unknown sentence: %s\n", t);
+                return;
+            }
+        }
+        nmea_output_set_sentences(mask);
+        cfg->nmea_sentences = mask;
+        cli_printf("NMEA sentences set\n");
+    } else {
+        bool enable = (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "1") == 0);
+        nmea_output_enable(enable);
+        cfg->nmea_enabled = enable;
+        cli_printf("NMEA %s\n", enable ? "enabled" : "disabled");
+    }
     cli_printf("Use 'config save' to persist settings\n");
 }
 
 /**
- * Force time resync from GNSS
+ * IRIG-B output control
  */
-static void cmd_sync(void) {
-    if (!gnss_has_time()) {
-        cli_printf("Error: GNSS does not have valid time\n");
-        cli_printf("Wait for GNSS fix before syncing\n");
+static void cmd_irig(int argc, char **argv) {
+    if (argc < 2) {
+        uint32_t frames, resyncs;
+        irig_b_get_stats(&frames, &resyncs);
+        cli_printf("IRIG-B Output: %s (GP%d)\n",
+                   irig_b_is_enabled() ? "ON" : "OFF", GPIO_IRIG_B);
+        cli_printf("  Format:  %s\n", irig_b_is_modulated() ?
+                   "B124 (1kHz AM, IEEE 1344)" : "B004 (DC level shift, IEEE 1344)");
+        cli_printf("  Frames:  %lu\n", frames);
+        cli_printf("  Resyncs: %lu\n", resyncs);
+        cli_printf("Usage: irig <on|off|dc|am>\n");
         return;
     }
 
-    cli_printf("Forcing time resync from GNSS...\n");
-    force_time_resync();
+    if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "1") == 0) {
+        irig_b_enable(true);
+    } else if (strcmp(argv[1], "off") == 0 || strcmp(argv[1], "0") == 0) {
+        irig_b_enable(false);
+    } else if (strcmp(argv[1], "dc") == 0) {
+        irig_b_set_mode(false);
+    } else if (strcmp(argv[1], "am") == 0) {
+        irig_b_set_mode(true);
+    } else {
+        cli_printf("Usage: irig <on|off|dc|am>\n");
+    }
+}
+
+/**
+ * NTP broadcast settings, saved to the config like the PTP ones
+ */
+static void cmd_ntp_bcast(int argc, char **argv) {
+    config_t *cfg = config_get();
+    bool on = (argc >= 4) && (strcmp(argv[3], "on") == 0 || strcmp(argv[3], "1") == 0);
+
+    if (argc == 3 && (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        cfg->ntp_bcast_enabled = (strcmp(argv[2], "on") == 0);
+        ntp_broadcast_enable(cfg->ntp_bcast_enabled);
+    } else if (argc >= 4 && strcmp(argv[2], "interval") == 0) {
+        int log_interval = atoi(argv[3]);
+        if (!ntp_broadcast_set_interval((int8_t)log_interval)) {
+            cli_printf("Broadcast log2 interval must be %d..%d\n", NTP_POLL_MIN, NTP_POLL_MAX);
+            return;
+        }
+        cfg->ntp_bcast_log = (int8_t)log_interval;
+        cli_printf("Broadcast every 2^%d s\n", log_interval);
+    } else if (argc >= 4 && strcmp(argv[2], "dest") == 0) {
+        if (strcmp(argv[3], "mcast") != 0 && strcmp(argv[3], "subnet") != 0) {
+            cli_printf("Usage: ntp bcast dest <subnet|mcast>\n");
+            return;
+        }
+        cfg->ntp_bcast_multicast = (strcmp(argv[3], "mcast") == 0);
+        ntp_broadcast_set_multicast(cfg->ntp_bcast_multicast);
+        cli_printf("Broadcast to %s\n", cfg->ntp_bcast_multicast ? "224.0.1.1" : "subnet");
+    } else if (argc >= 4 && strcmp(argv[2], "xleave") == 0) {
+        cfg->ntp_bcast_xleave = on;
+        ntp_broadcast_set_xleave(on);
+        cli_printf("Interleaved broadcast %s\n", on ? "on" : "off");
+    } else if (argc >= 4 && strcmp(argv[2], "auth") == 0) {
+        cfg->ntp_bcast_auth = on;
+        ntp_broadcast_set_auth(on);
+        cli_printf("Broadcast MAC %s (key %d, see 'ntp key')\n", on ? "on" : "off",
+                   NTP_BCAST_KEY_ID);
+    } else {
+        cli_printf("Usage: ntp bcast <on|off|interval <log2>|dest <subnet|mcast>|"
+                   "xleave <on|off>|auth <on|off>>\n");
+        return;
+    }
+    cli_printf("Use 'config save' to persist settings\n");
+}
+
+/**
+ * NTP server client table
+ */
+static void cmd_ntp(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "bcast") == 0) {
+        cmd_ntp_bcast(argc, argv);
+        return;
+    }
+    if (argc >= 2 && strcmp(argv[1], "key") == 0) {
+        /* /api/cli is unauthenticated: whoever reads the key can forge
+         * authenticated time, so it only goes to the USB console */
+        if (cli_to_stream) {
+            cli_printf("ntp key is only available on the USB console\n");
+            return;
+        }
+        /* Same key in ntpd (ntp.keys) and chrony (chrony.keys) syntax */
+        uint8_t key[16];
+        char hex[33];
+        ntp_get_symmetric_key(key);
+        for (int i = 0; i < 16; i++) {
+            snprintf(hex + 2 * i, 3, "%02x", key[i]);
+        }
+        memset(key, 0, sizeof(key));
+        cli_printf("ntp.keys:    %d AES128CMAC %s\n", NTP_BCAST_KEY_ID, hex);
+        cli_printf("chrony.keys: %d AES128 HEX:%s\n", NTP_BCAST_KEY_ID, hex);
+        return;
+    }
+    if (argc >= 2) {
+        cli_printf("Usage: ntp [bcast ...|key]\n");
+        return;
+    }
+
+    ntp_client_info_t clients[MAX_NTP_CLIENTS];
+    int n = ntp_get_clients(clients, MAX_NTP_CLIENTS);
+    uint32_t requests, errors, kod_sent, dropped;
+    ntp_get_statistics(&requests, &errors);
+    ntp_get_limit_stats(&kod_sent, &dropped);
+
+    cli_printf("NTP Server:\n");
+    cli_printf("  Requests:       %lu (%lu interleaved)\n", requests,
+               ntp_get_interleaved_count());
+    cli_printf("  Errors:         %lu\n", errors);
+    cli_printf("  KoD RATE sent:  %lu\n", kod_sent);
+    cli_printf("  Dropped:        %lu\n", dropped);
+
+    ntp_bcast_info_t bc;
+    ntp_broadcast_get_info(&bc);
+    if (bc.enabled) {
+        uint8_t *dst = (uint8_t *)&bc.dest;
+        cli_printf("  Broadcast:      every 2^%d s to %u.%u.%u.%u%s%s, %lu sent, %lu failed\n",
+                   bc.log_interval, dst[0], dst[1], dst[2], dst[3],
+                   bc.xleave ? ", interleaved" : "", bc.auth ? ", MAC" : "",
+                   bc.sent, bc.errors);
+    } else {
+        cli_printf("  Broadcast:      off\n");
+    }
+    if (bc.auth_replies != 0 || bc.auth_failed != 0) {
+        cli_printf("  Symmetric key:  %lu replies, %lu bad MACs\n",
+                   bc.auth_replies, bc.auth_failed);
+    }
+
+    /* Load over the last minute, and what each kind of reply costs */
+    float plain_rate, nts_rate;
+    ntp_get_rates(&plain_rate, &nts_rate);
+    metrics_hist_snapshot_t plain_h, nts_h;
+    metrics_hist_read(METRIC_NTP_SERVICE, &plain_h);
+    metrics_hist_read(METRIC_NTS_SERVICE, &nts_h);
+    cli_printf("  Load:           %.1f plain/s, %.1f NTS/s\n", plain_rate, nts_rate);
+    if (plain_h.count != 0) {
+        cli_printf("  Plain service:  %.0f us mean\n", (double)plain_h.sum / plain_h.count);
+    }
+    if (nts_h.count != 0) {
+        nts_auth_stats_t ns;
+        nts_get_auth_stats(&ns);
+        cli_printf("  NTS service:    %.0f us mean (%lu replies)\n",
+                   (double)nts_h.sum / nts_h.count, ntp_get_nts_count());
+        cli_printf("  NTS keys:       %lu cache hits, %lu misses, %lu NAKs, master %08lx\n",
+                   ns.cache_hits, ns.cache_misses, ns.naks, ns.master_id);
+    }
+    cli_printf("\n");
+
+    if (n == 0) {
+        cli_printf("No clients seen\n");
+        return;
+    }
+
+    cli_printf("Client           Requests  Limited      KoD  Avg(ms)   Idle(s)  Mode\n");
+    for (int i = 0; i < n; i++) {
+        const ntp_client_info_t *c = &clients[i];
+        uint8_t *ip = (uint8_t *)&c->addr;
+        char ip_str[16];
+        snprintf(ip_str, sizeof(ip_str), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        cli_printf("%-15s %9lu %8lu %8lu %8lu %9lu  %s\n",
+                   ip_str, c->requests, c->limited, c->kod_sent,
+                   c->avg_interval_ms, c->idle_ms / 1000,
+                   c->interleaved != 0 ? "interleaved" : "basic");
+    }
+}
+
+/**
+ * NTS key establishment status, or the server certificate for clients
+ */
+static void cmd_nts(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "cert") == 0) {
+        static char pem[1024];
+        if (nts_ke_cert_pem(pem, sizeof(pem)) == 0) {
+            cli_printf("No NTS-KE certificate\n");
+            return;
+        }
+        cli_printf("%s", pem);
+        return;
+    }
+    if (argc >= 2) {
+        cli_printf("Usage: nts [cert]\n");
+        return;
+    }
+
+    nts_ke_stats_t ke;
+    nts_auth_stats_t auth;
+    nts_ke_get_stats(&ke);
+    nts_get_auth_stats(&auth);
+
+    cli_printf("NTS:              %s\n", nts_is_enabled() ? "enabled" : "disabled");
+    cli_printf("NTS-KE (TCP %d):\n", NTS_KE_PORT);
+    cli_printf("  Connections:    %lu (%lu refused, %lu timed out)\n",
+               ke.accepted, ke.refused, ke.timeouts);
+    cli_printf("  Cookies issued: %lu sessions\n", ke.completed);
+    cli_printf("  Failures:       %lu TLS, %lu bad requests\n",
+               ke.tls_failures, ke.bad_requests);
+    cli_printf("  Longest step:   %lu us\n", ke.max_step_us);
+    cli_printf("  Arena:          %lu / %u bytes (peak %lu, %lu refused)\n",
+               ke.arena_used, NTS_KE_ARENA_SIZE, ke.arena_peak, ke.arena_failures);
+    cli_printf("NTS-protected NTP:\n");
+    cli_printf("  Requests:       %lu (%lu NTSN, %lu malformed)\n",
+               auth.requests, auth.naks, auth.malformed);
+    cli_printf("  Key cache:      %lu hits, %lu misses\n", auth.cache_hits, auth.cache_misses);
+    cli_printf("  Master key:     %08lx (%lu rotations)\n", auth.master_id, auth.rotations);
+}
+
+/**
+ * PTP server status, rates, BMCA priorities and egress latency calibration
+ */
+static void cmd_ptp(int argc, char **argv) {
+    config_t *cfg = config_get();
+
+    if (argc >= 3 && strcmp(argv[1], "cal") == 0) {
+        ptp_set_egress_calibration(strcmp(argv[2], "on") == 0 || strcmp(argv[2], "1") == 0);
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "trim") == 0) {
+        ptp_set_egress_trim((int32_t)atol(argv[2]));
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "sync") == 0) {
+        int log_interval = atoi(argv[2]);
+        if (log_interval < PTP_SYNC_LOG_MIN || log_interval > PTP_SYNC_LOG_MAX ||
+            !ptp_set_sync_log_interval((int8_t)log_interval)) {
+            cli_printf("Sync log2 interval must be %d..%d\n", PTP_SYNC_LOG_MIN, PTP_SYNC_LOG_MAX);
+            return;
+        }
+        cfg->ptp_sync_log = (int8_t)log_interval;
+        cli_printf("Multicast Sync every 2^%d s\n", log_interval);
+        cli_printf("Use 'config save' to persist settings\n");
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "prio") == 0) {
+        int p1 = atoi(argv[2]);
+        int p2 = (argc >= 4) ? atoi(argv[3]) : cfg->ptp_priority2;
+        if (p1 < 0 || p1 > 255 || p2 < 0 || p2 > 255) {
+            cli_printf("Priorities are 0-255\n");
+            return;
+        }
+        ptp_set_priority((uint8_t)p1, (uint8_t)p2);
+        cfg->ptp_priority1 = (uint8_t)p1;
+        cfg->ptp_priority2 = (uint8_t)p2;
+        cli_printf("Priority1 %d, priority2 %d\n", p1, p2);
+        cli_printf("Use 'config save' to persist settings\n");
+        return;
+    }
+
+    uint32_t syncs, delay_resps;
+    ptp_get_statistics(&syncs, &delay_resps);
+    ptp_bmca_info_t bm;
+    ptp_get_bmca_info(&bm);
+    ptp_egress_info_t eg;
+    ptp_get_egress_info(&eg);
+    net_ts_stats_t ts;
+    net_ts_get_stats(&ts);
+
+    cli_printf("PTP Server:\n");
+    cli_printf("  Role:           %s (%lu changes)\n",
+               bm.master ? "MASTER" : "PASSIVE", bm.role_changes);
+    cli_printf("  Dataset:        priority %u/%u, class %u, accuracy 0x%02X\n",
+               bm.priority1, bm.priority2, bm.clock_class, bm.clock_accuracy);
+    cli_printf("  Intervals:      Sync 2^%d s, Announce 2^%d s (multicast)\n",
+               bm.sync_log, bm.announce_log);
+    cli_printf("  Sync Sent:      %lu\n", syncs);
+    cli_printf("  Delay Resp:     %lu\n", delay_resps);
+    cli_printf("  TX pbufs:       %lu allocated\n", bm.tx_pbuf_allocs);
+    cli_printf("\n");
+
+    ptp_foreign_info_t fm[4];
+    int nf = ptp_get_foreign_masters(fm, 4);
+    cli_printf("Other Masters: %d\n", nf);
+    if (nf > 0) {
+        cli_printf("Grandmaster              Address          P1  Class Acc   P2  Steps  Age\n");
+        for (int i = 0; i < nf; i++) {
+            const ptp_foreign_info_t *f = &fm[i];
+            uint8_t *ip = (uint8_t *)&f->addr;
+            char ip_str[16];
+            snprintf(ip_str, sizeof(ip_str), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+            cli_printf("%02X%02X%02X%02X%02X%02X%02X%02X%s  %-15s  %3u  %3u   0x%02X  %3u  %3u  %5lums\n",
+                       f->clock_id[0], f->clock_id[1], f->clock_id[2], f->clock_id[3],
+                       f->clock_id[4], f->clock_id[5], f->clock_id[6], f->clock_id[7],
+                       f->best ? " (best)  " : (f->qualified ? "         " : " (new)   "),
+                       ip_str, f->priority1, f->clock_class, f->clock_accuracy,
+                       f->priority2, f->steps_removed, f->age_ms);
+        }
+    }
+    cli_printf("\n");
+    cli_printf("Egress Latency Model (see 'link'):\n");
+    cli_printf("  Calibration:    %s\n", eg.enabled ? "ON" : "OFF");
+    if (eg.valid) {
+        cli_printf("  Latency:        %ld ns (one-way)\n", eg.latency_ns);
+    } else {
+        cli_printf("  Latency:        not measured\n");
+    }
+    cli_printf("  Trim:           %ld ns\n", eg.trim_ns);
+    cli_printf("  Last RTT:       %lu us\n", eg.last_rtt_us);
+    cli_printf("  Probes:         %lu sent, %lu answered, %lu used\n",
+               ts.probes_sent, ts.probes_answered, eg.samples);
+    cli_printf("  Host wake:      %lu of %lu RX frames (last %lu us)\n",
+               ts.rx_wake_stamped, ts.rx_frames, ts.wake_latency_us);
+    cli_printf("\n");
+
+    ptp_slave_info_t slaves[MAX_PTP_CLIENTS];
+    int n = ptp_get_slaves(slaves, MAX_PTP_CLIENTS);
+    cli_printf("Unicast Slaves: %d (%lu requests denied)\n", n, ptp_get_grants_denied());
+    if (n > 0) {
+        cli_printf("Slave            Announce    Sync        DelayResp   Syncs\n");
+        for (int i = 0; i < n; i++) {
+            const ptp_slave_info_t *sl = &slaves[i];
+            uint8_t *ip = (uint8_t *)&sl->addr;
+            char ip_str[16];
+            snprintf(ip_str, sizeof(ip_str), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+            cli_printf("%-15s", ip_str);
+            for (int k = 0; k < 3; k++) {
+                if (sl->remaining_s[k] > 0) {
+                    cli_printf("  %3d/%-5lus", sl->log_interval[k], sl->remaining_s[k]);
+                } else {
+                    cli_printf("  %-10s", "-");
+                }
+            }
+            cli_printf("  %lu\n", sl->syncs_sent);
+        }
+        cli_printf("  (log2 interval / grant time left)\n");
+    }
+    cli_printf("\nUsage: ptp [cal on|off] [trim <ns>] [sync <log2>] [prio <p1> [p2]]\n");
+}
+
+static void stability_reset_on_timing_core(void *arg) {
+    (void)arg;
+    stability_reset();
+}
+
+/**
+ * Frequency stability (ADEV / MDEV / TDEV)
+ */
+static void cmd_adev(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        timing_core_call(stability_reset_on_timing_core, NULL);
+        cli_printf("Stability estimates cleared\n");
+        return;
+    }
+
+    stability_point_t pts[STAB_LEVELS];
+    int n = stability_get(pts, STAB_LEVELS);
+
+    cli_printf("Frequency Stability (%lu samples):\n", stability_get_samples());
+    cli_printf("  Tau(s)      ADEV         MDEV         TDEV(s)        N\n");
+    for (int i = 0; i < n; i++) {
+        const stability_point_t *p = &pts[i];
+        if (p->adev_n == 0) {
+            break;
+        }
+        cli_printf("  %6lu  %.3e    %.3e    %.3e  %7lu\n",
+                   p->tau_s, p->adev, p->mdev, p->tdev, p->adev_n);
+    }
+    cli_printf("Usage: adev [reset]\n");
+}
 
-    /* Wait a moment for the sync to happen */
-    sleep_ms(100);
+#define CLI_HISTORY_MAX     60
+
+/**
+ * Time-series store: records per series and tier, or a series' newest
+ * records
+ */
+static void cmd_history(int argc, char **argv) {
+    if (argc >= 2) {
+        static tsdb_point_t pts[CLI_HISTORY_MAX];
+        int series = tsdb_series_from_name(argv[1]);
+        int tier = (argc >= 3) ? tsdb_tier_from_name(argv[2]) : TSDB_TIER_MIN;
+        int n = (argc >= 4) ? atoi(argv[3]) : 10;
+        if (series < 0 || tier < 0) {
+            cli_printf("Unknown series or tier\n");
+            return;
+        }
+        if (n < 1) n = 1;
+        if (n > CLI_HISTORY_MAX) n = CLI_HISTORY_MAX;
+
+        n = tsdb_recent((tsdb_series_t)series, (tsdb_tier_t)tier, pts, n);
+        cli_printf("%s (%s), %s tier:\n", tsdb_series_name(series),
+                   tsdb_series_unit(series), tsdb_tier_name(tier));
+        cli_printf("  Time (Unix)        Min         Avg         Max\n");
+        for (int i = 0; i < n; i++) {
+            cli_printf("  %10lu  %10ld  %10ld  %10ld\n",
+                       pts[i].t, pts[i].min, pts[i].avg, pts[i].max);
+        }
+        if (n == 0) {
+            cli_printf("  (no records)\n");
+        }
+        return;
+    }
 
+    tsdb_stats_t st;
+    tsdb_get_stats(&st);
+
+    cli_printf("History Store (records in RAM per tier):\n");
+    cli_printf("  Series   Unit       Samples     1s     1m     1h     1d   Bytes\n");
+    for (int s = 0; s < TSDB_SERIES_COUNT; s++) {
+        tsdb_series_stats_t ss;
+        tsdb_get_series_stats((tsdb_series_t)s, &ss);
+        cli_printf("  %-8s %-8s %9lu %6lu %6lu %6lu %6lu %7lu\n",
+                   tsdb_series_name(s), tsdb_series_unit(s), ss.samples,
+                   ss.records[TSDB_TIER_SEC], ss.records[TSDB_TIER_MIN],
+                   ss.records[TSDB_TIER_HOUR], ss.records[TSDB_TIER_DAY],
+                   ss.bytes[0] + ss.bytes[1] + ss.bytes[2] + ss.bytes[3]);
+    }
+    cli_printf("  RAM:     %lu bytes\n", st.ram_bytes);
+    if (st.flash_pages > 0) {
+        cli_printf("  Flash:   %lu/%lu pages, %lu spilled this boot, %lu dropped\n",
+                   st.flash_used, st.flash_pages, st.spilled, st.spill_dropped);
+    } else {
+        cli_printf("  Flash:   off (build with CHRONOS_HISTORY_FLASH_KB)\n");
+    }
+    cli_printf("Usage: history [<series> [1s|1m|1h|1d] [n]]\n");
+}
+
+static void jitter_reset_on_timing_core(void *arg) {
+    jitter_stats_reset(*(const jitter_series_t *)arg);
+}
+
+/**
+ * PPS jitter: running statistics and percentiles, window and since boot
+ */
+static void cmd_jitter(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        jitter_series_t series = JITTER_SERIES_COUNT;
+        if (argc >= 3) {
+            int s = jitter_series_from_name(argv[2]);
+            if (s < 0) {
+                cli_printf("Unknown series (pps|gnss)\n");
+                return;
+            }
+            series = (jitter_series_t)s;
+        }
+        timing_core_call(jitter_reset_on_timing_core, &series);
+        cli_printf("Jitter window restarted\n");
+        return;
+    }
+
+    static jitter_snapshot_t js;
+    uint64_t now_us = time_us_64();
+
+    cli_printf("PPS Jitter (ns; pps = period - 1 s, gnss = GNSS - Rb offset):\n");
+    cli_printf("  Series Set        N      Mean      SD     Min     p50     p99   p99.9     Max\n");
+    for (int s = 0; s < JITTER_SERIES_COUNT; s++) {
+        for (int set = 0; set < JITTER_SET_COUNT; set++) {
+            jitter_stats_read((jitter_series_t)s, (jitter_set_t)set, &js);
+            cli_printf("  %-6s %-6s %7lu %9.1f %7.1f %7ld %7.0f %7.0f %7.0f %7ld\n",
+                       jitter_series_name(s), (set == JITTER_WINDOW) ? "window" : "total",
+                       js.count, js.mean, jitter_stats_stddev(&js), js.min,
+                       jitter_stats_quantile(&js, 0.5), jitter_stats_quantile(&js, 0.99),
+                       jitter_stats_quantile(&js, 0.999), js.max);
+        }
+        cli_printf("  %-6s window started %lus ago\n", jitter_series_name(s),
+                   (uint32_t)((now_us - js.start_us) / 1000000));
+    }
+    cli_printf("Usage: jitter [reset [pps|gnss]]\n");
+}
+
+static void get_model_on_timing_core(void *arg) {
+    discipline_get_model((clock_model_t *)arg);
+}
+
+static void set_kalman_on_timing_core(void *arg) {
+    discipline_set_kalman(*(const bool *)arg);
+}
+
+/**
+ * Discipline steering law and clock model state
+ */
+static void cmd_disc(int argc, char **argv) {
+    if (argc >= 2 && (strcmp(argv[1], "pi") == 0 || strcmp(argv[1], "kalman") == 0)) {
+        bool kalman = strcmp(argv[1], "kalman") == 0;
+        timing_core_call(set_kalman_on_timing_core, &kalman);
+        cli_printf("Steering: %s\n", kalman ? "Kalman" : "PI");
+        return;
+    }
+
+    static clock_model_t m;     /* Static: keeps the model off the CLI stack */
+    timing_core_call(get_model_on_timing_core, &m);
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+
+    cli_printf("Discipline (%s steering):\n", discipline_is_kalman() ? "Kalman" : "PI");
+    cli_printf("  Correction:  %.3f ppb\n", snap.state.frequency_offset);
+    if (!m.initialized) {
+        cli_printf("  Clock model: acquiring\n");
+    } else {
+        cli_printf("  Phase:       %.1f ns (sigma %.1f)\n", m.x[0], sqrt(m.p[0][0]));
+        cli_printf("  Frequency:   %.3f ppb (sigma %.3f)\n", m.x[1], sqrt(m.p[1][1]));
+        cli_printf("  Drift:       %.3e ppb/s (sigma %.1e)\n", m.x[2], sqrt(m.p[2][2]));
+        cli_printf("  Time error:  %lu ns%s\n", snap.time_error_ns,
+                   m.predictions > 0 ? " (predicting, no PPS)" : "");
+    }
+    cli_printf("  Noise:       q1 %.2e  q2 %.2e  q3 %.2e  r %.1f\n", m.q1, m.q2, m.q3, m.r);
+    cli_printf("  Updates:     %lu (+%lu frequency), %lu outliers, %lu predictions\n",
+               m.updates, m.freq_updates, m.outliers, m.predictions);
+    cli_printf("Usage: disc [pi|kalman]\n");
+}
+
+/**
+ * Reference ensemble: per-source health, primary and GNSS steering
+ */
+static void cmd_ref(void) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    const ref_status_t *r = &snap.ref;
+
+    cli_printf("References (primary: %s, %lu switches):\n",
+               ref_source_name(r->primary), r->switches);
+    cli_printf("  %-10s %5s %6s %5s %12s %9s %7s\n",
+               "Source", "Avail", "Locked", "Score", "Jitter", "Samples", "Faults");
+    for (int i = 0; i < REF_COUNT; i++) {
+        const ref_health_t *h = &r->src[i];
+        cli_printf("  %-10s %5s %6s %5u %9.1f ns %9lu %7lu\n",
+                   ref_source_name(i), h->available ? "yes" : "no",
+                   h->locked ? "yes" : "no", h->score, h->jitter_ns,
+                   h->samples, h->faults);
+    }
+    cli_printf("  GNSS-Rb:   %ld ns (filtered), steering %s\n",
+               r->gnss_offset_ns, r->steering ? "active" : "off");
+    cli_printf("  Phase:     %ld ns at the primary edge, target %ld ns\n",
+               r->phase_ns, r->target_ns);
+}
+
+#if CHRONOS_PERF_TRACE
+/**
+ * Deferred log levels, statistics and record dump
+ */
+/**
+ * Log dump job: CLI_LOG_LINES records a step, seq up to limit
+ */
+static uint32_t step_log_dump(cli_job_t *job) {
+    char line[160];
+
+    for (int n = 0; n < CLI_LOG_LINES && job->seq != job->limit; n++, job->seq++) {
+        log_record_t rec;
+        if (!log_record_format(job->seq, &rec, line, sizeof(line))) {
+            continue;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        cli_printf("  %7lu.%06lu  %u     %-7s %-6s %s\n",
+                   rec.time_us / 1000000, rec.time_us % 1000000, rec.core,
+                   log_module_name((log_module_t)rec.module),
+                   log_level_name((log_level_t)rec.level), line);
+    }
+    return (job->seq == job->limit) ? CLI_JOB_DONE : 0;
+}
+
+static void cmd_log(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "dump") == 0) {
+        int n = (argc >= 3) ? atoi(argv[2]) : 20;
+        if (n <= 0 || n > LOG_RECORD_SLOTS) n = LOG_RECORD_SLOTS;
+
+        if (!cli_job_start("log dump", step_log_dump, 0)) {
+            return;
+        }
+        uint32_t head = log_record_head();
+        cli_job.seq = (head > (uint32_t)n) ? head - (uint32_t)n : 0;
+        cli_job.limit = head;
+        cli_printf("  Time (s)       Core  Module  Level  Message\n");
+        return;
+    }
+
+    if (argc >= 3) {
+        int level = log_level_from_name(argv[2]);
+        int module = log_module_from_name(argv[1]);
+        if (level < 0 || (module < 0 && strcmp(argv[1], "all") != 0)) {
+            cli_printf("Usage: log <module|all> <error|warn|info|debug>\n");
+            return;
+        }
+        for (int m = 0; m < LOG_MOD_COUNT; m++) {
+            if (module < 0 || m == module) {
+                log_set_level((log_module_t)m, (log_level_t)level);
+            }
+        }
+        cli_printf("Log level %s set to %s\n", argv[1], argv[2]);
+        return;
+    }
+
+    log_record_stats_t st;
+    log_record_get_stats(&st);
+    cli_printf("Deferred Log:\n");
+    cli_printf("  Records:  %lu written, %lu printed, %lu lost\n",
+               st.written, st.drained, st.lost);
+    cli_printf("  Levels:  ");
+    for (int m = 0; m < LOG_MOD_COUNT; m++) {
+        cli_printf(" %s=%s", log_module_name((log_module_t)m),
+                   log_level_name(log_get_level((log_module_t)m)));
+    }
+    cli_printf("\n");
+    cli_printf("Usage: log [<module|all> <level> | dump [n]]\n");
+}
+
+/**
+ * Cycle trace statistics, or the raw per-core event ring
+ */
+static void cmd_perf(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        perf_reset();
+        cli_printf("Trace statistics cleared\n");
+        return;
+    }
+
+    float mhz = clock_get_hz(clk_sys) / 1e6f;
+
+    if (argc >= 2 && strcmp(argv[1], "dump") == 0) {
+        static perf_event_t ev[PERF_RING_SIZE];
+        uint32_t core = (argc >= 3) ? (uint32_t)atoi(argv[2]) : 0;
+        int n = (argc >= 4) ? atoi(argv[3]) : 32;
+        if (n > PERF_RING_SIZE) n = PERF_RING_SIZE;
+
+        n = perf_ring_read(core, ev, n);
+        cli_printf("Core %lu trace, %d events (oldest first):\n", core, n);
+        cli_printf("  Raw                 Start       Probe           Cycles\n");
+        for (int i = 0; i < n; i++) {
+            cli_printf("  %08lx %08lx  %10lu  %-15s %8lu\n",
+                       ev[i].start, ev[i].info, ev[i].start,
+                       perf_probe_name((perf_probe_t)(ev[i].info >> 24)),
+                       ev[i].info & 0xFFFFFFu);
+        }
+        return;
+    }
+
+    cli_printf("Cycle Trace (%.0f MHz clock, cycles):\n", mhz);
+    cli_printf("  Probe              Count      Min      Avg      Max      P99  P99(us)\n");
+    for (int p = 0; p < PERF_PROBE_COUNT; p++) {
+        perf_stats_t st;
+        perf_get_stats((perf_probe_t)p, &st);
+        if (st.count == 0) {
+            continue;
+        }
+        cli_printf("  %-15s %9lu %8lu %8lu %8lu %8lu %8.1f\n",
+                   perf_probe_name((perf_probe_t)p), st.count, st.min,
+                   (uint32_t)(st.sum / st.count), st.max, st.p99, st.p99 / mhz);
+    }
+    cli_printf("Usage: perf [dump [core] [n] | reset]\n");
+}
+#else
+static void cmd_perf(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    cli_printf("Cycle tracing not built (configure with -DCHRONOS_PERF_TRACE=ON)\n");
+}
+#endif
+
+/**
+ * Scheduler task tables and core load
+ */
+static void cmd_sched(void) {
+    uint64_t now = time_us_64();
+
+    for (uint32_t core = 0; core < 2; core++) {
+        sched_stats_t st;
+        sched_get_stats(core, &st);
+        if (st.tasks == 0) {
+            continue;
+        }
+
+        uint64_t window = now - st.since_us;
+        cli_printf("Core %lu: %u tasks, %lu passes, %lu sleeps, %.1f%% busy\n",
+                   core, st.tasks, st.passes, st.sleeps,
+                   window ? 100.0 * (double)st.busy_us / (double)window : 0.0);
+        cli_printf("  Task       Period(us) Events       Runs  Max(us)\n");
+
+        sched_task_stats_t t;
+        for (int i = 0; sched_get_task_stats(core, i, &t); i++) {
+            cli_printf("  %-10s %10lu   0x%02lx %10lu %8lu\n",
+                       t.name, t.period_us, t.events, t.runs, t.max_us);
+        }
+    }
+}
+
+/**
+ * NTP/PTP load benchmark: start, step and stop it (normally driven by
+ * tools/load_gen.py over /api/cli), or show the steps and capacity
+ */
+static void cmd_bench(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+        uint32_t target = (argc >= 3) ? (uint32_t)atoi(argv[2]) : BENCH_P99_DEFAULT_US;
+        ip4_addr_t generator;
+        ip4_addr_set_zero(&generator);
+        if (argc >= 4 && !ip4addr_aton(argv[3], &generator)) {
+            cli_printf("Error: bad generator address '%s'\n", argv[3]);
+            return;
+        }
+        load_bench_start(target, ip4_addr_get_u32(&generator));
+        bench_status_t st;
+        load_bench_get_status(&st);
+        if (st.generator_addr != 0) {
+            cli_printf("Benchmark started, NTP p99 target %lu us, rate limits off for %s\n",
+                       st.p99_target_us, ip4addr_ntoa(&generator));
+        } else {
+            cli_printf("Benchmark started, NTP p99 target %lu us, rate limits on "
+                       "(no generator address)\n", st.p99_target_us);
+        }
+        return;
+    }
+    if (argc >= 3 && strcmp(argv[1], "step") == 0) {
+        if (!load_bench_step((uint32_t)atoi(argv[2]))) {
+            cli_printf("Error: no benchmark running or step table full\n");
+            return;
+        }
+        cli_printf("Step at %s req/s\n", argv[2]);
+        return;
+    }
+    if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        load_bench_stop();
+    }
+
+    static bench_step_t steps[BENCH_MAX_STEPS];
+    int n = load_bench_get_steps(steps, BENCH_MAX_STEPS);
+    bench_status_t st;
+    load_bench_get_status(&st);
+
+    if (argc >= 2 && strcmp(argv[1], "csv") == 0) {
+        cli_printf("version,offered,duration_ms,ntp_rx,ntp_served,ptp_rx,ptp_served,"
+                   "pbuf_errors,ntp_p50_us,ntp_p99_us,ptp_p99_us,pps_p99_ns,loop_p99_us,passed\n");
+        for (int i = 0; i < n; i++) {
+            const bench_step_t *s = &steps[i];
+            cli_printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f,%.1f,%.1f,%.0f,%.0f,%d\n",
+                       CHRONOS_VERSION_STRING, s->offered, s->duration_ms,
+                       s->ntp_rx, s->ntp_served, s->ptp_rx, s->ptp_served,
+                       s->pbuf_errors, s->ntp_p50_us, s->ntp_p99_us, s->ptp_p99_us,
+                       s->pps_p99_ns, s->loop_p99_us, s->passed ? 1 : 0);
+        }
+        return;
+    }
+
+    cli_printf("Load benchmark (firmware %s): %s, %lu steps, NTP p99 target %lu us\n",
+               CHRONOS_VERSION_STRING,
+               st.running ? (st.open ? "running, step open" : "running") : "stopped",
+               st.steps, st.p99_target_us);
+    if (n == 0) {
+        cli_printf("No steps recorded\n");
+        return;
+    }
+
+    cli_printf("  Offered  Time(s)   NTP/s   PTP/s  Unans  Pbuf  NTP p50  NTP p99  PTP p99  PPS p99  Loop p99\n");
+    cli_printf("  (req/s)                                            (us)     (us)     (us)     (ns)      (us)\n");
+    for (int i = 0; i < n; i++) {
+        const bench_step_t *s = &steps[i];
+        float secs = s->duration_ms / 1000.0f;
+        if (secs <= 0.0f) {
+            secs = 1.0f;
+        }
+        cli_printf("  %7lu %8.1f %7.0f %7.0f %6lu %5lu %8.0f %8.0f %8.0f %8.0f %9.0f  %s\n",
+                   s->offered, secs, s->ntp_served / secs, s->ptp_served / secs,
+                   (s->ntp_rx + s->ptp_rx) - (s->ntp_served + s->ptp_served),
+                   s->pbuf_errors, s->ntp_p50_us, s->ntp_p99_us, s->ptp_p99_us,
+                   s->pps_p99_ns, s->loop_p99_us, s->passed ? "ok" : "FAIL");
+    }
+    if (st.capacity != 0) {
+        cli_printf("Capacity: %lu req/s at NTP p99 <= %lu us\n", st.capacity, st.p99_target_us);
+    } else {
+        cli_printf("Capacity: no step passed\n");
+    }
+}
+
+static void resync_on_timing_core(void *arg) {
+    (void)arg;
+    force_time_resync();
+}
+
+/**
+ * Resync job: report the GNSS time a moment after the request
+ */
+static uint32_t step_sync(cli_job_t *job) {
+    (void)job;
     if (gnss_has_time()) {
         gnss_time_t t;
         gnss_get_utc_time(&t);
@@ -723,52 +1906,160 @@ static void cmd_sync(void) {
                    t.year, t.month, t.day, t.hour, t.minute, t.second);
         cli_printf("Time will be set on next GNSS update\n");
     }
+    return CLI_JOB_DONE;
 }
 
 /**
- * Live time display - outputs current time every second for 30 seconds
+ * Force time resync from GNSS
  */
-static void cmd_time_watch(void) {
-    printf("Live time display (30 seconds):\n");
-    printf("DEVICE     | GNSS     | UNIX_TS\n");
-
-    uint32_t last_sec = 0;
-    int count = 0;
-
-    while (count < 30) {
-        /* Feed watchdog to prevent reset */
-        watchdog_update();
-
-        /* Get current time */
-        timestamp_t ts = get_current_time();
-        uint32_t unix_sec = ts.seconds - 2208988800UL;  /* Convert NTP to Unix */
-
-        /* Only print on second change */
-        if (unix_sec != last_sec) {
-            last_sec = unix_sec;
-            count++;
-
-            /* Calculate HMS from Unix timestamp */
-            uint32_t secs = unix_sec % 86400;
-            uint32_t hours = secs / 3600;
-            uint32_t mins = (secs % 3600) / 60;
-            uint32_t sec = secs % 60;
-
-            /* Get GNSS time for comparison */
-            gnss_time_t gnss_t = {0};
-            if (gnss_has_time()) {
-                gnss_get_utc_time(&gnss_t);
-            }
+static void cmd_sync(void) {
+    if (!gnss_has_time()) {
+        cli_printf("Error: GNSS does not have valid time\n");
+        cli_printf("Wait for GNSS fix before syncing\n");
+        return;
+    }
+
+    /* Give the sync a moment to happen before reporting */
+    if (!cli_job_start("sync", step_sync, 100000)) {
+        return;
+    }
+    cli_printf("Forcing time resync from GNSS...\n");
+    timing_core_call(resync_on_timing_core, NULL);
+}
+
+/**
+ * Warm start state: show, save now, or clear
+ */
+static void cmd_warm(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "save") == 0) {
+        cli_printf(warm_start_save() ? "Discipline state saved\n" :
+                   "Not saved: discipline not locked\n");
+        return;
+    } else if (argc >= 2 && strcmp(argv[1], "clear") == 0) {
+        warm_start_clear();
+        cli_printf("Saved state cleared; next boot calibrates from scratch\n");
+        return;
+    }
+
+    warm_start_stats_t ws;
+    warm_start_get_stats(&ws);
+
+    cli_printf("Warm Start:\n");
+    if (ws.restored) {
+        if (ws.restored_age_s > 0) {
+            cli_printf("  This boot:   warm (state %lus old)\n", ws.restored_age_s);
+        } else {
+            cli_printf("  This boot:   warm (Rb stayed locked)\n");
+        }
+    } else {
+        cli_printf("  This boot:   cold\n");
+    }
+    if (ws.saved_valid) {
+        cli_printf("  Integrator:  %.3f ppb\n", ws.integral_ppb);
+        cli_printf("  Drift:       %.3f ppb/day\n", ws.drift_ppb_day);
+        cli_printf("  Saved at:    %lu (Unix), after %lus locked\n",
+                   ws.saved_unix, ws.lock_seconds);
+    } else {
+        cli_printf("  Saved state: none\n");
+    }
+    cli_printf("  Saves:       %lu this boot, %lu failed\n", ws.saves, ws.save_failures);
+    cli_printf("Usage: warm [save|clear]\n");
+}
+
+/**
+ * Grid report job: print reports from seq until end_us
+ */
+static uint32_t step_acfreq_report(cli_job_t *job) {
+    ac_grid_report_t r;
+    while (job->seq < ac_freq_report_count()) {
+        if (ac_freq_get_report(job->seq++, &r)) {
+            cli_printf("%llu.%03lu | %9.6f | %+10.3f | %+.3f\n",
+                       r.unix_us / 1000000ULL,
+                       (unsigned long)((r.unix_us / 1000) % 1000),
+                       r.freq_uhz * 1e-6, r.rocof_mhz_s * 1e-3,
+                       r.grid_time_error_ns * 1e-6);
+        }
+    }
+
+    if (time_us_64() >= job->end_us) {
+        cli_printf("Done.\n");
+        return CLI_JOB_DONE;
+    }
+    return 20000;
+}
+
+/**
+ * AC mains: status, or stream the per-window grid reports
+ */
+static void cmd_acfreq(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "report") != 0) {
+        ac_freq_print_status();
+        return;
+    }
+
+    int seconds = (argc >= 3) ? atoi(argv[2]) : 30;
+    if (seconds <= 0) {
+        seconds = 30;
+    }
+    if (!cli_job_start("acfreq report", step_acfreq_report, 0)) {
+        return;
+    }
+    cli_job.seq = ac_freq_report_count();
+    cli_job.end_us = time_us_64() + (uint64_t)seconds * 1000000ULL;
+
+    cli_printf("Grid reports every %d cycles (%d seconds):\n", AC_REPORT_CYCLES, seconds);
+    cli_printf("UNIX_TS        | FREQ Hz   | ROCOF Hz/s | GTE ms\n");
+}
 
-            printf("%02lu:%02lu:%02lu | %02d:%02d:%02d | %lu\n",
+/**
+ * Live time job: a line on each second change, seq lines up to limit
+ */
+static uint32_t step_time_watch(cli_job_t *job) {
+    /* Get current time */
+    timestamp_t ts = get_current_time();
+    uint32_t unix_sec = ts.seconds - 2208988800UL;  /* Convert NTP to Unix */
+
+    /* Only print on second change */
+    if (unix_sec != job->last) {
+        job->last = unix_sec;
+        job->seq++;
+
+        /* Calculate HMS from Unix timestamp */
+        uint32_t secs = unix_sec % 86400;
+        uint32_t hours = secs / 3600;
+        uint32_t mins = (secs % 3600) / 60;
+        uint32_t sec = secs % 60;
+
+        /* Get GNSS time for comparison */
+        gnss_time_t gnss_t = {0};
+        if (gnss_has_time()) {
+            gnss_get_utc_time(&gnss_t);
+        }
+
+        cli_printf("%02lu:%02lu:%02lu | %02d:%02d:%02d | %lu\n",
                    (unsigned long)hours, (unsigned long)mins, (unsigned long)sec,
                    gnss_t.hour, gnss_t.minute, gnss_t.second,
                    (unsigned long)unix_sec);
-        }
+    }
 
-        sleep_ms(50);
+    if (job->seq >= job->limit) {
+        cli_printf("Done.\n");
+        return CLI_JOB_DONE;
     }
-    printf("Done.\n");
+    return 50000;
+}
+
+/**
+ * Live time display - outputs current time every second for 30 seconds
+ */
+static void cmd_time_watch(void) {
+    if (!cli_job_start("watch", step_time_watch, 0)) {
+        return;
+    }
+    cli_job.limit = 30;
+
+    cli_printf("Live time display (30 seconds):\n");
+    cli_printf("DEVICE     | GNSS     | UNIX_TS\n");
 }
 
 /**
@@ -834,6 +2125,25 @@ static void cmd_gnss(int argc, char **argv) {
  * COMMAND PROCESSOR
  *============================================================================*/
 
+/* Commands that reconfigure timing outputs run on the timing core so they
+ * never race pulse_output_task()/radio_timecode_task() or touch IRQs that
+ * are enabled on the other core */
+typedef struct {
+    void (*fn)(int argc, char **argv);
+    int argc;
+    char **argv;
+} timing_cmd_t;
+
+static void timing_cmd_trampoline(void *arg) {
+    timing_cmd_t *cmd = (timing_cmd_t *)arg;
+    cmd->fn(cmd->argc, cmd->argv);
+}
+
+static void run_on_timing_core(void (*fn)(int, char **), int argc, char **argv) {
+    timing_cmd_t cmd = { fn, argc, argv };
+    timing_core_call(timing_cmd_trampoline, &cmd);
+}
+
 /**
  * Process a complete command line
  */
@@ -859,7 +2169,7 @@ static void process_command(char *line) {
     } else if (strcmp(argv[0], "pins") == 0) {
         cmd_pins();
     } else if (strcmp(argv[0], "acfreq") == 0) {
-        ac_freq_print_status();
+        cmd_acfreq(argc, argv);
     } else if (strcmp(argv[0], "debug") == 0) {
         cmd_debug(argc, argv);
     } else if (strcmp(argv[0], "config") == 0) {
@@ -869,17 +2179,51 @@ static void process_command(char *line) {
     } else if (strcmp(argv[0], "wifi") == 0) {
         cmd_wifi(argc, argv);
     } else if (strcmp(argv[0], "pulse") == 0) {
-        cmd_pulse(argc, argv);
+        run_on_timing_core(cmd_pulse, argc, argv);
     } else if (strcmp(argv[0], "rf") == 0) {
-        cmd_rf(argc, argv);
+        run_on_timing_core(cmd_rf, argc, argv);
     } else if (strcmp(argv[0], "nmea") == 0) {
-        cmd_nmea(argc, argv);
+        run_on_timing_core(cmd_nmea, argc, argv);
+    } else if (strcmp(argv[0], "irig") == 0) {
+        run_on_timing_core(cmd_irig, argc, argv);
     } else if (strcmp(argv[0], "gnss") == 0) {
-        cmd_gnss(argc, argv);
+        run_on_timing_core(cmd_gnss, argc, argv);
+    } else if (strcmp(argv[0], "link") == 0) {
+        cmd_link(argc, argv);
+#if CHRONOS_ETH_W5500
+    } else if (strcmp(argv[0], "eth") == 0) {
+        cmd_eth(argc, argv);
+#endif
+    } else if (strcmp(argv[0], "ntp") == 0) {
+        cmd_ntp(argc, argv);
+    } else if (strcmp(argv[0], "nts") == 0) {
+        cmd_nts(argc, argv);
+    } else if (strcmp(argv[0], "ptp") == 0) {
+        cmd_ptp(argc, argv);
+    } else if (strcmp(argv[0], "adev") == 0) {
+        cmd_adev(argc, argv);
+    } else if (strcmp(argv[0], "jitter") == 0) {
+        cmd_jitter(argc, argv);
+    } else if (strcmp(argv[0], "history") == 0) {
+        cmd_history(argc, argv);
+    } else if (strcmp(argv[0], "perf") == 0) {
+        cmd_perf(argc, argv);
+    } else if (strcmp(argv[0], "sched") == 0) {
+        cmd_sched();
+    } else if (strcmp(argv[0], "bench") == 0) {
+        cmd_bench(argc, argv);
+    } else if (strcmp(argv[0], "log") == 0) {
+        cmd_log(argc, argv);
     } else if (strcmp(argv[0], "sync") == 0) {
         cmd_sync();
     } else if (strcmp(argv[0], "watch") == 0) {
         cmd_time_watch();
+    } else if (strcmp(argv[0], "disc") == 0) {
+        cmd_disc(argc, argv);
+    } else if (strcmp(argv[0], "ref") == 0) {
+        cmd_ref();
+    } else if (strcmp(argv[0], "warm") == 0) {
+        cmd_warm(argc, argv);
     } else {
         cli_printf("Unknown command: %s\n", argv[0]);
         cli_printf("Type 'help' for available commands\n");
@@ -890,6 +2234,12 @@ static void process_command(char *line) {
  * PUBLIC API
  *============================================================================*/
 
+/* Runs in the stdio driver's IRQ */
+static void cli_chars_available(void *param) {
+    (void)param;
+    sched_post(SCHED_EV_STDIO);
+}
+
 /**
  * Initialize CLI
  */
@@ -898,31 +2248,26 @@ void cli_init(void) {
     memset(cli_buffer, 0, sizeof(cli_buffer));
     cli_initialized = true;
 
+    stdio_set_chars_available_callback(cli_chars_available, NULL);
+
     printf("\nType 'help' for available commands\n");
     printf(CLI_PROMPT);
 }
 
 /**
- * Process CLI input - call from main loop
+ * Handle one console character
  */
-void cli_task(void) {
-    if (!cli_initialized) {
-        return;
-    }
-
-    int c = getchar_timeout_us(0);
-
-    if (c == PICO_ERROR_TIMEOUT) {
-        return;
-    }
-
+static void cli_handle_char(int c) {
     if (c == '\r' || c == '\n') {
         /* End of line - process command */
         printf("\n");
         cli_buffer[cli_buffer_pos] = '\0';
         process_command(cli_buffer);
         cli_buffer_pos = 0;
-        printf(CLI_PROMPT);
+        if (cli_job.step == NULL || cli_job.web) {
+            /* A console job prints the prompt when it ends */
+            printf(CLI_PROMPT);
+        }
     } else if (c == '\b' || c == 127) {
         /* Backspace */
         if (cli_buffer_pos > 0) {
@@ -944,39 +2289,86 @@ void cli_task(void) {
 }
 
 /**
- * Execute a CLI command and capture output to buffer
+ * Process CLI input - woken when console input arrives - and step the
+ * running job
  */
-int cli_execute(const char *cmd, char *out_buf, size_t out_len) {
-    if (out_buf == NULL || out_len == 0) {
-        /* No buffer - just execute with printf output */
-        char cmd_copy[CLI_BUFFER_SIZE];
-        strncpy(cmd_copy, cmd, sizeof(cmd_copy) - 1);
-        cmd_copy[sizeof(cmd_copy) - 1] = '\0';
-        process_command(cmd_copy);
-        return 0;
+void cli_task(void) {
+    if (!cli_initialized) {
+        return;
+    }
+
+    /* Drain everything received since the last wakeup */
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (cli_job.step != NULL && !cli_job.web) {
+            /* The console belongs to the job: Ctrl+C stops it, other
+             * input is dropped */
+            if (c == 0x03) {
+                printf("^C\n");
+                cli_job_end();
+            }
+            continue;
+        }
+        cli_handle_char(c);
     }
 
-    /* Set up output buffer */
-    cli_out_buf = out_buf;
-    cli_out_len = out_len;
-    cli_out_pos = 0;
-    out_buf[0] = '\0';
+    cli_job_run();
+}
+
+/**
+ * Run a command for the web with its output going to the stream
+ */
+bool cli_stream_start(const char *cmd) {
+    if (cli_stream.open) {
+        return false;
+    }
+    cli_stream.open = true;
+    cli_stream.head = 0;
+    cli_stream.released = 0;
 
-    /* Copy and process command */
     char cmd_copy[CLI_BUFFER_SIZE];
     strncpy(cmd_copy, cmd, sizeof(cmd_copy) - 1);
     cmd_copy[sizeof(cmd_copy) - 1] = '\0';
 
-    char *trimmed = trim(cmd_copy);
-    if (strlen(trimmed) > 0) {
-        process_command(trimmed);
+    cli_to_stream = true;
+    process_command(cmd_copy);
+    cli_to_stream = false;
+    return true;
+}
+
+size_t cli_stream_copy(uint32_t pos, char *buf, size_t len) {
+    if (pos >= cli_stream.head || pos < cli_stream.released) {
+        return 0;
     }
 
-    /* Clear output buffer pointer */
-    int result = cli_out_pos;
-    cli_out_buf = NULL;
-    cli_out_len = 0;
-    cli_out_pos = 0;
+    size_t n = cli_stream.head - pos;
+    if (n > len) {
+        n = len;
+    }
+    uint32_t at = pos % CLI_STREAM_SIZE;
+    size_t first = CLI_STREAM_SIZE - at;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(buf, cli_stream.buf + at, first);
+    memcpy(buf + first, cli_stream.buf, n - first);
+    return n;
+}
 
-    return result;
+void cli_stream_release(uint32_t pos) {
+    if (pos > cli_stream.released && pos <= cli_stream.head) {
+        cli_stream.released = pos;
+    }
+}
+
+bool cli_stream_done(uint32_t pos) {
+    return pos >= cli_stream.head && !(cli_job.step != NULL && cli_job.web);
+}
+
+void cli_stream_close(void) {
+    if (cli_job.step != NULL && cli_job.web) {
+        /* Reader gone */
+        cli_job.step = NULL;
+    }
+    cli_stream.open = false;
 }
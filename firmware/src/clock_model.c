@@ -0,0 +1,204 @@
+/**
+ * CHRONOS-Rb Clock Model
+ *
+ * State x = [phase, frequency, drift], one PPS per step:
+ *
+ *   F = | 1  dt  dt^2/2 |     x' = F x - [u dt, 0, 0]
+ *       | 0  1   dt     |     P' = F P F^T + Q(dt)
+ *       | 0  0   1      |
+ *
+ *   Q = | q1 dt + q2 dt^3/3 + q3 dt^5/20   q2 dt^2/2 + q3 dt^4/8   q3 dt^3/6 |
+ *       |                     .            q2 dt + q3 dt^3/3       q3 dt^2/2 |
+ *       |                     .                    .               q3 dt     |
+ *
+ * and the measurement is phase (H = [1 0 0]), or frequency (H = [0 1 0])
+ * when a counter measures it directly.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "clock_model.h"
+
+/* Initial uncertainty on acquisition: crystal tolerance and aging */
+#define INIT_PHASE_VAR      1e6         /* (1 µs)^2 */
+#define INIT_FREQ_VAR       1e10        /* (100 ppm)^2 */
+#define INIT_DRIFT_VAR      1e-2        /* (0.1 ppb/s)^2 */
+
+/*============================================================================
+ * PRIVATE FUNCTIONS
+ *============================================================================*/
+
+static void init_covariance(clock_model_t *m, double freq_var) {
+    memset(m->p, 0, sizeof(m->p));
+    m->p[0][0] = INIT_PHASE_VAR;
+    m->p[1][1] = freq_var;
+    m->p[2][2] = INIT_DRIFT_VAR;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void clock_model_reset(clock_model_t *m) {
+    memset(m, 0, sizeof(*m));
+    m->q1 = CLOCK_MODEL_Q1_FLOOR;
+    m->q2 = CLOCK_MODEL_Q2_FLOOR;
+    m->q3 = CLOCK_MODEL_Q3_FLOOR;
+    m->r = CLOCK_MODEL_MEAS_NOISE_NS * CLOCK_MODEL_MEAS_NOISE_NS;
+    init_covariance(m, INIT_FREQ_VAR);
+}
+
+void clock_model_seed(clock_model_t *m, double freq_ppb, double freq_sigma_ppb) {
+    m->x[0] = 0.0;
+    m->x[1] = freq_ppb;
+    m->x[2] = 0.0;
+    init_covariance(m, freq_sigma_ppb * freq_sigma_ppb);
+    m->initialized = false;     /* Phase taken from the next sample */
+    m->outlier_run = 0;
+}
+
+void clock_model_predict(clock_model_t *m, double dt, double u_ppb) {
+    double (*p)[3] = m->p;
+    double dt2 = dt * dt;
+    double dt3 = dt2 * dt;
+
+    m->x[0] += (m->x[1] - u_ppb) * dt + m->x[2] * dt2 * 0.5;
+    m->x[1] += m->x[2] * dt;
+
+    /* P = F P F^T, written out for the upper-triangular F */
+    double a[3][3];
+    for (int j = 0; j < 3; j++) {
+        a[0][j] = p[0][j] + dt * p[1][j] + 0.5 * dt2 * p[2][j];
+        a[1][j] = p[1][j] + dt * p[2][j];
+        a[2][j] = p[2][j];
+    }
+    for (int i = 0; i < 3; i++) {
+        p[i][0] = a[i][0] + dt * a[i][1] + 0.5 * dt2 * a[i][2];
+        p[i][1] = a[i][1] + dt * a[i][2];
+        p[i][2] = a[i][2];
+    }
+
+    double q1 = m->q1, q2 = m->q2, q3 = m->q3;
+    p[0][0] += q1 * dt + q2 * dt3 / 3.0 + q3 * dt3 * dt2 / 20.0;
+    p[0][1] += q2 * dt2 / 2.0 + q3 * dt2 * dt2 / 8.0;
+    p[0][2] += q3 * dt3 / 6.0;
+    p[1][1] += q2 * dt + q3 * dt3 / 3.0;
+    p[1][2] += q3 * dt2 / 2.0;
+    p[2][2] += q3 * dt;
+    p[1][0] = p[0][1];
+    p[2][0] = p[0][2];
+    p[2][1] = p[1][2];
+
+    m->predictions++;
+}
+
+bool clock_model_update(clock_model_t *m, double phase_ns) {
+    double (*p)[3] = m->p;
+
+    if (!m->initialized) {
+        m->x[0] = phase_ns;
+        p[0][0] = m->r;
+        p[0][1] = p[1][0] = 0.0;
+        p[0][2] = p[2][0] = 0.0;
+        m->initialized = true;
+        m->predictions = 0;
+        return true;
+    }
+
+    double s = p[0][0] + m->r;
+    double y = phase_ns - m->x[0];
+
+    /* A phase step or a glitched edge: keep predicting, and re-acquire
+     * if it persists */
+    if (y * y > CLOCK_MODEL_GATE_SIGMA * CLOCK_MODEL_GATE_SIGMA * s) {
+        m->outliers++;
+        if (++m->outlier_run >= CLOCK_MODEL_MAX_OUTLIERS) {
+            m->x[0] = phase_ns;
+            init_covariance(m, p[1][1] + INIT_PHASE_VAR);
+            p[0][0] = m->r;
+            m->outlier_run = 0;
+        }
+        return false;
+    }
+    m->outlier_run = 0;
+
+    double k[3] = { p[0][0] / s, p[1][0] / s, p[2][0] / s };
+    for (int i = 0; i < 3; i++) {
+        m->x[i] += k[i] * y;
+    }
+
+    double row0[3] = { p[0][0], p[0][1], p[0][2] };
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            p[i][j] -= k[i] * row0[j];
+            p[j][i] = p[i][j];
+        }
+    }
+
+    m->updates++;
+    m->predictions = 0;
+    return true;
+}
+
+bool clock_model_update_freq(clock_model_t *m, double freq_ppb, double var) {
+    double (*p)[3] = m->p;
+
+    if (!m->initialized) {
+        return false;
+    }
+
+    double s = p[1][1] + var;
+    double y = freq_ppb - m->x[1];
+    if (y * y > CLOCK_MODEL_GATE_SIGMA * CLOCK_MODEL_GATE_SIGMA * s) {
+        m->outliers++;
+        return false;
+    }
+
+    double k[3] = { p[0][1] / s, p[1][1] / s, p[2][1] / s };
+    for (int i = 0; i < 3; i++) {
+        m->x[i] += k[i] * y;
+    }
+
+    double row1[3] = { p[1][0], p[1][1], p[1][2] };
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++) {
+            p[i][j] -= k[i] * row1[j];
+            p[j][i] = p[i][j];
+        }
+    }
+
+    m->freq_updates++;
+    return true;
+}
+
+double clock_model_steer(const clock_model_t *m, double dt, double tau_s) {
+    return m->x[1] + m->x[2] * dt * 0.5 + m->x[0] / tau_s;
+}
+
+double clock_model_time_error_ns(const clock_model_t *m) {
+    double var = m->p[0][0] > 0.0 ? m->p[0][0] : 0.0;
+    return fabs(m->x[0]) + sqrt(var);
+}
+
+void clock_model_fit_noise(clock_model_t *m, const stability_point_t *pts, int n) {
+    double q1 = INFINITY, q2 = INFINITY, q3 = INFINITY;
+
+    for (int i = 0; i < n; i++) {
+        if (pts[i].adev_n < CLOCK_MODEL_FIT_MIN_N) {
+            continue;
+        }
+        double tau = (double)pts[i].tau_s;
+        double v = pts[i].adev * pts[i].adev * 1e18;    /* ns^2/s^2 */
+        q1 = fmin(q1, v * tau);
+        q2 = fmin(q2, 3.0 * v / tau);
+        q3 = fmin(q3, 20.0 * v / (tau * tau * tau));
+    }
+
+    m->q1 = isfinite(q1) ? fmax(q1, CLOCK_MODEL_Q1_FLOOR) : CLOCK_MODEL_Q1_FLOOR;
+    m->q2 = isfinite(q2) ? fmax(q2, CLOCK_MODEL_Q2_FLOOR) : CLOCK_MODEL_Q2_FLOOR;
+    m->q3 = isfinite(q3) ? fmax(q3, CLOCK_MODEL_Q3_FLOOR) : CLOCK_MODEL_Q3_FLOOR;
+}
@@ -3,30 +3,79 @@
  *
  * Persistent configuration stored in flash memory.
  *
+ * The reserved flash area is an append-only journal. Each sector starts
+ * with a header carrying a sequence number; the sector with the highest
+ * one is active. It holds a full snapshot of config_t, then one record
+ * per save covering the bytes that changed since the last save. Boot
+ * replays the active sector. A save is normally one or two page
+ * programs; only when the active sector is full is the next one erased
+ * and started with a fresh snapshot, its header written last so a power
+ * cut leaves the old sector in charge.
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include "pico/stdlib.h"
 #include "pico/flash.h"
 #include "hardware/flash.h"
 #include "hardware/sync.h"
 
+#include "chronos_rb.h"
 #include "config.h"
+#include "nmea_output.h"
 
 /*============================================================================
  * FLASH STORAGE CONFIGURATION
  *============================================================================*/
 
-/* Use the reserved filesystem area for config storage */
-/* With 8KB reserved, config goes at 4MB - 8KB to avoid UF2 wraparound issue */
-#define FLASH_TARGET_OFFSET (PICO_FLASH_SIZE_BYTES - (8 * 1024))
+/* Reserved filesystem area at the end of flash (PFB_RESERVED_FILESYSTEM_SIZE_KB,
+ * kept clear of the UF2 wraparound issue) */
+#ifndef CHRONOS_CONFIG_FLASH_KB
+#define CHRONOS_CONFIG_FLASH_KB     8
+#endif
+#define FLASH_TARGET_OFFSET (PICO_FLASH_SIZE_BYTES - (CHRONOS_CONFIG_FLASH_KB * 1024))
 
 /* Pointer to config in flash (read-only) */
 #define FLASH_CONFIG_ADDR   (XIP_BASE + FLASH_TARGET_OFFSET)
 
+/* Layout of the last whole-image config (firmware before the journal) */
+#define CONFIG_V4_CRC_OFFSET    232
+
+#define JOURNAL_SECTORS     ((CHRONOS_CONFIG_FLASH_KB * 1024) / FLASH_SECTOR_SIZE)
+#define JOURNAL_MAGIC       0x4C4E524A  /* "JRNL" */
+#define JOURNAL_REC_DATA    0x01        /* Bytes of config_t at offset */
+#define JOURNAL_REC_ERASED  0xFF
+
+#if JOURNAL_SECTORS < 2
+#error "Config journal needs at least two flash sectors"
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               /* Highest valid sequence is active */
+    uint32_t seq_inv;           /* ~seq, guards against a torn header */
+    uint32_t reserved;
+} journal_header_t;
+
+typedef struct {
+    uint8_t tag;                /* JOURNAL_REC_*, 0xFF = end of log */
+    uint8_t reserved;
+    uint16_t offset;            /* Into config_t */
+    uint16_t len;
+    uint16_t reserved2;
+} journal_record_t;             /* Followed by data, CRC32, pad to 4 */
+
+#define JOURNAL_REC_SIZE(len)   ((sizeof(journal_record_t) + (len) + 4 + 3) & ~3u)
+#define JOURNAL_SNAPSHOT_SIZE   JOURNAL_REC_SIZE(sizeof(config_t))
+
+_Static_assert(offsetof(config_t, unit_secret_flags) ==
+               offsetof(config_t, unit_secret) + CONFIG_SECRET_SIZE,
+               "config_save_secret() writes unit_secret and its flags as one record");
+
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -34,6 +83,16 @@
 static config_t current_config;
 static bool config_initialized = false;
 
+/* Journal state: what flash holds (replayed image), where it goes next */
+static config_t stored_config;
+static int journal_sector = -1;         /* Active sector, -1 = none */
+static uint32_t journal_seq = 0;
+static uint32_t journal_pos = 0;        /* Next record offset in the sector */
+static bool journal_compact_pending = false;
+static uint32_t journal_records = 0;    /* Replayed at boot */
+static uint32_t journal_appends = 0;
+static uint32_t journal_compactions = 0;
+
 /*============================================================================
  * CRC32 IMPLEMENTATION
  *============================================================================*/
@@ -88,34 +147,70 @@ static void config_set_defaults(void) {
     current_config.rf_jjy40_enabled = true;
     current_config.rf_jjy60_enabled = true;
 
-    /* NMEA output - enabled by default */
+    /* NMEA output - enabled by default, all sentences */
     current_config.nmea_enabled = true;
+    current_config.nmea_baud_100 = NMEA_BAUD_DEFAULT / 100;
+    current_config.nmea_sentences = NMEA_SENT_ALL;
 
     /* GNSS receiver - enabled by default */
     current_config.gnss_enabled = true;
 
+    /* PTP master - 1 Sync/s, default BMCA priorities */
+    current_config.ptp_sync_log = PTP_SYNC_LOG_DEFAULT;
+    current_config.ptp_priority1 = PTP_PRIORITY1;
+    current_config.ptp_priority2 = PTP_PRIORITY2;
+
+    /* NTP broadcast - off, interleaved every 64 s when turned on */
+    current_config.ntp_bcast_enabled = false;
+    current_config.ntp_bcast_multicast = false;
+    current_config.ntp_bcast_xleave = true;
+    current_config.ntp_bcast_auth = false;
+    current_config.ntp_bcast_log = NTP_BCAST_LOG_DEFAULT;
+
+    /* WiFi - power save off while serving time */
+    current_config.wifi_pm_mode = WIFI_PM_LOW_LATENCY;
+    current_config.wifi_listen_dtim = WIFI_LISTEN_DTIM_DEFAULT;
+    current_config.wifi_pm2_sleep_10ms = WIFI_PM2_SLEEP_MS_DEFAULT / 10;
+
     /* Pulse outputs - all disabled by default */
     memset(current_config.pulse_configs, 0, sizeof(current_config.pulse_configs));
 }
 
 /**
- * Validate configuration structure
+ * Check magic and version (current, or older for migration)
  */
-static bool config_validate(const config_t *cfg) {
+static bool config_validate_header(const config_t *cfg) {
     if (cfg->magic != CONFIG_MAGIC) {
         return false;
     }
 
     /* Accept current version or previous versions for migration */
-    if (cfg->version != CONFIG_VERSION && cfg->version != 1 && cfg->version != 2 && cfg->version != 3) {
+    if (cfg->version != CONFIG_VERSION && cfg->version != 1 && cfg->version != 2 &&
+        cfg->version != 3 && cfg->version != 4 && cfg->version != 5 &&
+        cfg->version != 6 && cfg->version != 7 && cfg->version != 8 &&
+        cfg->version != 9) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Validate a legacy whole-image configuration
+ */
+static bool config_validate(const config_t *cfg) {
+    if (!config_validate_header(cfg)) {
         return false;
     }
 
-    /* Compute CRC over everything except the CRC field itself */
-    size_t crc_offset = offsetof(config_t, crc32);
-    uint32_t computed_crc = crc32_compute(cfg, crc_offset);
+    /* Compute CRC over everything except the CRC field itself. Only
+     * v4 firmware wrote whole images before the journal; its CRC sits
+     * where the warm-start record starts now. */
+    size_t crc_offset = (cfg->version == 4) ? CONFIG_V4_CRC_OFFSET : offsetof(config_t, crc32);
+    uint32_t stored_crc;
+    memcpy(&stored_crc, (const uint8_t *)cfg + crc_offset, sizeof(stored_crc));
 
-    if (cfg->crc32 != computed_crc) {
+    if (stored_crc != crc32_compute(cfg, crc_offset)) {
         return false;
     }
 
@@ -146,6 +241,59 @@ static void config_migrate(void) {
         printf("[CONFIG] Migrating from v3 to v4...\n");
         /* v3 -> v4: Add pulse output storage (initialize to empty) */
         memset(current_config.pulse_configs, 0, sizeof(current_config.pulse_configs));
+        current_config.version = 4;
+    }
+    if (current_config.version == 4) {
+        printf("[CONFIG] Migrating from v4 to v5...\n");
+        /* v4 -> v5: Add warm-start state (none saved yet) */
+        memset(&current_config.warm, 0, sizeof(current_config.warm));
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
+        current_config.version = 5;
+    }
+    if (current_config.version == 5) {
+        printf("[CONFIG] Migrating from v5 to v6...\n");
+        /* v5 -> v6: NMEA baud and sentence set in former reserved bytes */
+        current_config.nmea_baud_100 = NMEA_BAUD_DEFAULT / 100;
+        current_config.nmea_sentences = NMEA_SENT_ALL;
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
+        current_config.version = 6;
+    }
+    if (current_config.version == 6) {
+        printf("[CONFIG] Migrating from v6 to v7...\n");
+        /* v6 -> v7: PTP Sync rate and BMCA priorities in former reserved bytes */
+        current_config.ptp_sync_log = PTP_SYNC_LOG_DEFAULT;
+        current_config.ptp_priority1 = PTP_PRIORITY1;
+        current_config.ptp_priority2 = PTP_PRIORITY2;
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
+        current_config.version = 7;
+    }
+    if (current_config.version == 7) {
+        printf("[CONFIG] Migrating from v7 to v8...\n");
+        /* v7 -> v8: NTP broadcast settings (the record grew) */
+        current_config.ntp_bcast_enabled = false;
+        current_config.ntp_bcast_multicast = false;
+        current_config.ntp_bcast_xleave = true;
+        current_config.ntp_bcast_auth = false;
+        current_config.ntp_bcast_log = NTP_BCAST_LOG_DEFAULT;
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
+        current_config.version = 8;
+    }
+    if (current_config.version == 8) {
+        printf("[CONFIG] Migrating from v8 to v9...\n");
+        /* v8 -> v9: WiFi power management (the record grew) */
+        current_config.wifi_pm_mode = WIFI_PM_LOW_LATENCY;
+        current_config.wifi_listen_dtim = WIFI_LISTEN_DTIM_DEFAULT;
+        current_config.wifi_pm2_sleep_10ms = WIFI_PM2_SLEEP_MS_DEFAULT / 10;
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
+        current_config.version = 9;
+    }
+    if (current_config.version == 9) {
+        printf("[CONFIG] Migrating from v9 to v10...\n");
+        /* v9 -> v10: unit secret (the record grew); unit_secret_init()
+         * generates one */
+        memset(current_config.unit_secret, 0, sizeof(current_config.unit_secret));
+        current_config.unit_secret_flags = 0;
+        memset(current_config.reserved, 0, sizeof(current_config.reserved));
         current_config.version = CONFIG_VERSION;
     }
 }
@@ -162,63 +310,325 @@ void config_init(void) {
         printf("[CONFIG] No valid config found, using defaults\n");
         config_set_defaults();
     } else {
-        printf("[CONFIG] Configuration loaded from flash\n");
+        printf("[CONFIG] Configuration loaded from flash (%lu journal records)\n",
+               journal_records);
+        uint32_t version = current_config.version;
         config_migrate();  /* Upgrade older config versions */
+
+        /* Records are offsets into one layout: never append new-layout
+         * records on an old-layout snapshot */
+        if (current_config.version != version) {
+            journal_compact_pending = true;
+        }
     }
     config_initialized = true;
 }
 
-/* Buffer for flash write - must be static so it persists during callback */
-static uint8_t flash_write_buffer[FLASH_PAGE_SIZE];
+/*============================================================================
+ * FLASH JOURNAL
+ *============================================================================*/
+
+static inline const uint8_t *sector_ptr(int sector) {
+    return (const uint8_t *)(FLASH_CONFIG_ADDR + (uint32_t)sector * FLASH_SECTOR_SIZE);
+}
+
+static inline uint32_t sector_offset(int sector) {
+    return FLASH_TARGET_OFFSET + (uint32_t)sector * FLASH_SECTOR_SIZE;
+}
+
+static bool header_valid(const journal_header_t *h) {
+    return h->magic == JOURNAL_MAGIC && h->seq_inv == ~h->seq;
+}
+
+/**
+ * Check a record in flash at pos. Returns its size, 0 at the end of the
+ * log, -1 if it is torn or corrupt.
+ */
+static int record_check(const uint8_t *sector, uint32_t pos) {
+    if (pos + sizeof(journal_record_t) > FLASH_SECTOR_SIZE) {
+        return 0;
+    }
+    const journal_record_t *r = (const journal_record_t *)(sector + pos);
+    if (r->tag == JOURNAL_REC_ERASED) {
+        return 0;
+    }
+    if (r->tag != JOURNAL_REC_DATA ||
+        (uint32_t)r->offset + r->len > sizeof(config_t) ||
+        pos + JOURNAL_REC_SIZE(r->len) > FLASH_SECTOR_SIZE) {
+        return -1;
+    }
+
+    uint32_t crc;
+    memcpy(&crc, sector + pos + sizeof(journal_record_t) + r->len, sizeof(crc));
+    if (crc32_compute(r, sizeof(journal_record_t) + r->len) != crc) {
+        return -1;
+    }
+    return (int)JOURNAL_REC_SIZE(r->len);
+}
+
+/**
+ * Find the active sector and replay it into stored_config
+ */
+static bool journal_replay(void) {
+    journal_sector = -1;
+    for (int i = 0; i < JOURNAL_SECTORS; i++) {
+        const journal_header_t *h = (const journal_header_t *)sector_ptr(i);
+        if (header_valid(h) &&
+            (journal_sector < 0 || (int32_t)(h->seq - journal_seq) > 0)) {
+            journal_sector = i;
+            journal_seq = h->seq;
+        }
+    }
+    if (journal_sector < 0) {
+        return false;
+    }
+
+    const uint8_t *sector = sector_ptr(journal_sector);
+    uint32_t pos = sizeof(journal_header_t);
+    int n = record_check(sector, pos);
+    const journal_record_t *first = (const journal_record_t *)(sector + pos);
+
+    /* Log must open with a snapshot; one from an older, shorter config_t
+     * leaves the new fields 0xFF for config_migrate() */
+    if (n <= 0 || first->offset != 0 || first->len < offsetof(config_t, wifi_enabled)) {
+        journal_sector = -1;
+        return false;
+    }
+
+    while (n > 0) {
+        const journal_record_t *r = (const journal_record_t *)(sector + pos);
+        memcpy((uint8_t *)&stored_config + r->offset, r + 1, r->len);
+        journal_records++;
+        pos += (uint32_t)n;
+        n = record_check(sector, pos);
+    }
+    journal_pos = pos;
+
+    if (n < 0) {
+        /* Torn append: the bytes after it are no longer erased */
+        printf("[CONFIG] Journal record at %lu corrupt, replay stopped\n", pos);
+        journal_compact_pending = true;
+    }
+    return stored_config.magic == CONFIG_MAGIC;
+}
+
+/* Page images for one flash operation - static so they persist during
+ * the callback. Sized for the largest record starting late in a page. */
+#define JOURNAL_BUF_PAGES   ((FLASH_PAGE_SIZE - 4 + JOURNAL_SNAPSHOT_SIZE + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+static uint8_t flash_write_buffer[JOURNAL_BUF_PAGES * FLASH_PAGE_SIZE];
+
+typedef struct {
+    bool erase;
+    uint32_t sector_off;        /* Flash offset of the sector */
+    uint32_t page_off;          /* Offset of the first page in the sector */
+    uint32_t pages;
+    bool header;                /* Then program the header page */
+    journal_header_t hdr;
+} flash_job_t;
+
+static flash_job_t flash_job;
 
 /**
  * Flash write callback - called with interrupts disabled and safe to write flash
  */
 static void flash_write_callback(void *param) {
-    (void)param;
+    const flash_job_t *job = (const flash_job_t *)param;
+
+    if (job->erase) {
+        flash_range_erase(job->sector_off, FLASH_SECTOR_SIZE);
+    }
 
-    /* Erase the sector first */
-    flash_range_erase(FLASH_TARGET_OFFSET, FLASH_SECTOR_SIZE);
+    /* Programming only clears bits: 0xFF around the record leaves
+     * earlier records in the same page untouched */
+    flash_range_program(job->sector_off + job->page_off, flash_write_buffer,
+                        job->pages * FLASH_PAGE_SIZE);
 
-    /* Write the config */
-    flash_range_program(FLASH_TARGET_OFFSET, flash_write_buffer, FLASH_PAGE_SIZE);
+    if (job->header) {
+        memset(flash_write_buffer, 0xFF, FLASH_PAGE_SIZE);
+        memcpy(flash_write_buffer, &job->hdr, sizeof(job->hdr));
+        flash_range_program(job->sector_off, flash_write_buffer, FLASH_PAGE_SIZE);
+    }
 }
 
 /**
- * Save current configuration to flash
+ * Stage a record for bytes [offset, offset + len) of image at pos in
+ * the sector
  */
-bool config_save(void) {
-    /* Compute CRC before saving */
-    size_t crc_offset = offsetof(config_t, crc32);
-    current_config.crc32 = crc32_compute(&current_config, crc_offset);
-
-    /* Prepare aligned buffer (flash writes require 256-byte alignment) */
+static void journal_stage(const config_t *image, uint32_t pos, uint16_t offset, uint16_t len) {
+    journal_record_t r = {
+        .tag = JOURNAL_REC_DATA,
+        .reserved = 0,
+        .offset = offset,
+        .len = len,
+        .reserved2 = 0
+    };
+    uint8_t rec[JOURNAL_SNAPSHOT_SIZE];
+    uint32_t size = JOURNAL_REC_SIZE(len);
+
+    memset(rec, 0, size);
+    memcpy(rec, &r, sizeof(r));
+    memcpy(rec + sizeof(r), (const uint8_t *)image + offset, len);
+    uint32_t crc = crc32_compute(rec, sizeof(r) + len);
+    memcpy(rec + sizeof(r) + len, &crc, sizeof(crc));
+
+    flash_job.page_off = pos & ~(uint32_t)(FLASH_PAGE_SIZE - 1);
+    flash_job.pages = (pos + size - flash_job.page_off + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
     memset(flash_write_buffer, 0xFF, sizeof(flash_write_buffer));
-    memcpy(flash_write_buffer, &current_config, sizeof(current_config));
-
-    /* Use flash_safe_execute which properly handles WiFi/lwIP background tasks */
-    int result = flash_safe_execute(flash_write_callback, NULL, UINT32_MAX);
+    memcpy(flash_write_buffer + (pos - flash_job.page_off), rec, size);
+}
 
+static bool journal_run(void) {
+    int result = flash_safe_execute(flash_write_callback, &flash_job, UINT32_MAX);
     if (result != PICO_OK) {
         printf("[CONFIG] Flash write failed (error %d)\n", result);
         return false;
     }
+    return true;
+}
+
+/**
+ * Start the next sector with a snapshot of image
+ */
+static bool journal_compact(const config_t *image) {
+    int next = (journal_sector < 0) ? 1 : (journal_sector + 1) % JOURNAL_SECTORS;
+    uint32_t seq = journal_seq + 1;
+
+    journal_stage(image, sizeof(journal_header_t), 0, sizeof(config_t));
+    flash_job.erase = true;
+    flash_job.sector_off = sector_offset(next);
+    flash_job.header = true;
+    flash_job.hdr.magic = JOURNAL_MAGIC;
+    flash_job.hdr.seq = seq;
+    flash_job.hdr.seq_inv = ~seq;
+    flash_job.hdr.reserved = 0xFFFFFFFF;
+
+    if (!journal_run()) {
+        return false;
+    }
+
+    journal_sector = next;
+    journal_seq = seq;
+    journal_pos = sizeof(journal_header_t) + JOURNAL_SNAPSHOT_SIZE;
+    journal_compact_pending = false;
+    journal_compactions++;
+    return true;
+}
+
+/**
+ * Bring flash to image: append the bytes that differ from what flash
+ * holds, or compact
+ */
+static bool journal_write(const config_t *image) {
+    const uint8_t *cur = (const uint8_t *)image;
+    const uint8_t *old = (const uint8_t *)&stored_config;
+    int first = -1, last = -1;
+    for (int i = 0; i < (int)sizeof(config_t); i++) {
+        if (cur[i] != old[i]) {
+            if (first < 0) first = i;
+            last = i;
+        }
+    }
+
+    bool ok;
+    if (journal_sector < 0 || journal_compact_pending) {
+        ok = journal_compact(image);
+    } else if (first < 0) {
+        printf("[CONFIG] Configuration unchanged\n");
+        return true;
+    } else {
+        uint16_t len = (uint16_t)(last - first + 1);
+        if (journal_pos + JOURNAL_REC_SIZE(len) > FLASH_SECTOR_SIZE) {
+            ok = journal_compact(image);
+        } else {
+            journal_stage(image, journal_pos, (uint16_t)first, len);
+            flash_job.erase = false;
+            flash_job.sector_off = sector_offset(journal_sector);
+            flash_job.header = false;
+            ok = journal_run();
+            if (ok) {
+                journal_pos += JOURNAL_REC_SIZE(len);
+                journal_appends++;
+            }
+        }
+    }
 
-    printf("[CONFIG] Configuration saved to flash\n");
+    if (!ok) {
+        return false;
+    }
+    memcpy(&stored_config, image, sizeof(config_t));
+    printf("[CONFIG] Configuration saved to flash (sector %d, %lu/%u bytes)\n",
+           journal_sector, journal_pos, FLASH_SECTOR_SIZE);
     return true;
 }
 
 /**
- * Load configuration from flash
+ * Save current configuration to flash
+ */
+bool config_save(void) {
+    return journal_write(&current_config);
+}
+
+/**
+ * Save len bytes at offset of config_t from src, on top of what flash
+ * holds rather than the live settings
+ */
+static bool journal_write_field(size_t offset, const void *src, size_t len) {
+    static config_t image;  /* Static: keeps config_t off the caller's stack */
+
+    /* Until flash holds a journal the first save writes everything */
+    if (journal_sector < 0 || journal_compact_pending) {
+        memcpy(&image, &current_config, sizeof(image));
+    } else {
+        memcpy(&image, &stored_config, sizeof(image));
+    }
+    memcpy((uint8_t *)&image + offset, src, len);
+    memcpy((uint8_t *)&current_config + offset, src, len);
+
+    return journal_write(&image);
+}
+
+/**
+ * Save only the warm-start record
+ */
+bool config_save_warm(const config_warm_t *warm) {
+    return journal_write_field(offsetof(config_t, warm), warm, sizeof(*warm));
+}
+
+/**
+ * Save only the unit secret; the flags byte follows it, so one record
+ * covers both
+ */
+bool config_save_secret(const uint8_t secret[CONFIG_SECRET_SIZE]) {
+    uint8_t field[CONFIG_SECRET_SIZE + 1];
+    bool ok;
+
+    memcpy(field, secret, CONFIG_SECRET_SIZE);
+    field[CONFIG_SECRET_SIZE] = CONFIG_SECRET_VALID;
+    ok = journal_write_field(offsetof(config_t, unit_secret), field, sizeof(field));
+    memset(field, 0, sizeof(field));
+    return ok;
+}
+
+/**
+ * Load configuration from flash: replay the journal, or fall back to a
+ * whole config_t image written by firmware before the journal
  */
 bool config_load(void) {
-    const config_t *flash_config = (const config_t *)FLASH_CONFIG_ADDR;
+    memset(&stored_config, 0xFF, sizeof(stored_config));
+
+    if (journal_replay()) {
+        memcpy(&current_config, &stored_config, sizeof(current_config));
+        return config_validate_header(&current_config);
+    }
 
+    const config_t *flash_config = (const config_t *)FLASH_CONFIG_ADDR;
     if (!config_validate(flash_config)) {
         return false;
     }
 
     memcpy(&current_config, flash_config, sizeof(current_config));
+    journal_compact_pending = true;
+    printf("[CONFIG] Legacy config image found, converting to journal on next save\n");
     return true;
 }
 
@@ -226,7 +636,15 @@ bool config_load(void) {
  * Reset configuration to defaults
  */
 void config_reset(void) {
+    uint8_t secret[CONFIG_SECRET_SIZE];
+    uint8_t flags = current_config.unit_secret_flags;
+
+    /* Settings only: the keys clients have pinned stay */
+    memcpy(secret, current_config.unit_secret, sizeof(secret));
     config_set_defaults();
+    memcpy(current_config.unit_secret, secret, sizeof(secret));
+    current_config.unit_secret_flags = flags;
+    memset(secret, 0, sizeof(secret));
     printf("[CONFIG] Configuration reset to defaults\n");
 }
 
@@ -280,6 +698,9 @@ void config_print(void) {
     } else {
         printf("  SSID:           (not configured)\n");
     }
+    printf("  Power mode:     %s, listen %u DTIM, PM2 sleep %u ms\n",
+           wifi_pm_mode_name(current_config.wifi_pm_mode), current_config.wifi_listen_dtim,
+           (unsigned)current_config.wifi_pm2_sleep_10ms * 10);
     printf("\n");
 
     printf("Radio Timecode Outputs:\n");
@@ -290,13 +711,30 @@ void config_print(void) {
     printf("\n");
 
     printf("Serial Outputs:\n");
-    printf("  NMEA:            %s\n", current_config.nmea_enabled ? "Enabled" : "Disabled");
+    printf("  NMEA:            %s, %lu baud, sentences 0x%02X\n",
+           current_config.nmea_enabled ? "Enabled" : "Disabled",
+           (uint32_t)current_config.nmea_baud_100 * 100, current_config.nmea_sentences);
     printf("\n");
 
     printf("GNSS Receiver:\n");
     printf("  GNSS Input:      %s\n", current_config.gnss_enabled ? "Enabled" : "Disabled");
     printf("\n");
 
+    printf("PTP Master:\n");
+    printf("  Sync interval:   log2 %d\n", current_config.ptp_sync_log);
+    printf("  Priority1/2:     %u/%u\n",
+           current_config.ptp_priority1, current_config.ptp_priority2);
+    printf("\n");
+
+    printf("NTP Broadcast:\n");
+    printf("  Broadcast:       %s, every 2^%d s to %s\n",
+           current_config.ntp_bcast_enabled ? "Enabled" : "Disabled",
+           current_config.ntp_bcast_log,
+           current_config.ntp_bcast_multicast ? "224.0.1.1" : "subnet");
+    printf("  Interleaved:     %s\n", current_config.ntp_bcast_xleave ? "Yes" : "No");
+    printf("  MAC:             %s\n", current_config.ntp_bcast_auth ? "AES-CMAC" : "None");
+    printf("\n");
+
     printf("Pulse Outputs:\n");
     bool any_pulse = false;
     for (int i = 0; i < CONFIG_MAX_PULSE_OUTPUTS; i++) {
@@ -316,6 +754,14 @@ void config_print(void) {
     printf("  Magic:          0x%08lX %s\n", current_config.magic,
            current_config.magic == CONFIG_MAGIC ? "(valid)" : "(INVALID)");
     printf("  Version:        %lu\n", current_config.version);
+    if (journal_sector >= 0) {
+        printf("  Journal:        sector %d/%d seq %lu, %lu/%u bytes used\n",
+               journal_sector, JOURNAL_SECTORS, journal_seq, journal_pos, FLASH_SECTOR_SIZE);
+    } else {
+        printf("  Journal:        empty\n");
+    }
+    printf("  Saves:          %lu appended, %lu compactions since boot\n",
+           journal_appends, journal_compactions);
     printf("\n");
 }
 
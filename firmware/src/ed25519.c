@@ -0,0 +1,326 @@
+/**
+ * CHRONOS-Rb Ed25519 Signing
+ *
+ * Field elements mod 2^255-19 are sixteen 16-bit limbs held in int64_t,
+ * the compact TweetNaCl representation: every product fits a 64-bit
+ * accumulator without intermediate carries, at the cost of 256
+ * multiplies per field multiplication. Points are extended twisted
+ * Edwards coordinates (X:Y:Z:T), and the scalar ladder swaps in
+ * constant time, so timing does not depend on the secret.
+ *
+ * The point and scalar work areas are static to keep the stack under
+ * 1KB, so signing is not reentrant: only the network core calls it.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+
+#include "ed25519.h"
+#include "sha512.h"
+
+/*============================================================================
+ * FIELD ARITHMETIC
+ *============================================================================*/
+
+typedef int64_t fe[16];
+
+static const fe fe_zero = {0};
+static const fe fe_one = {1};
+
+/* 2 * d, d = -121665/121666 */
+static const fe fe_d2 = {
+    0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+    0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406
+};
+
+/* Base point */
+static const fe base_x = {
+    0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+    0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169
+};
+static const fe base_y = {
+    0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+    0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666
+};
+
+/* Group order L = 2^252 + 27742317777372353535851937790883648493 */
+static const int64_t order_l[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+static void fe_copy(fe o, const fe a) {
+    memcpy(o, a, sizeof(fe));
+}
+
+static void fe_carry(fe o) {
+    for (int i = 0; i < 16; i++) {
+        o[i] += (int64_t)1 << 16;
+        int64_t c = o[i] >> 16;
+        /* Carry out of the top limb wraps round as 2^256 = 38 */
+        if (i < 15) {
+            o[i + 1] += c - 1;
+        } else {
+            o[0] += 38 * (c - 1);
+        }
+        o[i] -= c << 16;
+    }
+}
+
+/* Swap p and q when b is 1, without branching on b */
+static void fe_cswap(fe p, fe q, int b) {
+    int64_t mask = ~((int64_t)b - 1);
+    for (int i = 0; i < 16; i++) {
+        int64_t t = mask & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+/* Fully reduced little-endian encoding */
+static void fe_pack(uint8_t *o, const fe n) {
+    fe m, t;
+    fe_copy(t, n);
+    fe_carry(t);
+    fe_carry(t);
+    fe_carry(t);
+
+    for (int j = 0; j < 2; j++) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int b = (int)((m[15] >> 16) & 1);
+        m[14] &= 0xffff;
+        fe_cswap(t, m, 1 - b);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        o[2 * i] = (uint8_t)(t[i] & 0xff);
+        o[2 * i + 1] = (uint8_t)(t[i] >> 8);
+    }
+}
+
+static void fe_add(fe o, const fe a, const fe b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] + b[i];
+}
+
+static void fe_sub(fe o, const fe a, const fe b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] - b[i];
+}
+
+static void fe_mul(fe o, const fe a, const fe b) {
+    int64_t t[31] = {0};
+
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) {
+            t[i + j] += a[i] * b[j];
+        }
+    }
+    for (int i = 0; i < 15; i++) {
+        t[i] += 38 * t[i + 16];
+    }
+    for (int i = 0; i < 16; i++) {
+        o[i] = t[i];
+    }
+    fe_carry(o);
+    fe_carry(o);
+}
+
+/* a^(p-2) */
+static void fe_invert(fe o, const fe a) {
+    fe c;
+    fe_copy(c, a);
+    for (int i = 253; i >= 0; i--) {
+        fe_mul(c, c, c);
+        if (i != 2 && i != 4) {
+            fe_mul(c, c, a);
+        }
+    }
+    fe_copy(o, c);
+}
+
+/*============================================================================
+ * GROUP OPERATIONS
+ *============================================================================*/
+
+typedef fe ge[4];               /* X, Y, Z, T with x = X/Z, y = Y/Z, xy = T/Z */
+
+/* p += q (complete, so it also doubles) */
+static void ge_add(ge p, const ge q) {
+    static fe a, b, c, d, t, e, f, g, h;
+
+    fe_sub(a, p[1], p[0]);
+    fe_sub(t, q[1], q[0]);
+    fe_mul(a, a, t);
+    fe_add(b, p[0], p[1]);
+    fe_add(t, q[0], q[1]);
+    fe_mul(b, b, t);
+    fe_mul(c, p[3], q[3]);
+    fe_mul(c, c, fe_d2);
+    fe_mul(d, p[2], q[2]);
+    fe_add(d, d, d);
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+
+    fe_mul(p[0], e, f);
+    fe_mul(p[1], h, g);
+    fe_mul(p[2], g, f);
+    fe_mul(p[3], e, h);
+}
+
+static void ge_cswap(ge p, ge q, int b) {
+    for (int i = 0; i < 4; i++) {
+        fe_cswap(p[i], q[i], b);
+    }
+}
+
+static void ge_pack(uint8_t *r, ge p) {
+    fe tx, ty, zi;
+    uint8_t x[32];
+
+    fe_invert(zi, p[2]);
+    fe_mul(tx, p[0], zi);
+    fe_mul(ty, p[1], zi);
+    fe_pack(r, ty);
+    fe_pack(x, tx);
+    r[31] ^= (uint8_t)((x[0] & 1) << 7);
+}
+
+/* p = s * B, Montgomery-ladder style over all 256 bits */
+static void ge_scalarmult_base(ge p, const uint8_t *s) {
+    static ge q;
+
+    fe_copy(q[0], base_x);
+    fe_copy(q[1], base_y);
+    fe_copy(q[2], fe_one);
+    fe_mul(q[3], base_x, base_y);
+
+    fe_copy(p[0], fe_zero);
+    fe_copy(p[1], fe_one);
+    fe_copy(p[2], fe_one);
+    fe_copy(p[3], fe_zero);
+
+    for (int i = 255; i >= 0; i--) {
+        int b = (s[i / 8] >> (i & 7)) & 1;
+        ge_cswap(p, q, b);
+        ge_add(q, p);
+        ge_add(p, p);
+        ge_cswap(p, q, b);
+    }
+}
+
+/*============================================================================
+ * SCALARS MOD L
+ *============================================================================*/
+
+/* r = x mod L for a 64-limb little-endian radix-2^8 input */
+static void sc_reduce_limbs(uint8_t *r, int64_t x[64]) {
+    int64_t carry;
+    int i, j;
+
+    for (i = 63; i >= 32; i--) {
+        carry = 0;
+        for (j = i - 32; j < i - 12; j++) {
+            x[j] += carry - 16 * x[i] * order_l[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry << 8;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+
+    carry = 0;
+    for (j = 0; j < 32; j++) {
+        x[j] += carry - (x[31] >> 4) * order_l[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (j = 0; j < 32; j++) {
+        x[j] -= carry * order_l[j];
+    }
+    for (i = 0; i < 32; i++) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = (uint8_t)(x[i] & 255);
+    }
+}
+
+/* Reduce a 64-byte hash in place to 32 bytes mod L */
+static void sc_reduce(uint8_t *r) {
+    static int64_t x[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = r[i];
+    }
+    memset(r, 0, 64);
+    sc_reduce_limbs(r, x);
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void ed25519_key_from_seed(ed25519_key_t *key, const uint8_t seed[ED25519_SEED_SIZE]) {
+    uint8_t h[SHA512_DIGEST_SIZE];
+    static ge a;
+
+    sha512(seed, ED25519_SEED_SIZE, h);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+
+    memcpy(key->scalar, h, 32);
+    memcpy(key->prefix, h + 32, 32);
+
+    ge_scalarmult_base(a, key->scalar);
+    ge_pack(key->pub, a);
+
+    memset(h, 0, sizeof(h));
+}
+
+void ed25519_sign(const ed25519_key_t *key, const void *msg, size_t len,
+                  uint8_t sig[ED25519_SIG_SIZE]) {
+    uint8_t r[SHA512_DIGEST_SIZE];
+    uint8_t k[SHA512_DIGEST_SIZE];
+    static int64_t x[64];
+    static ge p;
+    sha512_ctx_t ctx;
+
+    /* r = H(prefix || M) mod L, R = rB */
+    sha512_init(&ctx);
+    sha512_update(&ctx, key->prefix, 32);
+    sha512_update(&ctx, msg, len);
+    sha512_final(&ctx, r);
+    sc_reduce(r);
+
+    ge_scalarmult_base(p, r);
+    ge_pack(sig, p);
+
+    /* k = H(R || A || M) mod L */
+    sha512_init(&ctx);
+    sha512_update(&ctx, sig, 32);
+    sha512_update(&ctx, key->pub, ED25519_PUBKEY_SIZE);
+    sha512_update(&ctx, msg, len);
+    sha512_final(&ctx, k);
+    sc_reduce(k);
+
+    /* S = r + k * a mod L */
+    memset(x, 0, sizeof(x));
+    for (int i = 0; i < 32; i++) {
+        x[i] = r[i];
+    }
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            x[i + j] += (int64_t)k[i] * key->scalar[j];
+        }
+    }
+    sc_reduce_limbs(sig + 32, x);
+
+    memset(r, 0, sizeof(r));
+}
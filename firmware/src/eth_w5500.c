@@ -0,0 +1,613 @@
+/**
+ * CHRONOS-Rb Wired Ethernet (WIZnet W5500)
+ *
+ * MACRAW netif driver. Every SPI transaction is a 3 byte header (offset,
+ * block select, read/write) followed by the data; payloads go through a
+ * pair of DMA channels so a frame costs one wait instead of a byte loop.
+ * All chip access happens with the lwIP lock held - linkoutput is only
+ * called by lwIP, and the task takes the lock to drain RX - so the
+ * background lwIP timers and the task never interleave transactions.
+ * See eth_w5500.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#include "chronos_rb.h"
+#include "eth_w5500.h"
+
+#if CHRONOS_ETH_W5500
+
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+#include "hardware/spi.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/etharp.h"
+#include "lwip/dhcp.h"
+#include "lwip/igmp.h"
+#include "netif/ethernet.h"
+
+#include "net_timestamp.h"
+#include "sched.h"
+
+/*============================================================================
+ * W5500 REGISTERS
+ *============================================================================*/
+
+#define ETH_SPI                 spi1
+
+/* Control byte: block select, read/write, variable length data mode */
+#define W5500_BSB(b)            ((uint8_t)((b) << 3))
+#define W5500_RWB_WRITE         0x04
+#define W5500_OM_VDM            0x00
+
+/* Blocks */
+#define W5500_BLOCK_COMMON      0x00
+#define W5500_BLOCK_S0_REG      0x01
+#define W5500_BLOCK_S0_TX       0x02
+#define W5500_BLOCK_S0_RX       0x03
+#define W5500_BLOCK_SN_REG(n)   ((n) * 4 + 1)
+
+/* Common registers */
+#define W5500_MR                0x0000
+#define W5500_MR_RST            0x80
+#define W5500_SHAR              0x0009
+#define W5500_SIMR              0x0018
+#define W5500_PHYCFGR           0x002E
+#define W5500_PHYCFGR_LNK       0x01
+#define W5500_PHYCFGR_SPD       0x02
+#define W5500_PHYCFGR_DPX       0x04
+#define W5500_VERSIONR          0x0039
+#define W5500_VERSION           0x04
+
+/* Socket registers */
+#define W5500_SN_MR             0x0000
+#define W5500_SN_MR_MACRAW      0x04
+#define W5500_SN_MR_MFEN        0x80    /* Own MAC, broadcast and multicast only */
+#define W5500_SN_CR             0x0001
+#define W5500_SN_CR_OPEN        0x01
+#define W5500_SN_CR_CLOSE       0x10
+#define W5500_SN_CR_SEND        0x20
+#define W5500_SN_CR_RECV        0x40
+#define W5500_SN_IR             0x0002
+#define W5500_SN_IR_SENDOK      0x10
+#define W5500_SN_IR_RECV        0x04
+#define W5500_SN_SR             0x0003
+#define W5500_SN_SR_MACRAW      0x42
+#define W5500_SN_RXBUF_SIZE     0x001E
+#define W5500_SN_TXBUF_SIZE     0x001F
+#define W5500_SN_TX_FSR         0x0020
+#define W5500_SN_TX_WR          0x0024
+#define W5500_SN_RX_RSR         0x0026
+#define W5500_SN_RX_RD          0x0028
+#define W5500_SN_IMR            0x002C
+
+#define W5500_SOCKETS           8
+#define W5500_CMD_TIMEOUT_US    1000
+#define W5500_RESET_TIMEOUT_US  10000
+
+/* MACRAW frames in the RX buffer carry a 2 byte length, itself included */
+#define ETH_RX_HDR_LEN          2
+#define ETH_FRAME_MIN           14
+#define ETH_FRAME_MAX           1514
+
+/* Below this a transfer is cheaper by polling than by setting up DMA */
+#define ETH_DMA_MIN             16
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static struct netif eth_netif;
+static bool eth_present = false;
+static bool eth_serving = true;
+static int32_t eth_latency = 0;
+
+static int dma_tx = -1;
+static int dma_rx = -1;
+static uint8_t dma_dummy;               /* Zeros out for reads, sink for writes */
+
+/* Last INTn edge (GPIO IRQ writer, task reader), 32-bit so it cannot tear */
+static volatile uint32_t irq_us32 = 0;
+static volatile bool irq_pending = false;
+
+static bool send_pending = false;       /* SEND issued, SENDOK not yet seen */
+static uint32_t last_link_poll = 0;
+static uint8_t phy_cfg = 0;
+
+static uint32_t rx_frames = 0;
+static uint32_t rx_irq_stamped = 0;
+static uint32_t rx_dropped = 0;
+static uint32_t rx_errors = 0;
+static uint32_t tx_frames = 0;
+static uint32_t tx_errors = 0;
+static uint32_t irq_latency_us = 0;
+static uint32_t tx_spi_us = 0;
+static uint32_t link_changes = 0;
+
+/*============================================================================
+ * SPI ACCESS
+ *============================================================================*/
+
+static void w5500_begin(uint16_t addr, uint8_t block, bool write) {
+    uint8_t hdr[3] = {
+        (uint8_t)(addr >> 8), (uint8_t)addr,
+        W5500_BSB(block) | (write ? W5500_RWB_WRITE : 0) | W5500_OM_VDM
+    };
+    gpio_put(GPIO_ETH_CS, 0);
+    spi_write_blocking(ETH_SPI, hdr, sizeof(hdr));
+}
+
+static inline void w5500_end(void) {
+    gpio_put(GPIO_ETH_CS, 1);
+}
+
+/**
+ * Clock len bytes through both FIFOs by DMA. The RX channel finishing
+ * means every byte has been shifted, in either direction.
+ */
+static void spi_dma(const uint8_t *src, uint8_t *dst, size_t len) {
+    dma_channel_config c = dma_channel_get_default_config(dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, src != NULL);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(ETH_SPI, true));
+    dma_channel_configure(dma_tx, &c, &spi_get_hw(ETH_SPI)->dr,
+                          src != NULL ? src : &dma_dummy, len, false);
+
+    c = dma_channel_get_default_config(dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, dst != NULL);
+    channel_config_set_dreq(&c, spi_get_dreq(ETH_SPI, false));
+    dma_channel_configure(dma_rx, &c, dst != NULL ? dst : &dma_dummy,
+                          &spi_get_hw(ETH_SPI)->dr, len, false);
+
+    dma_dummy = 0;
+    dma_start_channel_mask((1u << dma_tx) | (1u << dma_rx));
+    dma_channel_wait_for_finish_blocking(dma_rx);
+}
+
+static void w5500_read(uint16_t addr, uint8_t block, uint8_t *dst, size_t len) {
+    w5500_begin(addr, block, false);
+    if (len >= ETH_DMA_MIN) {
+        spi_dma(NULL, dst, len);
+    } else {
+        spi_read_blocking(ETH_SPI, 0, dst, len);
+    }
+    w5500_end();
+}
+
+static void w5500_write(uint16_t addr, uint8_t block, const uint8_t *src, size_t len) {
+    w5500_begin(addr, block, true);
+    if (len >= ETH_DMA_MIN) {
+        spi_dma(src, NULL, len);
+    } else {
+        spi_write_blocking(ETH_SPI, src, len);
+    }
+    w5500_end();
+}
+
+static uint8_t w5500_read8(uint16_t addr, uint8_t block) {
+    uint8_t v;
+    w5500_read(addr, block, &v, 1);
+    return v;
+}
+
+static void w5500_write8(uint16_t addr, uint8_t block, uint8_t v) {
+    w5500_write(addr, block, &v, 1);
+}
+
+static uint16_t w5500_read16(uint16_t addr, uint8_t block) {
+    uint8_t b[2];
+    w5500_read(addr, block, b, 2);
+    return ((uint16_t)b[0] << 8) | b[1];
+}
+
+static void w5500_write16(uint16_t addr, uint8_t block, uint16_t v) {
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    w5500_write(addr, block, b, 2);
+}
+
+/**
+ * The free/received size registers change while the chip works on the
+ * buffers; the datasheet asks for two equal reads
+ */
+static uint16_t w5500_read16_stable(uint16_t addr, uint8_t block) {
+    uint16_t a, b = w5500_read16(addr, block);
+    do {
+        a = b;
+        b = w5500_read16(addr, block);
+    } while (a != b);
+    return b;
+}
+
+/**
+ * Issue a socket 0 command and wait for the chip to take it
+ */
+static bool w5500_command(uint8_t cmd) {
+    w5500_write8(W5500_SN_CR, W5500_BLOCK_S0_REG, cmd);
+    uint64_t start = time_us_64();
+    while (w5500_read8(W5500_SN_CR, W5500_BLOCK_S0_REG) != 0) {
+        if (time_us_64() - start > W5500_CMD_TIMEOUT_US) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*============================================================================
+ * CHIP SETUP
+ *============================================================================*/
+
+/**
+ * (Re)open socket 0 in MACRAW mode with the RX interrupt on INTn
+ */
+static bool w5500_open(void) {
+    w5500_command(W5500_SN_CR_CLOSE);
+    w5500_write8(W5500_SN_MR, W5500_BLOCK_S0_REG, W5500_SN_MR_MACRAW | W5500_SN_MR_MFEN);
+    w5500_write8(W5500_SN_IMR, W5500_BLOCK_S0_REG, W5500_SN_IR_RECV);
+    w5500_write8(W5500_SN_IR, W5500_BLOCK_S0_REG, 0xFF);
+    send_pending = false;
+
+    if (!w5500_command(W5500_SN_CR_OPEN)) {
+        return false;
+    }
+    return w5500_read8(W5500_SN_SR, W5500_BLOCK_S0_REG) == W5500_SN_SR_MACRAW;
+}
+
+/**
+ * Software reset, then give socket 0 all the buffer memory
+ */
+static bool w5500_reset(const uint8_t mac[6]) {
+    w5500_write8(W5500_MR, W5500_BLOCK_COMMON, W5500_MR_RST);
+    uint64_t start = time_us_64();
+    while (w5500_read8(W5500_MR, W5500_BLOCK_COMMON) & W5500_MR_RST) {
+        if (time_us_64() - start > W5500_RESET_TIMEOUT_US) {
+            return false;
+        }
+    }
+    if (w5500_read8(W5500_VERSIONR, W5500_BLOCK_COMMON) != W5500_VERSION) {
+        return false;
+    }
+
+    w5500_write(W5500_SHAR, W5500_BLOCK_COMMON, mac, 6);
+    for (int s = 0; s < W5500_SOCKETS; s++) {
+        w5500_write8(W5500_SN_RXBUF_SIZE, W5500_BLOCK_SN_REG(s), s == 0 ? ETH_RX_BUF_KB : 0);
+        w5500_write8(W5500_SN_TXBUF_SIZE, W5500_BLOCK_SN_REG(s), s == 0 ? ETH_TX_BUF_KB : 0);
+    }
+    w5500_write8(W5500_SIMR, W5500_BLOCK_COMMON, 0x01);
+
+    return w5500_open();
+}
+
+/*============================================================================
+ * INTERRUPT
+ *============================================================================*/
+
+/**
+ * INTn falling edge: the chip has a frame. Keep the time of the first
+ * edge until the task has used it and wake the task.
+ */
+static void eth_int_irq(void) {
+    if (gpio_get_irq_event_mask(GPIO_ETH_INT) & GPIO_IRQ_EDGE_FALL) {
+        gpio_acknowledge_irq(GPIO_ETH_INT, GPIO_IRQ_EDGE_FALL);
+        if (!irq_pending) {
+            irq_us32 = time_us_32();
+            irq_pending = true;
+        }
+        sched_post(SCHED_EV_ETH);
+    }
+}
+
+/*============================================================================
+ * NETIF
+ *============================================================================*/
+
+/**
+ * Send one frame. The previous SEND has to have finished first; waiting
+ * for it here rather than after each SEND keeps that wait out of the
+ * time between a caller's send and its TX stamp.
+ */
+static err_t eth_linkoutput(struct netif *netif, struct pbuf *p) {
+    (void)netif;
+    uint64_t start = time_us_64();
+
+    if (p->tot_len > ETH_FRAME_MAX) {
+        tx_errors++;
+        return ERR_BUF;
+    }
+
+    if (send_pending) {
+        while (!(w5500_read8(W5500_SN_IR, W5500_BLOCK_S0_REG) & W5500_SN_IR_SENDOK)) {
+            if (time_us_64() - start > ETH_SEND_TIMEOUT_US) {
+                tx_errors++;
+                w5500_open();
+                return ERR_IF;
+            }
+        }
+        w5500_write8(W5500_SN_IR, W5500_BLOCK_S0_REG, W5500_SN_IR_SENDOK);
+        send_pending = false;
+    }
+
+    if (w5500_read16_stable(W5500_SN_TX_FSR, W5500_BLOCK_S0_REG) < p->tot_len) {
+        tx_errors++;
+        return ERR_MEM;
+    }
+
+    /* The chip wraps buffer offsets itself */
+    uint16_t wr = w5500_read16(W5500_SN_TX_WR, W5500_BLOCK_S0_REG);
+    for (const struct pbuf *q = p; q != NULL; q = q->next) {
+        w5500_write(wr, W5500_BLOCK_S0_TX, (const uint8_t *)q->payload, q->len);
+        wr += q->len;
+    }
+    w5500_write16(W5500_SN_TX_WR, W5500_BLOCK_S0_REG, wr);
+
+    w5500_write8(W5500_SN_CR, W5500_BLOCK_S0_REG, W5500_SN_CR_SEND);
+    uint64_t stamp = time_us_64();
+    send_pending = true;
+
+    net_ts_driver_tx(stamp);
+    tx_spi_us = (uint32_t)(stamp - start);
+    tx_frames++;
+    return ERR_OK;
+}
+
+static err_t eth_netif_init(struct netif *netif) {
+    netif->name[0] = 'e';
+    netif->name[1] = 'n';
+    netif->mtu = 1500;
+    netif->hwaddr_len = ETH_HWADDR_LEN;
+    netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP |
+                   NETIF_FLAG_ETHERNET | NETIF_FLAG_IGMP;
+    netif->output = etharp_output;
+    netif->linkoutput = eth_linkoutput;
+    netif_set_hostname(netif, "chronos-rb");
+    return ERR_OK;
+}
+
+/**
+ * Copy the frames waiting in the RX buffer into pbufs and hand them to
+ * lwIP (lwIP lock held). RECV is acknowledged first, so a frame arriving
+ * during the drain raises INTn again.
+ */
+static void eth_rx_drain(void) {
+    w5500_write8(W5500_SN_IR, W5500_BLOCK_S0_REG, W5500_SN_IR_RECV);
+
+    uint16_t avail = w5500_read16_stable(W5500_SN_RX_RSR, W5500_BLOCK_S0_REG);
+    if (avail == 0) {
+        return;
+    }
+    uint16_t rd = w5500_read16(W5500_SN_RX_RD, W5500_BLOCK_S0_REG);
+
+    for (int n = 0; n < ETH_RX_BURST && avail >= ETH_RX_HDR_LEN; n++) {
+        uint64_t now = time_us_64();
+        uint64_t stamp = now;
+
+        /* The edge belongs to the first frame read after it */
+        if (irq_pending) {
+            uint32_t age = (uint32_t)now - irq_us32;
+            irq_pending = false;
+            if (age < NET_TS_WAKE_MAX_US) {
+                stamp = now - age;
+                irq_latency_us = age;
+                rx_irq_stamped++;
+            }
+        }
+
+        uint8_t hdr[ETH_RX_HDR_LEN];
+        w5500_read(rd, W5500_BLOCK_S0_RX, hdr, sizeof(hdr));
+        uint16_t total = ((uint16_t)hdr[0] << 8) | hdr[1];
+        uint16_t len = total - ETH_RX_HDR_LEN;
+        if (total > avail || len < ETH_FRAME_MIN || len > ETH_FRAME_MAX) {
+            /* Lost framing: start over with an empty buffer */
+            rx_errors++;
+            w5500_open();
+            return;
+        }
+
+        struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+        if (p != NULL) {
+            uint16_t off = rd + ETH_RX_HDR_LEN;
+            for (struct pbuf *q = p; q != NULL; q = q->next) {
+                w5500_read(off, W5500_BLOCK_S0_RX, (uint8_t *)q->payload, q->len);
+                off += q->len;
+            }
+        }
+
+        /* Free the chip's copy before lwIP runs (and maybe replies) */
+        rd += total;
+        avail -= total;
+        w5500_write16(W5500_SN_RX_RD, W5500_BLOCK_S0_REG, rd);
+        w5500_command(W5500_SN_CR_RECV);
+
+        if (p == NULL) {
+            rx_dropped++;
+            continue;
+        }
+
+        net_ts_driver_rx(stamp);
+        rx_frames++;
+        if (eth_netif.input(p, &eth_netif) != ERR_OK) {
+            pbuf_free(p);
+        }
+    }
+
+    /* More than one burst waiting: come straight back */
+    if (avail >= ETH_RX_HDR_LEN) {
+        sched_wake_in(0);
+    }
+}
+
+/**
+ * Follow the PHY's link, speed and duplex
+ */
+static void eth_link_poll(void) {
+    uint8_t cfg = w5500_read8(W5500_PHYCFGR, W5500_BLOCK_COMMON);
+    bool up = (cfg & W5500_PHYCFGR_LNK) != 0;
+
+    if (up == netif_is_link_up(&eth_netif) && cfg == phy_cfg) {
+        return;
+    }
+    phy_cfg = cfg;
+    link_changes++;
+
+    if (up) {
+        netif_set_link_up(&eth_netif);
+        printf("[ETH] Link up, %s %s duplex\n",
+               (cfg & W5500_PHYCFGR_SPD) ? "100 Mbit/s" : "10 Mbit/s",
+               (cfg & W5500_PHYCFGR_DPX) ? "full" : "half");
+    } else {
+        netif_set_link_down(&eth_netif);
+        printf("[ETH] Link down\n");
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void eth_init(void) {
+    spi_init(ETH_SPI, ETH_SPI_HZ);
+    spi_set_format(ETH_SPI, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(GPIO_ETH_MISO, GPIO_FUNC_SPI);
+    gpio_set_function(GPIO_ETH_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(GPIO_ETH_MOSI, GPIO_FUNC_SPI);
+
+    gpio_init(GPIO_ETH_CS);
+    gpio_set_dir(GPIO_ETH_CS, GPIO_OUT);
+    gpio_put(GPIO_ETH_CS, 1);
+
+    gpio_init(GPIO_ETH_INT);
+    gpio_set_dir(GPIO_ETH_INT, GPIO_IN);
+    gpio_pull_up(GPIO_ETH_INT);
+
+    dma_tx = dma_claim_unused_channel(true);
+    dma_rx = dma_claim_unused_channel(true);
+
+    /* Locally administered address from the board ID */
+    pico_unique_board_id_t id;
+    pico_get_unique_board_id(&id);
+    uint8_t mac[6] = { 0x02, id.id[3], id.id[4], id.id[5], id.id[6], id.id[7] };
+
+    if (!w5500_reset(mac)) {
+        printf("[ETH] No W5500 on SPI1 (GP%d-%d)\n", GPIO_ETH_MISO, GPIO_ETH_MOSI);
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    netif_add(&eth_netif, IP4_ADDR_ANY4, IP4_ADDR_ANY4, IP4_ADDR_ANY4,
+              NULL, eth_netif_init, netif_input);
+    memcpy(eth_netif.hwaddr, mac, sizeof(mac));
+    netif_set_up(&eth_netif);
+    dhcp_start(&eth_netif);
+    cyw43_arch_lwip_end();
+
+    gpio_add_raw_irq_handler(GPIO_ETH_INT, eth_int_irq);
+    gpio_set_irq_enabled(GPIO_ETH_INT, GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    eth_present = true;
+    printf("[ETH] W5500 on SPI1 at %lu Hz, MAC %02x:%02x:%02x:%02x:%02x:%02x (DMA %d/%d)\n",
+           (unsigned long)spi_get_baudrate(ETH_SPI),
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], dma_tx, dma_rx);
+}
+
+void eth_task(void) {
+    if (!eth_present) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    eth_rx_drain();
+    if (time_us_32() - last_link_poll >= ETH_LINK_POLL_US) {
+        last_link_poll = time_us_32();
+        eth_link_poll();
+    }
+    cyw43_arch_lwip_end();
+}
+
+struct netif *eth_time_netif(void) {
+    if (!eth_present || !eth_serving || !netif_is_up(&eth_netif) ||
+        !netif_is_link_up(&eth_netif) || ip4_addr_isany_val(*netif_ip4_addr(&eth_netif))) {
+        return NULL;
+    }
+    return &eth_netif;
+}
+
+void eth_set_serving(bool enable) {
+    eth_serving = enable;
+    printf("[ETH] NTP/PTP on %s\n", enable ? "wired link when up" : "WiFi");
+}
+
+int32_t eth_latency_ns(void) {
+    return eth_latency;
+}
+
+void eth_set_latency_ns(int32_t ns) {
+    eth_latency = ns;
+}
+
+void eth_get_status(eth_status_t *status) {
+    memset(status, 0, sizeof(*status));
+    status->present = eth_present;
+    status->latency_ns = eth_latency;
+    if (!eth_present) {
+        return;
+    }
+
+    status->link_up = netif_is_link_up(&eth_netif);
+    status->speed_100 = (phy_cfg & W5500_PHYCFGR_SPD) != 0;
+    status->full_duplex = (phy_cfg & W5500_PHYCFGR_DPX) != 0;
+    status->serving = (eth_time_netif() != NULL);
+    status->ip_addr = ip4_addr_get_u32(netif_ip4_addr(&eth_netif));
+    memcpy(status->mac, eth_netif.hwaddr, sizeof(status->mac));
+    status->rx_frames = rx_frames;
+    status->rx_irq_stamped = rx_irq_stamped;
+    status->rx_dropped = rx_dropped;
+    status->rx_errors = rx_errors;
+    status->tx_frames = tx_frames;
+    status->tx_errors = tx_errors;
+    status->irq_latency_us = irq_latency_us;
+    status->tx_spi_us = tx_spi_us;
+    status->link_changes = link_changes;
+}
+
+#else /* !CHRONOS_ETH_W5500 */
+
+void eth_init(void) {
+}
+
+void eth_task(void) {
+}
+
+struct netif *eth_time_netif(void) {
+    return NULL;
+}
+
+void eth_set_serving(bool enable) {
+    (void)enable;
+}
+
+int32_t eth_latency_ns(void) {
+    return 0;
+}
+
+void eth_set_latency_ns(int32_t ns) {
+    (void)ns;
+}
+
+void eth_get_status(eth_status_t *status) {
+    memset(status, 0, sizeof(*status));
+}
+
+#endif /* CHRONOS_ETH_W5500 */
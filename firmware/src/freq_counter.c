@@ -1,8 +1,16 @@
 /**
  * CHRONOS-Rb Frequency Counter Module
  *
- * Hardware-only validation of PPS against 10MHz reference.
- * PIO counts 10MHz edges between PPS pulses - should be exactly 10,000,000.
+ * Hardware-only validation of PPS against 10MHz reference:
+ *   - Gate count: the Rb PPS capture SM latches a running 10MHz count at
+ *     each edge, so consecutive captures differ by exactly 10,000,000.
+ *   - Regression: a PIO SM stamps every FREQ_STAMP_EDGES 10MHz edges
+ *     against the system clock. A line fitted through the ~10k stamps of a
+ *     one second gate gives the local crystal against the 10MHz to ~0.1
+ *     ppb where the count resolves 100 ppb. The crystal also runs the time
+ *     base, so the clock model's frequency against the primary PPS turns
+ *     it into the 10MHz against the reference, and while the Rb is primary
+ *     it is a frequency measurement for the discipline loop.
  * No CPU involvement in timing-critical path.
  *
  * Copyright (c) 2025 - Open Source Hardware Project
@@ -10,22 +18,29 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
-#include "hardware/irq.h"
 #include "hardware/gpio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
 
 #include "chronos_rb.h"
 #include "freq_counter.pio.h"
+#include "perf_trace.h"
+#include "log_buffer.h"
+#include "ref_manager.h"
+#include "clock_model.h"
+#include "jitter_stats.h"
 
 /*============================================================================
  * CONFIGURATION
  *============================================================================*/
 
 /* PIO1 state machine allocation:
- *   SM0: freq_counter - counts 10MHz between FE PPS pulses
- *   SM1: (unused - appears broken, doesn't produce FIFO data)
+ *   SM0: freq_stamp - stamps 10MHz edge groups against the system clock
+ *   SM1: pps_generator
  *   SM2: fe_pps_capture - captures 10MHz count at FE PPS edge
  *   SM3: gps_pps_capture - captures 10MHz count at GPS PPS edge
  */
@@ -37,26 +52,53 @@ static uint gps_pps_sm = 3;  /* Try SM3 - SM1 appears broken */
 /* Expected count for 10MHz over 1 second */
 #define EXPECTED_COUNT 10000000UL
 
+/* Regression counter. 1000 edges = 100µs groups, 10k stamps per gate;
+ * the 256 entry ring covers 25ms, 2.5 polls of the PPS FIFO task. */
+#define FREQ_STAMP_EDGES        1000
+#define FREQ_TICK_CYCLES        2           /* The counter ticks every 2 clocks */
+#define FREQ_RING_LOG2          8
+#define FREQ_RING_SIZE          (1u << FREQ_RING_LOG2)
+#define FREQ_RING_MASK          (FREQ_RING_SIZE - 1)
+#define FREQ_RING_BYTES         (FREQ_RING_SIZE * sizeof(uint32_t))
+#define FREQ_REG_GROUPS         10000       /* Groups per 1 s gate */
+#define FREQ_REG_MAX_GAP        1000        /* Groups lost before restarting a gate */
+#define FREQ_REG_MIN_SIGMA_PPB  0.05        /* Reported uncertainty floor */
+#define FREQ_REG_STALE_US       2000000     /* Result unusable after 2s */
+
+static uint32_t stamp_ring[FREQ_RING_SIZE] __attribute__((aligned(FREQ_RING_BYTES)));
+static int stamp_dma_chan = -1;
+static uint32_t stamp_read_idx = 0;
+static double ticks_per_group = 0.0;        /* Nominal, from clk_sys */
+
+/* One gate: group index i against d = stamp - t0 - i * ticks_per_group,
+ * which stays small (the crystal offset), so double sums keep precision */
+static struct {
+    bool started;
+    uint32_t t0;                /* Raw stamp of group 0 */
+    uint32_t last;              /* Raw stamp of the newest group */
+    uint32_t last_i;
+    uint32_t n;
+    double si, sii, sd, sid, sdd;
+} reg;
+
+static freq_regression_t reg_result;
+static uint64_t reg_result_us = 0;
+
 /* PPS capture counts (from PIO, no IRQ latency) */
 static volatile uint32_t fe_pps_capture_count = 0;
 static volatile uint32_t gps_pps_capture_count = 0;
 static volatile bool fe_pps_capture_valid = false;
 static volatile bool gps_pps_capture_valid = false;
 
-/* PPS offset statistics */
+/* PPS offset statistics, in ns from the PIO edge stamps in pps_capture.c */
 #define PPS_OFFSET_HISTORY_SIZE 60  /* 60 seconds of history */
 static int32_t pps_offset_history[PPS_OFFSET_HISTORY_SIZE];
 static uint32_t pps_offset_history_idx = 0;
 static uint32_t pps_offset_history_count = 0;
 static int32_t pps_offset_last = 0;
 static int32_t pps_offset_prev = 0;
-static double pps_drift_rate = 0.0;      /* ticks per second */
-static double pps_offset_stddev = 0.0;   /* standard deviation in ticks */
-
-/* PIO latency compensation: cycles lost due to edge detection and loop overhead.
- * The PIO loses ~9 cycles between detecting PPS rise and starting to count,
- * plus asymmetry between start/end detection. Measured empirically. */
-#define PIO_LATENCY_COMPENSATION 9
+static double pps_drift_rate = 0.0;      /* ns per second */
+static double pps_offset_stddev = 0.0;   /* standard deviation in ns */
 
 /* Measurement storage */
 static volatile uint32_t last_count = 0;
@@ -72,44 +114,150 @@ static volatile uint32_t valid_measurements = 0;
 static volatile uint32_t invalid_measurements = 0;
 
 /*============================================================================
- * IRQ HANDLER
+ * GATE COUNT
  *============================================================================*/
 
 /**
- * PIO IRQ handler - called when frequency measurement is ready
+ * One gate: 10MHz edges between two Rb PPS captures. Both ends are
+ * latched by the same SM, so there is no start/stop latency to correct.
  */
-static void freq_counter_irq_handler(void) {
-    /* Clear the IRQ (flag 1, not 0 - to avoid conflict with pps_generator) */
-    pio_interrupt_clear(freq_pio, 1);
-
-    /* Read count from FIFO and apply latency compensation */
-    uint32_t raw_count;
-    if (freq_counter_read(freq_pio, freq_sm, &raw_count)) {
-        uint32_t count = raw_count + PIO_LATENCY_COMPENSATION;
-        last_count = count;
-        measurement_count++;
-        new_measurement = true;
-        last_measurement_time = time_us_64();
-
-        /* Calculate error from expected */
-        count_error = (int32_t)count - (int32_t)EXPECTED_COUNT;
-
-        /* Update statistics */
-        if (measurement_count > 1) {  /* Skip first measurement */
-            if (count_error > max_error) max_error = count_error;
-            if (count_error < min_error) min_error = count_error;
-
-            /* Check if within tolerance (±10 cycles = ±1µs) */
-            if (count_error >= -10 && count_error <= 10) {
-                valid_measurements++;
-            } else {
-                invalid_measurements++;
-            }
+static void gate_measurement(uint32_t count) {
+    last_count = count;
+    measurement_count++;
+    new_measurement = true;
+    last_measurement_time = time_us_64();
+
+    /* Calculate error from expected */
+    count_error = (int32_t)count - (int32_t)EXPECTED_COUNT;
+
+    /* Update statistics */
+    if (measurement_count > 1) {  /* Skip first measurement */
+        if (count_error > max_error) max_error = count_error;
+        if (count_error < min_error) min_error = count_error;
+
+        /* Check if within tolerance (±10 cycles = ±1µs) */
+        if (count_error >= -10 && count_error <= 10) {
+            valid_measurements++;
+        } else {
+            invalid_measurements++;
+        }
+    }
+
+    /* Update global state */
+    g_time_state.last_freq_count = count;
+    g_stats.freq_measurements = measurement_count;
+}
+
+/*============================================================================
+ * REGRESSION COUNTER
+ *============================================================================*/
+
+static void reg_start(uint32_t t) {
+    memset(&reg, 0, sizeof(reg));
+    reg.started = true;
+    reg.t0 = t;
+    reg.last = t;
+    reg.n = 1;                  /* (0, 0) adds nothing to the sums */
+}
+
+/**
+ * Close a gate: least-squares slope of d against i is the group length
+ * beyond nominal, its residuals the uncertainty
+ */
+static void reg_finish(void) {
+    double n = (double)reg.n;
+    double sxx = reg.sii - reg.si * reg.si / n;
+    double sxy = reg.sid - reg.si * reg.sd / n;
+    if (reg.n < 3 || sxx <= 0.0) {
+        return;
+    }
+
+    double b = sxy / sxx;
+    double a = (reg.sd - b * reg.si) / n;
+    double sse = reg.sdd - a * reg.sd - b * reg.sid;
+    double var_b = (sse > 0.0 ? sse : 0.0) / (n - 2.0) / sxx;
+
+    double local_ppb = b / ticks_per_group * 1e9;
+    double sigma_ppb = sqrt(var_b) / ticks_per_group * 1e9;
+    if (sigma_ppb < FREQ_REG_MIN_SIGMA_PPB) {
+        sigma_ppb = FREQ_REG_MIN_SIGMA_PPB;
+    }
+
+    /* The Rb PPS comes from the same 10MHz, so while it is primary this
+     * is the time base against the reference */
+    if (ref_get_primary() == REF_RB_PPS) {
+        discipline_frequency_update(local_ppb, sigma_ppb);
+    }
+
+    /* 10MHz against the reference: crystal against the primary PPS minus
+     * crystal against the 10MHz */
+    clock_model_t model;
+    discipline_get_model(&model);
+
+    reg_result.local_ppb = local_ppb;
+    reg_result.sigma_ppb = sigma_ppb;
+    reg_result.referenced = model.initialized;
+    reg_result.rb_offset_ppb = model.initialized ? model.x[1] - local_ppb : 0.0;
+    reg_result.gates++;
+    reg_result_us = time_us_64();
+}
+
+static void reg_add_stamp(uint32_t t) {
+    if (!reg.started) {
+        reg_start(t);
+        return;
+    }
+
+    /* Entries an overrun left behind are older than the last one taken */
+    int32_t delta = (int32_t)(t - reg.last);
+    if (delta <= 0) {
+        if (delta < -(int32_t)(FREQ_RING_SIZE * ticks_per_group)) {
+            reg_result.gaps++;  /* Counter wrapped while the signal was away */
+            reg_start(t);
         }
+        return;
+    }
+
+    /* Groups since the last stamp, so lost stamps only thin the fit */
+    uint32_t k = (uint32_t)lround(delta / ticks_per_group);
+    if (k == 0) {
+        return;
+    }
+    if (k > FREQ_REG_MAX_GAP) {
+        reg_result.gaps++;
+        reg_start(t);
+        return;
+    }
+    reg_result.lost += k - 1;
+
+    reg.last = t;
+    reg.last_i += k;
+    double i = (double)reg.last_i;
+    double d = (double)(uint32_t)(t - reg.t0) - i * ticks_per_group;
+    reg.n++;
+    reg.si += i;
+    reg.sii += i * i;
+    reg.sd += d;
+    reg.sid += i * d;
+    reg.sdd += d * d;
+
+    if (reg.last_i >= FREQ_REG_GROUPS) {
+        reg_finish();
+        reg_start(t);
+    }
+}
 
-        /* Update global state */
-        g_time_state.last_freq_count = count;
-        g_stats.freq_measurements = measurement_count;
+/**
+ * Drain the stamp ring (PPS FIFO task)
+ */
+static void stamp_drain(void) {
+    uintptr_t wr = (uintptr_t)dma_channel_hw_addr(stamp_dma_chan)->write_addr;
+    uint32_t write_idx = (uint32_t)((wr - (uintptr_t)stamp_ring) / sizeof(uint32_t)) & FREQ_RING_MASK;
+
+    while (stamp_read_idx != write_idx) {
+        /* The SM latches ~X, one less than the ticks elapsed */
+        reg_add_stamp(stamp_ring[stamp_read_idx] + 1);
+        stamp_read_idx = (stamp_read_idx + 1) & FREQ_RING_MASK;
     }
 }
 
@@ -130,19 +278,24 @@ void freq_counter_init(void) {
     gpio_set_dir(GPIO_GNSS_PPS_INPUT, GPIO_IN);
 
     /* Add PIO programs */
-    uint offset = pio_add_program(freq_pio, &freq_counter_program);
+    uint offset = pio_add_program(freq_pio, &freq_stamp_program);
     uint pps_capture_offset = pio_add_program(freq_pio, &pps_capture_program);
 
-    /* Initialize main frequency counter (SM0) - counts 10MHz between FE PPS */
-    freq_counter_program_init(freq_pio, freq_sm, offset,
-                               GPIO_10MHZ_INPUT, GPIO_PPS_INPUT);
-
-    /* Configure IRQ for frequency measurement notification (using interrupt flag 1) */
-    pio_set_irq0_source_enabled(freq_pio, pis_interrupt1, true);
-    irq_set_exclusive_handler(PIO1_IRQ_0, freq_counter_irq_handler);
-    irq_set_enabled(PIO1_IRQ_0, true);
+    /* Regression stamps (SM0), carried to the ring by DMA */
+    ticks_per_group = (double)FREQ_STAMP_EDGES *
+                      ((double)clock_get_hz(clk_sys) / FREQ_TICK_CYCLES) / (double)REF_CLOCK_HZ;
+    freq_stamp_program_init(freq_pio, freq_sm, offset, GPIO_10MHZ_INPUT, FREQ_STAMP_EDGES);
+
+    stamp_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(stamp_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, FREQ_RING_LOG2 + 2);
+    channel_config_set_dreq(&c, pio_get_dreq(freq_pio, freq_sm, false));
+    dma_channel_configure(stamp_dma_chan, &c, stamp_ring, &freq_pio->rxf[freq_sm],
+                          dma_encode_endless_transfer_count(), true);
 
-    /* Start the main frequency counter state machine FIRST */
     pio_sm_set_enabled(freq_pio, freq_sm, true);
 
     /* Initialize GPS PPS capture (SM2) - captures 10MHz count at GPS PPS edge */
@@ -150,14 +303,16 @@ void freq_counter_init(void) {
                               GPIO_10MHZ_INPUT, GPIO_GNSS_PPS_INPUT);
     pio_sm_set_enabled(freq_pio, gps_pps_sm, true);
 
-    /* Initialize FE PPS capture (SM1) AFTER SM0 is running
-     * Both share GP21 for JMP pin - ensure SM0 is stable first */
+    /* Initialize FE PPS capture (SM2) - its successive captures are the
+     * gate count */
     pps_capture_program_init(freq_pio, fe_pps_sm, pps_capture_offset,
                               GPIO_10MHZ_INPUT, GPIO_PPS_INPUT);
     pio_sm_set_enabled(freq_pio, fe_pps_sm, true);
 
     printf("[FREQ] PIO counter started, expected count: %lu\n", EXPECTED_COUNT);
-    printf("[FREQ] PPS capture SMs: Rb=SM2, GPS=SM3 (SM1 broken)\n");
+    printf("[FREQ] Regression: %u edges per stamp, %.1f ticks, DMA %d\n",
+           FREQ_STAMP_EDGES, ticks_per_group, stamp_dma_chan);
+    printf("[FREQ] PPS capture SMs: Rb=SM2, GPS=SM3\n");
     printf("[FREQ] Waiting for PPS signals...\n");
 }
 
@@ -184,21 +339,41 @@ bool freq_counter_new_measurement(void) {
 }
 
 /**
- * Get frequency offset in parts per billion (ppb)
+ * Get the 10MHz frequency offset against the reference in parts per
+ * billion (ppb). From the regression counter against the clock model,
+ * before the model has a phase against the last Rb PPS period, and
+ * without regression gates from the integer count.
  */
 double get_frequency_offset_ppb(void) {
-    if (last_count == 0) {
+    bool fresh = reg_result.gates > 0 && time_us_64() - reg_result_us < FREQ_REG_STALE_US;
+    int64_t interval_ns = get_last_pps_interval_ns();
+    double offset;
+
+    if (fresh && reg_result.referenced) {
+        offset = reg_result.rb_offset_ppb;
+    } else if (fresh && interval_ns != 0) {
+        offset = (double)(interval_ns - 1000000000LL) - reg_result.local_ppb;
+    } else if (last_count != 0) {
+        /* Calculate ppb offset from nominal */
+        offset = ((double)last_count - (double)EXPECTED_COUNT) /
+                 (double)EXPECTED_COUNT * 1e9;
+    } else {
         return 0.0;
     }
 
-    /* Calculate ppb offset from nominal */
-    double offset = ((double)last_count - (double)EXPECTED_COUNT) /
-                    (double)EXPECTED_COUNT * 1e9;
-
     g_time_state.frequency_offset = offset;
     return offset;
 }
 
+/**
+ * Copy the last regression gate (timing core; core0 uses
+ * timing_snapshot_t.freq)
+ */
+void freq_counter_get_regression(freq_regression_t *out) {
+    *out = reg_result;
+    out->valid = reg_result.gates > 0 && time_us_64() - reg_result_us < FREQ_REG_STALE_US;
+}
+
 /**
  * Get the count error (deviation from 10,000,000)
  */
@@ -279,17 +454,14 @@ void freq_counter_pps_start(void) {
 
 /**
  * Update PPS offset statistics
- * Called when we have both FE and GPS PPS captures
+ * Called with GPS edge - FE edge, both stamped by the same PIO counter
  */
-static void update_pps_offset_stats(void) {
-    /* Calculate offset: GPS count - FE count (raw, no normalization needed).
-     * The absolute value is arbitrary since both counters started at different times.
-     * What matters is drift (change over time) and jitter (stability). */
-    int32_t offset = (int32_t)(gps_pps_capture_count - fe_pps_capture_count);
+static void update_pps_offset_stats(int32_t offset) {
 
     /* Store previous offset for drift calculation */
     pps_offset_prev = pps_offset_last;
     pps_offset_last = offset;
+    jitter_stats_observe(JITTER_GNSS_OFFSET, offset);
 
     /* Add to history */
     pps_offset_history[pps_offset_history_idx] = offset;
@@ -298,7 +470,7 @@ static void update_pps_offset_stats(void) {
         pps_offset_history_count++;
     }
 
-    /* Calculate drift rate (ticks per second) */
+    /* Calculate drift rate (ns per second) */
     if (pps_offset_history_count >= 2) {
         /* Drift = change in offset from previous sample */
         int32_t drift = offset - pps_offset_prev;
@@ -337,14 +509,21 @@ static uint32_t gps_pps_debug_count = 0;
 void freq_counter_pps_task(void) {
     uint32_t count;
 
+    PERF_BEGIN(PERF_FREQ_STAMPS);
+    stamp_drain();
+    PERF_END(PERF_FREQ_STAMPS);
+
     /* Poll Rb PPS capture FIFO */
     if (pps_capture_read(freq_pio, fe_pps_sm, &count)) {
+        if (fe_pps_capture_valid) {
+            gate_measurement(count - fe_pps_capture_count);
+        }
         fe_pps_capture_count = count;
         fe_pps_capture_valid = true;
         fe_pps_debug_count++;
         if (fe_pps_debug_count <= 5) {
-            printf("[FREQ] Rb PPS capture #%lu: %lu\n",
-                   (unsigned long)fe_pps_debug_count, (unsigned long)count);
+            LOG_INFO(LOG_MOD_FREQ, "[FREQ] Rb PPS capture #%lu: %lu\n",
+                     (unsigned long)fe_pps_debug_count, (unsigned long)count);
         }
     }
 
@@ -354,14 +533,33 @@ void freq_counter_pps_task(void) {
         gps_pps_capture_valid = true;
         gps_pps_debug_count++;
         if (gps_pps_debug_count <= 5) {
-            printf("[FREQ] GPS PPS capture #%lu: %lu\n",
-                   (unsigned long)gps_pps_debug_count, (unsigned long)count);
+            LOG_INFO(LOG_MOD_FREQ, "[FREQ] GPS PPS capture #%lu: %lu\n",
+                     (unsigned long)gps_pps_debug_count, (unsigned long)count);
         }
 
-        /* Update statistics when we get a new GPS PPS capture */
-        if (fe_pps_capture_valid) {
-            update_pps_offset_stats();
+    }
+
+    /* GNSS vs Rb offset from the sub-µs edge stamps. The two edges may
+     * fall either side of a second boundary, so fold into +/-0.5s. */
+    uint64_t gps_ns;
+    if (pps_capture_take_gnss_edge_ns(&gps_ns)) {
+        uint64_t fe_ns = get_last_pps_timestamp_ns();
+        bool have_offset = false;
+        int32_t offset_ns = 0;
+        if (fe_ns != 0 && fe_pps_capture_valid && is_pps_valid()) {
+            int64_t offset = (int64_t)(gps_ns - fe_ns) % 1000000000LL;
+            if (offset > 500000000LL) {
+                offset -= 1000000000LL;
+            } else if (offset < -500000000LL) {
+                offset += 1000000000LL;
+            }
+            update_pps_offset_stats((int32_t)offset);
+            offset_ns = (int32_t)offset;
+            have_offset = true;
         }
+
+        /* Feeds the GNSS steering, and the time base when GNSS is primary */
+        ref_gnss_edge(gps_ns, have_offset ? &offset_ns : NULL);
     }
 }
 
@@ -374,7 +572,7 @@ void freq_counter_capture_gnss_pps(void) {
 }
 
 /**
- * Get PPS offset in 10MHz ticks (100ns resolution)
+ * Get PPS offset (GPS - FE) in ns, at the PIO edge counter resolution
  */
 int32_t freq_counter_get_pps_offset(void) {
     if (!fe_pps_capture_valid || !gps_pps_capture_valid) {
@@ -384,7 +582,7 @@ int32_t freq_counter_get_pps_offset(void) {
 }
 
 /**
- * Get PPS offset drift rate in ticks per second
+ * Get PPS offset drift rate in ns per second
  * Positive = GPS drifting later relative to FE
  * Negative = GPS drifting earlier relative to FE
  */
@@ -393,7 +591,7 @@ double freq_counter_get_pps_drift(void) {
 }
 
 /**
- * Get PPS offset standard deviation in ticks
+ * Get PPS offset standard deviation in ns
  */
 double freq_counter_get_pps_stddev(void) {
     return pps_offset_stddev;
@@ -13,29 +13,45 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
 #include "hardware/irq.h"
 #include "hardware/sync.h"
+#include "hardware/dma.h"
 
 #include "chronos_rb.h"
 #include "gnss_input.h"
-#include "ac_freq_monitor.h"
+#include "calendar.h"
+#include "perf_trace.h"
+#include "sched.h"
 
 /*============================================================================
  * CONFIGURATION
  *============================================================================*/
 
 #define GNSS_UART           uart1
-#define GNSS_UART_IRQ       UART1_IRQ
 #define NMEA_BUFFER_SIZE    128
 #define NMEA_FIELD_MAX      20
 
+/* UART RX DMA ring: 2KB holds ~175ms at 115200 baud, far longer than a
+ * pass of the timing loop */
+#define GNSS_RX_RING_LOG2   11
+#define GNSS_RX_RING_SIZE   (1u << GNSS_RX_RING_LOG2)
+#define GNSS_RX_RING_MASK   (GNSS_RX_RING_SIZE - 1)
+
 /* Current GPS-UTC leap second offset (as of Jan 1, 2017) */
 #define GNSS_LEAP_SECONDS   18
 
+/* NTP epoch is 1900, Unix epoch is 1970 */
+#define NTP_UNIX_OFFSET     2208988800UL
+
+/* UBX-NAV-TIMELS re-query while the leap count is unknown, and once it is */
+#define GNSS_LEAP_QUERY_US          60000000ULL
+#define GNSS_LEAP_REFRESH_US        3600000000ULL
+
 /*============================================================================
  * UBX PROTOCOL DEFINITIONS
  *============================================================================*/
@@ -66,6 +82,8 @@ static char gnss_hw_version[16] = "Unknown";
 /* Leap second info from UBX-NAV-TIMELS */
 static int8_t gnss_leap_seconds = 0;
 static bool gnss_leap_seconds_valid = false;
+static int8_t gnss_leap_change = 0;         /* Announced leap: +1/-1, 0 = none */
+static uint32_t gnss_leap_event_unix = 0;   /* UTC second the leap comes before */
 
 /*============================================================================
  * UBX PROTOCOL HELPERS
@@ -162,6 +180,28 @@ static uint16_t ubx_rx_len = 0;
 static uint8_t ubx_rx_class = 0;
 static uint8_t ubx_rx_id = 0;
 
+#define UBX_STATE_IDLE      0
+#define UBX_STATE_PAYLOAD   6
+
+/**
+ * Take a run of UBX payload bytes. ubx_rx_idx counts every payload byte;
+ * only the first sizeof(ubx_rx_buffer) are kept.
+ * Returns the number of bytes consumed.
+ */
+static uint32_t ubx_process_payload(const uint8_t *p, uint32_t n) {
+    uint32_t take = ubx_rx_len - ubx_rx_idx;
+    if (take > n) take = n;
+
+    if (ubx_rx_idx < sizeof(ubx_rx_buffer)) {
+        uint32_t keep = sizeof(ubx_rx_buffer) - ubx_rx_idx;
+        memcpy(&ubx_rx_buffer[ubx_rx_idx], p, (take < keep) ? take : keep);
+    }
+    ubx_rx_idx += take;
+    if (ubx_rx_idx >= ubx_rx_len) ubx_rx_state = 7;
+
+    return take;
+}
+
 /**
  * Process received UBX byte (called from task, not IRQ)
  */
@@ -192,10 +232,7 @@ static void ubx_process_byte(uint8_t c) {
             ubx_rx_state = (ubx_rx_len > 0) ? 6 : 7;
             break;
         case 6: /* Payload */
-            if (ubx_rx_idx < sizeof(ubx_rx_buffer)) {
-                ubx_rx_buffer[ubx_rx_idx++] = c;
-            }
-            if (ubx_rx_idx >= ubx_rx_len) ubx_rx_state = 7;
+            ubx_process_payload(&c, 1);
             break;
         case 7: /* Checksum A (ignore for now) */
             ubx_rx_state = 8;
@@ -223,12 +260,30 @@ static void ubx_process_byte(uint8_t c) {
             if (ubx_rx_class == UBX_CLASS_NAV && ubx_rx_id == UBX_NAV_TIMELS && ubx_rx_len >= 24) {
                 /* Offset 8: srcOfCurrLs (0=default, 1=GPS, 2=SBAS, etc.) */
                 /* Offset 9: currLs - current leap seconds */
-                /* Offset 23: valid flags (bit 0 = validCurrLs) */
+                /* Offset 11: lsChange - announced change (-1, 0, +1) */
+                /* Offset 12: timeToLsEvent - seconds to the change (I4) */
+                /* Offset 23: valid flags (bit 0 = validCurrLs,
+                 *            bit 1 = validTimeToLsEvent) */
                 uint8_t src = ubx_rx_buffer[8];
                 int8_t curr_ls = (int8_t)ubx_rx_buffer[9];
+                int8_t ls_change = (int8_t)ubx_rx_buffer[11];
+                int32_t to_event = (int32_t)((uint32_t)ubx_rx_buffer[12] |
+                                             ((uint32_t)ubx_rx_buffer[13] << 8) |
+                                             ((uint32_t)ubx_rx_buffer[14] << 16) |
+                                             ((uint32_t)ubx_rx_buffer[15] << 24));
                 uint8_t valid = ubx_rx_buffer[23];
                 gnss_leap_seconds = curr_ls;
                 gnss_leap_seconds_valid = (valid & 0x01) != 0;
+
+                /* Anchor the event to UTC midnight, where leaps happen */
+                uint32_t now_unix = gnss_get_unix_time();
+                gnss_leap_change = 0;
+                if ((valid & 0x02) && ls_change != 0 && to_event > 0 && now_unix != 0) {
+                    gnss_leap_event_unix = (now_unix + (uint32_t)to_event + 43200) / 86400 * 86400;
+                    gnss_leap_change = ls_change;
+                    printf("[GNSS] Leap second %+d announced before %" PRIu32 " (in %ld s)\n",
+                           ls_change, gnss_leap_event_unix, (long)to_event);
+                }
                 const char *src_str = "unknown";
                 if (src == 0) src_str = "default";
                 else if (src == 1) src_str = "GPS";
@@ -264,6 +319,11 @@ static uint8_t nmea_idx = 0;
 static bool nmea_receiving = false;
 static bool nmea_overflow = false;
 
+/* UART RX ring, filled by DMA and drained by gnss_input_task() */
+static uint8_t gnss_rx_ring[GNSS_RX_RING_SIZE] __attribute__((aligned(GNSS_RX_RING_SIZE)));
+static int gnss_rx_dma_chan = -1;
+static uint32_t gnss_rx_read_idx = 0;
+
 /*============================================================================
  * NMEA PARSING HELPERS
  *============================================================================*/
@@ -375,23 +435,8 @@ static double parse_longitude(const char *lon_str, const char *ew) {
 static uint32_t gnss_time_to_unix(const gnss_time_t *t) {
     if (!t->valid || t->year < 2000) return 0;
 
-    /* Days from 1970 to year */
-    uint32_t days = 0;
-    for (int y = 1970; y < t->year; y++) {
-        days += (y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)) ? 366 : 365;
-    }
-
-    /* Days in current year */
-    static const int month_days[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    for (int m = 1; m < t->month; m++) {
-        days += month_days[m];
-        if (m == 2 && (t->year % 4 == 0 && (t->year % 100 != 0 || t->year % 400 == 0))) {
-            days++;  /* Leap year */
-        }
-    }
-    days += t->day - 1;
-
-    return days * 86400 + t->hour * 3600 + t->minute * 60 + t->second;
+    return calendar_to_ntp(t->year, t->month, t->day,
+                           t->hour, t->minute, t->second) - NTP_UNIX_OFFSET;
 }
 
 /*============================================================================
@@ -574,7 +619,6 @@ static void process_nmea_sentence(const char *sentence) {
  *
  * Handles:
  *   - GNSS PPS (GP11) - rising edge
- *   - AC zero crossing (GP19) - falling edge
  *
  * Note: Rubidium PPS uses PIO interrupts (not GPIO), so no conflict.
  * The Pico only allows one GPIO callback per core, so all GPIO IRQs
@@ -582,28 +626,92 @@ static void process_nmea_sentence(const char *sentence) {
  */
 static void shared_gpio_callback(uint gpio, uint32_t events) {
     if (gpio == GPIO_GNSS_PPS_INPUT && (events & GPIO_IRQ_EDGE_RISE)) {
+        PERF_BEGIN(PERF_GNSS_PPS_IRQ);
         /* GNSS PPS - capture 10MHz counter first for accurate offset */
         freq_counter_capture_gnss_pps();
         gnss_pps_timestamp = time_us_64();
         gnss_pps_count++;
         gnss_pps_triggered = true;
-    }
-    if (gpio == GPIO_AC_ZERO_CROSS && (events & GPIO_IRQ_EDGE_FALL)) {
-        /* AC mains zero crossing */
-        ac_zero_cross_irq_handler();
+        sched_post(SCHED_EV_GNSS_PPS);
+        PERF_END(PERF_GNSS_PPS_IRQ);
     }
 }
 
 /*============================================================================
- * UART RECEIVE HANDLER
+ * UART RECEIVE (DMA RING + TASK-CONTEXT SCANNER)
  *============================================================================*/
 
-static void gnss_uart_handler(void) {
-    while (uart_is_readable(GNSS_UART)) {
-        char c = uart_getc(GNSS_UART);
+/**
+ * Start DMA copying UART1 RX into the ring forever. No UART interrupt is
+ * used; the task picks up whatever DMA has written since its last pass.
+ */
+static void gnss_rx_start(void) {
+    gnss_rx_dma_chan = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config(gnss_rx_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, GNSS_RX_RING_LOG2);
+    channel_config_set_dreq(&c, uart_get_dreq(GNSS_UART, false));
+
+    dma_channel_configure(gnss_rx_dma_chan, &c, gnss_rx_ring,
+                          &uart_get_hw(GNSS_UART)->dr,
+                          dma_encode_endless_transfer_count(), true);
+    gnss_rx_read_idx = 0;
+}
+
+/**
+ * Ring index DMA will write next
+ */
+static inline uint32_t gnss_rx_write_idx(void) {
+    uintptr_t wr = (uintptr_t)dma_channel_hw_addr(gnss_rx_dma_chan)->write_addr;
+    return (uint32_t)(wr - (uintptr_t)gnss_rx_ring) & GNSS_RX_RING_MASK;
+}
+
+/**
+ * Finish the NMEA sentence in nmea_buffer
+ */
+static void nmea_end_sentence(void) {
+    nmea_buffer[nmea_idx] = '\0';
+    nmea_receiving = false;
+
+    /* Only process if no overflow and valid length */
+    if (!nmea_overflow && nmea_idx > 10) {
+        process_nmea_sentence(nmea_buffer);
+    } else if (nmea_overflow) {
+        gnss_state.nmea_errors++;
+    }
+}
+
+/**
+ * Scan a contiguous chunk of received bytes. UBX payloads and NMEA
+ * sentence bodies are copied in runs; only framing bytes go through the
+ * per-byte state machines.
+ */
+static void gnss_rx_scan(const uint8_t *p, uint32_t n) {
+    uint32_t i = 0;
+
+    while (i < n) {
+        /* Inside a UBX frame */
+        if (ubx_rx_state == UBX_STATE_PAYLOAD) {
+            i += ubx_process_payload(&p[i], n - i);
+            continue;
+        }
+        if (ubx_rx_state != UBX_STATE_IDLE) {
+            ubx_process_byte(p[i++]);
+            continue;
+        }
 
-        /* Process UBX binary protocol (starts with 0xB5 0x62) */
-        ubx_process_byte((uint8_t)c);
+        uint8_t c = p[i];
+
+        /* Start of a UBX frame (0xB5 0x62) - never valid inside NMEA */
+        if (c == UBX_SYNC1) {
+            nmea_receiving = false;
+            ubx_process_byte(c);
+            i++;
+            continue;
+        }
 
         if (c == '$') {
             /* Start of new NMEA sentence - reset state */
@@ -612,30 +720,54 @@ static void gnss_uart_handler(void) {
             nmea_overflow = false;
         }
 
-        if (nmea_receiving) {
-            if (nmea_idx < NMEA_BUFFER_SIZE - 1) {
-                nmea_buffer[nmea_idx++] = c;
-            } else {
-                /* Buffer overflow - mark and discard rest of sentence */
-                nmea_overflow = true;
-            }
+        if (!nmea_receiving) {
+            i++;
+            continue;
+        }
+
+        /* Copy the sentence body up to a terminator or framing byte */
+        uint32_t run = (c == '$') ? i + 1 : i;
+        while (run < n && p[run] != '\r' && p[run] != '\n' &&
+               p[run] != '$' && p[run] != UBX_SYNC1) {
+            run++;
+        }
 
-            if (c == '\n' || c == '\r') {
-                /* End of sentence */
-                nmea_buffer[nmea_idx] = '\0';
-                nmea_receiving = false;
+        uint32_t len = run - i;
+        uint32_t room = (NMEA_BUFFER_SIZE - 1) - nmea_idx;
+        if (len > room) {
+            /* Buffer overflow - mark and discard rest of sentence */
+            nmea_overflow = true;
+            len = room;
+        }
+        memcpy(&nmea_buffer[nmea_idx], &p[i], len);
+        nmea_idx += len;
+        i = run;
 
-                /* Only process if no overflow and valid length */
-                if (!nmea_overflow && nmea_idx > 10) {
-                    process_nmea_sentence(nmea_buffer);
-                } else if (nmea_overflow) {
-                    gnss_state.nmea_errors++;
-                }
+        if (i < n && (p[i] == '\r' || p[i] == '\n')) {
+            /* End of sentence - the terminator is kept, as before */
+            if (nmea_idx < NMEA_BUFFER_SIZE - 1) {
+                nmea_buffer[nmea_idx++] = (char)p[i];
             }
+            i++;
+            nmea_end_sentence();
         }
     }
 }
 
+/**
+ * Drain everything DMA has written since the last call
+ */
+static void gnss_rx_drain(void) {
+    uint32_t write_idx = gnss_rx_write_idx();
+
+    while (gnss_rx_read_idx != write_idx) {
+        /* Contiguous chunk up to the write index or the end of the ring */
+        uint32_t end = (write_idx > gnss_rx_read_idx) ? write_idx : GNSS_RX_RING_SIZE;
+        gnss_rx_scan(&gnss_rx_ring[gnss_rx_read_idx], end - gnss_rx_read_idx);
+        gnss_rx_read_idx = end & GNSS_RX_RING_MASK;
+    }
+}
+
 /*============================================================================
  * PUBLIC API
  *============================================================================*/
@@ -647,8 +779,12 @@ static void gnss_flush_uart(void) {
     while (uart_is_readable(GNSS_UART)) {
         uart_getc(GNSS_UART);
     }
+    if (gnss_rx_dma_chan >= 0) {
+        gnss_rx_read_idx = gnss_rx_write_idx();
+    }
     nmea_idx = 0;
     nmea_receiving = false;
+    ubx_rx_state = UBX_STATE_IDLE;
 }
 
 /**
@@ -674,13 +810,11 @@ void gnss_input_init(void) {
     uart_set_format(GNSS_UART, 8, 1, UART_PARITY_NONE);
     uart_set_fifo_enabled(GNSS_UART, true);
 
-    /* Flush any stale data in UART buffer before enabling interrupts */
+    /* Flush any stale data in UART buffer before starting DMA */
     gnss_flush_uart();
 
-    /* Set up UART interrupt */
-    irq_set_exclusive_handler(GNSS_UART_IRQ, gnss_uart_handler);
-    irq_set_enabled(GNSS_UART_IRQ, true);
-    uart_set_irq_enables(GNSS_UART, true, false);
+    /* Receive by DMA; parsing happens in gnss_input_task() */
+    gnss_rx_start();
 
     /* Initialize GNSS PPS input GPIO */
     gpio_init(GPIO_GNSS_PPS_INPUT);
@@ -694,7 +828,8 @@ void gnss_input_init(void) {
     gpio_set_irq_enabled_with_callback(GPIO_GNSS_PPS_INPUT, GPIO_IRQ_EDGE_RISE, true,
                                        shared_gpio_callback);
 
-    printf("[GNSS] UART1: GP%d (RX from GNSS), GP%d (TX to GNSS)\n", GPIO_GNSS_RX, GPIO_GNSS_TX);
+    printf("[GNSS] UART1: GP%d (RX from GNSS), GP%d (TX to GNSS), RX DMA %d\n",
+           GPIO_GNSS_RX, GPIO_GNSS_TX, gnss_rx_dma_chan);
     printf("[GNSS] PPS: GP%d (GPIO IRQ callback)\n", GPIO_GNSS_PPS_INPUT);
 
     /* Give GNSS module time to start up, then configure it */
@@ -717,13 +852,16 @@ void gnss_input_init(void) {
 
 /**
  * GNSS task - call from main loop
- * Processes PPS events from IRQ and checks timeouts
+ * Parses received UART data, processes PPS events from IRQ and checks timeouts
  */
 void gnss_input_task(void) {
     static uint64_t last_leap_query_us = 0;
 
     if (!gnss_enabled) return;
 
+    /* Parse UBX/NMEA received since the last pass */
+    PERF_CALL(PERF_GNSS_RX, gnss_rx_drain());
+
     uint64_t now = time_us_64();
 
     /* Process PPS from IRQ handler (atomic read) */
@@ -748,8 +886,10 @@ void gnss_input_task(void) {
         gnss_state.fix_type = GNSS_FIX_NONE;
     }
 
-    /* Periodically re-query leap second status (every 60 seconds) */
-    if (!gnss_leap_seconds_valid && (now - last_leap_query_us) > 60000000ULL) {
+    /* Re-query leap second status: every 60 seconds until known, then
+     * hourly to pick up announcements */
+    uint64_t leap_query_us = gnss_leap_seconds_valid ? GNSS_LEAP_REFRESH_US : GNSS_LEAP_QUERY_US;
+    if ((now - last_leap_query_us) > leap_query_us) {
         ubx_request_timels();
         last_leap_query_us = now;
     }
@@ -873,13 +1013,11 @@ void gnss_enable(bool enable) {
     restore_interrupts(irq);
 
     if (!enable) {
-        /* Disable UART RX interrupt */
-        uart_set_irq_enables(GNSS_UART, false, false);
-        /* Disable PPS GPIO interrupt */
+        /* Disable PPS GPIO interrupt (RX DMA keeps running, unparsed) */
         gpio_set_irq_enabled(GPIO_GNSS_PPS_INPUT, GPIO_IRQ_EDGE_RISE, false);
     } else {
-        /* Enable UART RX interrupt */
-        uart_set_irq_enables(GNSS_UART, true, false);
+        /* Skip what arrived while disabled */
+        gnss_flush_uart();
         /* Enable PPS GPIO interrupt */
         gpio_set_irq_enabled(GPIO_GNSS_PPS_INPUT, GPIO_IRQ_EDGE_RISE, true);
     }
@@ -948,3 +1086,15 @@ int8_t gnss_get_leap_seconds(void) {
 bool gnss_leap_seconds_is_valid(void) {
     return gnss_leap_seconds_valid;
 }
+
+/**
+ * Get the announced leap second, if any
+ */
+bool gnss_get_leap_event(int8_t *change, uint32_t *event_unix) {
+    if (gnss_leap_change == 0) {
+        return false;
+    }
+    *change = gnss_leap_change;
+    *event_unix = gnss_leap_event_unix;
+    return true;
+}
@@ -0,0 +1,192 @@
+/**
+ * CHRONOS-Rb PPS Jitter Statistics
+ *
+ * Welford accumulators and log histograms, updated in O(1) per value.
+ * Each series has a single writer on the timing core, so a sequence lock
+ * gives readers on core0 a consistent copy; updates mask local
+ * interrupts, as the seqlock requires, which also keeps a reset from a
+ * timing core task out of the capture IRQ's way. See jitter_stats.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "jitter_stats.h"
+#include "timing_core.h"
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+typedef struct {
+    seqlock_t lock;
+    jitter_snapshot_t set[JITTER_SET_COUNT];
+} jitter_series_stats_t;
+
+static jitter_series_stats_t stats[JITTER_SERIES_COUNT];
+
+static const char *const series_names[JITTER_SERIES_COUNT] = {
+    [JITTER_PPS_PERIOD]  = "pps",
+    [JITTER_GNSS_OFFSET] = "gnss",
+};
+
+/*============================================================================
+ * BUCKETS
+ *============================================================================*/
+
+/**
+ * Bucket of a magnitude: exact below JITTER_SUB_BUCKETS, then
+ * JITTER_SUB_BUCKETS per octave (as perf_trace.c's cycle histograms)
+ */
+static inline uint32_t magnitude_bucket(uint32_t m) {
+    if (m < JITTER_SUB_BUCKETS) {
+        return m;
+    }
+    if (m >= (1u << JITTER_MAX_LOG2)) {
+        m = (1u << JITTER_MAX_LOG2) - 1;
+    }
+    uint32_t msb = 31 - __builtin_clz(m);
+    uint32_t sub = (m >> (msb - JITTER_SUB_BITS)) & (JITTER_SUB_BUCKETS - 1);
+    return ((msb - JITTER_SUB_BITS + 1) << JITTER_SUB_BITS) + sub;
+}
+
+/* Smallest magnitude in bucket b, and the bucket's width */
+static void magnitude_range(uint32_t b, double *lo, double *width) {
+    if (b < JITTER_SUB_BUCKETS) {
+        *lo = b;
+        *width = 1.0;
+        return;
+    }
+    uint32_t shift = (b >> JITTER_SUB_BITS) - 1;
+    uint32_t sub = b & (JITTER_SUB_BUCKETS - 1);
+    *lo = (double)((JITTER_SUB_BUCKETS + sub) << shift);
+    *width = (double)(1u << shift);
+}
+
+/**
+ * Histogram index of a value: negatives below JITTER_HALF_BUCKETS,
+ * largest magnitude first, so indices ascend with the value
+ */
+static inline uint32_t value_bucket(int32_t v) {
+    if (v >= 0) {
+        return JITTER_HALF_BUCKETS + magnitude_bucket((uint32_t)v);
+    }
+    return JITTER_HALF_BUCKETS - 1 - magnitude_bucket((uint32_t)(-(int64_t)v));
+}
+
+static void set_clear(jitter_snapshot_t *s, uint64_t now_us) {
+    memset(s, 0, sizeof(*s));
+    s->start_us = now_us;
+}
+
+static void set_add(jitter_snapshot_t *s, int32_t v, uint32_t b) {
+    if (s->count == 0 || v < s->min) s->min = v;
+    if (s->count == 0 || v > s->max) s->max = v;
+    s->last = v;
+    s->count++;
+
+    /* Welford */
+    double delta = (double)v - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * ((double)v - s->mean);
+
+    s->buckets[b]++;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void jitter_stats_observe(jitter_series_t series, int32_t value) {
+    jitter_series_stats_t *st = &stats[series];
+    uint32_t b = value_bucket(value);
+
+    uint32_t irq = save_and_disable_interrupts();
+    seqlock_write_begin(&st->lock);
+    set_add(&st->set[JITTER_TOTAL], value, b);
+    set_add(&st->set[JITTER_WINDOW], value, b);
+    seqlock_write_end(&st->lock);
+    restore_interrupts(irq);
+}
+
+void jitter_stats_reset(jitter_series_t series) {
+    uint64_t now_us = time_us_64();
+
+    for (int i = 0; i < JITTER_SERIES_COUNT; i++) {
+        if (series != JITTER_SERIES_COUNT && i != (int)series) {
+            continue;
+        }
+        jitter_series_stats_t *st = &stats[i];
+        uint32_t irq = save_and_disable_interrupts();
+        seqlock_write_begin(&st->lock);
+        set_clear(&st->set[JITTER_WINDOW], now_us);
+        seqlock_write_end(&st->lock);
+        restore_interrupts(irq);
+    }
+}
+
+void jitter_stats_read(jitter_series_t series, jitter_set_t set, jitter_snapshot_t *out) {
+    const jitter_series_stats_t *st = &stats[series];
+    uint32_t seq;
+
+    do {
+        seq = seqlock_read_begin(&st->lock);
+        *out = st->set[set];
+    } while (seqlock_read_retry(&st->lock, seq));
+}
+
+double jitter_stats_stddev(const jitter_snapshot_t *s) {
+    if (s->count < 2) {
+        return 0.0;
+    }
+    return sqrt(s->m2 / s->count);
+}
+
+double jitter_stats_quantile(const jitter_snapshot_t *s, double q) {
+    if (s->count == 0) {
+        return 0.0;
+    }
+
+    double rank = q * (double)s->count;
+    uint32_t below = 0;
+    for (uint32_t i = 0; i < JITTER_BUCKETS; i++) {
+        uint32_t n = s->buckets[i];
+        if (n == 0 || (double)(below + n) < rank) {
+            below += n;
+            continue;
+        }
+
+        double lo, width, start;
+        if (i >= JITTER_HALF_BUCKETS) {
+            magnitude_range(i - JITTER_HALF_BUCKETS, &lo, &width);
+            start = lo;
+        } else {
+            magnitude_range(JITTER_HALF_BUCKETS - 1 - i, &lo, &width);
+            start = -(lo + width) + 1.0;
+        }
+        double v = start + (rank - below) / (double)n * width;
+        if (v < s->min) v = s->min;
+        if (v > s->max) v = s->max;
+        return v;
+    }
+    return s->max;
+}
+
+const char *jitter_series_name(int series) {
+    return (series >= 0 && series < JITTER_SERIES_COUNT) ? series_names[series] : "?";
+}
+
+int jitter_series_from_name(const char *name) {
+    for (int i = 0; i < JITTER_SERIES_COUNT; i++) {
+        if (strcasecmp(name, series_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,213 @@
+/**
+ * CHRONOS-Rb Load Benchmark
+ *
+ * Each step is the difference between two snapshots of the server
+ * counters, the lwIP memory statistics and the latency histograms, so
+ * the request path itself carries no benchmark code. See load_bench.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "lwip/stats.h"
+
+#include "chronos_rb.h"
+#include "load_bench.h"
+#include "metrics.h"
+
+/*============================================================================
+ * PRIVATE DEFINITIONS
+ *============================================================================*/
+
+/* Histograms a step measures */
+typedef enum {
+    BENCH_HIST_NTP = 0,
+    BENCH_HIST_PTP,
+    BENCH_HIST_PPS,
+    BENCH_HIST_LOOP,
+    BENCH_HIST_COUNT
+} bench_hist_t;
+
+static const metrics_hist_id_t bench_hist_ids[BENCH_HIST_COUNT] = {
+    [BENCH_HIST_NTP] = METRIC_NTP_SERVICE,
+    [BENCH_HIST_PTP] = METRIC_PTP_SERVICE,
+    [BENCH_HIST_PPS] = METRIC_PPS_IRQ_LATENCY,
+    [BENCH_HIST_LOOP] = METRIC_MAIN_LOOP,
+};
+
+/* Everything a step is measured from */
+typedef struct {
+    uint64_t time_us;
+    uint32_t ntp_rx;
+    uint32_t ntp_served;
+    uint32_t ptp_rx;
+    uint32_t ptp_served;
+    uint16_t pool_err;          /* lwIP counters are 16-bit and wrap */
+    uint16_t pbuf_err;
+    uint16_t heap_err;
+    metrics_hist_snapshot_t hist[BENCH_HIST_COUNT];
+} bench_mark_t;
+
+/*============================================================================
+ * PRIVATE VARIABLES (core0 only)
+ *============================================================================*/
+
+static bool running = false;
+static bool step_open = false;
+static uint32_t p99_target_us = BENCH_P99_DEFAULT_US;
+static uint32_t generator_addr = 0;     /* Network byte order */
+static uint32_t step_offered = 0;
+static bench_mark_t step_start;
+
+static bench_step_t steps[BENCH_MAX_STEPS];
+static uint32_t step_count = 0;
+
+/*============================================================================
+ * MEASUREMENT
+ *============================================================================*/
+
+static void bench_mark(bench_mark_t *m) {
+    uint32_t requests, errors, kod_sent, dropped, syncs;
+
+    m->time_us = time_us_64();
+    ntp_get_statistics(&requests, &errors);
+    ntp_get_limit_stats(&kod_sent, &dropped);
+    m->ntp_rx = requests + errors + kod_sent + dropped;
+    m->ntp_served = requests;
+    ptp_get_statistics(&syncs, &m->ptp_served);
+    m->ptp_rx = ptp_get_delay_requests();
+
+    m->pool_err = lwip_stats.memp[MEMP_PBUF_POOL]->err;
+    m->pbuf_err = lwip_stats.memp[MEMP_PBUF]->err;
+    m->heap_err = lwip_stats.mem.err;
+
+    for (int i = 0; i < BENCH_HIST_COUNT; i++) {
+        metrics_hist_read(bench_hist_ids[i], &m->hist[i]);
+    }
+}
+
+/**
+ * Quantile of one histogram over the step (end less start copy)
+ */
+static float bench_quantile(const bench_mark_t *a, const bench_mark_t *b,
+                            bench_hist_t which, double q) {
+    metrics_hist_snapshot_t d = b->hist[which];
+    for (int i = 0; i <= d.nbounds; i++) {
+        d.buckets[i] -= a->hist[which].buckets[i];
+    }
+    d.count -= a->hist[which].count;
+    d.sum -= a->hist[which].sum;
+    return (float)metrics_hist_quantile(&d, q);
+}
+
+/**
+ * Close the open step into the table
+ */
+static void bench_close_step(void) {
+    if (!step_open) {
+        return;
+    }
+    step_open = false;
+
+    bench_mark_t end;
+    bench_mark(&end);
+    const bench_mark_t *a = &step_start;
+
+    bench_step_t *s = &steps[step_count++];
+    s->offered = step_offered;
+    s->duration_ms = (uint32_t)((end.time_us - a->time_us) / 1000);
+    s->ntp_rx = end.ntp_rx - a->ntp_rx;
+    s->ntp_served = end.ntp_served - a->ntp_served;
+    s->ptp_rx = end.ptp_rx - a->ptp_rx;
+    s->ptp_served = end.ptp_served - a->ptp_served;
+    s->pbuf_errors = (uint16_t)(end.pool_err - a->pool_err) +
+                     (uint16_t)(end.pbuf_err - a->pbuf_err) +
+                     (uint16_t)(end.heap_err - a->heap_err);
+    s->ntp_p50_us = bench_quantile(a, &end, BENCH_HIST_NTP, 0.50);
+    s->ntp_p99_us = bench_quantile(a, &end, BENCH_HIST_NTP, 0.99);
+    s->ptp_p99_us = bench_quantile(a, &end, BENCH_HIST_PTP, 0.99);
+    s->pps_p99_ns = bench_quantile(a, &end, BENCH_HIST_PPS, 0.99);
+    s->loop_p99_us = bench_quantile(a, &end, BENCH_HIST_LOOP, 0.99);
+
+    uint32_t rx = s->ntp_rx + s->ptp_rx;
+    uint32_t unanswered = rx - s->ntp_served - s->ptp_served;
+    s->passed = s->ntp_p99_us <= (float)p99_target_us &&
+                (uint64_t)unanswered * 1000000 <= (uint64_t)rx * BENCH_FAIL_MAX_PPM &&
+                s->pbuf_errors == 0 &&
+                s->pps_p99_ns <= (float)BENCH_PPS_P99_NS;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void load_bench_start(uint32_t target_us, uint32_t addr) {
+    memset(steps, 0, sizeof(steps));
+    step_count = 0;
+    step_open = false;
+    p99_target_us = (target_us != 0) ? target_us : BENCH_P99_DEFAULT_US;
+    generator_addr = addr;
+    ntp_set_limit_exempt(0, 0);
+    running = true;
+    printf("[BENCH] Load benchmark started, p99 target %lu us\n", p99_target_us);
+}
+
+bool load_bench_step(uint32_t offered_per_s) {
+    if (!running) {
+        return false;
+    }
+    bench_close_step();
+    if (step_count >= BENCH_MAX_STEPS) {
+        return false;
+    }
+
+    ntp_set_limit_exempt(generator_addr, BENCH_EXEMPT_S);
+    step_offered = offered_per_s;
+    bench_mark(&step_start);
+    step_open = true;
+    return true;
+}
+
+void load_bench_stop(void) {
+    if (!running) {
+        return;
+    }
+    bench_close_step();
+    running = false;
+    ntp_set_limit_exempt(0, 0);
+
+    bench_status_t st;
+    load_bench_get_status(&st);
+    printf("[BENCH] Load benchmark done: %lu steps, capacity %lu req/s\n",
+           st.steps, st.capacity);
+}
+
+void load_bench_get_status(bench_status_t *status) {
+    status->running = running;
+    status->open = step_open;
+    status->p99_target_us = p99_target_us;
+    status->generator_addr = generator_addr;
+    status->steps = step_count;
+    status->capacity = 0;
+
+    for (uint32_t i = 0; i < step_count; i++) {
+        const bench_step_t *s = &steps[i];
+        if (!s->passed || s->duration_ms == 0) {
+            continue;
+        }
+        uint32_t rate = (uint32_t)((uint64_t)(s->ntp_served + s->ptp_served) * 1000 /
+                                   s->duration_ms);
+        if (rate > status->capacity) {
+            status->capacity = rate;
+        }
+    }
+}
+
+int load_bench_get_steps(bench_step_t *out, int max) {
+    int n = ((int)step_count < max) ? (int)step_count : max;
+    memcpy(out, steps, (size_t)n * sizeof(bench_step_t));
+    return n;
+}
@@ -3,6 +3,12 @@
  *
  * Ring buffer for capturing log output for web interface display.
  *
+ * Deferred records: a writer claims a record number with one atomic
+ * add, clears the slot's seq, fills it in and publishes seq = number + 1.
+ * A reader copies a slot and checks seq before and after, so a slot
+ * still being written or overwritten under it is never formatted. A
+ * slow drain loses the oldest records, never blocks a writer.
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
@@ -12,8 +18,13 @@
 #include "pico/stdlib.h"
 #include "pico/stdio.h"
 #include "pico/stdio/driver.h"
+#include "hardware/sync.h"
 #include "chronos_rb.h"
 #include "log_buffer.h"
+#include "sched.h"
+
+_Static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0, "LOG_BUFFER_SIZE must be a power of 2");
+_Static_assert((LOG_RECORD_SLOTS & (LOG_RECORD_SLOTS - 1)) == 0, "LOG_RECORD_SLOTS must be a power of 2");
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -24,6 +35,26 @@ static volatile uint32_t write_pos = 0;
 static volatile uint32_t total_written = 0;  /* Total bytes ever written (for tracking) */
 static bool initialized = false;
 
+static log_record_t rec_ring[LOG_RECORD_SLOTS];
+static volatile uint32_t rec_head = 0;      /* Records ever claimed */
+static uint32_t rec_drained = 0;            /* Next record to print (core0) */
+static uint32_t rec_lost = 0;
+
+static uint8_t log_levels[LOG_MOD_COUNT] = {
+    [0 ... LOG_MOD_COUNT - 1] = LOG_LEVEL_INFO,
+};
+
+static const char *const module_names[LOG_MOD_COUNT] = {
+    [LOG_MOD_PPS]    = "pps",
+    [LOG_MOD_FREQ]   = "freq",
+    [LOG_MOD_RB]     = "rb",
+    [LOG_MOD_GNSS]   = "gnss",
+    [LOG_MOD_OUTPUT] = "output",
+    [LOG_MOD_NET]    = "net",
+};
+
+static const char *const level_names[] = { "error", "warn", "info", "debug" };
+
 /*============================================================================
  * STDIO DRIVER
  *============================================================================*/
@@ -32,11 +63,22 @@ static bool initialized = false;
  * Custom putchar that writes to ring buffer
  */
 static void log_out_chars(const char *buf, int len) {
-    for (int i = 0; i < len; i++) {
-        log_ring[write_pos] = buf[i];
-        write_pos = (write_pos + 1) % LOG_BUFFER_SIZE;
-        total_written++;
+    if (len > LOG_BUFFER_SIZE) {
+        buf += len - LOG_BUFFER_SIZE;
+        len = LOG_BUFFER_SIZE;
+    }
+
+    /* At most two copies: up to the end of the ring, then from the start */
+    uint32_t pos = write_pos;
+    uint32_t first = LOG_BUFFER_SIZE - pos;
+    if (first > (uint32_t)len) {
+        first = (uint32_t)len;
     }
+    memcpy(&log_ring[pos], buf, first);
+    memcpy(log_ring, buf + first, (uint32_t)len - first);
+
+    write_pos = (pos + (uint32_t)len) & (LOG_BUFFER_SIZE - 1);
+    total_written += (uint32_t)len;
 }
 
 /* Custom stdio driver that captures output */
@@ -100,11 +142,11 @@ size_t log_buffer_read(char *buf, size_t buf_size, uint32_t *read_pos) {
 
     /* Copy data from ring buffer */
     size_t copied = 0;
-    uint32_t ring_pos = last_read % LOG_BUFFER_SIZE;
+    uint32_t ring_pos = last_read & (LOG_BUFFER_SIZE - 1);
 
     for (uint32_t i = 0; i < available; i++) {
         buf[copied++] = log_ring[ring_pos];
-        ring_pos = (ring_pos + 1) % LOG_BUFFER_SIZE;
+        ring_pos = (ring_pos + 1) & (LOG_BUFFER_SIZE - 1);
     }
 
     buf[copied] = '\0';
@@ -113,6 +155,37 @@ size_t log_buffer_read(char *buf, size_t buf_size, uint32_t *read_pos) {
     return copied;
 }
 
+/**
+ * Copy up to buf_size bytes forward from absolute position *from
+ * (a log_buffer_get_pos() value). Bytes already overwritten are skipped.
+ * No terminator is added; *from is advanced past the bytes copied.
+ */
+size_t log_buffer_copy(char *buf, size_t buf_size, uint32_t *from) {
+    uint32_t current_total = total_written;
+    uint32_t start = *from;
+
+    if (!initialized || start >= current_total) {
+        return 0;
+    }
+    if (current_total - start > LOG_BUFFER_SIZE) {
+        start = current_total - LOG_BUFFER_SIZE;
+    }
+
+    size_t available = current_total - start;
+    if (available > buf_size) {
+        available = buf_size;
+    }
+
+    uint32_t ring_pos = start & (LOG_BUFFER_SIZE - 1);
+    for (size_t i = 0; i < available; i++) {
+        buf[i] = log_ring[ring_pos];
+        ring_pos = (ring_pos + 1) & (LOG_BUFFER_SIZE - 1);
+    }
+
+    *from = start + available;
+    return available;
+}
+
 /**
  * Get current write position for tracking
  */
@@ -128,3 +201,134 @@ void log_buffer_clear(void) {
     total_written = 0;
     memset(log_ring, 0, sizeof(log_ring));
 }
+
+/*============================================================================
+ * DEFERRED RECORDS
+ *============================================================================*/
+
+void log_write(log_module_t module, log_level_t level, const char *fmt,
+               uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3) {
+    if ((unsigned)module >= LOG_MOD_COUNT || level > log_levels[module]) {
+        return;
+    }
+
+    uint32_t n = __atomic_fetch_add(&rec_head, 1, __ATOMIC_RELAXED);
+    log_record_t *r = &rec_ring[n & (LOG_RECORD_SLOTS - 1)];
+
+    r->seq = 0;
+    __dmb();
+    r->time_us = time_us_32();
+    r->fmt = fmt;
+    r->module = (uint8_t)module;
+    r->level = (uint8_t)level;
+    r->core = (uint8_t)get_core_num();
+    r->args[0] = a0;
+    r->args[1] = a1;
+    r->args[2] = a2;
+    r->args[3] = a3;
+    __atomic_store_n(&r->seq, n + 1, __ATOMIC_RELEASE);
+
+    sched_post(SCHED_EV_LOG);
+}
+
+/**
+ * Copy record n out of the ring. Returns 1 if copied, 0 if it is not
+ * complete yet, -1 if it has been overwritten.
+ */
+static int rec_copy(uint32_t n, log_record_t *out) {
+    const log_record_t *r = &rec_ring[n & (LOG_RECORD_SLOTS - 1)];
+
+    uint32_t seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+    if (seq != n + 1) {
+        return (seq == 0 || (int32_t)(seq - (n + 1)) < 0) ? 0 : -1;
+    }
+
+    out->time_us = r->time_us;
+    out->fmt = r->fmt;
+    out->module = r->module;
+    out->level = r->level;
+    out->core = r->core;
+    memcpy(out->args, r->args, sizeof(out->args));
+    out->seq = seq;
+    __dmb();
+
+    return (r->seq == seq) ? 1 : -1;
+}
+
+void log_drain(void) {
+    uint32_t head = rec_head;
+
+    if (head - rec_drained > LOG_RECORD_SLOTS) {
+        rec_lost += head - rec_drained - LOG_RECORD_SLOTS;
+        rec_drained = head - LOG_RECORD_SLOTS;
+    }
+
+    while (rec_drained != head) {
+        log_record_t r;
+        int got = rec_copy(rec_drained, &r);
+        if (got == 0) {
+            /* Writer still filling it in; pick it up next time */
+            break;
+        }
+        if (got > 0) {
+            printf(r.fmt, r.args[0], r.args[1], r.args[2], r.args[3]);
+        } else {
+            rec_lost++;
+        }
+        rec_drained++;
+    }
+}
+
+bool log_record_format(uint32_t seq, log_record_t *rec, char *buf, size_t buf_size) {
+    if (rec_copy(seq, rec) <= 0) {
+        return false;
+    }
+    snprintf(buf, buf_size, rec->fmt, rec->args[0], rec->args[1], rec->args[2], rec->args[3]);
+    return true;
+}
+
+uint32_t log_record_head(void) {
+    return rec_head;
+}
+
+void log_record_get_stats(log_record_stats_t *stats) {
+    stats->written = rec_head;
+    stats->drained = rec_drained;
+    stats->lost = rec_lost;
+}
+
+void log_set_level(log_module_t module, log_level_t level) {
+    if ((unsigned)module < LOG_MOD_COUNT && level <= LOG_LEVEL_DEBUG) {
+        log_levels[module] = (uint8_t)level;
+    }
+}
+
+log_level_t log_get_level(log_module_t module) {
+    return ((unsigned)module < LOG_MOD_COUNT) ? (log_level_t)log_levels[module] : LOG_LEVEL_ERROR;
+}
+
+const char *log_module_name(log_module_t module) {
+    return ((unsigned)module < LOG_MOD_COUNT) ? module_names[module] : "?";
+}
+
+const char *log_level_name(log_level_t level) {
+    return (level <= LOG_LEVEL_DEBUG) ? level_names[level] : "?";
+}
+
+int log_module_from_name(const char *name) {
+    for (int i = 0; i < LOG_MOD_COUNT; i++) {
+        if (strcmp(name, module_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int log_level_from_name(const char *name) {
+    for (int i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
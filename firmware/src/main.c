@@ -34,7 +34,16 @@
 #include "roughtime.h"
 #include "gptp.h"
 #include "nts.h"
+#include "nts_ke.h"
 #include "gnss_input.h"
+#include "timing_core.h"
+#include "metrics.h"
+#include "perf_trace.h"
+#include "sched.h"
+#include "warm_start.h"
+#include "unit_secret.h"
+#include "tsdb.h"
+#include "eth_w5500.h"
 
 /*============================================================================
  * GLOBAL VARIABLES
@@ -184,6 +193,7 @@ static void print_banner(void) {
 void chronos_init(void) {
     /* Initialize stdio for debug output */
     stdio_init_all();
+    PERF_INIT_CORE();
 
     /* Initialize log buffer to capture printf output for web interface */
     log_buffer_init();
@@ -200,33 +210,28 @@ void chronos_init(void) {
     led_init();
     led_startup_sequence();
     
-    printf("[INIT] Initializing time subsystem...\n");
-    time_init();
-    
-    printf("[INIT] Initializing PPS capture...\n");
-    pps_capture_init();
-    
-    printf("[INIT] Initializing frequency counter...\n");
-    freq_counter_init();
-
-    printf("[INIT] Initializing 1PPS generator (10MHz / 10,000,000)...\n");
-    pps_generator_init();
-    pps_generator_start();
-
-    printf("[INIT] Initializing time discipline...\n");
-    discipline_init();
-    
-    printf("[INIT] Initializing rubidium sync...\n");
-    rubidium_sync_init();
-    
+    /* Config must be loaded before the timing modules (pulse outputs,
+     * RF/NMEA/GNSS enables are restored from it) */
     printf("[INIT] Initializing configuration...\n");
     config_init();
+    unit_secret_init();
+    warm_start_init();
+
+    /* PPS, frequency counter, discipline, sync and timing outputs -
+     * launched on core1 in multicore mode */
+    timing_core_init();
+
+    printf("[INIT] Initializing history store...\n");
+    tsdb_init();
 
     printf("[INIT] Initializing WiFi...\n");
     wifi_init();
 
-    printf("[INIT] Initializing pulse outputs...\n");
-    pulse_output_init();
+#if CHRONOS_ETH_W5500
+    /* Needs the lwIP stack wifi_init() brought up */
+    printf("[INIT] Initializing wired Ethernet...\n");
+    eth_init();
+#endif
 
     printf("[INIT] Initializing CLI...\n");
     cli_init();
@@ -234,46 +239,6 @@ void chronos_init(void) {
     printf("[INIT] Initializing OTA subsystem...\n");
     ota_init();
 
-    printf("[INIT] Initializing NMEA output...\n");
-    nmea_output_init();
-
-    printf("[INIT] Initializing radio timecode outputs...\n");
-    radio_timecode_init();
-
-    /* GNSS input must be initialized BEFORE AC frequency monitor because
-     * gnss_input_init() registers the shared GPIO callback that handles
-     * both GNSS PPS (GP11) and AC zero crossing (GP19) interrupts */
-    printf("[INIT] Initializing GNSS receiver input...\n");
-    gnss_input_init();
-
-    printf("[INIT] Initializing AC frequency monitor...\n");
-    ac_freq_init();
-
-    /* Apply RF, NMEA, and GNSS settings from config */
-    {
-        config_t *cfg = config_get();
-        printf("[INIT] Applying RF/NMEA/GNSS settings from config...\n");
-        radio_timecode_enable(RADIO_DCF77, cfg->rf_dcf77_enabled);
-        radio_timecode_enable(RADIO_WWVB, cfg->rf_wwvb_enabled);
-        radio_timecode_enable(RADIO_JJY40, cfg->rf_jjy40_enabled);
-        radio_timecode_enable(RADIO_JJY60, cfg->rf_jjy60_enabled);
-        nmea_output_enable(cfg->nmea_enabled);
-        gnss_enable(cfg->gnss_enabled);
-        printf("[INIT]   DCF77: %s, WWVB: %s, JJY40: %s, JJY60: %s\n",
-               cfg->rf_dcf77_enabled ? "ON" : "OFF",
-               cfg->rf_wwvb_enabled ? "ON" : "OFF",
-               cfg->rf_jjy40_enabled ? "ON" : "OFF",
-               cfg->rf_jjy60_enabled ? "ON" : "OFF");
-        printf("[INIT]   NMEA: %s, GNSS: %s\n",
-               cfg->nmea_enabled ? "ON" : "OFF",
-               cfg->gnss_enabled ? "ON" : "OFF");
-    }
-
-    /* IRIG-B disabled - causes crashes, needs debugging
-    printf("[INIT] Initializing IRIG-B output...\n");
-    irig_b_init();
-    */
-
     /* Check for WiFi auto-connect */
     if (config_wifi_auto_connect_enabled()) {
         config_t *cfg = config_get();
@@ -356,10 +321,14 @@ static void update_status_leds(void) {
     /* Sync LED: solid when locked, blinking when acquiring */
     static uint32_t sync_blink_time = 0;
     static bool sync_blink_state = false;
-    
-    if (g_time_state.sync_state == SYNC_STATE_LOCKED) {
+
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    uint8_t sync_state = snap.state.sync_state;
+
+    if (sync_state == SYNC_STATE_LOCKED) {
         led_set_sync(true);
-    } else if (g_time_state.sync_state >= SYNC_STATE_FREQ_CAL) {
+    } else if (sync_state >= SYNC_STATE_FREQ_CAL) {
         if (time_us_32() > sync_blink_time) {
             sync_blink_state = !sync_blink_state;
             led_set_sync(sync_blink_state);
@@ -379,7 +348,7 @@ static void update_status_leds(void) {
     }
     
     /* Error LED */
-    led_set_error(g_time_state.sync_state == SYNC_STATE_ERROR);
+    led_set_error(sync_state == SYNC_STATE_ERROR);
 }
 
 /**
@@ -399,15 +368,18 @@ static void print_status(void) {
             "INIT", "FREQ_CAL", "COARSE", "FINE", "LOCKED", "HOLDOVER", "ERROR"
         };
 
+        timing_snapshot_t snap;
+        timing_core_get_snapshot(&snap);
+
         printf("\n[STATUS] Sync: %s | Rb Lock: %s | PPS: %lu | Freq: %lu Hz\n",
-               sync_states[g_time_state.sync_state],
-               g_time_state.rb_locked ? "YES" : "NO",
-               g_time_state.pps_count,
-               g_time_state.last_freq_count);
+               sync_states[snap.state.sync_state],
+               snap.state.rb_locked ? "YES" : "NO",
+               snap.state.pps_count,
+               snap.state.last_freq_count);
 
         printf("[STATUS] Offset: %lld ns | Freq Offset: %.3f ppb\n",
-               g_time_state.offset_ns,
-               g_time_state.frequency_offset);
+               snap.state.offset_ns,
+               snap.state.frequency_offset);
 
         printf("[STATUS] NTP Requests: %lu | PTP Sync: %lu | Errors: %lu\n",
                g_stats.ntp_requests,
@@ -424,6 +396,129 @@ static void print_status(void) {
     }
 }
 
+/*============================================================================
+ * NETWORK CORE TASKS
+ *============================================================================*/
+
+static void task_wifi_auto(void) {
+    PERF_CALL(PERF_TASK_WIFI_AUTO, wifi_auto_connect_task());
+}
+
+/* Handles reconnection - runs whether or not we are connected */
+static void task_wifi(void) {
+    PERF_CALL(PERF_TASK_WIFI, wifi_task());
+}
+
+static void task_ntp(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_NTP, ntp_server_task());
+    }
+}
+
+static void task_ntp_bcast(void) {
+    if (g_wifi_connected) {
+        ntp_broadcast_task();
+    }
+}
+
+static void task_ptp(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_PTP, ptp_server_task());
+    }
+}
+
+static void task_web(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_WEB, web_task());
+    }
+}
+
+static void task_ota(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_OTA, ota_task());
+    }
+}
+
+static void task_leds(void) {
+    PERF_CALL(PERF_TASK_LEDS, update_status_leds());
+}
+
+static void task_cli(void) {
+    PERF_CALL(PERF_TASK_CLI, cli_task());
+}
+
+static void task_status(void) {
+    PERF_CALL(PERF_TASK_STATUS, print_status());
+}
+
+static void task_warm(void) {
+    PERF_CALL(PERF_TASK_WARM, warm_start_task());
+}
+
+static void task_history(void) {
+    PERF_CALL(PERF_TASK_HISTORY, tsdb_task());
+}
+
+#if CHRONOS_ETH_W5500
+static void task_eth(void) {
+    PERF_CALL(PERF_TASK_ETH, eth_task());
+}
+#endif
+
+static void task_log(void) {
+    PERF_CALL(PERF_TASK_LOG, log_drain());
+}
+
+static void task_roughtime(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_ROUGHTIME, roughtime_task());
+    }
+}
+
+static void task_nts_ke(void) {
+    if (g_wifi_connected) {
+        PERF_CALL(PERF_TASK_NTS_KE, nts_ke_task());
+    }
+}
+
+/**
+ * Register the core0 tasks. Requests are served from lwIP callbacks, so
+ * the network tasks only do housekeeping and timed transmits. The
+ * internal rate limits of wifi_task/ntp_server_task/print_status stay
+ * authoritative; the periods here just avoid waking for nothing.
+ */
+static void main_tasks_register(void) {
+    sched_add("wifi_auto", task_wifi_auto, 100000, 0);
+    sched_add("wifi", task_wifi, 100000, 0);
+    sched_add("ntp", task_ntp, 1000000, 0);
+    /* Each new second; sets its own deadline for the send phase */
+    sched_add("ntp_bcast", task_ntp_bcast, 0, SCHED_EV_SECOND);
+    /* Unicast grants go down to 1/128 s, Sync to 1/8 s */
+    sched_add("ptp", task_ptp, 1000, 0);
+    sched_add("web", task_web, 100000, SCHED_EV_PUBLISH);
+    sched_add("ota", task_ota, 1000000, 0);
+    /* 50 ms activity blink */
+    sched_add("leds", task_leds, 10000, 0);
+    /* Console input wakes the CLI; the period covers stdio drivers
+     * without a chars-available callback */
+    sched_add("cli", task_cli, 20000, SCHED_EV_STDIO);
+    sched_add("status", task_status, 1000000, 0);
+    /* Saves discipline state hourly while locked */
+    sched_add("warm", task_warm, 10000000, 0);
+    /* One sample of every series per second, rollups on UTC boundaries */
+    sched_add("history", task_history, 0, SCHED_EV_SECOND);
+#if CHRONOS_ETH_W5500
+    /* Woken by the W5500's INTn; the period polls the PHY link */
+    sched_add("eth", task_eth, ETH_LINK_POLL_US, SCHED_EV_ETH);
+#endif
+    /* Deferred records from IRQs and the timing core */
+    sched_add("log", task_log, 0, SCHED_EV_LOG);
+    /* Queued requests; the task sets its own deadline for the batch */
+    sched_add("roughtime", task_roughtime, 0, SCHED_EV_ROUGHTIME);
+    /* TLS handshakes, one step per pass; sets its own timeout polls */
+    sched_add("nts_ke", task_nts_ke, 0, SCHED_EV_NTS_KE);
+}
+
 /**
  * Main entry point
  */
@@ -447,11 +542,20 @@ int main(void) {
     /* OTA boot confirmation timer - confirm after 60 seconds of stable operation */
     static bool ota_boot_confirmed = false;
     uint32_t ota_confirm_time = time_us_32() + 60000000;  /* 60 seconds */
+
+    /* Single-core builds already registered the timing tasks, so they
+     * keep running first in each pass */
+    main_tasks_register();
     
     /* Main loop */
     while (1) {
-        /* Feed watchdog */
-        watchdog_update();
+        uint32_t loop_start = time_us_32();
+
+        /* Feed watchdog - only while the timing core is making progress,
+         * so a hung core1 still resets the board */
+        if (timing_core_is_alive()) {
+            watchdog_update();
+        }
 
         /* OTA boot confirmation - confirm after 60 seconds of stable operation */
         if (!ota_boot_confirmed && time_us_32() >= ota_confirm_time) {
@@ -459,51 +563,13 @@ int main(void) {
             ota_boot_confirmed = true;
         }
 
-        /* Run all tasks */
-        rubidium_sync_task();
-
-        /* Poll PPS capture FIFOs for offset measurement */
-        freq_counter_pps_task();
-
-        /* WiFi auto-connect (non-blocking) */
-        wifi_auto_connect_task();
-
-        /* WiFi task handles reconnection - call always */
-        wifi_task();
-
-        if (g_wifi_connected) {
-            ntp_server_task();
-            ptp_server_task();
-            web_task();
-            ota_task();
-            /* gptp_task(); - disabled */
+        if (sched_dispatch()) {
+            metrics_observe(METRIC_MAIN_LOOP, (int32_t)(time_us_32() - loop_start));
         }
 
-        /* Time output tasks */
-        nmea_output_task();
-        radio_timecode_task();
-        /* irig_b_task(); - disabled, crashes */
-
-        /* GNSS input task */
-        gnss_input_task();
-        
-        /* Update status LEDs */
-        update_status_leds();
-        
-        /* Process configurable pulse outputs */
-        pulse_output_task();
-
-        /* Process AC frequency monitor */
-        ac_freq_task();
-
-        /* Process CLI input */
-        cli_task();
-
-        /* Print periodic status */
-        print_status();
-
-        /* Small delay to prevent tight loop */
-        sleep_us(100);
+        /* Sleep until the next task is due, an event or an interrupt
+         * (lwIP and USB run from IRQs and wake us too) */
+        sched_idle();
     }
     
     return 0;
@@ -0,0 +1,136 @@
+/**
+ * CHRONOS-Rb Latency Histograms
+ *
+ * Each histogram has a single writer context, so a sequence lock is
+ * enough to give the web server a consistent copy. Writers mask local
+ * interrupts for the few cycles of an update, as the seqlock requires.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "metrics.h"
+#include "timing_core.h"
+
+/*============================================================================
+ * PRIVATE DEFINITIONS
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    const char *help;
+    double scale;
+    uint8_t nbounds;
+    const int32_t *bounds;
+} metrics_hist_info_t;
+
+typedef struct {
+    seqlock_t lock;
+    uint32_t buckets[METRICS_MAX_BOUNDS + 1];
+    int64_t sum;
+    uint32_t count;
+} metrics_hist_t;
+
+static const int32_t ntp_service_bounds[] = {
+    20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000
+};
+static const int32_t pps_latency_bounds[] = {
+    500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 1000000
+};
+static const int32_t offset_bounds[] = {
+    -100000, -10000, -1000, -100, -10, 0, 10, 100, 1000, 10000, 100000
+};
+static const int32_t probe_rtt_bounds[] = {
+    500, 1000, 1500, 2000, 3000, 5000, 7500, 10000, 15000, 20000
+};
+static const int32_t main_loop_bounds[] = {
+    200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 500000
+};
+
+#define HIST(n, h, s, b) { n, h, s, sizeof(b) / sizeof(b[0]), b }
+
+static const metrics_hist_info_t hist_info[METRIC_HIST_COUNT] = {
+    [METRIC_NTP_SERVICE] = HIST("ntp_service_seconds",
+        "NTP request receive stamp to reply sent", 1e-6, ntp_service_bounds),
+    [METRIC_PPS_IRQ_LATENCY] = HIST("pps_irq_latency_seconds",
+        "Rubidium PPS edge to capture IRQ handler", 1e-9, pps_latency_bounds),
+    [METRIC_DISCIPLINE_OFFSET] = HIST("discipline_offset_seconds",
+        "Phase offset fed to the discipline loop", 1e-9, offset_bounds),
+    [METRIC_MAIN_LOOP] = HIST("main_loop_seconds",
+        "Network core main loop pass, excluding the idle sleep", 1e-6, main_loop_bounds),
+    [METRIC_NTS_SERVICE] = HIST("nts_service_seconds",
+        "NTS-protected request receive stamp to reply sent", 1e-6, ntp_service_bounds),
+    [METRIC_PTP_SERVICE] = HIST("ptp_service_seconds",
+        "PTP Delay_Req receive stamp to Delay_Resp sent", 1e-6, ntp_service_bounds),
+    [METRIC_WIFI_PROBE_RTT] = HIST("wifi_probe_rtt_seconds",
+        "WiFi link probe round trip between driver stamps", 1e-6, probe_rtt_bounds),
+};
+
+static metrics_hist_t hists[METRIC_HIST_COUNT];
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void metrics_observe(metrics_hist_id_t id, int32_t value) {
+    const metrics_hist_info_t *info = &hist_info[id];
+    metrics_hist_t *h = &hists[id];
+
+    uint8_t b = 0;
+    while (b < info->nbounds && value > info->bounds[b]) {
+        b++;
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    seqlock_write_begin(&h->lock);
+    h->buckets[b]++;
+    h->sum += value;
+    h->count++;
+    seqlock_write_end(&h->lock);
+    restore_interrupts(irq);
+}
+
+void metrics_hist_read(metrics_hist_id_t id, metrics_hist_snapshot_t *out) {
+    const metrics_hist_info_t *info = &hist_info[id];
+    const metrics_hist_t *h = &hists[id];
+    uint32_t seq;
+
+    out->name = info->name;
+    out->help = info->help;
+    out->scale = info->scale;
+    out->nbounds = info->nbounds;
+    out->bounds = info->bounds;
+
+    do {
+        seq = seqlock_read_begin(&h->lock);
+        memcpy(out->buckets, h->buckets, sizeof(out->buckets));
+        out->sum = h->sum;
+        out->count = h->count;
+    } while (seqlock_read_retry(&h->lock, seq));
+}
+
+double metrics_hist_quantile(const metrics_hist_snapshot_t *h, double q) {
+    if (h->count == 0 || h->nbounds == 0) {
+        return 0.0;
+    }
+
+    double rank = q * (double)h->count;
+    uint32_t below = 0;
+    for (uint8_t b = 0; b < h->nbounds; b++) {
+        if ((double)(below + h->buckets[b]) >= rank && h->buckets[b] != 0) {
+            /* The first bucket starts at 0, or one bucket width below a
+             * negative bound */
+            double lo = (b > 0) ? h->bounds[b - 1]
+                      : (h->bounds[0] > 0) ? 0.0
+                      : 2.0 * h->bounds[0] - h->bounds[1];
+            double frac = (rank - below) / (double)h->buckets[b];
+            return lo + frac * (double)(h->bounds[b] - lo);
+        }
+        below += h->buckets[b];
+    }
+    return h->bounds[h->nbounds - 1];
+}
@@ -0,0 +1,315 @@
+/**
+ * CHRONOS-Rb Network Timestamping
+ *
+ * Wraps the default netif's input and linkoutput so NTP/PTP see the time
+ * a frame crossed the driver rather than the time their UDP callback ran.
+ * lwIP runs NO_SYS, so a frame passed to netif->input is processed to
+ * completion (IP -> UDP -> application) before the wrapper returns; the
+ * stamp taken on entry therefore belongs to the packet the callback sees.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/etharp.h"
+#include "lwip/udp.h"
+
+#include "chronos_rb.h"
+#include "net_timestamp.h"
+#include "eth_w5500.h"
+
+/*============================================================================
+ * CONSTANTS
+ *============================================================================*/
+
+/* Offsets into a received Ethernet/ARP frame */
+#define ETH_TYPE_OFFSET         12
+#define ETH_TYPE_ARP            0x0806
+#define ARP_OPCODE_OFFSET       20
+#define ARP_OPCODE_REPLY        2
+#define ARP_SENDER_IP_OFFSET    28
+#define ARP_FRAME_MIN_LEN       42
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static struct netif *hooked_netif = NULL;
+static netif_input_fn orig_input = NULL;
+static netif_linkoutput_fn orig_linkoutput = NULL;
+
+/* RX stamp of the frame being processed (lwIP context only) */
+static uint64_t rx_stamp_us = 0;
+static bool driver_stamps = false;      /* A driver reports its own */
+
+/* Last host-wake edge (GPIO IRQ writer, lwIP context reader). Kept 32-bit
+ * so the higher priority writer can never tear it. */
+static volatile uint32_t host_wake_us32 = 0;
+static volatile bool host_wake_pending = false;
+static bool host_wake_hooked = false;
+
+/* TX stamp of the last frame sent (lwIP context only) */
+static volatile uint64_t tx_stamp_us = 0;
+static volatile uint32_t tx_frames = 0;
+static uint32_t tx_latency_us = 0;
+
+/* Link probe state (lwIP context only) */
+static bool probe_pending = false;
+static bool probe_done = false;
+static uint32_t probe_target = 0;
+static uint64_t probe_tx_us = 0;
+static uint32_t probe_rtt_us = 0;
+static uint32_t probes_sent = 0;
+static uint32_t probes_answered = 0;
+
+static uint32_t rx_frames = 0;
+static uint32_t rx_wake_stamped = 0;
+static uint32_t wake_latency_us = 0;
+
+/*============================================================================
+ * HOST WAKE INTERRUPT
+ *============================================================================*/
+
+#if NET_TS_USE_HOST_WAKE && defined(CYW43_PIN_WL_HOST_WAKE)
+/**
+ * Raw GPIO handler registered ahead of the CYW43 driver's own handler.
+ * Only records the time; the driver still services the interrupt.
+ */
+static void host_wake_irq(void) {
+    if (gpio_get_irq_event_mask(CYW43_PIN_WL_HOST_WAKE) != 0) {
+        if (!host_wake_pending) {
+            host_wake_us32 = time_us_32();
+            host_wake_pending = true;
+        }
+    }
+}
+#endif
+
+/*============================================================================
+ * NETIF HOOKS
+ *============================================================================*/
+
+/**
+ * Match an ARP reply from the probe target
+ */
+static void probe_check_reply(const struct pbuf *p, uint64_t stamp) {
+    if (p->len < ARP_FRAME_MIN_LEN) {
+        return;
+    }
+
+    const uint8_t *f = (const uint8_t *)p->payload;
+    uint16_t type = ((uint16_t)f[ETH_TYPE_OFFSET] << 8) | f[ETH_TYPE_OFFSET + 1];
+    uint16_t op = ((uint16_t)f[ARP_OPCODE_OFFSET] << 8) | f[ARP_OPCODE_OFFSET + 1];
+    uint32_t sender;
+    memcpy(&sender, &f[ARP_SENDER_IP_OFFSET], sizeof(sender));
+
+    if (type == ETH_TYPE_ARP && op == ARP_OPCODE_REPLY && sender == probe_target) {
+        probe_rtt_us = (uint32_t)(stamp - probe_tx_us);
+        probe_pending = false;
+        probe_done = true;
+        probes_answered++;
+    }
+}
+
+/**
+ * Wrapper around the driver's netif->input
+ */
+static err_t ts_input(struct pbuf *p, struct netif *netif) {
+    uint64_t now = time_us_64();
+    uint64_t stamp = now;
+
+    if (host_wake_pending) {
+        uint32_t age = (uint32_t)now - host_wake_us32;
+        host_wake_pending = false;
+        if (age < NET_TS_WAKE_MAX_US) {
+            stamp = now - age;
+            wake_latency_us = age;
+            rx_wake_stamped++;
+        }
+    }
+
+    rx_stamp_us = stamp;
+    rx_frames++;
+
+    if (probe_pending) {
+        probe_check_reply(p, stamp);
+    }
+
+    return orig_input(p, netif);
+}
+
+/**
+ * Wrapper around the driver's netif->linkoutput. The CYW43 send is
+ * synchronous, so on return the frame has been written to the chip.
+ */
+static err_t ts_linkoutput(struct netif *netif, struct pbuf *p) {
+    uint64_t start = time_us_64();
+    err_t err = orig_linkoutput(netif, p);
+
+    tx_stamp_us = time_us_64();
+    tx_latency_us = (uint32_t)(tx_stamp_us - start);
+    tx_frames++;
+
+    return err;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void net_ts_attach(void) {
+    struct netif *netif = netif_default;
+
+    if (netif == NULL) {
+        return;
+    }
+
+    /* Already hooked and the driver has not re-installed its callbacks */
+    if (netif == hooked_netif && netif->input == ts_input &&
+        netif->linkoutput == ts_linkoutput) {
+        return;
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    if (netif->input != ts_input) {
+        orig_input = netif->input;
+        netif->input = ts_input;
+    }
+    if (netif->linkoutput != ts_linkoutput) {
+        orig_linkoutput = netif->linkoutput;
+        netif->linkoutput = ts_linkoutput;
+    }
+    hooked_netif = netif;
+    restore_interrupts(irq);
+
+#if NET_TS_USE_HOST_WAKE && defined(CYW43_PIN_WL_HOST_WAKE)
+    if (!host_wake_hooked) {
+        gpio_add_raw_irq_handler_with_order_priority(CYW43_PIN_WL_HOST_WAKE,
+                host_wake_irq, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+        host_wake_hooked = true;
+    }
+#endif
+
+    printf("[NETTS] Driver-level timestamping attached (host wake %s)\n",
+           host_wake_hooked ? "ON" : "OFF");
+}
+
+uint64_t net_ts_rx_us(void) {
+    if ((hooked_netif == NULL && !driver_stamps) || rx_stamp_us == 0) {
+        return time_us_64();
+    }
+    return rx_stamp_us;
+}
+
+uint32_t net_ts_tx_count(void) {
+    return tx_frames;
+}
+
+uint64_t net_ts_tx_us(void) {
+    return tx_stamp_us;
+}
+
+uint64_t net_ts_tx_since(uint32_t tx_count_before) {
+    if (tx_frames != tx_count_before) {
+        return tx_stamp_us;
+    }
+    return time_us_64();
+}
+
+bool net_ts_probe_start(void) {
+    struct netif *netif = hooked_netif;
+
+    if (netif == NULL) {
+        return false;
+    }
+    if (probe_pending && time_us_64() - probe_tx_us < NET_TS_PROBE_TIMEOUT_US) {
+        return false;
+    }
+
+    const ip4_addr_t *gw = netif_ip4_gw(netif);
+    if (gw == NULL || ip4_addr_get_u32(gw) == 0) {
+        return false;
+    }
+
+    /* Called from task context: hold off lwIP processing so the reply
+     * cannot be matched before the TX stamp is recorded */
+    cyw43_arch_lwip_begin();
+    probe_target = ip4_addr_get_u32(gw);
+    probe_done = false;
+
+    uint32_t tx_count = tx_frames;
+    err_t err = etharp_request(netif, gw);
+    probe_tx_us = net_ts_tx_since(tx_count);
+    probe_pending = (err == ERR_OK);
+    if (probe_pending) {
+        probes_sent++;
+    }
+    cyw43_arch_lwip_end();
+
+    return err == ERR_OK;
+}
+
+bool net_ts_probe_result(uint32_t *rtt_us) {
+    if (!probe_done) {
+        return false;
+    }
+    probe_done = false;
+    *rtt_us = probe_rtt_us;
+    return true;
+}
+
+void net_ts_driver_rx(uint64_t stamp_us) {
+    driver_stamps = true;
+    rx_stamp_us = stamp_us;
+}
+
+void net_ts_driver_tx(uint64_t stamp_us) {
+    tx_stamp_us = stamp_us;
+    tx_frames++;
+}
+
+struct netif *net_ts_time_netif(void) {
+    struct netif *wired = eth_time_netif();
+    return (wired != NULL) ? wired : netif_default;
+}
+
+bool net_ts_bind_pcb(struct udp_pcb *pcb) {
+    if (pcb == NULL) {
+        return false;
+    }
+
+    struct netif *wired = eth_time_netif();
+    u8_t idx = (wired != NULL) ? netif_get_index(wired) : NETIF_NO_INDEX;
+    if (pcb->netif_idx == idx) {
+        return false;
+    }
+
+    cyw43_arch_lwip_begin();
+    udp_bind_netif(pcb, wired);
+    cyw43_arch_lwip_end();
+    return true;
+}
+
+int32_t net_ts_link_latency_ns(void) {
+    return (eth_time_netif() != NULL) ? eth_latency_ns() : wifi_latency_ns();
+}
+
+void net_ts_get_stats(net_ts_stats_t *stats) {
+    stats->attached = (hooked_netif != NULL);
+    stats->rx_frames = rx_frames;
+    stats->rx_wake_stamped = rx_wake_stamped;
+    stats->wake_latency_us = wake_latency_us;
+    stats->tx_frames = tx_frames;
+    stats->tx_latency_us = tx_latency_us;
+    stats->probes_sent = probes_sent;
+    stats->probes_answered = probes_answered;
+}
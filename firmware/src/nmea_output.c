@@ -1,14 +1,23 @@
 /**
  * CHRONOS-Rb NMEA 0183 Output
  *
- * Outputs GPS-compatible NMEA sentences over UART for devices expecting GPS time.
- * Synchronized to rubidium reference, outputs at 1Hz on PPS edge.
+ * Outputs GPS-compatible NMEA sentences for devices expecting GPS time.
+ * Synchronized to rubidium reference, one burst per second on the PPS edge.
  *
- * Sentences:
+ * Sentences (selectable, see nmea_output_set_sentences()):
  *   $GPZDA - Time & Date
  *   $GPRMC - Recommended Minimum (with position placeholder)
+ *   $GPGGA - Fix data (time only)
  *
- * UART: 115200 baud, 8N1 on UART1 (shared with GNSS input)
+ * Each second's burst is formatted during the second before, from the
+ * calendar's next second, into one of two buffers. The rubidium PPS
+ * interrupt starts a DMA transfer of the prepared buffer into the UART0
+ * TX FIFO, so the first start bit leaves at the PPS IRQ latency after the
+ * edge and nothing waits on the line. UART0 is the output's alone (stdio
+ * is USB only), so it has its own baud rate; UART1 stays with the GNSS
+ * receiver.
+ *
+ * Serial: 8N1 on GP28 (UART0 TX), 4800-921600 baud (default 115200)
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -18,22 +27,26 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
 
 #include "chronos_rb.h"
 #include "nmea_output.h"
+#include "calendar.h"
 
 /*============================================================================
  * CONFIGURATION
  *============================================================================*/
 
-#define NMEA_UART           uart1
-#define NMEA_UART_TX        28      /* GP28 - UART1 TX */
-#define NMEA_UART_RX        -1      /* Not used (output only) */
-#define NMEA_BAUD_RATE      115200  /* Shared with GNSS input */
+#define NMEA_UART           uart0
+
+#define NMEA_SENTENCE_MAX   100     /* Longest sentence without checksum */
+#define NMEA_BURST_SIZE     512     /* All sentences of one second */
 
-/* NTP epoch offset */
-#define NTP_UNIX_OFFSET     2208988800UL
+/* Supported baud rates */
+static const uint32_t nmea_bauds[] = {
+    4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600
+};
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -41,8 +54,21 @@
 
 static bool nmea_initialized = false;
 static bool nmea_enabled = true;
+static uint8_t nmea_sentences = NMEA_SENT_ALL;
+static uint32_t nmea_baud = NMEA_BAUD_DEFAULT;
+static int nmea_dma_chan = -1;
+
+/* Double buffered bursts: the PPS IRQ starts the pending one */
+static char nmea_burst[2][NMEA_BURST_SIZE];
+static uint16_t nmea_burst_len[2];
+static uint8_t nmea_burst_count[2];     /* Sentences in the burst */
+static volatile int nmea_pending = -1;  /* Burst the next PPS starts */
+static int nmea_next = 0;               /* Burst to build next */
+static uint32_t nmea_built = 0;         /* Second of the pending burst */
+
 static uint32_t nmea_sentences_sent = 0;
-static uint32_t last_pps_count = 0;
+static uint32_t nmea_overruns = 0;
+static uint32_t nmea_dropped = 0;
 
 /*============================================================================
  * CHECKSUM CALCULATION
@@ -61,65 +87,12 @@ static uint8_t nmea_checksum(const char *sentence) {
     return cs;
 }
 
-/*============================================================================
- * TIME CONVERSION
- *============================================================================*/
-
-/**
- * Convert NTP timestamp to broken-down UTC time
- */
-static void ntp_to_utc(uint32_t ntp_secs, int *year, int *month, int *day,
-                       int *hour, int *min, int *sec) {
-    /* Convert NTP to Unix time */
-    uint32_t unix_time = ntp_secs - NTP_UNIX_OFFSET;
-
-    /* Time of day */
-    uint32_t days = unix_time / 86400;
-    uint32_t remaining = unix_time % 86400;
-
-    *hour = remaining / 3600;
-    *min = (remaining % 3600) / 60;
-    *sec = remaining % 60;
-
-    /* Calculate year */
-    int y = 1970;
-    while (1) {
-        int days_in_year = ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 366 : 365;
-        if (days < (uint32_t)days_in_year) break;
-        days -= days_in_year;
-        y++;
-    }
-    *year = y;
-
-    /* Days in each month */
-    int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) {
-        days_in_month[1] = 29;
-    }
-
-    int m = 0;
-    while (days >= (uint32_t)days_in_month[m]) {
-        days -= days_in_month[m];
-        m++;
-    }
-    *month = m + 1;  /* 1-based month */
-    *day = days + 1;
-}
-
 /*============================================================================
  * NMEA SENTENCE GENERATION
  *============================================================================*/
 
 /**
- * Send NMEA sentence over UART
- */
-static void nmea_send(const char *sentence) {
-    uart_puts(NMEA_UART, sentence);
-    nmea_sentences_sent++;
-}
-
-/**
- * Generate and send $GPZDA sentence
+ * Format $GPZDA sentence
  * Format: $GPZDA,hhmmss.ss,dd,mm,yyyy,xx,yy*cs
  *   hhmmss.ss = UTC time
  *   dd = day
@@ -128,74 +101,96 @@ static void nmea_send(const char *sentence) {
  *   xx = local zone hours (00)
  *   yy = local zone minutes (00)
  */
-static void nmea_send_gpzda(void) {
-    timestamp_t ts = get_current_time();
-    int year, month, day, hour, min, sec;
-    ntp_to_utc(ts.seconds, &year, &month, &day, &hour, &min, &sec);
-
-    /* Calculate fractional seconds from timestamp fraction */
-    int centisec = (ts.fraction >> 24) * 100 / 256;
-
-    char sentence[80];
-    snprintf(sentence, sizeof(sentence),
-             "$GPZDA,%02d%02d%02d.%02d,%02d,%02d,%04d,00,00",
-             hour, min, sec, centisec, day, month, year);
-
-    /* Append checksum */
-    char full[84];
-    snprintf(full, sizeof(full), "%s*%02X\r\n", sentence, nmea_checksum(sentence));
-    nmea_send(full);
+static void nmea_format_gpzda(char *sentence, size_t len, const calendar_t *c) {
+    snprintf(sentence, len,
+             "$GPZDA,%02d%02d%02d.00,%02d,%02d,%04d,00,00",
+             c->hour, c->minute, c->second, c->day, c->month, c->year);
 }
 
 /**
- * Generate and send $GPRMC sentence (Recommended Minimum)
+ * Format $GPRMC sentence (Recommended Minimum)
  * Format: $GPRMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,ddmmyy,x.x,a*cs
  * We output a minimal valid sentence since we don't have actual GPS position
  */
-static void nmea_send_gprmc(void) {
-    timestamp_t ts = get_current_time();
-    int year, month, day, hour, min, sec;
-    ntp_to_utc(ts.seconds, &year, &month, &day, &hour, &min, &sec);
-
-    int centisec = (ts.fraction >> 24) * 100 / 256;
-
+static void nmea_format_gprmc(char *sentence, size_t len, const calendar_t *c) {
     /* Status: A=valid, V=invalid. We say A if time is valid */
     char status = g_time_state.time_valid ? 'A' : 'V';
 
-    char sentence[100];
-    snprintf(sentence, sizeof(sentence),
-             "$GPRMC,%02d%02d%02d.%02d,%c,0000.0000,N,00000.0000,W,0.0,0.0,%02d%02d%02d,0.0,E",
-             hour, min, sec, centisec, status,
-             day, month, year % 100);
-
-    char full[104];
-    snprintf(full, sizeof(full), "%s*%02X\r\n", sentence, nmea_checksum(sentence));
-    nmea_send(full);
+    snprintf(sentence, len,
+             "$GPRMC,%02d%02d%02d.00,%c,0000.0000,N,00000.0000,W,0.0,0.0,%02d%02d%02d,0.0,E",
+             c->hour, c->minute, c->second, status,
+             c->day, c->month, c->year % 100);
 }
 
 /**
- * Generate and send $GPGGA sentence (Fix data)
+ * Format $GPGGA sentence (Fix data)
  * Minimal output indicating time-only (no position fix)
  */
-static void nmea_send_gpgga(void) {
-    timestamp_t ts = get_current_time();
-    int year, month, day, hour, min, sec;
-    ntp_to_utc(ts.seconds, &year, &month, &day, &hour, &min, &sec);
-    (void)year; (void)month; (void)day;
-
-    int centisec = (ts.fraction >> 24) * 100 / 256;
-
+static void nmea_format_gpgga(char *sentence, size_t len, const calendar_t *c) {
     /* Fix quality: 0=invalid, 1=GPS, 2=DGPS. Use 0 since we have no position */
     /* But we have valid time from atomic clock */
+    snprintf(sentence, len,
+             "$GPGGA,%02d%02d%02d.00,0000.0000,N,00000.0000,W,0,00,99.9,0.0,M,0.0,M,,",
+             c->hour, c->minute, c->second);
+}
 
-    char sentence[100];
-    snprintf(sentence, sizeof(sentence),
-             "$GPGGA,%02d%02d%02d.%02d,0000.0000,N,00000.0000,W,0,00,99.9,0.0,M,0.0,M,,",
-             hour, min, sec, centisec);
+/* Burst order */
+static const struct {
+    uint8_t bit;
+    void (*format)(char *sentence, size_t len, const calendar_t *c);
+} nmea_formats[] = {
+    { NMEA_SENT_ZDA, nmea_format_gpzda },
+    { NMEA_SENT_RMC, nmea_format_gprmc },
+    { NMEA_SENT_GGA, nmea_format_gpgga },
+};
 
-    char full[104];
-    snprintf(full, sizeof(full), "%s*%02X\r\n", sentence, nmea_checksum(sentence));
-    nmea_send(full);
+/**
+ * Format the burst for second c and queue it for the next PPS. Sentences
+ * that would run past NMEA_TX_BUDGET_MS at the current baud are dropped.
+ */
+static void nmea_build(const calendar_t *c) {
+    if (nmea_pending >= 0 && nmea_built == c->ntp_secs) {
+        return;
+    }
+
+    /* A stale pending burst may be the one being rebuilt */
+    nmea_pending = -1;
+
+    int idx = nmea_next;
+    char *buf = nmea_burst[idx];
+    uint32_t budget = nmea_baud * NMEA_TX_BUDGET_MS / 10000;    /* 10 bits a byte */
+    if (budget > NMEA_BURST_SIZE) {
+        budget = NMEA_BURST_SIZE;
+    }
+
+    uint32_t len = 0;
+    uint8_t count = 0;
+    for (size_t i = 0; i < sizeof(nmea_formats) / sizeof(nmea_formats[0]); i++) {
+        if (!(nmea_sentences & nmea_formats[i].bit)) {
+            continue;
+        }
+
+        char sentence[NMEA_SENTENCE_MAX];
+        nmea_formats[i].format(sentence, sizeof(sentence), c);
+
+        /* Bytes past len are not sent, so a sentence that does not fit
+         * is dropped by not advancing */
+        int n = snprintf(buf + len, NMEA_BURST_SIZE - len, "%s*%02X\r\n",
+                         sentence, nmea_checksum(sentence));
+        if (n < 0 || len + (uint32_t)n > budget) {
+            nmea_dropped++;
+            continue;
+        }
+        len += (uint32_t)n;
+        count++;
+    }
+
+    nmea_burst_len[idx] = (uint16_t)len;
+    nmea_burst_count[idx] = count;
+    nmea_built = c->ntp_secs;
+    if (len > 0) {
+        nmea_pending = idx;
+    }
 }
 
 /*============================================================================
@@ -203,36 +198,57 @@ static void nmea_send_gpgga(void) {
  *============================================================================*/
 
 /**
- * Initialize NMEA output on UART1
+ * Initialize NMEA output: UART0 and its DMA channel
  */
 void nmea_output_init(void) {
-    /* Initialize UART */
-    uart_init(NMEA_UART, NMEA_BAUD_RATE);
-    gpio_set_function(NMEA_UART_TX, GPIO_FUNC_UART);
+    uart_init(NMEA_UART, nmea_baud);
+    uart_set_format(NMEA_UART, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(NMEA_UART, true);
+    gpio_set_function(GPIO_NMEA_TX, GPIO_FUNC_UART);
+
+    nmea_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(nmea_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, uart_get_dreq(NMEA_UART, true));
+    dma_channel_configure(nmea_dma_chan, &c, &uart_get_hw(NMEA_UART)->dr, NULL, 0, false);
 
     nmea_initialized = true;
-    printf("[NMEA] Initialized on GP%d at %d baud\n", NMEA_UART_TX, NMEA_BAUD_RATE);
+    printf("[NMEA] Initialized on GP%d at %lu baud (UART0, DMA %d)\n",
+           GPIO_NMEA_TX, nmea_baud, nmea_dma_chan);
 }
 
 /**
- * NMEA task - call from main loop
- * Outputs NMEA sentences once per PPS
+ * Rubidium PPS edge, from the capture IRQ: start this second's burst
  */
-void nmea_output_task(void) {
-    if (!nmea_initialized || !nmea_enabled) {
+void nmea_output_pps_edge(void) {
+    int idx = nmea_pending;
+    if (idx < 0) {
         return;
     }
+    nmea_pending = -1;
+    nmea_next = idx ^ 1;
 
-    /* Check if new PPS has occurred */
-    uint32_t pps = g_time_state.pps_count;
-    if (pps != last_pps_count) {
-        last_pps_count = pps;
+    if (dma_channel_is_busy(nmea_dma_chan)) {
+        /* Last second's burst was still going */
+        dma_channel_abort(nmea_dma_chan);
+        nmea_overruns++;
+    }
+    dma_channel_transfer_from_buffer_now(nmea_dma_chan, nmea_burst[idx], nmea_burst_len[idx]);
+    nmea_sentences_sent += nmea_burst_count[idx];
+}
 
-        /* Output sentences immediately after PPS */
-        nmea_send_gpzda();
-        nmea_send_gprmc();
-        nmea_send_gpgga();
+/**
+ * NMEA task - woken each second by the calendar
+ * Formats the burst for the second that starts at the next PPS
+ */
+void nmea_output_task(void) {
+    if (!nmea_initialized || !nmea_enabled) {
+        return;
     }
+
+    nmea_build(calendar_next());
 }
 
 /**
@@ -240,6 +256,9 @@ void nmea_output_task(void) {
  */
 void nmea_output_enable(bool enable) {
     nmea_enabled = enable;
+    if (!enable) {
+        nmea_pending = -1;
+    }
     printf("[NMEA] Output %s\n", enable ? "enabled" : "disabled");
 }
 
@@ -250,9 +269,58 @@ bool nmea_output_is_enabled(void) {
     return nmea_enabled;
 }
 
+/**
+ * Select the sentence set; the next burst is rebuilt with it
+ */
+void nmea_output_set_sentences(uint8_t mask) {
+    nmea_sentences = mask & NMEA_SENT_ALL;
+    nmea_pending = -1;
+}
+
+uint8_t nmea_output_get_sentences(void) {
+    return nmea_sentences;
+}
+
+bool nmea_output_baud_valid(uint32_t baud) {
+    for (size_t i = 0; i < sizeof(nmea_bauds) / sizeof(nmea_bauds[0]); i++) {
+        if (nmea_bauds[i] == baud) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Change the baud rate. A burst in progress is cut short.
+ */
+bool nmea_output_set_baud(uint32_t baud) {
+    if (!nmea_output_baud_valid(baud)) {
+        return false;
+    }
+
+    nmea_baud = baud;
+    nmea_pending = -1;
+    if (nmea_initialized) {
+        dma_channel_abort(nmea_dma_chan);
+        uart_set_baudrate(NMEA_UART, baud);
+    }
+    printf("[NMEA] Baud rate %lu\n", baud);
+    return true;
+}
+
+uint32_t nmea_output_get_baud(void) {
+    return nmea_baud;
+}
+
 /**
  * Get statistics
  */
 uint32_t nmea_output_get_count(void) {
     return nmea_sentences_sent;
 }
+
+void nmea_output_get_stats(uint32_t *sent, uint32_t *overruns, uint32_t *dropped) {
+    if (sent) *sent = nmea_sentences_sent;
+    if (overruns) *overruns = nmea_overruns;
+    if (dropped) *dropped = nmea_dropped;
+}
@@ -3,6 +3,14 @@
  * 
  * Implements NTPv4 server functionality for time distribution.
  * Provides Stratum 1 time when synchronized to rubidium reference.
+ *
+ * Besides client/server mode it can send mode 5 broadcasts to the
+ * subnet or to 224.0.1.1, half way between PPS edges, optionally
+ * interleaved (each packet carries the accurate transmit time of the
+ * one before) and MACed with the unit's AES-CMAC symmetric key (RFC
+ * 8573). Broadcast clients calibrate their delay with ordinary
+ * client/server exchanges, which are answered with a MAC too when the
+ * request carries one under that key.
  * 
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -10,12 +18,26 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
+#include "lwip/netif.h"
+#include "hardware/sync.h"
 
 #include "chronos_rb.h"
+#include "timing_core.h"
+#include "net_timestamp.h"
+#include "eth_w5500.h"
+#include "metrics.h"
+#include "perf_trace.h"
+#include "nts.h"
+#include "aes_siv.h"
+#include "sched.h"
+#include "config.h"
+#include "unit_secret.h"
 
 /*============================================================================
  * NTP CONSTANTS
@@ -29,10 +51,47 @@
 
 #define NTP_MODE_CLIENT     3
 #define NTP_MODE_SERVER     4
+#define NTP_MODE_BROADCAST  5
+
+/* Root dispersion when the time error is unknown: 16 s (MAXDISP), 16.16 */
+#define NTP_MAX_DISPERSION  (16u << 16)
 
 /* Reference ID for rubidium */
 #define NTP_REFID_RBDM      0x5242444D  /* "RBDM" in big-endian */
 
+/* Reference ID of a rate limiting Kiss-o'-Death */
+#define NTP_KISS_RATE       0x52415445  /* "RATE" */
+
+/* Reference ID of an NTS negative acknowledgement (RFC 8915) */
+#define NTP_KISS_NTSN       0x4E54534E  /* "NTSN" */
+
+/* Client table (open addressed, linear probing) */
+#define NTP_CLIENT_PROBES   8           /* Slots tried before evicting */
+
+/* Rate limits, in the spirit of ntpd "restrict limited kod" */
+#define NTP_RATE_MIN_MS     500         /* Shortest allowed request gap */
+#define NTP_RATE_AVG_MS     1000        /* Shortest allowed average gap */
+#define NTP_RATE_AVG_INIT   8000        /* Initial average (allows iburst) */
+#define NTP_RATE_AVG_SHIFT  3           /* EWMA gain 1/8 */
+#define NTP_KOD_MIN_MS      1000        /* At most one KoD per client per second */
+
+/* Broadcast mode */
+#define NTP_BCAST_GROUP     "224.0.1.1" /* IANA NTP multicast group */
+#define NTP_BCAST_PHASE_US  500000      /* Send time after the PPS edge */
+
+/* Symmetric key MAC (RFC 8573): key ID then AES-128-CMAC of the header */
+#define NTP_MAC_SIZE        (4 + AES_SIV_TAG_SIZE)
+
+#if (MAX_NTP_CLIENTS & (MAX_NTP_CLIENTS - 1)) != 0
+#error "MAX_NTP_CLIENTS must be a power of two"
+#endif
+
+typedef enum {
+    NTP_RATE_OK,
+    NTP_RATE_KOD,
+    NTP_RATE_DROP
+} ntp_rate_t;
+
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -44,154 +103,628 @@ static bool ntp_server_running = false;
 static uint32_t ntp_requests_handled = 0;
 static uint32_t ntp_errors = 0;
 static uint64_t last_request_time = 0;
+static uint32_t ntp_interleaved_responses = 0;
+static uint32_t ntp_kod_sent = 0;
+static uint32_t ntp_dropped = 0;
+static uint32_t ntp_nts_responses = 0;
+
+/* Per-client state: rate limiting plus the interleaved mode exchange
+ * (RFC 5905 / draft-ietf-ntp-interleaved-modes) - the receive timestamp
+ * we sent and the accurate transmit time of that reply, which is only
+ * known after the send. Slots are reused but never emptied, so a probe
+ * sequence can stop at the first free slot. */
+typedef struct {
+    uint32_t addr;              /* Client IPv4 address (0 = free) */
+    uint32_t last_ms;           /* Time of last request */
+    uint32_t last_kod_ms;       /* Time of last KoD sent */
+    uint32_t avg_ms;            /* Average request interval (EWMA) */
+    uint32_t requests;          /* Requests received */
+    uint32_t limited;           /* Requests over the rate limit */
+    uint32_t kod_sent;          /* RATE KoDs sent */
+    uint32_t interleaved;       /* Interleaved responses sent */
+    bool have_ts;               /* rx/tx below are valid */
+    timestamp_t rx;             /* Receive timestamp we reported */
+    timestamp_t tx;             /* Driver-level transmit time of that reply */
+} ntp_client_t;
+
+static ntp_client_t clients[MAX_NTP_CLIENTS];
+static uint32_t client_evictions = 0;
+
+/* Load benchmark generator, answered regardless of rate until this time
+ * (network byte order, 0 = none) */
+static uint32_t limit_exempt_addr = 0;
+static uint32_t limit_exempt_until_ms = 0;
+
+/* Response header shared by all clients. Rebuilt only when the timing
+ * core publishes a new snapshot (each PPS or state change), so a request
+ * just patches LI/VN/mode, poll and the three timestamps. */
+static ntp_packet_t resp_template;
+static uint8_t template_li = NTP_LI_ALARM;
+static uint32_t template_publish = 0;
+static bool template_valid = false;
+
+/* Symmetric key, derived from the unit secret at init */
+static aes_siv_key_t sym_key;
+static bool sym_key_valid = false;
+static uint32_t ntp_auth_replies = 0;
+static uint32_t ntp_auth_failed = 0;
+
+/* Broadcast server. The previous packet's stamps go into the next one
+ * in interleaved mode. */
+static bool bcast_enabled = false;
+static bool bcast_multicast = false;
+static bool bcast_xleave = true;
+static bool bcast_auth = false;
+static int8_t bcast_log = NTP_BCAST_LOG_DEFAULT;
+static uint32_t bcast_last_sec = 0;
+static bool bcast_have_prev = false;
+static timestamp_t bcast_prev_tx;       /* Transmit timestamp it carried */
+static timestamp_t bcast_prev_tx_done;  /* Driver-level transmit time */
+static uint32_t bcast_dest = 0;
+static uint32_t bcast_sent = 0;
+static uint32_t bcast_errors = 0;
+
+/* Periodic log (task context) */
+static uint32_t last_logged_requests = 0;
+static uint32_t last_logged_nts = 0;
+static uint64_t last_log_time = 0;
+static float rate_plain = 0.0f;
+static float rate_nts = 0.0f;
+
+/*============================================================================
+ * CLIENT TABLE
+ *============================================================================*/
+
+static inline uint32_t client_hash(uint32_t addr) {
+    return ((addr * 2654435761u) >> 16) & (MAX_NTP_CLIENTS - 1);
+}
+
+/**
+ * Find a client's slot, claiming a free or the least recently seen one
+ * in its probe sequence for a new client
+ */
+static ntp_client_t *client_get(uint32_t addr, uint32_t now_ms) {
+    uint32_t idx = client_hash(addr);
+    ntp_client_t *victim = NULL;
+
+    for (int i = 0; i < NTP_CLIENT_PROBES; i++) {
+        ntp_client_t *c = &clients[(idx + i) & (MAX_NTP_CLIENTS - 1)];
+        if (c->addr == addr) {
+            return c;
+        }
+        if (c->addr == 0) {
+            victim = c;
+            break;
+        }
+        if (victim == NULL || (now_ms - c->last_ms) > (now_ms - victim->last_ms)) {
+            victim = c;
+        }
+    }
+
+    if (victim->addr != 0) {
+        client_evictions++;
+    }
+    memset(victim, 0, sizeof(ntp_client_t));
+    victim->addr = addr;
+    victim->avg_ms = NTP_RATE_AVG_INIT;
+    victim->last_ms = now_ms - NTP_RATE_AVG_INIT;
+    return victim;
+}
+
+/**
+ * Account for a request and decide whether to answer it
+ */
+static ntp_rate_t client_rate_check(ntp_client_t *c, uint32_t now_ms) {
+    uint32_t interval = now_ms - c->last_ms;
+
+    c->last_ms = now_ms;
+    c->requests++;
+
+    /* Every request moves the average, so a client that keeps hammering
+     * while limited stays limited */
+    if (interval >= c->avg_ms) {
+        c->avg_ms += (interval - c->avg_ms) >> NTP_RATE_AVG_SHIFT;
+    } else {
+        c->avg_ms -= (c->avg_ms - interval) >> NTP_RATE_AVG_SHIFT;
+    }
+
+    /* Load benchmark: the generator host stands in for many clients, so
+     * its average still moves but it is always answered */
+    if (limit_exempt_addr != 0 && c->addr == limit_exempt_addr) {
+        if ((int32_t)(limit_exempt_until_ms - now_ms) > 0) {
+            return NTP_RATE_OK;
+        }
+        limit_exempt_addr = 0;
+    }
+
+    if (interval >= NTP_RATE_MIN_MS && c->avg_ms >= NTP_RATE_AVG_MS) {
+        return NTP_RATE_OK;
+    }
+
+    c->limited++;
+    if (now_ms - c->last_kod_ms >= NTP_KOD_MIN_MS) {
+        c->last_kod_ms = now_ms;
+        c->kod_sent++;
+        return NTP_RATE_KOD;
+    }
+    return NTP_RATE_DROP;
+}
+
+/**
+ * Check whether a request refers to our previous reply. An interleaved
+ * client puts our previous receive timestamp in its origin field;
+ * anything else (including a basic client echoing our transmit
+ * timestamp) is basic mode.
+ */
+static bool client_is_interleaved(const ntp_client_t *c, const ntp_packet_t *request) {
+    if (!c->have_ts) {
+        return false;
+    }
+    if (request->orig_ts_sec == 0 && request->orig_ts_frac == 0) {
+        return false;
+    }
+    if (request->orig_ts_sec == request->tx_ts_sec &&
+        request->orig_ts_frac == request->tx_ts_frac) {
+        return false;
+    }
+
+    return ntohl(request->orig_ts_sec) == c->rx.seconds &&
+           ntohl(request->orig_ts_frac) == c->rx.fraction;
+}
+
+/*============================================================================
+ * SYMMETRIC KEY
+ *============================================================================*/
+
+/**
+ * The unit's AES-128-CMAC key, stable across reboots so it can be
+ * written into the clients' key files once
+ */
+static void symmetric_key_derive(uint8_t raw[AES_CMAC_KEY_SIZE]) {
+    unit_secret_derive("CHRONOS-Rb NTP symmetric key", raw, AES_CMAC_KEY_SIZE);
+}
+
+/**
+ * Append key ID and MAC to the 48-byte header at pkt
+ */
+static void symmetric_sign(uint8_t *pkt) {
+    uint32_t key_id = htonl(NTP_BCAST_KEY_ID);
+    memcpy(pkt + NTP_PACKET_SIZE, &key_id, sizeof(key_id));
+    aes_cmac(&sym_key, pkt, NTP_PACKET_SIZE, pkt + NTP_PACKET_SIZE + sizeof(key_id));
+}
+
+/**
+ * Check the key ID and MAC after a 48-byte header
+ */
+static bool symmetric_verify(const uint8_t *pkt) {
+    uint32_t key_id;
+    uint8_t mac[AES_SIV_TAG_SIZE];
+
+    memcpy(&key_id, pkt + NTP_PACKET_SIZE, sizeof(key_id));
+    if (!sym_key_valid || ntohl(key_id) != NTP_BCAST_KEY_ID) {
+        return false;
+    }
+    aes_cmac(&sym_key, pkt, NTP_PACKET_SIZE, mac);
+
+    /* Constant time compare */
+    uint8_t diff = 0;
+    for (int i = 0; i < AES_SIV_TAG_SIZE; i++) {
+        diff |= mac[i] ^ pkt[NTP_PACKET_SIZE + sizeof(key_id) + i];
+    }
+    return diff == 0;
+}
 
 /*============================================================================
  * NTP PACKET HANDLING
  *============================================================================*/
 
 /**
- * Build NTP response packet
+ * Driver-to-air latency of the time interface (us, rounded): measured by
+ * the WiFi link probe, or the wired link's trim. RX stamps move back by
+ * it and TX stamps forward, so clients see the times the frames were on
+ * the medium.
  */
-static void build_ntp_response(ntp_packet_t *request, ntp_packet_t *response,
-                                timestamp_t *rx_time, timestamp_t *tx_time) {
-    memset(response, 0, sizeof(ntp_packet_t));
-    
+static inline int32_t link_latency_us(void) {
+    return (net_ts_link_latency_ns() + 500) / 1000;
+}
+
+/**
+ * Rebuild the static part of the response from the latest snapshot
+ */
+static void template_rebuild(void) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    uint8_t sync_state = snap.state.sync_state;
+
+    memset(&resp_template, 0, sizeof(resp_template));
+
     /* Determine leap indicator based on sync state */
-    uint8_t li = NTP_LI_NONE;
-    if (g_time_state.sync_state == SYNC_STATE_ERROR || 
-        g_time_state.sync_state == SYNC_STATE_INIT) {
-        li = NTP_LI_ALARM;
+    template_li = NTP_LI_NONE;
+    if (sync_state == SYNC_STATE_ERROR ||
+        sync_state == SYNC_STATE_INIT) {
+        template_li = NTP_LI_ALARM;
     }
     
-    /* LI (2 bits) | VN (3 bits) | Mode (3 bits) */
-    uint8_t vn = (request->li_vn_mode >> 3) & 0x07;  /* Use client's version */
-    if (vn < 3) vn = 4;  /* Minimum version 3 */
-    
-    response->li_vn_mode = (li << 6) | (vn << 3) | NTP_MODE_SERVER;
-    
     /* Stratum - 1 for primary reference (rubidium) */
-    if (g_time_state.sync_state == SYNC_STATE_LOCKED) {
-        response->stratum = NTP_STRATUM;
-    } else if (g_time_state.sync_state >= SYNC_STATE_FINE) {
-        response->stratum = NTP_STRATUM + 1;  /* Stratum 2 when not fully locked */
+    if (sync_state == SYNC_STATE_LOCKED) {
+        resp_template.stratum = NTP_STRATUM;
+    } else if (sync_state >= SYNC_STATE_FINE) {
+        resp_template.stratum = NTP_STRATUM + 1;  /* Stratum 2 when not fully locked */
     } else {
-        response->stratum = 16;  /* Unsynchronized */
+        resp_template.stratum = 16;  /* Unsynchronized */
     }
     
-    /* Poll interval (use client's request) */
-    response->poll = request->poll;
-    if (response->poll < NTP_POLL_MIN) response->poll = NTP_POLL_MIN;
-    if (response->poll > NTP_POLL_MAX) response->poll = NTP_POLL_MAX;
-    
     /* Precision (2^precision seconds) - ~1µs = 2^-20 */
-    response->precision = NTP_PRECISION;
+    resp_template.precision = NTP_PRECISION;
     
     /* Root delay and dispersion */
     /* For a stratum 1 server, these are typically very small */
-    response->root_delay = htonl(0);  /* No upstream delay */
+    resp_template.root_delay = htonl(0);  /* No upstream delay */
     
-    /* Root dispersion in NTP format (16.16 fixed point) */
-    /* Based on our actual offset uncertainty */
-    uint32_t dispersion_us = 10;  /* 10 microseconds typical */
-    uint32_t dispersion_ntp = dispersion_us * 65536 / 1000000;
-    response->root_dispersion = htonl(dispersion_ntp);
+    /* Root dispersion in NTP format (16.16 fixed point): the clock
+     * model's time error bound, which grows through holdover. Rounded
+     * up, so never below one unit (~15µs); 16 s (MAXDISP) when unknown. */
+    uint32_t dispersion_ntp = NTP_MAX_DISPERSION;
+    if (snap.state.sync_state >= SYNC_STATE_FINE && snap.time_error_ns != UINT32_MAX) {
+        uint64_t units = ((uint64_t)snap.time_error_ns * 65536 + 999999999) / 1000000000;
+        dispersion_ntp = units < NTP_MAX_DISPERSION ? (uint32_t)units : NTP_MAX_DISPERSION;
+        if (dispersion_ntp == 0) {
+            dispersion_ntp = 1;
+        }
+    }
+    resp_template.root_dispersion = htonl(dispersion_ntp);
     
     /* Reference ID - "RBDM" for rubidium */
-    response->ref_id = htonl(NTP_REFID_RBDM);
+    resp_template.ref_id = htonl(NTP_REFID_RBDM);
     
-    /* Reference timestamp - time of last sync */
+    /* Reference timestamp - start of the current second */
     timestamp_t ref_ts = get_current_time();
-    /* Round to nearest second for reference timestamp */
-    response->ref_ts_sec = htonl(ref_ts.seconds);
-    response->ref_ts_frac = 0;
-    
-    /* Origin timestamp - copy from client's transmit timestamp */
-    response->orig_ts_sec = request->tx_ts_sec;
-    response->orig_ts_frac = request->tx_ts_frac;
-    
-    /* Receive timestamp - when we received the request */
-    response->rx_ts_sec = htonl(rx_time->seconds);
-    response->rx_ts_frac = htonl(rx_time->fraction);
-    
-    /* Transmit timestamp - current time */
-    response->tx_ts_sec = htonl(tx_time->seconds);
-    response->tx_ts_frac = htonl(tx_time->fraction);
+    resp_template.ref_ts_sec = htonl(ref_ts.seconds);
+    resp_template.ref_ts_frac = 0;
+
+    template_publish = snap.publish_count;
+    template_valid = true;
 }
 
 /**
- * Handle incoming NTP request
+ * Turn the request in pkt into a Kiss-o'-Death: stratum 0, no time
+ * information, our timestamps replaced by the client's own transmit
+ * timestamp
  */
-void ntp_handle_request(void *arg, struct udp_pcb *pcb, struct pbuf *p,
-                        const ip_addr_t *addr, uint16_t port) {
-    (void)arg;  /* Unused */
+static void ntp_fill_kiss(ntp_packet_t *pkt, uint8_t vn, int8_t poll, uint32_t refid) {
+    uint32_t client_tx_sec = pkt->tx_ts_sec;
+    uint32_t client_tx_frac = pkt->tx_ts_frac;
+    memset(pkt, 0, NTP_PACKET_SIZE);
+    pkt->li_vn_mode = (NTP_LI_ALARM << 6) | (vn << 3) | NTP_MODE_SERVER;
+    pkt->poll = poll;
+    pkt->precision = NTP_PRECISION;
+    pkt->ref_id = htonl(refid);
+    pkt->orig_ts_sec = client_tx_sec;
+    pkt->orig_ts_frac = client_tx_frac;
+    pkt->rx_ts_sec = client_tx_sec;
+    pkt->rx_ts_frac = client_tx_frac;
+    pkt->tx_ts_sec = client_tx_sec;
+    pkt->tx_ts_frac = client_tx_frac;
+}
+
+/**
+ * Handle incoming NTP request. The reply is written over the request in
+ * the received pbuf and sent from it, so the hot path never allocates.
+ * NTS-protected requests take the same path: the NTS reply is never
+ * longer than the request, so its fields are written in place too.
+ */
+static void ntp_serve(struct udp_pcb *pcb, struct pbuf *p,
+                      const ip_addr_t *addr, uint16_t port) {
     
-    /* Get receive timestamp immediately */
-    timestamp_t rx_time = get_current_time();
+    /* Receive timestamp taken by the driver hook when the frame arrived */
+    uint64_t rx_us = net_ts_rx_us();
+    int32_t link_us = link_latency_us();
+    timestamp_t rx_time = timestamp_from_us(rx_us - link_us);
     
     /* Validate packet size */
     if (p->tot_len < NTP_PACKET_SIZE) {
-        printf("[NTP] Invalid packet size: %d\n", p->tot_len);
         ntp_errors++;
         g_stats.errors++;
         pbuf_free(p);
         return;
     }
     
-    /* Parse request */
-    ntp_packet_t request;
-    pbuf_copy_partial(p, &request, NTP_PACKET_SIZE, 0);
-    pbuf_free(p);
+    /* Chained request (not produced by the CYW43 pool buffers) - flatten.
+     * NTS and the symmetric MAC need the trailer contiguous as well. */
+    bool nts_on = nts_is_enabled();
+    if (p->len < NTP_PACKET_SIZE || ((nts_on || sym_key_valid) && p->len < p->tot_len)) {
+        struct pbuf *q = pbuf_clone(PBUF_TRANSPORT, PBUF_RAM, p);
+        pbuf_free(p);
+        if (q == NULL) {
+            ntp_errors++;
+            g_stats.errors++;
+            return;
+        }
+        p = q;
+    }
+    
+    ntp_packet_t *pkt = (ntp_packet_t *)p->payload;
     
     /* Verify it's a client request */
-    uint8_t mode = request.li_vn_mode & 0x07;
+    uint8_t mode = pkt->li_vn_mode & 0x07;
     if (mode != NTP_MODE_CLIENT) {
         /* Silently ignore non-client packets */
+        pbuf_free(p);
         return;
     }
     
-    /* Get transmit timestamp */
-    timestamp_t tx_time = get_current_time();
+    /* Trailer: a symmetric key MAC (too short to be an NTS request),
+     * NTS extension fields, or ignored */
+    nts_request_t nts;
+    nts.status = NTS_NONE;
+    uint16_t req_len = p->tot_len;
+    bool sym = false;
+    if (req_len == NTP_PACKET_SIZE + NTP_MAC_SIZE) {
+        if (!symmetric_verify((const uint8_t *)pkt)) {
+            ntp_auth_failed++;
+            pbuf_free(p);
+            return;
+        }
+        sym = true;
+    } else if (nts_on && req_len > NTP_PACKET_SIZE) {
+        nts_verify_request((const uint8_t *)pkt, req_len, &nts);
+        if (nts.status == NTS_DROP) {
+            pbuf_free(p);
+            return;
+        }
+    }
     
-    /* Build response */
-    ntp_packet_t response;
-    build_ntp_response(&request, &response, &rx_time, &tx_time);
+    /* Plain reply is a bare 48-byte header - drop any extension fields */
+    if (nts.status == NTS_NONE && !sym && req_len > NTP_PACKET_SIZE) {
+        pbuf_realloc(p, NTP_PACKET_SIZE);
+    }
     
-    /* Allocate pbuf for response */
-    struct pbuf *resp_pbuf = pbuf_alloc(PBUF_TRANSPORT, NTP_PACKET_SIZE, PBUF_RAM);
-    if (resp_pbuf == NULL) {
-        printf("[NTP] Failed to allocate response buffer\n");
-        ntp_errors++;
-        g_stats.errors++;
+    uint32_t now_ms = (uint32_t)(time_us_64() / 1000);
+    ntp_client_t *client = client_get(ip_addr_get_ip4_u32(addr), now_ms);
+    ntp_rate_t rate = client_rate_check(client, now_ms);
+    
+    /* NTS and symmetric key clients ignore unauthenticated kisses, so
+     * a RATE kiss is no use to them: just drop */
+    if (rate == NTP_RATE_KOD && (nts.status != NTS_NONE || sym)) {
+        rate = NTP_RATE_DROP;
+    }
+    if (rate == NTP_RATE_DROP) {
+        ntp_dropped++;
+        pbuf_free(p);
         return;
     }
+    bool interleaved = (rate == NTP_RATE_OK) && client_is_interleaved(client, pkt);
     
-    /* Copy response to pbuf */
-    memcpy(resp_pbuf->payload, &response, NTP_PACKET_SIZE);
+    /* Capture the request fields the reply needs before overwriting */
+    uint8_t vn = (pkt->li_vn_mode >> 3) & 0x07;  /* Use client's version */
+    if (vn < 3) vn = 4;  /* Minimum version 3 */
+    int8_t poll = pkt->poll;
+    if (poll < NTP_POLL_MIN) poll = NTP_POLL_MIN;
+    if (poll > NTP_POLL_MAX) poll = NTP_POLL_MAX;
+    
+    /* Origin: client's transmit timestamp, or in interleaved mode the
+     * client's receive timestamp of our previous reply */
+    uint32_t orig_sec = interleaved ? pkt->rx_ts_sec : pkt->tx_ts_sec;
+    uint32_t orig_frac = interleaved ? pkt->rx_ts_frac : pkt->tx_ts_frac;
+    
+    if (rate == NTP_RATE_KOD) {
+        ntp_fill_kiss(pkt, vn, poll, NTP_KISS_RATE);
+        if (udp_sendto(pcb, p, addr, port) == ERR_OK) {
+            ntp_kod_sent++;
+        }
+        pbuf_free(p);
+        return;
+    }
+    
+    if (nts.status == NTS_NAK) {
+        /* Unknown cookie (key rotated out, or server rebooted): NTSN
+         * kiss echoing the Unique Identifier tells the client to redo
+         * NTS-KE */
+        ntp_fill_kiss(pkt, vn, poll, NTP_KISS_NTSN);
+        size_t len = nts_finish_response(&nts, (uint8_t *)pkt, req_len);
+        if (len != 0) {
+            pbuf_realloc(p, (uint16_t)len);
+            udp_sendto(pcb, p, addr, port);
+        }
+        pbuf_free(p);
+        return;
+    }
+    
+    if (!template_valid || timing_core_publish_count() != template_publish) {
+        template_rebuild();
+    }
+    
+    /* Patch the template into the received buffer */
+    memcpy(pkt, &resp_template, offsetof(ntp_packet_t, orig_ts_sec));
+    pkt->li_vn_mode = (template_li << 6) | (vn << 3) | NTP_MODE_SERVER;
+    pkt->poll = poll;
+    pkt->orig_ts_sec = orig_sec;
+    pkt->orig_ts_frac = orig_frac;
+    pkt->rx_ts_sec = htonl(rx_time.seconds);
+    pkt->rx_ts_frac = htonl(rx_time.fraction);
+    
+    /* Transmit: accurate time of the previous reply when interleaved,
+     * else as late as possible before the send */
+    timestamp_t tx_time = interleaved ? client->tx : get_current_time();
+    pkt->tx_ts_sec = htonl(tx_time.seconds);
+    pkt->tx_ts_frac = htonl(tx_time.fraction);
+    
+    /* NTS: new cookies and the authenticator over the finished header.
+     * Sealing sits between the transmit stamp and the send, so NTS
+     * clients get their best accuracy from interleaved mode. */
+    if (nts.status == NTS_OK) {
+        size_t len = nts_finish_response(&nts, (uint8_t *)pkt, req_len);
+        if (len == 0) {
+            ntp_errors++;
+            g_stats.errors++;
+            pbuf_free(p);
+            return;
+        }
+        pbuf_realloc(p, (uint16_t)len);
+    } else if (sym) {
+        symmetric_sign((uint8_t *)pkt);
+    }
     
     /* Send response */
-    err_t err = udp_sendto(pcb, resp_pbuf, addr, port);
-    pbuf_free(resp_pbuf);
+    uint32_t tx_count = net_ts_tx_count();
+    err_t err = udp_sendto(pcb, p, addr, port);
+    uint64_t tx_done_us = net_ts_tx_since(tx_count);
+    pbuf_free(p);
     
     if (err != ERR_OK) {
-        printf("[NTP] Failed to send response: %d\n", err);
         ntp_errors++;
         g_stats.errors++;
         return;
     }
     
+    /* Remember when this reply actually left for the client's next poll */
+    client->rx = rx_time;
+    client->tx = timestamp_from_us(tx_done_us + link_us);
+    client->have_ts = true;
+    
     /* Update statistics */
+    if (nts.status == NTS_OK) {
+        metrics_observe(METRIC_NTS_SERVICE, (int32_t)(tx_done_us - rx_us));
+        ntp_nts_responses++;
+    } else {
+        if (sym) {
+            ntp_auth_replies++;
+        }
+        metrics_observe(METRIC_NTP_SERVICE, (int32_t)(tx_done_us - rx_us));
+    }
     ntp_requests_handled++;
+    if (interleaved) {
+        client->interleaved++;
+        ntp_interleaved_responses++;
+    }
     g_stats.ntp_requests++;
     last_request_time = time_us_64();
     
     /* Blink activity LED */
     led_blink_activity();
-    
-    /* Debug output (every 100 requests) */
-    if (ntp_requests_handled % 100 == 0) {
-        printf("[NTP] Handled %lu requests (stratum %d)\n", 
-               ntp_requests_handled, response.stratum);
+}
+
+void ntp_handle_request(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *addr, uint16_t port) {
+    (void)arg;  /* Unused */
+    PERF_CALL(PERF_NTP_REQUEST, ntp_serve(pcb, p, addr, port));
+}
+
+/*============================================================================
+ * BROADCAST MODE
+ *============================================================================*/
+
+/**
+ * Destination of the next broadcast: the NTP group, or the directed
+ * broadcast of the time interface's subnet
+ */
+static bool broadcast_dest(ip_addr_t *dst) {
+    if (bcast_multicast) {
+        return ipaddr_aton(NTP_BCAST_GROUP, dst) != 0;
+    }
+    struct netif *netif = net_ts_time_netif();
+    if (netif == NULL || !netif_is_up(netif)) {
+        return false;
+    }
+    uint32_t addr = ip4_addr_get_u32(netif_ip4_addr(netif));
+    uint32_t mask = ip4_addr_get_u32(netif_ip4_netmask(netif));
+    if (addr == 0) {
+        return false;
+    }
+    ip_addr_set_ip4_u32(dst, addr | ~mask);
+    return true;
+}
+
+/**
+ * Send one mode 5 packet. Interleaved, origin and receive carry the
+ * previous packet's driver-level transmit time and the transmit
+ * timestamp it was sent with, so a client can pair them up.
+ */
+static void broadcast_send(void) {
+    ip_addr_t dst;
+    if (!broadcast_dest(&dst)) {
+        bcast_errors++;
+        return;
+    }
+
+    uint16_t len = NTP_PACKET_SIZE + ((bcast_auth && sym_key_valid) ? NTP_MAC_SIZE : 0);
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (p == NULL) {
+        bcast_errors++;
+        return;
+    }
+
+    if (!template_valid || timing_core_publish_count() != template_publish) {
+        template_rebuild();
+    }
+
+    ntp_packet_t *pkt = (ntp_packet_t *)p->payload;
+    memset(pkt, 0, NTP_PACKET_SIZE);
+    memcpy(pkt, &resp_template, offsetof(ntp_packet_t, orig_ts_sec));
+    pkt->li_vn_mode = (template_li << 6) | (NTP_VERSION << 3) | NTP_MODE_BROADCAST;
+    pkt->poll = bcast_log;
+    if (bcast_xleave && bcast_have_prev) {
+        pkt->orig_ts_sec = htonl(bcast_prev_tx_done.seconds);
+        pkt->orig_ts_frac = htonl(bcast_prev_tx_done.fraction);
+        pkt->rx_ts_sec = htonl(bcast_prev_tx.seconds);
+        pkt->rx_ts_frac = htonl(bcast_prev_tx.fraction);
+    }
+
+    /* The MAC takes a few block encryptions between the stamp and the
+     * send, which interleaved clients never see */
+    timestamp_t tx_time = get_current_time();
+    pkt->tx_ts_sec = htonl(tx_time.seconds);
+    pkt->tx_ts_frac = htonl(tx_time.fraction);
+    if (len > NTP_PACKET_SIZE) {
+        symmetric_sign((uint8_t *)pkt);
+    }
+
+    /* Keep lwIP callbacks out so the TX stamp belongs to this frame */
+    cyw43_arch_lwip_begin();
+    uint32_t tx_count = net_ts_tx_count();
+    err_t err = udp_sendto(ntp_pcb, p, &dst, NTP_PORT);
+    uint64_t tx_done_us = net_ts_tx_since(tx_count);
+    cyw43_arch_lwip_end();
+    pbuf_free(p);
+
+    bcast_dest = ip_addr_get_ip4_u32(&dst);
+    if (err != ERR_OK) {
+        bcast_errors++;
+        bcast_have_prev = false;
+        return;
     }
+
+    bcast_prev_tx = tx_time;
+    bcast_prev_tx_done = timestamp_from_us(tx_done_us + link_latency_us());
+    bcast_have_prev = true;
+    bcast_sent++;
+    led_blink_activity();
+}
+
+/**
+ * Broadcast task - woken by each new second, it sends at
+ * NTP_BCAST_PHASE_US into every 2^bcast_log th second, clear of the
+ * work both cores do at the edge
+ */
+void ntp_broadcast_task(void) {
+    if (!bcast_enabled || ntp_pcb == NULL) {
+        return;
+    }
+
+    timestamp_t now = get_current_time();
+    if (now.seconds == bcast_last_sec ||
+        (now.seconds & ((1u << bcast_log) - 1)) != 0) {
+        return;
+    }
+
+    uint32_t frac_us = (uint32_t)(((uint64_t)now.fraction * 1000000) >> 32);
+    if (frac_us < NTP_BCAST_PHASE_US) {
+        sched_wake_in(NTP_BCAST_PHASE_US - frac_us);
+        return;
+    }
+
+    bcast_last_sec = now.seconds;
+    broadcast_send();
 }
 
 /*============================================================================
@@ -209,6 +742,29 @@ void ntp_server_init(void) {
 
     printf("[NTP] Initializing NTP server\n");
 
+    /* Driver-level RX/TX timestamps */
+    net_ts_attach();
+    memset(clients, 0, sizeof(clients));
+    template_valid = false;
+
+    /* Symmetric key for MACed broadcasts and client/server exchanges */
+    if (!sym_key_valid) {
+        uint8_t raw[AES_CMAC_KEY_SIZE];
+        symmetric_key_derive(raw);
+        sym_key_valid = aes_cmac_setkey(&sym_key, raw);
+        memset(raw, 0, sizeof(raw));
+    }
+
+    config_t *cfg = config_get();
+    if (!ntp_broadcast_set_interval(cfg->ntp_bcast_log)) {
+        ntp_broadcast_set_interval(NTP_BCAST_LOG_DEFAULT);
+    }
+    bcast_multicast = cfg->ntp_bcast_multicast;
+    bcast_xleave = cfg->ntp_bcast_xleave;
+    bcast_auth = cfg->ntp_bcast_auth;
+    bcast_enabled = cfg->ntp_bcast_enabled;
+    bcast_have_prev = false;
+
     /* Create UDP PCB */
     ntp_pcb = udp_new();
     if (ntp_pcb == NULL) {
@@ -227,18 +783,59 @@ void ntp_server_init(void) {
     
     /* Set receive callback */
     udp_recv(ntp_pcb, ntp_handle_request, NULL);
+    ip_set_option(ntp_pcb, SOF_BROADCAST);
     
     ntp_server_running = true;
     printf("[NTP] Server listening on port %d\n", NTP_PORT);
     printf("[NTP] Reference ID: RBDM (Rubidium)\n");
+    if (bcast_enabled) {
+        printf("[NTP] Broadcasting to %s every 2^%d s%s%s\n",
+               bcast_multicast ? NTP_BCAST_GROUP : "subnet", bcast_log,
+               bcast_xleave ? ", interleaved" : "", bcast_auth ? ", MAC" : "");
+    }
 }
 
 /**
  * NTP server task - call periodically
  */
 void ntp_server_task(void) {
-    /* Currently nothing needed here - all handling is in callbacks */
-    /* Could add periodic cleanup or statistics logging */
+    /* Follow the wired link coming and going */
+    if (net_ts_bind_pcb(ntp_pcb)) {
+        printf("[NTP] Serving on %s\n", eth_time_netif() != NULL ? "wired Ethernet" : "all interfaces");
+    }
+
+    /* Request handling is all in the receive callback; log load here so
+     * the hot path never calls printf */
+    uint64_t now = time_us_64();
+    if (now - last_log_time < 60000000ULL) {
+        return;
+    }
+    float window_s = (last_log_time != 0) ? (now - last_log_time) / 1e6f : 0.0f;
+    last_log_time = now;
+
+    uint32_t handled = ntp_requests_handled;
+    uint32_t nts = ntp_nts_responses;
+    uint32_t nts_delta = nts - last_logged_nts;
+    uint32_t plain_delta = (handled - last_logged_requests) - nts_delta;
+    if (window_s > 0.0f) {
+        rate_plain = plain_delta / window_s;
+        rate_nts = nts_delta / window_s;
+    }
+
+    if (handled != last_logged_requests) {
+        printf("[NTP] Handled %" PRIu32 " requests (%" PRIu32 " in last 60s, %" PRIu32 " interleaved, %" PRIu32 " errors)\n",
+               handled, handled - last_logged_requests,
+               ntp_interleaved_responses, ntp_errors);
+        if (nts_delta != 0) {
+            printf("[NTP] Load: %.1f plain/s, %.1f NTS/s\n", rate_plain, rate_nts);
+        }
+        if (ntp_kod_sent != 0 || ntp_dropped != 0) {
+            printf("[NTP] Rate limited: %" PRIu32 " KoD sent, %" PRIu32 " dropped\n",
+                   ntp_kod_sent, ntp_dropped);
+        }
+        last_logged_requests = handled;
+        last_logged_nts = nts;
+    }
 }
 
 /**
@@ -256,6 +853,152 @@ void ntp_get_statistics(uint32_t *requests, uint32_t *errors) {
     *errors = ntp_errors;
 }
 
+/**
+ * Get number of interleaved-mode responses sent
+ */
+uint32_t ntp_get_interleaved_count(void) {
+    return ntp_interleaved_responses;
+}
+
+/**
+ * Get number of NTS-authenticated responses sent
+ */
+uint32_t ntp_get_nts_count(void) {
+    return ntp_nts_responses;
+}
+
+/**
+ * Get plain and NTS reply rates over the last log window (per second)
+ */
+void ntp_get_rates(float *plain_per_s, float *nts_per_s) {
+    *plain_per_s = rate_plain;
+    *nts_per_s = rate_nts;
+}
+
+/**
+ * Get rate limiting totals
+ */
+void ntp_get_limit_stats(uint32_t *kod_sent, uint32_t *dropped) {
+    *kod_sent = ntp_kod_sent;
+    *dropped = ntp_dropped;
+}
+
+/**
+ * Answer one client address (network byte order) regardless of rate for
+ * the next seconds (addr or seconds 0 ends it). Used by the load
+ * benchmark, which refreshes it each step.
+ */
+void ntp_set_limit_exempt(uint32_t addr, uint32_t seconds) {
+    limit_exempt_until_ms = (uint32_t)(time_us_64() / 1000) + seconds * 1000;
+    limit_exempt_addr = (seconds != 0) ? addr : 0;
+}
+
+/**
+ * Copy the client table, busiest clients first. Returns the number of
+ * entries written.
+ */
+int ntp_get_clients(ntp_client_info_t *out, int max) {
+    int n = 0;
+    uint32_t now_ms = (uint32_t)(time_us_64() / 1000);
+
+    /* The table is updated from the lwIP callback on this core */
+    uint32_t irq = save_and_disable_interrupts();
+    for (int i = 0; i < MAX_NTP_CLIENTS; i++) {
+        const ntp_client_t *c = &clients[i];
+        if (c->addr == 0) {
+            continue;
+        }
+
+        /* Insertion sort by request count, keeping the top max */
+        int pos = n;
+        while (pos > 0 && out[pos - 1].requests < c->requests) {
+            pos--;
+        }
+        if (pos >= max) {
+            continue;
+        }
+        int last = (n < max) ? n : max - 1;
+        memmove(&out[pos + 1], &out[pos], (last - pos) * sizeof(ntp_client_info_t));
+
+        out[pos].addr = c->addr;
+        out[pos].requests = c->requests;
+        out[pos].limited = c->limited;
+        out[pos].kod_sent = c->kod_sent;
+        out[pos].avg_interval_ms = c->avg_ms;
+        out[pos].idle_ms = now_ms - c->last_ms;
+        out[pos].interleaved = c->interleaved;
+        if (n < max) {
+            n++;
+        }
+    }
+    restore_interrupts(irq);
+
+    return n;
+}
+
+/**
+ * Enable/disable mode 5 broadcasts
+ */
+void ntp_broadcast_enable(bool enable) {
+    bcast_enabled = enable;
+    bcast_have_prev = false;
+    printf("[NTP] Broadcast %s\n", enable ? "enabled" : "disabled");
+}
+
+/**
+ * Set the broadcast interval (log2 s, NTP_POLL_MIN..NTP_POLL_MAX)
+ */
+bool ntp_broadcast_set_interval(int8_t log_interval) {
+    if (log_interval < NTP_POLL_MIN || log_interval > NTP_POLL_MAX) {
+        return false;
+    }
+    bcast_log = log_interval;
+    return true;
+}
+
+/**
+ * Send to 224.0.1.1 rather than the subnet broadcast address
+ */
+void ntp_broadcast_set_multicast(bool multicast) {
+    bcast_multicast = multicast;
+    bcast_have_prev = false;
+}
+
+/**
+ * Interleaved broadcast. Off for clients that only know basic mode.
+ */
+void ntp_broadcast_set_xleave(bool xleave) {
+    bcast_xleave = xleave;
+    bcast_have_prev = false;
+}
+
+/**
+ * MAC broadcasts with the symmetric key
+ */
+void ntp_broadcast_set_auth(bool auth) {
+    bcast_auth = auth;
+}
+
+void ntp_broadcast_get_info(ntp_bcast_info_t *info) {
+    info->enabled = bcast_enabled;
+    info->multicast = bcast_multicast;
+    info->xleave = bcast_xleave;
+    info->auth = bcast_auth;
+    info->log_interval = bcast_log;
+    info->dest = bcast_dest;
+    info->sent = bcast_sent;
+    info->errors = bcast_errors;
+    info->auth_replies = ntp_auth_replies;
+    info->auth_failed = ntp_auth_failed;
+}
+
+/**
+ * The raw symmetric key, for the clients' key files
+ */
+void ntp_get_symmetric_key(uint8_t key[16]) {
+    symmetric_key_derive(key);
+}
+
 /**
  * Shutdown NTP server
  */
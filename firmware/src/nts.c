@@ -11,19 +11,19 @@
  *
  * 2. NTS-protected NTP - UDP port 123
  *    - Standard NTP with NTS extension fields
- *    - AEAD encryption (AES-SIV recommended)
+ *    - AEAD_AES_SIV_CMAC_256 (aes_siv.c)
  *    - Cookie-based key management
  *
- * IMPLEMENTATION STATUS:
- * This is a skeleton implementation. Full NTS requires:
- * - TLS 1.3 library (mbedTLS or similar)
- * - AEAD implementation (AES-SIV or AES-GCM)
- * - ~50KB additional flash for crypto
+ * This file is the NTP side: ntp_server.c hands requests with extension
+ * fields to nts_verify_request() and nts_finish_response(), and answers
+ * them in the received buffer like plain ones. NTS-KE is nts_ke.c.
  *
- * For now, this module provides:
- * - Protocol structure definitions
- * - Extension field parsing
- * - Placeholder for future TLS integration
+ * Cookies are key ID || nonce || SIV(master, AD = key ID, C2S || S2C).
+ * The server keeps no per-client state beyond a small cache of expanded
+ * session keys: every cookie of a KE session carries the same keys, so
+ * a client's whole cookie chain hits one cache slot and costs a single
+ * key expansion. Master keys rotate daily; the previous one still opens
+ * cookies for one more period.
  *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -33,220 +33,250 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
-#include "lwip/tcp.h"
+#include "pico/rand.h"
 
 #include "chronos_rb.h"
 #include "nts.h"
+#include "nts_ke.h"
+#include "aes_siv.h"
 
 /*============================================================================
  * CONFIGURATION
  *============================================================================*/
 
-#define NTS_KE_PORT         4460    /* NTS Key Establishment */
-#define NTS_NTP_PORT        123     /* Same as NTP */
-
-/* NTS-KE record types */
-#define NTS_KE_END          0       /* End of message */
-#define NTS_KE_NEXT_PROTO   1       /* Next protocol negotiation */
-#define NTS_KE_ERROR        2       /* Error */
-#define NTS_KE_WARNING      3       /* Warning */
-#define NTS_KE_AEAD_ALGO    4       /* AEAD algorithm negotiation */
-#define NTS_KE_COOKIE       5       /* New cookie */
-#define NTS_KE_SERVER       6       /* NTPv4 server negotiation */
-#define NTS_KE_PORT_NEG     7       /* NTPv4 port negotiation */
-
-/* AEAD algorithm IDs */
-#define AEAD_AES_SIV_CMAC_256   15  /* Recommended */
-#define AEAD_AES_128_GCM_SIV    30
-
 /* NTP extension field types for NTS */
 #define EF_NTS_UNIQUE_ID    0x0104  /* Unique identifier */
 #define EF_NTS_COOKIE       0x0204  /* NTS cookie */
 #define EF_NTS_COOKIE_PLAC  0x0304  /* Cookie placeholder */
 #define EF_NTS_AUTH         0x0404  /* NTS authenticator */
 
-/* Cookie size */
-#define NTS_COOKIE_SIZE     128
+#define EF_HEADER_SIZE      4
+#define UID_MIN             32      /* RFC 8915: at least 32 octets */
+#define NONCE_SIZE          16      /* Server nonces */
+#define NONCE_MAX           32      /* Longest client nonce accepted */
+#define COOKIE_EF_SIZE      (EF_HEADER_SIZE + NTS_COOKIE_SIZE)
+
+/* Cookie layout */
+#define COOKIE_ID_SIZE      4
+#define COOKIE_KEYS_SIZE    (2 * NTS_KEY_SIZE)
+
+/* Encrypted EFs a client may send, decrypted and ignored */
+#define NTS_PLAIN_MAX       256
+
+/* Expanded session keys kept */
+#define NTS_SESSION_CACHE   8
+
+/* Master key lifetime; cookies stay valid for up to twice this */
+#define NTS_MASTER_ROTATE_US    (24ULL * 3600 * 1000000)
 
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
 
-static struct tcp_pcb *nts_ke_pcb = NULL;
+typedef struct {
+    uint32_t id;
+    bool valid;
+    aes_siv_key_t key;
+} nts_master_t;
+
+typedef struct {
+    bool valid;
+    uint32_t last_used;
+    uint8_t keys[COOKIE_KEYS_SIZE];     /* C2S || S2C, for new cookies */
+    aes_siv_key_t c2s;
+    aes_siv_key_t s2c;
+} nts_session_t;
+
 static bool nts_enabled = false;
-static uint32_t nts_ke_connections = 0;
-static uint32_t nts_ntp_requests = 0;
-
-/* Server master key (for cookie encryption - MUST be randomly generated) */
-static uint8_t master_key[32] = {
-    /* Placeholder - should be generated at first boot and stored in flash */
-    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
-    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
-    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f
-};
+static nts_auth_stats_t nts_stats = {0};
+
+/* Server master keys (for cookie encryption), generated at boot and
+ * rotated; current is masters[master_current] */
+static nts_master_t masters[2];
+static int master_current = 0;
+static uint64_t master_rotated_us = 0;
+
+static nts_session_t sessions[NTS_SESSION_CACHE];
+static uint32_t session_clock = 0;
+
+/* Server nonces: a boot-random prefix and a counter, unique per seal */
+static uint64_t nonce_prefix = 0;
+static uint64_t nonce_counter = 0;
+
+static uint8_t plain_buf[NTS_MAX_COOKIES * COOKIE_EF_SIZE];
 
 /*============================================================================
- * NTS-KE RECORD BUILDING
+ * HELPERS
  *============================================================================*/
 
-/**
- * Build NTS-KE response (placeholder - needs TLS wrapper)
- *
- * A real implementation would:
- * 1. Complete TLS 1.3 handshake
- * 2. Export keying material using TLS exporter
- * 3. Generate cookies encrypted with server key
- * 4. Send NTS-KE records over TLS
- */
-static int build_nts_ke_response(uint8_t *buf, size_t max_len) {
-    int pos = 0;
-
-    /* Record: Next Protocol (NTPv4 = 0) */
-    buf[pos++] = 0x80 | NTS_KE_NEXT_PROTO;  /* Critical bit set */
-    buf[pos++] = NTS_KE_NEXT_PROTO;
-    buf[pos++] = 0x00;  /* Length MSB */
-    buf[pos++] = 0x02;  /* Length LSB */
-    buf[pos++] = 0x00;  /* Protocol ID MSB */
-    buf[pos++] = 0x00;  /* Protocol ID LSB (NTPv4) */
-
-    /* Record: AEAD Algorithm (AES-SIV-CMAC-256) */
-    buf[pos++] = 0x80 | NTS_KE_AEAD_ALGO;
-    buf[pos++] = NTS_KE_AEAD_ALGO;
-    buf[pos++] = 0x00;
-    buf[pos++] = 0x02;
-    buf[pos++] = 0x00;
-    buf[pos++] = AEAD_AES_SIV_CMAC_256;
-
-    /* Record: Cookie (placeholder - needs real encryption) */
-    /* In real implementation, cookie contains:
-     * - AEAD algorithm
-     * - S2C key (encrypted)
-     * - C2S key (encrypted)
-     * All encrypted with server master key */
-    buf[pos++] = NTS_KE_COOKIE;
-    buf[pos++] = NTS_KE_COOKIE;
-    buf[pos++] = 0x00;
-    buf[pos++] = NTS_COOKIE_SIZE;
-    /* Placeholder cookie data */
-    memset(buf + pos, 0xCC, NTS_COOKIE_SIZE);
-    pos += NTS_COOKIE_SIZE;
-
-    /* Provide 8 cookies (recommended) */
-    for (int i = 0; i < 7; i++) {
-        buf[pos++] = NTS_KE_COOKIE;
-        buf[pos++] = NTS_KE_COOKIE;
-        buf[pos++] = 0x00;
-        buf[pos++] = NTS_COOKIE_SIZE;
-        memset(buf + pos, 0xCC + i, NTS_COOKIE_SIZE);
-        pos += NTS_COOKIE_SIZE;
-    }
+static uint16_t read_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void write_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
 
-    /* Record: End of message */
-    buf[pos++] = 0x80 | NTS_KE_END;
-    buf[pos++] = NTS_KE_END;
-    buf[pos++] = 0x00;
-    buf[pos++] = 0x00;
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
 
-    return pos;
+static void next_nonce(uint8_t nonce[NONCE_SIZE]) {
+    uint64_t n = nonce_counter++;
+    memcpy(nonce, &nonce_prefix, 8);
+    memcpy(nonce + 8, &n, 8);
+}
+
+static void write_ef_header(uint8_t *p, uint16_t type, uint16_t len) {
+    write_be16(p, type);
+    write_be16(p + 2, len);
+}
+
+static uint32_t pad4(uint32_t n) {
+    return (n + 3) & ~3u;
 }
 
 /*============================================================================
- * NTP EXTENSION FIELD PARSING
+ * MASTER KEYS AND SESSION CACHE
  *============================================================================*/
 
 /**
- * Parse NTS extension fields from NTP packet
- * Returns true if valid NTS request
+ * Make a fresh master key current, keeping the old one for opening
  */
-static bool parse_nts_extensions(const uint8_t *pkt, size_t len,
-                                 uint8_t *cookie, size_t *cookie_len,
-                                 uint8_t *unique_id, size_t *unique_id_len) {
-    /* NTP packet is 48 bytes minimum, extensions follow */
-    if (len <= 48) return false;
-
-    size_t pos = 48;
-    bool has_cookie = false;
-    bool has_unique_id = false;
-    bool has_auth = false;
+static void master_rotate(void) {
+    uint8_t raw[AES_SIV_KEY_SIZE];
 
-    while (pos + 4 <= len) {
-        uint16_t field_type = (pkt[pos] << 8) | pkt[pos + 1];
-        uint16_t field_len = (pkt[pos + 2] << 8) | pkt[pos + 3];
-
-        /* Field length must be multiple of 4 and include header */
-        if (field_len < 4 || (field_len & 3) != 0) break;
-        if (pos + field_len > len) break;
+    for (int i = 0; i < AES_SIV_KEY_SIZE; i += 8) {
+        uint64_t r = get_rand_64();
+        memcpy(raw + i, &r, 8);
+    }
 
-        switch (field_type) {
-            case EF_NTS_UNIQUE_ID:
-                if (unique_id && unique_id_len && field_len > 4) {
-                    *unique_id_len = field_len - 4;
-                    memcpy(unique_id, pkt + pos + 4, *unique_id_len);
-                    has_unique_id = true;
-                }
-                break;
+    int next = master_current ^ 1;
+    uint32_t id = masters[master_current].valid ? masters[master_current].id + 1
+                                                : (uint32_t)get_rand_32();
+    if (masters[next].valid) {
+        aes_siv_free(&masters[next].key);
+    }
+    masters[next].valid = aes_siv_setkey(&masters[next].key, raw);
+    masters[next].id = id;
+    memset(raw, 0, sizeof(raw));
+
+    if (masters[next].valid) {
+        master_current = next;
+        nts_stats.master_id = id;
+        nts_stats.rotations++;
+    }
+    master_rotated_us = time_us_64();
+}
 
-            case EF_NTS_COOKIE:
-                if (cookie && cookie_len && field_len > 4) {
-                    *cookie_len = field_len - 4;
-                    memcpy(cookie, pkt + pos + 4, *cookie_len);
-                    has_cookie = true;
-                }
-                break;
+static const nts_master_t *master_find(uint32_t id) {
+    for (int i = 0; i < 2; i++) {
+        if (masters[i].valid && masters[i].id == id) {
+            return &masters[i];
+        }
+    }
+    return NULL;
+}
 
-            case EF_NTS_AUTH:
-                has_auth = true;
-                /* Would verify AEAD tag here */
-                break;
+/**
+ * Expanded keys for keys (C2S || S2C): a cached slot, or the least
+ * recently used one re-expanded. Returns the slot, -1 on failure.
+ */
+static int session_get(const uint8_t keys[COOKIE_KEYS_SIZE]) {
+    int victim = 0;
+
+    for (int i = 0; i < NTS_SESSION_CACHE; i++) {
+        nts_session_t *s = &sessions[i];
+        if (s->valid && memcmp(s->keys, keys, COOKIE_KEYS_SIZE) == 0) {
+            s->last_used = ++session_clock;
+            nts_stats.cache_hits++;
+            return i;
         }
+        if (!s->valid) {
+            victim = i;
+        } else if (sessions[victim].valid &&
+                   (int32_t)(s->last_used - sessions[victim].last_used) < 0) {
+            victim = i;
+        }
+    }
 
-        pos += field_len;
+    nts_session_t *s = &sessions[victim];
+    if (s->valid) {
+        aes_siv_free(&s->c2s);
+        aes_siv_free(&s->s2c);
+        s->valid = false;
     }
+    nts_stats.cache_misses++;
 
-    return has_cookie && has_unique_id && has_auth;
+    if (!aes_siv_setkey(&s->c2s, keys) ||
+        !aes_siv_setkey(&s->s2c, keys + NTS_KEY_SIZE)) {
+        return -1;
+    }
+    memcpy(s->keys, keys, COOKIE_KEYS_SIZE);
+    s->valid = true;
+    s->last_used = ++session_clock;
+    return victim;
 }
 
-/*============================================================================
- * TCP CALLBACKS (NTS-KE)
- *============================================================================*/
-
 /**
- * NTS-KE connection accepted
- *
- * Note: This is a placeholder. Real implementation needs:
- * 1. TLS 1.3 handshake (requires mbedTLS integration)
- * 2. ALPN negotiation for "ntske/1"
- * 3. Key export after handshake
+ * Open a cookie into its session keys
  */
-static err_t nts_ke_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
-    (void)arg;
+static bool cookie_open(const uint8_t *cookie, uint8_t keys[COOKIE_KEYS_SIZE]) {
+    const nts_master_t *m = master_find(read_be32(cookie));
+    if (m == NULL) {
+        return false;
+    }
+    return aes_siv_open(&m->key, cookie, COOKIE_ID_SIZE,
+                        cookie + COOKIE_ID_SIZE, NONCE_SIZE,
+                        cookie + COOKIE_ID_SIZE + NONCE_SIZE,
+                        AES_SIV_TAG_SIZE + COOKIE_KEYS_SIZE, keys);
+}
 
-    if (err != ERR_OK || newpcb == NULL) {
-        return ERR_VAL;
+static void cookie_seal(const uint8_t keys[COOKIE_KEYS_SIZE], uint8_t *cookie) {
+    if (!masters[master_current].valid ||
+        time_us_64() - master_rotated_us >= NTS_MASTER_ROTATE_US) {
+        master_rotate();
     }
+    const nts_master_t *m = &masters[master_current];
+
+    write_be32(cookie, m->id);
+    next_nonce(cookie + COOKIE_ID_SIZE);
+    aes_siv_seal(&m->key, cookie, COOKIE_ID_SIZE,
+                 cookie + COOKIE_ID_SIZE, NONCE_SIZE,
+                 keys, COOKIE_KEYS_SIZE,
+                 cookie + COOKIE_ID_SIZE + NONCE_SIZE);
+}
 
-    nts_ke_connections++;
+/*============================================================================
+ * NTP EXTENSION FIELD PARSING
+ *============================================================================*/
 
-    /*
-     * TODO: Integrate TLS 1.3
-     *
-     * For now, just close the connection with an error message.
-     * Real implementation would:
-     * 1. Start TLS handshake
-     * 2. After handshake, send NTS-KE records
-     * 3. Close connection
-     */
+/**
+ * Check the authenticator EF at pkt + pos against the C2S key
+ */
+static bool verify_authenticator(const uint8_t *pkt, size_t pos, uint16_t field_len,
+                                 const aes_siv_key_t *c2s) {
+    if (field_len < EF_HEADER_SIZE + 4) return false;
 
-    printf("[NTS] KE connection from client (TLS not implemented)\n");
+    const uint8_t *body = pkt + pos + EF_HEADER_SIZE;
+    uint16_t nonce_len = read_be16(body);
+    uint16_t ct_len = read_be16(body + 2);
 
-    /* Send a placeholder response and close */
-    const char *msg = "NTS-KE requires TLS 1.3\r\n";
-    tcp_write(newpcb, msg, strlen(msg), TCP_WRITE_FLAG_COPY);
-    tcp_output(newpcb);
-    tcp_close(newpcb);
+    if (nonce_len < NONCE_SIZE || nonce_len > NONCE_MAX) return false;
+    if (ct_len < AES_SIV_TAG_SIZE || ct_len - AES_SIV_TAG_SIZE > NTS_PLAIN_MAX) return false;
+    if (EF_HEADER_SIZE + 4 + pad4(nonce_len) + pad4(ct_len) > field_len) return false;
 
-    return ERR_OK;
+    static uint8_t plain[NTS_PLAIN_MAX];
+    return aes_siv_open(c2s, pkt, pos, body + 4, nonce_len,
+                        body + 4 + pad4(nonce_len), ct_len, plain);
 }
 
 /*============================================================================
@@ -258,34 +288,19 @@ static err_t nts_ke_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
  */
 void nts_init(void) {
     printf("[NTS] Initializing Network Time Security\n");
-    printf("[NTS] WARNING: TLS 1.3 not implemented - NTS-KE will reject connections\n");
-    printf("[NTS] Full NTS requires mbedTLS integration\n");
-
-    /* Create NTS-KE TCP listener */
-    nts_ke_pcb = tcp_new();
-    if (nts_ke_pcb == NULL) {
-        printf("[NTS] Failed to create TCP PCB\n");
-        return;
-    }
 
-    err_t err = tcp_bind(nts_ke_pcb, IP_ADDR_ANY, NTS_KE_PORT);
-    if (err != ERR_OK) {
-        printf("[NTS] Failed to bind port %d: %d\n", NTS_KE_PORT, err);
-        tcp_close(nts_ke_pcb);
-        nts_ke_pcb = NULL;
-        return;
-    }
+    nonce_prefix = get_rand_64();
+    master_rotate();
+    printf("[NTS] AES-SIV-CMAC-256, master key %08lx, %d cached sessions\n",
+           (unsigned long)masters[master_current].id, NTS_SESSION_CACHE);
 
-    nts_ke_pcb = tcp_listen(nts_ke_pcb);
-    if (nts_ke_pcb == NULL) {
-        printf("[NTS] Failed to listen\n");
+    /* Without key establishment no client can hold a cookie */
+    if (!nts_ke_init()) {
+        printf("[NTS] NTS-KE unavailable, NTS disabled\n");
         return;
     }
 
-    tcp_accept(nts_ke_pcb, nts_ke_accept);
-
     nts_enabled = true;
-    printf("[NTS] NTS-KE listening on TCP port %d (placeholder)\n", NTS_KE_PORT);
 }
 
 /**
@@ -313,24 +328,153 @@ bool nts_is_protected_request(const uint8_t *pkt, size_t len) {
 }
 
 /**
- * Process NTS-protected NTP request
- * Returns response length, 0 if not valid NTS request
+ * Parse and authenticate an NTS request
  *
- * Note: This is a placeholder. Real implementation needs AEAD.
+ * Fields up to the authenticator are its associated data; anything
+ * after it is unauthenticated and ignored.
  */
-int nts_process_request(const uint8_t *req, size_t req_len,
-                        uint8_t *resp, size_t max_resp_len) {
-    (void)req;
-    (void)req_len;
-    (void)resp;
-    (void)max_resp_len;
+nts_status_t nts_verify_request(const uint8_t *pkt, size_t len, nts_request_t *req) {
+    const uint8_t *cookie = NULL;
+    bool cookie_ours = false;
+    size_t auth_pos = 0;
+    uint16_t auth_len = 0;
+    uint32_t placeholders = 0;
+    size_t pos = NTP_PACKET_SIZE;
+
+    req->status = NTS_NONE;
+    req->uid_len = 0;
+    req->session = -1;
+
+    while (pos + EF_HEADER_SIZE <= len && auth_pos == 0) {
+        uint16_t field_type = read_be16(pkt + pos);
+        uint16_t field_len = read_be16(pkt + pos + 2);
 
-    nts_ntp_requests++;
+        /* Field length must be multiple of 4 and include header */
+        if (field_len < EF_HEADER_SIZE || (field_len & 3) != 0) break;
+        if (pos + field_len > len) break;
 
-    /* Would decrypt, verify, process, and encrypt response */
-    printf("[NTS] NTS-protected NTP request (AEAD not implemented)\n");
+        uint16_t body_len = field_len - EF_HEADER_SIZE;
+        switch (field_type) {
+            case EF_NTS_UNIQUE_ID:
+                if (body_len >= UID_MIN && body_len <= NTS_UID_MAX && req->uid_len == 0) {
+                    req->uid_len = body_len;
+                    memcpy(req->uid, pkt + pos + EF_HEADER_SIZE, body_len);
+                }
+                break;
 
-    return 0;  /* Cannot process without AEAD */
+            case EF_NTS_COOKIE:
+                if (cookie != NULL) {
+                    /* Exactly one cookie per request */
+                    nts_stats.malformed++;
+                    return req->status = NTS_DROP;
+                }
+                cookie = pkt + pos + EF_HEADER_SIZE;
+                cookie_ours = (body_len == NTS_COOKIE_SIZE);
+                break;
+
+            case EF_NTS_COOKIE_PLAC:
+                /* Placeholders the size of a cookie make room for one */
+                if (field_len == COOKIE_EF_SIZE) {
+                    placeholders++;
+                }
+                break;
+
+            case EF_NTS_AUTH:
+                auth_pos = pos;
+                auth_len = field_len;
+                break;
+        }
+
+        pos += field_len;
+    }
+
+    if (cookie == NULL && auth_pos == 0) {
+        return NTS_NONE;
+    }
+    if (req->uid_len == 0 || cookie == NULL || auth_pos == 0) {
+        nts_stats.malformed++;
+        return req->status = NTS_DROP;
+    }
+
+    /* From here a reply is owed: the client gets an NTSN kiss when its
+     * cookie or authenticator does not check out */
+    uint8_t keys[COOKIE_KEYS_SIZE];
+    if (!cookie_ours || !cookie_open(cookie, keys)) {
+        nts_stats.naks++;
+        return req->status = NTS_NAK;
+    }
+
+    req->session = session_get(keys);
+    memset(keys, 0, sizeof(keys));
+    if (req->session < 0 ||
+        !verify_authenticator(pkt, auth_pos, auth_len, &sessions[req->session].c2s)) {
+        nts_stats.naks++;
+        return req->status = NTS_NAK;
+    }
+
+    req->cookies = (uint8_t)(1 + (placeholders < NTS_MAX_COOKIES - 1 ? placeholders
+                                                                     : NTS_MAX_COOKIES - 1));
+    nts_stats.requests++;
+    return req->status = NTS_OK;
+}
+
+/**
+ * Append Unique Identifier and, unless NAK, the authenticator with new
+ * cookies. The response is never longer than the request: each cookie
+ * returned was paid for by the request's cookie or a placeholder.
+ */
+size_t nts_finish_response(const nts_request_t *req, uint8_t *pkt, size_t max_len) {
+    size_t pos = NTP_PACKET_SIZE;
+    uint32_t uid_field = EF_HEADER_SIZE + pad4(req->uid_len);
+
+    if (pos + uid_field > max_len) return 0;
+    write_ef_header(pkt + pos, EF_NTS_UNIQUE_ID, (uint16_t)uid_field);
+    memset(pkt + pos + EF_HEADER_SIZE, 0, uid_field - EF_HEADER_SIZE);
+    memcpy(pkt + pos + EF_HEADER_SIZE, req->uid, req->uid_len);
+    pos += uid_field;
+
+    if (req->status != NTS_OK) {
+        return pos;
+    }
+
+    const nts_session_t *s = &sessions[req->session];
+    uint32_t plain_len = req->cookies * COOKIE_EF_SIZE;
+    uint32_t ct_len = AES_SIV_TAG_SIZE + plain_len;
+    uint32_t auth_field = EF_HEADER_SIZE + 4 + NONCE_SIZE + ct_len;
+    if (pos + auth_field > max_len) return 0;
+
+    for (uint32_t i = 0; i < req->cookies; i++) {
+        uint8_t *ef = plain_buf + i * COOKIE_EF_SIZE;
+        write_ef_header(ef, EF_NTS_COOKIE, COOKIE_EF_SIZE);
+        cookie_seal(s->keys, ef + EF_HEADER_SIZE);
+    }
+
+    uint8_t *auth = pkt + pos;
+    write_ef_header(auth, EF_NTS_AUTH, (uint16_t)auth_field);
+    write_be16(auth + 4, NONCE_SIZE);
+    write_be16(auth + 6, (uint16_t)ct_len);
+    next_nonce(auth + 8);
+    aes_siv_seal(&s->s2c, pkt, pos, auth + 8, NONCE_SIZE,
+                 plain_buf, plain_len, auth + 8 + NONCE_SIZE);
+
+    return pos + auth_field;
+}
+
+/**
+ * Build a cookie for newly exported session keys (task context)
+ */
+void nts_make_cookie(const uint8_t c2s[NTS_KEY_SIZE], const uint8_t s2c[NTS_KEY_SIZE],
+                     uint8_t cookie[NTS_COOKIE_SIZE]) {
+    uint8_t keys[COOKIE_KEYS_SIZE];
+
+    memcpy(keys, c2s, NTS_KEY_SIZE);
+    memcpy(keys + NTS_KEY_SIZE, s2c, NTS_KEY_SIZE);
+
+    /* Master keys and nonces belong to the NTP receive callback */
+    cyw43_arch_lwip_begin();
+    cookie_seal(keys, cookie);
+    cyw43_arch_lwip_end();
+    memset(keys, 0, sizeof(keys));
 }
 
 /**
@@ -352,13 +496,24 @@ bool nts_is_enabled(void) {
  * Get statistics
  */
 void nts_get_stats(uint32_t *ke_conns, uint32_t *ntp_reqs) {
-    if (ke_conns) *ke_conns = nts_ke_connections;
-    if (ntp_reqs) *ntp_reqs = nts_ntp_requests;
+    if (ke_conns) {
+        nts_ke_stats_t ke;
+        nts_ke_get_stats(&ke);
+        *ke_conns = ke.accepted;
+    }
+    if (ntp_reqs) *ntp_reqs = nts_stats.requests;
+}
+
+/**
+ * Get authentication and key cache statistics
+ */
+void nts_get_auth_stats(nts_auth_stats_t *stats) {
+    *stats = nts_stats;
 }
 
 /**
  * Check if full NTS is available (requires TLS)
  */
 bool nts_is_fully_implemented(void) {
-    return false;  /* TLS not implemented */
+    return nts_ke_is_ready();
 }
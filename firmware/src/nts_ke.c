@@ -0,0 +1,870 @@
+/**
+ * CHRONOS-Rb NTS Key Establishment Server
+ *
+ * RFC 8915 NTS-KE: a TLS 1.3 exchange with ALPN "ntske/1", after which
+ * the client sends its protocol/AEAD records, the server derives the
+ * C2S/S2C keys with the TLS exporter and answers with eight cookies
+ * (nts_make_cookie()) for the NTP fast path in nts.c.
+ *
+ * The lwIP callbacks only queue received pbufs and post
+ * SCHED_EV_NTS_KE; all TLS work happens in nts_ke_task() on the core0
+ * main loop, one handshake step per session per pass, so an ECDHE or
+ * signing step never runs in IRQ context and other tasks get a turn
+ * between steps. Received data is acknowledged to TCP only once TLS has
+ * consumed it, which keeps a slow handshake from pinning pool pbufs.
+ *
+ * Memory is bounded: every mbedTLS allocation comes from a fixed arena,
+ * sessions are capped at NTS_KE_MAX_SESSIONS (connections beyond it
+ * are reset at accept) and the certificate, key and TLS configuration
+ * are built once at boot and shared by all handshakes.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+#include "lwip/tcp.h"
+#include "lwip/netif.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pem.h"
+#include "mbedtls/ssl.h"
+#include "psa/crypto.h"
+
+#include "chronos_rb.h"
+#include "nts.h"
+#include "nts_ke.h"
+#include "sched.h"
+#include "unit_secret.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+/* NTS-KE record types (RFC 8915 section 4) */
+#define NTS_KE_END          0       /* End of message */
+#define NTS_KE_NEXT_PROTO   1       /* Next protocol negotiation */
+#define NTS_KE_ERROR        2       /* Error */
+#define NTS_KE_WARNING      3       /* Warning */
+#define NTS_KE_AEAD_ALGO    4       /* AEAD algorithm negotiation */
+#define NTS_KE_COOKIE       5       /* New cookie */
+#define NTS_KE_SERVER       6       /* NTPv4 server negotiation */
+#define NTS_KE_PORT_NEG     7       /* NTPv4 port negotiation */
+
+#define NTS_KE_CRITICAL     0x8000
+
+/* Error record codes */
+#define NTS_KE_ERR_CRITICAL 0       /* Unrecognized critical record */
+#define NTS_KE_ERR_BAD_REQ  1       /* Bad request */
+
+#define NTS_PROTO_NTPV4     0
+#define AEAD_AES_SIV_CMAC_256   15
+
+#define KE_REQ_MAX          512     /* Client records, all of them */
+#define KE_RESP_MAX         (16 + NTS_MAX_COOKIES * (4 + NTS_COOKIE_SIZE) + 4)
+#define KE_RX_MAX           6144    /* Unread TCP data before a reset */
+#define KE_CERT_MAX         640
+#define KE_POLL_US          100000  /* Timeout checks while sessions are open */
+
+static const char exporter_label[] = "EXPORTER-network-time-security";
+
+typedef enum {
+    KE_FREE = 0,
+    KE_ACCEPTED,                /* TCP up, TLS not set up yet */
+    KE_HANDSHAKE,
+    KE_REQUEST,                 /* Reading NTS-KE records */
+    KE_RESPONSE                 /* Writing records, then close */
+} ke_state_t;
+
+typedef struct {
+    ke_state_t state;
+    struct tcp_pcb *pcb;        /* NULL once lwIP has dropped it */
+    struct pbuf *rx;            /* Received, not yet read by TLS */
+    bool peer_closed;
+    uint32_t start_ms;
+    mbedtls_ssl_context ssl;
+    uint16_t req_len;
+    uint16_t resp_len;
+    uint16_t resp_off;
+    uint8_t req[KE_REQ_MAX];
+    uint8_t resp[KE_RESP_MAX];
+} ke_session_t;
+
+/* Arena block header; size includes the header */
+typedef struct {
+    uint32_t size;
+    uint32_t used;
+} arena_block_t;
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static struct tcp_pcb *ke_listen_pcb = NULL;
+static ke_session_t sessions[NTS_KE_MAX_SESSIONS];
+static nts_ke_stats_t ke_stats = {0};
+static bool ke_ready = false;
+
+/* Shared by every handshake */
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context drbg;
+static mbedtls_ssl_config tls_conf;
+static mbedtls_x509_crt server_cert;
+static mbedtls_pk_context server_key;
+static uint8_t cert_der[KE_CERT_MAX];
+static size_t cert_der_len = 0;
+
+static const char *alpn_list[] = { "ntske/1", NULL };
+
+/* X25519 first: the cheapest ECDHE on this core */
+static const uint16_t ke_groups[] = {
+    MBEDTLS_SSL_IANA_TLS_GROUP_X25519,
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+    MBEDTLS_SSL_IANA_TLS_GROUP_NONE
+};
+
+static uint8_t arena[NTS_KE_ARENA_SIZE] __attribute__((aligned(8)));
+
+/*============================================================================
+ * ARENA ALLOCATOR
+ *============================================================================*/
+
+/* First fit with coalescing on free. Only called from core0 task
+ * context: the lwIP callbacks never touch mbedTLS. */
+
+static void arena_init(void) {
+    arena_block_t *b = (arena_block_t *)arena;
+    b->size = sizeof(arena);
+    b->used = 0;
+}
+
+static void *arena_calloc(size_t n, size_t size) {
+    if (size != 0 && n > (sizeof(arena) / size)) {
+        ke_stats.arena_failures++;
+        return NULL;
+    }
+    uint32_t want = (uint32_t)(n * size);
+    uint32_t need = sizeof(arena_block_t) + ((want + 7) & ~7u);
+    if (want == 0) need += 8;
+
+    for (uint32_t off = 0; off < sizeof(arena); ) {
+        arena_block_t *b = (arena_block_t *)(arena + off);
+        if (!b->used && b->size >= need) {
+            /* Split unless the rest is too small to hold anything */
+            if (b->size - need >= sizeof(arena_block_t) + 8) {
+                arena_block_t *rest = (arena_block_t *)(arena + off + need);
+                rest->size = b->size - need;
+                rest->used = 0;
+                b->size = need;
+            }
+            b->used = 1;
+            ke_stats.arena_used += b->size;
+            if (ke_stats.arena_used > ke_stats.arena_peak) {
+                ke_stats.arena_peak = ke_stats.arena_used;
+            }
+            void *p = b + 1;
+            memset(p, 0, b->size - sizeof(arena_block_t));
+            return p;
+        }
+        off += b->size;
+    }
+
+    ke_stats.arena_failures++;
+    return NULL;
+}
+
+static void arena_free(void *p) {
+    if (p == NULL) {
+        return;
+    }
+    arena_block_t *b = (arena_block_t *)p - 1;
+    b->used = 0;
+    ke_stats.arena_used -= b->size;
+
+    /* Merge every run of free blocks */
+    for (uint32_t off = 0; off < sizeof(arena); ) {
+        arena_block_t *cur = (arena_block_t *)(arena + off);
+        if (!cur->used) {
+            while (off + cur->size < sizeof(arena)) {
+                arena_block_t *next = (arena_block_t *)(arena + off + cur->size);
+                if (next->used) break;
+                cur->size += next->size;
+            }
+        }
+        off += cur->size;
+    }
+}
+
+/*============================================================================
+ * SERVER CREDENTIALS
+ *============================================================================*/
+
+/**
+ * Server key, stable across reboots so clients can pin the certificate
+ */
+static bool load_server_key(void) {
+    /* SEC1 ECPrivateKey, version 1, scalar, namedCurve prime256v1 */
+    uint8_t der[51] = {
+        0x30, 0x31, 0x02, 0x01, 0x01, 0x04, 0x20
+    };
+    static const uint8_t der_curve[12] = {
+        0xA0, 0x0A, 0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07
+    };
+
+    unit_secret_derive("CHRONOS-Rb NTS-KE server key", der + 7, 32);
+    memcpy(der + 39, der_curve, sizeof(der_curve));
+
+    /* Public key is derived from the scalar */
+    int ret = mbedtls_pk_parse_key(&server_key, der, sizeof(der), NULL, 0,
+                                   mbedtls_ctr_drbg_random, &drbg);
+    memset(der, 0, sizeof(der));
+    if (ret != 0) {
+        printf("[NTS-KE] Key setup failed: -0x%04x\n", (unsigned)-ret);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Self-signed certificate for the server key, naming the board and the
+ * current address
+ */
+static bool make_certificate(void) {
+    pico_unique_board_id_t id;
+    char name[64];
+    uint8_t serial[sizeof(id.id)];
+    uint8_t ip[4] = {0};
+    mbedtls_x509write_cert crt;
+    static uint8_t buf[KE_CERT_MAX];
+
+    pico_get_unique_board_id(&id);
+    snprintf(name, sizeof(name), "CN=chronos-rb-%02x%02x%02x%02x,O=CHRONOS-Rb",
+             id.id[4], id.id[5], id.id[6], id.id[7]);
+
+    /* Serial is a positive INTEGER */
+    memcpy(serial, id.id, sizeof(serial));
+    serial[0] = (serial[0] & 0x7F) | 0x01;
+
+    if (netif_default != NULL) {
+        uint32_t addr = ip4_addr_get_u32(netif_ip4_addr(netif_default));
+        memcpy(ip, &addr, 4);
+    }
+    mbedtls_x509_san_list san = {0};
+    san.node.type = MBEDTLS_X509_SAN_IP_ADDRESS;
+    san.node.san.unstructured_name.p = ip;
+    san.node.san.unstructured_name.len = sizeof(ip);
+
+    mbedtls_x509write_crt_init(&crt);
+    mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+    mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+    mbedtls_x509write_crt_set_subject_key(&crt, &server_key);
+    mbedtls_x509write_crt_set_issuer_key(&crt, &server_key);
+
+    int ret = mbedtls_x509write_crt_set_subject_name(&crt, name);
+    if (ret == 0) ret = mbedtls_x509write_crt_set_issuer_name(&crt, name);
+    if (ret == 0) ret = mbedtls_x509write_crt_set_serial_raw(&crt, serial, sizeof(serial));
+    if (ret == 0) ret = mbedtls_x509write_crt_set_validity(&crt, "20250101000000", "20491231235959");
+    if (ret == 0) ret = mbedtls_x509write_crt_set_basic_constraints(&crt, 0, -1);
+    if (ret == 0 && ip[0] != 0) ret = mbedtls_x509write_crt_set_subject_alternative_name(&crt, &san);
+
+    /* DER is written at the end of the buffer */
+    int len = (ret == 0) ? mbedtls_x509write_crt_der(&crt, buf, sizeof(buf),
+                                                     mbedtls_ctr_drbg_random, &drbg)
+                         : ret;
+    mbedtls_x509write_crt_free(&crt);
+    if (len <= 0) {
+        printf("[NTS-KE] Certificate failed: -0x%04x\n", (unsigned)-len);
+        return false;
+    }
+
+    memcpy(cert_der, buf + sizeof(buf) - len, len);
+    cert_der_len = (size_t)len;
+
+    ret = mbedtls_x509_crt_parse_der(&server_cert, cert_der, cert_der_len);
+    if (ret != 0) {
+        printf("[NTS-KE] Certificate parse failed: -0x%04x\n", (unsigned)-ret);
+        return false;
+    }
+
+    printf("[NTS-KE] Self-signed certificate %s, IP %u.%u.%u.%u (%u bytes)\n",
+           name, ip[0], ip[1], ip[2], ip[3], (unsigned)cert_der_len);
+    return true;
+}
+
+static bool tls_setup(void) {
+    static const char pers[] = "chronos-rb nts-ke";
+
+    arena_init();
+    mbedtls_platform_set_calloc_free(arena_calloc, arena_free);
+
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        printf("[NTS-KE] PSA crypto init failed\n");
+        return false;
+    }
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                              (const uint8_t *)pers, sizeof(pers) - 1) != 0) {
+        printf("[NTS-KE] DRBG seed failed\n");
+        return false;
+    }
+
+    mbedtls_pk_init(&server_key);
+    mbedtls_x509_crt_init(&server_cert);
+    if (!load_server_key() || !make_certificate()) {
+        return false;
+    }
+
+    mbedtls_ssl_config_init(&tls_conf);
+    int ret = mbedtls_ssl_config_defaults(&tls_conf, MBEDTLS_SSL_IS_SERVER,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret == 0) {
+        mbedtls_ssl_conf_min_tls_version(&tls_conf, MBEDTLS_SSL_VERSION_TLS1_3);
+        mbedtls_ssl_conf_max_tls_version(&tls_conf, MBEDTLS_SSL_VERSION_TLS1_3);
+        mbedtls_ssl_conf_rng(&tls_conf, mbedtls_ctr_drbg_random, &drbg);
+        mbedtls_ssl_conf_authmode(&tls_conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_tls13_key_exchange_modes(&tls_conf,
+            MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL);
+        mbedtls_ssl_conf_groups(&tls_conf, ke_groups);
+        ret = mbedtls_ssl_conf_alpn_protocols(&tls_conf, alpn_list);
+    }
+    if (ret == 0) {
+        ret = mbedtls_ssl_conf_own_cert(&tls_conf, &server_cert, &server_key);
+    }
+    if (ret != 0) {
+        printf("[NTS-KE] TLS config failed: -0x%04x\n", (unsigned)-ret);
+        return false;
+    }
+
+    return true;
+}
+
+/*============================================================================
+ * NTS-KE RECORDS
+ *============================================================================*/
+
+static int ke_record(uint8_t *buf, uint16_t type, const uint8_t *body, uint16_t len) {
+    buf[0] = (uint8_t)(type >> 8);
+    buf[1] = (uint8_t)type;
+    buf[2] = (uint8_t)(len >> 8);
+    buf[3] = (uint8_t)len;
+    if (len != 0) {
+        memcpy(buf + 4, body, len);
+    }
+    return 4 + len;
+}
+
+static int ke_error_response(uint8_t *buf, uint16_t code) {
+    uint8_t body[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+    int pos = ke_record(buf, NTS_KE_CRITICAL | NTS_KE_ERROR, body, 2);
+    pos += ke_record(buf + pos, NTS_KE_CRITICAL | NTS_KE_END, NULL, 0);
+    return pos;
+}
+
+/**
+ * Build NTS-KE response for exported session keys: NTPv4, AES-SIV-CMAC-256
+ * and NTS_MAX_COOKIES cookies. The NTP server and port are ours, so
+ * those records are left out.
+ */
+static int build_nts_ke_response(uint8_t *buf, size_t max_len,
+                                 const uint8_t c2s[NTS_KEY_SIZE],
+                                 const uint8_t s2c[NTS_KEY_SIZE]) {
+    static const uint8_t proto[2] = { 0x00, NTS_PROTO_NTPV4 };
+    static const uint8_t aead[2] = { 0x00, AEAD_AES_SIV_CMAC_256 };
+    int pos = 0;
+
+    if (max_len < KE_RESP_MAX) return 0;
+
+    pos += ke_record(buf + pos, NTS_KE_CRITICAL | NTS_KE_NEXT_PROTO, proto, 2);
+    pos += ke_record(buf + pos, NTS_KE_CRITICAL | NTS_KE_AEAD_ALGO, aead, 2);
+
+    /* 8 cookies (recommended), each sealing both keys */
+    for (int i = 0; i < NTS_MAX_COOKIES; i++) {
+        uint8_t cookie[NTS_COOKIE_SIZE];
+        nts_make_cookie(c2s, s2c, cookie);
+        pos += ke_record(buf + pos, NTS_KE_COOKIE, cookie, NTS_COOKIE_SIZE);
+    }
+
+    pos += ke_record(buf + pos, NTS_KE_CRITICAL | NTS_KE_END, NULL, 0);
+    return pos;
+}
+
+/**
+ * Scan the client's records. Returns 1 when End of Message has been
+ * seen and a response is built, 0 if more data is needed, -1 if the
+ * session failed.
+ */
+static int ke_handle_request(ke_session_t *s) {
+    bool proto_ok = false, aead_ok = false, got_proto = false, got_aead = false;
+    size_t pos = 0;
+
+    while (pos + 4 <= s->req_len) {
+        uint16_t type = (uint16_t)((s->req[pos] << 8) | s->req[pos + 1]);
+        uint16_t len = (uint16_t)((s->req[pos + 2] << 8) | s->req[pos + 3]);
+        bool critical = (type & NTS_KE_CRITICAL) != 0;
+        const uint8_t *body = s->req + pos + 4;
+
+        if (pos + 4 + len > s->req_len) {
+            break;
+        }
+        type &= ~NTS_KE_CRITICAL;
+
+        switch (type) {
+            case NTS_KE_END:
+                if (!got_proto || !got_aead) {
+                    ke_stats.bad_requests++;
+                    s->resp_len = (uint16_t)ke_error_response(s->resp, NTS_KE_ERR_BAD_REQ);
+                    return 1;
+                }
+                goto done;
+
+            case NTS_KE_NEXT_PROTO:
+                got_proto = true;
+                for (uint16_t i = 0; i + 1 < len; i += 2) {
+                    if (((body[i] << 8) | body[i + 1]) == NTS_PROTO_NTPV4) proto_ok = true;
+                }
+                break;
+
+            case NTS_KE_AEAD_ALGO:
+                got_aead = true;
+                for (uint16_t i = 0; i + 1 < len; i += 2) {
+                    if (((body[i] << 8) | body[i + 1]) == AEAD_AES_SIV_CMAC_256) aead_ok = true;
+                }
+                break;
+
+            case NTS_KE_SERVER:
+            case NTS_KE_PORT_NEG:
+            case NTS_KE_WARNING:
+                break;
+
+            default:
+                if (critical) {
+                    ke_stats.bad_requests++;
+                    s->resp_len = (uint16_t)ke_error_response(s->resp, NTS_KE_ERR_CRITICAL);
+                    return 1;
+                }
+                break;
+        }
+        pos += 4 + len;
+    }
+
+    if (s->req_len >= KE_REQ_MAX) {
+        ke_stats.bad_requests++;
+        s->resp_len = (uint16_t)ke_error_response(s->resp, NTS_KE_ERR_BAD_REQ);
+        return 1;
+    }
+    return 0;
+
+done:
+    if (!proto_ok || !aead_ok) {
+        /* Nothing in common: empty negotiation records, no cookies */
+        static const uint8_t proto[2] = { 0x00, NTS_PROTO_NTPV4 };
+        int p = ke_record(s->resp, NTS_KE_CRITICAL | NTS_KE_NEXT_PROTO, proto, proto_ok ? 2 : 0);
+        if (proto_ok) {
+            p += ke_record(s->resp + p, NTS_KE_CRITICAL | NTS_KE_AEAD_ALGO, NULL, 0);
+        }
+        p += ke_record(s->resp + p, NTS_KE_CRITICAL | NTS_KE_END, NULL, 0);
+        s->resp_len = (uint16_t)p;
+        ke_stats.bad_requests++;
+        return 1;
+    }
+
+    /* Keys: exporter context is protocol ID || AEAD ID || direction */
+    uint8_t context[5] = { 0x00, NTS_PROTO_NTPV4, 0x00, AEAD_AES_SIV_CMAC_256, 0x00 };
+    uint8_t c2s[NTS_KEY_SIZE], s2c[NTS_KEY_SIZE];
+    int ret = mbedtls_ssl_export_keying_material(&s->ssl, c2s, sizeof(c2s),
+                                                 exporter_label, sizeof(exporter_label) - 1,
+                                                 context, sizeof(context), 1);
+    if (ret == 0) {
+        context[4] = 0x01;
+        ret = mbedtls_ssl_export_keying_material(&s->ssl, s2c, sizeof(s2c),
+                                                 exporter_label, sizeof(exporter_label) - 1,
+                                                 context, sizeof(context), 1);
+    }
+    if (ret != 0) {
+        ke_stats.tls_failures++;
+        return -1;
+    }
+
+    s->resp_len = (uint16_t)build_nts_ke_response(s->resp, sizeof(s->resp), c2s, s2c);
+    memset(c2s, 0, sizeof(c2s));
+    memset(s2c, 0, sizeof(s2c));
+    ke_stats.completed++;
+    return 1;
+}
+
+/*============================================================================
+ * TLS TRANSPORT
+ *============================================================================*/
+
+/* Both run in task context (inside mbedtls_ssl_*), so take the lwIP lock */
+
+static int ke_bio_send(void *ctx, const unsigned char *buf, size_t len) {
+    ke_session_t *s = (ke_session_t *)ctx;
+    int ret;
+
+    cyw43_arch_lwip_begin();
+    if (s->pcb == NULL) {
+        ret = MBEDTLS_ERR_SSL_CONN_EOF;
+    } else {
+        size_t n = tcp_sndbuf(s->pcb);
+        if (n > len) n = len;
+        if (n == 0 || tcp_write(s->pcb, buf, (u16_t)n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+            ret = MBEDTLS_ERR_SSL_WANT_WRITE;
+        } else {
+            tcp_output(s->pcb);
+            ret = (int)n;
+        }
+    }
+    cyw43_arch_lwip_end();
+    return ret;
+}
+
+static int ke_bio_recv(void *ctx, unsigned char *buf, size_t len) {
+    ke_session_t *s = (ke_session_t *)ctx;
+    int ret;
+
+    cyw43_arch_lwip_begin();
+    if (s->rx == NULL) {
+        ret = (s->peer_closed || s->pcb == NULL) ? MBEDTLS_ERR_SSL_CONN_EOF
+                                                 : MBEDTLS_ERR_SSL_WANT_READ;
+    } else {
+        u16_t n = pbuf_copy_partial(s->rx, buf, (u16_t)(len > 0xFFFF ? 0xFFFF : len), 0);
+        s->rx = pbuf_free_header(s->rx, n);
+        if (s->pcb != NULL) {
+            tcp_recved(s->pcb, n);
+        }
+        ret = n;
+    }
+    cyw43_arch_lwip_end();
+    return ret;
+}
+
+/*============================================================================
+ * TCP CALLBACKS
+ *============================================================================*/
+
+static err_t ke_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) {
+    ke_session_t *s = (ke_session_t *)arg;
+
+    if (s == NULL) {
+        if (p != NULL) pbuf_free(p);
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    if (p == NULL) {
+        s->peer_closed = true;
+    } else if (err != ERR_OK) {
+        pbuf_free(p);
+    } else if (s->rx != NULL && s->rx->tot_len + p->tot_len > KE_RX_MAX) {
+        /* Far more than a handshake needs */
+        pbuf_free(p);
+        s->pcb = NULL;
+        s->peer_closed = true;
+        tcp_arg(pcb, NULL);
+        tcp_abort(pcb);
+        sched_post(SCHED_EV_NTS_KE);
+        return ERR_ABRT;
+    } else if (s->rx == NULL) {
+        s->rx = p;
+    } else {
+        pbuf_cat(s->rx, p);
+    }
+
+    sched_post(SCHED_EV_NTS_KE);
+    return ERR_OK;
+}
+
+static err_t ke_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+    (void)arg;
+    (void)pcb;
+    (void)len;
+    sched_post(SCHED_EV_NTS_KE);
+    return ERR_OK;
+}
+
+static void ke_err(void *arg, err_t err) {
+    ke_session_t *s = (ke_session_t *)arg;
+    (void)err;
+
+    /* PCB already freed by lwIP */
+    if (s != NULL) {
+        s->pcb = NULL;
+        s->peer_closed = true;
+        sched_post(SCHED_EV_NTS_KE);
+    }
+}
+
+static err_t ke_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+    (void)arg;
+
+    if (err != ERR_OK || newpcb == NULL) {
+        return ERR_VAL;
+    }
+
+    ke_session_t *s = NULL;
+    for (int i = 0; i < NTS_KE_MAX_SESSIONS; i++) {
+        if (sessions[i].state == KE_FREE) {
+            s = &sessions[i];
+            break;
+        }
+    }
+    if (s == NULL) {
+        /* Handshake budget in use: reset rather than queue */
+        ke_stats.refused++;
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    s->pcb = newpcb;
+    s->rx = NULL;
+    s->peer_closed = false;
+    s->start_ms = to_ms_since_boot(get_absolute_time());
+    s->req_len = 0;
+    s->resp_len = 0;
+    s->resp_off = 0;
+    s->state = KE_ACCEPTED;
+    ke_stats.accepted++;
+
+    tcp_arg(newpcb, s);
+    tcp_recv(newpcb, ke_recv);
+    tcp_sent(newpcb, ke_sent);
+    tcp_err(newpcb, ke_err);
+
+    sched_post(SCHED_EV_NTS_KE);
+    return ERR_OK;
+}
+
+/*============================================================================
+ * SESSIONS
+ *============================================================================*/
+
+static void ke_close(ke_session_t *s, bool reset) {
+    cyw43_arch_lwip_begin();
+    if (s->pcb != NULL) {
+        tcp_arg(s->pcb, NULL);
+        tcp_recv(s->pcb, NULL);
+        tcp_sent(s->pcb, NULL);
+        tcp_err(s->pcb, NULL);
+        if (reset || tcp_close(s->pcb) != ERR_OK) {
+            tcp_abort(s->pcb);
+        }
+        s->pcb = NULL;
+    }
+    if (s->rx != NULL) {
+        pbuf_free(s->rx);
+        s->rx = NULL;
+    }
+    cyw43_arch_lwip_end();
+
+    if (s->state != KE_ACCEPTED) {
+        mbedtls_ssl_free(&s->ssl);
+    }
+    s->state = KE_FREE;
+}
+
+/**
+ * Run one step of a session. Returns true if it made progress and
+ * should be run again without waiting for the network.
+ */
+static bool ke_step(ke_session_t *s) {
+    int ret;
+
+    switch (s->state) {
+        case KE_ACCEPTED:
+            mbedtls_ssl_init(&s->ssl);
+            s->state = KE_HANDSHAKE;
+            ret = mbedtls_ssl_setup(&s->ssl, &tls_conf);
+            if (ret != 0) {
+                ke_stats.tls_failures++;
+                ke_close(s, true);
+                return false;
+            }
+            mbedtls_ssl_set_bio(&s->ssl, s, ke_bio_send, ke_bio_recv, NULL);
+            return true;
+
+        case KE_HANDSHAKE: {
+            uint32_t t0 = time_us_32();
+            ret = mbedtls_ssl_handshake_step(&s->ssl);
+            uint32_t dt = time_us_32() - t0;
+            if (dt > ke_stats.max_step_us) {
+                ke_stats.max_step_us = dt;
+            }
+
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                return false;
+            }
+            if (ret != 0) {
+                ke_stats.tls_failures++;
+                ke_close(s, true);
+                return false;
+            }
+            if (mbedtls_ssl_is_handshake_over(&s->ssl)) {
+                const char *alpn = mbedtls_ssl_get_alpn_protocol(&s->ssl);
+                if (alpn == NULL || strcmp(alpn, alpn_list[0]) != 0) {
+                    ke_stats.bad_requests++;
+                    ke_close(s, true);
+                    return false;
+                }
+                s->state = KE_REQUEST;
+            }
+            return true;
+        }
+
+        case KE_REQUEST:
+            ret = mbedtls_ssl_read(&s->ssl, s->req + s->req_len, KE_REQ_MAX - s->req_len);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                return false;
+            }
+            if (ret <= 0) {
+                /* Closed before End of Message */
+                ke_stats.tls_failures++;
+                ke_close(s, true);
+                return false;
+            }
+            s->req_len += (uint16_t)ret;
+            ret = ke_handle_request(s);
+            if (ret < 0) {
+                ke_close(s, true);
+                return false;
+            }
+            if (ret > 0) {
+                s->state = KE_RESPONSE;
+            }
+            return true;
+
+        case KE_RESPONSE:
+            ret = mbedtls_ssl_write(&s->ssl, s->resp + s->resp_off, s->resp_len - s->resp_off);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                return false;
+            }
+            if (ret <= 0) {
+                ke_stats.tls_failures++;
+                ke_close(s, true);
+                return false;
+            }
+            s->resp_off += (uint16_t)ret;
+            if (s->resp_off >= s->resp_len) {
+                /* RFC 8915: the server closes after its response */
+                mbedtls_ssl_close_notify(&s->ssl);
+                ke_close(s, false);
+                return false;
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+bool nts_ke_init(void) {
+    memset(sessions, 0, sizeof(sessions));
+
+    if (!tls_setup()) {
+        return false;
+    }
+    printf("[NTS-KE] TLS 1.3 ready (%u byte arena, %u in use, %d sessions)\n",
+           (unsigned)sizeof(arena), (unsigned)ke_stats.arena_used, NTS_KE_MAX_SESSIONS);
+
+    cyw43_arch_lwip_begin();
+    ke_listen_pcb = tcp_new();
+    if (ke_listen_pcb == NULL) {
+        cyw43_arch_lwip_end();
+        printf("[NTS-KE] Failed to create TCP PCB\n");
+        return false;
+    }
+
+    err_t err = tcp_bind(ke_listen_pcb, IP_ADDR_ANY, NTS_KE_PORT);
+    if (err != ERR_OK) {
+        tcp_close(ke_listen_pcb);
+        ke_listen_pcb = NULL;
+        cyw43_arch_lwip_end();
+        printf("[NTS-KE] Failed to bind port %d: %d\n", NTS_KE_PORT, err);
+        return false;
+    }
+
+    ke_listen_pcb = tcp_listen_with_backlog(ke_listen_pcb, NTS_KE_MAX_SESSIONS);
+    if (ke_listen_pcb == NULL) {
+        cyw43_arch_lwip_end();
+        printf("[NTS-KE] Failed to listen\n");
+        return false;
+    }
+    tcp_accept(ke_listen_pcb, ke_accept);
+    cyw43_arch_lwip_end();
+
+    ke_ready = true;
+    printf("[NTS-KE] Listening on TCP port %d\n", NTS_KE_PORT);
+    return true;
+}
+
+void nts_ke_task(void) {
+    bool active = false;
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+
+    for (int i = 0; i < NTS_KE_MAX_SESSIONS; i++) {
+        ke_session_t *s = &sessions[i];
+        if (s->state == KE_FREE) {
+            continue;
+        }
+
+        if (now_ms - s->start_ms > NTS_KE_TIMEOUT_MS) {
+            ke_stats.timeouts++;
+            ke_close(s, true);
+            continue;
+        }
+
+        /* One step per pass; come straight back if it moved on */
+        if (ke_step(s)) {
+            sched_post(SCHED_EV_NTS_KE);
+        } else if (s->state != KE_FREE && s->pcb == NULL && s->rx == NULL) {
+            /* Connection gone and nothing left to read */
+            ke_stats.tls_failures++;
+            ke_close(s, true);
+        }
+
+        if (s->state != KE_FREE) {
+            active = true;
+        }
+    }
+
+    if (active) {
+        sched_wake_in(KE_POLL_US);
+    }
+}
+
+bool nts_ke_is_ready(void) {
+    return ke_ready;
+}
+
+size_t nts_ke_cert_pem(char *buf, size_t max_len) {
+    size_t olen = 0;
+
+    if (cert_der_len == 0) {
+        return 0;
+    }
+    if (mbedtls_pem_write_buffer("-----BEGIN CERTIFICATE-----\n",
+                                 "-----END CERTIFICATE-----\n",
+                                 cert_der, cert_der_len,
+                                 (unsigned char *)buf, max_len, &olen) != 0) {
+        return 0;
+    }
+    return olen > 0 ? olen - 1 : 0;     /* olen counts the terminator */
+}
+
+void nts_ke_get_stats(nts_ke_stats_t *stats) {
+    *stats = ke_stats;
+}
@@ -8,6 +8,10 @@
  * 2. On finish: decrypt, decompress, write to lower half
  * 3. Bootloader does normal swap with decompressed data
  *
+ * The streaming path (ota_stream_*) skips the staging copy: one request
+ * carries the whole image, decrypted and decompressed as it arrives
+ * straight into the lower half, one flash pass instead of two.
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
@@ -20,6 +24,8 @@
 #include "pico_fota_bootloader/core.h"
 
 #include "ota_update.h"
+#include "timing_core.h"
+#include "warm_start.h"
 
 #ifdef PFB_WITH_GZIP_COMPRESSION
 #include "../deps/pico_fota_bootloader/src/uzlib/uzlib.h"
@@ -43,6 +49,14 @@ extern char __FLASH_SWAP_SPACE_LENGTH[];
 /* Size for decompression dictionary */
 #define GZIP_DICT_SIZE  32768
 
+/* CRC-32 (IEEE, as gzip), nibble table */
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -66,6 +80,30 @@ static uint8_t g_dict[GZIP_DICT_SIZE];
 static mbedtls_aes_context g_aes_ctx;
 #endif
 
+#ifdef PFB_WITH_GZIP_COMPRESSION
+/* Streaming state: decrypted input not yet inflated, a partial AES
+ * block, and the lower-half write position */
+static struct {
+    uint8_t in[OTA_STREAM_BUF_SIZE];
+    uint8_t block[16];
+    size_t block_len;
+    bool header_done;
+    bool done;                  /* Gzip trailer checked */
+    size_t write_offset;
+    uint8_t page[PFB_ALIGN_SIZE];
+} g_stream;
+#endif
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
 /*============================================================================
  * INITIALIZATION
  *============================================================================*/
@@ -148,9 +186,12 @@ const char* ota_state_str(ota_state_t state) {
 static int write_raw_to_flash(const uint8_t *data, size_t offset, size_t len) {
     uint32_t dest = (uint32_t)__FLASH_DOWNLOAD_SLOT_START - XIP_BASE + offset;
 
+    /* Park core1 - it executes from XIP flash */
+    timing_core_pause();
     uint32_t saved_interrupts = save_and_disable_interrupts();
     flash_range_program(dest, data, len);
     restore_interrupts(saved_interrupts);
+    timing_core_resume();
 
     return 0;
 }
@@ -180,7 +221,9 @@ ota_error_t ota_begin(size_t total_size, uint32_t expected_crc) {
 
     /* Initialize download slot (erases flash) */
     printf("[OTA] Initializing download slot...\n");
+    timing_core_pause();
     int ret = pfb_initialize_download_slot();
+    timing_core_resume();
     if (ret != 0) {
         printf("[OTA] ERROR: Failed to initialize download slot: %d\n", ret);
         g_ota_status.last_error = OTA_ERROR_FLASH_INIT;
@@ -380,14 +423,230 @@ fail:
 }
 #endif /* PFB_WITH_GZIP_COMPRESSION */
 
-ota_error_t ota_finish(void) {
-    printf("[OTA] Finishing update...\n");
+/*============================================================================
+ * STREAMING UPDATE
+ *============================================================================*/
 
-    if (g_ota_status.state != OTA_STATE_RECEIVING) {
-        printf("[OTA] ERROR: Invalid state for finish\n");
+#ifdef PFB_WITH_GZIP_COMPRESSION
+/* Program one decompressed page, erasing its sector first when it opens
+ * one. Core1 is parked per page or sector, never for the whole slot. */
+static int stream_write_page(const uint8_t *data, size_t offset) {
+    uint32_t dest = (uint32_t)__FLASH_DOWNLOAD_SLOT_START - XIP_BASE + offset;
+
+    timing_core_pause();
+    uint32_t saved_interrupts = save_and_disable_interrupts();
+    if ((offset % FLASH_SECTOR_SIZE) == 0) {
+        flash_range_erase(dest, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(dest, data, PFB_ALIGN_SIZE);
+    restore_interrupts(saved_interrupts);
+    timing_core_resume();
+
+    return 0;
+}
+
+/* Input exhausted: only reached at the true end, given the margin */
+static int stream_read_cb(struct uzlib_uncomp *uncomp) {
+    (void)uncomp;
+    return -1;
+}
+
+/**
+ * Inflate while more than the margin is buffered, or to the end when
+ * final. Consumed input is compacted away.
+ */
+static ota_error_t stream_pump(bool final) {
+    int res = g_stream.done ? TINF_DONE : TINF_OK;
+
+    while (res == TINF_OK) {
+        size_t avail = g_decomp.source_limit - g_decomp.source;
+        if (!final && avail < OTA_STREAM_MARGIN) {
+            break;
+        }
+
+        if (!g_stream.header_done) {
+            res = uzlib_gzip_parse_header(&g_decomp);
+            if (res != TINF_OK) {
+                printf("[OTA] ERROR: Header parse failed: %d\n", res);
+                return OTA_ERROR_DECOMPRESS;
+            }
+            g_stream.header_done = true;
+            continue;
+        }
+
+        g_decomp.dest_start = g_stream.page;
+        g_decomp.dest = g_stream.page;
+        g_decomp.dest_limit = g_stream.page + PFB_ALIGN_SIZE;
+
+        res = uzlib_uncompress_chksum(&g_decomp);
+
+        size_t produced = g_decomp.dest - g_stream.page;
+        if (produced > 0) {
+            if (g_stream.write_offset + PFB_ALIGN_SIZE > (size_t)__FLASH_SWAP_SPACE_LENGTH) {
+                printf("[OTA] ERROR: Image larger than the download slot\n");
+                return OTA_ERROR_SIZE_TOO_LARGE;
+            }
+            if (produced < PFB_ALIGN_SIZE) {
+                memset(g_stream.page + produced, 0xFF, PFB_ALIGN_SIZE - produced);
+            }
+            stream_write_page(g_stream.page, g_stream.write_offset);
+            g_stream.write_offset += produced;
+        }
+
+        if (res != TINF_OK && res != TINF_DONE) {
+            printf("[OTA] ERROR: Decompress failed: %d at %u\n", res,
+                   (unsigned)g_stream.write_offset);
+            return OTA_ERROR_DECOMPRESS;
+        }
+    }
+
+    g_stream.done = (res == TINF_DONE);
+    if (final && !g_stream.done) {
+        printf("[OTA] ERROR: Image truncated at %u\n", (unsigned)g_stream.write_offset);
+        return OTA_ERROR_DECOMPRESS;
+    }
+
+    /* Compact the unread input to the front (anything after the trailer
+     * is dropped) */
+    size_t left = g_stream.done ? 0 : (size_t)(g_decomp.source_limit - g_decomp.source);
+    memmove(g_stream.in, g_decomp.source, left);
+    g_decomp.source = g_stream.in;
+    g_decomp.source_limit = g_stream.in + left;
+    return OTA_OK;
+}
+
+/* Append decrypted bytes to the input buffer */
+static void stream_append(const uint8_t *data, size_t len) {
+    uint8_t *end = (uint8_t *)g_decomp.source_limit;
+#ifdef PFB_WITH_IMAGE_ENCRYPTION
+    for (size_t i = 0; i < len; i++) {
+        g_stream.block[g_stream.block_len++] = data[i];
+        if (g_stream.block_len == 16) {
+            mbedtls_aes_crypt_ecb(&g_aes_ctx, MBEDTLS_AES_DECRYPT, g_stream.block, end);
+            end += 16;
+            g_stream.block_len = 0;
+        }
+    }
+#else
+    memcpy(end, data, len);
+    end += len;
+#endif
+    g_decomp.source_limit = end;
+}
+#endif /* PFB_WITH_GZIP_COMPRESSION */
+
+ota_error_t ota_stream_begin(size_t total_size, uint32_t expected_crc) {
+#ifdef PFB_WITH_GZIP_COMPRESSION
+    printf("[OTA] Starting streaming update, size=%u bytes\n", (unsigned)total_size);
+
+    if (g_ota_status.state == OTA_STATE_RECEIVING) {
+        printf("[OTA] ERROR: Update already in progress\n");
+        return OTA_ERROR_ALREADY_IN_PROGRESS;
+    }
+
+    if (total_size == 0 || total_size > (size_t)__FLASH_SWAP_SPACE_LENGTH) {
+        printf("[OTA] ERROR: Firmware too large (%u > %u)\n",
+               (unsigned)total_size, (unsigned)(size_t)__FLASH_SWAP_SPACE_LENGTH);
+        g_ota_status.last_error = OTA_ERROR_SIZE_TOO_LARGE;
+        g_ota_status.state = OTA_STATE_ERROR;
+        return OTA_ERROR_SIZE_TOO_LARGE;
+    }
+
+#ifdef PFB_WITH_IMAGE_ENCRYPTION
+    const char *aes_key = PFB_AES_KEY;
+    mbedtls_aes_init(&g_aes_ctx);
+    if (mbedtls_aes_setkey_dec(&g_aes_ctx, (const unsigned char *)aes_key,
+                                strlen(aes_key) * 8) != 0) {
+        printf("[OTA] ERROR: AES init failed\n");
+        mbedtls_aes_free(&g_aes_ctx);
+        g_ota_status.last_error = OTA_ERROR_DECOMPRESS;
+        g_ota_status.state = OTA_STATE_ERROR;
+        return OTA_ERROR_DECOMPRESS;
+    }
+#endif
+
+    /* The slot is erased sector by sector as pages arrive */
+    timing_core_pause();
+    pfb_mark_download_slot_as_invalid();
+    timing_core_resume();
+
+    memset(&g_stream, 0, sizeof(g_stream));
+    memset(&g_decomp, 0, sizeof(g_decomp));
+    uzlib_uncompress_init(&g_decomp, g_dict, GZIP_DICT_SIZE);
+    g_decomp.source = g_stream.in;
+    g_decomp.source_limit = g_stream.in;
+    g_decomp.source_read_cb = stream_read_cb;
+
+    g_ota_status.state = OTA_STATE_RECEIVING;
+    g_ota_status.streaming = true;
+    g_ota_status.total_size = total_size;
+    g_ota_status.bytes_received = 0;
+    g_ota_status.bytes_written = 0;
+    g_ota_status.expected_crc = expected_crc;
+    g_ota_status.crc = 0;
+    g_ota_status.last_error = OTA_OK;
+    last_activity_us = time_us_64();
+
+    printf("[OTA] Ready to stream firmware\n");
+    return OTA_OK;
+#else
+    /* No decompressor: the same store path, in one request */
+    ota_error_t err = ota_begin(total_size, expected_crc);
+    if (err == OTA_OK) {
+        g_ota_status.streaming = true;
+        g_ota_status.crc = 0;
+    }
+    return err;
+#endif
+}
+
+ota_error_t ota_stream_write(const uint8_t *data, size_t len) {
+    if (g_ota_status.state != OTA_STATE_RECEIVING || !g_ota_status.streaming) {
         return OTA_ERROR_INVALID_STATE;
     }
+    if (len > ota_stream_space() ||
+        g_ota_status.bytes_received + len > g_ota_status.total_size) {
+        return OTA_ERROR_SIZE_TOO_LARGE;
+    }
+
+    last_activity_us = time_us_64();
+    g_ota_status.crc = crc32_update(g_ota_status.crc, data, len);
+
+#ifdef PFB_WITH_GZIP_COMPRESSION
+    g_ota_status.bytes_received += len;
+    stream_append(data, len);
+
+    ota_error_t err = stream_pump(false);
+    g_ota_status.bytes_written = g_stream.write_offset;
+    if (err != OTA_OK) {
+        g_ota_status.last_error = err;
+        g_ota_status.state = OTA_STATE_ERROR;
+        g_ota_status.streaming = false;
+#ifdef PFB_WITH_IMAGE_ENCRYPTION
+        mbedtls_aes_free(&g_aes_ctx);
+#endif
+    }
+    return err;
+#else
+    return ota_write_chunk(data, len);
+#endif
+}
+
+size_t ota_stream_space(void) {
+#ifdef PFB_WITH_GZIP_COMPRESSION
+    size_t held = (g_decomp.source_limit - g_stream.in) + g_stream.block_len;
+    return (held < OTA_STREAM_BUF_SIZE) ? OTA_STREAM_BUF_SIZE - held : 0;
+#else
+    return OTA_STREAM_BUF_SIZE;
+#endif
+}
 
+/*============================================================================
+ * FINISH
+ *============================================================================*/
+
+/* Chunked path: flush the staged tail, then decompress it into place */
+static ota_error_t store_finish(void) {
     /* Flush any remaining buffered data */
     if (buffer_offset > 0) {
         /* Pad with 0xFF to align */
@@ -398,8 +657,6 @@ ota_error_t ota_finish(void) {
 
         if (ret != 0) {
             printf("[OTA] ERROR: Final flush failed: %d\n", ret);
-            g_ota_status.last_error = OTA_ERROR_WRITE_FAILED;
-            g_ota_status.state = OTA_STATE_ERROR;
             return OTA_ERROR_WRITE_FAILED;
         }
 
@@ -413,17 +670,74 @@ ota_error_t ota_finish(void) {
 
 #ifdef PFB_WITH_GZIP_COMPRESSION
     /* Decompress from upper to lower area */
-    ota_error_t err = decompress_firmware(g_ota_status.bytes_received);
-    if (err != OTA_OK) {
-        g_ota_status.last_error = err;
-        g_ota_status.state = OTA_STATE_ERROR;
-        return err;
-    }
+    return decompress_firmware(g_ota_status.bytes_received);
 #else
     /* Without compression, data was written directly - just track size */
     g_ota_status.bytes_written = g_ota_status.bytes_received;
     printf("[OTA] Wrote %u bytes total\n", (unsigned)g_ota_status.bytes_written);
+    return OTA_OK;
 #endif
+}
+
+/* Streaming path: the whole upload, its CRC, then the last pages */
+static ota_error_t stream_finish(void) {
+    ota_error_t err = OTA_OK;
+
+    if (g_ota_status.bytes_received != g_ota_status.total_size) {
+        printf("[OTA] ERROR: Upload incomplete (%u of %u bytes)\n",
+               (unsigned)g_ota_status.bytes_received, (unsigned)g_ota_status.total_size);
+        err = OTA_ERROR_VERIFY_FAILED;
+    } else if (g_ota_status.expected_crc != 0 &&
+               g_ota_status.crc != g_ota_status.expected_crc) {
+        printf("[OTA] ERROR: Upload CRC %08lx, expected %08lx\n",
+               (unsigned long)g_ota_status.crc, (unsigned long)g_ota_status.expected_crc);
+        err = OTA_ERROR_VERIFY_FAILED;
+    }
+
+#ifdef PFB_WITH_GZIP_COMPRESSION
+    if (err == OTA_OK) {
+        g_ota_status.state = OTA_STATE_VALIDATING;
+
+        /* A short final AES block is not encrypted */
+        uint8_t *end = (uint8_t *)g_decomp.source_limit;
+        memcpy(end, g_stream.block, g_stream.block_len);
+        g_decomp.source_limit = end + g_stream.block_len;
+        g_stream.block_len = 0;
+
+        err = stream_pump(true);
+        g_ota_status.bytes_written = g_stream.write_offset;
+        if (err == OTA_OK) {
+            printf("[OTA] Done: %u -> %u bytes in one pass\n",
+                   (unsigned)g_ota_status.bytes_received, (unsigned)g_ota_status.bytes_written);
+        }
+    }
+#ifdef PFB_WITH_IMAGE_ENCRYPTION
+    mbedtls_aes_free(&g_aes_ctx);
+#endif
+#else
+    if (err == OTA_OK) {
+        err = store_finish();
+    }
+#endif
+
+    g_ota_status.streaming = false;
+    return err;
+}
+
+ota_error_t ota_finish(void) {
+    printf("[OTA] Finishing update...\n");
+
+    if (g_ota_status.state != OTA_STATE_RECEIVING) {
+        printf("[OTA] ERROR: Invalid state for finish\n");
+        return OTA_ERROR_INVALID_STATE;
+    }
+
+    ota_error_t err = g_ota_status.streaming ? stream_finish() : store_finish();
+    if (err != OTA_OK) {
+        g_ota_status.last_error = err;
+        g_ota_status.state = OTA_STATE_ERROR;
+        return err;
+    }
 
     /* Verify SHA256 if enabled in bootloader */
     printf("[OTA] Verifying firmware...\n");
@@ -434,7 +748,9 @@ ota_error_t ota_finish(void) {
 
     /* Mark download slot as valid */
     printf("[OTA] Marking firmware as valid\n");
+    timing_core_pause();
     pfb_mark_download_slot_as_valid();
+    timing_core_resume();
 
     g_ota_status.state = OTA_STATE_READY;
     printf("[OTA] Update ready! Call ota_apply_and_reboot() to apply.\n");
@@ -445,8 +761,16 @@ ota_error_t ota_finish(void) {
 void ota_abort(void) {
     printf("[OTA] Aborting update\n");
 
+#if defined(PFB_WITH_GZIP_COMPRESSION) && defined(PFB_WITH_IMAGE_ENCRYPTION)
+    if (g_ota_status.streaming) {
+        mbedtls_aes_free(&g_aes_ctx);
+    }
+#endif
+
     /* Mark download slot as invalid */
+    timing_core_pause();
     pfb_mark_download_slot_as_invalid();
+    timing_core_resume();
 
     /* Reset state */
     g_ota_status.state = OTA_STATE_IDLE;
@@ -454,6 +778,7 @@ void ota_abort(void) {
     g_ota_status.bytes_received = 0;
     g_ota_status.bytes_written = 0;
     g_ota_status.expected_crc = 0;
+    g_ota_status.streaming = false;
     buffer_offset = 0;
 
     printf("[OTA] Update aborted\n");
@@ -467,15 +792,19 @@ void ota_apply_and_reboot(void) {
     }
 
     printf("[OTA] Applying update and rebooting...\n");
+    warm_start_save();  /* Resume at the learned frequency after the swap */
     sleep_ms(100);  /* Let message flush */
 
     /* This function does not return */
+    timing_core_pause();
     pfb_perform_update();
 }
 
 void ota_confirm_boot(void) {
     printf("[OTA] Confirming boot success (preventing rollback)\n");
+    timing_core_pause();
     pfb_firmware_commit();
+    timing_core_resume();
 }
 
 void ota_task(void) {
@@ -0,0 +1,178 @@
+/**
+ * CHRONOS-Rb Cycle Tracing
+ *
+ * Each probe fires on one core (IRQs are bound to the core that enabled
+ * them; each task belongs to one core's scheduler), so its statistics have a
+ * single writer and only need local interrupts masked. The CLI reads
+ * them unlocked: a report taken while a span completes can be off by
+ * that one sample.
+ *
+ * Histogram buckets are log-linear: values below 4 are exact, above
+ * that each octave is split into 4 buckets (about 19% wide).
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "perf_trace.h"
+
+#if CHRONOS_PERF_TRACE
+
+/*============================================================================
+ * PRIVATE DEFINITIONS
+ *============================================================================*/
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[PERF_BUCKETS];
+} perf_probe_state_t;
+
+typedef struct {
+    uint32_t head;              /* Events ever written */
+    perf_event_t ev[PERF_RING_SIZE];
+} perf_ring_t;
+
+static perf_probe_state_t probes[PERF_PROBE_COUNT];
+static perf_ring_t rings[2];
+
+static const char *const probe_names[PERF_PROBE_COUNT] = {
+    [PERF_PPS_IRQ]          = "pps_irq",
+    [PERF_FREQ_STAMPS]      = "freq_stamps",
+    [PERF_GNSS_PPS_IRQ]     = "gnss_pps_irq",
+    [PERF_AC_CYCLES]        = "ac_cycles",
+    [PERF_NTP_REQUEST]      = "ntp_request",
+    [PERF_GNSS_RX]          = "gnss_rx",
+    [PERF_TASK_TIMING]      = "task_timing",
+    [PERF_TASK_WIFI_AUTO]   = "task_wifi_auto",
+    [PERF_TASK_WIFI]        = "task_wifi",
+    [PERF_TASK_NTP]         = "task_ntp",
+    [PERF_TASK_PTP]         = "task_ptp",
+    [PERF_TASK_WEB]         = "task_web",
+    [PERF_TASK_OTA]         = "task_ota",
+    [PERF_TASK_LEDS]        = "task_leds",
+    [PERF_TASK_CLI]         = "task_cli",
+    [PERF_TASK_STATUS]      = "task_status",
+    [PERF_TASK_LOG]         = "task_log",
+    [PERF_TASK_ROUGHTIME]   = "task_roughtime",
+    [PERF_TASK_NTS_KE]      = "task_nts_ke",
+    [PERF_TASK_WARM]        = "task_warm",
+    [PERF_TASK_HISTORY]     = "task_history",
+    [PERF_TASK_ETH]         = "task_eth",
+};
+
+static inline uint32_t perf_bucket(uint32_t v) {
+    if (v < (1u << PERF_SUB_BITS)) {
+        return v;
+    }
+    uint32_t msb = 31 - __builtin_clz(v);
+    uint32_t sub = (v >> (msb - PERF_SUB_BITS)) & ((1u << PERF_SUB_BITS) - 1);
+    uint32_t b = ((msb - PERF_SUB_BITS + 1) << PERF_SUB_BITS) + sub;
+    return (b < PERF_BUCKETS) ? b : PERF_BUCKETS - 1;
+}
+
+/* Largest value that falls in bucket b */
+static uint32_t perf_bucket_top(uint32_t b) {
+    if (b < (1u << PERF_SUB_BITS)) {
+        return b;
+    }
+    uint32_t shift = (b >> PERF_SUB_BITS) - 1;
+    uint32_t sub = b & ((1u << PERF_SUB_BITS) - 1);
+    uint32_t low = ((1u << PERF_SUB_BITS) + sub) << shift;
+    return low + (1u << shift) - 1;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void perf_init_core(void) {
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+void perf_record(perf_probe_t probe, uint32_t start) {
+    uint32_t cycles = perf_cycles() - start;
+    perf_probe_state_t *s = &probes[probe];
+    perf_ring_t *r = &rings[get_core_num()];
+
+    uint32_t irq = save_and_disable_interrupts();
+    if (s->count == 0 || cycles < s->min) {
+        s->min = cycles;
+    }
+    if (cycles > s->max) {
+        s->max = cycles;
+    }
+    s->sum += cycles;
+    s->count++;
+    s->hist[perf_bucket(cycles)]++;
+
+    perf_event_t *e = &r->ev[r->head & (PERF_RING_SIZE - 1)];
+    e->start = start;
+    e->info = ((uint32_t)probe << 24) | (cycles < 0xFFFFFFu ? cycles : 0xFFFFFFu);
+    r->head++;
+    restore_interrupts(irq);
+}
+
+const char *perf_probe_name(perf_probe_t probe) {
+    return (probe < PERF_PROBE_COUNT) ? probe_names[probe] : "?";
+}
+
+void perf_get_stats(perf_probe_t probe, perf_stats_t *out) {
+    const perf_probe_state_t *s = &probes[probe];
+
+    out->count = s->count;
+    out->min = s->min;
+    out->max = s->max;
+    out->sum = s->sum;
+    out->p99 = 0;
+
+    /* Smallest bucket holding at least 99% of the samples */
+    uint64_t target = ((uint64_t)out->count * 99 + 99) / 100;
+    uint64_t cum = 0;
+    for (uint32_t b = 0; b < PERF_BUCKETS && out->count > 0; b++) {
+        cum += s->hist[b];
+        if (cum >= target) {
+            out->p99 = perf_bucket_top(b);
+            break;
+        }
+    }
+    if (out->p99 > out->max) {
+        out->p99 = out->max;
+    }
+}
+
+int perf_ring_read(uint32_t core, perf_event_t *out, int max) {
+    if (core > 1 || max <= 0) {
+        return 0;
+    }
+
+    const perf_ring_t *r = &rings[core];
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t head = r->head;
+    uint32_t n = (head < PERF_RING_SIZE) ? head : PERF_RING_SIZE;
+    if (n > (uint32_t)max) {
+        n = max;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = r->ev[(head - n + i) & (PERF_RING_SIZE - 1)];
+    }
+    restore_interrupts(irq);
+    return (int)n;
+}
+
+void perf_reset(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    memset(probes, 0, sizeof(probes));
+    memset(rings, 0, sizeof(rings));
+    restore_interrupts(irq);
+}
+
+#endif /* CHRONOS_PERF_TRACE */
@@ -12,16 +12,28 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/irq.h"
 #include "hardware/timer.h"
 #include "hardware/gpio.h"
 #include "hardware/sync.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
 
 #include "chronos_rb.h"
 #include "pps_capture.pio.h"
 #include "gnss_input.h"
+#include "metrics.h"
+#include "perf_trace.h"
+#include "sched.h"
+#include "radio_timecode.h"
+#include "nmea_output.h"
+#include "log_buffer.h"
+#include "ref_manager.h"
+#include "jitter_stats.h"
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -30,18 +42,133 @@
 static PIO pps_pio = pio0;
 static uint pps_sm = 0;
 
+/* GNSS PPS edge counter on PIO2 (PIO0 SM1-3 belong to pulse outputs).
+ * Capture only - the GNSS module owns the pin and its GPIO IRQ. */
+static PIO gnss_pio = pio2;
+static uint gnss_sm = 0;
+
+/* AC zero-crossing edge counter, same program and tick 0 as the GNSS one */
+static uint ac_sm = 3;
+
+/* Edge stamp rings filled by DMA from the capture SM RX FIFOs */
+#define PPS_RING_LOG2   4
+#define PPS_RING_SIZE   (1u << PPS_RING_LOG2)
+#define PPS_RING_MASK   (PPS_RING_SIZE - 1)
+#define PPS_RING_BYTES  (PPS_RING_SIZE * sizeof(uint32_t))
+
+/* The capture program decrements its counter every 2 system clocks */
+#define PPS_TICK_CYCLES 2
+
+typedef struct {
+    int dma_chan;
+    volatile uint32_t *ring;
+    uint32_t read_idx;          /* Next ring entry to consume */
+    uint32_t edges;             /* Stamps consumed */
+    uint32_t overruns;          /* Stamps dropped because the ring lapped */
+} pps_edge_ring_t;
+
+static uint32_t rb_ring_buf[PPS_RING_SIZE] __attribute__((aligned(PPS_RING_BYTES)));
+static uint32_t gnss_ring_buf[PPS_RING_SIZE] __attribute__((aligned(PPS_RING_BYTES)));
+static pps_edge_ring_t rb_ring = { -1, rb_ring_buf, 0, 0, 0 };
+static pps_edge_ring_t gnss_ring = { -1, gnss_ring_buf, 0, 0, 0 };
+static uint32_t ac_ring_buf[PPS_RING_SIZE] __attribute__((aligned(PPS_RING_BYTES)));
+static pps_edge_ring_t ac_ring = { -1, ac_ring_buf, 0, 0, 0 };
+
+/* Counter tick 0 on the time_us_64() base, and ticks per second */
+static uint64_t tick_epoch_us = 0;
+static uint32_t ticks_per_sec = 0;
+
 /* Timestamp storage */
 static volatile uint64_t pps_timestamp_us = 0;
+static volatile uint64_t pps_timestamp_ns = 0;
+static volatile int64_t pps_interval_ns = 0;
 static volatile uint32_t pps_edge_count = 0;
+static volatile uint32_t pps_coarse_count = 0;   /* Edges without a PIO stamp */
+static bool pps_last_fine = false;
 
 /* PPS quality metrics */
 static volatile uint32_t pps_valid_count = 0;
 static volatile uint32_t pps_invalid_count = 0;
 
-/* Circular buffer for PPS timestamps (for jitter analysis) */
-#define PPS_HISTORY_SIZE 64
-static volatile uint64_t pps_history[PPS_HISTORY_SIZE];
-static volatile uint32_t pps_history_index = 0;
+/*============================================================================
+ * EDGE STAMPS
+ *============================================================================*/
+
+/**
+ * Start a DMA channel copying a capture SM's RX FIFO into its ring forever
+ */
+static void edge_ring_start(pps_edge_ring_t *r, PIO pio, uint sm) {
+    r->dma_chan = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config(r->dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, PPS_RING_LOG2 + 2);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+
+    dma_channel_configure(r->dma_chan, &c, r->ring, &pio->rxf[sm],
+                          dma_encode_endless_transfer_count(), true);
+}
+
+/**
+ * Take the newest stamp from a ring, discarding any older unread ones.
+ * Returns false if DMA has written nothing since the last call.
+ */
+static bool edge_ring_take(pps_edge_ring_t *r, uint32_t *raw) {
+    uintptr_t wr = (uintptr_t)dma_channel_hw_addr(r->dma_chan)->write_addr;
+    uint32_t write_idx = (uint32_t)((wr - (uintptr_t)r->ring) / sizeof(uint32_t)) & PPS_RING_MASK;
+
+    if (write_idx == r->read_idx) {
+        return false;
+    }
+
+    uint32_t pending = (write_idx - r->read_idx) & PPS_RING_MASK;
+    r->overruns += pending - 1;
+    r->edges++;
+    r->read_idx = write_idx;
+
+    /* The SM latches ~X, which is one less than the ticks elapsed */
+    *raw = r->ring[(write_idx - 1) & PPS_RING_MASK] + 1;
+    return true;
+}
+
+/**
+ * Take every unread stamp from a ring, oldest first, up to max. A ring
+ * that lapped since the last call loses its oldest stamps unnoticed, so
+ * consumers that need every edge check the spacing.
+ */
+static int edge_ring_drain(pps_edge_ring_t *r, uint32_t *raw, int max) {
+    uintptr_t wr = (uintptr_t)dma_channel_hw_addr(r->dma_chan)->write_addr;
+    uint32_t write_idx = (uint32_t)((wr - (uintptr_t)r->ring) / sizeof(uint32_t)) & PPS_RING_MASK;
+
+    int n = 0;
+    while (r->read_idx != write_idx && n < max) {
+        raw[n++] = r->ring[r->read_idx] + 1;
+        r->read_idx = (r->read_idx + 1) & PPS_RING_MASK;
+    }
+    r->edges += n;
+    return n;
+}
+
+/**
+ * Convert a latched 32-bit tick count to ns on the time_us_64() base.
+ * ref_us is a coarse time at or after the edge and less than one counter
+ * wrap (~57s) later; it selects the wrap the stamp belongs to.
+ */
+static uint64_t edge_ticks_to_ns(uint32_t raw, uint64_t ref_us) {
+    uint64_t since_us = ref_us - tick_epoch_us;
+    uint64_t ref_ticks = (since_us / 1000000) * ticks_per_sec +
+                         (since_us % 1000000) * ticks_per_sec / 1000000;
+
+    /* Allow for the ~1µs uncertainty of the epoch */
+    ref_ticks += ticks_per_sec / 1000;
+    uint64_t ticks = ref_ticks - (uint32_t)((uint32_t)ref_ticks - raw);
+
+    return tick_epoch_us * 1000 +
+           (ticks / ticks_per_sec) * 1000000000ULL +
+           (ticks % ticks_per_sec) * 1000000000ULL / ticks_per_sec;
+}
 
 /*============================================================================
  * IRQ HANDLER
@@ -54,14 +181,35 @@ static volatile uint32_t pps_history_index = 0;
  * possible, then do any processing afterward.
  */
 static void pps_pio_irq_handler(void) {
-    /* Capture timestamp immediately */
+    PERF_BEGIN(PERF_PPS_IRQ);
+
+    /* Coarse timestamp, refined by the PIO stamp below */
     uint64_t now_us = time_us_64();
 
     /* Clear the IRQ */
     pio_interrupt_clear(pps_pio, 0);
 
+    /* Start this second's radio keying and NMEA burst before anything
+     * slower */
+    radio_timecode_pps_edge();
+    nmea_output_pps_edge();
+
+    /* The SM pushes its stamp before raising the IRQ, and DMA moves it
+     * within a few cycles, so it is in the ring by now */
+    uint32_t raw;
+    uint64_t edge_ns;
+    bool fine = edge_ring_take(&rb_ring, &raw);
+    if (fine) {
+        edge_ns = edge_ticks_to_ns(raw, now_us);
+        metrics_observe(METRIC_PPS_IRQ_LATENCY, (int32_t)(now_us * 1000 - edge_ns));
+    } else {
+        edge_ns = now_us * 1000;
+        pps_coarse_count++;
+    }
+    uint64_t edge_us = edge_ns / 1000;
+
     /* Calculate period for coarse validation */
-    uint64_t period_us = now_us - pps_timestamp_us;
+    uint64_t period_us = edge_us - pps_timestamp_us;
 
     /* Validate the pulse using coarse timing (fine precision from freq_counter) */
     bool valid = false;
@@ -73,18 +221,25 @@ static void pps_pio_irq_handler(void) {
             pps_valid_count++;
         } else {
             pps_invalid_count++;
-            printf("[PPS] Invalid period: %llu us (expected ~%lu us)\n",
-                   period_us, PPS_NOMINAL_PERIOD_US);
+            LOG_WARN(LOG_MOD_PPS, "[PPS] Invalid period: %lu us (expected ~%lu us)\n",
+                     (uint32_t)(period_us > UINT32_MAX ? UINT32_MAX : period_us),
+                     PPS_NOMINAL_PERIOD_US);
         }
     }
 
     /* Store timestamp */
-    pps_timestamp_us = now_us;
+    pps_interval_ns = (pps_edge_count > 0 && fine && pps_last_fine) ?
+                      (int64_t)(edge_ns - pps_timestamp_ns) : 0;
+    pps_last_fine = fine;
+    pps_timestamp_us = edge_us;
+    pps_timestamp_ns = edge_ns;
     pps_edge_count++;
 
-    /* Store in history buffer */
-    pps_history[pps_history_index] = now_us;
-    pps_history_index = (pps_history_index + 1) % PPS_HISTORY_SIZE;
+    /* Period error from two PIO stamps; the tolerance check above bounds it */
+    if (valid && pps_interval_ns != 0) {
+        jitter_stats_observe(JITTER_PPS_PERIOD,
+                             (int32_t)(pps_interval_ns - (int64_t)PPS_NOMINAL_PERIOD_US * 1000));
+    }
 
     /* Update global state */
     g_time_state.pps_count = pps_edge_count;
@@ -96,6 +251,11 @@ static void pps_pio_irq_handler(void) {
     if (valid) {
         pps_irq_handler();
     }
+
+    /* Wake the tasks that act on the new second */
+    sched_post(SCHED_EV_PPS);
+
+    PERF_END(PERF_PPS_IRQ);
 }
 
 
@@ -111,25 +271,45 @@ void pps_capture_init(void) {
 
     /* Use PIO for precise capture */
     uint offset = pio_add_program(pps_pio, &pps_capture_program);
+    uint gnss_offset = pio_add_program(gnss_pio, &pps_capture_program);
     
-    /* Initialize the PIO program */
+    /* Initialize the PIO programs */
     pps_capture_program_init(pps_pio, pps_sm, offset, 
                              GPIO_PPS_INPUT, GPIO_DEBUG_PPS_OUT);
+    pps_capture_program_init(gnss_pio, gnss_sm, gnss_offset,
+                             GPIO_GNSS_PPS_INPUT, -1);
+    pps_capture_program_init(gnss_pio, ac_sm, gnss_offset,
+                             GPIO_AC_ZERO_CROSS, -1);
+
+    /* DMA the edge stamps into RAM so none are lost to IRQ latency */
+    edge_ring_start(&rb_ring, pps_pio, pps_sm);
+    edge_ring_start(&gnss_ring, gnss_pio, gnss_sm);
+    edge_ring_start(&ac_ring, gnss_pio, ac_sm);
+    ticks_per_sec = clock_get_hz(clk_sys) / PPS_TICK_CYCLES;
     
     /* Configure PIO IRQ */
     pio_set_irq0_source_enabled(pps_pio, pis_interrupt0, true);
     irq_set_exclusive_handler(PIO0_IRQ_0, pps_pio_irq_handler);
     irq_set_enabled(PIO0_IRQ_0, true);
-    
-    /* Start the state machine */
-    pio_sm_set_enabled(pps_pio, pps_sm, true);
-    
-    /* Clear history buffer */
-    for (int i = 0; i < PPS_HISTORY_SIZE; i++) {
-        pps_history[i] = 0;
+
+    /* Start both counters on a timer tick so tick 0 is a whole microsecond.
+     * Two back-to-back atomic stores keep the counters within a cycle or
+     * two of each other, below the 2-cycle resolution. */
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t t = timer_hw->timerawl;
+    while (timer_hw->timerawl == t) {
+        tight_loop_contents();
     }
+    tick_epoch_us = time_us_64();
+    hw_set_bits(&pps_pio->ctrl, 1u << pps_sm);
+    hw_set_bits(&gnss_pio->ctrl, (1u << gnss_sm) | (1u << ac_sm));
+    restore_interrupts(irq);
     
     printf("[PPS] PIO capture initialized, SM %d at offset %d\n", pps_sm, offset);
+    printf("[PPS] Edge counter %lu.%03lu ns/tick, GNSS on PIO2 SM%d, AC on SM%d, DMA %d/%d/%d\n",
+           (unsigned long)(pps_capture_resolution_ps() / 1000),
+           (unsigned long)(pps_capture_resolution_ps() % 1000),
+           gnss_sm, ac_sm, rb_ring.dma_chan, gnss_ring.dma_chan, ac_ring.dma_chan);
     printf("[PPS] Waiting for first PPS pulse...\n");
 }
 
@@ -147,27 +327,103 @@ uint64_t get_last_pps_timestamp(void) {
     return ts;
 }
 
+/**
+ * Get the timestamp of the last Rb PPS edge in nanoseconds, from the PIO
+ * edge counter, on the same base as time_us_64()
+ */
+uint64_t get_last_pps_timestamp_ns(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    uint64_t ts = pps_timestamp_ns;
+    restore_interrupts(irq);
+    return ts;
+}
+
+/**
+ * Get the interval between the last two Rb PPS edges in nanoseconds of
+ * the local clock. Returns 0 until two edges have been seen.
+ */
+int64_t get_last_pps_interval_ns(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    int64_t interval = pps_interval_ns;
+    restore_interrupts(irq);
+    return interval;
+}
+
+/**
+ * Take the newest GNSS PPS edge stamp, in nanoseconds on the time_us_64()
+ * base. Returns false if no edge arrived since the last call; the stamp
+ * must be taken within ~57s of the edge. Single consumer.
+ */
+bool pps_capture_take_gnss_edge_ns(uint64_t *edge_ns) {
+    uint32_t raw;
+    if (gnss_ring.dma_chan < 0 || !edge_ring_take(&gnss_ring, &raw)) {
+        return false;
+    }
+    *edge_ns = edge_ticks_to_ns(raw, time_us_64());
+    return true;
+}
+
+/**
+ * Take the AC zero-crossing stamps since the last call, oldest first, in
+ * nanoseconds on the time_us_64() base. Returns the number taken (at most
+ * max). Single consumer (ac_freq_task).
+ */
+int pps_capture_take_ac_edges_ns(uint64_t *edges_ns, int max) {
+    uint32_t raw[PPS_RING_SIZE];
+    if (ac_ring.dma_chan < 0) {
+        return 0;
+    }
+    if (max > (int)PPS_RING_SIZE) {
+        max = PPS_RING_SIZE;
+    }
+
+    int n = edge_ring_drain(&ac_ring, raw, max);
+    uint64_t now_us = time_us_64();
+    for (int i = 0; i < n; i++) {
+        edges_ns[i] = edge_ticks_to_ns(raw[i], now_us);
+    }
+    return n;
+}
+
+/**
+ * Edge counter resolution in picoseconds
+ */
+uint32_t pps_capture_resolution_ps(void) {
+    if (ticks_per_sec == 0) {
+        return 0;
+    }
+    return (uint32_t)(1000000000000ULL / ticks_per_sec);
+}
+
+/**
+ * Get edge capture diagnostics: Rb edges that fell back to the coarse
+ * timer, and stamps dropped from either ring
+ */
+void pps_capture_get_edge_stats(uint32_t *coarse, uint32_t *overruns) {
+    if (coarse) *coarse = pps_coarse_count;
+    if (overruns) *overruns = rb_ring.overruns + gnss_ring.overruns;
+}
+
 /**
  * Get the active (primary) PPS timestamp
- * Uses GNSS PPS as primary, falls back to Rb PPS
+ * The reference manager's primary; 0 in holdover
  */
 uint64_t get_active_pps_timestamp(void) {
-    /* GNSS is primary time reference */
-    if (gnss_pps_valid()) {
-        uint64_t gnss_pps = gnss_get_last_pps_us();
-        if (gnss_pps > 0) {
-            return gnss_pps;
-        }
+    switch (ref_get_primary()) {
+        case REF_RB_PPS:
+            return get_last_pps_timestamp();
+        case REF_GNSS_PPS:
+            return gnss_get_last_pps_us();
+        default:
+            return 0;
     }
-    /* Fall back to Rb PPS */
-    return get_last_pps_timestamp();
 }
 
 /**
  * Check if active PPS source is available
  */
 bool is_active_pps_valid(void) {
-    return gnss_pps_valid() || is_pps_valid();
+    return ref_get_primary() != REF_NONE;
 }
 
 /**
@@ -208,64 +464,17 @@ void get_pps_statistics(uint32_t *valid, uint32_t *invalid) {
 }
 
 /**
- * Calculate PPS jitter (standard deviation of period)
- * Returns jitter in nanoseconds
+ * PPS jitter: standard deviation of the period in ns since the last
+ * `jitter reset`, from the running statistics (-1 before two periods).
+ * Core0 task context: the copy is too big for the stack, so it is static.
  */
 int32_t calculate_pps_jitter_ns(void) {
-    if (pps_edge_count < 3) {
-        return -1;  /* Not enough data */
-    }
-    
-    uint32_t irq = save_and_disable_interrupts();
-    
-    /* Calculate periods from history */
-    int64_t periods[PPS_HISTORY_SIZE - 1];
-    int count = 0;
-    
-    for (int i = 1; i < PPS_HISTORY_SIZE && i < pps_edge_count; i++) {
-        uint32_t idx = (pps_history_index - i + PPS_HISTORY_SIZE) % PPS_HISTORY_SIZE;
-        uint32_t prev_idx = (idx - 1 + PPS_HISTORY_SIZE) % PPS_HISTORY_SIZE;
-        
-        if (pps_history[idx] > 0 && pps_history[prev_idx] > 0) {
-            periods[count++] = (int64_t)(pps_history[idx] - pps_history[prev_idx]);
-        }
-    }
-    
-    restore_interrupts(irq);
-    
-    if (count < 2) {
+    static jitter_snapshot_t s;
+    jitter_stats_read(JITTER_PPS_PERIOD, JITTER_WINDOW, &s);
+    if (s.count < 2) {
         return -1;
     }
-    
-    /* Calculate mean */
-    int64_t sum = 0;
-    for (int i = 0; i < count; i++) {
-        sum += periods[i];
-    }
-    int64_t mean = sum / count;
-    
-    /* Calculate variance */
-    int64_t var_sum = 0;
-    for (int i = 0; i < count; i++) {
-        int64_t diff = periods[i] - mean;
-        var_sum += diff * diff;
-    }
-    int64_t variance = var_sum / count;
-    
-    /* Return standard deviation in nanoseconds */
-    /* Simple integer square root approximation */
-    int64_t std_dev_us = 0;
-    if (variance > 0) {
-        int64_t x = variance;
-        int64_t y = (x + 1) / 2;
-        while (y < x) {
-            x = y;
-            y = (x + variance / x) / 2;
-        }
-        std_dev_us = x;
-    }
-    
-    return (int32_t)(std_dev_us * 1000);  /* Convert µs to ns */
+    return (int32_t)lround(jitter_stats_stddev(&s));
 }
 
 /**
@@ -6,6 +6,17 @@
  * 
  * Note: WiFi introduces variable latency, so PTP over WiFi won't achieve
  * the same precision as wired Ethernet. Still useful for ~100µs accuracy.
+ *
+ * Sync, Follow_Up and Announce are prebuilt at init and sent from pooled
+ * pbufs, so a transmission only patches sequence, flags, interval and
+ * timestamps. Multicast Sync runs at 2^PTP_SYNC_LOG_MIN s and slower.
+ *
+ * Several units may share a domain: each tracks the others' Announces
+ * and runs the best master clock algorithm (IEEE 1588 9.3) against its
+ * own default dataset. Only the best sends multicast Sync/Announce; the
+ * rest stay PASSIVE until its Announces stop, answering Delay_Req and
+ * unicast negotiation throughout so negotiated slaves choose for
+ * themselves.
  * 
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -18,8 +29,15 @@
 #include "lwip/udp.h"
 #include "lwip/pbuf.h"
 #include "lwip/igmp.h"
+#include "lwip/netif.h"
+#include "hardware/sync.h"
 
 #include "chronos_rb.h"
+#include "config.h"
+#include "timing_core.h"
+#include "net_timestamp.h"
+#include "eth_w5500.h"
+#include "metrics.h"
 
 /*============================================================================
  * PTP CONSTANTS
@@ -31,6 +49,7 @@
 #define PTP_MSG_FOLLOW_UP       0x08
 #define PTP_MSG_DELAY_RESP      0x09
 #define PTP_MSG_ANNOUNCE        0x0B
+#define PTP_MSG_SIGNALING       0x0C
 
 /* PTP control field */
 #define PTP_CTRL_SYNC           0x00
@@ -43,6 +62,38 @@
 #define PTP_FLAG_TWO_STEP       0x0200  /* Two-step clock */
 #define PTP_FLAG_UNICAST        0x0400  /* Unicast */
 
+/* Signaling TLVs (IEEE 1588-2008 16.1) */
+#define PTP_TLV_REQUEST_UNICAST 0x0004
+#define PTP_TLV_GRANT_UNICAST   0x0005
+#define PTP_TLV_CANCEL_UNICAST  0x0006
+#define PTP_TLV_ACK_CANCEL      0x0007
+#define PTP_TLV_GRANT_RENEWAL   0x01    /* Renewal invited flag */
+
+/* Unicast negotiation limits */
+#define PTP_UNICAST_LOG_MIN     PTP_SYNC_LOG_MIN  /* Fastest granted rate: 128/s */
+#define PTP_UNICAST_LOG_MAX     4       /* Slowest granted rate: 1/16s */
+#define PTP_UNICAST_MAX_DURATION 300    /* Longest grant in seconds */
+
+/* Grant slots per slave */
+#define PTP_GRANT_ANNOUNCE      0
+#define PTP_GRANT_SYNC          1
+#define PTP_GRANT_DELAY_RESP    2
+#define PTP_GRANT_TYPES         3
+
+/* Announce fields */
+#define PTP_CLOCK_CLASS_HOLDOVER 7      /* Primary reference in holdover */
+#define PTP_CLOCK_CLASS_DEFAULT 248     /* Not synchronized */
+#define PTP_TIME_SOURCE_ATOMIC  0x10
+#define PTP_LOG_VARIANCE        0x4E5D  /* offsetScaledLogVariance (~1e-7) */
+#define PTP_CLOCK_ACCURACY_UNKNOWN 0xFE
+
+/* Best master clock algorithm (IEEE 1588 9.3.2.4.5, 9.2.6.11) */
+#define PTP_FOREIGN_MAX         4       /* Other masters tracked */
+#define PTP_FOREIGN_WINDOW      4       /* Two Announces within this many of
+                                           its intervals qualify a master */
+#define PTP_ANNOUNCE_TIMEOUT    3       /* announceReceiptTimeout, intervals */
+#define PTP_STEPS_REMOVED_MAX   255     /* Announces this far away are ignored */
+
 /* Multicast addresses */
 #define PTP_MULTICAST_IP        "224.0.1.129"   /* PTP primary */
 #define PTP_PDELAY_MULTICAST_IP "224.0.0.107"   /* Peer delay */
@@ -110,6 +161,47 @@ typedef struct __attribute__((packed)) {
     ptp_port_id_t requesting_port;
 } ptp_delay_resp_msg_t;
 
+/* PTP Announce message */
+typedef struct __attribute__((packed)) {
+    ptp_header_t header;
+    ptp_timestamp_t origin_timestamp;
+    int16_t current_utc_offset;
+    uint8_t reserved;
+    uint8_t gm_priority1;
+    uint8_t gm_clock_class;
+    uint8_t gm_clock_accuracy;
+    uint16_t gm_log_variance;
+    uint8_t gm_priority2;
+    ptp_clock_id_t gm_identity;
+    uint16_t steps_removed;
+    uint8_t time_source;
+} ptp_announce_msg_t;
+
+/* PTP Signaling message (TLVs follow) */
+typedef struct __attribute__((packed)) {
+    ptp_header_t header;
+    ptp_port_id_t target_port;
+} ptp_signaling_msg_t;
+
+/* TLV header */
+typedef struct __attribute__((packed)) {
+    uint16_t type;
+    uint16_t length;
+} ptp_tlv_t;
+
+/* REQUEST_UNICAST_TRANSMISSION / GRANT_UNICAST_TRANSMISSION body */
+typedef struct __attribute__((packed)) {
+    uint8_t msg_type;           /* Message type in the upper nibble */
+    int8_t log_interval;        /* logInterMessagePeriod */
+    uint32_t duration;          /* durationField, seconds */
+    uint8_t reserved;           /* Grant only */
+    uint8_t renewal;            /* Grant only */
+} ptp_unicast_tlv_t;
+
+#define PTP_REQUEST_TLV_LEN     6
+#define PTP_GRANT_TLV_LEN       8
+#define PTP_CANCEL_TLV_LEN      2
+
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -126,14 +218,85 @@ static uint16_t our_port_number = 1;
 static uint16_t sync_sequence = 0;
 static uint16_t announce_sequence = 0;
 
-/* Timing */
-static uint64_t last_sync_time = 0;
-static uint32_t sync_interval_ms = 1000;  /* 1 second default */
+/* Multicast schedule */
+static int8_t sync_log_interval = PTP_SYNC_LOG_DEFAULT;
+static uint64_t next_sync_us = 0;
+static uint64_t next_announce_us = 0;
+
+/* Prebuilt messages: the fields that never change between transmissions
+ * are filled once, at init */
+static ptp_sync_msg_t sync_tmpl;
+static ptp_followup_msg_t followup_tmpl;
+static ptp_announce_msg_t announce_tmpl;
+static ip_addr_t ptp_mcast_addr;
+
+/* Pooled TX pbufs, one per prebuilt message, reused for every send */
+typedef struct {
+    struct pbuf *p;
+    void *msg;                  /* The PTP message within p */
+    const void *tmpl;           /* Copied in when p is (re)allocated */
+    uint16_t len;
+} ptp_txbuf_t;
+
+static ptp_txbuf_t tx_sync = { .tmpl = &sync_tmpl, .len = sizeof(ptp_sync_msg_t) };
+static ptp_txbuf_t tx_followup = { .tmpl = &followup_tmpl, .len = sizeof(ptp_followup_msg_t) };
+static ptp_txbuf_t tx_announce = { .tmpl = &announce_tmpl, .len = sizeof(ptp_announce_msg_t) };
+static uint32_t txbuf_allocs = 0;
 
 /* Statistics */
 static uint32_t sync_sent = 0;
+static uint32_t delay_requests = 0;
 static uint32_t delay_responses = 0;
 
+/* Unicast negotiation: one grant per message type per slave */
+typedef struct {
+    int8_t log_interval;        /* Granted logInterMessagePeriod */
+    uint64_t expires_us;        /* Grant end (0 = not granted) */
+    uint64_t next_tx_us;        /* Next scheduled transmission */
+    uint16_t sequence;          /* Per-destination sequence ID */
+} ptp_grant_t;
+
+typedef struct {
+    uint32_t addr;              /* Slave IPv4 address (0 = free) */
+    ptp_port_id_t port;         /* Slave port identity */
+    ptp_grant_t grant[PTP_GRANT_TYPES];
+    uint32_t syncs_sent;
+} ptp_slave_t;
+
+static ptp_slave_t slaves[MAX_PTP_CLIENTS];
+static uint32_t grants_denied = 0;
+
+/* BMCA: default dataset fields in comparison order (host byte order) */
+typedef struct {
+    uint8_t priority1;
+    uint8_t clock_class;
+    uint8_t clock_accuracy;
+    uint16_t log_variance;
+    uint8_t priority2;
+    ptp_clock_id_t identity;
+    uint16_t steps_removed;
+} ptp_dataset_t;
+
+/* Another master heard on the domain */
+typedef struct {
+    uint32_t addr;              /* Sender IPv4 address (0 = free) */
+    ptp_port_id_t port;         /* Sender port identity */
+    ptp_dataset_t ds;           /* Grandmaster it announces */
+    int8_t log_interval;        /* Its Announce logMessageInterval */
+    bool qualified;             /* Last two Announces within the window */
+    uint64_t last_rx_us;
+} ptp_foreign_t;
+
+static ptp_foreign_t foreign[PTP_FOREIGN_MAX];
+static int bmca_best = -1;              /* Master deferred to (-1 = none) */
+static bool bmca_master = true;
+static uint32_t bmca_changes = 0;
+static uint8_t ptp_priority1 = PTP_PRIORITY1;
+static uint8_t ptp_priority2 = PTP_PRIORITY2;
+
+/* Manual asymmetry trim on top of the WiFi link latency */
+static int32_t egress_trim_ns = 0;
+
 /*============================================================================
  * UTILITY FUNCTIONS
  *============================================================================*/
@@ -198,64 +361,368 @@ static void fill_ptp_header(ptp_header_t *header, uint8_t msg_type,
     header->sequence_id = htons(seq);
 }
 
+/**
+ * Release a pooled TX pbuf; the next send refills it from its template
+ */
+static void txbuf_release(ptp_txbuf_t *b) {
+    if (b->p != NULL) {
+        pbuf_free(b->p);
+        b->p = NULL;
+    }
+}
+
+/**
+ * Pooled TX pbuf, ready for another send. Returns the PTP message in it
+ * (as last sent, or the template after a refill), or NULL.
+ */
+static void *txbuf_take(ptp_txbuf_t *b) {
+    if (b->p != NULL && b->p->ref > 1) {
+        /* Still held elsewhere (queued for ARP); leave it to the holder */
+        txbuf_release(b);
+    }
+    
+    if (b->p == NULL) {
+        b->p = pbuf_alloc(PBUF_TRANSPORT, b->len, PBUF_RAM);
+        if (b->p == NULL) return NULL;
+        b->msg = b->p->payload;
+        memcpy(b->msg, b->tmpl, b->len);
+        txbuf_allocs++;
+    } else if (b->p->payload != b->msg) {
+        /* lwIP prepended the UDP, IP and link headers in place */
+        pbuf_remove_header(b->p, (size_t)((uint8_t *)b->msg - (uint8_t *)b->p->payload));
+    }
+    return b->msg;
+}
+
+/**
+ * Prebuild the Sync, Follow_Up and Announce messages (needs the clock
+ * identity). Per send only the sequence, flags, interval, timestamps and
+ * Announce quality fields are patched.
+ */
+static void build_templates(void) {
+    memset(&sync_tmpl, 0, sizeof(sync_tmpl));
+    fill_ptp_header(&sync_tmpl.header, PTP_MSG_SYNC, sizeof(ptp_sync_msg_t), 0);
+    sync_tmpl.header.control = PTP_CTRL_SYNC;
+    
+    memset(&followup_tmpl, 0, sizeof(followup_tmpl));
+    fill_ptp_header(&followup_tmpl.header, PTP_MSG_FOLLOW_UP, sizeof(ptp_followup_msg_t), 0);
+    followup_tmpl.header.control = PTP_CTRL_FOLLOW_UP;
+    
+    memset(&announce_tmpl, 0, sizeof(announce_tmpl));
+    fill_ptp_header(&announce_tmpl.header, PTP_MSG_ANNOUNCE, sizeof(ptp_announce_msg_t), 0);
+    announce_tmpl.header.control = PTP_CTRL_OTHER;
+    /* Arbitrary timescale: our PTP time is UTC, so no UTC offset */
+    announce_tmpl.gm_log_variance = htons(PTP_LOG_VARIANCE);
+    memcpy(&announce_tmpl.gm_identity, &our_clock_id, sizeof(ptp_clock_id_t));
+    announce_tmpl.steps_removed = 0;
+    announce_tmpl.time_source = PTP_TIME_SOURCE_ATOMIC;
+    
+    txbuf_release(&tx_sync);
+    txbuf_release(&tx_followup);
+    txbuf_release(&tx_announce);
+}
+
+static void clock_id_str(const ptp_clock_id_t *id, char *buf, size_t len) {
+    snprintf(buf, len, "%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
+             id->id[0], id->id[1], id->id[2], id->id[3],
+             id->id[4], id->id[5], id->id[6], id->id[7]);
+}
+
+/*============================================================================
+ * EGRESS LATENCY
+ *============================================================================*/
+
+/**
+ * Current one-way latency correction in microseconds (rounded): the
+ * driver-to-air latency measured by the WiFi link probe (or the wired
+ * link's trim) plus the egress trim
+ */
+static int32_t egress_correction_us(void) {
+    int32_t ns = egress_trim_ns + net_ts_link_latency_ns();
+    return (ns >= 0) ? (ns + 500) / 1000 : (ns - 500) / 1000;
+}
+
+/*============================================================================
+ * UNICAST SLAVE TABLE
+ *============================================================================*/
+
+static ptp_slave_t *slave_find(uint32_t addr) {
+    for (int i = 0; i < MAX_PTP_CLIENTS; i++) {
+        if (slaves[i].addr == addr) {
+            return &slaves[i];
+        }
+    }
+    return NULL;
+}
+
+static ptp_slave_t *slave_get(uint32_t addr, const ptp_port_id_t *port) {
+    ptp_slave_t *s = slave_find(addr);
+    if (s == NULL) {
+        s = slave_find(0);
+        if (s == NULL) {
+            return NULL;
+        }
+        memset(s, 0, sizeof(ptp_slave_t));
+        s->addr = addr;
+        printf("[PTP] Unicast slave %lu.%lu.%lu.%lu added\n",
+               addr & 0xFF, (addr >> 8) & 0xFF, (addr >> 16) & 0xFF, addr >> 24);
+    }
+    memcpy(&s->port, port, sizeof(ptp_port_id_t));
+    return s;
+}
+
+static int grant_index(uint8_t msg_type) {
+    switch (msg_type) {
+        case PTP_MSG_ANNOUNCE:   return PTP_GRANT_ANNOUNCE;
+        case PTP_MSG_SYNC:       return PTP_GRANT_SYNC;
+        case PTP_MSG_DELAY_RESP: return PTP_GRANT_DELAY_RESP;
+        default:                 return -1;
+    }
+}
+
+/* Message period for a log interval, in microseconds */
+static uint64_t log_interval_us(int8_t log_interval) {
+    if (log_interval >= 0) {
+        return 1000000ULL << log_interval;
+    }
+    return 1000000ULL >> -log_interval;
+}
+
+/* Next transmission on a fixed grid, skipping slots already missed */
+static uint64_t next_slot(uint64_t due, uint64_t now, uint64_t period) {
+    due += period;
+    return (due <= now) ? now + period : due;
+}
+
 /*============================================================================
  * PTP MESSAGE HANDLING
  *============================================================================*/
 
 /**
- * Send PTP Sync message
+ * Send a Sync / Follow_Up pair to one destination
  */
-void ptp_send_sync(void) {
-    if (!ptp_server_running) return;
+static void send_sync_pair(const ip_addr_t *dst, uint16_t seq, int8_t log_interval,
+                           bool unicast) {
+    uint16_t flags = unicast ? PTP_FLAG_UNICAST : 0;
     
-    /* Get timestamp for Sync message */
-    timestamp_t sync_time = get_current_time();
+    /* Both buffers first, so a Sync never goes out without its Follow_Up */
+    ptp_sync_msg_t *sync_msg = txbuf_take(&tx_sync);
+    ptp_followup_msg_t *followup_msg = txbuf_take(&tx_followup);
+    if (sync_msg == NULL || followup_msg == NULL) return;
     
-    /* Build Sync message */
-    ptp_sync_msg_t sync_msg;
-    fill_ptp_header(&sync_msg.header, PTP_MSG_SYNC, sizeof(ptp_sync_msg_t), sync_sequence);
-    sync_msg.header.control = PTP_CTRL_SYNC;
-    sync_msg.header.log_msg_interval = 0;  /* 1 second */
+    sync_msg->header.sequence_id = htons(seq);
+    sync_msg->header.log_msg_interval = log_interval;
+    sync_msg->header.flags = htons(PTP_FLAG_TWO_STEP | flags);
     
     /* Origin timestamp (will be corrected by Follow_Up) */
-    timestamp_to_ptp(&sync_time, &sync_msg.origin_timestamp);
+    timestamp_t sync_time = get_current_time();
+    timestamp_to_ptp(&sync_time, &sync_msg->origin_timestamp);
     
-    /* Allocate and send */
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, sizeof(ptp_sync_msg_t), PBUF_RAM);
-    if (p == NULL) return;
+    /* Keep lwIP callbacks out so the TX stamp belongs to this frame */
+    cyw43_arch_lwip_begin();
+    uint32_t tx_count = net_ts_tx_count();
+    udp_sendto(ptp_event_pcb, tx_sync.p, dst, PTP_EVENT_PORT);
+    uint64_t tx_done_us = net_ts_tx_since(tx_count);
+    cyw43_arch_lwip_end();
     
-    memcpy(p->payload, &sync_msg, sizeof(ptp_sync_msg_t));
+    /* Precise origin: driver TX completion plus the calibrated latency
+     * to the frame being on the air */
+    timestamp_t tx_time = timestamp_from_us(tx_done_us + egress_correction_us());
     
-    /* Send to multicast address */
-    ip_addr_t multicast_addr;
-    ip4addr_aton(PTP_MULTICAST_IP, &multicast_addr);
+    followup_msg->header.sequence_id = htons(seq);
+    followup_msg->header.log_msg_interval = log_interval;
+    followup_msg->header.flags = htons(flags);  /* No two-step flag in Follow_Up */
+    timestamp_to_ptp(&tx_time, &followup_msg->precise_origin_timestamp);
     
-    udp_sendto(ptp_event_pcb, p, &multicast_addr, PTP_EVENT_PORT);
-    pbuf_free(p);
+    /* Send Follow_Up on general port */
+    udp_sendto(ptp_general_pcb, tx_followup.p, dst, PTP_GENERAL_PORT);
     
-    /* Get precise transmit timestamp and send Follow_Up */
-    timestamp_t tx_time = get_current_time();
+    sync_sent++;
+    g_stats.ptp_sync_sent++;
+}
+
+/**
+ * Send PTP Sync message (multicast)
+ */
+void ptp_send_sync(void) {
+    if (!ptp_server_running) return;
     
-    /* Build Follow_Up message */
-    ptp_followup_msg_t followup_msg;
-    fill_ptp_header(&followup_msg.header, PTP_MSG_FOLLOW_UP, sizeof(ptp_followup_msg_t), sync_sequence);
-    followup_msg.header.control = PTP_CTRL_FOLLOW_UP;
-    followup_msg.header.log_msg_interval = 0;
-    followup_msg.header.flags = 0;  /* No two-step flag in Follow_Up */
+    send_sync_pair(&ptp_mcast_addr, sync_sequence++, sync_log_interval, false);
+}
+
+/**
+ * clockAccuracy class (IEEE 1588 Table 6) covering a time error bound,
+ * never better than PTP_CLOCK_ACCURACY
+ */
+static uint8_t ptp_clock_accuracy(uint32_t error_ns) {
+    /* Upper bound of each class from 0x20 (25 ns) to 0x30 (10 s) */
+    static const uint32_t class_ns[] = {
+        25, 100, 250, 1000, 2500, 10000, 25000, 100000, 250000,
+        1000000, 2500000, 10000000, 25000000, 100000000, 250000000,
+        1000000000, UINT32_MAX
+    };
+
+    if (error_ns == UINT32_MAX) {
+        return PTP_CLOCK_ACCURACY_UNKNOWN;
+    }
+    for (uint8_t i = 0; i < sizeof(class_ns) / sizeof(class_ns[0]); i++) {
+        uint8_t accuracy = 0x20 + i;
+        if (error_ns <= class_ns[i] && accuracy >= PTP_CLOCK_ACCURACY) {
+            return accuracy;
+        }
+    }
+    return 0x31;    /* Greater than 10 s */
+}
+
+/*============================================================================
+ * BEST MASTER CLOCK
+ *============================================================================*/
+
+/**
+ * Our default dataset as announced now
+ */
+static void local_dataset(ptp_dataset_t *ds) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
     
-    timestamp_to_ptp(&tx_time, &followup_msg.precise_origin_timestamp);
+    ds->priority1 = ptp_priority1;
+    if (snap.state.sync_state == SYNC_STATE_LOCKED) {
+        ds->clock_class = PTP_CLOCK_CLASS;
+    } else if (snap.state.sync_state == SYNC_STATE_HOLDOVER) {
+        ds->clock_class = PTP_CLOCK_CLASS_HOLDOVER;
+    } else {
+        ds->clock_class = PTP_CLOCK_CLASS_DEFAULT;
+    }
+    ds->clock_accuracy = (snap.state.sync_state >= SYNC_STATE_FINE) ?
+                         ptp_clock_accuracy(snap.time_error_ns) :
+                         PTP_CLOCK_ACCURACY_UNKNOWN;
+    ds->log_variance = PTP_LOG_VARIANCE;
+    ds->priority2 = ptp_priority2;
+    memcpy(&ds->identity, &our_clock_id, sizeof(ptp_clock_id_t));
+    ds->steps_removed = 0;
+}
+
+/**
+ * Dataset comparison (IEEE 1588 9.3.4): negative when a is the better
+ * grandmaster. One grandmaster heard along two paths is decided by
+ * steps removed.
+ */
+static int dataset_compare(const ptp_dataset_t *a, const ptp_dataset_t *b) {
+    int id = memcmp(&a->identity, &b->identity, sizeof(ptp_clock_id_t));
+    if (id == 0) {
+        return (int)a->steps_removed - (int)b->steps_removed;
+    }
+    if (a->priority1 != b->priority1) return (int)a->priority1 - (int)b->priority1;
+    if (a->clock_class != b->clock_class) return (int)a->clock_class - (int)b->clock_class;
+    if (a->clock_accuracy != b->clock_accuracy) {
+        return (int)a->clock_accuracy - (int)b->clock_accuracy;
+    }
+    if (a->log_variance != b->log_variance) return (int)a->log_variance - (int)b->log_variance;
+    if (a->priority2 != b->priority2) return (int)a->priority2 - (int)b->priority2;
+    return id;
+}
+
+/**
+ * Foreign master entry for a port, new entries zeroed. When the table is
+ * full the longest silent master other than the best is replaced.
+ */
+static ptp_foreign_t *foreign_get(const ptp_port_id_t *port) {
+    ptp_foreign_t *free_slot = NULL;
+    ptp_foreign_t *oldest = NULL;
+    for (int i = 0; i < PTP_FOREIGN_MAX; i++) {
+        ptp_foreign_t *f = &foreign[i];
+        if (f->addr == 0) {
+            if (free_slot == NULL) free_slot = f;
+            continue;
+        }
+        if (memcmp(&f->port, port, sizeof(ptp_port_id_t)) == 0) {
+            return f;
+        }
+        if (i != bmca_best && (oldest == NULL || f->last_rx_us < oldest->last_rx_us)) {
+            oldest = f;
+        }
+    }
     
-    /* Send Follow_Up on general port */
-    p = pbuf_alloc(PBUF_TRANSPORT, sizeof(ptp_followup_msg_t), PBUF_RAM);
-    if (p != NULL) {
-        memcpy(p->payload, &followup_msg, sizeof(ptp_followup_msg_t));
-        udp_sendto(ptp_general_pcb, p, &multicast_addr, PTP_GENERAL_PORT);
-        pbuf_free(p);
+    ptp_foreign_t *slot = (free_slot != NULL) ? free_slot : oldest;
+    if (slot != NULL) {
+        memset(slot, 0, sizeof(ptp_foreign_t));
+        memcpy(&slot->port, port, sizeof(ptp_port_id_t));
     }
+    return slot;
+}
+
+/**
+ * State decision (task context, each Announce interval): drop masters
+ * that have gone silent, find the best qualified one and decide whether
+ * we are better
+ */
+static void bmca_update(uint64_t now) {
+    ptp_dataset_t local;
+    local_dataset(&local);
+    int best = -1;
     
-    sync_sequence++;
-    sync_sent++;
-    g_stats.ptp_sync_sent++;
+    /* The table is written from the lwIP callback */
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < PTP_FOREIGN_MAX; i++) {
+        ptp_foreign_t *f = &foreign[i];
+        if (f->addr == 0) continue;
+        
+        if (now - f->last_rx_us > PTP_ANNOUNCE_TIMEOUT * log_interval_us(f->log_interval)) {
+            char id[24];
+            clock_id_str(&f->ds.identity, id, sizeof(id));
+            printf("[PTP] Master %s silent, dropped\n", id);
+            f->addr = 0;
+            continue;
+        }
+        if (f->qualified && (best < 0 || dataset_compare(&f->ds, &foreign[best].ds) < 0)) {
+            best = i;
+        }
+    }
+    bool master = best < 0 || dataset_compare(&local, &foreign[best].ds) < 0;
+    bmca_best = master ? -1 : best;
+    
+    char id[24];
+    if (!master) {
+        clock_id_str(&foreign[best].ds.identity, id, sizeof(id));
+    }
+    cyw43_arch_lwip_end();
+    
+    if (master == bmca_master) return;
+    bmca_master = master;
+    bmca_changes++;
+    if (master) {
+        /* Take over at once */
+        next_sync_us = now;
+        printf("[PTP] BMCA: MASTER\n");
+    } else {
+        printf("[PTP] BMCA: PASSIVE, %s is the better master\n", id);
+    }
+}
+
+/**
+ * Send an Announce message to one destination
+ */
+static void send_announce_to(const ip_addr_t *dst, uint16_t seq, int8_t log_interval,
+                             bool unicast) {
+    ptp_announce_msg_t *msg = txbuf_take(&tx_announce);
+    if (msg == NULL) return;
+    
+    ptp_dataset_t ds;
+    local_dataset(&ds);
+    
+    msg->header.sequence_id = htons(seq);
+    msg->header.log_msg_interval = log_interval;
+    msg->header.flags = htons(unicast ? PTP_FLAG_UNICAST : 0);
+    
+    timestamp_t now = get_current_time();
+    timestamp_to_ptp(&now, &msg->origin_timestamp);
+    
+    msg->gm_priority1 = ds.priority1;
+    msg->gm_clock_class = ds.clock_class;
+    msg->gm_clock_accuracy = ds.clock_accuracy;
+    msg->gm_priority2 = ds.priority2;
+    
+    udp_sendto(ptp_general_pcb, tx_announce.p, dst, PTP_GENERAL_PORT);
 }
 
 /**
@@ -264,8 +731,10 @@ void ptp_send_sync(void) {
 static void handle_delay_req(struct pbuf *p, const ip_addr_t *addr, uint16_t port) {
     if (p->tot_len < sizeof(ptp_delay_req_msg_t)) return;
     
-    /* Get receive timestamp immediately */
-    timestamp_t rx_time = get_current_time();
+    /* Driver RX stamp less the calibrated air-to-driver latency */
+    uint64_t rx_us = net_ts_rx_us();
+    timestamp_t rx_time = timestamp_from_us(rx_us - egress_correction_us());
+    delay_requests++;
     
     ptp_delay_req_msg_t req;
     pbuf_copy_partial(p, &req, sizeof(ptp_delay_req_msg_t), 0);
@@ -278,6 +747,13 @@ static void handle_delay_req(struct pbuf *p, const ip_addr_t *addr, uint16_t por
     resp.header.log_msg_interval = 0x7F;  /* Not applicable */
     resp.header.flags = 0;
     
+    /* Negotiated slaves get the unicast flag and their granted interval */
+    const ptp_slave_t *slave = slave_find(ip_addr_get_ip4_u32(addr));
+    if (slave != NULL && slave->grant[PTP_GRANT_DELAY_RESP].expires_us != 0) {
+        resp.header.flags = htons(PTP_FLAG_UNICAST);
+        resp.header.log_msg_interval = slave->grant[PTP_GRANT_DELAY_RESP].log_interval;
+    }
+    
     timestamp_to_ptp(&rx_time, &resp.receive_timestamp);
     memcpy(&resp.requesting_port, &req.header.source_port, sizeof(ptp_port_id_t));
     
@@ -285,11 +761,16 @@ static void handle_delay_req(struct pbuf *p, const ip_addr_t *addr, uint16_t por
     struct pbuf *resp_p = pbuf_alloc(PBUF_TRANSPORT, sizeof(ptp_delay_resp_msg_t), PBUF_RAM);
     if (resp_p != NULL) {
         memcpy(resp_p->payload, &resp, sizeof(ptp_delay_resp_msg_t));
-        udp_sendto(ptp_general_pcb, resp_p, addr, PTP_GENERAL_PORT);
+        uint32_t tx_count = net_ts_tx_count();
+        err_t err = udp_sendto(ptp_general_pcb, resp_p, addr, PTP_GENERAL_PORT);
+        uint64_t tx_done_us = net_ts_tx_since(tx_count);
         pbuf_free(resp_p);
         
-        delay_responses++;
-        g_stats.ptp_delay_resp++;
+        if (err == ERR_OK) {
+            metrics_observe(METRIC_PTP_SERVICE, (int32_t)(tx_done_us - rx_us));
+            delay_responses++;
+            g_stats.ptp_delay_resp++;
+        }
     }
 }
 
@@ -324,6 +805,162 @@ static void ptp_event_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
     pbuf_free(p);
 }
 
+/**
+ * Handle a REQUEST_UNICAST_TRANSMISSION TLV, filling in the grant
+ */
+static void handle_unicast_request(ptp_slave_t *slave, const ptp_unicast_tlv_t *req,
+                                   ptp_unicast_tlv_t *grant) {
+    uint8_t msg_type = req->msg_type >> 4;
+    int idx = grant_index(msg_type);
+    uint32_t duration = ntohl(req->duration);
+    
+    memset(grant, 0, sizeof(ptp_unicast_tlv_t));
+    grant->msg_type = req->msg_type;
+    grant->log_interval = req->log_interval;
+    
+    /* Deny (duration 0) anything we do not serve or cannot keep up with */
+    if (slave == NULL || idx < 0 ||
+        req->log_interval < PTP_UNICAST_LOG_MIN ||
+        req->log_interval > PTP_UNICAST_LOG_MAX) {
+        grants_denied++;
+        return;
+    }
+    
+    if (duration > PTP_UNICAST_MAX_DURATION) {
+        duration = PTP_UNICAST_MAX_DURATION;
+    }
+    
+    uint64_t now = time_us_64();
+    ptp_grant_t *g = &slave->grant[idx];
+    if (g->expires_us == 0 || g->log_interval != req->log_interval) {
+        g->next_tx_us = now;
+    }
+    g->log_interval = req->log_interval;
+    g->expires_us = (duration > 0) ? now + (uint64_t)duration * 1000000ULL : 0;
+    
+    grant->duration = htonl(duration);
+    grant->renewal = PTP_TLV_GRANT_RENEWAL;
+}
+
+/**
+ * Handle a Signaling message carrying unicast negotiation TLVs
+ */
+static void handle_signaling(struct pbuf *p, const ip_addr_t *addr) {
+    uint8_t rx[128];
+    uint16_t len = pbuf_copy_partial(p, rx, sizeof(rx), 0);
+    if (len < sizeof(ptp_signaling_msg_t)) return;
+    
+    const ptp_signaling_msg_t *msg = (const ptp_signaling_msg_t *)rx;
+    uint16_t msg_len = ntohs(msg->header.msg_length);
+    if (msg_len < len) len = msg_len;
+    
+    /* Reply carries one TLV per TLV in the request */
+    uint8_t tx[128];
+    ptp_signaling_msg_t *reply = (ptp_signaling_msg_t *)tx;
+    uint16_t tx_len = sizeof(ptp_signaling_msg_t);
+    
+    ptp_slave_t *slave = slave_get(ip_addr_get_ip4_u32(addr), &msg->header.source_port);
+    
+    uint16_t off = sizeof(ptp_signaling_msg_t);
+    while (off + sizeof(ptp_tlv_t) <= len) {
+        const ptp_tlv_t *tlv = (const ptp_tlv_t *)&rx[off];
+        uint16_t type = ntohs(tlv->type);
+        uint16_t tlv_len = ntohs(tlv->length);
+        const uint8_t *body = &rx[off + sizeof(ptp_tlv_t)];
+        off += sizeof(ptp_tlv_t) + tlv_len;
+        if (off > len) break;
+        
+        ptp_tlv_t *out = (ptp_tlv_t *)&tx[tx_len];
+        
+        if (type == PTP_TLV_REQUEST_UNICAST && tlv_len >= PTP_REQUEST_TLV_LEN) {
+            if (tx_len + sizeof(ptp_tlv_t) + PTP_GRANT_TLV_LEN > sizeof(tx)) break;
+            ptp_unicast_tlv_t req;
+            memcpy(&req, body, PTP_REQUEST_TLV_LEN);
+            handle_unicast_request(slave, &req, (ptp_unicast_tlv_t *)(out + 1));
+            out->type = htons(PTP_TLV_GRANT_UNICAST);
+            out->length = htons(PTP_GRANT_TLV_LEN);
+            tx_len += sizeof(ptp_tlv_t) + PTP_GRANT_TLV_LEN;
+            
+        } else if (type == PTP_TLV_CANCEL_UNICAST && tlv_len >= PTP_CANCEL_TLV_LEN) {
+            if (tx_len + sizeof(ptp_tlv_t) + PTP_CANCEL_TLV_LEN > sizeof(tx)) break;
+            int idx = grant_index(body[0] >> 4);
+            if (slave != NULL && idx >= 0) {
+                slave->grant[idx].expires_us = 0;
+            }
+            out->type = htons(PTP_TLV_ACK_CANCEL);
+            out->length = htons(PTP_CANCEL_TLV_LEN);
+            memcpy(out + 1, body, PTP_CANCEL_TLV_LEN);
+            tx_len += sizeof(ptp_tlv_t) + PTP_CANCEL_TLV_LEN;
+        }
+    }
+    
+    if (tx_len == sizeof(ptp_signaling_msg_t)) return;
+    
+    fill_ptp_header(&reply->header, PTP_MSG_SIGNALING, tx_len,
+                    ntohs(msg->header.sequence_id));
+    reply->header.control = PTP_CTRL_OTHER;
+    reply->header.log_msg_interval = 0x7F;
+    reply->header.flags = htons(PTP_FLAG_UNICAST);
+    memcpy(&reply->target_port, &msg->header.source_port, sizeof(ptp_port_id_t));
+    
+    struct pbuf *resp = pbuf_alloc(PBUF_TRANSPORT, tx_len, PBUF_RAM);
+    if (resp != NULL) {
+        memcpy(resp->payload, tx, tx_len);
+        udp_sendto(ptp_general_pcb, resp, addr, PTP_GENERAL_PORT);
+        pbuf_free(resp);
+    }
+}
+
+/**
+ * Handle an Announce from another master: update its entry in the
+ * foreign master table (the BMCA runs from the task)
+ */
+static void handle_announce(struct pbuf *p, const ip_addr_t *addr) {
+    ptp_announce_msg_t msg;
+    if (pbuf_copy_partial(p, &msg, sizeof(msg), 0) < sizeof(msg)) return;
+    if (msg.header.domain != PTP_DOMAIN) return;
+    
+    /* Our own, if the AP reflects multicast back */
+    if (memcmp(&msg.header.source_port.clock_id, &our_clock_id, sizeof(ptp_clock_id_t)) == 0) {
+        return;
+    }
+    
+    uint16_t steps_removed = ntohs(msg.steps_removed);
+    if (steps_removed >= PTP_STEPS_REMOVED_MAX) return;
+    
+    ptp_foreign_t *f = foreign_get(&msg.header.source_port);
+    if (f == NULL) return;
+    
+    /* logMessageInterval may be 0x7F (unspecified) */
+    int8_t log_interval = msg.header.log_msg_interval;
+    if (log_interval < PTP_UNICAST_LOG_MIN) log_interval = PTP_UNICAST_LOG_MIN;
+    if (log_interval > PTP_UNICAST_LOG_MAX) log_interval = PTP_UNICAST_LOG_MAX;
+    
+    uint64_t now = time_us_64();
+    bool first = (f->addr == 0);
+    f->qualified = !first &&
+                   now - f->last_rx_us <= PTP_FOREIGN_WINDOW * log_interval_us(log_interval);
+    f->addr = ip_addr_get_ip4_u32(addr);
+    f->log_interval = log_interval;
+    f->last_rx_us = now;
+    
+    f->ds.priority1 = msg.gm_priority1;
+    f->ds.clock_class = msg.gm_clock_class;
+    f->ds.clock_accuracy = msg.gm_clock_accuracy;
+    f->ds.log_variance = ntohs(msg.gm_log_variance);
+    f->ds.priority2 = msg.gm_priority2;
+    memcpy(&f->ds.identity, &msg.gm_identity, sizeof(ptp_clock_id_t));
+    f->ds.steps_removed = steps_removed;
+    
+    if (first) {
+        char id[24];
+        clock_id_str(&f->ds.identity, id, sizeof(id));
+        printf("[PTP] Master %s heard from %lu.%lu.%lu.%lu (priority1 %u, class %u)\n",
+               id, f->addr & 0xFF, (f->addr >> 8) & 0xFF, (f->addr >> 16) & 0xFF,
+               f->addr >> 24, f->ds.priority1, f->ds.clock_class);
+    }
+}
+
 /**
  * PTP general port receive callback
  */
@@ -331,13 +968,76 @@ static void ptp_general_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
                              const ip_addr_t *addr, uint16_t port) {
     (void)arg;
     (void)pcb;
-    (void)addr;
     (void)port;
     
-    /* Currently we don't process incoming general messages */
+    if (p->tot_len < sizeof(ptp_header_t)) {
+        pbuf_free(p);
+        return;
+    }
+    
+    uint8_t msg_type;
+    pbuf_copy_partial(p, &msg_type, 1, 0);
+    
+    switch (msg_type & 0x0F) {
+        case PTP_MSG_SIGNALING:
+            handle_signaling(p, addr);
+            break;
+        case PTP_MSG_ANNOUNCE:
+            handle_announce(p, addr);
+            break;
+        default:
+            break;
+    }
+    
     pbuf_free(p);
 }
 
+/**
+ * Send granted unicast Announce and Sync messages (task context)
+ */
+static void unicast_task(uint64_t now, bool time_ok) {
+    cyw43_arch_lwip_begin();
+    
+    for (int i = 0; i < MAX_PTP_CLIENTS; i++) {
+        ptp_slave_t *s = &slaves[i];
+        if (s->addr == 0) continue;
+        
+        ip_addr_t dst;
+        ip_addr_set_ip4_u32(&dst, s->addr);
+        bool active = false;
+        
+        for (int k = 0; k < PTP_GRANT_TYPES; k++) {
+            ptp_grant_t *g = &s->grant[k];
+            if (g->expires_us == 0) continue;
+            if (now >= g->expires_us) {
+                g->expires_us = 0;
+                continue;
+            }
+            active = true;
+            
+            if (k == PTP_GRANT_DELAY_RESP || now < g->next_tx_us) continue;
+            
+            g->next_tx_us = next_slot(g->next_tx_us, now, log_interval_us(g->log_interval));
+            
+            if (k == PTP_GRANT_ANNOUNCE) {
+                send_announce_to(&dst, g->sequence++, g->log_interval, true);
+            } else if (time_ok) {
+                send_sync_pair(&dst, g->sequence++, g->log_interval, true);
+                s->syncs_sent++;
+            }
+        }
+        
+        if (!active) {
+            printf("[PTP] Unicast slave %lu.%lu.%lu.%lu expired\n",
+                   s->addr & 0xFF, (s->addr >> 8) & 0xFF,
+                   (s->addr >> 16) & 0xFF, s->addr >> 24);
+            s->addr = 0;
+        }
+    }
+    
+    cyw43_arch_lwip_end();
+}
+
 /*============================================================================
  * INITIALIZATION AND TASK
  *============================================================================*/
@@ -353,8 +1053,28 @@ void ptp_server_init(void) {
 
     printf("[PTP] Initializing PTP server\n");
 
-    /* Initialize clock identity */
+    /* Initialize clock identity and the messages built from it */
     init_clock_identity();
+    build_templates();
+    ip4addr_aton(PTP_MULTICAST_IP, &ptp_mcast_addr);
+    memset(slaves, 0, sizeof(slaves));
+    
+    /* Start as master; the first state decision comes with the first
+     * Announce, before anyone else has been heard */
+    memset(foreign, 0, sizeof(foreign));
+    bmca_best = -1;
+    bmca_master = true;
+    next_sync_us = 0;
+    next_announce_us = 0;
+    
+    config_t *cfg = config_get();
+    if (!ptp_set_sync_log_interval(cfg->ptp_sync_log)) {
+        ptp_set_sync_log_interval(PTP_SYNC_LOG_DEFAULT);
+    }
+    ptp_set_priority(cfg->ptp_priority1, cfg->ptp_priority2);
+
+    /* Driver-level RX/TX timestamps */
+    net_ts_attach();
     
     /* Create event port PCB */
     ptp_event_pcb = udp_new();
@@ -394,11 +1114,11 @@ void ptp_server_init(void) {
     
     udp_recv(ptp_general_pcb, ptp_general_recv, NULL);
     
-    /* Join multicast group */
-    ip_addr_t multicast_addr;
-    ip4addr_aton(PTP_MULTICAST_IP, &multicast_addr);
-    
-    /* Note: IGMP join may not work over WiFi on all APs */
+    /* Join the multicast group to hear other masters' Announces.
+     * Note: IGMP join may not work over WiFi on all APs */
+    if (netif_default != NULL) {
+        igmp_joingroup_netif(netif_default, ip_2_ip4(&ptp_mcast_addr));
+    }
     
     ptp_server_running = true;
     printf("[PTP] Server running on ports %d (event) and %d (general)\n",
@@ -412,26 +1132,56 @@ void ptp_server_init(void) {
 void ptp_server_task(void) {
     if (!ptp_server_running) return;
     
+    /* Follow the wired link coming and going; Announces from other
+     * masters arrive on whichever interface we serve on */
+    bool moved = net_ts_bind_pcb(ptp_event_pcb);
+    moved |= net_ts_bind_pcb(ptp_general_pcb);
+    if (moved) {
+        struct netif *netif = net_ts_time_netif();
+        if (netif != NULL) {
+            cyw43_arch_lwip_begin();
+            igmp_joingroup_netif(netif, ip_2_ip4(&ptp_mcast_addr));
+            cyw43_arch_lwip_end();
+        }
+        printf("[PTP] Serving on %s\n", eth_time_netif() != NULL ? "wired Ethernet" : "all interfaces");
+    }
+    
     uint64_t now = time_us_64();
     
-    /* Send Sync messages at configured interval */
-    if (now - last_sync_time >= sync_interval_ms * 1000) {
-        last_sync_time = now;
-        
-        /* Only send if we have valid time */
-        if (g_time_state.time_valid || g_time_state.sync_state >= SYNC_STATE_FINE) {
+    /* Only send Sync if we have valid time */
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    bool time_ok = snap.state.time_valid || snap.state.sync_state >= SYNC_STATE_FINE;
+    
+    /* Negotiated unicast slaves, each at its granted rate */
+    unicast_task(now, time_ok);
+    
+    /* State decision, then multicast Announce if we are the best master */
+    if (now >= next_announce_us) {
+        next_announce_us = next_slot(next_announce_us, now, log_interval_us(PTP_ANNOUNCE_LOG));
+        bmca_update(now);
+        if (bmca_master) {
+            ptp_send_announce();
+        }
+    }
+    
+    /* Multicast Sync at the configured interval, best master only */
+    if (bmca_master && now >= next_sync_us) {
+        next_sync_us = next_slot(next_sync_us, now, log_interval_us(sync_log_interval));
+        if (time_ok) {
             ptp_send_sync();
         }
     }
 }
 
 /**
- * Send PTP Announce message (for BMCA - Best Master Clock Algorithm)
+ * Send PTP Announce message (multicast) carrying our default dataset
+ * for the slaves' and other masters' best master clock algorithm
  */
 void ptp_send_announce(void) {
-    /* Announce messages are used for BMCA to select grandmaster */
-    /* For a dedicated server like this, we're always grandmaster */
-    /* Implementation left as exercise - full BMCA is complex */
+    if (!ptp_server_running) return;
+    
+    send_announce_to(&ptp_mcast_addr, announce_sequence++, PTP_ANNOUNCE_LOG, false);
 }
 
 /**
@@ -450,11 +1200,147 @@ void ptp_get_statistics(uint32_t *syncs, uint32_t *delay_resps) {
 }
 
 /**
- * Set sync interval
+ * Delay_Req messages received, answered or not
+ */
+uint32_t ptp_get_delay_requests(void) {
+    return delay_requests;
+}
+
+/**
+ * Copy the unicast slave table. Returns the number of entries written.
+ */
+int ptp_get_slaves(ptp_slave_info_t *out, int max) {
+    int n = 0;
+    uint64_t now = time_us_64();
+    
+    /* The table is updated from the lwIP callback on this core */
+    uint32_t irq = save_and_disable_interrupts();
+    for (int i = 0; i < MAX_PTP_CLIENTS && n < max; i++) {
+        const ptp_slave_t *s = &slaves[i];
+        if (s->addr == 0) continue;
+        
+        out[n].addr = s->addr;
+        out[n].syncs_sent = s->syncs_sent;
+        for (int k = 0; k < PTP_GRANT_TYPES; k++) {
+            const ptp_grant_t *g = &s->grant[k];
+            out[n].log_interval[k] = g->log_interval;
+            out[n].remaining_s[k] = (g->expires_us > now) ?
+                (uint32_t)((g->expires_us - now) / 1000000ULL) : 0;
+        }
+        n++;
+    }
+    restore_interrupts(irq);
+    
+    return n;
+}
+
+/**
+ * Number of unicast requests denied
+ */
+uint32_t ptp_get_grants_denied(void) {
+    return grants_denied;
+}
+
+/**
+ * Get egress latency model state (the WiFi link latency and our trim)
+ */
+void ptp_get_egress_info(ptp_egress_info_t *info) {
+    wifi_latency_info_t lat;
+    wifi_get_latency(&lat);
+    info->enabled = lat.probing;
+    info->valid = lat.valid;
+    info->latency_ns = lat.one_way_ns;
+    info->trim_ns = egress_trim_ns;
+    info->last_rtt_us = lat.rtt_last_us;
+    info->samples = lat.samples;
+}
+
+/**
+ * Enable/disable link probing for the egress model
+ */
+void ptp_set_egress_calibration(bool enable) {
+    wifi_set_latency_probe(enable);
+}
+
+/**
+ * Set manual egress asymmetry trim (added to the measured latency)
  */
-void ptp_set_sync_interval(uint32_t interval_ms) {
-    sync_interval_ms = interval_ms;
-    printf("[PTP] Sync interval set to %lu ms\n", interval_ms);
+void ptp_set_egress_trim(int32_t trim_ns) {
+    egress_trim_ns = trim_ns;
+    printf("[PTP] Egress trim set to %ld ns\n", trim_ns);
+}
+
+/**
+ * Set the multicast Sync interval to 2^log_interval seconds
+ * (PTP_SYNC_LOG_MIN to PTP_SYNC_LOG_MAX). Returns false if out of range.
+ */
+bool ptp_set_sync_log_interval(int8_t log_interval) {
+    if (log_interval < PTP_SYNC_LOG_MIN || log_interval > PTP_SYNC_LOG_MAX) {
+        return false;
+    }
+    sync_log_interval = log_interval;
+    next_sync_us = time_us_64();
+    printf("[PTP] Sync interval 2^%d s\n", log_interval);
+    return true;
+}
+
+/**
+ * Set the BMCA priorities (lower wins); decided again at once
+ */
+void ptp_set_priority(uint8_t priority1, uint8_t priority2) {
+    ptp_priority1 = priority1;
+    ptp_priority2 = priority2;
+    next_announce_us = time_us_64();
+    printf("[PTP] Priority1 %u, priority2 %u\n", priority1, priority2);
+}
+
+/**
+ * Get BMCA state and message rates
+ */
+void ptp_get_bmca_info(ptp_bmca_info_t *info) {
+    ptp_dataset_t ds;
+    local_dataset(&ds);
+    
+    info->master = bmca_master;
+    info->priority1 = ds.priority1;
+    info->priority2 = ds.priority2;
+    info->clock_class = ds.clock_class;
+    info->clock_accuracy = ds.clock_accuracy;
+    info->sync_log = sync_log_interval;
+    info->announce_log = PTP_ANNOUNCE_LOG;
+    info->role_changes = bmca_changes;
+    info->tx_pbuf_allocs = txbuf_allocs;
+}
+
+/**
+ * Copy the foreign master table. Returns the number of entries written.
+ */
+int ptp_get_foreign_masters(ptp_foreign_info_t *out, int max) {
+    int n = 0;
+    uint64_t now = time_us_64();
+    
+    /* The table is updated from the lwIP callback on this core */
+    uint32_t irq = save_and_disable_interrupts();
+    for (int i = 0; i < PTP_FOREIGN_MAX && n < max; i++) {
+        const ptp_foreign_t *f = &foreign[i];
+        if (f->addr == 0) continue;
+        
+        out[n].addr = f->addr;
+        memcpy(out[n].clock_id, f->ds.identity.id, sizeof(out[n].clock_id));
+        out[n].priority1 = f->ds.priority1;
+        out[n].clock_class = f->ds.clock_class;
+        out[n].clock_accuracy = f->ds.clock_accuracy;
+        out[n].priority2 = f->ds.priority2;
+        out[n].log_variance = f->ds.log_variance;
+        out[n].steps_removed = f->ds.steps_removed;
+        out[n].qualified = f->qualified;
+        out[n].best = (i == bmca_best);
+        out[n].age_ms = (uint32_t)((now - f->last_rx_us) / 1000ULL);
+        n++;
+    }
+    restore_interrupts(irq);
+    
+    return n;
 }
 
 /**
@@ -469,6 +1355,12 @@ void ptp_server_shutdown(void) {
         udp_remove(ptp_general_pcb);
         ptp_general_pcb = NULL;
     }
+    if (netif_default != NULL) {
+        igmp_leavegroup_netif(netif_default, ip_2_ip4(&ptp_mcast_addr));
+    }
+    txbuf_release(&tx_sync);
+    txbuf_release(&tx_followup);
+    txbuf_release(&tx_announce);
     ptp_server_running = false;
     printf("[PTP] Server stopped\n");
 }
@@ -2,7 +2,15 @@
  * CHRONOS-Rb Configurable Pulse Output with PIO Precision
  *
  * Generates precisely-timed pulses synchronized to PPS using PIO hardware.
- * Sub-microsecond jitter on pulse edges when triggered from PPS.
+ * Every pulse edge falls on a 10MHz reference edge, counted from the PPS
+ * edge or from the end of the pulse before it (pulse_interval_pio.pio).
+ *
+ * Scheduling is an event queue: a min-heap of slots keyed on when each
+ * one next needs the CPU. For a PIO slot that is when its next pulse can
+ * be handed to the state machine - during the second before it fires
+ * for a PPS-synced pulse, or once the previous pulse has started for a
+ * chained one. A CPU fallback slot is keyed on its next GPIO edge. Each
+ * placed pulse costs one heap update; slots that are not due cost nothing.
  *
  * PIO State Machine Allocation:
  *   PIO0 SM1-SM3: 3 pulse outputs (SM0 used by pps_capture)
@@ -23,7 +31,7 @@
 #include "chronos_rb.h"
 #include "pulse_output.h"
 #include "config.h"
-#include "pulse_pio.pio.h"
+#include "sched.h"
 #include "pulse_interval_pio.pio.h"
 
 /*============================================================================
@@ -39,22 +47,30 @@ typedef struct {
     uint sm;
     bool allocated;
     int slot;           /* Which pulse_config slot uses this SM */
-    bool is_interval;   /* Using interval PIO (10MHz counting) vs PPS PIO */
 } pio_sm_alloc_t;
 
 static pio_sm_alloc_t pio_allocs[MAX_PIO_OUTPUTS] = {
-    { pio0, 1, false, -1, false },  /* PIO0 SM1 */
-    { pio0, 2, false, -1, false },  /* PIO0 SM2 */
-    { pio0, 3, false, -1, false },  /* PIO0 SM3 */
-    { pio1, 2, false, -1, false },  /* PIO1 SM2 */
-    { pio1, 3, false, -1, false },  /* PIO1 SM3 */
+    { pio0, 1, false, -1 },  /* PIO0 SM1 */
+    { pio0, 2, false, -1 },  /* PIO0 SM2 */
+    { pio0, 3, false, -1 },  /* PIO0 SM3 */
+    { pio1, 2, false, -1 },  /* PIO1 SM2 */
+    { pio1, 3, false, -1 },  /* PIO1 SM3 */
 };
 
-/* PIO program offsets (loaded once) */
-static uint pulse_pio_offset = 0;
-static uint pulse_interval_pio_offset = 0;
-static bool pulse_pio_loaded = false;
-static bool pulse_interval_pio_loaded = false;
+/* Program offset in PIO0/PIO1, loaded on first use (-1 = not loaded) */
+static int pulse_pio_offset[2] = { -1, -1 };
+
+/*============================================================================
+ * EVENT QUEUE TIMING
+ *============================================================================*/
+
+#define PULSE_TICKS_PER_US  10ULL
+#define PULSE_TICKS_PER_MS  (PULSE_TICKS_PER_US * 1000)
+#define PULSE_TICKS_PER_DS  (PULSE_TICKS_PER_MS * 100)
+#define PULSE_TICKS_PER_SEC (PULSE_TICKS_PER_MS * 1000)
+
+/* A clock jump larger than this re-plans every slot */
+#define PULSE_STEP_TICKS    (3 * PULSE_TICKS_PER_SEC)
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -62,7 +78,12 @@ static bool pulse_interval_pio_loaded = false;
 
 static pulse_config_t pulse_configs[MAX_PULSE_OUTPUTS];
 static bool pulse_system_initialized = false;
-static uint32_t last_processed_pps = 0;
+
+/* Min-heap of slot numbers ordered by pulse_configs[slot].due */
+static uint8_t pulse_heap[MAX_PULSE_OUTPUTS];
+static int pulse_heap_len = 0;
+static int8_t pulse_heap_pos[MAX_PULSE_OUTPUTS];    /* -1 = not queued */
+static uint64_t pulse_last_now = 0;
 
 /*============================================================================
  * CONFIG STORAGE HELPERS
@@ -110,12 +131,11 @@ static void save_pulse_config(int slot) {
  * Allocate a PIO SM for a pulse output
  * Returns index into pio_allocs, or -1 if none available
  */
-static int allocate_pio_sm(int slot, bool need_interval) {
+static int allocate_pio_sm(int slot) {
     for (int i = 0; i < MAX_PIO_OUTPUTS; i++) {
         if (!pio_allocs[i].allocated) {
             pio_allocs[i].allocated = true;
             pio_allocs[i].slot = slot;
-            pio_allocs[i].is_interval = need_interval;
             return i;
         }
     }
@@ -128,8 +148,11 @@ static int allocate_pio_sm(int slot, bool need_interval) {
 static void free_pio_sm(int slot) {
     for (int i = 0; i < MAX_PIO_OUTPUTS; i++) {
         if (pio_allocs[i].allocated && pio_allocs[i].slot == slot) {
-            /* Stop and reset the SM */
+            /* Stop the SM, drop queued pulses and leave the pin low */
             pio_sm_set_enabled(pio_allocs[i].pio, pio_allocs[i].sm, false);
+            pio_sm_clear_fifos(pio_allocs[i].pio, pio_allocs[i].sm);
+            pio_sm_set_pins_with_mask(pio_allocs[i].pio, pio_allocs[i].sm, 0,
+                                      1u << pulse_configs[slot].gpio_pin);
             pio_allocs[i].allocated = false;
             pio_allocs[i].slot = -1;
             break;
@@ -149,67 +172,78 @@ static pio_sm_alloc_t* get_pio_alloc(int slot) {
     return NULL;
 }
 
+/**
+ * Drive a slot's pin from the CPU
+ */
+static void init_pulse_cpu(pulse_config_t *cfg) {
+    cfg->pio_index = -1;
+    gpio_init(cfg->gpio_pin);
+    gpio_set_dir(cfg->gpio_pin, GPIO_OUT);
+    gpio_put(cfg->gpio_pin, 0);
+}
+
 /**
  * Initialize PIO for a pulse output
  */
 static bool init_pulse_pio(int slot) {
     pulse_config_t *cfg = &pulse_configs[slot];
 
-    /* Determine if we need interval PIO (sub-second) or PPS PIO */
-    bool need_interval = (cfg->mode == PULSE_MODE_INTERVAL && cfg->interval_ds < 10);
-
     /* Allocate SM */
-    int alloc_idx = allocate_pio_sm(slot, need_interval);
+    int alloc_idx = allocate_pio_sm(slot);
     if (alloc_idx < 0) {
         printf("[PULSE] No PIO SM available for GPIO %d, using CPU fallback\n", cfg->gpio_pin);
-        cfg->pio_index = -1;
+        init_pulse_cpu(cfg);
         return false;
     }
 
     pio_sm_alloc_t *alloc = &pio_allocs[alloc_idx];
-    cfg->pio_index = alloc_idx;
-
-    /* Load PIO program if not already loaded */
-    if (need_interval) {
-        if (!pulse_interval_pio_loaded) {
-            pulse_interval_pio_offset = pio_add_program(alloc->pio, &pulse_interval_pio_program);
-            pulse_interval_pio_loaded = true;
+    int pio_num = pio_get_index(alloc->pio);
+
+    /* Load PIO program if not already loaded in this block */
+    if (pulse_pio_offset[pio_num] < 0) {
+        if (!pio_can_add_program(alloc->pio, &pulse_interval_pio_program)) {
+            printf("[PULSE] No PIO%d instruction space for GPIO %d, using CPU fallback\n",
+                   pio_num, cfg->gpio_pin);
+            alloc->allocated = false;
+            alloc->slot = -1;
+            init_pulse_cpu(cfg);
+            return false;
         }
-        /* Get active PPS pin */
-        uint pps_pin = GPIO_PPS_INPUT;  /* Use Rb PPS as trigger sync */
-        pulse_interval_pio_program_init(alloc->pio, alloc->sm, pulse_interval_pio_offset,
-                                         GPIO_10MHZ_INPUT, pps_pin, cfg->gpio_pin);
-    } else {
-        if (!pulse_pio_loaded) {
-            pulse_pio_offset = pio_add_program(alloc->pio, &pulse_pio_program);
-            pulse_pio_loaded = true;
-        }
-        pulse_pio_program_init(alloc->pio, alloc->sm, pulse_pio_offset,
-                               GPIO_PPS_INPUT, cfg->gpio_pin);
+        pulse_pio_offset[pio_num] = (int)pio_add_program(alloc->pio, &pulse_interval_pio_program);
     }
+    cfg->pio_index = alloc_idx;
+
+    /* Rb PPS is the sync edge, the 10MHz reference times every edge */
+    pulse_interval_pio_program_init(alloc->pio, alloc->sm, (uint)pulse_pio_offset[pio_num],
+                                    GPIO_10MHZ_INPUT, GPIO_PPS_INPUT, cfg->gpio_pin);
 
     /* Enable the SM */
     pio_sm_set_enabled(alloc->pio, alloc->sm, true);
 
-    printf("[PULSE] GPIO %d using PIO%d SM%d (%s)\n",
-           cfg->gpio_pin, alloc->pio == pio0 ? 0 : 1, alloc->sm,
-           need_interval ? "10MHz interval" : "PPS sync");
+    printf("[PULSE] GPIO %d using PIO%d SM%d\n", cfg->gpio_pin, pio_num, alloc->sm);
 
     return true;
 }
 
 /**
- * Load pulse configs from flash and initialize PIO
+ * Load pulse configs from flash and initialize PIO. Configs saved by a
+ * build without the pin reservations (see pulse_output_pin_allowed())
+ * are left off.
  */
 static void load_pulse_configs(void) {
     pulse_config_stored_t *stored = config_get_pulse_configs();
     int loaded = 0;
 
     for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
+        if (stored[i].active && !pulse_output_pin_allowed(stored[i].gpio_pin)) {
+            printf("[PULSE] Skipping saved output on reserved GP%d\n", stored[i].gpio_pin);
+            continue;
+        }
         if (stored[i].active) {
             stored_to_config(&stored[i], &pulse_configs[i]);
 
-            /* Initialize PIO for this output */
+            /* Initialize PIO for this output; the task plans its
+             * first pulse once the clock is read */
             init_pulse_pio(i);
             loaded++;
         }
@@ -224,6 +258,24 @@ static void load_pulse_configs(void) {
  * HELPER FUNCTIONS
  *============================================================================*/
 
+bool pulse_output_pin_allowed(uint8_t gpio_pin) {
+    if (gpio_pin > PULSE_GPIO_MAX) {
+        return false;
+    }
+#if CHRONOS_ETH_W5500
+    /* The W5500 bus: re-muxing any of these drops the wired time link */
+    switch (gpio_pin) {
+        case GPIO_ETH_MISO:
+        case GPIO_ETH_CS:
+        case GPIO_ETH_SCK:
+        case GPIO_ETH_MOSI:
+        case GPIO_ETH_INT:
+            return false;
+    }
+#endif
+    return true;
+}
+
 static int find_slot(uint8_t gpio_pin, bool find_empty) {
     int empty_slot = -1;
 
@@ -239,116 +291,242 @@ static int find_slot(uint8_t gpio_pin, bool find_empty) {
     return find_empty ? empty_slot : -1;
 }
 
-static void get_time_components(uint32_t pps_count, uint8_t *second,
-                                 uint8_t *minute, uint8_t *hour) {
+/**
+ * Current time in 10MHz ticks since the NTP epoch
+ */
+static uint64_t pulse_now_ticks(void) {
     timestamp_t ts = get_current_time();
-    uint32_t seconds_today = ts.seconds % 86400;
-
-    *hour = (seconds_today / 3600) % 24;
-    *minute = (seconds_today / 60) % 60;
-    *second = seconds_today % 60;
+    return (uint64_t)ts.seconds * PULSE_TICKS_PER_SEC +
+           (((uint64_t)ts.fraction * PULSE_TICKS_PER_SEC) >> 32);
 }
 
 /**
- * Queue a pulse to PIO (fires on next PPS edge)
+ * First trigger of a slot's schedule strictly after a given time
  */
-static void queue_pio_pulse(int slot) {
-    pulse_config_t *cfg = &pulse_configs[slot];
-    pio_sm_alloc_t *alloc = get_pio_alloc(slot);
+static uint64_t next_trigger(const pulse_config_t *cfg, uint64_t after) {
+    uint64_t period, offset;
 
-    if (!alloc) {
-        /* CPU fallback - just set GPIO high briefly */
-        gpio_put(cfg->gpio_pin, 1);
-        cfg->pulse_off_time = time_us_32() + (cfg->pulse_width_ms * 1000);
-        return;
+    switch (cfg->mode) {
+        case PULSE_MODE_INTERVAL:
+            period = cfg->interval_ds * PULSE_TICKS_PER_DS;
+            offset = 0;
+            break;
+        case PULSE_MODE_SECOND:
+            period = 60 * PULSE_TICKS_PER_SEC;
+            offset = cfg->trigger_second * PULSE_TICKS_PER_SEC;
+            break;
+        case PULSE_MODE_MINUTE:
+            period = 3600 * PULSE_TICKS_PER_SEC;
+            offset = cfg->trigger_minute * 60 * PULSE_TICKS_PER_SEC;
+            break;
+        case PULSE_MODE_TIME:
+        default:
+            period = 86400 * PULSE_TICKS_PER_SEC;
+            offset = (cfg->trigger_hour * 3600 + cfg->trigger_minute * 60) *
+                     PULSE_TICKS_PER_SEC;
+            break;
     }
 
-    /* Convert pulse width to microseconds */
-    uint32_t width_us = cfg->pulse_width_ms * 1000;
+    if (after < offset) {
+        return offset;
+    }
+    return ((after - offset) / period + 1) * period + offset;
+}
 
-    if (alloc->is_interval) {
-        /* Sub-second interval: queue with 10MHz count */
-        /* For now, sync to PPS (count=0) - will be enhanced later */
-        pulse_interval_pio_queue(alloc->pio, alloc->sm, 0, width_us);
+/**
+ * Step next_fire to the following pulse of the burst, or the next trigger
+ */
+static void pulse_advance(pulse_config_t *cfg) {
+    cfg->burst_index++;
+    if (cfg->burst_index < cfg->pulse_count) {
+        cfg->next_fire += (uint64_t)(cfg->pulse_width_ms + cfg->pulse_gap_ms) * PULSE_TICKS_PER_MS;
     } else {
-        /* PPS-sync: just queue the width, PIO waits for PPS */
-        pulse_pio_queue(alloc->pio, alloc->sm, width_us);
+        /* A burst that overruns the next trigger skips it */
+        cfg->burst_index = 0;
+        cfg->next_fire = next_trigger(cfg, cfg->next_fire);
     }
 }
 
+static inline uint64_t second_start(uint64_t ticks) {
+    return ticks - ticks % PULSE_TICKS_PER_SEC;
+}
+
 /**
- * Queue interval pulse with 10MHz offset
- * offset_ds: deciseconds from PPS (0-9)
+ * When next_fire can be handed to the SM. A pulse in the same second as
+ * the end of the one before chains onto it; that needs the FIFO free, so
+ * wait until the previous pulse has started. Any other pulse syncs to
+ * the PPS edge of its second and is loaded in the second before it.
  */
-static void queue_interval_pulse(int slot, uint8_t offset_ds) {
-    pulse_config_t *cfg = &pulse_configs[slot];
-    pio_sm_alloc_t *alloc = get_pio_alloc(slot);
+static uint64_t pulse_pio_due(const pulse_config_t *cfg) {
+    uint64_t sec = second_start(cfg->next_fire);
 
-    if (!alloc) {
-        /* CPU fallback */
-        gpio_put(cfg->gpio_pin, 1);
-        cfg->pulse_off_time = time_us_32() + (cfg->pulse_width_ms * 1000);
-        return;
+    if (cfg->queued_end >= sec || sec < PULSE_TICKS_PER_SEC) {
+        return cfg->queued_start;
     }
 
-    uint32_t width_us = cfg->pulse_width_ms * 1000;
+    uint64_t due = sec - PULSE_TICKS_PER_SEC;
+    return due > cfg->queued_start ? due : cfg->queued_start;
+}
 
-    if (alloc->is_interval) {
-        /* Calculate 10MHz count: offset_ds * 1,000,000 edges */
-        uint32_t count = offset_ds * 1000000;
-        pulse_interval_pio_queue(alloc->pio, alloc->sm, count, width_us);
-    } else {
-        /* Using PPS PIO - queue for next edge */
-        pulse_pio_queue(alloc->pio, alloc->sm, width_us);
+/*============================================================================
+ * EVENT QUEUE
+ *============================================================================*/
+
+static void heap_swap(int a, int b) {
+    uint8_t t = pulse_heap[a];
+    pulse_heap[a] = pulse_heap[b];
+    pulse_heap[b] = t;
+    pulse_heap_pos[pulse_heap[a]] = (int8_t)a;
+    pulse_heap_pos[pulse_heap[b]] = (int8_t)b;
+}
+
+static inline bool heap_less(int a, int b) {
+    return pulse_configs[pulse_heap[a]].due < pulse_configs[pulse_heap[b]].due;
+}
+
+static void heap_sift_up(int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!heap_less(i, parent)) break;
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(int i) {
+    for (;;) {
+        int least = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < pulse_heap_len && heap_less(l, least)) least = l;
+        if (r < pulse_heap_len && heap_less(r, least)) least = r;
+        if (least == i) break;
+        heap_swap(i, least);
+        i = least;
+    }
+}
+
+static void heap_remove(int slot) {
+    int i = pulse_heap_pos[slot];
+    if (i < 0) {
+        return;
+    }
+
+    pulse_heap_pos[slot] = -1;
+    pulse_heap_len--;
+    if (i != pulse_heap_len) {
+        pulse_heap[i] = pulse_heap[pulse_heap_len];
+        pulse_heap_pos[pulse_heap[i]] = (int8_t)i;
+        heap_sift_up(i);
+        heap_sift_down(i);
     }
 }
 
 /**
- * Start a pulse burst (for multi-pulse bursts, handled by CPU timing between pulses)
+ * Plan a slot's first pulse, from the second after now, and queue it
  */
-static void start_burst(pulse_config_t *cfg, int slot) {
-    /* Fire first pulse via PIO */
-    queue_pio_pulse(slot);
-
-    /* Set up remaining pulses in burst (CPU-timed gaps) */
-    if (cfg->pulse_count > 1) {
-        cfg->burst_remaining = cfg->pulse_count - 1;
-        cfg->next_pulse_time = time_us_32() + (cfg->pulse_width_ms * 1000) + (cfg->pulse_gap_ms * 1000);
-    } else {
-        cfg->burst_remaining = 0;
-        cfg->next_pulse_time = 0;
-    }
+static void pulse_schedule(int slot, uint64_t now) {
+    pulse_config_t *cfg = &pulse_configs[slot];
+
+    heap_remove(slot);
+
+    cfg->next_fire = next_trigger(cfg, second_start(now) + PULSE_TICKS_PER_SEC - 1);
+    cfg->burst_index = 0;
+    cfg->queued_start = 0;
+    cfg->queued_end = 0;
+    cfg->cpu_high = false;
+    cfg->due = (cfg->pio_index >= 0) ? pulse_pio_due(cfg) : cfg->next_fire;
+
+    int i = pulse_heap_len++;
+    pulse_heap[i] = (uint8_t)slot;
+    pulse_heap_pos[slot] = (int8_t)i;
+    heap_sift_up(i);
 }
 
 /**
- * Continue a pulse burst
+ * Take a slot off the queue and release its outputs
  */
-static void continue_burst(pulse_config_t *cfg, int slot) {
-    /* Fire next pulse via PIO (immediate, not PPS-synced) */
-    pio_sm_alloc_t *alloc = get_pio_alloc(slot);
-
-    if (alloc) {
-        uint32_t width_us = cfg->pulse_width_ms * 1000;
-        if (alloc->is_interval) {
-            /* Fire immediately (count=1 for minimal delay) */
-            pulse_interval_pio_queue(alloc->pio, alloc->sm, 1, width_us);
+static void pulse_stop(int slot) {
+    heap_remove(slot);
+    free_pio_sm(slot);
+}
+
+/**
+ * Re-plan every slot after the clock jumped; queued pulses are stale
+ */
+static void pulse_reschedule_all(uint64_t now) {
+    for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
+        pulse_config_t *cfg = &pulse_configs[i];
+        if (!cfg->active) {
+            continue;
+        }
+
+        pio_sm_alloc_t *alloc = get_pio_alloc(i);
+        if (alloc) {
+            pio_sm_set_enabled(alloc->pio, alloc->sm, false);
+            pio_sm_clear_fifos(alloc->pio, alloc->sm);
+            pio_sm_restart(alloc->pio, alloc->sm);
+            pio_sm_exec(alloc->pio, alloc->sm,
+                        pio_encode_jmp((uint)pulse_pio_offset[pio_get_index(alloc->pio)]));
+            pio_sm_set_pins_with_mask(alloc->pio, alloc->sm, 0, 1u << cfg->gpio_pin);
+            pio_sm_set_enabled(alloc->pio, alloc->sm, true);
         } else {
-            /* For PPS PIO, we need to use CPU for burst continuation */
-            gpio_put(cfg->gpio_pin, 1);
-            cfg->pulse_off_time = time_us_32() + (cfg->pulse_width_ms * 1000);
+            gpio_put(cfg->gpio_pin, 0);
         }
+        pulse_schedule(i, now);
+    }
+}
+
+/**
+ * Hand next_fire to the SM if it can still be placed exactly, else
+ * drop it. A synced pulse must be queued before its second starts; a
+ * chained one before the pulse it counts from has ended.
+ */
+static void pulse_service_pio(pulse_config_t *cfg, pio_sm_alloc_t *alloc, uint64_t now) {
+    uint64_t sec = second_start(cfg->next_fire);
+    bool sync = cfg->queued_end < sec;
+    bool placeable = cfg->next_fire >= cfg->queued_end &&
+                     (sync ? now < sec : now < cfg->queued_end);
+
+    if (placeable) {
+        uint64_t width = (uint64_t)cfg->pulse_width_ms * PULSE_TICKS_PER_MS;
+        uint64_t delay = cfg->next_fire - (sync ? sec : cfg->queued_end);
+
+        pulse_interval_pio_queue(alloc->pio, alloc->sm, sync, (uint32_t)delay, (uint32_t)width);
+        cfg->queued_start = cfg->next_fire;
+        cfg->queued_end = cfg->next_fire + width;
     } else {
-        gpio_put(cfg->gpio_pin, 1);
-        cfg->pulse_off_time = time_us_32() + (cfg->pulse_width_ms * 1000);
+        cfg->missed++;
     }
 
-    cfg->burst_remaining--;
+    pulse_advance(cfg);
+    cfg->due = pulse_pio_due(cfg);
+}
 
-    if (cfg->burst_remaining > 0) {
-        cfg->next_pulse_time = time_us_32() + (cfg->pulse_width_ms * 1000) + (cfg->pulse_gap_ms * 1000);
-    } else {
-        cfg->next_pulse_time = 0;
+/**
+ * CPU fallback: drive the next edge, skipping pulses that are already over
+ */
+static void pulse_service_cpu(pulse_config_t *cfg, uint64_t now) {
+    uint64_t width = (uint64_t)cfg->pulse_width_ms * PULSE_TICKS_PER_MS;
+
+    if (cfg->cpu_high) {
+        gpio_put(cfg->gpio_pin, 0);
+        cfg->cpu_high = false;
+        pulse_advance(cfg);
+        cfg->due = cfg->next_fire;
+        return;
+    }
+
+    if (cfg->next_fire + width <= now) {
+        cfg->missed++;
+        pulse_advance(cfg);
+        cfg->due = cfg->next_fire;
+        return;
     }
+
+    gpio_put(cfg->gpio_pin, 1);
+    cfg->cpu_high = true;
+    cfg->due = cfg->next_fire + width;
 }
 
 /*============================================================================
@@ -364,6 +542,12 @@ void pulse_output_init(void) {
         pio_allocs[i].slot = -1;
     }
 
+    pulse_heap_len = 0;
+    for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
+        pulse_heap_pos[i] = -1;
+    }
+    pulse_last_now = 0;
+
     pulse_system_initialized = true;
 
     /* Load saved configurations from flash */
@@ -377,121 +561,40 @@ void pulse_output_task(void) {
         return;
     }
 
-    uint32_t now = time_us_32();
-    uint32_t pps_count = g_time_state.pps_count;
+    uint64_t now = pulse_now_ticks();
 
-    /* Detect new PPS edge */
-    bool new_pps = (pps_count != last_processed_pps);
-    if (new_pps) {
-        last_processed_pps = pps_count;
+    /* Startup, or the clock was set: plan from the new time */
+    if (now + PULSE_STEP_TICKS < pulse_last_now || now > pulse_last_now + PULSE_STEP_TICKS) {
+        pulse_reschedule_all(now);
     }
+    pulse_last_now = now;
 
-    /* Get current time components */
-    uint8_t cur_second, cur_minute, cur_hour;
-    get_time_components(pps_count, &cur_second, &cur_minute, &cur_hour);
-
-    for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
-        pulse_config_t *cfg = &pulse_configs[i];
-
-        if (!cfg->active) {
-            continue;
-        }
+    while (pulse_heap_len > 0) {
+        int slot = pulse_heap[0];
+        pulse_config_t *cfg = &pulse_configs[slot];
 
-        /* Handle CPU fallback pulse off timing */
-        if (cfg->pulse_off_time != 0 && now >= cfg->pulse_off_time) {
-            gpio_put(cfg->gpio_pin, 0);
-            cfg->pulse_off_time = 0;
-        }
-
-        /* Handle next pulse in burst */
-        if (cfg->next_pulse_time != 0 && now >= cfg->next_pulse_time &&
-            cfg->pulse_off_time == 0) {
-            continue_burst(cfg, i);
+        if (cfg->due > now) {
+            break;
         }
 
-        /* Skip if currently in a burst */
-        if (cfg->burst_remaining > 0 || cfg->pulse_off_time != 0) {
-            continue;
+        pio_sm_alloc_t *alloc = get_pio_alloc(slot);
+        if (alloc) {
+            pulse_service_pio(cfg, alloc, now);
+        } else {
+            pulse_service_cpu(cfg, now);
         }
+        heap_sift_down(0);
+    }
 
-        switch (cfg->mode) {
-            case PULSE_MODE_INTERVAL: {
-                /* Fire every N deciseconds (0.1s) */
-                if (pps_count == 0) break;
-
-                /* For intervals >= 1s, trigger on PPS edge */
-                if (cfg->interval_ds >= 10) {
-                    /* Check if this PPS should trigger */
-                    uint32_t interval_sec = cfg->interval_ds / 10;
-                    if (new_pps && (pps_count % interval_sec) == 0) {
-                        /* Avoid double-trigger */
-                        if (pps_count != cfg->last_trigger_pps) {
-                            start_burst(cfg, i);
-                            cfg->last_trigger_pps = pps_count;
-                        }
-                    }
-                } else {
-                    /* Sub-second interval - use 10MHz counting */
-                    uint64_t last_pps = get_active_pps_timestamp();
-                    if (last_pps == 0) break;
-
-                    uint32_t us_since_pps = (uint32_t)((now > last_pps) ? (now - last_pps) : 0);
-                    if (us_since_pps > 1000000) us_since_pps = 0;
-                    uint8_t cur_ds = us_since_pps / 100000;
-
-                    uint32_t total_ds = pps_count * 10 + cur_ds;
-
-                    if ((total_ds % cfg->interval_ds) == 0) {
-                        if (pps_count != cfg->last_trigger_pps || cur_ds != cfg->last_trigger_ds) {
-                            /* Queue with 10MHz offset for precise timing */
-                            queue_interval_pulse(i, cur_ds);
-                            cfg->last_trigger_pps = pps_count;
-                            cfg->last_trigger_ds = cur_ds;
-                        }
-                    }
-                }
-                break;
-            }
-
-            case PULSE_MODE_SECOND:
-                if (cur_second == cfg->trigger_second) {
-                    if (!cfg->triggered_this_period && new_pps) {
-                        start_burst(cfg, i);
-                        cfg->triggered_this_period = true;
-                    }
-                } else {
-                    cfg->triggered_this_period = false;
-                }
-                break;
-
-            case PULSE_MODE_MINUTE:
-                if (cur_minute == cfg->trigger_minute && cur_second == 0) {
-                    if (!cfg->triggered_this_period && new_pps) {
-                        start_burst(cfg, i);
-                        cfg->triggered_this_period = true;
-                    }
-                } else if (cur_second != 0) {
-                    cfg->triggered_this_period = false;
-                }
-                break;
-
-            case PULSE_MODE_TIME:
-                if (cur_hour == cfg->trigger_hour &&
-                    cur_minute == cfg->trigger_minute &&
-                    cur_second == 0) {
-                    if (!cfg->triggered_this_period && new_pps) {
-                        start_burst(cfg, i);
-                        cfg->triggered_this_period = true;
-                    }
-                } else if (cur_second != 0) {
-                    cfg->triggered_this_period = false;
-                }
-                break;
-
-            default:
-                break;
+    /* Come back for the next due slot; PPS covers anything later */
+    uint64_t wait = PULSE_TICKS_PER_SEC;
+    if (pulse_heap_len > 0) {
+        uint64_t due = pulse_configs[pulse_heap[0]].due;
+        if (due - now < wait) {
+            wait = due - now;
         }
     }
+    sched_wake_in((uint32_t)((wait + PULSE_TICKS_PER_US - 1) / PULSE_TICKS_PER_US));
 }
 
 int pulse_output_set_interval(uint8_t gpio_pin, uint16_t interval_ds,
@@ -501,6 +604,11 @@ int pulse_output_set_interval(uint8_t gpio_pin, uint16_t interval_ds,
         return -1;
     }
 
+    if (!pulse_output_pin_allowed(gpio_pin)) {
+        printf("Error: GP%d cannot be a pulse output\n", gpio_pin);
+        return -1;
+    }
+
     int slot = find_slot(gpio_pin, true);
     if (slot < 0) {
         printf("Error: No free pulse slots\n");
@@ -508,7 +616,7 @@ int pulse_output_set_interval(uint8_t gpio_pin, uint16_t interval_ds,
     }
 
     /* Free any existing PIO allocation */
-    free_pio_sm(slot);
+    pulse_stop(slot);
 
     pulse_config_t *cfg = &pulse_configs[slot];
     memset(cfg, 0, sizeof(pulse_config_t));
@@ -523,6 +631,7 @@ int pulse_output_set_interval(uint8_t gpio_pin, uint16_t interval_ds,
 
     /* Initialize PIO */
     init_pulse_pio(slot);
+    pulse_schedule(slot, pulse_now_ticks());
 
     printf("[PULSE] GPIO %d: interval %u.%u sec, width %u ms (PIO)\n",
            gpio_pin, interval_ds / 10, interval_ds % 10, pulse_width_ms);
@@ -543,13 +652,18 @@ int pulse_output_set_second(uint8_t gpio_pin, uint8_t second,
         return -1;
     }
 
+    if (!pulse_output_pin_allowed(gpio_pin)) {
+        printf("Error: GP%d cannot be a pulse output\n", gpio_pin);
+        return -1;
+    }
+
     int slot = find_slot(gpio_pin, true);
     if (slot < 0) {
         printf("Error: No free pulse slots\n");
         return -1;
     }
 
-    free_pio_sm(slot);
+    pulse_stop(slot);
 
     pulse_config_t *cfg = &pulse_configs[slot];
     memset(cfg, 0, sizeof(pulse_config_t));
@@ -563,6 +677,7 @@ int pulse_output_set_second(uint8_t gpio_pin, uint8_t second,
     cfg->active = true;
 
     init_pulse_pio(slot);
+    pulse_schedule(slot, pulse_now_ticks());
 
     printf("[PULSE] GPIO %d: on second %u, %u ms pulse x%u (gap %u ms) (PIO)\n",
            gpio_pin, second, pulse_width_ms, count, gap_ms);
@@ -583,13 +698,18 @@ int pulse_output_set_minute(uint8_t gpio_pin, uint8_t minute,
         return -1;
     }
 
+    if (!pulse_output_pin_allowed(gpio_pin)) {
+        printf("Error: GP%d cannot be a pulse output\n", gpio_pin);
+        return -1;
+    }
+
     int slot = find_slot(gpio_pin, true);
     if (slot < 0) {
         printf("Error: No free pulse slots\n");
         return -1;
     }
 
-    free_pio_sm(slot);
+    pulse_stop(slot);
 
     pulse_config_t *cfg = &pulse_configs[slot];
     memset(cfg, 0, sizeof(pulse_config_t));
@@ -603,6 +723,7 @@ int pulse_output_set_minute(uint8_t gpio_pin, uint8_t minute,
     cfg->active = true;
 
     init_pulse_pio(slot);
+    pulse_schedule(slot, pulse_now_ticks());
 
     printf("[PULSE] GPIO %d: on minute %u, %u ms pulse x%u (gap %u ms) (PIO)\n",
            gpio_pin, minute, pulse_width_ms, count, gap_ms);
@@ -627,13 +748,18 @@ int pulse_output_set_time(uint8_t gpio_pin, uint8_t hour, uint8_t minute,
         return -1;
     }
 
+    if (!pulse_output_pin_allowed(gpio_pin)) {
+        printf("Error: GP%d cannot be a pulse output\n", gpio_pin);
+        return -1;
+    }
+
     int slot = find_slot(gpio_pin, true);
     if (slot < 0) {
         printf("Error: No free pulse slots\n");
         return -1;
     }
 
-    free_pio_sm(slot);
+    pulse_stop(slot);
 
     pulse_config_t *cfg = &pulse_configs[slot];
     memset(cfg, 0, sizeof(pulse_config_t));
@@ -648,6 +774,7 @@ int pulse_output_set_time(uint8_t gpio_pin, uint8_t hour, uint8_t minute,
     cfg->active = true;
 
     init_pulse_pio(slot);
+    pulse_schedule(slot, pulse_now_ticks());
 
     printf("[PULSE] GPIO %d: at %02u:%02u, %u ms pulse x%u (gap %u ms) (PIO)\n",
            gpio_pin, hour, minute, pulse_width_ms, count, gap_ms);
@@ -664,7 +791,7 @@ bool pulse_output_disable(uint8_t gpio_pin) {
     }
 
     /* Free PIO SM */
-    free_pio_sm(slot);
+    pulse_stop(slot);
 
     gpio_put(gpio_pin, 0);
     pulse_configs[slot].active = false;
@@ -721,8 +848,12 @@ void pulse_output_list(void) {
             printf(" [CPU]");
         }
 
-        if (cfg->burst_remaining > 0) {
-            printf(" [burst: %u remaining]", cfg->burst_remaining);
+        if (cfg->burst_index > 0) {
+            printf(" [burst: %u remaining]", cfg->pulse_count - cfg->burst_index);
+        }
+
+        if (cfg->missed > 0) {
+            printf(" [missed: %lu]", (unsigned long)cfg->missed);
         }
 
         printf("\n");
@@ -744,7 +875,7 @@ pulse_config_t* pulse_output_get(int index) {
 void pulse_output_clear_all(void) {
     for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
         if (pulse_configs[i].active) {
-            free_pio_sm(i);
+            pulse_stop(i);
             gpio_put(pulse_configs[i].gpio_pin, 0);
         }
     }
@@ -15,10 +15,19 @@
  * short-range (<1m) inductive coupling only.
  *
  * Signal encoding:
- *   - Carrier is generated using PWM
+ *   - Carrier is generated using PWM (DCF77: PIO, see below)
  *   - Amplitude modulation via PWM duty cycle
  *   - Time data encoded in pulse width per bit
  *
+ * Keying is hardware timed; the CPU only schedules it once per second:
+ *   - DCF77 runs on the reference-locked waveform engine (ref_wave.c,
+ *     PIO2 SM2). Every carrier cycle is a DMA-fed high/low pair in 10MHz
+ *     ticks, each second starts on the PPS edge, and the pseudo-random
+ *     phase modulation is sent as single-cycle phase steps.
+ *   - WWVB and JJY keep their PWM carriers. Each second's level changes
+ *     are a DMA timeline (set level, wait N ticks of a DMA pacing timer)
+ *     started from the PPS interrupt.
+ *
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
  */
@@ -27,11 +36,12 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
-#include "hardware/timer.h"
-#include "hardware/irq.h"
+#include "hardware/dma.h"
 
 #include "chronos_rb.h"
 #include "radio_timecode.h"
+#include "calendar.h"
+#include "ref_wave.h"
 
 /*============================================================================
  * GPIO ASSIGNMENTS
@@ -55,7 +65,6 @@
 #define JJY60_FREQ_HZ   60000
 
 /* PWM wrap values for each frequency (SYS_CLK / freq - 1) */
-#define DCF77_WRAP      (SYS_CLK_HZ / DCF77_FREQ_HZ - 1)     /* 1935 */
 #define WWVB_WRAP       (SYS_CLK_HZ / WWVB_FREQ_HZ - 1)      /* 2499 */
 #define JJY40_WRAP      (SYS_CLK_HZ / JJY40_FREQ_HZ - 1)     /* 3749 */
 #define JJY60_WRAP      (SYS_CLK_HZ / JJY60_FREQ_HZ - 1)     /* 2499 */
@@ -64,8 +73,8 @@
 #define LEVEL_FULL      100     /* Full carrier (100% duty) */
 #define LEVEL_REDUCED   15      /* Reduced carrier for marks (~-17dB) */
 
-/* NTP epoch offset */
-#define NTP_UNIX_OFFSET 2208988800UL
+/* DCF77 announces a leap second through the hour before it */
+#define DCF77_LEAP_WARN_S   3600
 
 /*============================================================================
  * TIME CODE BIT DEFINITIONS
@@ -82,26 +91,48 @@
 #define JJY_MARKER_MS   200     /* Marker: 200ms full (800ms reduced) */
 
 /*============================================================================
- * STATE MACHINE
+ * DCF77 CARRIER AND PHASE MODULATION
+ *============================================================================*/
+
+#define DCF77_SM            2       /* PIO2 SM2 (SM1 is IRIG-B) */
+#define DCF77_TICKS_PER_S   (REF_WAVE_TICKS_PER_US * 1000000)
+#define DCF77_CYCLES_MS(ms) ((ms) * DCF77_FREQ_HZ / 1000)
+#define DCF77_SYNC_CYCLES   ((REF_WAVE_SYNC_US * DCF77_FREQ_HZ + 999999) / 1000000)
+
+/* Phase modulation: 512 chips of 120 carrier cycles from 200ms, phase
+ * +/-15.6 degrees (5.6 ticks of a 129-tick cycle, rounded to 6) */
+#define DCF77_PM_START_MS   200
+#define DCF77_PM_CHIPS      512
+#define DCF77_PM_CHIP_CYCLES 120
+#define DCF77_PM_RUNS       256     /* Runs of equal chips in the sequence */
+#define DCF77_PM_DEV_TICKS  6
+
+/* Worst case list: reduced + full, step + run per PM run, exit step,
+ * tail, sync, jump */
+#define DCF77_BLOCKS        (2 * DCF77_PM_RUNS + 6)
+
+/*============================================================================
+ * PWM KEYING TIMELINE
  *============================================================================*/
 
-typedef enum {
-    RADIO_STATE_IDLE,
-    RADIO_STATE_MINUTE_START,
-    RADIO_STATE_SENDING_BIT,
-    RADIO_STATE_BIT_COMPLETE
-} radio_state_t;
+#define KEY_TICK_HZ         100000  /* DMA pacing timer, 10us per wait tick */
+#define KEY_CHANNELS        3       /* WWVB, JJY40, JJY60 */
+#define KEY_BLOCKS          (KEY_CHANNELS * 2 * 2 + 1)  /* Wait + set per edge, stop */
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
 
 typedef struct {
     bool enabled;
     uint gpio;
     uint slice;
     uint16_t wrap;
-    radio_state_t state;
-    uint8_t current_bit;        /* Current bit position (0-59) */
-    uint8_t bits[60];           /* Encoded bits for this minute */
-    uint32_t bit_start_ms;      /* When current bit started */
-    uint16_t reduce_duration;   /* How long to reduce carrier (ms) */
+    uint32_t cc_full;           /* Slice CC words read by the keying DMA */
+    uint32_t cc_reduced;
+    void (*encode)(uint8_t *bits, const calendar_t *c);
+    uint32_t minute;            /* Minute bits[] holds */
+    uint8_t bits[60];           /* Encoded bits for that minute */
 } radio_channel_t;
 
 static radio_channel_t dcf77 = {0};
@@ -109,57 +140,47 @@ static radio_channel_t wwvb = {0};
 static radio_channel_t jjy40 = {0};
 static radio_channel_t jjy60 = {0};
 
-static uint32_t last_second = 0;
-static uint32_t last_minute = 0;
+/* DCF77 waveform: one carrier period per table pair, REF_WAVE_RING_WORDS
+ * words at a time (periods of 129/130 ticks average out to 77.5kHz) */
+static ref_wave_t dcf77_wave;
+static ref_wave_block_t dcf77_lists[2 * DCF77_BLOCKS];
+static bool dcf77_ready = false;
+static bool dcf77_pm = true;
+static uint32_t dcf77_full[REF_WAVE_RING_WORDS] __attribute__((aligned(REF_WAVE_RING_ALIGN)));
+static uint32_t dcf77_reduced[REF_WAVE_RING_WORDS] __attribute__((aligned(REF_WAVE_RING_ALIGN)));
+static uint32_t dcf77_step[5][2];   /* Cycle moving the phase by (i - 2) * DEV */
+static uint8_t dcf77_pm_runs[DCF77_PM_RUNS];
+static uint8_t dcf77_pm_first;      /* First chip of the sequence */
+
+/* PWM keying: one timeline per second, double buffered */
+typedef struct {
+    uint32_t ctrl;
+    const void *read;
+    volatile void *write;
+    uint32_t count;
+} key_block_t;
+
+typedef struct {
+    uint32_t tick;
+    radio_channel_t *ch;
+    const uint32_t *cc;
+} key_edge_t;
+
+static key_block_t key_list[2][KEY_BLOCKS];
+static volatile int key_pending = -1;   /* List the next PPS starts */
+static int key_next = 0;                /* List to build next */
+static uint32_t key_built = 0;          /* Second of the pending list */
+static int key_ctrl_chan = -1;
+static int key_data_chan = -1;
+static uint32_t key_ctrl_set;
+static uint32_t key_ctrl_wait;
+static const uint32_t key_zero = 0;
+static uint32_t key_sink;               /* Wait blocks write here */
 
 /*============================================================================
- * TIME CONVERSION HELPERS
+ * ENCODING HELPERS
  *============================================================================*/
 
-/**
- * Convert NTP timestamp to broken-down UTC time
- */
-static void ntp_to_utc(uint32_t ntp_secs, int *year, int *month, int *day,
-                       int *hour, int *min, int *sec, int *wday, int *yday) {
-    uint32_t unix_time = ntp_secs - NTP_UNIX_OFFSET;
-    uint32_t days = unix_time / 86400;
-    uint32_t remaining = unix_time % 86400;
-
-    *hour = remaining / 3600;
-    *min = (remaining % 3600) / 60;
-    *sec = remaining % 60;
-
-    /* Day of week (Jan 1, 1970 was Thursday = 4) */
-    *wday = (days + 4) % 7;  /* 0=Sun, 1=Mon, ... */
-
-    int y = 1970;
-    int doy = 0;
-    while (1) {
-        int days_in_year = ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 366 : 365;
-        if (days < (uint32_t)days_in_year) {
-            doy = days;
-            break;
-        }
-        days -= days_in_year;
-        y++;
-    }
-    *year = y;
-    *yday = doy + 1;  /* 1-based day of year */
-
-    int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) {
-        days_in_month[1] = 29;
-    }
-
-    int m = 0;
-    while (days >= (uint32_t)days_in_month[m]) {
-        days -= days_in_month[m];
-        m++;
-    }
-    *month = m + 1;
-    *day = days + 1;
-}
-
 /**
  * Calculate even parity of BCD value
  */
@@ -176,13 +197,12 @@ static uint8_t even_parity(uint8_t *bits, int start, int count) {
  *============================================================================*/
 
 /**
- * Encode DCF77 time code for the NEXT minute
- * DCF77 transmits data for the minute that will START at second 59
+ * Encode DCF77 time code for minute c (the one starting after this
+ * frame's second 59)
  */
-static void dcf77_encode(uint8_t *bits, uint32_t ntp_secs) {
-    int year, month, day, hour, min, sec, wday, yday;
-    /* Encode for next minute */
-    ntp_to_utc(ntp_secs + 60, &year, &month, &day, &hour, &min, &sec, &wday, &yday);
+static void dcf77_encode(uint8_t *bits, const calendar_t *c) {
+    int year = c->year, month = c->month, day = c->day;
+    int hour = c->hour, min = c->minute, wday = c->wday;
 
     memset(bits, 0, 60);
 
@@ -195,6 +215,8 @@ static void dcf77_encode(uint8_t *bits, uint32_t ntp_secs) {
     bits[18] = 1;  /* Assume standard time */
 
     /* Bit 19: Leap second announcement */
+    bits[19] = (c->leap_pending != 0 && c->leap_ntp - c->ntp_secs < DCF77_LEAP_WARN_S) ? 1 : 0;
+
     /* Bit 20: Start of time (always 1) */
     bits[20] = 1;
 
@@ -263,12 +285,10 @@ static void dcf77_encode(uint8_t *bits, uint32_t ntp_secs) {
  *============================================================================*/
 
 /**
- * Encode WWVB time code
+ * Encode WWVB time code for minute c
  */
-static void wwvb_encode(uint8_t *bits, uint32_t ntp_secs) {
-    int year, month, day, hour, min, sec, wday, yday;
-    ntp_to_utc(ntp_secs + 60, &year, &month, &day, &hour, &min, &sec, &wday, &yday);
-    (void)month; (void)day; (void)wday;
+static void wwvb_encode(uint8_t *bits, const calendar_t *c) {
+    int year = c->year, hour = c->hour, min = c->minute, yday = c->yday;
 
     memset(bits, 0, 60);
 
@@ -336,14 +356,14 @@ static void wwvb_encode(uint8_t *bits, uint32_t ntp_secs) {
     bits[53] = (yr_units >> 0) & 1;
 
     /* Bit 55: Leap year indicator */
-    bits[55] = ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0) ? 1 : 0;
+    bits[55] = c->leap_year ? 1 : 0;
 
-    /* Bit 56: Leap second warning */
-    bits[56] = 0;
+    /* Bit 56: Leap second warning, through the month it ends */
+    bits[56] = (c->leap_pending != 0) ? 1 : 0;
 
-    /* Bits 57-58: DST indicators */
-    bits[57] = 0;
-    bits[58] = 0;
+    /* Bits 57-58: DST in effect at 24:00 and at 00:00 UTC today */
+    bits[57] = c->dst_us_at_24h ? 1 : 0;
+    bits[58] = c->dst_us_at_0h ? 1 : 0;
 }
 
 /*============================================================================
@@ -351,12 +371,10 @@ static void wwvb_encode(uint8_t *bits, uint32_t ntp_secs) {
  *============================================================================*/
 
 /**
- * Encode JJY time code (same for 40kHz and 60kHz)
+ * Encode JJY time code for minute c (same for 40kHz and 60kHz)
  */
-static void jjy_encode(uint8_t *bits, uint32_t ntp_secs) {
-    int year, month, day, hour, min, sec, wday, yday;
-    ntp_to_utc(ntp_secs + 60, &year, &month, &day, &hour, &min, &sec, &wday, &yday);
-    (void)month; (void)day;
+static void jjy_encode(uint8_t *bits, const calendar_t *c) {
+    int year = c->year, hour = c->hour, min = c->minute, wday = c->wday, yday = c->yday;
 
     memset(bits, 0, 60);
 
@@ -425,8 +443,124 @@ static void jjy_encode(uint8_t *bits, uint32_t ntp_secs) {
     bits[52] = wday & 1;
 }
 
+/**
+ * Bit for a second, re-encoding the channel's minute when it changes.
+ * Each frame carries the time of the minute that follows it.
+ */
+static uint8_t radio_bit(radio_channel_t *ch, uint32_t ntp_secs) {
+    uint32_t minute = ntp_secs / 60;
+    if (minute != ch->minute) {
+        calendar_t next;
+        calendar_at((minute + 1) * 60, &next);
+        ch->encode(ch->bits, &next);
+        ch->minute = minute;
+    }
+    return ch->bits[ntp_secs % 60];
+}
+
+/*============================================================================
+ * DCF77 WAVEFORM
+ *============================================================================*/
+
+static void dcf77_tables_init(void) {
+    /* Spread the fractional period over the table */
+    for (int i = 0; i < REF_WAVE_RING_WORDS / 2; i++) {
+        uint32_t period = (uint32_t)(((uint64_t)(i + 1) * DCF77_TICKS_PER_S) / DCF77_FREQ_HZ -
+                                     ((uint64_t)i * DCF77_TICKS_PER_S) / DCF77_FREQ_HZ);
+        uint32_t full = period / 2;
+        uint32_t reduced = (period * LEVEL_REDUCED + 100) / 200;
+        dcf77_full[2 * i] = REF_WAVE_WORD(full);
+        dcf77_full[2 * i + 1] = REF_WAVE_WORD(period - full);
+        dcf77_reduced[2 * i] = REF_WAVE_WORD(reduced);
+        dcf77_reduced[2 * i + 1] = REF_WAVE_WORD(period - reduced);
+    }
+
+    /* Advancing the phase shortens the cycle that carries the step */
+    uint32_t period = DCF77_TICKS_PER_S / DCF77_FREQ_HZ;
+    for (int i = 0; i < 5; i++) {
+        dcf77_step[i][0] = REF_WAVE_WORD(period / 2);
+        dcf77_step[i][1] = REF_WAVE_WORD(period - period / 2 - (i - 2) * DCF77_PM_DEV_TICKS);
+    }
+
+    /* Chip sequence: 511 chips of the 9-stage LFSR x^9 + x^5 + 1 from
+     * the all-ones state, then one 0 chip. Stored as run lengths. */
+    uint16_t sr = 0x1FF;
+    int runs = 0;
+    uint8_t prev = 0;
+    for (int i = 0; i < DCF77_PM_CHIPS; i++) {
+        uint8_t chip = 0;
+        if (i < DCF77_PM_CHIPS - 1) {
+            chip = sr & 1;
+            uint16_t fb = (sr ^ (sr >> 4)) & 1;
+            sr = (sr >> 1) | (fb << 8);
+        }
+        if (i == 0) {
+            dcf77_pm_first = chip;
+        }
+        if (i == 0 || chip != prev) {
+            if (runs == DCF77_PM_RUNS) {
+                /* Cannot happen for this sequence; keep AM only */
+                printf("[RADIO] ERROR: PM sequence overflow\n");
+                dcf77_pm = false;
+                return;
+            }
+            dcf77_pm_runs[runs++] = 0;
+        }
+        dcf77_pm_runs[runs - 1]++;
+        prev = chip;
+    }
+}
+
+/**
+ * Append the 512 PM chips plus one exit cycle back to nominal phase.
+ * A chip of 0 advances the phase, 1 retards it; bit 1 inverts the
+ * sequence.
+ */
+static ref_wave_block_t *dcf77_put_pm(ref_wave_block_t *b, bool invert) {
+    int phase = 0;
+    uint8_t chip = dcf77_pm_first ^ (invert ? 1 : 0);
+
+    for (int r = 0; r < DCF77_PM_RUNS; r++) {
+        int target = chip ? -1 : 1;
+        b = ref_wave_put(&dcf77_wave, b, dcf77_step[target - phase + 2], 2);
+        b = ref_wave_put_ring(&dcf77_wave, b, dcf77_full,
+                              2 * (dcf77_pm_runs[r] * DCF77_PM_CHIP_CYCLES - 1));
+        phase = target;
+        chip ^= 1;
+    }
+    return ref_wave_put(&dcf77_wave, b, dcf77_step[2 - phase], 2);
+}
+
+/**
+ * Encode the second at ntp_secs into list idx: reduced carrier for the
+ * bit, full carrier to 200ms, PM chips, full carrier to the sync margin
+ */
+static void dcf77_build(int idx, uint32_t ntp_secs) {
+    ref_wave_block_t *b = dcf77_wave.list[idx];
+    uint8_t bit = radio_bit(&dcf77, ntp_secs);
+
+    /* Second 59 (bit 2) has no reduction */
+    uint32_t reduced = 0;
+    if (bit != 2) {
+        reduced = DCF77_CYCLES_MS(bit ? DCF77_BIT1_MS : DCF77_BIT0_MS);
+        b = ref_wave_put_ring(&dcf77_wave, b, dcf77_reduced, 2 * reduced);
+    }
+    b = ref_wave_put_ring(&dcf77_wave, b, dcf77_full,
+                          2 * (DCF77_CYCLES_MS(DCF77_PM_START_MS) - reduced));
+
+    uint32_t cycles = DCF77_CYCLES_MS(DCF77_PM_START_MS);
+    if (dcf77_pm) {
+        b = dcf77_put_pm(b, bit == 1);
+        cycles += DCF77_PM_CHIPS * DCF77_PM_CHIP_CYCLES + 1;
+    }
+
+    b = ref_wave_put_ring(&dcf77_wave, b, dcf77_full,
+                          2 * (DCF77_FREQ_HZ - cycles - DCF77_SYNC_CYCLES));
+    ref_wave_end(&dcf77_wave, idx, b);
+}
+
 /*============================================================================
- * PWM CONTROL
+ * PWM KEYING
  *============================================================================*/
 
 /**
@@ -445,59 +579,132 @@ static void radio_pwm_init(radio_channel_t *ch, uint gpio, uint16_t wrap) {
     pwm_set_enabled(ch->slice, true);
 
     ch->enabled = true;
-    ch->state = RADIO_STATE_IDLE;
-    ch->current_bit = 0;
 }
 
 /**
- * Set carrier amplitude
+ * Slice CC word for a carrier amplitude (both halves; the other pin of
+ * each slice used here is not a PWM output)
  * @param level 0-100 (percentage)
  */
-static void radio_set_level(radio_channel_t *ch, uint8_t level) {
-    if (!ch->enabled) return;
+static uint32_t radio_cc(const radio_channel_t *ch, uint8_t level) {
+    if (!ch->enabled) return 0;
 
-    uint16_t duty = (uint32_t)ch->wrap * level / 200;  /* 50% at full, less when reduced */
-    pwm_set_gpio_level(ch->gpio, duty);
+    uint32_t duty = (uint32_t)ch->wrap * level / 200;  /* 50% at full, less when reduced */
+    return duty | (duty << 16);
 }
 
-/*============================================================================
- * BIT TRANSMISSION STATE MACHINE
- *============================================================================*/
+static void radio_set_levels(radio_channel_t *ch) {
+    ch->cc_full = radio_cc(ch, LEVEL_FULL);
+    ch->cc_reduced = radio_cc(ch, LEVEL_REDUCED);
+    pwm_hw->slice[ch->slice].cc = ch->cc_full;
+}
+
+static void key_dma_init(void) {
+    key_ctrl_chan = dma_claim_unused_channel(true);
+    key_data_chan = dma_claim_unused_channel(true);
+    int timer = dma_claim_unused_timer(true);
+    dma_timer_set_fraction(timer, 1, SYS_CLK_HZ / KEY_TICK_HZ);
+
+    /* Set blocks: one unpaced word into a slice's CC */
+    dma_channel_config c = dma_channel_get_default_config(key_data_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_chain_to(&c, key_ctrl_chan);
+    key_ctrl_set = channel_config_get_ctrl_value(&c);
+
+    /* Wait blocks: one dummy word per pacing timer tick */
+    channel_config_set_dreq(&c, dma_get_timer_dreq(timer));
+    key_ctrl_wait = channel_config_get_ctrl_value(&c);
+
+    /* Control channel: four words per block, wrapping on alias 1 */
+    c = dma_channel_get_default_config(key_ctrl_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 4);
+    dma_channel_configure(key_ctrl_chan, &c, &dma_hw->ch[key_data_chan].al1_ctrl,
+                          key_list[0], 4, false);
+}
 
 /**
- * Start transmitting a bit
+ * Add a channel's two level changes for its bit at ntp_secs.
+ * WWVB reduces the carrier for the bit time; JJY holds it full for the
+ * bit time and then reduces it.
  */
-static void radio_start_bit(radio_channel_t *ch, uint8_t bit_value,
-                            uint16_t zero_ms, uint16_t one_ms, uint16_t marker_ms) {
-    ch->state = RADIO_STATE_SENDING_BIT;
-    ch->bit_start_ms = to_ms_since_boot(get_absolute_time());
-
-    if (bit_value == 2) {
-        /* Marker */
-        ch->reduce_duration = marker_ms;
-    } else if (bit_value == 1) {
-        ch->reduce_duration = one_ms;
+static int key_add_edges(key_edge_t *e, int n, radio_channel_t *ch, uint32_t ntp_secs) {
+    uint8_t bit = radio_bit(ch, ntp_secs);
+    uint32_t ms;
+    bool reduce_first = (ch == &wwvb);
+
+    if (reduce_first) {
+        ms = (bit == 2) ? WWVB_MARKER_MS : bit ? WWVB_BIT1_MS : WWVB_BIT0_MS;
     } else {
-        ch->reduce_duration = zero_ms;
+        ms = (bit == 2) ? JJY_MARKER_MS : bit ? JJY_BIT1_MS : JJY_BIT0_MS;
     }
 
-    /* Start with reduced carrier */
-    radio_set_level(ch, LEVEL_REDUCED);
+    e[n].tick = 0;
+    e[n].ch = ch;
+    e[n].cc = reduce_first ? &ch->cc_reduced : &ch->cc_full;
+    e[n + 1].tick = ms * (KEY_TICK_HZ / 1000);
+    e[n + 1].ch = ch;
+    e[n + 1].cc = reduce_first ? &ch->cc_full : &ch->cc_reduced;
+    return n + 2;
 }
 
 /**
- * Update bit transmission state
+ * Build the timeline for ntp_secs and queue it for the next PPS
  */
-static void radio_update_bit(radio_channel_t *ch) {
-    if (ch->state != RADIO_STATE_SENDING_BIT) return;
+static void key_build(uint32_t ntp_secs) {
+    if (key_ctrl_chan < 0 || (key_pending >= 0 && key_built == ntp_secs)) {
+        return;
+    }
 
-    uint32_t elapsed = to_ms_since_boot(get_absolute_time()) - ch->bit_start_ms;
+    /* A stale pending list may be the one being rebuilt */
+    key_pending = -1;
+
+    key_edge_t edges[KEY_CHANNELS * 2];
+    int n = 0;
+    n = key_add_edges(edges, n, &wwvb, ntp_secs);
+    n = key_add_edges(edges, n, &jjy40, ntp_secs);
+    n = key_add_edges(edges, n, &jjy60, ntp_secs);
+
+    /* Insertion sort by time; equal times keep their order */
+    for (int i = 1; i < n; i++) {
+        key_edge_t t = edges[i];
+        int j = i - 1;
+        while (j >= 0 && edges[j].tick > t.tick) {
+            edges[j + 1] = edges[j];
+            j--;
+        }
+        edges[j + 1] = t;
+    }
 
-    if (elapsed >= ch->reduce_duration) {
-        /* Restore full carrier for remainder of second */
-        radio_set_level(ch, LEVEL_FULL);
-        ch->state = RADIO_STATE_BIT_COMPLETE;
+    /* The running list may still be in its last wait */
+    int idx = key_next;
+    key_block_t *b = key_list[idx];
+    uint32_t tick = 0;
+    for (int i = 0; i < n; i++) {
+        if (edges[i].tick > tick) {
+            b->ctrl = key_ctrl_wait;
+            b->read = &key_zero;
+            b->write = &key_sink;
+            b->count = edges[i].tick - tick;
+            b++;
+            tick = edges[i].tick;
+        }
+        b->ctrl = key_ctrl_set;
+        b->read = edges[i].cc;
+        b->write = &pwm_hw->slice[edges[i].ch->slice].cc;
+        b->count = 1;
+        b++;
     }
+
+    /* Null trigger stops the control channel */
+    memset(b, 0, sizeof(*b));
+
+    key_built = ntp_secs;
+    key_pending = idx;
 }
 
 /*============================================================================
@@ -510,8 +717,20 @@ static void radio_update_bit(radio_channel_t *ch) {
 void radio_timecode_init(void) {
     printf("[RADIO] Initializing radio timecode outputs\n");
 
-    radio_pwm_init(&dcf77, GPIO_DCF77, DCF77_WRAP);
-    printf("[RADIO] DCF77 (77.5kHz) on GP%d\n", GPIO_DCF77);
+    dcf77.encode = dcf77_encode;
+    wwvb.encode = wwvb_encode;
+    jjy40.encode = jjy_encode;
+    jjy60.encode = jjy_encode;
+
+    dcf77.gpio = GPIO_DCF77;
+    dcf77.enabled = true;
+    dcf77_tables_init();
+    if (ref_wave_init(&dcf77_wave, DCF77_SM, GPIO_DCF77, dcf77_lists, DCF77_BLOCKS)) {
+        ref_wave_service(&dcf77_wave, get_current_time().seconds, dcf77_build);
+        ref_wave_output(GPIO_DCF77, true);
+        dcf77_ready = true;
+    }
+    printf("[RADIO] DCF77 (77.5kHz, AM+PM) on GP%d\n", GPIO_DCF77);
 
     radio_pwm_init(&wwvb, GPIO_WWVB, WWVB_WRAP);
     printf("[RADIO] WWVB (60kHz) on GP%d\n", GPIO_WWVB);
@@ -521,65 +740,43 @@ void radio_timecode_init(void) {
 
     radio_pwm_init(&jjy60, GPIO_JJY60, JJY60_WRAP);
     printf("[RADIO] JJY60 (60kHz) on GP%d\n", GPIO_JJY60);
+
+    radio_set_levels(&wwvb);
+    radio_set_levels(&jjy40);
+    radio_set_levels(&jjy60);
+    key_dma_init();
 }
 
 /**
- * Radio timecode task - call frequently from main loop
+ * Rubidium PPS edge, from the capture IRQ: start this second's PWM
+ * keying timeline
  */
-void radio_timecode_task(void) {
-    timestamp_t ts = get_current_time();
-    uint32_t ntp_secs = ts.seconds;
-
-    /* Check for new minute - re-encode */
-    uint32_t minute = ntp_secs / 60;
-    if (minute != last_minute) {
-        last_minute = minute;
-
-        /* Encode time for all channels */
-        dcf77_encode(dcf77.bits, ntp_secs);
-        wwvb_encode(wwvb.bits, ntp_secs);
-        jjy_encode(jjy40.bits, ntp_secs);
-        memcpy(jjy60.bits, jjy40.bits, 60);  /* Same encoding */
-
-        dcf77.current_bit = 0;
-        wwvb.current_bit = 0;
-        jjy40.current_bit = 0;
-        jjy60.current_bit = 0;
+void radio_timecode_pps_edge(void) {
+    int idx = key_pending;
+    if (idx < 0) {
+        return;
     }
+    key_pending = -1;
+    key_next = idx ^ 1;
 
-    /* Check for new second - start next bit */
-    uint32_t second = ntp_secs % 60;
-    if (second != last_second) {
-        last_second = second;
-
-        /* Start bit transmission for each channel */
-        if (dcf77.enabled && second < 59) {
-            radio_start_bit(&dcf77, dcf77.bits[second],
-                           DCF77_BIT0_MS, DCF77_BIT1_MS, 0);
-        }
-
-        if (wwvb.enabled) {
-            radio_start_bit(&wwvb, wwvb.bits[second],
-                           WWVB_BIT0_MS, WWVB_BIT1_MS, WWVB_MARKER_MS);
-        }
+    if (dma_channel_is_busy(key_data_chan)) {
+        /* Last second's timeline overran its final wait */
+        dma_channel_abort(key_data_chan);
+    }
+    dma_channel_set_read_addr(key_ctrl_chan, key_list[idx], true);
+}
 
-        if (jjy40.enabled) {
-            /* JJY: opposite - full carrier, then reduced */
-            radio_start_bit(&jjy40, jjy40.bits[second],
-                           JJY_BIT0_MS, JJY_BIT1_MS, JJY_MARKER_MS);
-        }
+/**
+ * Radio timecode task - woken each second by the calendar to schedule
+ * the next one
+ */
+void radio_timecode_task(void) {
+    uint32_t ntp_secs = calendar_now()->ntp_secs;
 
-        if (jjy60.enabled) {
-            radio_start_bit(&jjy60, jjy60.bits[second],
-                           JJY_BIT0_MS, JJY_BIT1_MS, JJY_MARKER_MS);
-        }
+    if (dcf77_ready) {
+        ref_wave_service(&dcf77_wave, ntp_secs, dcf77_build);
     }
-
-    /* Update bit transmission state machines */
-    radio_update_bit(&dcf77);
-    radio_update_bit(&wwvb);
-    radio_update_bit(&jjy40);
-    radio_update_bit(&jjy60);
+    key_build(ntp_secs + 1);
 }
 
 /**
@@ -597,10 +794,13 @@ void radio_timecode_enable(radio_signal_t signal, bool enable) {
 
     if (ch) {
         ch->enabled = enable;
-        if (!enable) {
-            pwm_set_gpio_level(ch->gpio, 0);  /* Turn off carrier */
+        if (ch == &dcf77) {
+            if (dcf77_ready) {
+                ref_wave_output(GPIO_DCF77, enable);
+            }
         } else {
-            radio_set_level(ch, LEVEL_FULL);  /* Restore carrier */
+            /* Timelines read the words when they fire */
+            radio_set_levels(ch);
         }
     }
 }
@@ -630,3 +830,20 @@ uint8_t radio_timecode_get_gpio(radio_signal_t signal) {
     }
     return 0;
 }
+
+/**
+ * Enable/disable DCF77 phase modulation (from the next second encoded)
+ */
+void radio_timecode_set_dcf77_pm(bool enable) {
+    dcf77_pm = enable;
+    if (dcf77_ready) {
+        ref_wave_invalidate(&dcf77_wave);
+    }
+}
+
+/**
+ * Check if DCF77 phase modulation is on
+ */
+bool radio_timecode_get_dcf77_pm(void) {
+    return dcf77_pm;
+}
@@ -0,0 +1,387 @@
+/**
+ * CHRONOS-Rb Reference Manager
+ *
+ * Per-source health and the primary PPS selection, plus the phase slew
+ * that makes switchover glitch-free. See ref_manager.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "chronos_rb.h"
+#include "gnss_input.h"
+#include "log_buffer.h"
+#include "ref_manager.h"
+
+/* A PPS interval further than this from 1s is a glitched or missed edge */
+#define EDGE_TOL_NS         1000000LL
+
+/* Jitter EWMA weight once past the first samples */
+#define JITTER_WEIGHT       16
+
+/* Steering offsets further than this many sigma from the filter are
+ * rejected; this many in a row and the filter restarts */
+#define STEER_GATE_SIGMA    5.0
+#define STEER_GATE_MIN_NS   1000.0
+#define STEER_MAX_REJECTS   8
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+typedef struct {
+    uint64_t last_us;           /* Last sample (time_us_64), 0 = never */
+    double var;                 /* Jitter variance EWMA (ns^2) */
+    uint32_t n;                 /* Samples in the EWMA */
+    int64_t prev;               /* Previous interval or latency (ns) */
+    bool have_prev;
+} src_state_t;
+
+static src_state_t src_state[REF_COUNT];
+static ref_status_t status;
+
+/* Last edge of each PPS source (µs), for phase at switchover */
+static uint64_t rb_edge_us = 0;
+static uint64_t gnss_edge_us = 0;
+static uint64_t gnss_edge_ns = 0;
+
+/* GNSS minus Rb phase filter (timing core task context) */
+static double steer_offset_ns = 0.0;
+static double steer_var = 0.0;
+static uint32_t steer_n = 0;
+static uint32_t steer_rejects = 0;
+
+/* NMEA latency after the GNSS PPS */
+static double nmea_latency_ns = 0.0;
+static uint64_t nmea_sampled_pps_us = 0;
+
+/* Selection hysteresis */
+static uint32_t degraded_s = 0;
+static uint32_t return_s = 0;
+static uint64_t last_second_us = 0;
+
+static const char *const source_names[] = {
+    "rb_pps", "gnss_pps", "rb_10mhz", "gnss_nmea", "none"
+};
+
+/*============================================================================
+ * PRIVATE FUNCTIONS
+ *============================================================================*/
+
+/**
+ * Fold a jitter sample (ns) into the source's RMS
+ */
+static void jitter_sample(ref_source_t i, double d_ns) {
+    src_state_t *s = &src_state[i];
+    uint32_t w = (s->n < JITTER_WEIGHT) ? ++s->n : JITTER_WEIGHT;
+    s->var += (d_ns * d_ns - s->var) / w;
+    status.src[i].jitter_ns = (float)sqrt(s->var);
+}
+
+/**
+ * Interval of a one-second source; the second difference of successive
+ * intervals is its jitter (times sqrt 2, removed here)
+ */
+static void interval_sample(ref_source_t i, int64_t interval_ns) {
+    src_state_t *s = &src_state[i];
+
+    status.src[i].samples++;
+    s->last_us = time_us_64();
+
+    if (interval_ns == 0) {
+        s->have_prev = false;
+        return;
+    }
+    if (llabs(interval_ns - 1000000000LL) > EDGE_TOL_NS) {
+        status.src[i].faults++;
+        s->have_prev = false;
+        return;
+    }
+    if (s->have_prev) {
+        jitter_sample(i, (double)(interval_ns - s->prev) * 0.70710678);
+    }
+    s->prev = interval_ns;
+    s->have_prev = true;
+}
+
+static bool source_ok(ref_source_t i) {
+    return status.src[i].score >= REF_SCORE_MIN;
+}
+
+/**
+ * Availability, lock and jitter to a score: full marks up to the
+ * nominal jitter, falling as 1/jitter past it, a quarter without lock
+ */
+static void update_health(ref_source_t i, bool available, bool locked, float nominal_ns) {
+    ref_health_t *h = &status.src[i];
+    h->available = available;
+    h->locked = locked;
+
+    if (!available) {
+        h->score = 0;
+        return;
+    }
+    float jitter = (h->jitter_ns > nominal_ns) ? h->jitter_ns : nominal_ns;
+    float score = 100.0f * nominal_ns / jitter;
+    if (!locked) {
+        score *= 0.25f;
+    }
+    h->score = (uint8_t)score;
+}
+
+/**
+ * GNSS minus Rb phase into the steering filter
+ */
+static void steer_sample(int32_t offset_ns) {
+    double d = (double)offset_ns - steer_offset_ns;
+    if (d > 5e8) {
+        d -= 1e9;
+    } else if (d < -5e8) {
+        d += 1e9;
+    }
+
+    if (steer_n >= REF_STEER_MIN_SAMPLES) {
+        double gate = fmax(STEER_GATE_SIGMA * sqrt(steer_var), STEER_GATE_MIN_NS);
+        if (fabs(d) > gate) {
+            status.src[REF_GNSS_PPS].faults++;
+            if (++steer_rejects >= STEER_MAX_REJECTS) {
+                LOG_WARN(LOG_MOD_RB, "[REF] GNSS to Rb phase moved %ld ns, restarting steering\n",
+                         (int32_t)d);
+                steer_n = 0;
+                steer_rejects = 0;
+            }
+            return;
+        }
+    }
+    steer_rejects = 0;
+
+    if (steer_n == 0) {
+        steer_offset_ns = offset_ns;
+        steer_var = 0.0;
+        steer_n = 1;
+    } else {
+        if (steer_n < REF_STEER_TAU_S) {
+            steer_n++;
+        }
+        steer_offset_ns += d / steer_n;
+        steer_var += (d * d - steer_var) / (steer_n < JITTER_WEIGHT ? steer_n : JITTER_WEIGHT);
+        if (steer_offset_ns > 5e8) {
+            steer_offset_ns -= 1e9;
+        } else if (steer_offset_ns < -5e8) {
+            steer_offset_ns += 1e9;
+        }
+    }
+    status.gnss_offset_ns = (int32_t)lround(steer_offset_ns);
+}
+
+/**
+ * What the time base reads at an edge, as a phase within the second
+ */
+static int32_t edge_phase_ns(uint64_t edge_us) {
+    timestamp_t ts = timestamp_from_us(edge_us);
+    int64_t ns = (int64_t)(((uint64_t)ts.fraction * 1000000000ULL) >> 32);
+    if (ns >= 500000000LL) {
+        ns -= 1000000000LL;
+    }
+    return (int32_t)ns;
+}
+
+/**
+ * Make src primary, starting from the phase the time base already has
+ * at its last edge so the handover is continuous
+ */
+static void switch_primary(uint8_t src) {
+    LOG_INFO(LOG_MOD_RB, "[REF] Primary reference %s -> %s\n",
+             source_names[status.primary], source_names[src]);
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint64_t edge_us = (src == REF_RB_PPS) ? rb_edge_us : gnss_edge_us;
+    if (src != REF_NONE && edge_us != 0) {
+        status.phase_ns = edge_phase_ns(edge_us);
+    }
+    status.primary = src;
+    restore_interrupts(irq);
+
+    status.switches++;
+    degraded_s = 0;
+    return_s = 0;
+}
+
+/**
+ * Once a second: pick the primary with hysteresis. The Rb is preferred;
+ * a degraded primary is left after REF_SWITCH_S, a missing one at once.
+ */
+static void select_primary(void) {
+    uint8_t want = source_ok(REF_RB_PPS) ? REF_RB_PPS :
+                   source_ok(REF_GNSS_PPS) ? REF_GNSS_PPS : REF_NONE;
+    uint8_t cur = status.primary;
+
+    if (want == cur) {
+        degraded_s = 0;
+        return_s = 0;
+    } else if (cur == REF_NONE || !status.src[cur].available) {
+        switch_primary(want);
+    } else if (!source_ok(cur)) {
+        if (++degraded_s >= REF_SWITCH_S) {
+            switch_primary(want);
+        }
+    } else if (++return_s >= REF_RETURN_S) {
+        switch_primary(want);
+    }
+}
+
+/**
+ * Once a second: move the primary's phase toward its target. GNSS
+ * edges are UTC; Rb edges sit at minus the GNSS offset while GNSS steers
+ * and hold their phase while it does not.
+ */
+static void slew_phase(void) {
+    status.steering = steer_n >= REF_STEER_MIN_SAMPLES &&
+                      source_ok(REF_RB_PPS) && source_ok(REF_GNSS_PPS);
+
+    int32_t target = status.phase_ns;
+    if (status.primary == REF_GNSS_PPS) {
+        target = 0;
+    } else if (status.primary == REF_RB_PPS) {
+        if (status.steering) {
+            target = -status.gnss_offset_ns;
+        } else if (!g_time_state.time_valid) {
+            target = 0;
+        }
+    }
+    status.target_ns = target;
+
+    int32_t step = target - status.phase_ns;
+    if (g_time_state.time_valid) {
+        if (step > REF_SLEW_NS_PER_S) {
+            step = REF_SLEW_NS_PER_S;
+        } else if (step < -REF_SLEW_NS_PER_S) {
+            step = -REF_SLEW_NS_PER_S;
+        }
+    }
+
+    uint32_t irq = save_and_disable_interrupts();
+    status.phase_ns += step;
+    restore_interrupts(irq);
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void ref_init(void) {
+    memset(src_state, 0, sizeof(src_state));
+    memset(&status, 0, sizeof(status));
+    status.primary = REF_NONE;
+
+    printf("[REF] Reference manager: Rb PPS short term, GNSS PPS long term\n");
+}
+
+bool ref_rb_edge(int64_t interval_ns, int32_t *phase_ns) {
+    rb_edge_us = get_last_pps_timestamp();
+    interval_sample(REF_RB_PPS, interval_ns);
+
+    if (status.primary != REF_RB_PPS) {
+        return false;
+    }
+    *phase_ns = status.phase_ns;
+    return true;
+}
+
+void ref_gnss_edge(uint64_t edge_ns, const int32_t *offset_ns) {
+    int64_t interval_ns = (gnss_edge_ns != 0) ? (int64_t)(edge_ns - gnss_edge_ns) : 0;
+    gnss_edge_ns = edge_ns;
+    gnss_edge_us = (edge_ns + 500) / 1000;
+
+    interval_sample(REF_GNSS_PPS, interval_ns);
+    if (!src_state[REF_GNSS_PPS].have_prev) {
+        interval_ns = 0;    /* Missed or glitched: no frequency sample */
+    }
+
+    if (offset_ns != NULL && source_ok(REF_RB_PPS) && source_ok(REF_GNSS_PPS)) {
+        steer_sample(*offset_ns);
+    }
+
+    if (status.primary == REF_GNSS_PPS) {
+        uint32_t irq = save_and_disable_interrupts();
+        time_pps_edge(gnss_edge_us, interval_ns, status.phase_ns);
+        restore_interrupts(irq);
+    }
+}
+
+void ref_task(void) {
+    uint64_t now = time_us_64();
+    bool rb_locked = rubidium_is_locked();
+
+    /* 10 MHz: every gate should hold exactly 10,000,000 Rb cycles */
+    if (freq_counter_new_measurement()) {
+        int32_t err = freq_counter_get_error();
+        src_state[REF_RB_10MHZ].last_us = now;
+        status.src[REF_RB_10MHZ].samples++;
+        if (err < -10 || err > 10) {
+            status.src[REF_RB_10MHZ].faults++;
+        }
+        jitter_sample(REF_RB_10MHZ, err * 100.0);
+    }
+
+    /* NMEA: latency of the first sentence after each GNSS PPS */
+    uint64_t pps_us = gnss_get_last_pps_us();
+    uint64_t nmea_us = gnss_get_last_nmea_us();
+    if (pps_us != 0 && pps_us != nmea_sampled_pps_us &&
+        nmea_us > pps_us && nmea_us - pps_us < 1000000) {
+        double latency = (double)(nmea_us - pps_us) * 1e3;
+        src_state[REF_GNSS_NMEA].last_us = now;
+        status.src[REF_GNSS_NMEA].samples++;
+        if (status.src[REF_GNSS_NMEA].samples == 1) {
+            nmea_latency_ns = latency;
+        }
+        nmea_latency_ns += (latency - nmea_latency_ns) / JITTER_WEIGHT;
+        jitter_sample(REF_GNSS_NMEA, latency - nmea_latency_ns);
+        nmea_sampled_pps_us = pps_us;
+    }
+
+    bool fresh[REF_COUNT];
+    for (int i = 0; i < REF_COUNT; i++) {
+        fresh[i] = src_state[i].last_us != 0 && now - src_state[i].last_us < REF_STALE_US;
+    }
+
+    update_health(REF_RB_10MHZ, fresh[REF_RB_10MHZ] && freq_counter_signal_present(),
+                  rb_locked, REF_10MHZ_JITTER_NS);
+
+    /* The PPS is divided from the 10 MHz: a bad count says the divider
+     * chain slipped, whatever the lock pin reports */
+    bool count_ok = !status.src[REF_RB_10MHZ].available || source_ok(REF_RB_10MHZ);
+    update_health(REF_RB_PPS, fresh[REF_RB_PPS], rb_locked && count_ok,
+                  REF_RB_PPS_JITTER_NS);
+    update_health(REF_GNSS_PPS, fresh[REF_GNSS_PPS] && gnss_pps_valid(),
+                  gnss_has_fix(), REF_GNSS_PPS_JITTER_NS);
+    update_health(REF_GNSS_NMEA, fresh[REF_GNSS_NMEA] && gnss_has_time(),
+                  gnss_has_fix(), REF_NMEA_JITTER_NS);
+
+    if (now - last_second_us >= 1000000) {
+        last_second_us = now;
+        select_primary();
+        slew_phase();
+    }
+}
+
+uint8_t ref_get_primary(void) {
+    return status.primary;
+}
+
+void ref_get_status(ref_status_t *out) {
+    uint32_t irq = save_and_disable_interrupts();
+    memcpy(out, &status, sizeof(*out));
+    restore_interrupts(irq);
+}
+
+const char *ref_source_name(uint8_t src) {
+    return source_names[src < REF_COUNT ? src : REF_NONE];
+}
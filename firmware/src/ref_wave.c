@@ -0,0 +1,201 @@
+/**
+ * CHRONOS-Rb Reference-Locked Waveform Engine
+ *
+ * Every instance runs the one copy of the ref_wave program on PIO2.
+ * The data DMA channel moves words into the state machine's FIFO, paced
+ * by its DREQ; each time it finishes a block it chains to the control
+ * channel, which loads the next block. The last block of a list copies
+ * the other list's address into the control channel's read address, so
+ * the control channel carries straight on into it.
+ *
+ * DMA runs at most a FIFO (8 words) ahead of the pin, so the list the
+ * control channel is reading is the frame on air, or the next one in
+ * the last few words of a frame.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+
+#include "chronos_rb.h"
+#include "ref_wave.h"
+#include "ref_wave.pio.h"
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static PIO wave_pio = pio2;         /* SM0 is the GNSS PPS capture */
+static int wave_offset = -1;
+static const uint32_t wave_sync_word = 0;
+
+/*============================================================================
+ * PRIVATE FUNCTIONS
+ *============================================================================*/
+
+static void wave_stop(ref_wave_t *w) {
+    /* Aborting the data channel can fire its chain, so the control
+     * channel is aborted on both sides of it */
+    dma_channel_abort(w->ctrl_chan);
+    dma_channel_abort(w->data_chan);
+    dma_channel_abort(w->ctrl_chan);
+
+    pio_sm_set_enabled(wave_pio, w->sm, false);
+    pio_sm_clear_fifos(wave_pio, w->sm);
+    pio_sm_restart(wave_pio, w->sm);
+    pio_sm_exec(wave_pio, w->sm, pio_encode_jmp((uint)wave_offset + ref_wave_offset_start));
+}
+
+static void wave_start(ref_wave_t *w) {
+    /* Leading sync so the first frame waits for its PPS edge */
+    pio_sm_put(wave_pio, w->sm, 0);
+    pio_sm_set_enabled(wave_pio, w->sm, true);
+
+    dma_channel_set_write_addr(w->ctrl_chan, &dma_hw->ch[w->data_chan].al1_ctrl, false);
+    dma_channel_set_read_addr(w->ctrl_chan, w->list[0], true);
+    w->running = true;
+}
+
+/**
+ * List the control channel is fetching from
+ */
+static int wave_playing(const ref_wave_t *w) {
+    uintptr_t addr = (uintptr_t)dma_hw->ch[w->ctrl_chan].read_addr;
+    return (addr >= (uintptr_t)w->list[1]) ? 1 : 0;
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+bool ref_wave_init(ref_wave_t *w, uint sm, uint out_pin,
+                   ref_wave_block_t *lists, uint32_t blocks) {
+    if (wave_offset < 0) {
+        if (!pio_can_add_program(wave_pio, &ref_wave_program)) {
+            printf("[WAVE] ERROR: No PIO2 instruction space\n");
+            return false;
+        }
+        wave_offset = (int)pio_add_program(wave_pio, &ref_wave_program);
+    }
+
+    w->sm = sm;
+    w->list[0] = lists;
+    w->list[1] = lists + blocks;
+    w->list_addr[0] = w->list[0];
+    w->list_addr[1] = w->list[1];
+    w->blocks = blocks;
+    w->running = false;
+
+    pio_sm_claim(wave_pio, sm);
+    ref_wave_program_init(wave_pio, sm, (uint)wave_offset,
+                          GPIO_10MHZ_INPUT, GPIO_PPS_INPUT, out_pin);
+
+    w->ctrl_chan = dma_claim_unused_channel(true);
+    w->data_chan = dma_claim_unused_channel(true);
+
+    /* Data channel settings, loaded by each block */
+    dma_channel_config c = dma_channel_get_default_config(w->data_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(wave_pio, sm, true));
+    channel_config_set_chain_to(&c, w->ctrl_chan);
+    w->ctrl_table = channel_config_get_ctrl_value(&c);
+
+    channel_config_set_ring(&c, false, __builtin_ctz(REF_WAVE_RING_ALIGN));
+    w->ctrl_ring = channel_config_get_ctrl_value(&c);
+
+    /* Jump block: one unpaced word into the control channel's read
+     * address, then chain to it so it fetches from the other list */
+    channel_config_set_ring(&c, false, 0);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    w->ctrl_jump = channel_config_get_ctrl_value(&c);
+
+    /* Control channel: four words per block, wrapping on alias 1 */
+    c = dma_channel_get_default_config(w->ctrl_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 4);
+    dma_channel_configure(w->ctrl_chan, &c, &dma_hw->ch[w->data_chan].al1_ctrl,
+                          w->list[0], 4, false);
+
+    printf("[WAVE] PIO2 SM%u on GP%u, DMA %d/%d\n", sm, out_pin,
+           w->ctrl_chan, w->data_chan);
+    return true;
+}
+
+ref_wave_block_t *ref_wave_put(const ref_wave_t *w, ref_wave_block_t *b,
+                               const uint32_t *words, uint32_t count) {
+    b->ctrl = w->ctrl_table;
+    b->read = words;
+    b->write = &wave_pio->txf[w->sm];
+    b->count = count;
+    return b + 1;
+}
+
+ref_wave_block_t *ref_wave_put_ring(const ref_wave_t *w, ref_wave_block_t *b,
+                                    const uint32_t *table, uint32_t count) {
+    b->ctrl = w->ctrl_ring;
+    b->read = table;
+    b->write = &wave_pio->txf[w->sm];
+    b->count = count;
+    return b + 1;
+}
+
+void ref_wave_end(const ref_wave_t *w, int idx, ref_wave_block_t *b) {
+    b = ref_wave_put(w, b, &wave_sync_word, 1);
+
+    b->ctrl = w->ctrl_jump;
+    b->read = &w->list_addr[idx ^ 1];
+    b->write = &dma_hw->ch[w->ctrl_chan].read_addr;
+    b->count = 1;
+}
+
+bool ref_wave_service(ref_wave_t *w, uint32_t now, ref_wave_build_fn build) {
+    int playing = w->running ? wave_playing(w) : 0;
+    uint32_t on_air = w->label[playing];
+
+    if (!w->running || (on_air != now && on_air != now + 1)) {
+        /* Time stepped or PPS was lost: start clean on the next edge */
+        if (w->running) {
+            w->resyncs++;
+        }
+        wave_stop(w);
+        build(0, now + 1);
+        w->label[0] = now + 1;
+        build(1, now + 2);
+        w->label[1] = now + 2;
+        wave_start(w);
+        return true;
+    }
+
+    int idle = playing ^ 1;
+    if (w->label[idle] != on_air + 1) {
+        build(idle, on_air + 1);
+        w->label[idle] = on_air + 1;
+        w->frames++;
+    }
+    return false;
+}
+
+void ref_wave_invalidate(ref_wave_t *w) {
+    if (w->running) {
+        w->label[wave_playing(w) ^ 1] = 0;
+    }
+}
+
+void ref_wave_output(uint out_pin, bool enable) {
+    if (enable) {
+        pio_gpio_init(wave_pio, out_pin);
+    } else {
+        gpio_init(out_pin);
+        gpio_set_dir(out_pin, GPIO_OUT);
+        gpio_put(out_pin, 0);
+    }
+}
@@ -6,10 +6,18 @@
  * verify, with ~10 second accuracy (suitable for certificate validation).
  *
  * Protocol: UDP port 2002
- * Signature: Ed25519 (requires crypto library)
+ * Signature: Ed25519 over SREP, once per batch
  *
- * Note: This implementation provides the protocol framework. Full
- * cryptographic signing requires an Ed25519 implementation.
+ * An Ed25519 signature costs tens of milliseconds on the Cortex-M33, so
+ * requests are not signed one by one. The receive callback only queues
+ * the nonce; the roughtime task collects everything that arrives within
+ * ROUGHTIME_BATCH_US, hashes the nonces into a SHA-512 Merkle tree and
+ * signs one SREP carrying the tree's ROOT. Each reply then has the same
+ * SIG and SREP plus its own PATH (sibling hashes, leaf upwards) and INDX.
+ *
+ * The long-term key never signs requests: it signs a delegation (CERT)
+ * of a random online key with a MINT..MAXT validity window, built once
+ * and re-issued when the window runs out or time steps outside it.
  *
  * Reference: https://roughtime.googlesource.com/roughtime
  *
@@ -21,10 +29,15 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
+#include "pico/rand.h"
 #include "lwip/udp.h"
 
 #include "chronos_rb.h"
 #include "roughtime.h"
+#include "ed25519.h"
+#include "sha512.h"
+#include "sched.h"
+#include "unit_secret.h"
 
 /*============================================================================
  * CONFIGURATION
@@ -43,33 +56,90 @@
 #define TAG_RADI    0x49444152  /* "RADI" - Radius */
 #define TAG_ROOT    0x544F4F52  /* "ROOT" - Merkle root */
 #define TAG_NONC    0x434E4F4E  /* "NONC" - Nonce */
+#define TAG_DELE    0x454C4544  /* "DELE" - Delegation */
+#define TAG_MINT    0x544E494D  /* "MINT" - Delegation start */
+#define TAG_MAXT    0x5458414D  /* "MAXT" - Delegation end */
 
 /* Response structure sizes */
-#define SIGNATURE_SIZE      64      /* Ed25519 signature */
-#define PUBKEY_SIZE         32      /* Ed25519 public key */
+#define SIGNATURE_SIZE      ED25519_SIG_SIZE
+#define PUBKEY_SIZE         ED25519_PUBKEY_SIZE
 #define NONCE_SIZE          64      /* Client nonce */
+#define HASH_SIZE           SHA512_DIGEST_SIZE
 #define TIMESTAMP_SIZE      8       /* Microseconds since epoch */
 #define RADIUS_SIZE         4       /* Uncertainty in microseconds */
 
+/* Requests are padded to at least this, so a reply is never larger */
+#define REQUEST_MIN_SIZE    1024
+#define REQUEST_MAX_SIZE    1280
+
+/* SIG, PATH, SREP, CERT, INDX with a full-depth path */
+#define RESPONSE_MAX_SIZE   640
+
+/* Batching: up to 16 nonces per signature (tree depth 4), collected for
+ * at most 10ms after the first one arrives */
+#define ROUGHTIME_BATCH_MAX     16
+#define ROUGHTIME_TREE_DEPTH    4
+#define ROUGHTIME_BATCH_US      10000
+
+/* Claimed accuracy, before adding the batch wait and signing time */
+#define ROUGHTIME_RADI_MIN_US   1000
+
+/* Delegation window: re-issued a day at a time, with an hour of slack
+ * back so a small step does not invalidate it */
+#define DELE_LIFETIME_US    (24ULL * 3600 * 1000000)
+#define DELE_SLACK_US       (3600ULL * 1000000)
+#define DELE_SIZE           72      /* PUBK, MINT, MAXT */
+#define CERT_SIZE           (16 + SIGNATURE_SIZE + DELE_SIZE)
+#define SREP_SIZE           (24 + RADIUS_SIZE + TIMESTAMP_SIZE + HASH_SIZE)
+
 /* NTP to Unix offset */
 #define NTP_UNIX_OFFSET     2208988800ULL
 /* Unix to Roughtime offset (Roughtime uses microseconds since Unix epoch) */
 
+/* Signature contexts, including the terminating NUL */
+static const char response_context[] = "RoughTime v1 response signature";
+static const char delegation_context[] = "RoughTime v1 delegation signature--";
+
 /*============================================================================
- * PRIVATE VARIABLES
+ * PRIVATE TYPES AND VARIABLES
  *============================================================================*/
 
+typedef struct {
+    uint32_t tag;
+    const void *data;
+    uint32_t len;
+} rt_field_t;
+
+typedef struct {
+    uint8_t nonce[NONCE_SIZE];
+    ip_addr_t addr;
+    u16_t port;
+} rt_request_t;
+
 static struct udp_pcb *roughtime_pcb = NULL;
-static uint32_t roughtime_requests = 0;
+static roughtime_stats_t roughtime_stats = {0};
 static bool roughtime_enabled = true;
 
-/* Dummy Ed25519 keypair (MUST be replaced with real keys in production) */
-static const uint8_t dummy_pubkey[PUBKEY_SIZE] = {
-    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
-    0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
-    0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
-    0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20
-};
+/* Long-term identity and the delegated online key */
+static ed25519_key_t longterm_key;
+static ed25519_key_t online_key;
+static uint8_t cert[CERT_SIZE];
+static uint64_t dele_mint_us = 0;
+static uint64_t dele_maxt_us = 0;
+static bool dele_valid = false;
+
+/* Requests queued by the receive callback, taken by the task under the
+ * lwIP lock */
+static rt_request_t pending[ROUGHTIME_BATCH_MAX];
+static uint32_t pending_count = 0;
+static uint32_t pending_since_us = 0;
+
+/* The batch being answered, and its tree (leaves at level 0) */
+static rt_request_t batch[ROUGHTIME_BATCH_MAX];
+static uint8_t tree[ROUGHTIME_TREE_DEPTH + 1][ROUGHTIME_BATCH_MAX][HASH_SIZE];
+
+static uint8_t rx_buf[REQUEST_MAX_SIZE];
+static uint8_t resp_buf[RESPONSE_MAX_SIZE];
 
 /*============================================================================
  * ROUGHTIME MESSAGE BUILDING
@@ -94,122 +164,252 @@ static void write_le64(uint8_t *buf, uint64_t val) {
     }
 }
 
+static uint32_t read_le32(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
 /**
- * Build Roughtime response
- * Returns response size, 0 on error
+ * Encode a message from fields already in ascending tag order
+ * Returns message size, 0 if it does not fit
  *
- * Note: This creates an UNSIGNED response. Real implementation
- * requires Ed25519 signing of the SREP content.
+ * Layout: tag count, n-1 value offsets, n tags, then the values.
  */
-static int build_response(uint8_t *resp, size_t max_len,
-                          const uint8_t *nonce, size_t nonce_len) {
-    if (max_len < 256) return 0;
+static uint32_t encode_message(uint8_t *out, size_t max_len,
+                               const rt_field_t *fields, uint32_t n) {
+    uint32_t header = 8 * n;
+    uint32_t total = header;
+
+    for (uint32_t i = 0; i < n; i++) {
+        total += fields[i].len;
+    }
+    if (total > max_len) return 0;
+
+    write_le32(out, n);
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (i > 0) {
+            write_le32(out + 4 * i, offset);
+        }
+        write_le32(out + 4 * n + 4 * i, fields[i].tag);
+        memcpy(out + header + offset, fields[i].data, fields[i].len);
+        offset += fields[i].len;
+    }
+    return total;
+}
 
-    /* Get current time as microseconds since Unix epoch */
+/**
+ * Find tag in a received message
+ * Returns its value, NULL if absent or the header is malformed
+ */
+static const uint8_t *find_tag(const uint8_t *msg, uint32_t len,
+                               uint32_t tag, uint32_t *value_len) {
+    if (len < 4) return NULL;
+
+    uint32_t n = read_le32(msg);
+    if (n == 0 || n > 64 || 8 * n > len) return NULL;
+
+    const uint8_t *values = msg + 8 * n;
+    uint32_t values_len = len - 8 * n;
+    uint32_t start = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t end = (i + 1 < n) ? read_le32(msg + 4 + 4 * i) : values_len;
+        if (end < start || end > values_len || (end & 3) != 0) {
+            return NULL;
+        }
+        if (read_le32(msg + 4 * n + 4 * i) == tag) {
+            *value_len = end - start;
+            return values + start;
+        }
+        start = end;
+    }
+    return NULL;
+}
+
+/**
+ * Microseconds since the Unix epoch
+ */
+static uint64_t roughtime_now_us(void) {
     timestamp_t ts = get_current_time();
     uint64_t unix_secs = ts.seconds - NTP_UNIX_OFFSET;
-    uint64_t midp_us = unix_secs * 1000000ULL +
-                       ((uint64_t)ts.fraction * 1000000ULL >> 32);
-
-    /* Radius (uncertainty) in microseconds - we claim 1ms precision */
-    uint32_t radi_us = 1000;
-
-    /*
-     * Roughtime message format:
-     * - 4 bytes: number of tags
-     * - 4 bytes per tag offset (n-1 offsets for n tags)
-     * - 4 bytes per tag value
-     * - variable: tag data
-     */
-
-    int pos = 0;
-
-    /* Build SREP (signed response) content first */
-    uint8_t srep[128];  /* Increased buffer size */
-    int srep_pos = 0;
-
-    /* SREP contains: ROOT, MIDP, RADI */
-    write_le32(srep + srep_pos, 3);  /* 3 tags */
-    srep_pos += 4;
-
-    /* Offsets (n-1 = 2 offsets) */
-    write_le32(srep + srep_pos, 32);  /* ROOT ends at offset 32 from data start */
-    srep_pos += 4;
-    write_le32(srep + srep_pos, 40);  /* MIDP ends at offset 40 */
-    srep_pos += 4;
-
-    /* Tags */
-    write_le32(srep + srep_pos, TAG_ROOT);
-    srep_pos += 4;
-    write_le32(srep + srep_pos, TAG_MIDP);
-    srep_pos += 4;
-    write_le32(srep + srep_pos, TAG_RADI);
-    srep_pos += 4;
-
-    /* ROOT (Merkle root - hash of nonce, simplified to nonce hash) */
-    /* In real implementation, this is SHA-512 hash */
-    memset(srep + srep_pos, 0, 32);  /* Placeholder */
-    if (nonce_len >= 32) {
-        memcpy(srep + srep_pos, nonce, 32);  /* Use nonce as placeholder */
+    return unix_secs * 1000000ULL + (((uint64_t)ts.fraction * 1000000ULL) >> 32);
+}
+
+/*============================================================================
+ * KEYS AND DELEGATION
+ *============================================================================*/
+
+/**
+ * Generate a fresh online key and have the long-term key sign it for
+ * [now - slack, now + lifetime]
+ */
+static void issue_delegation(uint64_t now_us) {
+    uint8_t seed[ED25519_SEED_SIZE];
+    uint8_t mint[TIMESTAMP_SIZE], maxt[TIMESTAMP_SIZE];
+    uint8_t dele[DELE_SIZE];
+    uint8_t signed_msg[sizeof(delegation_context) + DELE_SIZE];
+    uint8_t sig[SIGNATURE_SIZE];
+
+    for (int i = 0; i < ED25519_SEED_SIZE; i += 8) {
+        uint64_t r = get_rand_64();
+        memcpy(seed + i, &r, 8);
+    }
+    ed25519_key_from_seed(&online_key, seed);
+    memset(seed, 0, sizeof(seed));
+
+    dele_mint_us = now_us - DELE_SLACK_US;
+    dele_maxt_us = now_us + DELE_LIFETIME_US;
+    write_le64(mint, dele_mint_us);
+    write_le64(maxt, dele_maxt_us);
+
+    const rt_field_t dele_fields[] = {
+        { TAG_PUBK, online_key.pub, PUBKEY_SIZE },
+        { TAG_MINT, mint, TIMESTAMP_SIZE },
+        { TAG_MAXT, maxt, TIMESTAMP_SIZE },
+    };
+    encode_message(dele, sizeof(dele), dele_fields, 3);
+
+    memcpy(signed_msg, delegation_context, sizeof(delegation_context));
+    memcpy(signed_msg + sizeof(delegation_context), dele, DELE_SIZE);
+    ed25519_sign(&longterm_key, signed_msg, sizeof(signed_msg), sig);
+
+    const rt_field_t cert_fields[] = {
+        { TAG_SIG, sig, SIGNATURE_SIZE },
+        { TAG_DELE, dele, DELE_SIZE },
+    };
+    encode_message(cert, sizeof(cert), cert_fields, 2);
+
+    dele_valid = true;
+    roughtime_stats.delegations++;
+}
+
+/*============================================================================
+ * BATCH SIGNING
+ *============================================================================*/
+
+static void hash_node(uint8_t *out, const uint8_t *left, const uint8_t *right) {
+    static const uint8_t node_prefix = 0x01;
+    sha512_ctx_t ctx;
+
+    sha512_init(&ctx);
+    sha512_update(&ctx, &node_prefix, 1);
+    sha512_update(&ctx, left, HASH_SIZE);
+    sha512_update(&ctx, right, HASH_SIZE);
+    sha512_final(&ctx, out);
+}
+
+/**
+ * Hash n nonces into the tree; returns its depth. Leaves past n are
+ * zero: no reply's path runs through them.
+ */
+static uint32_t build_tree(uint32_t n) {
+    static const uint8_t leaf_prefix = 0x00;
+    uint32_t depth = 0;
+
+    while ((1u << depth) < n) {
+        depth++;
+    }
+
+    for (uint32_t i = 0; i < (1u << depth); i++) {
+        if (i < n) {
+            sha512_ctx_t ctx;
+            sha512_init(&ctx);
+            sha512_update(&ctx, &leaf_prefix, 1);
+            sha512_update(&ctx, batch[i].nonce, NONCE_SIZE);
+            sha512_final(&ctx, tree[0][i]);
+        } else {
+            memset(tree[0][i], 0, HASH_SIZE);
+        }
+    }
+
+    for (uint32_t level = 1; level <= depth; level++) {
+        for (uint32_t i = 0; i < (1u << (depth - level)); i++) {
+            hash_node(tree[level][i], tree[level - 1][2 * i], tree[level - 1][2 * i + 1]);
+        }
+    }
+    return depth;
+}
+
+/**
+ * Build request index's reply around the batch's SIG and SREP
+ * Returns response size, 0 on error
+ */
+static int build_response(uint8_t *resp, size_t max_len, uint32_t index,
+                          uint32_t depth, const uint8_t *sig,
+                          const uint8_t *srep) {
+    uint8_t path[ROUGHTIME_TREE_DEPTH * HASH_SIZE];
+    uint8_t indx[4];
+
+    /* Sibling at each level, leaf upwards */
+    for (uint32_t level = 0; level < depth; level++) {
+        memcpy(path + level * HASH_SIZE, tree[level][(index >> level) ^ 1], HASH_SIZE);
+    }
+    write_le32(indx, index);
+
+    const rt_field_t fields[] = {
+        { TAG_SIG, sig, SIGNATURE_SIZE },
+        { TAG_PATH, path, depth * HASH_SIZE },
+        { TAG_SREP, srep, SREP_SIZE },
+        { TAG_CERT, cert, CERT_SIZE },
+        { TAG_INDX, indx, 4 },
+    };
+    return (int)encode_message(resp, max_len, fields, 5);
+}
+
+/**
+ * Sign one SREP for the batch and send every reply
+ */
+static void answer_batch(uint32_t n, uint32_t waited_us) {
+    uint8_t radi[RADIUS_SIZE], midp[TIMESTAMP_SIZE];
+    uint8_t signed_msg[sizeof(response_context) + SREP_SIZE];
+    uint8_t *srep = signed_msg + sizeof(response_context);
+    uint8_t sig[SIGNATURE_SIZE];
+
+    uint64_t midp_us = roughtime_now_us();
+    if (!dele_valid || midp_us < dele_mint_us || midp_us >= dele_maxt_us) {
+        issue_delegation(midp_us);
+    }
+
+    uint32_t depth = build_tree(n);
+
+    /* Covers the wait since the first request and the time spent
+     * signing before the replies go out */
+    uint32_t radi_us = ROUGHTIME_RADI_MIN_US +
+        (waited_us > roughtime_stats.sign_us ? waited_us : roughtime_stats.sign_us);
+    write_le32(radi, radi_us);
+    write_le64(midp, midp_us);
+
+    const rt_field_t srep_fields[] = {
+        { TAG_RADI, radi, RADIUS_SIZE },
+        { TAG_MIDP, midp, TIMESTAMP_SIZE },
+        { TAG_ROOT, tree[depth][0], HASH_SIZE },
+    };
+    encode_message(srep, SREP_SIZE, srep_fields, 3);
+
+    uint32_t t0 = time_us_32();
+    memcpy(signed_msg, response_context, sizeof(response_context));
+    ed25519_sign(&online_key, signed_msg, sizeof(signed_msg), sig);
+    roughtime_stats.sign_us = time_us_32() - t0;
+
+    cyw43_arch_lwip_begin();
+    for (uint32_t i = 0; i < n; i++) {
+        int resp_len = build_response(resp_buf, sizeof(resp_buf), i, depth, sig, srep);
+        if (resp_len <= 0) continue;
+
+        struct pbuf *resp = pbuf_alloc(PBUF_TRANSPORT, resp_len, PBUF_RAM);
+        if (resp) {
+            memcpy(resp->payload, resp_buf, resp_len);
+            udp_sendto(roughtime_pcb, resp, &batch[i].addr, batch[i].port);
+            pbuf_free(resp);
+            roughtime_stats.requests++;
+        }
+    }
+    cyw43_arch_lwip_end();
+
+    roughtime_stats.batches++;
+    if (n > roughtime_stats.max_batch) {
+        roughtime_stats.max_batch = n;
     }
-    srep_pos += 32;
-
-    /* MIDP (timestamp midpoint) */
-    write_le64(srep + srep_pos, midp_us);
-    srep_pos += 8;
-
-    /* RADI (radius/uncertainty) */
-    write_le32(srep + srep_pos, radi_us);
-    srep_pos += 4;
-
-    /* Now build outer response: SIG, PATH, SREP, CERT, INDX */
-    write_le32(resp + pos, 5);  /* 5 tags */
-    pos += 4;
-
-    /* Offsets for 5 tags (4 offsets) */
-    int sig_end = 64;                      /* SIG: 64 bytes */
-    int path_end = sig_end + 0;            /* PATH: empty for single response */
-    int srep_end = path_end + srep_pos;    /* SREP: srep_pos bytes */
-    int cert_end = srep_end + 0;           /* CERT: empty (use long-term cert) */
-
-    write_le32(resp + pos, sig_end);
-    pos += 4;
-    write_le32(resp + pos, path_end);
-    pos += 4;
-    write_le32(resp + pos, srep_end);
-    pos += 4;
-    write_le32(resp + pos, cert_end);
-    pos += 4;
-
-    /* Tags */
-    write_le32(resp + pos, TAG_SIG);
-    pos += 4;
-    write_le32(resp + pos, TAG_PATH);
-    pos += 4;
-    write_le32(resp + pos, TAG_SREP);
-    pos += 4;
-    write_le32(resp + pos, TAG_CERT);
-    pos += 4;
-    write_le32(resp + pos, TAG_INDX);
-    pos += 4;
-
-    /* SIG (signature - DUMMY, needs Ed25519 implementation) */
-    memset(resp + pos, 0xAA, SIGNATURE_SIZE);  /* Placeholder signature */
-    pos += SIGNATURE_SIZE;
-
-    /* PATH (empty for single request) */
-
-    /* SREP */
-    memcpy(resp + pos, srep, srep_pos);
-    pos += srep_pos;
-
-    /* CERT (empty - would contain delegated certificate) */
-
-    /* INDX (index into batch - 0 for single response) */
-    write_le32(resp + pos, 0);
-    pos += 4;
-
-    return pos;
 }
 
 /*============================================================================
@@ -217,57 +417,48 @@ static int build_response(uint8_t *resp, size_t max_len,
  *============================================================================*/
 
 /**
- * UDP receive callback for Roughtime
+ * UDP receive callback for Roughtime: validate and queue the nonce
  */
 static void roughtime_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
                            const ip_addr_t *addr, u16_t port) {
     (void)arg;
+    (void)pcb;
 
     if (p == NULL || !roughtime_enabled) {
         if (p) pbuf_free(p);
         return;
     }
 
-    /* Parse request - minimum is a NONC tag */
-    if (p->tot_len < 12) {  /* 4 (num_tags) + 4 (tag) + 4 (min data) */
+    /* Undersized requests would make this an amplifier */
+    if (p->tot_len < REQUEST_MIN_SIZE) {
+        roughtime_stats.malformed++;
         pbuf_free(p);
         return;
     }
 
-    /* Extract nonce from request (simplified parsing) */
-    uint8_t nonce[NONCE_SIZE];
-    size_t nonce_len = 0;
-
-    uint8_t *data = (uint8_t *)p->payload;
-    uint32_t num_tags = data[0] | (data[1] << 8) |
-                        (data[2] << 16) | (data[3] << 24);
-
-    /* Look for NONC tag - simplified, assumes it's the only tag */
-    if (num_tags >= 1 && p->tot_len >= 12) {
-        /* Skip header, get nonce data */
-        int data_start = 4 + (num_tags - 1) * 4 + num_tags * 4;
-        if (data_start < (int)p->tot_len) {
-            nonce_len = p->tot_len - data_start;
-            if (nonce_len > NONCE_SIZE) nonce_len = NONCE_SIZE;
-            memcpy(nonce, data + data_start, nonce_len);
-        }
-    }
-
+    uint32_t len = pbuf_copy_partial(p, rx_buf, sizeof(rx_buf), 0);
     pbuf_free(p);
 
-    /* Build response */
-    uint8_t resp_buf[512];
-    int resp_len = build_response(resp_buf, sizeof(resp_buf), nonce, nonce_len);
+    uint32_t nonce_len = 0;
+    const uint8_t *nonce = find_tag(rx_buf, len, TAG_NONC, &nonce_len);
+    if (nonce == NULL || nonce_len != NONCE_SIZE) {
+        roughtime_stats.malformed++;
+        return;
+    }
 
-    if (resp_len > 0) {
-        struct pbuf *resp = pbuf_alloc(PBUF_TRANSPORT, resp_len, PBUF_RAM);
-        if (resp) {
-            memcpy(resp->payload, resp_buf, resp_len);
-            udp_sendto(pcb, resp, addr, port);
-            pbuf_free(resp);
-            roughtime_requests++;
-        }
+    if (pending_count >= ROUGHTIME_BATCH_MAX) {
+        roughtime_stats.dropped++;
+        return;
     }
+
+    rt_request_t *r = &pending[pending_count];
+    memcpy(r->nonce, nonce, NONCE_SIZE);
+    ip_addr_copy(r->addr, *addr);
+    r->port = port;
+    if (pending_count++ == 0) {
+        pending_since_us = time_us_32();
+    }
+    sched_post(SCHED_EV_ROUGHTIME);
 }
 
 /*============================================================================
@@ -278,9 +469,20 @@ static void roughtime_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
  * Initialize Roughtime server
  */
 void roughtime_init(void) {
+    uint8_t seed[ED25519_SEED_SIZE];
+
     printf("[ROUGHTIME] Initializing on UDP port %d\n", ROUGHTIME_PORT);
-    printf("[ROUGHTIME] WARNING: Using dummy keys - not cryptographically secure!\n");
-    printf("[ROUGHTIME] For production, implement Ed25519 signing\n");
+
+    /* Stable across reboots so clients can pin the public key */
+    unit_secret_derive("CHRONOS-Rb Roughtime long-term key", seed, sizeof(seed));
+    ed25519_key_from_seed(&longterm_key, seed);
+    memset(seed, 0, sizeof(seed));
+
+    printf("[ROUGHTIME] Public key: ");
+    for (int i = 0; i < PUBKEY_SIZE; i++) {
+        printf("%02x", longterm_key.pub[i]);
+    }
+    printf("\n");
 
     roughtime_pcb = udp_new();
     if (roughtime_pcb == NULL) {
@@ -297,7 +499,33 @@ void roughtime_init(void) {
     }
 
     udp_recv(roughtime_pcb, roughtime_recv, NULL);
-    printf("[ROUGHTIME] Server listening\n");
+    printf("[ROUGHTIME] Server listening, up to %d requests per signature\n",
+           ROUGHTIME_BATCH_MAX);
+}
+
+/**
+ * Answer the queued batch once its window has closed or it is full
+ */
+void roughtime_task(void) {
+    if (roughtime_pcb == NULL) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    uint32_t n = pending_count;
+    uint32_t waited_us = time_us_32() - pending_since_us;
+    if (n > 0 && n < ROUGHTIME_BATCH_MAX && waited_us < ROUGHTIME_BATCH_US) {
+        cyw43_arch_lwip_end();
+        sched_wake_at(pending_since_us + ROUGHTIME_BATCH_US);
+        return;
+    }
+    memcpy(batch, pending, n * sizeof(rt_request_t));
+    pending_count = 0;
+    cyw43_arch_lwip_end();
+
+    if (n > 0) {
+        answer_batch(n, waited_us);
+    }
 }
 
 /**
@@ -319,12 +547,19 @@ bool roughtime_is_enabled(void) {
  * Get request count
  */
 uint32_t roughtime_get_requests(void) {
-    return roughtime_requests;
+    return roughtime_stats.requests;
+}
+
+/**
+ * Get batching statistics
+ */
+void roughtime_get_stats(roughtime_stats_t *stats) {
+    *stats = roughtime_stats;
 }
 
 /**
  * Get public key (for client configuration)
  */
 const uint8_t *roughtime_get_pubkey(void) {
-    return dummy_pubkey;
+    return longterm_key.pub;
 }
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
@@ -18,6 +19,10 @@
 
 #include "chronos_rb.h"
 #include "gnss_input.h"
+#include "timing_core.h"
+#include "log_buffer.h"
+#include "ref_manager.h"
+#include "warm_start.h"
 
 /* Forward declaration */
 void set_time_unix(uint32_t unix_time);
@@ -32,12 +37,13 @@ static uint32_t state_pps_count = 0;
 
 /* Time tracking */
 static uint32_t current_seconds = 0;     /* Seconds since startup (or epoch if set) */
-static uint32_t subsecond_us = 0;        /* Microseconds within current second */
-static uint64_t last_pps_us = 0;         /* Timestamp of last PPS */
+static uint64_t last_pps_us = 0;         /* Time base anchor: last PPS, or holdover step */
+static uint32_t anchor_frac = 0;         /* NTP fraction at the anchor */
 static int64_t accumulated_offset = 0;   /* Accumulated time offset */
 
 /* GNSS time synchronization state */
 static uint32_t pending_gnss_time = 0;    /* GNSS time to set on next PPS */
+static uint64_t pending_gnss_edge_us = 0; /* GNSS PPS it refers to, 0 = unknown */
 static bool gnss_time_pending = false;    /* True if we have a GNSS time waiting */
 
 /* Rubidium status */
@@ -54,6 +60,77 @@ static uint32_t epoch_offset = 0;        /* Offset from Unix epoch */
  * Difference: 2208988800 seconds */
 #define NTP_UNIX_OFFSET 2208988800UL
 
+/* Clock model noise refit interval */
+#define NOISE_REFIT_US  64000000ULL
+
+/*============================================================================
+ * TIME BASE
+ *============================================================================*/
+
+/* NTP fraction units (2^-32 s) per microsecond in Q24: 2^56 / 1e6 */
+#define NTP_FRAC_PER_US_Q24     72057594038ULL
+
+/* Integer time base, republished on every PPS edge (and on set_time) so
+ * readers on either core convert a timer value to NTP time with one
+ * multiply and shift: no IRQ masking, no division, no floating point.
+ * The anchor carries a fraction: an edge sits at its phase within the
+ * UTC second (ref_manager.h), and in holdover there is no edge, so the
+ * timing core re-anchors mid-second as the clock model updates the rate. */
+typedef struct {
+    uint32_t ntp_seconds;       /* NTP seconds at the anchor edge */
+    uint32_t ntp_frac;          /* NTP fraction at the anchor */
+    uint64_t anchor_us;         /* time_us_64() at the anchor edge */
+    uint64_t frac_per_us_q24;   /* Disciplined NTP fraction per µs (Q24) */
+} time_base_t;
+
+/* Written only from the timing core (PPS IRQ or IRQs masked) */
+static seqlock_t time_base_lock;
+static time_base_t time_base = { NTP_UNIX_OFFSET, 0, 0, NTP_FRAC_PER_US_Q24 };
+static uint64_t frac_per_us_q24 = NTP_FRAC_PER_US_Q24;
+
+/**
+ * Publish the time base - caller must be in the PPS IRQ or have
+ * interrupts masked so the sequence is never left odd under a reader
+ */
+static void time_base_publish(void) {
+    seqlock_write_begin(&time_base_lock);
+    time_base.ntp_seconds = current_seconds + epoch_offset + NTP_UNIX_OFFSET;
+    time_base.ntp_frac = anchor_frac;
+    time_base.anchor_us = last_pps_us;
+    time_base.frac_per_us_q24 = frac_per_us_q24;
+    seqlock_write_end(&time_base_lock);
+}
+
+/**
+ * Fold the discipline correction (ppb) into the fixed-point rate.
+ * The only floating point on the time path, once per PPS.
+ */
+static void time_base_update_rate(void) {
+    double correction_ppb = discipline_get_correction();
+    int64_t adj = (int64_t)((double)NTP_FRAC_PER_US_Q24 * correction_ppb * 1e-9);
+    frac_per_us_q24 = NTP_FRAC_PER_US_Q24 - adj;
+}
+
+/**
+ * Re-anchor the time base now at the current discipline rate (timing
+ * core task context, holdover). Time is continuous across the anchor;
+ * only the rate from here on changes.
+ */
+static void time_base_reanchor(void) {
+    uint32_t irq = save_and_disable_interrupts();
+
+    uint64_t now = time_us_64();
+    timestamp_t ts = timestamp_from_us(now);
+    current_seconds = ts.seconds - epoch_offset - NTP_UNIX_OFFSET;
+    anchor_frac = ts.fraction;
+    last_pps_us = now;
+
+    time_base_update_rate();
+    time_base_publish();
+
+    restore_interrupts(irq);
+}
+
 /*============================================================================
  * INITIALIZATION
  *============================================================================*/
@@ -61,14 +138,15 @@ static uint32_t epoch_offset = 0;        /* Offset from Unix epoch */
 /**
  * Initialize rubidium synchronization
  *
- * Architecture: GNSS is primary time reference, Rb provides frequency stability
- * - GNSS PPS: Primary time source (absolute accuracy)
- * - Rb 10MHz: Frequency reference (stability)
- * - Rb PPS: Backup/holdover when GNSS lost
+ * Architecture: the reference manager (ref_manager.h) picks the PPS
+ * that drives the time base
+ * - Rb PPS: Primary edge source (short-term stability)
+ * - GNSS PPS: Steers the Rb edges to UTC; takes over if the Rb fails
+ * - Rb 10MHz: Cross-checks the Rb PPS divider chain
  */
 void rubidium_sync_init(void) {
     printf("[RB] Initializing time synchronization\n");
-    printf("[RB] Primary: GNSS PPS | Frequency: Rb 10MHz | Backup: Rb PPS\n");
+    printf("[RB] Edges: Rb PPS | Steering: GNSS PPS | Backup: GNSS PPS\n");
 
     current_state = SYNC_STATE_INIT;
     state_enter_time = time_us_64();
@@ -76,7 +154,6 @@ void rubidium_sync_init(void) {
 
     /* Initialize time to a default (will be set via NTP or manual) */
     current_seconds = 0;
-    subsecond_us = 0;
 
     g_time_state.sync_state = current_state;
     g_time_state.time_valid = false;
@@ -89,11 +166,11 @@ void rubidium_sync_init(void) {
  * Change state machine state
  */
 static void change_state(sync_state_t new_state) {
-    const char *state_names[] = {
+    static const char *const state_names[] = {
         "INIT", "FREQ_CAL", "COARSE", "FINE", "LOCKED", "HOLDOVER", "ERROR"
     };
     
-    printf("[RB] State change: %s -> %s\n", 
+    LOG_INFO(LOG_MOD_RB, "[RB] State change: %s -> %s\n", 
            state_names[current_state], state_names[new_state]);
     
     current_state = new_state;
@@ -110,44 +187,80 @@ static void change_state(sync_state_t new_state) {
  * Called from PPS capture IRQ on valid 1PPS edge
  */
 void pps_irq_handler(void) {
-    uint64_t pps_time = get_last_pps_timestamp();
-
     /* Note: freq_counter_pps_start() is called from pps_capture.c on every edge */
 
-    state_pps_count++;
-
-    /* Get offset from freq_counter which measures 10MHz cycles between PPS edges
-     * This gives 100ns resolution from the rubidium reference itself.
-     * freq_counter_get_error() = deviation from 10,000,000 cycles
-     * Each count = 100ns */
-    int64_t offset_ns = (int64_t)freq_counter_get_error() * 100LL;
+    int64_t interval_ns = get_last_pps_interval_ns();
+    int32_t phase_ns;
+    if (!ref_rb_edge(interval_ns, &phase_ns)) {
+        return;     /* GNSS is primary, or holdover */
+    }
+    time_pps_edge(get_last_pps_timestamp(), interval_ns, phase_ns);
+}
 
-    /* Update discipline loop with high-precision offset */
-    discipline_update(offset_ns);
+/**
+ * Anchor the time base on an edge of the primary reference (PPS IRQ, or
+ * the timing core with interrupts masked). interval_ns is the period
+ * since its previous edge in local-clock ns, 0 if unknown; phase_ns is
+ * UTC at the edge minus the whole second (ref_manager.h).
+ */
+void time_pps_edge(uint64_t edge_us, int64_t interval_ns, int32_t phase_ns) {
+    state_pps_count++;
 
-    /* Apply correction to subsecond counter */
-    accumulated_offset += offset_ns;
+    /* Time error of the disciplined time base over the last second.
+     * The PIO edge counter gives the reference period in local-clock ns
+     * at ~13ns resolution; the time base runs that clock scaled by the
+     * current correction, so the residual is what the loop must remove.
+     * Positive = our clock ahead. */
+    if (interval_ns != 0) {
+        double corrected_ns = (double)interval_ns *
+                              (1.0 - discipline_get_correction() * 1e-9);
+        int64_t offset_ns = (int64_t)llround(corrected_ns - 1e9);
+
+        /* Update discipline loop with high-precision offset */
+        discipline_update(offset_ns);
+
+        /* Apply correction to subsecond counter */
+        accumulated_offset += offset_ns;
+    }
 
-    last_pps_us = pps_time;
+    /* The edge sits phase_ns into its UTC second (NTP units) */
+    int64_t phase_frac = (int64_t)phase_ns * 4294967296LL / 1000000000LL;
+    uint32_t ntp_seconds;
 
     /* Apply pending GNSS time if waiting
      * GNSS NMEA arrives ~300ms after the PPS it refers to
-     * So pending_gnss_time is the time of the PREVIOUS GNSS second
-     * This PPS marks the start of the NEXT second */
+     * So pending_gnss_time is the time of the GNSS second that began at
+     * pending_gnss_edge_us; count whole seconds from there to this edge */
     if (gnss_time_pending) {
-        current_seconds = pending_gnss_time + 1;
+        int64_t since_us = (pending_gnss_edge_us != 0) ?
+                           (int64_t)(edge_us - pending_gnss_edge_us) : 1000000;
+        int64_t whole = llround(((double)since_us * 1e3 - phase_ns) * 1e-9);
+        ntp_seconds = pending_gnss_time + (uint32_t)whole + NTP_UNIX_OFFSET;
         epoch_offset = 0;
         gnss_time_pending = false;
         epoch_set = true;
     } else {
-        /* Normal increment */
-        current_seconds++;
+        /* Whole seconds from the time base itself, so a run of missed
+         * edges or a holdover with mid-second anchors lands on the
+         * right second */
+        timestamp_t at_edge = timestamp_from_us(edge_us);
+        uint64_t t = (((uint64_t)at_edge.seconds << 32) | at_edge.fraction) -
+                     (uint64_t)phase_frac;
+        ntp_seconds = (uint32_t)((t + 0x80000000ULL) >> 32);
     }
-    subsecond_us = 0;
+
+    uint64_t anchor = ((uint64_t)ntp_seconds << 32) + (uint64_t)phase_frac;
+    current_seconds = (uint32_t)(anchor >> 32) - epoch_offset - NTP_UNIX_OFFSET;
+    anchor_frac = (uint32_t)anchor;
+    last_pps_us = edge_us;
+
+    /* Republish the time base for this second */
+    time_base_update_rate();
+    time_base_publish();
 
     /* Update global time state */
     g_time_state.current_time.seconds = current_seconds;
-    g_time_state.current_time.fraction = 0;
+    g_time_state.current_time.fraction = anchor_frac;
 }
 
 /*============================================================================
@@ -163,10 +276,10 @@ static bool check_rb_lock(void) {
     bool locked = gpio_get(GPIO_RB_LOCK_STATUS);
     
     if (locked && !rb_lock_status) {
-        printf("[RB] Rubidium oscillator LOCKED\n");
+        LOG_INFO(LOG_MOD_RB, "[RB] Rubidium oscillator LOCKED\n");
         rb_lock_duration = 0;
     } else if (!locked && rb_lock_status) {
-        printf("[RB] WARNING: Rubidium oscillator UNLOCKED!\n");
+        LOG_WARN(LOG_MOD_RB, "[RB] WARNING: Rubidium oscillator UNLOCKED!\n");
     }
     
     rb_lock_status = locked;
@@ -179,27 +292,14 @@ static bool check_rb_lock(void) {
  * Main synchronization task - call periodically
  */
 void rubidium_sync_task(void) {
-    static uint64_t last_task_time = 0;
+    /* Scheduled at ~10Hz by the timing core */
     uint64_t now = time_us_64();
     
-    /* Run at ~10Hz */
-    if (now - last_task_time < 100000) {
-        return;
-    }
-    last_task_time = now;
-    
     /* Check rubidium lock status */
     bool rb_locked = check_rb_lock();
-    
-    /* Update subsecond counter */
-    if (last_pps_us > 0) {
-        subsecond_us = (now - last_pps_us) % 1000000;
-        
-        /* Apply frequency correction */
-        double correction = discipline_get_correction();
-        int64_t correction_ns = (int64_t)(subsecond_us * correction / 1e3);
-        /* Correction is applied in timestamp generation */
-    }
+
+    /* Score the references and pick the primary PPS */
+    ref_task();
     
     /* Update warmup timer */
     static uint64_t last_warmup_time = 0;
@@ -217,35 +317,57 @@ void rubidium_sync_task(void) {
     if (!epoch_set && !gnss_time_pending && gnss_has_time()) {
         uint32_t gnss_time = gnss_get_unix_time();
         if (gnss_time > 0) {
-            printf("[RB] Queueing GNSS time %lu for next PPS edge\n", gnss_time);
+            LOG_INFO(LOG_MOD_RB, "[RB] Queueing GNSS time %lu for next PPS edge\n", gnss_time);
+            uint64_t pps_us = gnss_get_last_pps_us();
             pending_gnss_time = gnss_time;
+            pending_gnss_edge_us = (pps_us != 0 && pps_us < gnss_get_last_nmea_us()) ? pps_us : 0;
             gnss_time_pending = true;
         }
     }
 
+    /* Keep the clock model's process noise in step with the measured
+     * Allan profile */
+    static uint64_t last_refit = 0;
+    if (now - last_refit >= NOISE_REFIT_US) {
+        discipline_refit_noise();
+        last_refit = now;
+    }
+
     /* State machine */
     uint64_t state_time = (now - state_enter_time) / 1000000;  /* Seconds in state */
     
     switch (current_state) {
-        case SYNC_STATE_INIT:
+        case SYNC_STATE_INIT: {
+            /* Warm start: Rb already locked and a fresh saved state, so
+             * the learned frequency is still good - skip calibration */
+            double integral_ppb;
+            if (warm_start_check(rb_locked, rb_warmup_time, &integral_ppb)) {
+                LOG_INFO(LOG_MOD_RB, "[RB] Warm start after %lu seconds, skipping calibration\n",
+                         rb_warmup_time);
+                discipline_warm_start(integral_ppb);
+                change_state(SYNC_STATE_FINE);
+                break;
+            }
+
             /* Wait for GNSS lock (primary) or Rb lock (backup) */
             if (gnss_has_time() && gnss_pps_valid()) {
-                printf("[RB] GNSS locked - primary time source acquired\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] GNSS locked - primary time source acquired\n");
                 change_state(SYNC_STATE_FREQ_CAL);
             } else if (rb_locked) {
-                printf("[RB] Rb locked after %lu seconds (GNSS not available)\n", rb_warmup_time);
-                printf("[RB] Using Rb as time source until GNSS acquired\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Rb locked after %lu seconds (GNSS not available)\n", rb_warmup_time);
+                LOG_INFO(LOG_MOD_RB, "[RB] Using Rb as time source until GNSS acquired\n");
                 change_state(SYNC_STATE_FREQ_CAL);
             } else if (state_time > 600) {  /* 10 minute timeout */
-                printf("[RB] ERROR: Neither GNSS nor Rb locked within 10 minutes\n");
+                LOG_ERR(LOG_MOD_RB, "[RB] ERROR: Neither GNSS nor Rb locked within 10 minutes\n");
                 change_state(SYNC_STATE_ERROR);
             }
             break;
+        }
             
         case SYNC_STATE_FREQ_CAL:
             /* Wait for frequency counter to stabilize */
             if (!freq_counter_signal_present()) {
-                printf("[RB] WARNING: 10MHz signal not detected!\n");
+                LOG_WARN(LOG_MOD_RB, "[RB] WARNING: 10MHz signal not detected!\n");
                 if (state_time > 30) {
                     change_state(SYNC_STATE_ERROR);
                 }
@@ -255,12 +377,13 @@ void rubidium_sync_task(void) {
             /* Need at least 10 PPS pulses for calibration */
             if (state_pps_count >= 10) {
                 double offset = get_frequency_offset_ppb();
-                printf("[RB] Frequency calibration complete: %.3f ppb offset\n", offset);
+                LOG_INFO(LOG_MOD_RB, "[RB] Frequency calibration complete: %ld ppt offset\n",
+                         (int32_t)lround(offset * 1000.0));
                 
                 if (fabs(offset) < 10000) {  /* Within 10 ppm is reasonable */
                     change_state(SYNC_STATE_COARSE);
                 } else {
-                    printf("[RB] WARNING: Large frequency offset detected\n");
+                    LOG_WARN(LOG_MOD_RB, "[RB] WARNING: Large frequency offset detected\n");
                     change_state(SYNC_STATE_COARSE);  /* Continue anyway */
                 }
             }
@@ -268,28 +391,25 @@ void rubidium_sync_task(void) {
             
         case SYNC_STATE_COARSE:
             /* Coarse time acquisition - need GNSS or Rb PPS */
-            if (!gnss_pps_valid() && !is_pps_valid()) {
-                printf("[RB] Lost all PPS signals!\n");
+            if (ref_get_primary() == REF_NONE) {
+                LOG_WARN(LOG_MOD_RB, "[RB] Lost all PPS signals!\n");
                 change_state(SYNC_STATE_ERROR);
                 break;
             }
 
             /* Wait for time to be set (via GNSS or NTP) or use default */
             if (epoch_set || state_pps_count >= 10) {
-                printf("[RB] Coarse sync complete, entering fine discipline\n");
-                if (gnss_pps_valid()) {
-                    printf("[RB] Using GNSS PPS as primary reference\n");
-                } else {
-                    printf("[RB] Using Rb PPS (GNSS not available)\n");
-                }
+                LOG_INFO(LOG_MOD_RB, "[RB] Coarse sync complete, entering fine discipline\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Using %s as primary reference\n",
+                         ref_source_name(ref_get_primary()));
                 change_state(SYNC_STATE_FINE);
             }
             break;
             
         case SYNC_STATE_FINE:
             /* Fine time discipline - GNSS primary, Rb backup */
-            if (!gnss_pps_valid() && !is_pps_valid()) {
-                printf("[RB] Lost all PPS signals, entering holdover\n");
+            if (ref_get_primary() == REF_NONE) {
+                LOG_WARN(LOG_MOD_RB, "[RB] Lost all PPS signals, entering holdover\n");
                 change_state(SYNC_STATE_HOLDOVER);
                 break;
             }
@@ -298,14 +418,14 @@ void rubidium_sync_task(void) {
             if (!gnss_pps_valid() && is_pps_valid()) {
                 static uint64_t last_gnss_warn = 0;
                 if (now - last_gnss_warn > 60000000) {  /* Every 60s */
-                    printf("[RB] GNSS PPS lost, using Rb PPS as backup\n");
+                    LOG_INFO(LOG_MOD_RB, "[RB] GNSS PPS lost, using Rb PPS as backup\n");
                     last_gnss_warn = now;
                 }
             }
 
             /* Check if we've achieved lock */
             if (discipline_is_locked() && state_pps_count >= 60) {
-                printf("[RB] Time discipline LOCKED - Stratum 1 quality achieved!\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Time discipline LOCKED - Stratum 1 quality achieved!\n");
                 change_state(SYNC_STATE_LOCKED);
                 g_time_state.time_valid = true;
             }
@@ -313,8 +433,8 @@ void rubidium_sync_task(void) {
             
         case SYNC_STATE_LOCKED:
             /* Monitor for loss of lock - GNSS primary, Rb backup */
-            if (!gnss_pps_valid() && !is_pps_valid()) {
-                printf("[RB] Lost all PPS signals, entering holdover\n");
+            if (ref_get_primary() == REF_NONE) {
+                LOG_WARN(LOG_MOD_RB, "[RB] Lost all PPS signals, entering holdover\n");
                 change_state(SYNC_STATE_HOLDOVER);
                 break;
             }
@@ -323,47 +443,52 @@ void rubidium_sync_task(void) {
             if (!gnss_pps_valid() && is_pps_valid()) {
                 static uint64_t last_gnss_lock_warn = 0;
                 if (now - last_gnss_lock_warn > 300000000) {  /* Every 5 min */
-                    printf("[RB] GNSS PPS lost, maintaining lock with Rb backup\n");
+                    LOG_INFO(LOG_MOD_RB, "[RB] GNSS PPS lost, maintaining lock with Rb backup\n");
                     last_gnss_lock_warn = now;
                 }
             }
 
             if (!discipline_is_locked()) {
-                printf("[RB] Lost time discipline lock, returning to fine sync\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Lost time discipline lock, returning to fine sync\n");
                 change_state(SYNC_STATE_FINE);
             }
             break;
             
         case SYNC_STATE_HOLDOVER:
-            /* Running on stored frequency offset - Rb provides holdover stability */
-            g_time_state.time_valid = (state_time < 3600);  /* Valid for 1 hour */
+            /* Steering from the clock model's prediction - Rb provides holdover stability */
+            if (discipline_holdover_update()) {
+                time_base_reanchor();
+            }
+            g_time_state.time_valid = (state_time < 3600) &&  /* Valid for 1 hour */
+                discipline_get_time_error_ns() < DISCIPLINE_HOLDOVER_MAX_ERR_NS;
 
             /* Check if GNSS (primary) restored */
-            if (gnss_pps_valid() && gnss_has_time()) {
-                printf("[RB] GNSS restored, returning to fine sync\n");
+            if (ref_get_primary() != REF_NONE && gnss_pps_valid() && gnss_has_time()) {
+                LOG_INFO(LOG_MOD_RB, "[RB] GNSS restored, returning to fine sync\n");
                 change_state(SYNC_STATE_FINE);
                 break;
             }
 
             /* Use Rb PPS as backup during GNSS holdover if available */
-            if (!gnss_pps_valid() && is_pps_valid() && rb_locked) {
+            if (ref_get_primary() == REF_RB_PPS && !gnss_pps_valid()) {
                 static uint32_t last_rb_backup_report = 0;
                 if (now / 1000000 - last_rb_backup_report >= 60) {
-                    printf("[RB] Using Rb PPS as backup (GNSS unavailable)\n");
+                    LOG_INFO(LOG_MOD_RB, "[RB] Using Rb PPS as backup (GNSS unavailable)\n");
                     last_rb_backup_report = now / 1000000;
                 }
                 /* Extended holdover validity with Rb backup */
-                g_time_state.time_valid = (state_time < 7200);  /* 2 hours with Rb */
+                g_time_state.time_valid = (state_time < 7200) &&  /* 2 hours with Rb */
+                    discipline_get_time_error_ns() < DISCIPLINE_HOLDOVER_MAX_ERR_NS;
 
                 /* If Rb is stable, can return to fine sync */
                 if (rb_lock_duration > 300) {  /* Rb stable for 5+ min */
-                    printf("[RB] Rb stable, returning to fine sync (GNSS-degraded mode)\n");
+                    LOG_INFO(LOG_MOD_RB, "[RB] Rb stable, returning to fine sync (GNSS-degraded mode)\n");
                     change_state(SYNC_STATE_FINE);
                 }
             }
 
             if (state_time > 86400) {  /* 24 hours */
-                printf("[RB] Extended holdover, time may be inaccurate\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Extended holdover, time may be inaccurate\n");
                 change_state(SYNC_STATE_ERROR);
             }
             break;
@@ -374,7 +499,7 @@ void rubidium_sync_task(void) {
 
             /* GNSS restored - return to normal operation */
             if (gnss_has_time() && gnss_pps_valid()) {
-                printf("[RB] GNSS restored, restarting sync\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] GNSS restored, restarting sync\n");
                 discipline_reset();
                 change_state(SYNC_STATE_FREQ_CAL);
                 break;
@@ -382,7 +507,7 @@ void rubidium_sync_task(void) {
 
             /* Rb available as backup */
             if (rb_locked && is_pps_valid()) {
-                printf("[RB] Rb available as backup, restarting sync (degraded mode)\n");
+                LOG_INFO(LOG_MOD_RB, "[RB] Rb available as backup, restarting sync (degraded mode)\n");
                 discipline_reset();
                 change_state(SYNC_STATE_FREQ_CAL);
             }
@@ -399,92 +524,130 @@ void rubidium_sync_task(void) {
  */
 void time_init(void) {
     current_seconds = 0;
-    subsecond_us = 0;
+    last_pps_us = 0;
     epoch_set = false;
     accumulated_offset = 0;
+    frac_per_us_q24 = NTP_FRAC_PER_US_Q24;
+
+    uint32_t irq = save_and_disable_interrupts();
+    time_base_publish();
+    restore_interrupts(irq);
 }
 
 /**
- * Get current time as timestamp
+ * Convert a time_us_64() value to an NTP timestamp
+ *
+ * Lock-free and integer-only; safe from any core or IRQ. The timer value
+ * may precede the latest PPS edge (e.g. a receive stamp taken before the
+ * edge and converted after it).
  */
-timestamp_t get_current_time(void) {
-    timestamp_t ts;
-    uint64_t now = time_us_64();
-    
-    /* Calculate subseconds since last PPS */
-    uint32_t sub_us;
-    uint32_t sec;
-    
-    uint32_t irq = save_and_disable_interrupts();
-    sec = current_seconds;
-    if (last_pps_us > 0 && now >= last_pps_us) {
-        sub_us = (now - last_pps_us) % 1000000;
+timestamp_t timestamp_from_us(uint64_t timer_us) {
+    time_base_t tb;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&time_base_lock);
+        tb = time_base;
+    } while (seqlock_read_retry(&time_base_lock, seq));
+
+    uint32_t sec = tb.ntp_seconds;
+    uint64_t elapsed_us;
+
+    if (timer_us >= tb.anchor_us) {
+        elapsed_us = timer_us - tb.anchor_us;
+        if (elapsed_us >= 1000000) {
+            /* PPS missing - freewheel whole seconds */
+            uint32_t whole = (uint32_t)(elapsed_us / 1000000);
+            sec += whole;
+            elapsed_us -= (uint64_t)whole * 1000000;
+        }
     } else {
-        sub_us = subsecond_us;
+        uint64_t before_us = tb.anchor_us - timer_us;
+        uint32_t whole = (uint32_t)((before_us + 999999) / 1000000);
+        sec -= whole;
+        elapsed_us = (uint64_t)whole * 1000000 - before_us;
     }
-    restore_interrupts(irq);
-    
-    /* Apply frequency correction */
-    double correction = discipline_get_correction();
-    int64_t correction_ns = (int64_t)(sub_us * correction / 1e3);
-    sub_us -= correction_ns / 1000;
-    
-    /* Convert to NTP timestamp format */
-    ts.seconds = sec + NTP_UNIX_OFFSET + epoch_offset;
-    
-    /* Convert microseconds to NTP fraction (2^32 / 1e6) */
-    ts.fraction = (uint32_t)((uint64_t)sub_us * 4294967296ULL / 1000000ULL);
-    
+
+    /* elapsed < 1e6 and rate < 2^37, so the product fits in 64 bits */
+    uint64_t frac = tb.ntp_frac + ((elapsed_us * tb.frac_per_us_q24) >> 24);
+    if (frac > 0xFFFFFFFFULL) {
+        sec += (uint32_t)(frac >> 32);
+        frac &= 0xFFFFFFFFULL;
+    }
+
+    timestamp_t ts;
+    ts.seconds = sec;
+    ts.fraction = (uint32_t)frac;
     return ts;
 }
 
 /**
- * Get current time in microseconds since some epoch
+ * Get current time as timestamp
+ */
+timestamp_t get_current_time(void) {
+    return timestamp_from_us(time_us_64());
+}
+
+/**
+ * Get current time in microseconds since Unix epoch
  */
 uint64_t get_time_us(void) {
     uint64_t now = time_us_64();
-    
-    uint32_t irq = save_and_disable_interrupts();
-    uint32_t sec = current_seconds;
-    uint64_t pps = last_pps_us;
-    restore_interrupts(irq);
-    
-    if (pps > 0 && now >= pps) {
-        return (uint64_t)sec * 1000000ULL + (now - pps);
+
+    time_base_t tb;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&time_base_lock);
+        tb = time_base;
+    } while (seqlock_read_retry(&time_base_lock, seq));
+
+    uint64_t us = (uint64_t)(tb.ntp_seconds - NTP_UNIX_OFFSET) * 1000000ULL +
+                  (((uint64_t)tb.ntp_frac * 1000000ULL) >> 32);
+    if (now >= tb.anchor_us) {
+        return us + (now - tb.anchor_us);
     }
-    
-    return (uint64_t)sec * 1000000ULL;
+
+    return us;
 }
 
 /**
- * Set the current time
+ * Set the current time (timing core only)
  */
 void set_time(timestamp_t *ts) {
     uint32_t irq = save_and_disable_interrupts();
-    
+
     /* Calculate epoch offset from provided time */
     current_seconds = ts->seconds - NTP_UNIX_OFFSET;
     epoch_offset = 0;
     epoch_set = true;
-    
+    if (last_pps_us == 0) {
+        last_pps_us = time_us_64();  /* No PPS yet - anchor here */
+    }
+    anchor_frac = 0;
+    time_base_publish();
+
     restore_interrupts(irq);
-    
-    printf("[RB] Time set to %lu seconds (NTP epoch)\n", ts->seconds);
+
+    printf("[RB] Time set to %" PRIu32 " seconds (NTP epoch)\n", ts->seconds);
 }
 
 /**
- * Set time from Unix timestamp
+ * Set time from Unix timestamp (timing core only)
  */
 void set_time_unix(uint32_t unix_time) {
     uint32_t irq = save_and_disable_interrupts();
-    
+
     current_seconds = unix_time;
     epoch_offset = 0;
     epoch_set = true;
-    
+    if (last_pps_us == 0) {
+        last_pps_us = time_us_64();  /* No PPS yet - anchor here */
+    }
+    anchor_frac = 0;
+    time_base_publish();
+
     restore_interrupts(irq);
-    
-    printf("[RB] Time set to Unix timestamp %lu\n", unix_time);
+
+    printf("[RB] Time set to Unix timestamp %" PRIu32 "\n", unix_time);
 }
 
 /**
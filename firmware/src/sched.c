@@ -0,0 +1,227 @@
+/**
+ * CHRONOS-Rb Task Scheduler
+ *
+ * Task tables are only touched by their own core. The pending event
+ * word is the one shared field: IRQs and the other core OR bits in
+ * atomically, and dispatch swaps it for zero at the start of a pass.
+ *
+ * The idle sleep arms a per-core hardware alarm for the next deadline
+ * and executes WFE. Every way out of the sleep sets the event register
+ * first (sched_post and the alarm callback both SEV, and so does any
+ * interrupt taken), so a wakeup that lands between the checks and the
+ * WFE is never lost.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#include "sched.h"
+
+/*============================================================================
+ * PRIVATE DEFINITIONS
+ *============================================================================*/
+
+typedef struct {
+    const char *name;
+    sched_fn_t fn;
+    uint32_t period_us;
+    uint32_t events;
+    uint32_t next_us;           /* Next periodic deadline */
+    uint32_t wake_us;           /* Deadline requested by the task */
+    bool wake_set;
+    uint32_t runs;
+    uint32_t max_us;
+} sched_task_t;
+
+typedef struct {
+    sched_task_t tasks[SCHED_MAX_TASKS];
+    volatile uint8_t count;
+    volatile uint32_t pending;  /* Latched SCHED_EV_* bits */
+    uint32_t event_mask;        /* Events any task here listens for */
+    int alarm;                  /* Hardware alarm for the idle sleep */
+    sched_task_t *current;      /* Task being called, for sched_wake_at() */
+    uint32_t passes;
+    uint32_t sleeps;
+    uint64_t busy_us;
+    uint64_t since_us;
+} sched_core_t;
+
+static sched_core_t cores[2] = {
+    { .alarm = -1 },
+    { .alarm = -1 },
+};
+
+static inline bool deadline_reached(uint32_t now, uint32_t deadline) {
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static void sched_alarm_fired(uint alarm_num) {
+    (void)alarm_num;
+    __sev();
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+int sched_add(const char *name, sched_fn_t fn, uint32_t period_us, uint32_t events) {
+    sched_core_t *s = &cores[get_core_num()];
+
+    if (s->count >= SCHED_MAX_TASKS) {
+        printf("[SCHED] Task table full, '%s' not registered\n", name);
+        return -1;
+    }
+
+    uint32_t now = time_us_32();
+    sched_task_t *t = &s->tasks[s->count];
+
+    memset(t, 0, sizeof(sched_task_t));
+    t->name = name;
+    t->fn = fn;
+    t->period_us = period_us;
+    t->events = events;
+    t->next_us = now;
+    t->wake_us = now;
+    t->wake_set = true;         /* First call on the next pass */
+
+    if (s->count == 0) {
+        s->since_us = time_us_64();
+    }
+    s->event_mask |= events;
+    __dmb();
+    return s->count++;
+}
+
+void sched_post(uint32_t events) {
+    __atomic_fetch_or(&cores[0].pending, events, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&cores[1].pending, events, __ATOMIC_RELEASE);
+    __sev();
+}
+
+void sched_wake_at(uint32_t when_us) {
+    sched_task_t *t = cores[get_core_num()].current;
+    if (t == NULL) {
+        return;
+    }
+
+    if (!t->wake_set || (int32_t)(when_us - t->wake_us) < 0) {
+        t->wake_us = when_us;
+        t->wake_set = true;
+    }
+}
+
+void sched_wake_in(uint32_t delay_us) {
+    sched_wake_at(time_us_32() + delay_us);
+}
+
+bool sched_dispatch(void) {
+    sched_core_t *s = &cores[get_core_num()];
+    uint32_t events = __atomic_exchange_n(&s->pending, 0, __ATOMIC_ACQUIRE);
+    bool ran = false;
+
+    for (int i = 0; i < s->count; i++) {
+        sched_task_t *t = &s->tasks[i];
+        uint32_t now = time_us_32();
+
+        bool periodic = t->period_us != 0 && deadline_reached(now, t->next_us);
+        bool woken = t->wake_set && deadline_reached(now, t->wake_us);
+
+        if (!periodic && !woken && (events & t->events) == 0) {
+            continue;
+        }
+
+        if (periodic) {
+            /* Keep the phase unless we fell a whole period behind */
+            t->next_us += t->period_us;
+            if (deadline_reached(now, t->next_us)) {
+                t->next_us = now + t->period_us;
+            }
+        }
+        t->wake_set = false;
+
+        s->current = t;
+        t->fn();
+        s->current = NULL;
+
+        uint32_t elapsed = time_us_32() - now;
+        if (elapsed > t->max_us) {
+            t->max_us = elapsed;
+        }
+        t->runs++;
+        s->busy_us += elapsed;
+        ran = true;
+    }
+
+    if (ran) {
+        s->passes++;
+    }
+    return ran;
+}
+
+void sched_idle(void) {
+    sched_core_t *s = &cores[get_core_num()];
+    uint32_t now = time_us_32();
+    int32_t sleep_us = SCHED_MAX_SLEEP_US;
+
+    for (int i = 0; i < s->count; i++) {
+        const sched_task_t *t = &s->tasks[i];
+        if (t->period_us != 0) {
+            int32_t d = (int32_t)(t->next_us - now);
+            if (d < sleep_us) sleep_us = d;
+        }
+        if (t->wake_set) {
+            int32_t d = (int32_t)(t->wake_us - now);
+            if (d < sleep_us) sleep_us = d;
+        }
+    }
+
+    if (sleep_us <= 0 || (s->pending & s->event_mask) != 0) {
+        return;
+    }
+
+    /* Claimed on first use so the IRQ lands on this core */
+    if (s->alarm < 0) {
+        s->alarm = hardware_alarm_claim_unused(true);
+        hardware_alarm_set_callback(s->alarm, sched_alarm_fired);
+    }
+
+    /* A target already in the past means the deadline is here */
+    if (hardware_alarm_set_target(s->alarm, delayed_by_us(get_absolute_time(), sleep_us))) {
+        return;
+    }
+
+    s->sleeps++;
+    __wfe();
+}
+
+void sched_get_stats(uint32_t core, sched_stats_t *stats) {
+    const sched_core_t *s = &cores[core & 1];
+
+    stats->tasks = s->count;
+    stats->passes = s->passes;
+    stats->sleeps = s->sleeps;
+    stats->busy_us = s->busy_us;
+    stats->since_us = s->since_us;
+}
+
+bool sched_get_task_stats(uint32_t core, int index, sched_task_stats_t *stats) {
+    const sched_core_t *s = &cores[core & 1];
+
+    if (index < 0 || index >= s->count) {
+        return false;
+    }
+
+    const sched_task_t *t = &s->tasks[index];
+    stats->name = t->name;
+    stats->period_us = t->period_us;
+    stats->events = t->events;
+    stats->runs = t->runs;
+    stats->max_us = t->max_us;
+    return true;
+}
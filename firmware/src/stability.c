@@ -0,0 +1,179 @@
+/**
+ * CHRONOS-Rb Frequency Stability Estimator
+ *
+ * Octave level k (tau = m = 2^k seconds) stores every stride-th phase
+ * sample, stride = m / lag with lag = min(m, STAB_OVERLAP), so a tau spans
+ * lag stored samples. Per stored sample:
+ *
+ *   ADEV term  d = x[n] - 2x[n-m] + x[n-2m]
+ *   MDEV term  D = S[n] - 3S[n-m] + 3S[n-2m] - S[n-3m]
+ *
+ * where S is the running sum of phase, so D is the sum of m consecutive
+ * second differences without storing them. Then
+ *
+ *   ADEV^2 = <d^2> / (2 tau^2)
+ *   MDEV^2 = <D^2> / (2 m^2 tau^2)
+ *   TDEV   = tau * MDEV / sqrt(3)
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "stability.h"
+#include "timing_core.h"
+
+/*============================================================================
+ * PRIVATE DEFINITIONS
+ *============================================================================*/
+
+#define STAB_RING               (3 * STAB_OVERLAP + 1)
+
+typedef struct {
+    uint32_t stride;            /* Input samples per stored sample */
+    uint32_t lag;               /* Stored samples per tau */
+    uint32_t countdown;         /* Input samples until the next store */
+    uint8_t head;               /* Next ring slot */
+    uint8_t count;              /* Valid ring entries */
+    int64_t x[STAB_RING];       /* Phase (ns) */
+    int64_t s[STAB_RING];       /* Running phase sum (ns) */
+    double adev_sum;            /* Sum of d^2 (ns^2) */
+    double mdev_sum;            /* Sum of D^2 (ns^2) */
+    uint32_t adev_n;
+    uint32_t mdev_n;
+} stab_level_t;
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+/* Written from the PPS path on the timing core, read from anywhere */
+static seqlock_t stab_lock;
+static stab_level_t levels[STAB_LEVELS];
+static int64_t phase_sum = 0;
+static uint32_t samples = 0;
+
+/*============================================================================
+ * PRIVATE FUNCTIONS
+ *============================================================================*/
+
+/* Ring entry 'back' samples before the newest */
+static inline uint32_t ring_idx(const stab_level_t *l, uint32_t back) {
+    return (l->head + STAB_RING - 1 - back) % STAB_RING;
+}
+
+/**
+ * Store one decimated sample and accumulate the new second differences
+ */
+static void level_push(stab_level_t *l, int64_t x, int64_t s) {
+    l->x[l->head] = x;
+    l->s[l->head] = s;
+    l->head = (l->head + 1) % STAB_RING;
+    if (l->count < STAB_RING) {
+        l->count++;
+    }
+
+    uint32_t lag = l->lag;
+
+    if (l->count > 2 * lag) {
+        int64_t d = l->x[ring_idx(l, 0)]
+                  - 2 * l->x[ring_idx(l, lag)]
+                  + l->x[ring_idx(l, 2 * lag)];
+        l->adev_sum += (double)d * (double)d;
+        l->adev_n++;
+    }
+
+    if (l->count > 3 * lag) {
+        int64_t D = l->s[ring_idx(l, 0)]
+                  - 3 * l->s[ring_idx(l, lag)]
+                  + 3 * l->s[ring_idx(l, 2 * lag)]
+                  - l->s[ring_idx(l, 3 * lag)];
+        l->mdev_sum += (double)D * (double)D;
+        l->mdev_n++;
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void stability_reset(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    seqlock_write_begin(&stab_lock);
+
+    memset(levels, 0, sizeof(levels));
+    for (int k = 0; k < STAB_LEVELS; k++) {
+        uint32_t m = 1u << k;
+        levels[k].lag = (m < STAB_OVERLAP) ? m : STAB_OVERLAP;
+        levels[k].stride = m / levels[k].lag;
+    }
+    phase_sum = 0;
+    samples = 0;
+
+    seqlock_write_end(&stab_lock);
+    restore_interrupts(irq);
+}
+
+void stability_add_phase(int64_t phase_ns) {
+    seqlock_write_begin(&stab_lock);
+
+    phase_sum += phase_ns;
+    samples++;
+
+    for (int k = 0; k < STAB_LEVELS; k++) {
+        stab_level_t *l = &levels[k];
+        if (l->countdown > 0) {
+            l->countdown--;
+            continue;
+        }
+        l->countdown = l->stride - 1;
+        level_push(l, phase_ns, phase_sum);
+    }
+
+    seqlock_write_end(&stab_lock);
+}
+
+int stability_get(stability_point_t *out, int max) {
+    int n = (max < STAB_LEVELS) ? max : STAB_LEVELS;
+    double adev_sum[STAB_LEVELS];
+    double mdev_sum[STAB_LEVELS];
+    uint32_t seq;
+
+    do {
+        seq = seqlock_read_begin(&stab_lock);
+        for (int k = 0; k < n; k++) {
+            adev_sum[k] = levels[k].adev_sum;
+            mdev_sum[k] = levels[k].mdev_sum;
+            out[k].adev_n = levels[k].adev_n;
+            out[k].mdev_n = levels[k].mdev_n;
+        }
+    } while (seqlock_read_retry(&stab_lock, seq));
+
+    for (int k = 0; k < n; k++) {
+        double tau = (double)(1u << k);
+        stability_point_t *p = &out[k];
+
+        p->tau_s = 1u << k;
+        p->adev = 0.0;
+        p->mdev = 0.0;
+        p->tdev = 0.0;
+
+        if (p->adev_n > 0) {
+            p->adev = sqrt(adev_sum[k] / (2.0 * p->adev_n * tau * tau)) * 1e-9;
+        }
+        if (p->mdev_n > 0) {
+            p->mdev = sqrt(mdev_sum[k] / (2.0 * p->mdev_n * tau * tau * tau * tau)) * 1e-9;
+            p->tdev = tau * p->mdev / sqrt(3.0);
+        }
+    }
+
+    return n;
+}
+
+uint32_t stability_get_samples(void) {
+    return samples;
+}
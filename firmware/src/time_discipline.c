@@ -2,7 +2,10 @@
  * CHRONOS-Rb Time Discipline Module
  * 
  * Implements a PI (Proportional-Integral) controller to discipline the
- * system time to the rubidium 1PPS reference.
+ * system time to the rubidium 1PPS reference, or steers from the
+ * Kalman clock model (clock_model.c). The model runs in both modes: it
+ * carries holdover, when it steers from prediction alone, and its time
+ * error bound feeds NTP root dispersion and PTP clockAccuracy.
  * 
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -11,10 +14,15 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
 
 #include "chronos_rb.h"
+#include "stability.h"
+#include "metrics.h"
+#include "clock_model.h"
 
 /*============================================================================
  * DISCIPLINE PARAMETERS
@@ -32,16 +40,18 @@ static double integral_term = 0.0;
 static double last_offset_ns = 0.0;
 static double frequency_correction = 0.0;  /* ppb */
 
-/* Offset statistics */
-#define OFFSET_HISTORY_SIZE 128
-static int64_t offset_history[OFFSET_HISTORY_SIZE];
-static uint32_t offset_history_index = 0;
-static uint32_t offset_history_count = 0;
+/* Steering law and the clock model behind it */
+static bool kalman_steering = DISCIPLINE_KALMAN_DEFAULT;
+static clock_model_t model;
+static uint64_t last_holdover_us = 0;          /* 0 = PPS updates running */
 
-/* Allan deviation calculation */
-static double allan_dev_1s = 0.0;
-static double allan_dev_10s = 0.0;
-static double allan_dev_100s = 0.0;
+/* Frequency uncertainty of a warm-start seed */
+#define WARM_SEED_SIGMA_PPB     10.0
+
+/* Phase of the disciplined time base against the Rb PPS, fed to the
+ * stability estimator. Each offset is the time error accumulated over one
+ * PPS interval (a frequency sample), so phase is their running sum. */
+static int64_t stability_phase_ns = 0;
 
 /* State tracking */
 static uint32_t discipline_updates = 0;
@@ -49,6 +59,9 @@ static uint32_t lock_count = 0;
 static bool is_locked = false;
 static uint64_t last_update_time = 0;
 
+static void discipline_pi_update(int64_t offset_ns, double dt);
+static void discipline_check_lock(int64_t offset_ns);
+
 /*============================================================================
  * INITIALIZATION
  *============================================================================*/
@@ -58,7 +71,7 @@ static uint64_t last_update_time = 0;
  */
 void discipline_init(void) {
     printf("[DISC] Initializing time discipline loop\n");
-    printf("[DISC] Kp=%.3f, Ki=%.3f, Tau=%lu\n", kp, ki, tau);
+    printf("[DISC] Kp=%.3f, Ki=%.3f, Tau=%" PRIu32 "\n", kp, ki, tau);
     
     /* Clear state */
     integral_term = 0.0;
@@ -68,10 +81,10 @@ void discipline_init(void) {
     lock_count = 0;
     is_locked = false;
     
-    /* Clear history */
-    memset(offset_history, 0, sizeof(offset_history));
-    offset_history_index = 0;
-    offset_history_count = 0;
+    /* Clear stability estimates */
+    stability_phase_ns = 0;
+    stability_reset();
+    clock_model_reset(&model);
     
     last_update_time = time_us_64();
 }
@@ -95,14 +108,28 @@ void discipline_update(int64_t offset_ns) {
         dt = 1.0;  /* Default to 1 second */
     }
     
-    /* Store in history */
-    offset_history[offset_history_index] = offset_ns;
-    offset_history_index = (offset_history_index + 1) % OFFSET_HISTORY_SIZE;
-    if (offset_history_count < OFFSET_HISTORY_SIZE) {
-        offset_history_count++;
+    /* Feed the streaming ADEV/MDEV/TDEV estimator */
+    stability_phase_ns += offset_ns;
+    stability_add_phase(stability_phase_ns);
+
+    /* Back from holdover: the PI integrator resumes from the model's
+     * last correction, not from where the PPS left it */
+    if (last_holdover_us != 0) {
+        last_holdover_us = 0;
+        if (!kalman_steering) {
+            integral_term = frequency_correction * 1e-9;
+        }
     }
+
+    /* Clock model: the correction applied over this interval is its
+     * control input, the accumulated phase its measurement */
+    clock_model_predict(&model, dt, frequency_correction);
+    clock_model_update(&model, (double)stability_phase_ns);
     
     /* Update statistics */
+    metrics_observe(METRIC_DISCIPLINE_OFFSET,
+                    offset_ns > INT32_MAX ? INT32_MAX :
+                    offset_ns < INT32_MIN ? INT32_MIN : (int32_t)offset_ns);
     g_time_state.offset_ns = offset_ns;
     if (offset_ns < g_stats.min_offset_ns || g_stats.min_offset_ns == 0) {
         g_stats.min_offset_ns = offset_ns;
@@ -115,6 +142,40 @@ void discipline_update(int64_t offset_ns) {
     double alpha = 0.01;
     g_stats.avg_offset_ns = alpha * offset_ns + (1.0 - alpha) * g_stats.avg_offset_ns;
     
+    if (kalman_steering) {
+        double correction_ppb = clock_model_steer(&model, dt, (double)tau);
+        if (correction_ppb > 100e3) {
+            correction_ppb = 100e3;     /* Same 100 ppm bound as the PI integral */
+        } else if (correction_ppb < -100e3) {
+            correction_ppb = -100e3;
+        }
+        frequency_correction = correction_ppb;
+        integral_term = model.x[1] * 1e-9;  /* Kept for warm start and display */
+    } else {
+        discipline_pi_update(offset_ns, dt);
+    }
+
+    /* Update global state */
+    g_time_state.frequency_offset = frequency_correction;
+    g_time_state.drift_rate = model.x[2];
+    
+    discipline_check_lock(offset_ns);
+
+    discipline_updates++;
+    last_offset_ns = (double)offset_ns;
+    
+    /* Debug output every 10 updates */
+    if (discipline_updates % 10 == 0) {
+        printf("[DISC] Update %" PRIu32 ": offset=%" PRId64 " ns, correction=%.3f ppb, locked=%s\n",
+               discipline_updates, offset_ns, frequency_correction,
+               is_locked ? "YES" : "NO");
+    }
+}
+
+/**
+ * Fixed-gain PI step
+ */
+static void discipline_pi_update(int64_t offset_ns, double dt) {
     /* Calculate PI controller output */
     double offset_s = offset_ns / 1e9;  /* Convert to seconds */
     
@@ -124,8 +185,10 @@ void discipline_update(int64_t offset_ns) {
     /* Integral term with anti-windup */
     integral_term += ki * offset_s * dt;
     
-    /* Limit integral term to prevent windup */
-    double max_integral = 100e-9;  /* 100 ppb max integral contribution */
+    /* Limit integral term to prevent windup. The offset is measured
+     * against the local crystal, so the integral must be able to carry
+     * its whole tolerance. */
+    double max_integral = 100e-6;  /* 100 ppm max integral contribution */
     if (integral_term > max_integral) {
         integral_term = max_integral;
     } else if (integral_term < -max_integral) {
@@ -137,10 +200,12 @@ void discipline_update(int64_t offset_ns) {
     
     /* Convert to ppb */
     frequency_correction = correction * 1e9;
-    
-    /* Update global state */
-    g_time_state.frequency_offset = frequency_correction;
-    
+}
+
+/**
+ * Lock detection and the gain/time constant switch that goes with it
+ */
+static void discipline_check_lock(int64_t offset_ns) {
     /* Check for lock */
     double abs_offset = fabs((double)offset_ns);
     if (abs_offset <= 1000.0) {  /* Within 1 microsecond */
@@ -158,7 +223,7 @@ void discipline_update(int64_t offset_ns) {
         }
     } else if (abs_offset > 10000.0) {  /* More than 10 microseconds */
         if (is_locked) {
-            printf("[DISC] Lost lock (offset = %lld ns)\n", offset_ns);
+            printf("[DISC] Lost lock (offset = %" PRId64 " ns)\n", offset_ns);
             is_locked = false;
             
             /* Switch back to fast time constant */
@@ -168,16 +233,100 @@ void discipline_update(int64_t offset_ns) {
         }
         lock_count = 0;
     }
-    
-    discipline_updates++;
-    last_offset_ns = (double)offset_ns;
-    
-    /* Debug output every 10 updates */
-    if (discipline_updates % 10 == 0) {
-        printf("[DISC] Update %lu: offset=%lld ns, correction=%.3f ppb, locked=%s\n",
-               discipline_updates, offset_ns, frequency_correction,
-               is_locked ? "YES" : "NO");
+}
+
+/**
+ * Holdover step: no PPS, so steer from the model's prediction alone.
+ * Call from the timing core's holdover state; rate limited to 1 s.
+ * @return true if the correction changed
+ */
+bool discipline_holdover_update(void) {
+    uint64_t now = time_us_64();
+    if (now - last_update_time < 2000000) {
+        return false;                   /* PPS still arriving */
+    }
+    if (last_holdover_us == 0) {
+        /* First step since the last PPS update */
+        last_holdover_us = last_update_time;
+    }
+    if (now - last_holdover_us < 1000000) {
+        return false;
+    }
+    double dt = (now - last_holdover_us) / 1e6;
+    last_holdover_us = now;
+
+    uint32_t irq = save_and_disable_interrupts();
+    clock_model_predict(&model, dt, frequency_correction);
+    if (model.initialized) {
+        frequency_correction = clock_model_steer(&model, dt, (double)tau);
+        g_time_state.frequency_offset = frequency_correction;
     }
+    restore_interrupts(irq);
+    return true;
+}
+
+/**
+ * Direct measurement of the time base's free-running frequency against
+ * the reference (ppb), from the 10MHz regression counter while the Rb
+ * is primary. Timing core, task context.
+ */
+void discipline_frequency_update(double freq_ppb, double sigma_ppb) {
+    uint32_t irq = save_and_disable_interrupts();
+    clock_model_update_freq(&model, freq_ppb, sigma_ppb * sigma_ppb);
+    restore_interrupts(irq);
+}
+
+/**
+ * Refit the model's process noise from the measured Allan profile
+ * (timing core, task context)
+ */
+void discipline_refit_noise(void) {
+    stability_point_t pts[STAB_LEVELS];
+    int n = stability_get(pts, STAB_LEVELS);
+
+    uint32_t irq = save_and_disable_interrupts();
+    clock_model_fit_noise(&model, pts, n);
+    restore_interrupts(irq);
+}
+
+/**
+ * Predicted time error bound of the time base (ns): |phase| + 1 sigma
+ * from the clock model, growing through holdover
+ */
+double discipline_get_time_error_ns(void) {
+    if (!model.initialized) {
+        return INFINITY;
+    }
+    return clock_model_time_error_ns(&model);
+}
+
+/**
+ * Select the steering law (timing core)
+ */
+void discipline_set_kalman(bool enable) {
+    uint32_t irq = save_and_disable_interrupts();
+    if (enable && !kalman_steering && model.initialized) {
+        /* Hand over without a frequency step */
+        model.x[1] = frequency_correction - model.x[0] / (double)tau;
+    } else if (!enable && kalman_steering) {
+        integral_term = frequency_correction * 1e-9;
+    }
+    kalman_steering = enable;
+    restore_interrupts(irq);
+    printf("[DISC] Steering: %s\n", enable ? "Kalman" : "PI");
+}
+
+bool discipline_is_kalman(void) {
+    return kalman_steering;
+}
+
+/**
+ * Copy the clock model (timing core)
+ */
+void discipline_get_model(clock_model_t *out) {
+    uint32_t irq = save_and_disable_interrupts();
+    memcpy(out, &model, sizeof(*out));
+    restore_interrupts(irq);
 }
 
 /**
@@ -213,6 +362,26 @@ void discipline_reset(void) {
     tau = DISCIPLINE_TAU_FAST;
     kp = DISCIPLINE_GAIN_P;
     ki = DISCIPLINE_GAIN_I;
+    clock_model_reset(&model);
+}
+
+/**
+ * Preload the integrator from a saved state (warm start), so the loop
+ * resumes at the learned frequency instead of ramping up from zero
+ * @param integral_ppb Integrator value in ppb
+ */
+void discipline_warm_start(double integral_ppb) {
+    printf("[DISC] Warm start: integrator %.3f ppb\n", integral_ppb);
+
+    /* The PPS IRQ updates the same state on this core */
+    uint32_t irq = save_and_disable_interrupts();
+    integral_term = integral_ppb * 1e-9;
+    frequency_correction = integral_ppb;
+    clock_model_seed(&model, integral_ppb, WARM_SEED_SIGMA_PPB);
+    g_time_state.frequency_offset = frequency_correction;
+    lock_count = 0;
+    is_locked = false;
+    restore_interrupts(irq);
 }
 
 /**
@@ -220,11 +389,13 @@ void discipline_reset(void) {
  * @param step_ns Step to apply in nanoseconds
  */
 void discipline_apply_step(int64_t step_ns) {
-    printf("[DISC] Applying time step of %lld ns\n", step_ns);
+    printf("[DISC] Applying time step of %" PRId64 " ns\n", step_ns);
     
-    /* Clear integral term after a step */
+    /* Clear integral term after a step; the model keeps its frequency
+     * and takes the new phase from the next sample */
     integral_term = 0.0;
     lock_count = 0;
+    model.initialized = false;
 }
 
 /*============================================================================
@@ -232,51 +403,14 @@ void discipline_apply_step(int64_t step_ns) {
  *============================================================================*/
 
 /**
- * Calculate Allan deviation at specified tau
- * @param tau_samples Number of samples for tau (1, 10, 100 seconds)
- * @return Allan deviation in seconds
+ * Get overlapping Allan deviation at 1 second (-1 if not enough data)
  */
-double calculate_allan_deviation(uint32_t tau_samples) {
-    if (offset_history_count < tau_samples * 3) {
-        return -1.0;  /* Not enough data */
-    }
-    
-    /* Calculate Allan variance */
-    double sum = 0.0;
-    int count = 0;
-    
-    for (uint32_t i = 0; i < offset_history_count - 2 * tau_samples; i++) {
-        double y1 = offset_history[i] / 1e9;
-        double y2 = offset_history[i + tau_samples] / 1e9;
-        double y3 = offset_history[i + 2 * tau_samples] / 1e9;
-        
-        double diff = y3 - 2 * y2 + y1;
-        sum += diff * diff;
-        count++;
-    }
-    
-    if (count == 0) {
+double get_allan_dev_1s(void) {
+    stability_point_t p;
+    if (stability_get(&p, 1) < 1 || p.adev_n == 0) {
         return -1.0;
     }
-    
-    double allan_var = sum / (2.0 * count);
-    return sqrt(allan_var);
-}
-
-/**
- * Update Allan deviation calculations
- */
-void discipline_update_allan(void) {
-    allan_dev_1s = calculate_allan_deviation(1);
-    allan_dev_10s = calculate_allan_deviation(10);
-    allan_dev_100s = calculate_allan_deviation(100);
-}
-
-/**
- * Get Allan deviation at 1 second
- */
-double get_allan_dev_1s(void) {
-    return allan_dev_1s;
+    return p.adev;
 }
 
 /**
@@ -20,6 +20,7 @@
 
 #include "chronos_rb.h"
 #include "time_protocol.h"
+#include "calendar.h"
 
 /*============================================================================
  * CONFIGURATION
@@ -28,9 +29,6 @@
 #define TIME_PORT       37
 #define DAYTIME_PORT    13
 
-/* NTP epoch is 1900, Unix epoch is 1970 */
-#define NTP_UNIX_OFFSET 2208988800UL
-
 /*============================================================================
  * PRIVATE VARIABLES
  *============================================================================*/
@@ -118,63 +116,17 @@ static const char *month_names[] = {
     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
 };
 
-/**
- * Convert NTP timestamp to broken-down time
- */
-static void ntp_to_tm(uint32_t ntp_secs, int *year, int *month, int *day,
-                      int *hour, int *min, int *sec, int *wday) {
-    /* Convert NTP to Unix time */
-    uint32_t unix_time = ntp_secs - NTP_UNIX_OFFSET;
-
-    /* Days since epoch */
-    uint32_t days = unix_time / 86400;
-    uint32_t remaining = unix_time % 86400;
-
-    *hour = remaining / 3600;
-    *min = (remaining % 3600) / 60;
-    *sec = remaining % 60;
-
-    /* Day of week (Jan 1, 1970 was Thursday = 4) */
-    *wday = (days + 4) % 7;
-
-    /* Calculate year, month, day */
-    int y = 1970;
-    while (1) {
-        int days_in_year = ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) ? 366 : 365;
-        if (days < (uint32_t)days_in_year) break;
-        days -= days_in_year;
-        y++;
-    }
-    *year = y;
-
-    /* Days in each month */
-    int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if ((y % 4 == 0 && y % 100 != 0) || y % 400 == 0) {
-        days_in_month[1] = 29;  /* Leap year */
-    }
-
-    int m = 0;
-    while (days >= (uint32_t)days_in_month[m]) {
-        days -= days_in_month[m];
-        m++;
-    }
-    *month = m;
-    *day = days + 1;
-}
-
 /**
  * Format daytime string per RFC 867
  * Format: "Weekday, Month DD, YYYY HH:MM:SS-Zone\r\n"
  */
 static int format_daytime(char *buf, size_t len) {
-    uint32_t ntp_secs = get_ntp_seconds();
-
-    int year, month, day, hour, min, sec, wday;
-    ntp_to_tm(ntp_secs, &year, &month, &day, &hour, &min, &sec, &wday);
+    calendar_t c;
+    calendar_at(get_ntp_seconds(), &c);
 
     return snprintf(buf, len, "%s, %s %02d, %04d %02d:%02d:%02d-UTC\r\n",
-                    day_names[wday], month_names[month], day, year,
-                    hour, min, sec);
+                    day_names[c.wday], month_names[c.month - 1], c.day, c.year,
+                    c.hour, c.minute, c.second);
 }
 
 /**
@@ -0,0 +1,368 @@
+/**
+ * CHRONOS-Rb Timing Core
+ *
+ * Runs the timing path on core1 so lwIP, the web server and the CLI on
+ * core0 can no longer delay PPS handling or output edges. See
+ * timing_core.h for the split and the handoff rules.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "hardware/sync.h"
+
+#include "chronos_rb.h"
+#include "timing_core.h"
+#include "config.h"
+#include "pulse_output.h"
+#include "ac_freq_monitor.h"
+#include "pps_generator.h"
+#include "nmea_output.h"
+#include "radio_timecode.h"
+#include "irig_b.h"
+#include "calendar.h"
+#include "gnss_input.h"
+#include "perf_trace.h"
+#include "ref_manager.h"
+#include "sched.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define TIMING_CORE_READY       0x54434F52  /* "TCOR" - core1 init done */
+#define TIMING_PUBLISH_US       50000       /* Snapshot refresh without PPS */
+#define TIMING_POLL_US          10000       /* FIFO/UART ring/AC polling */
+#define TIMING_SLOW_US          100000      /* Housekeeping and PPS fallback */
+#define TIMING_STALL_US         2000000     /* Core1 considered hung after 2s */
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+/* Shared snapshot (written by timing core, read anywhere) */
+static seqlock_t snapshot_lock;
+static timing_snapshot_t snapshot;
+
+/* Publisher state (timing core only) */
+static uint32_t last_published_pps = 0;
+static uint32_t last_publish_us = 0;
+
+/* Core0 -> core1 call mailbox */
+static struct {
+    volatile uint32_t req_seq;  /* Bumped by core0 when a call is posted */
+    volatile uint32_t ack_seq;  /* Set to req_seq by core1 when done */
+    timing_call_fn_t fn;
+    void *arg;
+} mailbox;
+
+/* Loop statistics and liveness */
+static volatile bool core1_running = false;
+static volatile uint32_t heartbeat = 0;
+static volatile uint32_t max_loop_us = 0;
+static volatile uint32_t calls_executed = 0;
+
+/* Watchdog liveness tracking (core0 only) */
+static uint32_t last_seen_heartbeat = 0;
+static uint32_t last_heartbeat_change_us = 0;
+
+/*============================================================================
+ * MODULE INITIALIZATION
+ *============================================================================*/
+
+/**
+ * Initialize everything owned by the timing path.
+ * Runs on core1 in multicore mode: IRQ handlers registered here are
+ * enabled in core1's NVIC, so PPS/PIO/GPIO/UART interrupts land there.
+ */
+static void timing_modules_init(void) {
+    printf("[INIT] Initializing time subsystem...\n");
+    time_init();
+
+    printf("[INIT] Initializing PPS capture...\n");
+    pps_capture_init();
+
+    printf("[INIT] Initializing frequency counter...\n");
+    freq_counter_init();
+
+    printf("[INIT] Initializing 1PPS generator (10MHz / 10,000,000)...\n");
+    pps_generator_init();
+    pps_generator_start();
+
+    printf("[INIT] Initializing time discipline...\n");
+    discipline_init();
+
+    printf("[INIT] Initializing reference manager...\n");
+    ref_init();
+
+    printf("[INIT] Initializing rubidium sync...\n");
+    rubidium_sync_init();
+
+    printf("[INIT] Initializing calendar...\n");
+    calendar_init();
+
+    printf("[INIT] Initializing pulse outputs...\n");
+    pulse_output_init();
+
+    printf("[INIT] Initializing NMEA output...\n");
+    nmea_output_init();
+
+    printf("[INIT] Initializing radio timecode outputs...\n");
+    radio_timecode_init();
+
+    /* GNSS input must be initialized BEFORE AC frequency monitor because
+     * gnss_input_init() registers the shared GPIO callback that handles
+     * both GNSS PPS (GP11) and AC zero crossing (GP19) interrupts */
+    printf("[INIT] Initializing GNSS receiver input...\n");
+    gnss_input_init();
+
+    printf("[INIT] Initializing AC frequency monitor...\n");
+    ac_freq_init();
+
+    /* Apply RF, NMEA, and GNSS settings from config */
+    config_t *cfg = config_get();
+    printf("[INIT] Applying RF/NMEA/GNSS settings from config...\n");
+    radio_timecode_enable(RADIO_DCF77, cfg->rf_dcf77_enabled);
+    radio_timecode_enable(RADIO_WWVB, cfg->rf_wwvb_enabled);
+    radio_timecode_enable(RADIO_JJY40, cfg->rf_jjy40_enabled);
+    radio_timecode_enable(RADIO_JJY60, cfg->rf_jjy60_enabled);
+    nmea_output_enable(cfg->nmea_enabled);
+    nmea_output_set_sentences(cfg->nmea_sentences);
+    nmea_output_set_baud((uint32_t)cfg->nmea_baud_100 * 100);
+    gnss_enable(cfg->gnss_enabled);
+    printf("[INIT]   DCF77: %s, WWVB: %s, JJY40: %s, JJY60: %s\n",
+           cfg->rf_dcf77_enabled ? "ON" : "OFF",
+           cfg->rf_wwvb_enabled ? "ON" : "OFF",
+           cfg->rf_jjy40_enabled ? "ON" : "OFF",
+           cfg->rf_jjy60_enabled ? "ON" : "OFF");
+    printf("[INIT]   NMEA: %s, GNSS: %s\n",
+           cfg->nmea_enabled ? "ON" : "OFF",
+           cfg->gnss_enabled ? "ON" : "OFF");
+
+    printf("[INIT] Initializing IRIG-B output...\n");
+    irig_b_init();
+
+    timing_core_publish();
+}
+
+/*============================================================================
+ * TIMING LOOP
+ *============================================================================*/
+
+/**
+ * Register the timing tasks with the calling core's scheduler. They run
+ * in this order within a pass. Outputs that act on a PPS edge
+ * are woken by it and schedule their own follow-up deadlines; polling
+ * tasks keep a period matched to what they drain.
+ */
+static void timing_tasks_register(void) {
+    sched_add("rb_sync", rubidium_sync_task, TIMING_SLOW_US, 0);
+
+    /* Poll PPS capture FIFOs for offset measurement */
+    sched_add("pps_fifo", freq_counter_pps_task, TIMING_POLL_US,
+              SCHED_EV_PPS | SCHED_EV_GNSS_PPS);
+
+    /* 2 KB DMA ring holds ~170 ms of GNSS UART at 115200 baud */
+    sched_add("gnss", gnss_input_task, TIMING_POLL_US, SCHED_EV_GNSS_PPS);
+
+    /* Time outputs. The calendar advances on the PPS (polled as well,
+     * so time set without an edge is picked up); the outputs that label
+     * a second wake when it has. */
+    sched_add("calendar", calendar_task, TIMING_SLOW_US, SCHED_EV_PPS);
+    sched_add("pulse", pulse_output_task, 0, SCHED_EV_PPS);
+    sched_add("radio", radio_timecode_task, 0, SCHED_EV_SECOND);
+    sched_add("nmea", nmea_output_task, TIMING_SLOW_US, SCHED_EV_SECOND);
+    sched_add("irig_b", irig_b_task, 0, SCHED_EV_SECOND);
+
+    sched_add("ac_freq", ac_freq_task, TIMING_POLL_US, 0);
+
+    sched_add("publish", timing_core_publish, TIMING_PUBLISH_US, SCHED_EV_PPS);
+}
+
+/**
+ * Execute a pending mailbox call from core0
+ */
+static void service_mailbox(void) {
+    uint32_t req = mailbox.req_seq;
+    if (req == mailbox.ack_seq) {
+        return;
+    }
+
+    __dmb();
+    mailbox.fn(mailbox.arg);
+    calls_executed++;
+    __dmb();
+
+    mailbox.ack_seq = req;
+}
+
+/**
+ * Core1 entry point - never returns
+ */
+static void core1_entry(void) {
+    /* Allow core0 to park us during flash_safe_execute() */
+    flash_safe_execute_core_init();
+    PERF_INIT_CORE();
+
+    timing_modules_init();
+    timing_tasks_register();
+    sched_add("mailbox", service_mailbox, 0, SCHED_EV_CALL);
+
+    core1_running = true;
+    multicore_fifo_push_blocking(TIMING_CORE_READY);
+
+    while (1) {
+        uint32_t start = time_us_32();
+
+        PERF_BEGIN(PERF_TASK_TIMING);
+        bool ran = sched_dispatch();
+        PERF_END(PERF_TASK_TIMING);
+
+        if (ran) {
+            uint32_t elapsed = time_us_32() - start;
+            if (elapsed > max_loop_us) {
+                max_loop_us = elapsed;
+            }
+        }
+
+        /* Counts wakeups too - the idle sleep is capped, so a healthy
+         * core still beats several times a second */
+        heartbeat++;
+        sched_idle();
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void timing_core_init(void) {
+#if CHRONOS_MULTICORE
+    printf("[TIMING] Launching timing engine on core1\n");
+    multicore_launch_core1(core1_entry);
+
+    uint32_t ready = multicore_fifo_pop_blocking();
+    if (ready != TIMING_CORE_READY) {
+        printf("[TIMING] WARNING: unexpected core1 handshake 0x%08lx\n", ready);
+    }
+    last_heartbeat_change_us = time_us_32();
+    printf("[TIMING] Core1 timing engine running\n");
+#else
+    timing_modules_init();
+    timing_tasks_register();
+    printf("[TIMING] Single-core mode, timing tasks scheduled on core0\n");
+#endif
+}
+
+void timing_core_publish(void) {
+    uint32_t now = time_us_32();
+    uint32_t pps = g_time_state.pps_count;
+
+    if (pps == last_published_pps && now - last_publish_us < TIMING_PUBLISH_US) {
+        return;
+    }
+    last_published_pps = pps;
+    last_publish_us = now;
+
+    /* Mask local IRQs: PPS/freq handlers on this core write g_time_state,
+     * and an IRQ-context reader must never see the odd sequence here */
+    uint32_t irq = save_and_disable_interrupts();
+    seqlock_write_begin(&snapshot_lock);
+
+    memcpy(&snapshot.state, (const void *)&g_time_state, sizeof(time_state_t));
+    snapshot.min_offset_ns = g_stats.min_offset_ns;
+    snapshot.max_offset_ns = g_stats.max_offset_ns;
+    snapshot.avg_offset_ns = g_stats.avg_offset_ns;
+    snapshot.freq_measurements = g_stats.freq_measurements;
+    snapshot.discipline_integral = discipline_get_integral();
+    double err_ns = discipline_get_time_error_ns();
+    snapshot.time_error_ns = (err_ns < (double)UINT32_MAX) ? (uint32_t)err_ns : UINT32_MAX;
+    ref_get_status(&snapshot.ref);
+    freq_counter_get_regression(&snapshot.freq);
+    snapshot.publish_count++;
+
+    seqlock_write_end(&snapshot_lock);
+    restore_interrupts(irq);
+
+    sched_post(SCHED_EV_PUBLISH);
+}
+
+void timing_core_get_snapshot(timing_snapshot_t *out) {
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&snapshot_lock);
+        memcpy(out, &snapshot, sizeof(timing_snapshot_t));
+    } while (seqlock_read_retry(&snapshot_lock, seq));
+}
+
+uint32_t timing_core_publish_count(void) {
+    return snapshot.publish_count;
+}
+
+void timing_core_call(timing_call_fn_t fn, void *arg) {
+    if (!core1_running || get_core_num() == 1) {
+        fn(arg);
+        return;
+    }
+
+    /* Serialize core0 callers (main loop vs lwIP callbacks): wait for any
+     * call already in flight, then post ours with interrupts masked */
+    uint32_t irq = save_and_disable_interrupts();
+    while (mailbox.ack_seq != mailbox.req_seq) {
+        tight_loop_contents();
+    }
+    mailbox.fn = fn;
+    mailbox.arg = arg;
+    __dmb();
+    uint32_t my_seq = mailbox.req_seq + 1;
+    mailbox.req_seq = my_seq;
+    restore_interrupts(irq);
+    sched_post(SCHED_EV_CALL);
+
+    /* A later caller that preempted us may already have been acked */
+    while ((int32_t)(mailbox.ack_seq - my_seq) < 0) {
+        tight_loop_contents();
+    }
+    __dmb();
+}
+
+bool timing_core_is_alive(void) {
+    if (!core1_running) {
+        return true;
+    }
+
+    uint32_t now = time_us_32();
+    uint32_t hb = heartbeat;
+
+    if (hb != last_seen_heartbeat) {
+        last_seen_heartbeat = hb;
+        last_heartbeat_change_us = now;
+        return true;
+    }
+
+    return (now - last_heartbeat_change_us) < TIMING_STALL_US;
+}
+
+void timing_core_pause(void) {
+    if (core1_running) {
+        multicore_lockout_start_blocking();
+    }
+}
+
+void timing_core_resume(void) {
+    if (core1_running) {
+        multicore_lockout_end_blocking();
+    }
+}
+
+void timing_core_get_stats(timing_core_stats_t *stats) {
+    stats->multicore = core1_running;
+    stats->loops = heartbeat;
+    stats->max_loop_us = max_loop_us;
+    stats->calls = calls_executed;
+}
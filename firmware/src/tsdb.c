@@ -0,0 +1,815 @@
+/**
+ * CHRONOS-Rb Time-Series Store
+ *
+ * Delta/varint compressed rings with 1 s -> 1 min -> 1 h -> 1 day
+ * rollups, optionally spilled to flash. See tsdb.h.
+ *
+ * Only core0 touches the store. Blocks change in tsdb_task() under the
+ * lwIP lock, so the web server, reading from its callbacks, always sees
+ * whole records.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/flash.h"
+#include "hardware/adc.h"
+
+#include "chronos_rb.h"
+#include "tsdb.h"
+#include "timing_core.h"
+#include "ac_freq_monitor.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+#define NTP_UNIX_OFFSET     2208988800UL
+
+#define TSDB_MAGIC          0x5354      /* "TS" */
+#define TSDB_CUR_RAM        0x80000000u /* Cursor block is in the RAM ring */
+#define TSDB_REC_MAX        16          /* Longest record: rollup or gap */
+#define TSDB_SPAN_MAX       0xFFFF      /* Intervals one block may cover */
+
+/* Flash ring: the history area sits below the config journal at the end
+ * of flash, both inside the bootloader's reserved filesystem area */
+#ifndef CHRONOS_CONFIG_FLASH_KB
+#define CHRONOS_CONFIG_FLASH_KB     8
+#endif
+#ifndef CHRONOS_HISTORY_FLASH_KB
+#define CHRONOS_HISTORY_FLASH_KB    0
+#endif
+
+#define TSDB_FLASH_PAGES    ((CHRONOS_HISTORY_FLASH_KB * 1024) / TSDB_BLOCK_SIZE)
+#define TSDB_FLASH_OFFSET   (PICO_FLASH_SIZE_BYTES - \
+                             (CHRONOS_CONFIG_FLASH_KB + CHRONOS_HISTORY_FLASH_KB) * 1024)
+#define TSDB_SECTOR_PAGES   (FLASH_SECTOR_SIZE / TSDB_BLOCK_SIZE)
+
+#if TSDB_BLOCK_SIZE != FLASH_PAGE_SIZE
+#error "A history block is spilled as one flash page"
+#endif
+#if TSDB_FLASH_PAGES > 0 && (CHRONOS_HISTORY_FLASH_KB * 1024) / FLASH_SECTOR_SIZE < 2
+#error "History flash needs at least two sectors"
+#endif
+
+/*============================================================================
+ * DATA STRUCTURES
+ *============================================================================*/
+
+typedef struct {
+    uint16_t magic;
+    uint8_t series;
+    uint8_t tier;
+    uint32_t seq;               /* Flash page sequence, once spilled */
+    uint32_t start;             /* Unix time of the first interval */
+    uint16_t span;              /* Intervals from start past the last record */
+    uint16_t used;              /* Record bytes */
+} tsdb_header_t;
+
+typedef struct {
+    tsdb_header_t hdr;
+    uint8_t data[TSDB_BLOCK_SIZE - sizeof(tsdb_header_t)];
+} tsdb_block_t;
+
+typedef struct {
+    tsdb_block_t *blocks;
+    uint32_t nblocks;
+    uint32_t next;              /* Sequence of the next block opened */
+    bool open;                  /* blocks[(next - 1) % nblocks] takes records */
+    int32_t prev;               /* Last average in the open block */
+    uint32_t next_t;            /* Time of the next record without a gap */
+} tsdb_ring_t;
+
+/* Rollup being accumulated */
+typedef struct {
+    uint32_t start;
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint32_t n;                 /* Seconds sampled, 0 = empty */
+} tsdb_acc_t;
+
+/* Block decoder */
+typedef struct {
+    const tsdb_block_t *b;
+    uint32_t pos;
+    uint32_t t;
+    int32_t prev;
+} tsdb_dec_t;
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+static const struct {
+    const char *name;
+    const char *unit;
+} series_info[TSDB_SERIES_COUNT] = {
+    [TSDB_OFFSET]   = { "offset", "ns" },
+    [TSDB_FREQ]     = { "freq",   "ppt" },
+    [TSDB_GNSS]     = { "gnss",   "ns" },
+    [TSDB_NTP_LOAD] = { "ntp",    "req/s" },
+    [TSDB_RSSI]     = { "rssi",   "dBm" },
+    [TSDB_TEMP]     = { "temp",   "mdegC" },
+    [TSDB_AC_FREQ]  = { "ac",     "uHz" },
+};
+
+static const char *const tier_names[TSDB_TIER_COUNT] = { "1s", "1m", "1h", "1d" };
+static const uint32_t tier_seconds[TSDB_TIER_COUNT] = { 1, 60, 3600, 86400 };
+
+static tsdb_block_t ram_sec[TSDB_SERIES_COUNT][TSDB_BLOCKS_SEC];
+static tsdb_block_t ram_min[TSDB_SERIES_COUNT][TSDB_BLOCKS_MIN];
+static tsdb_block_t ram_hour[TSDB_SERIES_COUNT][TSDB_BLOCKS_HOUR];
+static tsdb_block_t ram_day[TSDB_SERIES_COUNT][TSDB_BLOCKS_DAY];
+
+static tsdb_ring_t rings[TSDB_SERIES_COUNT][TSDB_TIER_COUNT];
+static tsdb_acc_t accs[TSDB_SERIES_COUNT][TSDB_TIER_COUNT];    /* [0] unused */
+static uint32_t samples[TSDB_SERIES_COUNT];
+
+static bool tsdb_initialized = false;
+static uint32_t last_sample_t = 0;
+static uint32_t last_ntp_requests = 0;
+static bool have_ntp_requests = false;
+
+/* Blocks pushed out of RAM, written to flash by tsdb_task() */
+static tsdb_block_t spill_queue[TSDB_SPILL_QUEUE];
+static uint32_t spill_count = 0;
+static uint32_t spilled = 0;
+static uint32_t spill_dropped = 0;
+
+#if TSDB_FLASH_PAGES > 0
+static uint32_t flash_next = 0;     /* Sequence of the next page written */
+
+typedef struct {
+    uint32_t offset;            /* Page's flash offset */
+    bool erase;                 /* Erase its sector first */
+    const tsdb_block_t *block;
+} spill_job_t;
+#endif
+
+/*============================================================================
+ * ENCODING
+ *============================================================================*/
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u) {
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+/* LEB128; a 33-bit value takes at most 5 bytes */
+static int put_varint(uint8_t *p, uint64_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Returns bytes read, 0 if the varint runs past end */
+static int get_varint(const uint8_t *p, uint32_t left, uint64_t *v) {
+    uint64_t x = 0;
+    for (uint32_t i = 0; i < left && i < 10; i++) {
+        x |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) {
+            *v = x;
+            return (int)i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Encode one record: an optional gap of skip intervals, then the value.
+ * A value's lead varint is the zigzag delta + 1, so 0 marks a gap.
+ */
+static int encode(uint8_t *rec, uint32_t skip, int32_t prev,
+                  int32_t min, int32_t avg, int32_t max, bool rollup) {
+    int n = 0;
+    if (skip > 0) {
+        n += put_varint(rec + n, 0);
+        n += put_varint(rec + n, skip);
+    }
+    n += put_varint(rec + n, (uint64_t)zigzag((int32_t)((uint32_t)avg - (uint32_t)prev)) + 1);
+    if (rollup) {
+        n += put_varint(rec + n, (uint32_t)avg - (uint32_t)min);
+        n += put_varint(rec + n, (uint32_t)max - (uint32_t)avg);
+    }
+    return n;
+}
+
+static void dec_init(tsdb_dec_t *d, const tsdb_block_t *b) {
+    d->b = b;
+    d->pos = 0;
+    d->t = b->hdr.start;
+    d->prev = 0;
+}
+
+/**
+ * Next record of a block. Returns false at the end (or on a record cut
+ * short, which only a torn flash page can hold).
+ */
+static bool dec_next(tsdb_dec_t *d, tsdb_point_t *p) {
+    const tsdb_header_t *h = &d->b->hdr;
+    uint32_t iv = tier_seconds[h->tier];
+    uint32_t used = (h->used <= sizeof(d->b->data)) ? h->used : sizeof(d->b->data);
+
+    while (d->pos < used) {
+        uint64_t lead;
+        int n = get_varint(d->b->data + d->pos, used - d->pos, &lead);
+        if (n == 0) {
+            return false;
+        }
+        d->pos += (uint32_t)n;
+
+        if (lead == 0) {
+            uint64_t skip;
+            n = get_varint(d->b->data + d->pos, used - d->pos, &skip);
+            if (n == 0) {
+                return false;
+            }
+            d->pos += (uint32_t)n;
+            d->t += (uint32_t)skip * iv;
+            continue;
+        }
+
+        int32_t avg = (int32_t)((uint32_t)d->prev + (uint32_t)unzigzag((uint32_t)(lead - 1)));
+        p->t = d->t;
+        p->avg = avg;
+        p->min = avg;
+        p->max = avg;
+        if (h->tier != TSDB_TIER_SEC) {
+            uint64_t below, above;
+            n = get_varint(d->b->data + d->pos, used - d->pos, &below);
+            if (n == 0) {
+                return false;
+            }
+            d->pos += (uint32_t)n;
+            n = get_varint(d->b->data + d->pos, used - d->pos, &above);
+            if (n == 0) {
+                return false;
+            }
+            d->pos += (uint32_t)n;
+            p->min = (int32_t)((uint32_t)avg - (uint32_t)below);
+            p->max = (int32_t)((uint32_t)avg + (uint32_t)above);
+        }
+        d->prev = avg;
+        d->t += iv;
+        return true;
+    }
+    return false;
+}
+
+/*============================================================================
+ * RINGS
+ *============================================================================*/
+
+/**
+ * Queue a block leaving RAM for flash
+ */
+static void spill(const tsdb_block_t *b) {
+#if TSDB_FLASH_PAGES > 0
+    if (b->hdr.tier == TSDB_TIER_SEC || b->hdr.used == 0) {
+        return;
+    }
+    if (spill_count >= TSDB_SPILL_QUEUE) {
+        spill_dropped++;
+        return;
+    }
+    spill_queue[spill_count++] = *b;
+#else
+    (void)b;
+#endif
+}
+
+static tsdb_block_t *ring_open(tsdb_ring_t *r, int series, int tier, uint32_t t) {
+    tsdb_block_t *b = &r->blocks[r->next % r->nblocks];
+    if (r->next >= r->nblocks) {
+        spill(b);
+    }
+
+    memset(b, 0, sizeof(*b));
+    b->hdr.magic = TSDB_MAGIC;
+    b->hdr.series = (uint8_t)series;
+    b->hdr.tier = (uint8_t)tier;
+    b->hdr.start = t;
+    r->next++;
+    r->open = true;
+    r->prev = 0;
+    r->next_t = t;
+    return b;
+}
+
+/**
+ * Append a record for the interval starting at t. A new block is opened
+ * when the record does not fit, the span is full or time went back.
+ */
+static void ring_append(int series, int tier, uint32_t t, int32_t min, int32_t avg, int32_t max) {
+    tsdb_ring_t *r = &rings[series][tier];
+    uint32_t iv = tier_seconds[tier];
+    bool rollup = (tier != TSDB_TIER_SEC);
+    uint8_t rec[TSDB_REC_MAX];
+    tsdb_block_t *b = NULL;
+    uint32_t skip = 0;
+    int n = 0;
+
+    if (r->open && t >= r->next_t) {
+        b = &r->blocks[(r->next - 1) % r->nblocks];
+        skip = (t - r->next_t) / iv;
+        if ((uint32_t)b->hdr.span + skip + 1 > TSDB_SPAN_MAX) {
+            b = NULL;
+        } else {
+            n = encode(rec, skip, r->prev, min, avg, max, rollup);
+            if (b->hdr.used + n > sizeof(b->data)) {
+                b = NULL;
+            }
+        }
+    }
+    if (b == NULL) {
+        b = ring_open(r, series, tier, t);
+        skip = 0;
+        n = encode(rec, 0, 0, min, avg, max, rollup);
+    }
+
+    memcpy(b->data + b->hdr.used, rec, (size_t)n);
+    b->hdr.used += (uint16_t)n;
+    b->hdr.span += (uint16_t)(skip + 1);
+    r->prev = avg;
+    r->next_t = t + iv;
+}
+
+static inline uint32_t period_start(int tier, uint32_t t) {
+    return t - t % tier_seconds[tier];
+}
+
+static void acc_add(int series, int tier, uint32_t t, int32_t min, int32_t max,
+                    int64_t sum, uint32_t n) {
+    tsdb_acc_t *a = &accs[series][tier];
+    if (a->n == 0) {
+        a->start = period_start(tier, t);
+        a->min = min;
+        a->max = max;
+        a->sum = 0;
+    }
+    if (min < a->min) a->min = min;
+    if (max > a->max) a->max = max;
+    a->sum += sum;
+    a->n += n;
+}
+
+/**
+ * Close the rollups of a series whose interval has ended by t, each
+ * feeding the next tier up
+ */
+static void acc_close(int series, uint32_t t) {
+    for (int tier = TSDB_TIER_MIN; tier < TSDB_TIER_COUNT; tier++) {
+        tsdb_acc_t *a = &accs[series][tier];
+        if (a->n == 0) {
+            continue;
+        }
+        if (t < a->start) {
+            /* Time stepped back past the interval: it cannot close cleanly */
+            a->n = 0;
+            continue;
+        }
+        if (t - a->start < tier_seconds[tier]) {
+            continue;
+        }
+
+        int64_t half = (a->sum >= 0) ? (int64_t)a->n / 2 : -(int64_t)a->n / 2;
+        int32_t avg = (int32_t)((a->sum + half) / (int64_t)a->n);
+        if (avg < a->min) avg = a->min;
+        if (avg > a->max) avg = a->max;
+        ring_append(series, tier, a->start, a->min, avg, a->max);
+        if (tier + 1 < TSDB_TIER_COUNT) {
+            acc_add(series, tier + 1, a->start, a->min, a->max, a->sum, a->n);
+        }
+        a->n = 0;
+    }
+}
+
+static void series_add(int series, uint32_t t, int32_t v) {
+    ring_append(series, TSDB_TIER_SEC, t, v, v, v);
+    acc_add(series, TSDB_TIER_MIN, t, v, v, v, 1);
+    samples[series]++;
+}
+
+/*============================================================================
+ * FLASH
+ *============================================================================*/
+
+#if TSDB_FLASH_PAGES > 0
+static inline const tsdb_block_t *flash_page(uint32_t seq) {
+    return (const tsdb_block_t *)(XIP_BASE + TSDB_FLASH_OFFSET +
+                                  (seq % TSDB_FLASH_PAGES) * TSDB_BLOCK_SIZE);
+}
+
+static void spill_write_callback(void *param) {
+    const spill_job_t *job = (const spill_job_t *)param;
+    if (job->erase) {
+        flash_range_erase(job->offset, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(job->offset, (const uint8_t *)job->block, TSDB_BLOCK_SIZE);
+}
+
+/**
+ * Write the queued blocks to the next pages, erasing each sector as the
+ * ring reaches it (which drops that sector's oldest blocks)
+ */
+static void spill_flush(void) {
+    static spill_job_t job;
+
+    for (uint32_t i = 0; i < spill_count; i++) {
+        uint32_t page = flash_next % TSDB_FLASH_PAGES;
+        tsdb_block_t *b = &spill_queue[i];
+        b->hdr.seq = flash_next;
+
+        job.offset = TSDB_FLASH_OFFSET + page * TSDB_BLOCK_SIZE;
+        job.erase = (page % TSDB_SECTOR_PAGES == 0);
+        job.block = b;
+        int result = flash_safe_execute(spill_write_callback, &job, UINT32_MAX);
+        if (result != PICO_OK) {
+            printf("[TSDB] Flash write failed (error %d)\n", result);
+            spill_dropped += spill_count - i;
+            break;
+        }
+        flash_next++;
+        spilled++;
+    }
+    spill_count = 0;
+}
+
+/**
+ * Resume after the newest page. Sequences only grow, so it is the
+ * highest valid one.
+ */
+static void flash_scan(void) {
+    bool found = false;
+    uint32_t newest = 0;
+
+    for (uint32_t i = 0; i < TSDB_FLASH_PAGES; i++) {
+        const tsdb_block_t *b = flash_page(i);
+        if (b->hdr.magic != TSDB_MAGIC || b->hdr.seq % TSDB_FLASH_PAGES != i) {
+            continue;
+        }
+        if (!found || (int32_t)(b->hdr.seq - newest) > 0) {
+            newest = b->hdr.seq;
+            found = true;
+        }
+    }
+    flash_next = found ? newest + 1 : 0;
+}
+#endif
+
+/*============================================================================
+ * SAMPLING
+ *============================================================================*/
+
+/**
+ * RP2350 die temperature in m°C (RP2350 datasheet: 27 °C at 0.706 V,
+ * -1.721 mV/°C)
+ */
+static int32_t read_temperature(void) {
+    adc_select_input(ADC_TEMPERATURE_CHANNEL_NUM);
+    float v = adc_read() * 3.3f / 4096.0f;
+    return (int32_t)lroundf((27.0f - (v - 0.706f) / 0.001721f) * 1000.0f);
+}
+
+/**
+ * This second's value of a series; false when there is none
+ */
+static bool sample(int series, const timing_snapshot_t *snap, int32_t *v) {
+    switch (series) {
+        case TSDB_OFFSET:
+            if (snap->state.offset_ns > INT32_MAX || snap->state.offset_ns < INT32_MIN) {
+                return false;
+            }
+            *v = (int32_t)snap->state.offset_ns;
+            return true;
+
+        case TSDB_FREQ:
+            if (!snap->freq.valid) {
+                return false;
+            }
+            *v = (int32_t)lround(snap->freq.rb_offset_ppb * 1000.0);
+            return true;
+
+        case TSDB_GNSS:
+            if (!freq_counter_pps_offset_valid()) {
+                return false;
+            }
+            *v = freq_counter_get_pps_offset();
+            return true;
+
+        case TSDB_NTP_LOAD: {
+            uint32_t requests, errors;
+            ntp_get_statistics(&requests, &errors);
+            bool ok = have_ntp_requests;
+            *v = (int32_t)(requests - last_ntp_requests);
+            last_ntp_requests = requests;
+            have_ntp_requests = true;
+            return ok;
+        }
+
+        case TSDB_RSSI:
+            if (!wifi_is_connected()) {
+                return false;
+            }
+            *v = wifi_get_rssi();
+            return *v != 0;
+
+        case TSDB_TEMP:
+            *v = read_temperature();
+            return true;
+
+        case TSDB_AC_FREQ: {
+            uint32_t uhz = ac_freq_get_second_uhz();
+            *v = (int32_t)uhz;
+            return uhz != 0;
+        }
+
+        default:
+            return false;
+    }
+}
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+void tsdb_init(void) {
+    for (int s = 0; s < TSDB_SERIES_COUNT; s++) {
+        rings[s][TSDB_TIER_SEC] = (tsdb_ring_t){ .blocks = ram_sec[s], .nblocks = TSDB_BLOCKS_SEC };
+        rings[s][TSDB_TIER_MIN] = (tsdb_ring_t){ .blocks = ram_min[s], .nblocks = TSDB_BLOCKS_MIN };
+        rings[s][TSDB_TIER_HOUR] = (tsdb_ring_t){ .blocks = ram_hour[s], .nblocks = TSDB_BLOCKS_HOUR };
+        rings[s][TSDB_TIER_DAY] = (tsdb_ring_t){ .blocks = ram_day[s], .nblocks = TSDB_BLOCKS_DAY };
+    }
+
+    adc_init();
+    adc_set_temp_sensor_enabled(true);
+
+#if TSDB_FLASH_PAGES > 0
+    flash_scan();
+    printf("[TSDB] History in RAM and %d KB flash (next page %lu)\n",
+           CHRONOS_HISTORY_FLASH_KB, flash_next);
+#else
+    printf("[TSDB] History in RAM only\n");
+#endif
+    tsdb_initialized = true;
+}
+
+void tsdb_task(void) {
+    if (!tsdb_initialized) {
+        return;
+    }
+
+    static timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    if (!snap.state.time_valid) {
+        return;
+    }
+
+    uint32_t t = get_current_time().seconds - NTP_UNIX_OFFSET;
+    if (t == last_sample_t) {
+        return;
+    }
+    last_sample_t = t;
+
+    /* Sources are read outside the lock; RSSI is a driver ioctl */
+    int32_t v[TSDB_SERIES_COUNT];
+    bool ok[TSDB_SERIES_COUNT];
+    for (int s = 0; s < TSDB_SERIES_COUNT; s++) {
+        ok[s] = sample(s, &snap, &v[s]);
+    }
+
+    cyw43_arch_lwip_begin();
+    for (int s = 0; s < TSDB_SERIES_COUNT; s++) {
+        acc_close(s, t);
+        if (ok[s]) {
+            series_add(s, t, v[s]);
+        }
+    }
+    cyw43_arch_lwip_end();
+
+#if TSDB_FLASH_PAGES > 0
+    if (spill_count > 0) {
+        spill_flush();
+    }
+#endif
+}
+
+const char *tsdb_series_name(int series) {
+    return (series >= 0 && series < TSDB_SERIES_COUNT) ? series_info[series].name : "?";
+}
+
+const char *tsdb_series_unit(int series) {
+    return (series >= 0 && series < TSDB_SERIES_COUNT) ? series_info[series].unit : "";
+}
+
+const char *tsdb_tier_name(int tier) {
+    return (tier >= 0 && tier < TSDB_TIER_COUNT) ? tier_names[tier] : "?";
+}
+
+int tsdb_series_from_name(const char *name) {
+    for (int s = 0; s < TSDB_SERIES_COUNT; s++) {
+        if (strcasecmp(name, series_info[s].name) == 0) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+int tsdb_tier_from_name(const char *name) {
+    for (int i = 0; i < TSDB_TIER_COUNT; i++) {
+        if (strcasecmp(name, tier_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int tsdb_recent(tsdb_series_t series, tsdb_tier_t tier, tsdb_point_t *out, int max) {
+    if (series >= TSDB_SERIES_COUNT || tier >= TSDB_TIER_COUNT || max <= 0) {
+        return 0;
+    }
+    const tsdb_ring_t *r = &rings[series][tier];
+    uint32_t first = (r->next > r->nblocks) ? r->next - r->nblocks : 0;
+    tsdb_dec_t d;
+    tsdb_point_t p;
+
+    /* Count, then keep the last max */
+    uint32_t total = 0;
+    for (uint32_t seq = first; seq < r->next; seq++) {
+        dec_init(&d, &r->blocks[seq % r->nblocks]);
+        while (dec_next(&d, &p)) {
+            total++;
+        }
+    }
+
+    uint32_t skip = (total > (uint32_t)max) ? total - (uint32_t)max : 0;
+    int n = 0;
+    for (uint32_t seq = first; seq < r->next && n < max; seq++) {
+        dec_init(&d, &r->blocks[seq % r->nblocks]);
+        while (n < max && dec_next(&d, &p)) {
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            out[n++] = p;
+        }
+    }
+    return n;
+}
+
+static bool block_matches(const tsdb_block_t *b, const tsdb_query_t *q) {
+    if (b->hdr.magic != TSDB_MAGIC || b->hdr.series != q->series ||
+        b->hdr.tier != q->tier || b->hdr.used == 0) {
+        return false;
+    }
+    uint32_t end = b->hdr.start + (uint32_t)b->hdr.span * tier_seconds[b->hdr.tier];
+    return end > q->from && b->hdr.start < q->to;
+}
+
+/**
+ * Block at or after the cursor that the query wants: flash pages oldest
+ * first, then the RAM ring. NULL at the end.
+ */
+static const tsdb_block_t *query_block(const tsdb_query_t *q, uint32_t *blk) {
+    if (!(*blk & TSDB_CUR_RAM)) {
+#if TSDB_FLASH_PAGES > 0
+        uint32_t first = (flash_next > TSDB_FLASH_PAGES) ? flash_next - TSDB_FLASH_PAGES : 0;
+        if (*blk < first) {
+            *blk = first;
+        }
+        for (; *blk < flash_next; (*blk)++) {
+            const tsdb_block_t *b = flash_page(*blk);
+            if (b->hdr.seq == *blk && block_matches(b, q)) {
+                return b;
+            }
+        }
+#endif
+        *blk = TSDB_CUR_RAM;
+    }
+
+    const tsdb_ring_t *r = &rings[q->series][q->tier];
+    uint32_t first = (r->next > r->nblocks) ? r->next - r->nblocks : 0;
+    uint32_t seq = *blk & ~TSDB_CUR_RAM;
+    if (seq < first) {
+        seq = first;
+    }
+    for (; seq < r->next; seq++) {
+        const tsdb_block_t *b = &r->blocks[seq % r->nblocks];
+        if (block_matches(b, q)) {
+            *blk = TSDB_CUR_RAM | seq;
+            return b;
+        }
+    }
+    *blk = TSDB_CUR_RAM | seq;
+    return NULL;
+}
+
+size_t tsdb_read(const tsdb_query_t *q, uint32_t *blk, uint32_t *pos,
+                 char *buf, size_t len, bool *done) {
+    size_t out = 0;
+
+    if (q->series >= TSDB_SERIES_COUNT || q->tier >= TSDB_TIER_COUNT) {
+        *done = true;
+        return 0;
+    }
+
+    for (;;) {
+        uint32_t at = *blk;
+        const tsdb_block_t *b = query_block(q, blk);
+        if (*blk != at) {
+            *pos = 0;
+        }
+        if (b == NULL) {
+            *done = true;
+            return out;
+        }
+
+        if (q->binary) {
+            /* Whole blocks, header and records as stored, so the open
+             * block cannot grow under a partly sent copy */
+            size_t size = sizeof(tsdb_header_t) + b->hdr.used;
+            if (size > len - out) {
+                return out;
+            }
+            memcpy(buf + out, b, size);
+            out += size;
+        } else {
+            /* Whole rows, resuming after the *pos records already done */
+            tsdb_dec_t d;
+            tsdb_point_t p;
+            uint32_t i = 0;
+            dec_init(&d, b);
+            while (dec_next(&d, &p)) {
+                if (i++ < *pos) {
+                    continue;
+                }
+                if (p.t >= q->from && p.t < q->to) {
+                    int n = (q->tier == TSDB_TIER_SEC) ?
+                        snprintf(buf + out, len - out, "%lu,%ld\n", p.t, p.avg) :
+                        snprintf(buf + out, len - out, "%lu,%ld,%ld,%ld\n",
+                                 p.t, p.min, p.avg, p.max);
+                    if (n < 0 || (size_t)n >= len - out) {
+                        return out;
+                    }
+                    out += (size_t)n;
+                }
+                (*pos)++;
+            }
+        }
+
+        (*blk)++;
+        *pos = 0;
+    }
+}
+
+void tsdb_get_series_stats(tsdb_series_t series, tsdb_series_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (series >= TSDB_SERIES_COUNT) {
+        return;
+    }
+
+    for (int tier = 0; tier < TSDB_TIER_COUNT; tier++) {
+        const tsdb_ring_t *r = &rings[series][tier];
+        uint32_t first = (r->next > r->nblocks) ? r->next - r->nblocks : 0;
+        for (uint32_t seq = first; seq < r->next; seq++) {
+            const tsdb_block_t *b = &r->blocks[seq % r->nblocks];
+            tsdb_dec_t d;
+            tsdb_point_t p;
+            dec_init(&d, b);
+            while (dec_next(&d, &p)) {
+                if (out->records[tier] == 0) {
+                    out->first_t[tier] = p.t;
+                }
+                out->records[tier]++;
+            }
+            out->bytes[tier] += b->hdr.used;
+        }
+    }
+    out->samples = samples[series];
+}
+
+void tsdb_get_stats(tsdb_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->spilled = spilled;
+    out->spill_dropped = spill_dropped;
+    out->ram_bytes = sizeof(ram_sec) + sizeof(ram_min) + sizeof(ram_hour) + sizeof(ram_day);
+#if TSDB_FLASH_PAGES > 0
+    out->flash_pages = TSDB_FLASH_PAGES;
+    out->flash_used = (flash_next < TSDB_FLASH_PAGES) ? flash_next : TSDB_FLASH_PAGES;
+#endif
+}
@@ -0,0 +1,72 @@
+/**
+ * CHRONOS-Rb Unit Secret
+ *
+ * Generates the per-unit secret once and derives the long-term keys
+ * from it. See unit_secret.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+
+#include "chronos_rb.h"
+#include "config.h"
+#include "sha512.h"
+#include "unit_secret.h"
+
+/*============================================================================
+ * PUBLIC API
+ *============================================================================*/
+
+/**
+ * Generate and store the secret on first boot
+ */
+void unit_secret_init(void) {
+    config_t *cfg = config_get();
+    uint8_t secret[CONFIG_SECRET_SIZE];
+
+    if (cfg->unit_secret_flags == CONFIG_SECRET_VALID) {
+        return;
+    }
+
+    for (int i = 0; i < CONFIG_SECRET_SIZE; i += 8) {
+        uint64_t r = get_rand_64();
+        memcpy(secret + i, &r, 8);
+    }
+
+    /* Also sets the RAM copy, so a failed write still gives this boot
+     * consistent keys; the next boot draws new ones */
+    if (config_save_secret(secret)) {
+        printf("[SECRET] Unit secret generated\n");
+    } else {
+        printf("[SECRET] WARNING: Unit secret not saved, keys change at next boot\n");
+    }
+    memset(secret, 0, sizeof(secret));
+}
+
+/**
+ * Derive key material for label: SHA-512(label, NUL, secret)
+ */
+void unit_secret_derive(const char *label, uint8_t *out, size_t len) {
+    const config_t *cfg = config_get();
+    uint8_t h[SHA512_DIGEST_SIZE];
+    sha512_ctx_t ctx;
+
+    if (len > sizeof(h)) {
+        len = sizeof(h);
+    }
+    unit_secret_init();
+
+    sha512_init(&ctx);
+    sha512_update(&ctx, label, strlen(label) + 1);
+    sha512_update(&ctx, cfg->unit_secret, sizeof(cfg->unit_secret));
+    sha512_final(&ctx, h);
+
+    memcpy(out, h, len);
+    memset(h, 0, sizeof(h));
+    memset(&ctx, 0, sizeof(ctx));
+}
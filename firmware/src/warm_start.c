@@ -0,0 +1,182 @@
+/**
+ * CHRONOS-Rb Warm Start
+ *
+ * Saves the discipline state to the config journal while locked and
+ * offers it back to the sync state machine at boot. See warm_start.h.
+ *
+ * Copyright (c) 2025 - Open Source Hardware Project
+ * License: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "pico/stdlib.h"
+
+#include "chronos_rb.h"
+#include "config.h"
+#include "gnss_input.h"
+#include "timing_core.h"
+#include "warm_start.h"
+
+/*============================================================================
+ * PRIVATE VARIABLES
+ *============================================================================*/
+
+/* State as loaded at boot - read-only once the timing core runs */
+static config_warm_t boot_state;
+
+/* Set by the timing core when it starts warm */
+static volatile bool restored = false;
+static volatile uint32_t restored_age_s = 0;
+
+/* Saver state (core0 only) */
+static uint32_t lock_start_unix = 0;    /* 0 = not locked */
+static uint32_t last_save_unix = 0;
+static uint32_t saves = 0;
+static uint32_t save_failures = 0;
+
+/*============================================================================
+ * RESTORE (TIMING CORE)
+ *============================================================================*/
+
+void warm_start_init(void) {
+    memcpy(&boot_state, &config_get()->warm, sizeof(boot_state));
+
+    if (boot_state.flags & CONFIG_WARM_VALID) {
+        printf("[WARM] Saved state: integrator %ld ppt, drift %ld ppt/day, locked %lus\n",
+               boot_state.integral_ppt, boot_state.drift_ppt_day, boot_state.lock_seconds);
+    } else {
+        printf("[WARM] No saved discipline state\n");
+    }
+}
+
+bool warm_start_check(bool rb_locked, uint32_t uptime_s, double *integral_ppb) {
+    if (!(boot_state.flags & CONFIG_WARM_VALID) || !rb_locked) {
+        return false;
+    }
+
+    /* Age from GNSS if it has time yet, otherwise trust a quick Rb lock */
+    uint32_t age_s = 0;
+    uint32_t now_unix = gnss_has_time() ? gnss_get_unix_time() : 0;
+    if (now_unix != 0) {
+        if (now_unix < boot_state.saved_unix ||
+            now_unix - boot_state.saved_unix > WARM_START_MAX_AGE_S) {
+            return false;
+        }
+        age_s = now_unix - boot_state.saved_unix;
+    } else if (uptime_s > WARM_START_RB_LOCK_S) {
+        return false;
+    }
+
+    /* Carry the integrator forward along its measured drift */
+    double ppb = boot_state.integral_ppt * 1e-3;
+    if (age_s > 0) {
+        ppb += boot_state.drift_ppt_day * 1e-3 * ((double)age_s / 86400.0);
+    }
+
+    *integral_ppb = ppb;
+    restored_age_s = age_s;
+    restored = true;
+    return true;
+}
+
+/*============================================================================
+ * SAVE (CORE0)
+ *============================================================================*/
+
+bool warm_start_save(void) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+
+    if (snap.state.sync_state != SYNC_STATE_LOCKED || !snap.state.time_valid) {
+        return false;
+    }
+
+    uint32_t now_unix = (uint32_t)(get_time_us() / 1000000);
+    if (lock_start_unix == 0) {
+        lock_start_unix = now_unix;
+    }
+
+    const config_warm_t *prev = &config_get()->warm;
+    config_warm_t w;
+    memset(&w, 0, sizeof(w));
+    w.saved_unix = now_unix;
+    w.integral_ppt = (int32_t)llround(snap.discipline_integral * 1e12);
+    w.drift_ppt_day = prev->drift_ppt_day;
+    w.lock_unix = lock_start_unix;
+    w.lock_seconds = now_unix - lock_start_unix;
+    w.saves = prev->saves + 1;
+    w.flags = CONFIG_WARM_VALID;
+
+    /* Drift from the previous save (same lock or not), smoothed. A gap
+     * under half an interval is a forced save: too short to measure. */
+    if ((prev->flags & CONFIG_WARM_VALID) && now_unix > prev->saved_unix) {
+        uint32_t dt = now_unix - prev->saved_unix;
+        if (dt >= WARM_START_SAVE_S / 2 && dt <= WARM_START_MAX_AGE_S) {
+            double rate = (double)(w.integral_ppt - prev->integral_ppt) * 86400.0 / dt;
+            double drift = (prev->drift_ppt_day == 0) ? rate :
+                           0.75 * prev->drift_ppt_day + 0.25 * rate;
+            w.drift_ppt_day = (int32_t)lround(drift);
+        }
+    }
+
+    if (!config_save_warm(&w)) {
+        save_failures++;
+        return false;
+    }
+
+    last_save_unix = now_unix;
+    saves++;
+    printf("[WARM] Saved: integrator %ld ppt, drift %ld ppt/day, locked %lus\n",
+           w.integral_ppt, w.drift_ppt_day, w.lock_seconds);
+    return true;
+}
+
+void warm_start_task(void) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+
+    if (snap.state.sync_state != SYNC_STATE_LOCKED || !snap.state.time_valid) {
+        lock_start_unix = 0;
+        return;
+    }
+
+    uint32_t now_unix = (uint32_t)(get_time_us() / 1000000);
+    if (lock_start_unix == 0) {
+        lock_start_unix = now_unix;
+    }
+
+    /* Let the integrator settle before the first save of a lock */
+    if (now_unix - lock_start_unix < WARM_START_SETTLE_S) {
+        return;
+    }
+    if (last_save_unix != 0 && now_unix - last_save_unix < WARM_START_SAVE_S) {
+        return;
+    }
+
+    if (!warm_start_save()) {
+        last_save_unix = now_unix;  /* Retry next interval, not every pass */
+    }
+}
+
+void warm_start_clear(void) {
+    config_warm_t w;
+    memset(&w, 0, sizeof(w));
+    config_save_warm(&w);
+}
+
+void warm_start_get_stats(warm_start_stats_t *stats) {
+    const config_warm_t *w = &config_get()->warm;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->saved_valid = (w->flags & CONFIG_WARM_VALID) != 0;
+    stats->restored = restored;
+    stats->restored_age_s = restored_age_s;
+    stats->integral_ppb = w->integral_ppt * 1e-3;
+    stats->drift_ppb_day = w->drift_ppt_day * 1e-3;
+    stats->saved_unix = w->saved_unix;
+    stats->lock_seconds = w->lock_seconds;
+    stats->saves = saves;
+    stats->save_failures = save_failures;
+}
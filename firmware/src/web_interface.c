@@ -9,8 +9,11 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
 #include "lwip/tcp.h"
 
 #include "chronos_rb.h"
@@ -23,512 +26,112 @@
 #include "radio_timecode.h"
 #include "nmea_output.h"
 #include "gnss_input.h"
+#include "timing_core.h"
+#include "stability.h"
+#include "web_assets.h"
+#include "metrics.h"
+#include "net_timestamp.h"
+#include "time_protocol.h"
+#include "calendar.h"
+#include "roughtime.h"
+#include "nts.h"
+#include "nts_ke.h"
+#include "tsdb.h"
+#include "jitter_stats.h"
+#include "eth_w5500.h"
+
 
 /*============================================================================
  * HTTP CONSTANTS
  *============================================================================*/
 
-#define HTTP_RESPONSE_HEADER \
-    "HTTP/1.1 200 OK\r\n" \
-    "Content-Type: text/html; charset=utf-8\r\n" \
-    "Connection: close\r\n" \
-    "Cache-Control: no-cache\r\n" \
-    "\r\n"
-
-#define HTTP_JSON_HEADER \
-    "HTTP/1.1 200 OK\r\n" \
-    "Content-Type: application/json\r\n" \
-    "Connection: close\r\n" \
-    "Access-Control-Allow-Origin: *\r\n" \
-    "\r\n"
-
-#define HTTP_404_RESPONSE \
-    "HTTP/1.1 404 Not Found\r\n" \
-    "Content-Type: text/plain\r\n" \
-    "Connection: close\r\n" \
-    "\r\n" \
-    "404 Not Found"
-
-#define HTTP_REDIRECT_RESPONSE \
-    "HTTP/1.1 303 See Other\r\n" \
-    "Location: /config\r\n" \
-    "Connection: close\r\n" \
-    "\r\n"
-
-#define HTTP_OK_TEXT \
-    "HTTP/1.1 200 OK\r\n" \
-    "Content-Type: text/plain\r\n" \
-    "Connection: close\r\n" \
-    "\r\n"
-
-#define HTTP_400_RESPONSE \
-    "HTTP/1.1 400 Bad Request\r\n" \
-    "Content-Type: text/plain\r\n" \
-    "Connection: close\r\n" \
-    "\r\n"
+#define HTTP_STATUS_OK          "200 OK"
+#define HTTP_STATUS_SEE_OTHER   "303 See Other"
+#define HTTP_STATUS_NOT_MODIFIED "304 Not Modified"
+#define HTTP_STATUS_BAD_REQUEST "400 Bad Request"
+#define HTTP_STATUS_NOT_FOUND   "404 Not Found"
+#define HTTP_STATUS_UNAVAILABLE "503 Service Unavailable"
+
+#define HTTP_TYPE_HTML          "text/html; charset=utf-8"
+#define HTTP_TYPE_JSON          "application/json"
+#define HTTP_TYPE_TEXT          "text/plain"
+#define HTTP_TYPE_METRICS       "text/plain; version=0.0.4"
+#define HTTP_TYPE_BINARY        "application/octet-stream"
+
+#define WEB_LOG_MAX             4095    /* Max log bytes per /api/logs reply */
 
 /*============================================================================
- * HTML CONTENT
+ * JSON CONTENT
  *============================================================================*/
 
-static const char HTML_PAGE[] =
-"<!DOCTYPE html>"
-"<html><head>"
-"<title>⚛ CHRONOS-Rb Time Server</title>"
-"<link rel='icon' href=\"data:image/svg+xml,<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 100 100'><text y='.9em' font-size='90'>⚛</text></svg>\">"
-"<meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<style>"
-"*{box-sizing:border-box;margin:0;padding:0}"
-"body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Roboto,sans-serif;"
-"background:linear-gradient(135deg,#1a1a2e 0%%,#16213e 100%%);color:#eee;min-height:100vh;padding:20px}"
-".container{max-width:1200px;margin:0 auto}"
-"h1{text-align:center;margin-bottom:8px;font-size:1.8em}"
-".logo-ok{color:#4ade80;text-shadow:0 0 20px rgba(74,222,128,0.5)}"
-".logo-error{color:#f87171;text-shadow:0 0 20px rgba(248,113,113,0.5)}"
-".time-display{text-align:center;font-size:2.5em;font-family:'Courier New',monospace;margin-bottom:15px;min-width:280px}"
-".time-valid{color:#4ade80;text-shadow:0 0 20px rgba(74,222,128,0.5)}"
-".time-invalid{color:#f87171;text-shadow:0 0 20px rgba(248,113,113,0.5)}"
-".grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(320px,1fr));gap:15px}"
-".card{background:rgba(255,255,255,0.05);border-radius:12px;padding:15px;"
-"backdrop-filter:blur(10px);border:1px solid rgba(255,255,255,0.1)}"
-".card h2{color:#e94560;margin-bottom:10px;font-size:1.1em}"
-".stat{display:flex;justify-content:space-between;padding:6px 0;border-bottom:1px solid rgba(255,255,255,0.05)}"
-".stat:last-child{border-bottom:none}"
-".stat-label{color:#888;font-size:0.9em}"
-".stat-value{font-weight:bold;font-family:'Courier New',monospace;font-size:0.9em;text-align:right}"
-".status-locked{color:#4ade80}"
-".status-syncing{color:#fbbf24}"
-".status-error{color:#f87171}"
-".led{display:inline-block;width:8px;height:8px;border-radius:50%%;margin-right:6px}"
-".led-green{background:#4ade80;box-shadow:0 0 8px #4ade80}"
-".led-yellow{background:#fbbf24;box-shadow:0 0 8px #fbbf24}"
-".led-red{background:#f87171;box-shadow:0 0 8px #f87171}"
-".nav{text-align:center;margin-bottom:15px}"
-".nav a{color:#e94560;text-decoration:none;margin:0 8px;padding:4px 12px;border:1px solid #e94560;border-radius:4px;font-size:0.85em}"
-".nav a:hover{background:#e94560;color:#fff}"
-"footer{text-align:center;margin-top:20px;color:#555;font-size:0.8em}"
-"</style>"
-"</head><body>"
-"<div class='container'>"
-"<h1 class='%s'>&#9883; CHRONOS-Rb</h1>"
-"<div id='time' class='time-display %s'>%s</div>"
-"<div class='nav'><a href='/'>Status</a> <a href='/acfreq'>AC Freq</a> <a href='/config'>Config</a> <a href='/ota'>OTA</a></div>"
-"<div class='grid'>"
-"<div class='card'>"
-"<h2>System Status</h2>"
-"<div class='stat'><span class='stat-label'>Sync State</span>"
-"<span class='stat-value %s'><span class='led %s'></span>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Rubidium Lock</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Time Valid</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Uptime</span>"
-"<span class='stat-value'>%s</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>Time Discipline</h2>"
-"<div class='stat'><span class='stat-label'>Offset</span>"
-"<span class='stat-value'>%lld ns</span></div>"
-"<div class='stat'><span class='stat-label'>Freq Offset</span>"
-"<span class='stat-value'>%.3f ppb</span></div>"
-"<div class='stat'><span class='stat-label'>PPS Count</span>"
-"<span class='stat-value'>%lu</span></div>"
-"<div class='stat'><span class='stat-label'>Freq Count</span>"
-"<span class='stat-value'>%lu Hz</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>Network</h2>"
-"<div class='stat'><span class='stat-label'>IP Address</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>NTP Server</span>"
-"<span class='stat-value'>Port %d (S%d)</span></div>"
-"<div class='stat'><span class='stat-label'>NTP Requests</span>"
-"<span class='stat-value'>%lu</span></div>"
-"<div class='stat'><span class='stat-label'>PTP Syncs</span>"
-"<span class='stat-value'>%lu</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>AC Mains</h2>"
-"<div class='stat'><span class='stat-label'>Signal</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Frequency</span>"
-"<span class='stat-value'>%.3f Hz</span></div>"
-"<div class='stat'><span class='stat-label'>Average</span>"
-"<span class='stat-value'>%.3f Hz</span></div>"
-"<div class='stat'><span class='stat-label'>Range</span>"
-"<span class='stat-value'>%.3f - %.3f Hz</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>RF Outputs</h2>"
-"<div class='stat'><span class='stat-label'>DCF77 (77.5kHz)</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>WWVB (60kHz)</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>JJY40 (40kHz)</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>JJY60 (60kHz)</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>NMEA Serial</span>"
-"<span class='stat-value'>%s</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>GNSS Receiver</h2>"
-"<div class='stat'><span class='stat-label'>Status</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Fix</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Satellites</span>"
-"<span class='stat-value'>%d</span></div>"
-"<div class='stat'><span class='stat-label'>Position</span>"
-"<span class='stat-value'><a href='%s' target='_blank' style='color:#4ade80'>%s</a></span></div>"
-"<div class='stat'><span class='stat-label'>GNSS Time</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>GNSS PPS</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>PPS Offset</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>PPS Drift</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>PPS Jitter</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Rb PPS Captures</span>"
-"<span class='stat-value'>%lu</span></div>"
-"<div class='stat'><span class='stat-label'>GNSS PPS Captures</span>"
-"<span class='stat-value'>%lu</span></div>"
-"<div class='stat'><span class='stat-label'>GNSS Firmware</span>"
-"<span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>GNSS Hardware</span>"
-"<span class='stat-value'>%s</span></div>"
-"</div>"
-"</div>"
-"%s"
-"<footer>v%s | %s</footer>"
-"</div>"
-"<script>"
-"function updateTime(){"
-"fetch('/api/time').then(r=>r.json()).then(d=>{"
-"document.getElementById('time').textContent=d.time;"
-"document.getElementById('time').className='time-display '+(d.valid?'time-valid':'time-invalid');"
-"}).catch(()=>{});}"
-"setInterval(updateTime,500);"
-"setTimeout(function(){location.reload()},30000);"
-"</script>"
-"</body></html>";
-
-static const char CONFIG_PAGE[] =
-"<!DOCTYPE html>"
-"<html><head>"
-"<title>⚛ CHRONOS-Rb Configuration</title>"
-"<link rel='icon' href=\"data:image/svg+xml,<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 100 100'><text y='.9em' font-size='90'>⚛</text></svg>\">"
-"<meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<style>"
-"*{box-sizing:border-box;margin:0;padding:0}"
-"body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Roboto,sans-serif;"
-"background:linear-gradient(135deg,#1a1a2e 0%%,#16213e 100%%);color:#eee;min-height:100vh;padding:20px}"
-".container{max-width:600px;margin:0 auto}"
-"h1{text-align:center;margin-bottom:30px;font-size:1.8em;"
-"background:linear-gradient(90deg,#e94560,#0f3460);-webkit-background-clip:text;"
-"-webkit-text-fill-color:transparent}"
-".card{background:rgba(255,255,255,0.05);border-radius:15px;padding:20px;margin-bottom:20px;"
-"backdrop-filter:blur(10px);border:1px solid rgba(255,255,255,0.1)}"
-".card h2{color:#e94560;margin-bottom:15px;font-size:1.1em}"
-"label{display:block;color:#aaa;margin-bottom:5px;font-size:0.9em}"
-"input[type=text],input[type=password]{width:100%%;padding:10px;margin-bottom:15px;"
-"background:rgba(255,255,255,0.1);border:1px solid rgba(255,255,255,0.2);border-radius:8px;"
-"color:#fff;font-size:1em}"
-"input[type=text]:focus,input[type=password]:focus{outline:none;border-color:#e94560}"
-".checkbox-row{display:flex;align-items:center;margin-bottom:15px}"
-".checkbox-row input{margin-right:10px;width:18px;height:18px}"
-".checkbox-row label{margin-bottom:0}"
-"button{background:linear-gradient(90deg,#e94560,#0f3460);color:#fff;border:none;"
-"padding:12px 30px;border-radius:8px;cursor:pointer;font-size:1em;width:100%%}"
-"button:hover{opacity:0.9}"
-".nav{text-align:center;margin-bottom:20px}"
-".nav a{color:#e94560;text-decoration:none;margin:0 15px}"
-".msg{padding:10px;border-radius:8px;margin-bottom:15px;text-align:center}"
-".msg-ok{background:rgba(74,222,128,0.2);color:#4ade80}"
-".msg-err{background:rgba(248,113,113,0.2);color:#f87171}"
-".stat{display:flex;justify-content:space-between;padding:8px 0;border-bottom:1px solid rgba(255,255,255,0.1)}"
-".stat:last-child{border-bottom:none}"
-".stat-label{color:#aaa;font-size:0.9em}"
-".stat-value{font-family:'Courier New',monospace;font-size:0.9em}"
-".note{color:#888;font-size:0.85em;margin-top:10px}"
-".cli-output{background:#0a0a12;border-radius:8px;padding:12px;font-family:'Courier New',monospace;"
-"font-size:12px;white-space:pre;height:60em;line-height:1.2em;overflow:auto;margin-bottom:15px;color:#0f0}"
-".cli-input input{width:100%%;background:rgba(255,255,255,0.1);border:1px solid rgba(255,255,255,0.2);"
-"border-radius:8px;padding:10px;color:#fff;font-family:'Courier New',monospace;font-size:12px;margin-bottom:10px}"
-".cli-input button{width:100%%}"
-"footer{text-align:center;margin-top:30px;color:#666;font-size:0.9em}"
-"</style>"
-"</head><body>"
-"<div class='container'>"
-"<h1>⚙ Configuration</h1>"
-"<div class='nav'><a href='/'>← Status</a><a href='/config'>Config</a></div>"
-"%s"
-"<form method='POST' action='/config'>"
-"<div class='card'>"
-"<h2>WiFi Settings</h2>"
-"<label>SSID</label>"
-"<input type='text' name='ssid' value='%s' maxlength='32'>"
-"<label>Password</label>"
-"<input type='password' name='pass' placeholder='Enter new password' maxlength='64'>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='auto' id='auto' %s>"
-"<label for='auto'>Auto-connect on boot</label>"
-"</div>"
-"</div>"
-"<div class='card'>"
-"<h2>System Settings</h2>"
-"<div class='checkbox-row'>"
-"<input type='checkbox' name='debug' id='debug' %s>"
-"<label for='debug'>Enable debug output</label>"
-"</div>"
-"</div>"
-"<button type='submit'>Save Configuration</button>"
-"</form>"
-"%s"
-"<div class='card'>"
-"<h2>Command Line</h2>"
-"<div class='cli-output' id='cli-out'>Type a command and press Run</div>"
-"<div class='cli-input'>"
-"<input type='text' id='cli-cmd' placeholder='Enter command (e.g., help, status, reboot)' autocomplete='off'>"
-"<button onclick='runCmd()'>Run</button>"
-"</div>"
-"</div>"
-"<footer>CHRONOS-Rb v%s</footer>"
-"</div>"
-"<script>"
-"var logPos=0,logOut=document.getElementById('cli-out');"
-"function appendLog(txt){"
-"if(!txt)return;"
-"logOut.textContent+=txt;"
-"logOut.scrollTop=logOut.scrollHeight;"
-"}"
-"function pollLogs(){"
-"fetch('/api/logs?pos='+logPos)"
-".then(r=>r.json()).then(d=>{"
-"logPos=d.pos;appendLog(d.data);"
-"}).catch(e=>{});"
-"}"
-"function runCmd(){"
-"var i=document.getElementById('cli-cmd'),cmd=i.value;"
-"if(!cmd)return;"
-"i.value='';"
-"fetch('/api/cli',{method:'POST',body:'cmd='+encodeURIComponent(cmd),"
-"headers:{'Content-Type':'application/x-www-form-urlencoded'}})"
-".then(r=>r.json()).then(d=>{"
-"if(d.ok)appendLog('> '+cmd+'\\n'+d.output+'\\n');else appendLog('Error: '+d.error+'\\n');"
-"}).catch(e=>{appendLog('Error: '+e+'\\n');});"
-"}"
-"document.getElementById('cli-cmd').addEventListener('keypress',function(e){"
-"if(e.key==='Enter')runCmd();});"
-"setInterval(pollLogs,1000);"
-"logOut.textContent='';"
-"pollLogs();"
-"</script>"
-"</body></html>";
-
-/* AC Frequency Graph Page */
-static const char AC_GRAPH_PAGE[] =
-"<!DOCTYPE html>"
-"<html><head>"
-"<title>⚛ AC Frequency - CHRONOS-Rb</title>"
-"<link rel='icon' href=\"data:image/svg+xml,<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 100 100'><text y='.9em' font-size='90'>⚛</text></svg>\">"
-"<meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<style>"
-"*{box-sizing:border-box;margin:0;padding:0}"
-"body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Roboto,sans-serif;"
-"background:linear-gradient(135deg,#1a1a2e 0%%,#16213e 100%%);color:#eee;min-height:100vh;padding:20px}"
-".container{max-width:900px;margin:0 auto}"
-"h1{text-align:center;margin-bottom:20px;font-size:1.6em}"
-".card{background:rgba(255,255,255,0.05);border-radius:15px;padding:20px;margin-bottom:20px;"
-"backdrop-filter:blur(10px);border:1px solid rgba(255,255,255,0.1)}"
-".card h2{color:#e94560;margin-bottom:10px;font-size:1.1em}"
-".nav{text-align:center;margin-bottom:20px}"
-".nav a{color:#e94560;text-decoration:none;margin:0 15px}"
-".graph{width:100%%;height:200px;background:#0a0a12;border-radius:8px;position:relative}"
-".graph svg{width:100%%;height:100%%}"
-".axis{stroke:#444;stroke-width:1}"
-".grid{stroke:#333;stroke-width:0.5}"
-".line{fill:none;stroke:#e94560;stroke-width:2}"
-".label{fill:#888;font-size:10px}"
-".value{fill:#e94560;font-size:12px}"
-".nominal{stroke:#4a4;stroke-width:1;stroke-dasharray:5,5}"
-".info{display:flex;justify-content:space-between;margin-top:10px;font-size:0.9em;color:#aaa}"
-".time-range{text-align:center;font-size:0.85em;color:#666;margin-top:5px}"
-"</style>"
-"</head><body>"
-"<div class='container'>"
-"<h1>⚛ AC Mains Frequency</h1>"
-"<div class='nav'>"
-"<a href='/'>Status</a>"
-"<a href='/acfreq'>AC Freq</a>"
-"<a href='/config'>Config</a>"
-"<a href='/ota'>OTA</a>"
-"</div>"
-"<div class='card'>"
-"<h2>Last 60 Minutes</h2>"
-"<div class='graph' id='min-graph'><svg></svg></div>"
-"<div class='info'><span id='min-info'>Loading...</span><span id='min-range'></span></div>"
-"<div class='time-range' id='min-time'></div>"
-"</div>"
-"<div class='card'>"
-"<h2>Last 48 Hours</h2>"
-"<div class='graph' id='hour-graph'><svg></svg></div>"
-"<div class='info'><span id='hour-info'>Loading...</span><span id='hour-range'></span></div>"
-"<div class='time-range' id='hour-time'></div>"
-"</div>"
-"</div>"
-"<script>"
-"function fmtTime(d){return d.toTimeString().slice(0,5);}"
-"function fmtDateShort(d){return d.toISOString().slice(5,10);}"
-"function fmtDate(d){return d.toISOString().slice(0,10)+' '+d.toTimeString().slice(0,5);}"
-"function drawGraph(id,data,nowMs,intervalMs){"
-"if(!data||data.length===0){document.querySelector('#'+id+' svg').innerHTML='<text x=\"50%%\" y=\"50%%\" text-anchor=\"middle\" fill=\"#666\">No data yet</text>';return null;}"
-"var svg=document.querySelector('#'+id+' svg');"
-"var w=svg.clientWidth||850,h=svg.clientHeight||200;"
-"var isHour=intervalMs>=3600000;"
-"var pad={t:20,r:20,b:isHour?45:35,l:50};"
-"var gw=w-pad.l-pad.r,gh=h-pad.t-pad.b;"
-"var min=Math.min(...data),max=Math.max(...data);"
-"var range=max-min;if(range<0.1)range=0.1;"
-"min-=range*0.1;max+=range*0.1;"
-"var nom=data[0]>55?60:50;"
-"var html='<g transform=\"translate('+pad.l+','+pad.t+')\">';"
-"html+='<line class=\"axis\" x1=\"0\" y1=\"'+gh+'\" x2=\"'+gw+'\" y2=\"'+gh+'\"/>';"
-"html+='<line class=\"axis\" x1=\"0\" y1=\"0\" x2=\"0\" y2=\"'+gh+'\"/>';"
-"for(var i=0;i<=4;i++){var y=gh*i/4;var v=(max-(max-min)*i/4).toFixed(2);"
-"html+='<line class=\"grid\" x1=\"0\" y1=\"'+y+'\" x2=\"'+gw+'\" y2=\"'+y+'\"/>';"
-"html+='<text class=\"label\" x=\"-5\" y=\"'+(y+4)+'\" text-anchor=\"end\">'+v+'</text>';}"
-"var startMs=nowMs-(data.length-1)*intervalMs;"
-"var ticks=isHour?6:5;var lastDate='';"
-"for(var i=0;i<=ticks;i++){var x=gw*i/ticks;var tMs=startMs+(data.length-1)*intervalMs*i/ticks;"
-"var dt=new Date(tMs);html+='<text class=\"label\" x=\"'+x+'\" y=\"'+(gh+12)+'\" text-anchor=\"middle\">'+fmtTime(dt)+'</text>';"
-"if(isHour){var ds=fmtDateShort(dt);if(ds!==lastDate){html+='<text class=\"label\" x=\"'+x+'\" y=\"'+(gh+24)+'\" text-anchor=\"middle\">'+ds+'</text>';lastDate=ds;}}}"
-"var ny=gh-(nom-min)/(max-min)*gh;"
-"if(ny>0&&ny<gh)html+='<line class=\"nominal\" x1=\"0\" y1=\"'+ny+'\" x2=\"'+gw+'\" y2=\"'+ny+'\"/>';"
-"var pts='';for(var i=0;i<data.length;i++){var x=gw*i/(data.length-1||1);var y=gh-(data[i]-min)/(max-min)*gh;pts+=(i?'L':'M')+x+','+y;}"
-"html+='<path class=\"line\" d=\"'+pts+'\"/>';"
-"html+='</g>';svg.innerHTML=html;"
-"var startDt=new Date(startMs),endDt=new Date(nowMs);"
-"return{min:Math.min(...data).toFixed(3),max:Math.max(...data).toFixed(3),avg:(data.reduce((a,b)=>a+b,0)/data.length).toFixed(3),start:startDt,end:endDt};}"
-"function update(){"
-"fetch('/api/ac_history').then(r=>r.json()).then(d=>{"
-"var nowMs=d.time_unix*1000;"
-"var m=drawGraph('min-graph',d.minutes,nowMs,60000);"
-"if(m){document.getElementById('min-info').textContent=d.min_count+' samples, avg: '+m.avg+' Hz';"
-"document.getElementById('min-range').textContent='Range: '+m.min+' - '+m.max+' Hz';"
-"document.getElementById('min-time').textContent=fmtDate(m.start)+' → '+fmtDate(m.end);}"
-"var h=drawGraph('hour-graph',d.hours,nowMs,3600000);"
-"if(h){document.getElementById('hour-info').textContent=d.hour_count+' samples, avg: '+h.avg+' Hz';"
-"document.getElementById('hour-range').textContent='Range: '+h.min+' - '+h.max+' Hz';"
-"document.getElementById('hour-time').textContent=fmtDate(h.start)+' → '+fmtDate(h.end);}"
-"}).catch(e=>{console.error(e);});}"
-"update();setInterval(update,60000);"
-"</script>"
-"</body></html>";
-
-static const char OTA_PAGE[] =
-"<!DOCTYPE html>"
-"<html><head>"
-"<title>⚛ CHRONOS-Rb OTA Update</title>"
-"<link rel='icon' href=\"data:image/svg+xml,<svg xmlns='http://www.w3.org/2000/svg' viewBox='0 0 100 100'><text y='.9em' font-size='90'>⚛</text></svg>\">"
-"<meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<style>"
-"*{box-sizing:border-box;margin:0;padding:0}"
-"body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Roboto,sans-serif;"
-"background:linear-gradient(135deg,#1a1a2e 0%%,#16213e 100%%);color:#eee;min-height:100vh;padding:20px}"
-".container{max-width:600px;margin:0 auto}"
-"h1{text-align:center;margin-bottom:30px;font-size:1.8em;"
-"background:linear-gradient(90deg,#e94560,#0f3460);-webkit-background-clip:text;"
-"-webkit-text-fill-color:transparent}"
-".card{background:rgba(255,255,255,0.05);border-radius:15px;padding:20px;margin-bottom:20px;"
-"backdrop-filter:blur(10px);border:1px solid rgba(255,255,255,0.1)}"
-".card h2{color:#e94560;margin-bottom:15px;font-size:1.1em}"
-".nav{text-align:center;margin-bottom:20px}"
-".nav a{color:#e94560;text-decoration:none;margin:0 15px}"
-".stat{display:flex;justify-content:space-between;padding:8px 0;border-bottom:1px solid rgba(255,255,255,0.1)}"
-".stat:last-child{border-bottom:none}"
-".stat-label{color:#aaa;font-size:0.9em}"
-".stat-value{font-family:'Courier New',monospace;font-size:0.9em}"
-"input[type=file]{width:100%%;padding:10px;margin-bottom:15px;background:rgba(255,255,255,0.1);"
-"border:1px solid rgba(255,255,255,0.2);border-radius:8px;color:#fff}"
-"button{background:linear-gradient(90deg,#e94560,#0f3460);color:#fff;border:none;"
-"padding:12px 30px;border-radius:8px;cursor:pointer;font-size:1em;width:100%%}"
-"button:hover{opacity:0.9}"
-"button:disabled{opacity:0.5;cursor:not-allowed}"
-".progress{width:100%%;height:20px;background:rgba(255,255,255,0.1);border-radius:10px;overflow:hidden;margin:15px 0}"
-".progress-bar{height:100%%;background:linear-gradient(90deg,#4ade80,#22c55e);width:0%%;transition:width 0.3s}"
-".msg{padding:10px;border-radius:8px;margin:15px 0;text-align:center}"
-".msg-ok{background:rgba(74,222,128,0.2);color:#4ade80}"
-".msg-err{background:rgba(248,113,113,0.2);color:#f87171}"
-".msg-warn{background:rgba(251,191,36,0.2);color:#fbbf24}"
-"#status{font-family:'Courier New',monospace}"
-"footer{text-align:center;margin-top:30px;color:#666;font-size:0.9em}"
-"</style>"
-"</head><body>"
-"<div class='container'>"
-"<h1>Firmware Update</h1>"
-"<div class='nav'><a href='/'>Status</a><a href='/acfreq'>AC Freq</a><a href='/config'>Config</a><a href='/ota'>OTA</a></div>"
-"%s"
-"<div class='card'>"
-"<h2>Current Firmware</h2>"
-"<div class='stat'><span class='stat-label'>Version</span><span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>Build Date</span><span class='stat-value'>%s</span></div>"
-"<div class='stat'><span class='stat-label'>OTA State</span><span class='stat-value'>%s</span></div>"
-"</div>"
-"<div class='card'>"
-"<h2>Upload Firmware</h2>"
-"<p style='color:#aaa;font-size:0.9em;margin-bottom:15px'>Select the encrypted FOTA image file (*_fota_image_encrypted.bin)</p>"
-"<input type='file' id='firmware' accept='.bin'>"
-"<div class='progress'><div class='progress-bar' id='progressBar'></div></div>"
-"<div id='status'></div>"
-"<button id='uploadBtn' onclick='uploadFirmware()'>Upload Firmware</button>"
-"</div>"
-"<div class='card' id='applyCard' style='display:none'>"
-"<h2>Apply Update</h2>"
-"<p style='color:#aaa;font-size:0.9em;margin-bottom:15px'>Firmware verified successfully. Click to apply and reboot.</p>"
-"<button onclick='applyUpdate()' style='background:linear-gradient(90deg,#22c55e,#16a34a)'>Apply & Reboot</button>"
-"</div>"
-"<footer>CHRONOS-Rb v%s</footer>"
-"</div>"
-"<script>"
-"async function uploadFirmware(){"
-"const f=document.getElementById('firmware').files[0];"
-"if(!f){alert('Select a file');return;}"
-"const btn=document.getElementById('uploadBtn');"
-"const bar=document.getElementById('progressBar');"
-"const stat=document.getElementById('status');"
-"btn.disabled=true;bar.style.width='0%%';"
-"stat.textContent='Initializing...';"
-"try{"
-"let r=await fetch('/api/ota/begin',{method:'POST',headers:{'X-OTA-Size':f.size}});"
-"if(!r.ok)throw new Error(await r.text());"
-"const chunk=1024;let sent=0;"
-"while(sent<f.size){"
-"const end=Math.min(sent+chunk,f.size);"
-"const blob=f.slice(sent,end);"
-"const data=await blob.arrayBuffer();"
-"r=await fetch('/api/ota/chunk',{method:'POST',body:new Uint8Array(data),"
-"headers:{'Content-Type':'application/octet-stream'}});"
-"if(!r.ok)throw new Error(await r.text());"
-"sent=end;bar.style.width=(sent*100/f.size)+'%%';"
-"stat.textContent='Uploading... '+(sent*100/f.size).toFixed(1)+'%%';}"
-"stat.textContent='Validating...';"
-"r=await fetch('/api/ota/finish',{method:'POST'});"
-"if(!r.ok)throw new Error(await r.text());"
-"bar.style.width='100%%';"
-"stat.innerHTML='<span class=\"msg msg-ok\">Upload complete! Ready to apply.</span>';"
-"document.getElementById('applyCard').style.display='block';"
-"}catch(e){stat.innerHTML='<span class=\"msg msg-err\">Error: '+e.message+'</span>';}"
-"btn.disabled=false;}"
-"async function applyUpdate(){"
-"if(!confirm('Apply update and reboot now?'))return;"
-"document.getElementById('status').innerHTML='<span class=\"msg msg-warn\">Rebooting...</span>';"
-"await fetch('/api/ota/apply',{method:'POST'});"
-"setTimeout(()=>location.reload(),5000);}"
-"</script>"
-"</body></html>";
+/* /api/status - also feeds the static status page. "ntp" and
+ * "pulse_outputs" are generated sections. */
+static const char JSON_STATUS[] =
+"{"
+"\"sync_state\":%d,"
+"\"rb_locked\":%s,"
+"\"time_valid\":%s,"
+"\"current_time\":\"%s\","
+"\"uptime_sec\":%lu,"
+"\"offset_ns\":%lld,"
+"\"freq_offset_ppb\":%.3f,"
+"\"pps_count\":%lu,"
+"\"freq_count\":%lu,"
+"\"freq_measurements\":%lu,"
+"\"ntp_requests\":%lu,"
+"\"ntp_port\":%d,"
+"\"stratum\":%d,"
+"\"ntp\":%s,"
+"\"ptp_syncs\":%lu,"
+"\"ac_mains\":{"
+"\"signal\":%s,"
+"\"freq_hz\":%.3f,"
+"\"avg_hz\":%.3f,"
+"\"min_hz\":%.3f,"
+"\"max_hz\":%.3f,"
+"\"zero_crossings\":%lu,"
+"\"rocof_hz_s\":%.3f,"
+"\"grid_time_error_ms\":%.3f,"
+"\"rb_referenced\":%s"
+"},"
+"\"rf_outputs\":{"
+"\"dcf77\":%s,"
+"\"wwvb\":%s,"
+"\"jjy40\":%s,"
+"\"jjy60\":%s"
+"},"
+"\"nmea\":%s,"
+"\"gps\":{"
+"\"enabled\":%s,"
+"\"has_fix\":%s,"
+"\"has_time\":%s,"
+"\"pps_valid\":%s,"
+"\"satellites\":%d,"
+"\"fix_type\":%d,"
+"\"lat\":%.6f,"
+"\"lon\":%.6f,"
+"\"utc\":\"%s\","
+"\"pps_count\":%lu,"
+"\"nmea_count\":%lu,"
+"\"nmea_errors\":%lu,"
+"\"firmware\":\"%s\","
+"\"hardware\":\"%s\","
+"\"leap_seconds\":%d,"
+"\"leap_valid\":%s"
+"},"
+"\"pps_offset\":{"
+"\"valid\":%s,"
+"\"offset_ns\":%ld,"
+"\"drift_ns_s\":%.1f,"
+"\"jitter_ns\":%.1f,"
+"\"rb_captures\":%lu,"
+"\"gnss_captures\":%lu"
+"},"
+"\"pulse_outputs\":%s,"
+"\"ip\":\"%s\","
+"\"version\":\"%s\","
+"\"build\":\"%s\""
+"}";
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -537,6 +140,706 @@ static const char OTA_PAGE[] =
 static struct tcp_pcb *web_pcb = NULL;
 static bool web_running = false;
 
+/*============================================================================
+ * RESPONSE STREAMING
+ *============================================================================*/
+
+/*
+ * Every response is a printf-style template plus an argument list held
+ * per connection. Nothing is rendered up front: web_pump() fills one
+ * HTTP/1.1 chunk at a time into a shared scratch buffer, sized to what
+ * the TCP send buffer will take right now, and is re-entered from the
+ * tcp_sent and tcp_poll callbacks until the template is exhausted.
+ * Repeating sections (pulse outputs, NTP clients, logs, ...) are
+ * generator arguments that emit whole rows and resume from a cursor.
+ * If tcp_write fails the fill cursor is rolled back and the same bytes
+ * are produced again on the next callback.
+ */
+
+#define WEB_CHUNK_SIZE          1024    /* Max body bytes per HTTP chunk */
+#define WEB_CHUNK_MIN           256     /* Don't fill for less than this */
+#define WEB_CHUNK_HEAD          6       /* "hhhh\r\n" */
+#define WEB_CHUNK_OVERHEAD      (WEB_CHUNK_HEAD + 2 + 5)  /* + "\r\n" + "0\r\n\r\n" */
+#define WEB_INFLIGHT_MAX        (2 * TCP_MSS)   /* Unacked bytes per connection */
+#define WEB_MAX_ARGS            56
+#define WEB_POOL_SIZE           384     /* Formatted string arguments */
+#define WEB_HEAD_SIZE           256
+#define WEB_POLL_INTERVAL       2       /* tcp_poll units of 500 ms */
+#define WEB_KEEPALIVE_S         10      /* Idle keep-alive connection lifetime */
+#define WEB_STALL_S             30      /* Streaming with no ACK progress */
+
+typedef struct web_conn web_conn_t;
+
+/* Emit whole rows into buf, resuming from c->cur.off. Returns bytes
+ * written; sets *done once the section is complete. */
+typedef size_t (*web_gen_fn)(web_conn_t *c, char *buf, size_t len, bool *done);
+
+typedef enum {
+    WA_STR,                     /* Streamed verbatim at any %s */
+    WA_INT,
+    WA_UINT,
+    WA_I64,
+    WA_DBL,
+    WA_GEN                      /* Generator at %s */
+} web_arg_type_t;
+
+typedef struct {
+    union {
+        const char *s;
+        long i;
+        unsigned long u;
+        long long ll;
+        double d;
+        struct {
+            web_gen_fn fn;
+            uint32_t from;      /* Initial cursor */
+            uint32_t to;        /* Generator-defined limit */
+        } gen;
+    } v;
+    uint8_t type;
+} web_arg_t;
+
+typedef struct {
+    uint32_t tpl_pos;           /* Next template byte */
+    uint32_t off;               /* String offset / generator cursor */
+    uint32_t aux;               /* String length / generator limit */
+    uint8_t arg;                /* Next argument */
+    bool in_arg;                /* Part way through a string or generator */
+    bool body_done;
+} web_cursor_t;
+
+typedef enum {
+    WEB_CONN_FREE = 0,
+    WEB_CONN_IDLE,              /* Waiting for a (keep-alive) request */
+    WEB_CONN_STREAMING,         /* Response being generated */
+    WEB_CONN_EVENTS,            /* Subscribed to /api/events */
+    WEB_CONN_CLOSING            /* tcp_close failed, retried from poll */
+} web_conn_state_t;
+
+struct web_conn {
+    struct tcp_pcb *pcb;
+    web_conn_state_t state;
+    bool keep_alive;
+    bool chunked;               /* HTTP/1.1 client */
+    uint8_t idle_polls;
+    uint16_t head_len;          /* Unsent response header bytes */
+    char head[WEB_HEAD_SIZE];
+    const char *tpl;            /* Body template, NULL for none */
+    uint32_t tpl_len;
+    const web_asset_t *asset;   /* Or a body sent in place from flash */
+    uint32_t asset_off;
+    web_cursor_t cur;
+    uint8_t nargs;
+    uint16_t pool_used;
+    web_arg_t args[WEB_MAX_ARGS];
+    char pool[WEB_POOL_SIZE];
+};
+
+static web_conn_t web_conns[WEB_MAX_CONNECTIONS];
+static char web_scratch[WEB_CHUNK_SIZE + WEB_CHUNK_OVERHEAD];
+
+/* The CLI has one output stream (cli_stream_start()), read by one
+ * connection until the response carrying it has been queued */
+static web_conn_t *cli_owner = NULL;
+
+static void web_reset(web_conn_t *c) {
+    c->nargs = 0;
+    c->pool_used = 0;
+    c->head_len = 0;
+    c->tpl = NULL;
+    c->asset = NULL;
+    memset(&c->cur, 0, sizeof(c->cur));
+}
+
+static web_arg_t *web_arg(web_conn_t *c, web_arg_type_t type) {
+    static web_arg_t discard;
+    if (c->nargs >= WEB_MAX_ARGS) {
+        return &discard;
+    }
+    web_arg_t *a = &c->args[c->nargs++];
+    a->type = type;
+    return a;
+}
+
+/* String argument - must outlive the response (literal or static) */
+static void web_arg_str(web_conn_t *c, const char *s) {
+    web_arg(c, WA_STR)->v.s = s ? s : "";
+}
+
+/* Formatted string argument, copied into the connection's pool */
+static void web_arg_strf(web_conn_t *c, const char *fmt, ...) {
+    char *dst = c->pool + c->pool_used;
+    size_t room = sizeof(c->pool) - c->pool_used;
+    const char *s = "";
+
+    if (room > 1) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(dst, room, fmt, ap);
+        va_end(ap);
+        if (n >= 0) {
+            size_t used = ((size_t)n < room) ? (size_t)n + 1 : room;
+            c->pool_used += used;
+            s = dst;
+        }
+    }
+    web_arg_str(c, s);
+}
+
+static void web_arg_int(web_conn_t *c, long v) {
+    web_arg(c, WA_INT)->v.i = v;
+}
+
+static void web_arg_uint(web_conn_t *c, unsigned long v) {
+    web_arg(c, WA_UINT)->v.u = v;
+}
+
+static void web_arg_i64(web_conn_t *c, long long v) {
+    web_arg(c, WA_I64)->v.ll = v;
+}
+
+static void web_arg_dbl(web_conn_t *c, double v) {
+    web_arg(c, WA_DBL)->v.d = v;
+}
+
+static void web_arg_gen(web_conn_t *c, web_gen_fn fn, uint32_t from, uint32_t to) {
+    web_arg_t *a = web_arg(c, WA_GEN);
+    a->v.gen.fn = fn;
+    a->v.gen.from = from;
+    a->v.gen.to = to;
+}
+
+/**
+ * Start a response: status line and headers, then the body template
+ * with the arguments already added
+ */
+static void web_respond(web_conn_t *c, const char *status, const char *type,
+                        const char *tpl) {
+    const char *extra = "";
+    if (strcmp(type, HTTP_TYPE_JSON) == 0) {
+        extra = "Access-Control-Allow-Origin: *\r\n";
+    } else if (strcmp(type, HTTP_TYPE_HTML) == 0) {
+        extra = "Cache-Control: no-cache\r\n";
+    }
+
+    int n = snprintf(c->head, sizeof(c->head),
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: %s\r\n"
+        "%s%s"
+        "Connection: %s\r\n"
+        "\r\n",
+        status, type, extra,
+        c->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+        c->keep_alive ? "keep-alive" : "close");
+    c->head_len = (n > 0 && n < (int)sizeof(c->head)) ? (uint16_t)n : 0;
+
+    c->tpl = tpl;
+    c->tpl_len = strlen(tpl);
+    memset(&c->cur, 0, sizeof(c->cur));
+    c->state = WEB_CONN_STREAMING;
+}
+
+/* Plain response body that needs no formatting */
+static void web_respond_text(web_conn_t *c, const char *status, const char *type,
+                             const char *text) {
+    web_arg_str(c, text);
+    web_respond(c, status, type, "%s");
+}
+
+/**
+ * Produce up to len body bytes from the template and arguments.
+ * Scalars are only emitted whole; strings and generators can split.
+ */
+static size_t web_fill(web_conn_t *c, char *buf, size_t len) {
+    web_cursor_t *cur = &c->cur;
+    size_t pos = 0;
+
+    while (pos < len) {
+        if (cur->in_arg) {
+            const web_arg_t *a = &c->args[cur->arg];
+            if (a->type == WA_GEN) {
+                bool done = false;
+                pos += a->v.gen.fn(c, buf + pos, len - pos, &done);
+                if (!done) {
+                    break;
+                }
+            } else {
+                size_t n = cur->aux - cur->off;
+                if (n > len - pos) {
+                    n = len - pos;
+                }
+                memcpy(buf + pos, a->v.s + cur->off, n);
+                cur->off += n;
+                pos += n;
+                if (cur->off < cur->aux) {
+                    break;
+                }
+            }
+            cur->in_arg = false;
+            cur->arg++;
+            continue;
+        }
+
+        if (cur->tpl_pos >= c->tpl_len) {
+            cur->body_done = true;
+            break;
+        }
+
+        const char *t = c->tpl + cur->tpl_pos;
+        size_t left = c->tpl_len - cur->tpl_pos;
+
+        if (*t != '%') {
+            const char *pct = memchr(t, '%', left);
+            size_t n = pct ? (size_t)(pct - t) : left;
+            if (n > len - pos) {
+                n = len - pos;
+            }
+            memcpy(buf + pos, t, n);
+            cur->tpl_pos += n;
+            pos += n;
+            continue;
+        }
+
+        if (left > 1 && t[1] == '%') {
+            buf[pos++] = '%';
+            cur->tpl_pos += 2;
+            continue;
+        }
+
+        /* Conversion: keep flags/width/precision, rebuild the length
+         * modifier from the argument type */
+        char spec[16];
+        size_t s = 0, i = 1;
+        spec[s++] = '%';
+        while (i < left && strchr("-+ #0123456789.", t[i]) && s < 10) {
+            spec[s++] = t[i++];
+        }
+        while (i < left && (t[i] == 'l' || t[i] == 'h' || t[i] == 'z')) {
+            i++;
+        }
+        if (i >= left) {
+            cur->tpl_pos = c->tpl_len;
+            continue;
+        }
+        char conv = t[i++];
+
+        if (cur->arg >= c->nargs) {
+            cur->tpl_pos += i;
+            continue;
+        }
+
+        const web_arg_t *a = &c->args[cur->arg];
+        if (a->type == WA_STR || a->type == WA_GEN) {
+            cur->tpl_pos += i;
+            cur->in_arg = true;
+            if (a->type == WA_GEN) {
+                cur->off = a->v.gen.from;
+                cur->aux = a->v.gen.to;
+            } else {
+                cur->off = 0;
+                cur->aux = strlen(a->v.s);
+            }
+            continue;
+        }
+
+        char num[40];
+        int n = 0;
+        switch (a->type) {
+            case WA_INT:
+                spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(num, sizeof(num), spec, a->v.i);
+                break;
+            case WA_UINT:
+                spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(num, sizeof(num), spec, a->v.u);
+                break;
+            case WA_I64:
+                spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(num, sizeof(num), spec, a->v.ll);
+                break;
+            default:
+                spec[s++] = conv; spec[s] = '\0';
+                n = snprintf(num, sizeof(num), spec, a->v.d);
+                break;
+        }
+        if (n < 0) {
+            n = 0;
+        } else if (n >= (int)sizeof(num)) {
+            n = sizeof(num) - 1;
+        }
+        if ((size_t)n > len - pos) {
+            break;
+        }
+        memcpy(buf + pos, num, n);
+        pos += n;
+        cur->tpl_pos += i;
+        cur->arg++;
+    }
+
+    return pos;
+}
+
+/*============================================================================
+ * CONNECTIONS
+ *============================================================================*/
+
+/* OTA chunk buffering state */
+static uint8_t ota_chunk_buf[1280];  /* Buffer for OTA chunk data */
+static size_t ota_chunk_expected = 0;
+static size_t ota_chunk_received = 0;
+static web_conn_t *ota_chunk_conn = NULL;
+
+/* Streaming OTA upload: one POST whose body goes straight to
+ * ota_stream_write(), acknowledged to TCP only once consumed */
+static web_conn_t *ota_stream_conn = NULL;
+static size_t ota_stream_remaining = 0;
+static size_t ota_stream_body_offset = 0;  /* Body start in the first pbuf */
+
+static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+static err_t web_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len);
+static err_t web_poll_callback(void *arg, struct tcp_pcb *tpcb);
+static void web_err_callback(void *arg, err_t err);
+
+static void web_conn_free(web_conn_t *c) {
+    if (cli_owner == c) {
+        cli_stream_close();
+        cli_owner = NULL;
+    }
+    if (ota_chunk_conn == c) {
+        ota_chunk_expected = 0;
+        ota_chunk_received = 0;
+        ota_chunk_conn = NULL;
+    }
+    if (ota_stream_conn == c) {
+        /* Upload cut short */
+        ota_stream_conn = NULL;
+        ota_abort();
+    }
+    c->pcb = NULL;
+    c->state = WEB_CONN_FREE;
+}
+
+/**
+ * Close gracefully; queued data is still delivered by lwIP. If lwIP is
+ * out of memory the close is retried from the poll callback.
+ */
+static void web_close(web_conn_t *c) {
+    struct tcp_pcb *pcb = c->pcb;
+
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+
+    if (tcp_close(pcb) != ERR_OK) {
+        tcp_arg(pcb, c);
+        tcp_err(pcb, web_err_callback);
+        tcp_poll(pcb, web_poll_callback, WEB_POLL_INTERVAL);
+        c->state = WEB_CONN_CLOSING;
+        return;
+    }
+
+    web_conn_free(c);
+}
+
+/* Whole body queued */
+static void web_finish(web_conn_t *c) {
+    if (cli_owner == c) {
+        cli_stream_close();
+        cli_owner = NULL;
+    }
+    c->state = WEB_CONN_IDLE;
+    c->idle_polls = 0;
+    if (!c->keep_alive) {
+        web_close(c);
+    }
+}
+
+/* Bytes this connection may queue now with at most limit unacked. Copied
+ * data costs heap, so it is held to WEB_INFLIGHT_MAX; data referenced
+ * in flash only costs segments and may use the whole send buffer. */
+static size_t web_send_room(struct tcp_pcb *pcb, size_t limit) {
+    size_t room = tcp_sndbuf(pcb);
+    size_t inflight = TCP_SND_BUF - room;
+
+    if (inflight >= limit || tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN - 2) {
+        return 0;
+    }
+    if (room > limit - inflight) {
+        room = limit - inflight;
+    }
+    return room;
+}
+
+/**
+ * Queue the next MSS-sized pieces of a flash asset. No copy: lwIP
+ * references the XIP data until it is acknowledged.
+ */
+static bool web_pump_asset(web_conn_t *c, bool *queued) {
+    struct tcp_pcb *pcb = c->pcb;
+    const web_asset_t *a = c->asset;
+
+    while (c->asset_off < a->len) {
+        size_t n = a->len - c->asset_off;
+        size_t room = web_send_room(pcb, TCP_SND_BUF);
+        if (n > TCP_MSS) n = TCP_MSS;
+        if (n > room) n = room;
+        if (n == 0) {
+            return false;
+        }
+
+        bool last = (c->asset_off + n >= a->len);
+        if (tcp_write(pcb, a->data + c->asset_off, (u16_t)n,
+                      last ? 0 : TCP_WRITE_FLAG_MORE) != ERR_OK) {
+            return false;
+        }
+        c->asset_off += n;
+        *queued = true;
+    }
+    return true;
+}
+
+/**
+ * Queue as much of the response as the send buffer allows
+ */
+static void web_pump(web_conn_t *c) {
+    struct tcp_pcb *pcb = c->pcb;
+    bool queued = false;
+
+    while (c->state == WEB_CONN_STREAMING) {
+        size_t room = web_send_room(pcb, WEB_INFLIGHT_MAX);
+
+        if (c->head_len > 0) {
+            if (room < c->head_len ||
+                tcp_write(pcb, c->head, c->head_len,
+                          TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK) {
+                break;
+            }
+            c->head_len = 0;
+            queued = true;
+            continue;
+        }
+
+        if (c->asset != NULL || c->tpl == NULL) {
+            if (c->asset != NULL && !web_pump_asset(c, &queued)) {
+                break;
+            }
+            tcp_output(pcb);
+            web_finish(c);
+            return;
+        }
+
+        if (room < WEB_CHUNK_MIN + WEB_CHUNK_OVERHEAD) {
+            break;
+        }
+        size_t max = room - WEB_CHUNK_OVERHEAD;
+        if (max > WEB_CHUNK_SIZE) {
+            max = WEB_CHUNK_SIZE;
+        }
+
+        web_cursor_t saved = c->cur;
+        char *data = web_scratch + WEB_CHUNK_HEAD;
+        size_t n = web_fill(c, data, max);
+        bool done = c->cur.body_done;
+        char *out = data;
+        size_t out_len = n;
+
+        if (c->chunked) {
+            if (n > 0) {
+                char hex[WEB_CHUNK_HEAD + 1];
+                snprintf(hex, sizeof(hex), "%04x\r\n", (unsigned)n);
+                memcpy(web_scratch, hex, WEB_CHUNK_HEAD);
+                out = web_scratch;
+                out_len = WEB_CHUNK_HEAD + n;
+                memcpy(out + out_len, "\r\n", 2);
+                out_len += 2;
+            }
+            if (done) {
+                memcpy(out + out_len, "0\r\n\r\n", 5);
+                out_len += 5;
+            }
+        }
+
+        if (out_len == 0 && !done) {
+            break;
+        }
+        if (out_len > 0) {
+            err_t err = tcp_write(pcb, out, out_len,
+                                  TCP_WRITE_FLAG_COPY | (done ? 0 : TCP_WRITE_FLAG_MORE));
+            if (err != ERR_OK) {
+                c->cur = saved;
+                break;
+            }
+            queued = true;
+        }
+
+        if (done) {
+            tcp_output(pcb);
+            web_finish(c);
+            return;
+        }
+    }
+
+    if (queued) {
+        tcp_output(pcb);
+    }
+}
+
+/*============================================================================
+ * TELEMETRY EVENTS
+ *============================================================================*/
+
+/*
+ * /api/events is a server-sent event stream: one small JSON update per
+ * PPS, rendered once in web_task() and copied to every subscriber, so a
+ * dashboard holds one connection instead of polling /api/status.
+ */
+
+#define WEB_EVENT_SIZE          384
+#define WEB_EVENT_MAX_SUBS      (WEB_MAX_CONNECTIONS - 1)  /* Keep a slot for requests */
+#define WEB_EVENT_PERIOD_MS     1000    /* Update rate while PPS is absent */
+
+static char web_event[WEB_EVENT_SIZE];
+static uint32_t event_publish = 0;
+static uint32_t event_pps = 0;
+static uint32_t event_time_ms = 0;      /* 0 = no baseline for rates */
+static uint32_t event_ntp_requests = 0;
+static uint32_t event_ptp_syncs = 0;
+
+static int web_subscriber_count(void) {
+    int n = 0;
+    for (int i = 0; i < WEB_MAX_CONNECTIONS; i++) {
+        if (web_conns[i].state == WEB_CONN_EVENTS) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Queue any unsent stream header, then data. Events are only queued
+ * whole: a subscriber without room misses that update.
+ */
+static bool web_events_send(web_conn_t *c, const char *data, size_t len) {
+    struct tcp_pcb *pcb = c->pcb;
+    bool ok = true;
+
+    if (c->head_len > 0) {
+        if (web_send_room(pcb, WEB_INFLIGHT_MAX) < c->head_len ||
+            tcp_write(pcb, c->head, c->head_len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+            return false;
+        }
+        c->head_len = 0;
+    }
+    if (len > 0 &&
+        (web_send_room(pcb, WEB_INFLIGHT_MAX) < len ||
+         tcp_write(pcb, data, len, TCP_WRITE_FLAG_COPY) != ERR_OK)) {
+        ok = false;
+    }
+    tcp_output(pcb);
+    return ok;
+}
+
+/* Turn the connection into an event stream; it stays open until the
+ * client goes away */
+static void web_subscribe_events(web_conn_t *c) {
+    int subs = web_subscriber_count();
+    if (subs >= WEB_EVENT_MAX_SUBS) {
+        web_respond_text(c, HTTP_STATUS_UNAVAILABLE, HTTP_TYPE_TEXT, "Too many subscribers\n");
+        return;
+    }
+    if (subs == 0) {
+        event_time_ms = 0;
+    }
+
+    int n = snprintf(c->head, sizeof(c->head),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "retry: 2000\n\n");
+    c->head_len = (n > 0 && n < (int)sizeof(c->head)) ? (uint16_t)n : 0;
+    c->idle_polls = 0;
+    c->state = WEB_CONN_EVENTS;
+
+    printf("[WEB] Event subscriber %d connected\n", subs + 1);
+    web_events_send(c, NULL, 0);
+}
+
+/* Render one update into web_event */
+static size_t web_build_event(const timing_snapshot_t *snap, uint32_t now_ms) {
+    const time_state_t *state = &snap->state;
+    uint32_t ntp = g_stats.ntp_requests;
+    uint32_t ptp = g_stats.ptp_sync_sent;
+    float ntp_rate = 0.0f, ptp_rate = 0.0f;
+
+    if (event_time_ms != 0 && now_ms != event_time_ms) {
+        float dt = (now_ms - event_time_ms) / 1000.0f;
+        ntp_rate = (ntp - event_ntp_requests) / dt;
+        ptp_rate = (ptp - event_ptp_syncs) / dt;
+    }
+    event_time_ms = now_ms ? now_ms : 1;
+    event_ntp_requests = ntp;
+    event_ptp_syncs = ptp;
+
+    int n = snprintf(web_event, sizeof(web_event),
+        "id: %lu\n"
+        "data: {\"pps_count\":%lu,\"sync_state\":%d,\"rb_locked\":%s,"
+        "\"time_valid\":%s,\"offset_ns\":%lld,\"freq_offset_ppb\":%.3f,"
+        "\"ntp_rate\":%.1f,\"ptp_rate\":%.1f,"
+        "\"gnss\":{\"pps_valid\":%s,\"offset_valid\":%s,\"offset_ns\":%ld}}\n\n",
+        (unsigned long)state->pps_count, (unsigned long)state->pps_count,
+        (int)state->sync_state,
+        state->rb_locked ? "true" : "false",
+        state->time_valid ? "true" : "false",
+        (long long)state->offset_ns, state->frequency_offset,
+        (double)ntp_rate, (double)ptp_rate,
+        gnss_pps_valid() ? "true" : "false",
+        freq_counter_pps_offset_valid() ? "true" : "false",
+        (long)freq_counter_get_pps_offset());
+    return (n > 0 && n < (int)sizeof(web_event)) ? (size_t)n : 0;
+}
+
+/**
+ * Push an update to all subscribers on each new PPS, or once a second
+ * while there is none. Runs from the main loop, so lwIP is locked out
+ * while the connections are touched.
+ */
+static void web_events_task(void) {
+    /* Unlocked peek to keep the idle case cheap; re-checked below */
+    if (web_subscriber_count() == 0) {
+        return;
+    }
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    bool periodic = (event_time_ms == 0 || now - event_time_ms >= WEB_EVENT_PERIOD_MS);
+
+    if (!periodic && timing_core_publish_count() == event_publish) {
+        return;
+    }
+
+    cyw43_arch_lwip_begin();
+    if (web_subscriber_count() > 0) {
+        timing_snapshot_t snap;
+        timing_core_get_snapshot(&snap);
+        event_publish = snap.publish_count;
+
+        if (periodic || snap.state.pps_count != event_pps) {
+            event_pps = snap.state.pps_count;
+            size_t len = web_build_event(&snap, now);
+            for (int i = 0; i < WEB_MAX_CONNECTIONS; i++) {
+                if (web_conns[i].state == WEB_CONN_EVENTS && len > 0) {
+                    web_events_send(&web_conns[i], web_event, len);
+                }
+            }
+        }
+    }
+    cyw43_arch_lwip_end();
+}
+
 /*============================================================================
  * HTTP HANDLERS
  *============================================================================*/
@@ -548,295 +851,643 @@ static bool web_running = false;
  * Format current time as ISO 8601 string
  */
 static void format_current_time(char *buf, size_t len) {
-    timestamp_t ts = get_current_time();
+    calendar_t c;
+    calendar_at(get_current_time().seconds, &c);
 
-    /* Protect against underflow if time not yet initialized */
-    if (ts.seconds < NTP_UNIX_OFFSET) {
-        snprintf(buf, len, "1970-01-01T00:00:00Z");
-        return;
+    snprintf(buf, len, "%04d-%02d-%02dT%02d:%02d:%02dZ",
+             c.year, c.month, c.day, c.hour, c.minute, c.second);
+}
+
+/**
+ * Append to a generator fragment only if the whole row fits
+ */
+static bool web_put(char *buf, size_t len, size_t *pos, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + *pos, len - *pos, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= len - *pos) {
+        return false;
     }
+    *pos += n;
+    return true;
+}
 
-    uint32_t unix_time = ts.seconds - NTP_UNIX_OFFSET;
+/**
+ * JSON-escape src into dst. Stops when the next character does not fit;
+ * *consumed reports how much of src was used.
+ */
+static size_t json_escape(const char *src, size_t n, char *dst, size_t room, size_t *consumed) {
+    size_t out = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        char ch = src[i];
+        char esc = 0;
+        if (ch == '"') esc = '"';
+        else if (ch == '\\') esc = '\\';
+        else if (ch == '\n') esc = 'n';
+        else if (ch == '\r') esc = 'r';
+        else if (ch == '\t') esc = 't';
+        else if ((unsigned char)ch < 32) continue;
+
+        if (esc) {
+            if (out + 2 > room) break;
+            dst[out++] = '\\';
+            dst[out++] = esc;
+        } else {
+            if (out + 1 > room) break;
+            dst[out++] = ch;
+        }
+    }
 
-    /* Calculate broken-down time */
-    uint32_t days = unix_time / 86400;
-    uint32_t remaining = unix_time % 86400;
-    int hour = remaining / 3600;
-    int min = (remaining % 3600) / 60;
-    int sec = remaining % 60;
+    *consumed = i;
+    return out;
+}
 
-    /* Calculate year */
-    int year = 1970;
-    while (days > 365) {
-        int days_in_year = ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0) ? 366 : 365;
-        if (days < (uint32_t)days_in_year) break;
-        days -= days_in_year;
-        year++;
+/**
+ * Pulse outputs JSON array. Cursor: 0 = "[", 1..MAX_PULSE_OUTPUTS =
+ * output cursor-1, then "]"; aux counts the entries emitted so far for
+ * the separators.
+ */
+static size_t gen_pulse_outputs_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    const char *mode_names[] = { "disabled", "interval", "second", "minute", "time" };
+    size_t pos = 0;
+
+    while (c->cur.off <= MAX_PULSE_OUTPUTS + 1) {
+        uint32_t k = c->cur.off;
+
+        if (k == 0) {
+            if (!web_put(buf, len, &pos, "[")) return pos;
+        } else if (k <= MAX_PULSE_OUTPUTS) {
+            pulse_config_t *p = pulse_output_get(k - 1);
+            if (p && p->active) {
+                if (!web_put(buf, len, &pos,
+                        "%s{\"pin\":%d,\"mode\":\"%s\",\"interval\":%u.%u,"
+                        "\"second\":%d,\"minute\":%d,\"hour\":%d,"
+                        "\"width_ms\":%d,\"count\":%d,\"gap_ms\":%d,\"pio\":%s}",
+                        c->cur.aux ? "," : "",
+                        p->gpio_pin, mode_names[p->mode],
+                        p->interval_ds / 10, p->interval_ds % 10,
+                        p->trigger_second, p->trigger_minute, p->trigger_hour,
+                        p->pulse_width_ms, p->pulse_count, p->pulse_gap_ms,
+                        p->pio_index >= 0 ? "true" : "false")) {
+                    return pos;
+                }
+                c->cur.aux++;
+            }
+        } else {
+            if (!web_put(buf, len, &pos, "]")) return pos;
+        }
+        c->cur.off++;
     }
 
-    /* Days in each month */
-    int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0) {
-        days_in_month[1] = 29;
+    *done = true;
+    return pos;
+}
+
+/**
+ * NTP client table JSON (busiest clients first). Cursor: 0 = counters,
+ * 1..n = client cursor-1; the table is re-read on each call.
+ */
+#define WEB_NTP_CLIENTS_MAX     8
+
+static size_t gen_ntp_clients_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    ntp_client_info_t clients[WEB_NTP_CLIENTS_MAX];
+    int n = ntp_get_clients(clients, WEB_NTP_CLIENTS_MAX);
+    size_t pos = 0;
+
+    if (c->cur.off == 0) {
+        uint32_t kod_sent, dropped;
+        ntp_get_limit_stats(&kod_sent, &dropped);
+        if (!web_put(buf, len, &pos,
+                "{\"kod_sent\":%lu,\"dropped\":%lu,\"interleaved\":%lu,\"clients\":[",
+                (unsigned long)kod_sent, (unsigned long)dropped,
+                (unsigned long)ntp_get_interleaved_count())) {
+            return pos;
+        }
+        c->cur.off++;
     }
 
-    int month = 0;
-    while (month < 12 && days >= (uint32_t)days_in_month[month]) {
-        days -= days_in_month[month];
-        month++;
+    while ((int)c->cur.off <= n) {
+        const ntp_client_info_t *cl = &clients[c->cur.off - 1];
+        uint8_t *ip = (uint8_t *)&cl->addr;
+
+        if (!web_put(buf, len, &pos,
+                "%s{\"ip\":\"%u.%u.%u.%u\",\"requests\":%lu,\"limited\":%lu,"
+                "\"kod\":%lu,\"avg_interval_ms\":%lu,\"idle_s\":%lu}",
+                c->cur.off > 1 ? "," : "", ip[0], ip[1], ip[2], ip[3],
+                (unsigned long)cl->requests, (unsigned long)cl->limited,
+                (unsigned long)cl->kod_sent, (unsigned long)cl->avg_interval_ms,
+                (unsigned long)(cl->idle_ms / 1000))) {
+            return pos;
+        }
+        c->cur.off++;
     }
 
-    snprintf(buf, len, "%04d-%02d-%02dT%02d:%02d:%02dZ",
-             year, month + 1, (int)days + 1, hour, min, sec);
+    if (web_put(buf, len, &pos, "]}")) {
+        *done = true;
+    }
+    return pos;
 }
 
 /**
- * Generate pulse outputs HTML section
+ * ADEV/MDEV/TDEV points, cursor = octave
  */
-static int generate_pulse_outputs_html(char *buf, size_t len) {
-    const char *mode_names[] = { "Off", "Interval", "Second", "Minute", "Time" };
-    int pos = 0;
-    int count = 0;
+static size_t gen_stability_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    stability_point_t pts[STAB_LEVELS];
+    int count = stability_get(pts, STAB_LEVELS);
+    size_t pos = 0;
+
+    while ((int)c->cur.off < count && pts[c->cur.off].adev_n > 0) {
+        const stability_point_t *pt = &pts[c->cur.off];
+        if (!web_put(buf, len, &pos,
+                "%s{\"tau\":%lu,\"adev\":%.4e,\"mdev\":%.4e,\"tdev\":%.4e,"
+                "\"adev_n\":%lu,\"mdev_n\":%lu}",
+                c->cur.off > 0 ? "," : "", (unsigned long)pt->tau_s,
+                pt->adev, pt->mdev, pt->tdev,
+                (unsigned long)pt->adev_n, (unsigned long)pt->mdev_n)) {
+            return pos;
+        }
+        c->cur.off++;
+    }
 
-    /* Count active outputs */
-    for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
-        pulse_config_t *p = pulse_output_get(i);
-        if (p && p->active) count++;
+    *done = true;
+    return pos;
+}
+
+/**
+ * AC frequency history values, cursor = sample index, limit = count
+ * taken when the response started
+ */
+static size_t gen_ac_history(web_conn_t *c, char *buf, size_t len, bool *done, bool hours) {
+    static float hist[AC_FREQ_MINUTE_HISTORY > AC_FREQ_HOUR_HISTORY ?
+                      AC_FREQ_MINUTE_HISTORY : AC_FREQ_HOUR_HISTORY];
+    int count = hours ? ac_freq_get_hour_history(hist, AC_FREQ_HOUR_HISTORY)
+                      : ac_freq_get_minute_history(hist, AC_FREQ_MINUTE_HISTORY);
+    if ((uint32_t)count > c->cur.aux) {
+        count = c->cur.aux;
     }
+    size_t pos = 0;
 
-    if (count == 0) {
-        return snprintf(buf, len,
-            "<div class='card'><h2>Pulse Outputs</h2>"
-            "<div class='stat'><span class='stat-label'>Status</span>"
-            "<span class='stat-value'>No outputs configured</span></div></div>");
+    while ((int)c->cur.off < count) {
+        if (!web_put(buf, len, &pos, "%s%.3f", c->cur.off > 0 ? "," : "",
+                     (double)hist[c->cur.off])) {
+            return pos;
+        }
+        c->cur.off++;
     }
 
-    pos += snprintf(buf + pos, len - pos,
-        "<div class='card'><h2>Pulse Outputs</h2>");
+    *done = true;
+    return pos;
+}
+
+static size_t gen_ac_minutes(web_conn_t *c, char *buf, size_t len, bool *done) {
+    return gen_ac_history(c, buf, len, done, false);
+}
 
-    for (int i = 0; i < MAX_PULSE_OUTPUTS && pos < (int)len - 200; i++) {
-        pulse_config_t *p = pulse_output_get(i);
-        if (!p || !p->active) continue;
+static size_t gen_ac_hours(web_conn_t *c, char *buf, size_t len, bool *done) {
+    return gen_ac_history(c, buf, len, done, true);
+}
 
-        char config[64];
-        switch (p->mode) {
-            case PULSE_MODE_INTERVAL:
-                snprintf(config, sizeof(config), "every %u.%us, %ums",
-                    p->interval_ds / 10, p->interval_ds % 10, p->pulse_width_ms);
-                break;
-            case PULSE_MODE_SECOND:
-                snprintf(config, sizeof(config), "sec %d, %ums x%d",
-                    p->trigger_second, p->pulse_width_ms, p->pulse_count);
-                break;
-            case PULSE_MODE_MINUTE:
-                snprintf(config, sizeof(config), "min %d, %ums x%d",
-                    p->trigger_minute, p->pulse_width_ms, p->pulse_count);
-                break;
-            case PULSE_MODE_TIME:
-                snprintf(config, sizeof(config), "%02d:%02d, %ums x%d",
-                    p->trigger_hour, p->trigger_minute,
-                    p->pulse_width_ms, p->pulse_count);
-                break;
-            default:
-                snprintf(config, sizeof(config), "disabled");
+/**
+ * Jitter statistics, cursor = series * JITTER_SET_COUNT + set
+ */
+static size_t gen_jitter_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    static jitter_snapshot_t js;
+    uint64_t now_us = time_us_64();
+    size_t pos = 0;
+
+    while (c->cur.off < JITTER_SERIES_COUNT * JITTER_SET_COUNT) {
+        int series = c->cur.off / JITTER_SET_COUNT;
+        int set = c->cur.off % JITTER_SET_COUNT;
+        jitter_stats_read((jitter_series_t)series, (jitter_set_t)set, &js);
+        if (!web_put(buf, len, &pos,
+                "%s{\"series\":\"%s\",\"set\":\"%s\",\"age_s\":%lu,\"count\":%lu,"
+                "\"mean\":%.2f,\"stddev\":%.2f,\"min\":%ld,\"max\":%ld,\"last\":%ld,"
+                "\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f}",
+                c->cur.off > 0 ? "," : "", jitter_series_name(series),
+                (set == JITTER_WINDOW) ? "window" : "total",
+                (uint32_t)((now_us - js.start_us) / 1000000), js.count,
+                js.mean, jitter_stats_stddev(&js), js.min, js.max, js.last,
+                jitter_stats_quantile(&js, 0.5), jitter_stats_quantile(&js, 0.99),
+                jitter_stats_quantile(&js, 0.999))) {
+            return pos;
         }
+        c->cur.off++;
+    }
 
-        pos += snprintf(buf + pos, len - pos,
-            "<div class='stat'><span class='stat-label'>GP%d (%s)</span>"
-            "<span class='stat-value'>%s</span></div>",
-            p->gpio_pin, mode_names[p->mode], config);
+    *done = true;
+    return pos;
+}
+
+/**
+ * History series and what each tier holds, cursor = series
+ */
+static size_t gen_history_index(web_conn_t *c, char *buf, size_t len, bool *done) {
+    size_t pos = 0;
+
+    while (c->cur.off < TSDB_SERIES_COUNT) {
+        tsdb_series_stats_t st;
+        tsdb_get_series_stats((tsdb_series_t)c->cur.off, &st);
+        if (!web_put(buf, len, &pos,
+                "%s{\"name\":\"%s\",\"unit\":\"%s\",\"samples\":%lu,"
+                "\"records\":[%lu,%lu,%lu,%lu],\"bytes\":[%lu,%lu,%lu,%lu],"
+                "\"first\":[%lu,%lu,%lu,%lu]}",
+                c->cur.off > 0 ? "," : "",
+                tsdb_series_name(c->cur.off), tsdb_series_unit(c->cur.off), st.samples,
+                st.records[0], st.records[1], st.records[2], st.records[3],
+                st.bytes[0], st.bytes[1], st.bytes[2], st.bytes[3],
+                st.first_t[0], st.first_t[1], st.first_t[2], st.first_t[3])) {
+            return pos;
+        }
+        c->cur.off++;
     }
 
-    pos += snprintf(buf + pos, len - pos, "</div>");
+    *done = true;
     return pos;
 }
 
+/* Query of each /api/history response, by connection */
+static tsdb_query_t history_queries[WEB_MAX_CONNECTIONS];
+
+/**
+ * History rows or blocks, cursor = block, limit = position in it
+ */
+static size_t gen_history(web_conn_t *c, char *buf, size_t len, bool *done) {
+    return tsdb_read(&history_queries[c - web_conns], &c->cur.off, &c->cur.aux,
+                     buf, len, done);
+}
+
 /**
- * Generate status page HTML
+ * Escaped log text from absolute position cursor up to the limit
  */
-static int generate_status_page(char *buf, size_t len) {
-    const char *sync_states[] = {
-        "INIT", "FREQ_CAL", "COARSE", "FINE", "LOCKED", "HOLDOVER", "ERROR"
-    };
+static size_t gen_log_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    char tmp[256];
+    size_t pos = 0;
+
+    while (c->cur.off < c->cur.aux) {
+        size_t want = c->cur.aux - c->cur.off;
+        if (want > sizeof(tmp)) want = sizeof(tmp);
+        if (want > (len - pos) / 2) want = (len - pos) / 2;
+        if (want == 0) {
+            return pos;
+        }
 
-    const char *sync_class = "status-syncing";
-    const char *led_class = "led-yellow";
+        uint32_t from = c->cur.off;
+        size_t got = log_buffer_copy(tmp, want, &from);
+        if (got == 0) {
+            break;
+        }
 
-    if (g_time_state.sync_state == SYNC_STATE_LOCKED) {
-        sync_class = "status-locked";
-        led_class = "led-green";
-    } else if (g_time_state.sync_state == SYNC_STATE_ERROR) {
-        sync_class = "status-error";
-        led_class = "led-red";
+        size_t used;
+        pos += json_escape(tmp, got, buf + pos, len - pos, &used);
+        c->cur.off = from;
     }
 
-    char ip_str[20];
-    get_ip_address_str(ip_str, sizeof(ip_str));
+    *done = true;
+    return pos;
+}
 
-    uint8_t stratum = NTP_STRATUM;
-    if (g_time_state.sync_state != SYNC_STATE_LOCKED) {
-        stratum = (g_time_state.sync_state >= SYNC_STATE_FINE) ? NTP_STRATUM + 1 : 16;
-    }
+/**
+ * Escaped CLI output as the command writes it, cursor = stream position.
+ * Not done until the command (or its job) has finished.
+ */
+static size_t gen_cli_json(web_conn_t *c, char *buf, size_t len, bool *done) {
+    char tmp[256];
+    size_t pos = 0;
+
+    /* A rolled back fill restarts from here, never before */
+    cli_stream_release(c->cur.off);
+
+    for (;;) {
+        size_t want = (len - pos) / 2;
+        if (want > sizeof(tmp)) want = sizeof(tmp);
+        if (want == 0) {
+            return pos;
+        }
 
-    const ac_freq_state_t *ac = ac_freq_get_state();
+        size_t got = cli_stream_copy(c->cur.off, tmp, want);
+        if (got == 0) {
+            break;
+        }
 
-    /* Generate pulse outputs section */
-    static char pulse_html[512];
-    generate_pulse_outputs_html(pulse_html, sizeof(pulse_html));
+        size_t used;
+        pos += json_escape(tmp, got, buf + pos, len - pos, &used);
+        c->cur.off += used;
+    }
 
-    /* Get current time as ISO 8601 */
-    char time_str[32];
-    format_current_time(time_str, sizeof(time_str));
-    const char *time_class = g_time_state.time_valid ? "time-valid" : "time-invalid";
+    *done = cli_stream_done(c->cur.off);
+    return pos;
+}
 
-    /* Logo: green if everything OK, red otherwise */
-    bool all_ok = g_time_state.rb_locked && g_time_state.time_valid &&
-                  (g_time_state.sync_state == SYNC_STATE_LOCKED);
-    const char *logo_class = all_ok ? "logo-ok" : "logo-error";
+/* One counter or gauge with its HELP and TYPE lines */
+static bool put_metric(char *buf, size_t len, size_t *pos, const char *type,
+                       const char *name, const char *help, double v) {
+    return web_put(buf, len, pos,
+        "# HELP chronos_%s %s\n# TYPE chronos_%s %s\nchronos_%s %.10g\n",
+        name, help, name, type, name, v);
+}
 
-    /* GNSS status */
-    const char *gnss_fix_str = "None";
-    gnss_fix_type_t fix = gnss_get_fix_type();
-    if (fix == GNSS_FIX_2D) gnss_fix_str = "2D";
-    else if (fix == GNSS_FIX_3D) gnss_fix_str = "3D";
+#define COUNTER(name, help, v)  return put_metric(buf, len, pos, "counter", name, help, (double)(v))
+#define GAUGE(name, help, v)    return put_metric(buf, len, pos, "gauge", name, help, (double)(v))
 
-    char gnss_time_str[24] = "N/A";
-    if (gnss_has_time()) {
-        gnss_time_t gnss_t;
-        gnss_get_utc_time(&gnss_t);
-        snprintf(gnss_time_str, sizeof(gnss_time_str), "%02d:%02d:%02d",
-                 gnss_t.hour, gnss_t.minute, gnss_t.second);
+/**
+ * One metric with a line per reference source; same return as
+ * put_metric_row(). field: 0 up, 1 score, 2 jitter, 3 faults.
+ */
+static int put_ref_family(char *buf, size_t len, size_t *pos, const ref_status_t *r,
+                          const char *name, const char *type, const char *help, int field) {
+    size_t start = *pos;
+
+    if (!web_put(buf, len, pos, "# HELP chronos_%s %s\n# TYPE chronos_%s %s\n",
+                 name, help, name, type)) {
+        *pos = start;
+        return 0;
+    }
+    for (int i = 0; i < REF_COUNT; i++) {
+        const ref_health_t *h = &r->src[i];
+        double v = (field == 0) ? h->available :
+                   (field == 1) ? h->score :
+                   (field == 2) ? h->jitter_ns * 1e-9 : h->faults;
+        if (!web_put(buf, len, pos, "chronos_%s{source=\"%s\"} %.9g\n",
+                     name, ref_source_name(i), v)) {
+            *pos = start;
+            return 0;
+        }
     }
+    return 1;
+}
 
-    /* GNSS position with Google Maps link */
-    char gnss_pos_str[32] = "N/A";
-    char gnss_pos_url[64] = "#";
-    if (gnss_has_fix()) {
-        double lat, lon, alt;
-        gnss_get_position(&lat, &lon, &alt);
-        snprintf(gnss_pos_str, sizeof(gnss_pos_str), "Google Maps");
-        snprintf(gnss_pos_url, sizeof(gnss_pos_url), "https://maps.google.com/?q=%.6f,%.6f", lat, lon);
-    }
-
-    /* Format uptime as days:hours:minutes:seconds */
-    char uptime_str[24];
-    uint32_t uptime_sec = (uint32_t)(time_us_64() / 1000000);
-    uint32_t days = uptime_sec / 86400;
-    uint32_t hours = (uptime_sec % 86400) / 3600;
-    uint32_t mins = (uptime_sec % 3600) / 60;
-    uint32_t secs = uptime_sec % 60;
-    if (days > 0) {
-        snprintf(uptime_str, sizeof(uptime_str), "%lud %02lu:%02lu:%02lu",
-                 (unsigned long)days, (unsigned long)hours, (unsigned long)mins, (unsigned long)secs);
-    } else {
-        snprintf(uptime_str, sizeof(uptime_str), "%02lu:%02lu:%02lu",
-                 (unsigned long)hours, (unsigned long)mins, (unsigned long)secs);
-    }
-
-    /* PPS offset, drift and jitter (FE PPS vs GNSS PPS) */
-    char pps_offset_str[32] = "N/A";
-    char pps_drift_str[32] = "N/A";
-    char pps_jitter_str[32] = "N/A";
-    if (freq_counter_pps_offset_valid()) {
-        int32_t offset = freq_counter_get_pps_offset();
-        double drift = freq_counter_get_pps_drift();
-        double stddev = freq_counter_get_pps_stddev();
-        /* Offset in ticks (100ns units) */
-        snprintf(pps_offset_str, sizeof(pps_offset_str), "%+ld ticks", (long)offset);
-        /* Drift in ticks/sec, convert to ns/s for display */
-        snprintf(pps_drift_str, sizeof(pps_drift_str), "%+.1f ns/s", drift * 100.0);
-        /* Jitter (stddev) in ticks, convert to ns */
-        snprintf(pps_jitter_str, sizeof(pps_jitter_str), "%.1f ns", stddev * 100.0);
-    }
-
-    return snprintf(buf, len, HTML_PAGE,
-        logo_class, time_class, time_str,
-        sync_class, led_class, sync_states[g_time_state.sync_state],
-        g_time_state.rb_locked ? "LOCKED" : "UNLOCKED",
-        g_time_state.time_valid ? "YES" : "NO",
-        uptime_str,
-        (long long)g_time_state.offset_ns,
-        (double)g_time_state.frequency_offset,
-        (unsigned long)g_time_state.pps_count,
-        (unsigned long)g_time_state.last_freq_count,
-        ip_str,
-        NTP_PORT, (int)stratum,
-        (unsigned long)g_stats.ntp_requests,
-        (unsigned long)g_stats.ptp_sync_sent,
-        ac->signal_present ? "Detected" : "Not detected",
-        (double)ac->frequency_hz,
-        (double)ac->frequency_avg_hz,
-        (double)ac->frequency_min_hz,
-        (double)ac->frequency_max_hz,
-        radio_timecode_is_enabled(RADIO_DCF77) ? "ON" : "OFF",
-        radio_timecode_is_enabled(RADIO_WWVB) ? "ON" : "OFF",
-        radio_timecode_is_enabled(RADIO_JJY40) ? "ON" : "OFF",
-        radio_timecode_is_enabled(RADIO_JJY60) ? "ON" : "OFF",
-        nmea_output_is_enabled() ? "ON" : "OFF",
-        gnss_is_enabled() ? "Enabled" : "Disabled",
-        gnss_fix_str,
-        (int)gnss_get_satellites(),
-        gnss_pos_url,
-        gnss_pos_str,
-        gnss_time_str,
-        gnss_pps_valid() ? "Active" : "No signal",
-        pps_offset_str,
-        pps_drift_str,
-        pps_jitter_str,
-        (unsigned long)freq_counter_get_fe_pps_count(),
-        (unsigned long)freq_counter_get_gnss_pps_count(),
-        gnss_get_firmware_version(),
-        gnss_get_hardware_version(),
-        pulse_html,
-        CHRONOS_VERSION_STRING,
-        CHRONOS_BUILD_DATE
-    );
+/**
+ * Summary of a jitter series since boot: p50/p99/p99.9, sum and count;
+ * same return as put_metric_row()
+ */
+static int put_jitter_summary(char *buf, size_t len, size_t *pos, jitter_series_t series,
+                              const char *name, const char *help) {
+    static jitter_snapshot_t js;
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+    size_t start = *pos;
+
+    jitter_stats_read(series, JITTER_TOTAL, &js);
+    if (!web_put(buf, len, pos, "# HELP chronos_%s %s\n# TYPE chronos_%s summary\n",
+                 name, help, name)) {
+        *pos = start;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        if (!web_put(buf, len, pos, "chronos_%s{quantile=\"%g\"} %.9g\n", name, quantiles[i],
+                     jitter_stats_quantile(&js, quantiles[i]) * 1e-9)) {
+            *pos = start;
+            return 0;
+        }
+    }
+    if (!web_put(buf, len, pos, "chronos_%s_sum %.9g\nchronos_%s_count %lu\n",
+                 name, js.mean * js.count * 1e-9, name, js.count)) {
+        *pos = start;
+        return 0;
+    }
+    return 1;
 }
 
 /**
- * Generate pulse outputs JSON array
+ * Counter/gauge row. Returns 1 when written, 0 when it does not fit,
+ * -1 past the last row.
  */
-static int generate_pulse_outputs_json(char *buf, size_t len) {
-    const char *mode_names[] = { "disabled", "interval", "second", "minute", "time" };
-    int pos = 0;
+static int put_metric_row(char *buf, size_t len, size_t *pos, uint32_t row,
+                          const timing_snapshot_t *snap) {
+    const time_state_t *state = &snap->state;
+    uint32_t a = 0, b = 0;
+    net_ts_stats_t ts;
+    timing_core_stats_t tc;
+    roughtime_stats_t rt;
+    nts_auth_stats_t ns;
+    nts_ke_stats_t ke;
+    wifi_latency_info_t wl;
+#if CHRONOS_ETH_W5500
+    eth_status_t es;
+#endif
+
+    switch (row) {
+        case 0:
+            return web_put(buf, len, pos,
+                "# HELP chronos_build_info Firmware build\n"
+                "# TYPE chronos_build_info gauge\n"
+                "chronos_build_info{version=\"%s\",build=\"%s\"} 1\n",
+                CHRONOS_VERSION_STRING, CHRONOS_BUILD_DATE);
+        case 1:  GAUGE("uptime_seconds", "Time since boot", to_ms_since_boot(get_absolute_time()) / 1000);
+        case 2:  GAUGE("sync_state", "Sync state (0 INIT .. 4 LOCKED, 5 HOLDOVER, 6 ERROR)", state->sync_state);
+        case 3:  GAUGE("rb_locked", "Rubidium lock indicator", state->rb_locked);
+        case 4:  GAUGE("time_valid", "Time of day is valid", state->time_valid);
+        case 5:  GAUGE("offset_seconds", "Last phase offset to the reference PPS", state->offset_ns * 1e-9);
+        case 6:  GAUGE("frequency_offset_ppb", "Frequency correction", state->frequency_offset);
+        case 7:  COUNTER("pps_total", "Rubidium PPS edges", state->pps_count);
+        case 8:  COUNTER("freq_measurements_total", "10 MHz gate measurements", snap->freq_measurements);
+        case 9:  COUNTER("errors_total", "Errors counted by any module", g_stats.errors);
+        case 10: ntp_get_statistics(&a, &b);
+                 COUNTER("ntp_requests_total", "NTP requests answered", a);
+        case 11: ntp_get_statistics(&a, &b);
+                 COUNTER("ntp_errors_total", "NTP requests failed", b);
+        case 12: COUNTER("ntp_interleaved_total", "Interleaved-mode NTP replies", ntp_get_interleaved_count());
+        case 13: ntp_get_limit_stats(&a, &b);
+                 COUNTER("ntp_kod_sent_total", "RATE Kiss-o'-Death replies", a);
+        case 14: ntp_get_limit_stats(&a, &b);
+                 COUNTER("ntp_dropped_total", "NTP requests dropped by the rate limit", b);
+        case 15: ptp_get_statistics(&a, &b);
+                 COUNTER("ptp_sync_sent_total", "PTP Sync messages sent", a);
+        case 16: ptp_get_statistics(&a, &b);
+                 COUNTER("ptp_delay_resp_total", "PTP Delay_Resp messages sent", b);
+        case 17: COUNTER("ptp_grants_denied_total", "PTP unicast grant requests denied", ptp_get_grants_denied());
+        case 18: nts_get_stats(&a, &b);
+                 COUNTER("nts_ke_connections_total", "NTS-KE connections", a);
+        case 19: nts_get_stats(&a, &b);
+                 COUNTER("nts_requests_total", "NTS-protected NTP requests", b);
+        case 20: COUNTER("roughtime_requests_total", "Roughtime requests", roughtime_get_requests());
+        case 21: time_protocols_get_stats(&a, &b);
+                 COUNTER("time_requests_total", "RFC 868 Time requests", a);
+        case 22: time_protocols_get_stats(&a, &b);
+                 COUNTER("daytime_requests_total", "RFC 867 Daytime requests", b);
+        case 23: net_ts_get_stats(&ts);
+                 COUNTER("net_rx_frames_total", "Frames delivered to lwIP", ts.rx_frames);
+        case 24: net_ts_get_stats(&ts);
+                 COUNTER("net_rx_wake_stamped_total", "Frames stamped from the host-wake IRQ", ts.rx_wake_stamped);
+        case 25: net_ts_get_stats(&ts);
+                 COUNTER("net_tx_frames_total", "Frames handed to the WiFi driver", ts.tx_frames);
+        case 26: net_ts_get_stats(&ts);
+                 GAUGE("net_wake_latency_seconds", "Last host-wake to lwIP delivery latency", ts.wake_latency_us * 1e-6);
+        case 27: timing_core_get_stats(&tc);
+                 COUNTER("timing_loops_total", "Timing loop iterations", tc.loops);
+        case 28: timing_core_get_stats(&tc);
+                 GAUGE("timing_max_loop_seconds", "Longest timing loop iteration", tc.max_loop_us * 1e-6);
+        case 29: timing_core_get_stats(&tc);
+                 COUNTER("timing_calls_total", "Calls run on the timing core", tc.calls);
+        case 30: pps_capture_get_edge_stats(&a, &b);
+                 COUNTER("pps_coarse_total", "PPS edges without a PIO stamp", a);
+        case 31: pps_capture_get_edge_stats(&a, &b);
+                 COUNTER("pps_ring_overruns_total", "PPS stamp ring overruns", b);
+        case 32: GAUGE("gnss_pps_offset_valid", "GNSS to rubidium PPS offset is valid", freq_counter_pps_offset_valid());
+        case 33: GAUGE("gnss_pps_offset_seconds", "GNSS PPS minus rubidium PPS", freq_counter_get_pps_offset() * 1e-9);
+        case 34: GAUGE("gnss_pps_drift", "GNSS to rubidium PPS drift (s/s)", freq_counter_get_pps_drift() * 1e-9);
+        case 35: GAUGE("gnss_pps_jitter_seconds", "GNSS to rubidium PPS offset deviation", freq_counter_get_pps_stddev() * 1e-9);
+        case 36: GAUGE("gnss_fix_type", "GNSS fix (0 none, 2 2D, 3 3D)", gnss_get_fix_type());
+        case 37: GAUGE("gnss_satellites", "GNSS satellites in use", gnss_get_satellites());
+        case 38: COUNTER("gnss_pps_total", "GNSS PPS pulses", gnss_get_state()->pps_count);
+        case 39: COUNTER("gnss_nmea_total", "NMEA sentences parsed", gnss_get_state()->nmea_count);
+        case 40: COUNTER("gnss_nmea_errors_total", "NMEA sentences rejected", gnss_get_state()->nmea_errors);
+        case 41: GAUGE("ac_signal", "AC mains signal present", ac_freq_get_state()->signal_present);
+        case 42: GAUGE("ac_frequency_hertz", "AC mains frequency", ac_freq_get_state()->frequency_hz);
+        case 43: GAUGE("web_event_subscribers", "Connections on /api/events", web_subscriber_count());
+        case 44: roughtime_get_stats(&rt);
+                 COUNTER("roughtime_batches_total", "Roughtime signatures, one per batch", rt.batches);
+        case 45: roughtime_get_stats(&rt);
+                 COUNTER("roughtime_dropped_total", "Roughtime requests refused with the batch full", rt.dropped);
+        case 46: nts_get_auth_stats(&ns);
+                 COUNTER("nts_naks_total", "NTSN kisses for unknown cookies or bad authenticators", ns.naks);
+        case 47: nts_get_auth_stats(&ns);
+                 COUNTER("nts_key_cache_misses_total", "NTS session key expansions", ns.cache_misses);
+        case 48: nts_get_auth_stats(&ns);
+                 COUNTER("nts_key_rotations_total", "NTS cookie master key rotations", ns.rotations);
+        case 49: nts_ke_get_stats(&ke);
+                 COUNTER("nts_ke_completed_total", "NTS-KE sessions that received cookies", ke.completed);
+        case 50: nts_ke_get_stats(&ke);
+                 COUNTER("nts_ke_failures_total", "NTS-KE TLS failures and timeouts", ke.tls_failures + ke.timeouts);
+        case 51: nts_ke_get_stats(&ke);
+                 GAUGE("nts_ke_arena_peak_bytes", "NTS-KE mbedTLS arena high-water mark", ke.arena_peak);
+        case 52: GAUGE("ref_primary", "Primary reference (0 Rb PPS, 1 GNSS PPS, 4 none)", snap->ref.primary);
+        case 53: COUNTER("ref_switches_total", "Primary reference changes", snap->ref.switches);
+        case 54: GAUGE("ref_steering", "GNSS phase steering the Rb edges", snap->ref.steering);
+        case 55: GAUGE("ref_gnss_offset_seconds", "Filtered GNSS minus rubidium PPS phase", snap->ref.gnss_offset_ns * 1e-9);
+        case 56: GAUGE("ref_phase_seconds", "Phase of the primary edge within the UTC second", snap->ref.phase_ns * 1e-9);
+        case 57: return put_ref_family(buf, len, pos, &snap->ref, "ref_up", "gauge",
+                                       "Reference available (by source)", 0);
+        case 58: return put_ref_family(buf, len, pos, &snap->ref, "ref_score", "gauge",
+                                       "Reference health score 0-100 (by source)", 1);
+        case 59: return put_ref_family(buf, len, pos, &snap->ref, "ref_jitter_seconds", "gauge",
+                                       "Reference short-term jitter (by source)", 2);
+        case 60: return put_ref_family(buf, len, pos, &snap->ref, "ref_faults_total", "counter",
+                                       "Reference samples rejected (by source)", 3);
+        case 61: GAUGE("freq_10mhz_offset", "10 MHz against the reference (ratio)", snap->freq.rb_offset_ppb * 1e-9);
+        case 62: GAUGE("freq_crystal_offset", "Local crystal against the 10 MHz (ratio)", snap->freq.local_ppb * 1e-9);
+        case 63: GAUGE("freq_regression_sigma", "Regression counter 1 s uncertainty (ratio)", snap->freq.sigma_ppb * 1e-9);
+        case 64: GAUGE("ac_rocof_hertz_per_second", "AC mains rate of change of frequency", ac_freq_get_state()->rocof_hz_s);
+        case 65: GAUGE("ac_grid_time_error_seconds", "AC mains grid time minus reference time", ac_freq_get_state()->grid_time_error_ns * 1e-9);
+        case 66: wifi_get_latency(&wl);
+                 GAUGE("wifi_power_mode", "WiFi power mode in the driver (0 latency, 1 balanced, 2 powersave)", wl.applied);
+        case 67: wifi_get_latency(&wl);
+                 COUNTER("wifi_power_switches_total", "Adaptive power mode changes", wl.switches);
+        case 68: wifi_get_latency(&wl);
+                 GAUGE("wifi_link_latency_seconds", "Measured one-way link latency applied to stamps", wl.one_way_ns * 1e-9);
+        case 69: wifi_get_latency(&wl);
+                 GAUGE("wifi_probe_rtt_jitter_seconds", "Gateway probe round trip jitter", wl.rtt_jitter_us * 1e-6);
+        case 70: wifi_get_latency(&wl);
+                 GAUGE("wifi_rx_wake_latency_seconds", "Mean host-wake to lwIP delivery latency", wl.rx_wake_us * 1e-6);
+        case 71: wifi_get_latency(&wl);
+                 GAUGE("wifi_tx_driver_latency_seconds", "Mean time in the driver's transmit call", wl.tx_driver_us * 1e-6);
+        case 72: return put_jitter_summary(buf, len, pos, JITTER_PPS_PERIOD, "pps_period_error_seconds",
+                                           "Rubidium PPS period minus 1 s, since boot");
+        case 73: return put_jitter_summary(buf, len, pos, JITTER_GNSS_OFFSET, "gnss_pps_offset_dist_seconds",
+                                           "GNSS PPS minus rubidium PPS distribution, since boot");
+        case 74: {
+            int32_t jitter_ns = calculate_pps_jitter_ns();
+            GAUGE("pps_period_jitter_seconds", "Rubidium PPS period deviation since 'jitter reset'",
+                  jitter_ns > 0 ? jitter_ns * 1e-9 : 0);
+        }
+#if CHRONOS_ETH_W5500
+        case 75: eth_get_status(&es);
+                 GAUGE("eth_link_up", "W5500 wired link up", es.link_up ? 1 : 0);
+        case 76: eth_get_status(&es);
+                 GAUGE("eth_serving", "NTP/PTP bound to the wired link", es.serving ? 1 : 0);
+        case 77: eth_get_status(&es);
+                 COUNTER("eth_rx_frames_total", "Wired frames delivered to lwIP", es.rx_frames);
+        case 78: eth_get_status(&es);
+                 COUNTER("eth_rx_irq_stamped_total", "Wired frames stamped from the INTn edge", es.rx_irq_stamped);
+        case 79: eth_get_status(&es);
+                 COUNTER("eth_rx_dropped_total", "Wired frames dropped (no pbuf or bad length)", es.rx_dropped + es.rx_errors);
+        case 80: eth_get_status(&es);
+                 COUNTER("eth_tx_frames_total", "Wired frames sent", es.tx_frames);
+        case 81: eth_get_status(&es);
+                 COUNTER("eth_tx_errors_total", "Wired frames not sent", es.tx_errors);
+#endif
+        default:
+            return -1;
+    }
+}
 
-    pos += snprintf(buf + pos, len - pos, "[");
+#undef COUNTER
+#undef GAUGE
+
+/* Histogram line: 0 = HELP/TYPE, 1..nbounds = cumulative bucket, then
+ * +Inf with sum and count. Lines may come from successive reads; the
+ * counts only grow, so the buckets stay monotonic. */
+static bool put_metric_hist(char *buf, size_t len, size_t *pos,
+                            const metrics_hist_snapshot_t *h, uint32_t line) {
+    uint32_t cum = 0;
+    for (uint32_t b = 0; b < line && b <= h->nbounds; b++) {
+        cum += h->buckets[b];
+    }
 
-    bool first = true;
-    for (int i = 0; i < MAX_PULSE_OUTPUTS && pos < (int)len - 100; i++) {
-        pulse_config_t *p = pulse_output_get(i);
-        if (!p || !p->active) continue;
+    if (line == 0) {
+        return web_put(buf, len, pos, "# HELP chronos_%s %s\n# TYPE chronos_%s histogram\n",
+                       h->name, h->help, h->name);
+    }
+    if (line <= h->nbounds) {
+        return web_put(buf, len, pos, "chronos_%s_bucket{le=\"%g\"} %lu\n",
+                       h->name, h->bounds[line - 1] * h->scale, (unsigned long)cum);
+    }
+    return web_put(buf, len, pos,
+        "chronos_%s_bucket{le=\"+Inf\"} %lu\nchronos_%s_sum %.9g\nchronos_%s_count %lu\n",
+        h->name, (unsigned long)h->count, h->name, (double)h->sum * h->scale,
+        h->name, (unsigned long)h->count);
+}
 
-        if (!first) pos += snprintf(buf + pos, len - pos, ",");
-        first = false;
+/**
+ * Prometheus text exposition. Cursor: counter/gauge row while aux = 0,
+ * then aux = 1 + histogram and off = histogram line.
+ */
+static size_t gen_metrics(web_conn_t *c, char *buf, size_t len, bool *done) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    size_t pos = 0;
+
+    while (c->cur.aux == 0) {
+        int r = put_metric_row(buf, len, &pos, c->cur.off, &snap);
+        if (r == 0) return pos;
+        if (r < 0) {
+            c->cur.aux = 1;
+            c->cur.off = 0;
+            break;
+        }
+        c->cur.off++;
+    }
 
-        pos += snprintf(buf + pos, len - pos,
-            "{\"pin\":%d,\"mode\":\"%s\",\"interval\":%u.%u,"
-            "\"second\":%d,\"minute\":%d,\"hour\":%d,"
-            "\"width_ms\":%d,\"count\":%d,\"gap_ms\":%d,\"pio\":%s}",
-            p->gpio_pin, mode_names[p->mode],
-            p->interval_ds / 10, p->interval_ds % 10,
-            p->trigger_second, p->trigger_minute, p->trigger_hour,
-            p->pulse_width_ms, p->pulse_count, p->pulse_gap_ms,
-            p->pio_index >= 0 ? "true" : "false");
+    while (c->cur.aux <= METRIC_HIST_COUNT) {
+        metrics_hist_snapshot_t h;
+        metrics_hist_read((metrics_hist_id_t)(c->cur.aux - 1), &h);
+        while (c->cur.off <= (uint32_t)h.nbounds + 1) {
+            if (!put_metric_hist(buf, len, &pos, &h, c->cur.off)) return pos;
+            c->cur.off++;
+        }
+        c->cur.aux++;
+        c->cur.off = 0;
     }
 
-    pos += snprintf(buf + pos, len - pos, "]");
+    *done = true;
     return pos;
 }
 
 /**
- * Generate JSON status
+ * JSON status
  */
-static int generate_json_status(char *buf, size_t len) {
+static void generate_json_status(web_conn_t *c) {
+    timing_snapshot_t snap;
+    timing_core_get_snapshot(&snap);
+    const time_state_t *state = &snap.state;
+
     char ip_str[20];
     get_ip_address_str(ip_str, sizeof(ip_str));
     const ac_freq_state_t *ac = ac_freq_get_state();
 
-    /* Generate pulse outputs JSON */
-    static char pulse_json[512];
-    generate_pulse_outputs_json(pulse_json, sizeof(pulse_json));
-
     /* Get current time as ISO 8601 */
     char time_str[32];
     format_current_time(time_str, sizeof(time_str));
@@ -844,242 +1495,236 @@ static int generate_json_status(char *buf, size_t len) {
     /* Get uptime */
     uint32_t uptime_sec = to_ms_since_boot(get_absolute_time()) / 1000;
 
-    return snprintf(buf, len,
-        "{"
-        "\"sync_state\":%d,"
-        "\"rb_locked\":%s,"
-        "\"time_valid\":%s,"
-        "\"current_time\":\"%s\","
-        "\"uptime_sec\":%lu,"
-        "\"offset_ns\":%lld,"
-        "\"freq_offset_ppb\":%.3f,"
-        "\"pps_count\":%lu,"
-        "\"freq_count\":%lu,"
-        "\"freq_measurements\":%lu,"
-        "\"ntp_requests\":%lu,"
-        "\"ptp_syncs\":%lu,"
-        "\"ac_mains\":{"
-        "\"signal\":%s,"
-        "\"freq_hz\":%.3f,"
-        "\"avg_hz\":%.3f,"
-        "\"min_hz\":%.3f,"
-        "\"max_hz\":%.3f,"
-        "\"zero_crossings\":%lu"
-        "},"
-        "\"rf_outputs\":{"
-        "\"dcf77\":%s,"
-        "\"wwvb\":%s,"
-        "\"jjy40\":%s,"
-        "\"jjy60\":%s"
-        "},"
-        "\"nmea\":%s,"
-        "\"gps\":{"
-        "\"enabled\":%s,"
-        "\"has_fix\":%s,"
-        "\"has_time\":%s,"
-        "\"pps_valid\":%s,"
-        "\"satellites\":%d,"
-        "\"fix_type\":%d,"
-        "\"pps_count\":%lu,"
-        "\"nmea_count\":%lu,"
-        "\"nmea_errors\":%lu,"
-        "\"firmware\":\"%s\","
-        "\"hardware\":\"%s\","
-        "\"leap_seconds\":%d,"
-        "\"leap_valid\":%s"
-        "},"
-        "\"pulse_outputs\":%s,"
-        "\"ip\":\"%s\","
-        "\"version\":\"%s\""
-        "}",
-        (int)g_time_state.sync_state,
-        g_time_state.rb_locked ? "true" : "false",
-        g_time_state.time_valid ? "true" : "false",
-        time_str,
-        (unsigned long)uptime_sec,
-        (long long)g_time_state.offset_ns,
-        (double)g_time_state.frequency_offset,
-        (unsigned long)g_time_state.pps_count,
-        (unsigned long)g_time_state.last_freq_count,
-        (unsigned long)g_stats.freq_measurements,
-        (unsigned long)g_stats.ntp_requests,
-        (unsigned long)g_stats.ptp_sync_sent,
-        ac->signal_present ? "true" : "false",
-        (double)ac->frequency_hz,
-        (double)ac->frequency_avg_hz,
-        (double)ac->frequency_min_hz,
-        (double)ac->frequency_max_hz,
-        (unsigned long)ac->zero_cross_count,
-        radio_timecode_is_enabled(RADIO_DCF77) ? "true" : "false",
-        radio_timecode_is_enabled(RADIO_WWVB) ? "true" : "false",
-        radio_timecode_is_enabled(RADIO_JJY40) ? "true" : "false",
-        radio_timecode_is_enabled(RADIO_JJY60) ? "true" : "false",
-        nmea_output_is_enabled() ? "true" : "false",
-        gnss_is_enabled() ? "true" : "false",
-        gnss_has_fix() ? "true" : "false",
-        gnss_has_time() ? "true" : "false",
-        gnss_pps_valid() ? "true" : "false",
-        (int)gnss_get_satellites(),
-        (int)gnss_get_fix_type(),
-        (unsigned long)gnss_get_state()->pps_count,
-        (unsigned long)gnss_get_state()->nmea_count,
-        (unsigned long)gnss_get_state()->nmea_errors,
-        gnss_get_firmware_version(),
-        gnss_get_hardware_version(),
-        (int)gnss_get_leap_seconds(),
-        gnss_leap_seconds_is_valid() ? "true" : "false",
-        pulse_json,
-        ip_str,
-        CHRONOS_VERSION_STRING
-    );
+    uint8_t stratum = NTP_STRATUM;
+    if (state->sync_state != SYNC_STATE_LOCKED) {
+        stratum = (state->sync_state >= SYNC_STATE_FINE) ? NTP_STRATUM + 1 : 16;
+    }
+
+    double lat = 0.0, lon = 0.0, alt = 0.0;
+    if (gnss_has_fix()) {
+        gnss_get_position(&lat, &lon, &alt);
+    }
+
+    web_arg_int(c, state->sync_state);
+    web_arg_str(c, state->rb_locked ? "true" : "false");
+    web_arg_str(c, state->time_valid ? "true" : "false");
+    web_arg_strf(c, "%s", time_str);
+    web_arg_uint(c, uptime_sec);
+    web_arg_i64(c, state->offset_ns);
+    web_arg_dbl(c, state->frequency_offset);
+    web_arg_uint(c, state->pps_count);
+    web_arg_uint(c, state->last_freq_count);
+    web_arg_uint(c, snap.freq_measurements);
+    web_arg_uint(c, g_stats.ntp_requests);
+    web_arg_int(c, NTP_PORT);
+    web_arg_int(c, stratum);
+    web_arg_gen(c, gen_ntp_clients_json, 0, 0);
+    web_arg_uint(c, g_stats.ptp_sync_sent);
+    web_arg_str(c, ac->signal_present ? "true" : "false");
+    web_arg_dbl(c, ac->frequency_hz);
+    web_arg_dbl(c, ac->frequency_avg_hz);
+    web_arg_dbl(c, ac->frequency_min_hz);
+    web_arg_dbl(c, ac->frequency_max_hz);
+    web_arg_uint(c, ac->zero_cross_count);
+    web_arg_dbl(c, ac->rocof_hz_s);
+    web_arg_dbl(c, ac->grid_time_error_ns * 1e-6);
+    web_arg_str(c, ac->rb_referenced ? "true" : "false");
+    web_arg_str(c, radio_timecode_is_enabled(RADIO_DCF77) ? "true" : "false");
+    web_arg_str(c, radio_timecode_is_enabled(RADIO_WWVB) ? "true" : "false");
+    web_arg_str(c, radio_timecode_is_enabled(RADIO_JJY40) ? "true" : "false");
+    web_arg_str(c, radio_timecode_is_enabled(RADIO_JJY60) ? "true" : "false");
+    web_arg_str(c, nmea_output_is_enabled() ? "true" : "false");
+    web_arg_str(c, gnss_is_enabled() ? "true" : "false");
+    web_arg_str(c, gnss_has_fix() ? "true" : "false");
+    web_arg_str(c, gnss_has_time() ? "true" : "false");
+    web_arg_str(c, gnss_pps_valid() ? "true" : "false");
+    web_arg_int(c, gnss_get_satellites());
+    web_arg_int(c, gnss_get_fix_type());
+    web_arg_dbl(c, lat);
+    web_arg_dbl(c, lon);
+    if (gnss_has_time()) {
+        gnss_time_t gnss_t;
+        gnss_get_utc_time(&gnss_t);
+        web_arg_strf(c, "%02d:%02d:%02d", gnss_t.hour, gnss_t.minute, gnss_t.second);
+    } else {
+        web_arg_str(c, "");
+    }
+    web_arg_uint(c, gnss_get_state()->pps_count);
+    web_arg_uint(c, gnss_get_state()->nmea_count);
+    web_arg_uint(c, gnss_get_state()->nmea_errors);
+    web_arg_str(c, gnss_get_firmware_version());
+    web_arg_str(c, gnss_get_hardware_version());
+    web_arg_int(c, gnss_get_leap_seconds());
+    web_arg_str(c, gnss_leap_seconds_is_valid() ? "true" : "false");
+    web_arg_str(c, freq_counter_pps_offset_valid() ? "true" : "false");
+    web_arg_int(c, freq_counter_get_pps_offset());
+    web_arg_dbl(c, freq_counter_get_pps_drift());
+    web_arg_dbl(c, freq_counter_get_pps_stddev());
+    web_arg_uint(c, freq_counter_get_fe_pps_count());
+    web_arg_uint(c, freq_counter_get_gnss_pps_count());
+    web_arg_gen(c, gen_pulse_outputs_json, 0, 0);
+    web_arg_strf(c, "%s", ip_str);
+    web_arg_str(c, CHRONOS_VERSION_STRING);
+    web_arg_str(c, CHRONOS_BUILD_DATE);
+
+    web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, JSON_STATUS);
 }
 
 /**
- * Generate JSON config
+ * JSON config
  */
-static int generate_json_config(char *buf, size_t len) {
+static void generate_json_config(web_conn_t *c) {
     config_t *cfg = config_get();
 
-    return snprintf(buf, len,
+    web_arg_str(c, cfg->wifi_ssid);
+    web_arg_str(c, cfg->wifi_enabled ? "true" : "false");
+    web_arg_str(c, g_debug_enabled ? "true" : "false");
+    web_arg_str(c, CHRONOS_VERSION_STRING);
+
+    web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON,
         "{"
         "\"wifi_ssid\":\"%s\","
         "\"wifi_enabled\":%s,"
-        "\"debug_enabled\":%s"
-        "}",
-        cfg->wifi_ssid,
-        cfg->wifi_enabled ? "true" : "false",
-        g_debug_enabled ? "true" : "false"
-    );
+        "\"debug_enabled\":%s,"
+        "\"version\":\"%s\""
+        "}");
 }
 
 /**
- * Generate pulse outputs section for config page
+ * Find an HTTP header value (case-insensitive name match)
  */
-static int generate_pulse_config_html(char *buf, size_t len) {
-    const char *mode_names[] = { "Off", "Interval", "Second", "Minute", "Time" };
-    int pos = 0;
-    int count = 0;
-
-    /* Count active outputs */
-    for (int i = 0; i < MAX_PULSE_OUTPUTS; i++) {
-        pulse_config_t *p = pulse_output_get(i);
-        if (p && p->active) count++;
+static const char *find_http_header(const char *request, const char *header) {
+    size_t hlen = strlen(header);
+    const char *line = strstr(request, "\r\n");
+
+    while (line != NULL) {
+        line += 2;
+        if (line[0] == '\r' && line[1] == '\n') {
+            break;  /* End of headers */
+        }
+        if (strncasecmp(line, header, hlen) == 0 && line[hlen] == ':') {
+            const char *start = line + hlen + 1;
+            while (*start == ' ') start++;  /* Skip whitespace */
+            return start;
+        }
+        line = strstr(line, "\r\n");
     }
+    return NULL;
+}
 
-    pos += snprintf(buf + pos, len - pos,
-        "<div class='card'><h2>Pulse Outputs</h2>");
-
-    if (count == 0) {
-        pos += snprintf(buf + pos, len - pos,
-            "<div class='stat'><span class='stat-label'>Status</span>"
-            "<span class='stat-value'>No outputs configured</span></div>");
-    } else {
-        for (int i = 0; i < MAX_PULSE_OUTPUTS && pos < (int)len - 200; i++) {
-            pulse_config_t *p = pulse_output_get(i);
-            if (!p || !p->active) continue;
-
-            char config[64];
-            switch (p->mode) {
-                case PULSE_MODE_INTERVAL:
-                    snprintf(config, sizeof(config), "every %u.%us, %ums",
-                        p->interval_ds / 10, p->interval_ds % 10, p->pulse_width_ms);
-                    break;
-                case PULSE_MODE_SECOND:
-                    snprintf(config, sizeof(config), "sec %d, %ums x%d",
-                        p->trigger_second, p->pulse_width_ms, p->pulse_count);
-                    break;
-                case PULSE_MODE_MINUTE:
-                    snprintf(config, sizeof(config), "min %d, %ums x%d",
-                        p->trigger_minute, p->pulse_width_ms, p->pulse_count);
-                    break;
-                case PULSE_MODE_TIME:
-                    snprintf(config, sizeof(config), "%02d:%02d, %ums x%d",
-                        p->trigger_hour, p->trigger_minute,
-                        p->pulse_width_ms, p->pulse_count);
-                    break;
-                default:
-                    snprintf(config, sizeof(config), "disabled");
-            }
-
-            pos += snprintf(buf + pos, len - pos,
-                "<div class='stat'><span class='stat-label'>GP%d (%s)</span>"
-                "<span class='stat-value'>%s</span></div>",
-                p->gpio_pin, mode_names[p->mode], config);
-        }
+/**
+ * Parse HTTP header value
+ */
+static bool parse_http_header(const char *request, const char *header, char *value, size_t max_len) {
+    const char *start = find_http_header(request, header);
+    if (!start) {
+        value[0] = '\0';
+        return false;
     }
 
-    pos += snprintf(buf + pos, len - pos,
-        "<p class='note'>Configure via CLI: pulse &lt;pin&gt; &lt;mode&gt; ...</p></div>");
+    const char *end = strstr(start, "\r\n");
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+    if (len >= max_len) len = max_len - 1;
 
-    return pos;
+    strncpy(value, start, len);
+    value[len] = '\0';
+    return true;
 }
 
 /**
- * Generate config page HTML
+ * HTTP/1.1 keeps the connection open unless told otherwise; HTTP/1.0
+ * clients get a close-delimited body, since it is not length-prefixed
  */
-static int generate_config_page(char *buf, size_t len, const char *message) {
-    config_t *cfg = config_get();
+static void parse_connection_mode(web_conn_t *c, const char *request) {
+    const char *eol = strstr(request, "\r\n");
+    bool http10 = eol && (eol - request) >= 8 && strncmp(eol - 8, "HTTP/1.0", 8) == 0;
 
-    /* Generate pulse outputs section */
-    static char pulse_html[512];
-    generate_pulse_config_html(pulse_html, sizeof(pulse_html));
+    char value[24];
+    parse_http_header(request, "Connection", value, sizeof(value));
 
-    return snprintf(buf, len, CONFIG_PAGE,
-        message ? message : "",
-        cfg->wifi_ssid,
-        cfg->wifi_enabled ? "checked" : "",
-        g_debug_enabled ? "checked" : "",
-        pulse_html,
-        CHRONOS_VERSION_STRING
-    );
+    c->chunked = !http10;
+    c->keep_alive = !http10 && strncasecmp(value, "close", 5) != 0;
 }
 
 /**
- * Generate OTA update page HTML
+ * Look up the embedded page for a GET request. "/index" and a trailing
+ * ".html" are accepted as aliases.
  */
-static int generate_ota_page(char *buf, size_t len, const char *message) {
-    const ota_status_t *ota = ota_get_status();
-    const char *status_msg = "";
+static const web_asset_t *find_web_asset(const char *request) {
+    if (strncmp(request, "GET ", 4) != 0) {
+        return NULL;
+    }
 
-    /* Check for update/rollback messages */
-    if (ota->is_after_rollback) {
-        status_msg = "<div class='msg msg-err'>Rollback occurred - previous update failed!</div>";
-    } else if (ota->is_after_update) {
-        status_msg = "<div class='msg msg-ok'>Firmware updated successfully!</div>";
+    const char *path = request + 4;
+    size_t len = strcspn(path, " ?\r\n");
+    if (len > 5 && strncmp(path + len - 5, ".html", 5) == 0) {
+        len -= 5;
+    }
+    if (len == 6 && strncmp(path, "/index", 6) == 0) {
+        len = 1;
     }
 
-    return snprintf(buf, len, OTA_PAGE,
-        message ? message : status_msg,
-        CHRONOS_VERSION_STRING,
-        CHRONOS_BUILD_DATE,
-        ota_state_str(ota->state),
-        CHRONOS_VERSION_STRING
-    );
+    for (int i = 0; i < web_asset_count; i++) {
+        const web_asset_t *a = &web_assets[i];
+        if (strlen(a->path) == len && strncmp(a->path, path, len) == 0) {
+            return a;
+        }
+    }
+    return NULL;
 }
 
 /**
- * Parse HTTP header value
+ * Serve an embedded page: 304 if the client's copy is current, else the
+ * gzip stream straight from flash. Every browser in use accepts gzip, so
+ * Accept-Encoding is not checked.
  */
-static bool parse_http_header(const char *request, const char *header, char *value, size_t max_len) {
-    char search[64];
-    snprintf(search, sizeof(search), "%s:", header);
-
-    const char *start = strstr(request, search);
-    if (!start) {
-        value[0] = '\0';
-        return false;
+static void web_respond_asset(web_conn_t *c, const web_asset_t *a, const char *request) {
+    char tag[64];
+    bool fresh = parse_http_header(request, "If-None-Match", tag, sizeof(tag)) &&
+                 strstr(tag, a->etag) != NULL;
+    int n;
+
+    if (fresh) {
+        n = snprintf(c->head, sizeof(c->head),
+            "HTTP/1.1 " HTTP_STATUS_NOT_MODIFIED "\r\n"
+            "ETag: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: %s\r\n"
+            "\r\n",
+            a->etag, c->keep_alive ? "keep-alive" : "close");
+    } else {
+        n = snprintf(c->head, sizeof(c->head),
+            "HTTP/1.1 " HTTP_STATUS_OK "\r\n"
+            "Content-Type: %s\r\n"
+            "Content-Encoding: gzip\r\n"
+            "Content-Length: %lu\r\n"
+            "ETag: %s\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "Connection: %s\r\n"
+            "\r\n",
+            a->content_type, (unsigned long)a->len, a->etag,
+            c->keep_alive ? "keep-alive" : "close");
+        c->asset = a;
+        c->asset_off = 0;
     }
+    c->head_len = (n > 0 && n < (int)sizeof(c->head)) ? (uint16_t)n : 0;
+    c->state = WEB_CONN_STREAMING;
+}
 
-    start += strlen(search);
-    while (*start == ' ') start++;  /* Skip whitespace */
-
-    const char *end = strstr(start, "\r\n");
-    size_t len = end ? (size_t)(end - start) : strlen(start);
-    if (len >= max_len) len = max_len - 1;
-
-    strncpy(value, start, len);
-    value[len] = '\0';
-    return true;
+/**
+ * Bodyless 303 to another page
+ */
+static void web_respond_redirect(web_conn_t *c, const char *location) {
+    int n = snprintf(c->head, sizeof(c->head),
+        "HTTP/1.1 " HTTP_STATUS_SEE_OTHER "\r\n"
+        "Location: %s\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: %s\r\n"
+        "\r\n",
+        location, c->keep_alive ? "keep-alive" : "close");
+    c->head_len = (n > 0 && n < (int)sizeof(c->head)) ? (uint16_t)n : 0;
+    c->state = WEB_CONN_STREAMING;
 }
 
 /**
@@ -1102,6 +1747,26 @@ static void url_decode(char *str) {
     *dst = '\0';
 }
 
+/**
+ * Copy the query string of the request line (after '?', up to the
+ * space before the HTTP version)
+ */
+static bool parse_query_string(const char *request, char *query, size_t max_len) {
+    const char *path = strchr(request, ' ');
+    const char *end = path ? strpbrk(path + 1, " \r\n") : NULL;
+    const char *start = end ? memchr(path, '?', (size_t)(end - path)) : NULL;
+    if (!start) {
+        query[0] = '\0';
+        return false;
+    }
+
+    size_t len = (size_t)(end - start - 1);
+    if (len >= max_len) len = max_len - 1;
+    memcpy(query, start + 1, len);
+    query[len] = '\0';
+    return true;
+}
+
 /**
  * Parse form field from POST body
  */
@@ -1135,88 +1800,71 @@ static bool parse_form_checkbox(const char *body, const char *field) {
     return strstr(body, search) != NULL;
 }
 
-/*============================================================================
- * TCP CALLBACKS
- *============================================================================*/
-
-static err_t web_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len) {
-    (void)arg;
-    (void)len;
-    tcp_close(tpcb);
-    return ERR_OK;
-}
-
-/* OTA chunk buffering state */
-static uint8_t ota_chunk_buf[1280];  /* Buffer for OTA chunk data */
-static size_t ota_chunk_expected = 0;
-static size_t ota_chunk_received = 0;
-static struct tcp_pcb *ota_chunk_pcb = NULL;
-
-static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
-    (void)arg;
+/**
+ * Apply POST /api/rf form fields - runs on the timing core, which owns
+ * the RF/NMEA outputs and the GNSS UART/PPS interrupts
+ */
+static void apply_rf_form(void *arg) {
+    const char *body = (const char *)arg;
+    config_t *cfg = config_get();
 
-    if (p == NULL || err != ERR_OK) {
-        if (p != NULL) pbuf_free(p);
-        tcp_close(tpcb);
-        /* Reset OTA chunk state if this connection was buffering */
-        if (tpcb == ota_chunk_pcb) {
-            ota_chunk_expected = 0;
-            ota_chunk_received = 0;
-            ota_chunk_pcb = NULL;
-        }
-        return ERR_OK;
+    char val[8];
+    if (parse_form_field(body, "dcf77", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        radio_timecode_enable(RADIO_DCF77, enable);
+        cfg->rf_dcf77_enabled = enable;
     }
-
-    tcp_recved(tpcb, p->tot_len);
-
-    /* Check if we're continuing to receive OTA chunk data */
-    if (tpcb == ota_chunk_pcb && ota_chunk_expected > 0) {
-        /* Append to buffer */
-        size_t to_copy = p->tot_len;
-        if (ota_chunk_received + to_copy > sizeof(ota_chunk_buf)) {
-            to_copy = sizeof(ota_chunk_buf) - ota_chunk_received;
-        }
-        pbuf_copy_partial(p, ota_chunk_buf + ota_chunk_received, to_copy, 0);
-        ota_chunk_received += to_copy;
-        pbuf_free(p);
-
-        /* Check if we have all the data */
-        if (ota_chunk_received >= ota_chunk_expected) {
-            printf("[WEB] OTA chunk complete: %zu bytes\n", ota_chunk_received);
-            ota_error_t ota_err = ota_write_chunk(ota_chunk_buf, ota_chunk_received);
-
-            static char response[256];
-            if (ota_err == OTA_OK) {
-                snprintf(response, sizeof(response), "%sOK", HTTP_OK_TEXT);
-            } else {
-                snprintf(response, sizeof(response), "%s%s", HTTP_400_RESPONSE, ota_error_str(ota_err));
-            }
-
-            size_t resp_len = strlen(response);
-            tcp_write(tpcb, response, resp_len, TCP_WRITE_FLAG_COPY);
-            tcp_output(tpcb);
-            tcp_close(tpcb);
-
-            ota_chunk_expected = 0;
-            ota_chunk_received = 0;
-            ota_chunk_pcb = NULL;
-        }
-        return ERR_OK;
+    if (parse_form_field(body, "wwvb", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        radio_timecode_enable(RADIO_WWVB, enable);
+        cfg->rf_wwvb_enabled = enable;
+    }
+    if (parse_form_field(body, "jjy40", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        radio_timecode_enable(RADIO_JJY40, enable);
+        cfg->rf_jjy40_enabled = enable;
+    }
+    if (parse_form_field(body, "jjy60", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        radio_timecode_enable(RADIO_JJY60, enable);
+        cfg->rf_jjy60_enabled = enable;
+    }
+    if (parse_form_field(body, "nmea", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        nmea_output_enable(enable);
+        cfg->nmea_enabled = enable;
+    }
+    if (parse_form_field(body, "gps", val, sizeof(val))) {
+        bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
+        gnss_enable(enable);
+        cfg->gnss_enabled = enable;
     }
+}
 
-    /* Copy request to buffer for parsing - use pbuf_copy_partial to handle chained pbufs */
-    static char request[2048];
-    size_t copy_len = p->tot_len < sizeof(request) - 1 ? p->tot_len : sizeof(request) - 1;
-    pbuf_copy_partial(p, request, copy_len, 0);
-    request[copy_len] = '\0';
+/**
+ * Restart a jitter window - runs on the timing core, which writes them
+ */
+static void jitter_reset_on_timing_core(void *arg) {
+    jitter_stats_reset((jitter_series_t)*(const int *)arg);
+}
 
-    pbuf_free(p);
+/**
+ * Answer an OTA call with OK or the OTA error text
+ */
+static void respond_ota_result(web_conn_t *c, ota_error_t err) {
+    if (err == OTA_OK) {
+        web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_TEXT, "OK");
+    } else {
+        web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_TEXT, ota_error_str(err));
+    }
+}
 
-    /* Allocate response buffer */
-    static char response[20000];
-    static char html_buf[18000];
-    static char cli_output[4096];
-    const char *msg = NULL;
+/**
+ * Dispatch one request. Leaves the connection idle without a response
+ * only while an OTA chunk or stream body is still arriving.
+ */
+static void web_handle_request(web_conn_t *c, const char *request, size_t copy_len) {
+    const web_asset_t *asset;
 
     /* Parse HTTP method and path */
     bool is_post = (strncmp(request, "POST ", 5) == 0);
@@ -1225,66 +1873,40 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
         /* Lightweight time-only API for fast polling */
         char time_str[32];
         format_current_time(time_str, sizeof(time_str));
-        snprintf(response, sizeof(response),
-            "%s{\"time\":\"%s\",\"valid\":%s}",
-            HTTP_JSON_HEADER, time_str,
-            g_time_state.time_valid ? "true" : "false");
+        timing_snapshot_t snap;
+        timing_core_get_snapshot(&snap);
+        web_arg_strf(c, "%s", time_str);
+        web_arg_str(c, snap.state.time_valid ? "true" : "false");
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"time\":\"%s\",\"valid\":%s}");
+
+    } else if (strncmp(request, "GET /metrics", 12) == 0) {
+        /* Prometheus scrape */
+        web_arg_gen(c, gen_metrics, 0, 0);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_METRICS, "%s");
+
+    } else if (strstr(request, "/api/events") != NULL) {
+        /* Server-sent telemetry stream */
+        web_subscribe_events(c);
 
     } else if (strstr(request, "/api/status") != NULL) {
         /* JSON status API */
-        char json_buf[960];  /* Increased for GPS diagnostics */
-        generate_json_status(json_buf, sizeof(json_buf));
-        snprintf(response, sizeof(response), "%s%s", HTTP_JSON_HEADER, json_buf);
+        generate_json_status(c);
 
     } else if (strstr(request, "/api/config") != NULL) {
         /* JSON config API */
-        char json_buf[256];
-        generate_json_config(json_buf, sizeof(json_buf));
-        snprintf(response, sizeof(response), "%s%s", HTTP_JSON_HEADER, json_buf);
+        generate_json_config(c);
 
     } else if (is_post && strstr(request, "/api/rf") != NULL) {
         /* POST /api/rf - toggle RF outputs */
         const char *body = strstr(request, "\r\n\r\n");
         if (body) {
             body += 4;
-            config_t *cfg = config_get();
-
-            char val[8];
-            if (parse_form_field(body, "dcf77", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                radio_timecode_enable(RADIO_DCF77, enable);
-                cfg->rf_dcf77_enabled = enable;
-            }
-            if (parse_form_field(body, "wwvb", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                radio_timecode_enable(RADIO_WWVB, enable);
-                cfg->rf_wwvb_enabled = enable;
-            }
-            if (parse_form_field(body, "jjy40", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                radio_timecode_enable(RADIO_JJY40, enable);
-                cfg->rf_jjy40_enabled = enable;
-            }
-            if (parse_form_field(body, "jjy60", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                radio_timecode_enable(RADIO_JJY60, enable);
-                cfg->rf_jjy60_enabled = enable;
-            }
-            if (parse_form_field(body, "nmea", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                nmea_output_enable(enable);
-                cfg->nmea_enabled = enable;
-            }
-            if (parse_form_field(body, "gps", val, sizeof(val))) {
-                bool enable = (strcmp(val, "on") == 0 || strcmp(val, "1") == 0);
-                gnss_enable(enable);
-                cfg->gnss_enabled = enable;
-            }
+            timing_core_call(apply_rf_form, (void *)body);
             if (parse_form_checkbox(body, "save")) {
                 config_save();
             }
         }
-        snprintf(response, sizeof(response), "%s{\"ok\":true}", HTTP_JSON_HEADER);
+        web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":true}");
 
     } else if (is_post && strstr(request, "/api/cli") != NULL) {
         /* POST /api/cli - execute CLI command and return JSON */
@@ -1293,97 +1915,152 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
             body += 4;
             char cmd[128];
             parse_form_field(body, "cmd", cmd, sizeof(cmd));
-            if (cmd[0]) {
-                cli_execute(cmd, cli_output, sizeof(cli_output));
-                /* Escape output for JSON */
-                static char escaped[8192];
-                char *out = escaped;
-                for (const char *p = cli_output; *p && out < escaped + sizeof(escaped) - 6; p++) {
-                    if (*p == '"') { *out++ = '\\'; *out++ = '"'; }
-                    else if (*p == '\\') { *out++ = '\\'; *out++ = '\\'; }
-                    else if (*p == '\n') { *out++ = '\\'; *out++ = 'n'; }
-                    else if (*p == '\r') { *out++ = '\\'; *out++ = 'r'; }
-                    else if (*p == '\t') { *out++ = '\\'; *out++ = 't'; }
-                    else if ((unsigned char)*p >= 32) { *out++ = *p; }
-                }
-                *out = '\0';
-                snprintf(response, sizeof(response), "%s{\"ok\":true,\"output\":\"%s\"}", HTTP_JSON_HEADER, escaped);
+            if (!cmd[0]) {
+                web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":false,\"error\":\"No command\"}");
+            } else if (cli_owner != NULL || !cli_stream_start(cmd)) {
+                web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":false,\"error\":\"Busy\"}");
             } else {
-                snprintf(response, sizeof(response), "%s{\"ok\":false,\"error\":\"No command\"}", HTTP_JSON_HEADER);
+                /* Streamed as the command runs; a job carries on after this */
+                cli_owner = c;
+                web_arg_gen(c, gen_cli_json, 0, 0);
+                web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":true,\"output\":\"%s\"}");
             }
         } else {
-            snprintf(response, sizeof(response), "%s{\"ok\":false,\"error\":\"No body\"}", HTTP_JSON_HEADER);
+            web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":false,\"error\":\"No body\"}");
         }
 
     } else if (strstr(request, "/api/logs") != NULL) {
-        /* GET /api/logs?pos=N - get log output since position N */
-        static uint32_t client_pos = 0;  /* Track position per connection */
+        /* GET /api/logs?pos=N - get log output since position N.
+         * Print pending records first so the reply is current. */
+        log_drain();
+        uint32_t end = log_buffer_get_pos();
+        uint32_t start = 0;
 
         /* Parse position parameter */
         const char *pos_param = strstr(request, "pos=");
         if (pos_param) {
-            client_pos = (uint32_t)strtoul(pos_param + 4, NULL, 10);
+            start = (uint32_t)strtoul(pos_param + 4, NULL, 10);
         }
 
-        /* Read logs into buffer */
-        static char log_buf[4096];
-        size_t log_len = log_buffer_read(log_buf, sizeof(log_buf), &client_pos);
+        /* Newest WEB_LOG_MAX bytes at most; a position from before a
+         * log clear restarts from the beginning */
+        if (start > end) {
+            start = 0;
+        }
+        if (end - start > WEB_LOG_MAX) {
+            start = end - WEB_LOG_MAX;
+        }
 
-        /* Escape for JSON */
-        static char escaped[8192];
-        char *out = escaped;
-        for (size_t i = 0; i < log_len && out < escaped + sizeof(escaped) - 6; i++) {
-            char c = log_buf[i];
-            if (c == '"') { *out++ = '\\'; *out++ = '"'; }
-            else if (c == '\\') { *out++ = '\\'; *out++ = '\\'; }
-            else if (c == '\n') { *out++ = '\\'; *out++ = 'n'; }
-            else if (c == '\r') { *out++ = '\\'; *out++ = 'r'; }
-            else if (c == '\t') { *out++ = '\\'; *out++ = 't'; }
-            else if ((unsigned char)c >= 32) { *out++ = c; }
+        web_arg_uint(c, end);
+        web_arg_gen(c, gen_log_json, start, end);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"pos\":%lu,\"data\":\"%s\"}");
+
+    } else if (strstr(request, "/api/stability") != NULL) {
+        /* GET /api/stability - ADEV/MDEV/TDEV at octave taus */
+        web_arg_uint(c, stability_get_samples());
+        web_arg_gen(c, gen_stability_json, 0, 0);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"samples\":%lu,\"points\":[%s]}");
+
+    } else if (is_post && strstr(request, "/api/jitter") != NULL) {
+        /* POST /api/jitter[?series=pps|gnss] - restart the window */
+        char query[32];
+        char val[8];
+        int series = JITTER_SERIES_COUNT;
+        parse_query_string(request, query, sizeof(query));
+        if (parse_form_field(query, "series", val, sizeof(val))) {
+            series = jitter_series_from_name(val);
+        }
+        if (series < 0) {
+            web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_JSON,
+                             "{\"ok\":false,\"error\":\"Unknown series\"}");
+        } else {
+            timing_core_call(jitter_reset_on_timing_core, &series);
+            web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"ok\":true}");
         }
-        *out = '\0';
 
-        snprintf(response, sizeof(response),
-            "%s{\"pos\":%lu,\"data\":\"%s\"}",
-            HTTP_JSON_HEADER, (unsigned long)client_pos, escaped);
+    } else if (strstr(request, "/api/jitter") != NULL) {
+        /* GET /api/jitter - PPS period error and GNSS offset statistics
+         * (ns), window since the last reset and total since boot */
+        web_arg_gen(c, gen_jitter_json, 0, 0);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON, "{\"unit\":\"ns\",\"stats\":[%s]}");
+
+    } else if (strstr(request, "/api/history") != NULL) {
+        /* GET /api/history - series list and stats, or with
+         * ?series=S&tier=1s|1m|1h|1d[&from=T][&to=T][&format=csv|bin]
+         * one tier of one series over Unix time [from, to) */
+        char query[128];
+        char val[16];
+        parse_query_string(request, query, sizeof(query));
+
+        if (!parse_form_field(query, "series", val, sizeof(val))) {
+            tsdb_stats_t st;
+            tsdb_get_stats(&st);
+            web_arg_uint(c, st.ram_bytes);
+            web_arg_uint(c, st.flash_pages);
+            web_arg_uint(c, st.flash_used);
+            web_arg_uint(c, st.spilled);
+            web_arg_uint(c, st.spill_dropped);
+            web_arg_gen(c, gen_history_index, 0, 0);
+            web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON,
+                "{\"ram_bytes\":%lu,\"flash_pages\":%lu,\"flash_used\":%lu,"
+                "\"spilled\":%lu,\"spill_dropped\":%lu,"
+                "\"tiers\":[\"1s\",\"1m\",\"1h\",\"1d\"],\"series\":[%s]}");
+        } else {
+            int series = tsdb_series_from_name(val);
+            int tier = parse_form_field(query, "tier", val, sizeof(val)) ?
+                       tsdb_tier_from_name(val) : TSDB_TIER_MIN;
+
+            if (series < 0 || tier < 0) {
+                web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_JSON,
+                                 "{\"ok\":false,\"error\":\"Unknown series or tier\"}");
+            } else {
+                tsdb_query_t *q = &history_queries[c - web_conns];
+                q->series = (uint8_t)series;
+                q->tier = (uint8_t)tier;
+                q->from = parse_form_field(query, "from", val, sizeof(val)) ?
+                          (uint32_t)strtoul(val, NULL, 10) : 0;
+                q->to = parse_form_field(query, "to", val, sizeof(val)) ?
+                        (uint32_t)strtoul(val, NULL, 10) : UINT32_MAX;
+                q->binary = parse_form_field(query, "format", val, sizeof(val)) &&
+                            strcmp(val, "bin") == 0;
+
+                if (q->binary) {
+                    web_arg_gen(c, gen_history, 0, 0);
+                    web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_BINARY, "%s");
+                } else {
+                    web_arg_str(c, tsdb_series_name(series));
+                    web_arg_str(c, tsdb_series_unit(series));
+                    web_arg_str(c, tsdb_tier_name(tier));
+                    web_arg_str(c, (tier == TSDB_TIER_SEC) ? "time,value" : "time,min,avg,max");
+                    web_arg_gen(c, gen_history, 0, 0);
+                    web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_TEXT, "# %s %s %s\n%s\n%s");
+                }
+            }
+        }
 
     } else if (strstr(request, "/api/ac_history") != NULL) {
         /* GET /api/ac_history - get AC frequency history for graphing */
-        static float min_buf[AC_FREQ_MINUTE_HISTORY];
-        static float hour_buf[AC_FREQ_HOUR_HISTORY];
-
-        int min_count = ac_freq_get_minute_history(min_buf, AC_FREQ_MINUTE_HISTORY);
-        int hour_count = ac_freq_get_hour_history(hour_buf, AC_FREQ_HOUR_HISTORY);
+        static float probe[AC_FREQ_MINUTE_HISTORY > AC_FREQ_HOUR_HISTORY ?
+                           AC_FREQ_MINUTE_HISTORY : AC_FREQ_HOUR_HISTORY];
+        int min_count = ac_freq_get_minute_history(probe, AC_FREQ_MINUTE_HISTORY);
+        int hour_count = ac_freq_get_hour_history(probe, AC_FREQ_HOUR_HISTORY);
 
         /* Get current Unix time */
         timestamp_t ts = get_current_time();
         uint32_t unix_time = (ts.seconds >= NTP_UNIX_OFFSET) ? ts.seconds - NTP_UNIX_OFFSET : 0;
 
-        /* Build JSON response */
-        char *p = response;
-        int rem = sizeof(response);
-        int n;
-
-        n = snprintf(p, rem, "%s{\"time_unix\":%lu,\"minutes\":[", HTTP_JSON_HEADER, (unsigned long)unix_time);
-        p += n; rem -= n;
-
-        for (int i = 0; i < min_count && rem > 20; i++) {
-            n = snprintf(p, rem, "%s%.3f", i > 0 ? "," : "", min_buf[i]);
-            p += n; rem -= n;
-        }
-
-        n = snprintf(p, rem, "],\"hours\":[");
-        p += n; rem -= n;
-
-        for (int i = 0; i < hour_count && rem > 20; i++) {
-            n = snprintf(p, rem, "%s%.3f", i > 0 ? "," : "", hour_buf[i]);
-            p += n; rem -= n;
-        }
-
-        n = snprintf(p, rem, "],\"min_count\":%d,\"hour_count\":%d}", min_count, hour_count);
+        web_arg_uint(c, unix_time);
+        web_arg_gen(c, gen_ac_minutes, 0, min_count);
+        web_arg_gen(c, gen_ac_hours, 0, hour_count);
+        web_arg_int(c, min_count);
+        web_arg_int(c, hour_count);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON,
+            "{\"time_unix\":%lu,\"minutes\":[%s],\"hours\":[%s],"
+            "\"min_count\":%d,\"hour_count\":%d}");
 
     } else if (is_post && strstr(request, "/config") != NULL) {
-        /* POST /config - save configuration */
+        /* POST /config - save configuration, then back to the page */
+        const char *location = "/config";
         const char *body = strstr(request, "\r\n\r\n");
         if (body) {
             body += 4;
@@ -1403,47 +2080,52 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
             }
 
             /* Save to flash */
-            if (config_save()) {
-                msg = "<div class='msg msg-ok'>Configuration saved!</div>";
-            } else {
-                msg = "<div class='msg msg-err'>Failed to save configuration</div>";
-            }
+            location = config_save() ? "/config?saved=1" : "/config?saved=0";
         }
-        generate_config_page(html_buf, sizeof(html_buf), msg);
-        snprintf(response, sizeof(response), "%s%s", HTTP_RESPONSE_HEADER, html_buf);
+        web_respond_redirect(c, location);
 
-    } else if (strstr(request, "GET /config") != NULL) {
-        /* GET /config - show config page */
-        generate_config_page(html_buf, sizeof(html_buf), NULL);
-        snprintf(response, sizeof(response), "%s%s", HTTP_RESPONSE_HEADER, html_buf);
-
-    } else if (strstr(request, "GET / ") != NULL || strstr(request, "GET /index") != NULL) {
-        /* Status page */
-        generate_status_page(html_buf, sizeof(html_buf));
-        snprintf(response, sizeof(response), "%s%s", HTTP_RESPONSE_HEADER, html_buf);
-
-    } else if (strstr(request, "GET /acfreq") != NULL) {
-        /* AC frequency graph page */
-        snprintf(response, sizeof(response), "%s%s", HTTP_RESPONSE_HEADER, AC_GRAPH_PAGE);
-
-    } else if (strstr(request, "GET /ota") != NULL) {
-        /* OTA update page */
-        generate_ota_page(html_buf, sizeof(html_buf), NULL);
-        snprintf(response, sizeof(response), "%s%s", HTTP_RESPONSE_HEADER, html_buf);
+    } else if ((asset = find_web_asset(request)) != NULL) {
+        /* Static pages (status, config, AC graph, OTA) from flash */
+        web_respond_asset(c, asset, request);
 
     } else if (is_post && strstr(request, "/api/ota/begin") != NULL) {
         /* OTA begin - parse size from header */
         char size_str[16];
         if (parse_http_header(request, "X-OTA-Size", size_str, sizeof(size_str))) {
             size_t fw_size = (size_t)atoi(size_str);
-            ota_error_t err = ota_begin(fw_size, 0);
-            if (err == OTA_OK) {
-                snprintf(response, sizeof(response), "%sOK", HTTP_OK_TEXT);
+            respond_ota_result(c, ota_begin(fw_size, 0));
+        } else {
+            web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_TEXT, "Missing X-OTA-Size header");
+        }
+
+    } else if (is_post && strstr(request, "/api/ota/stream") != NULL) {
+        /* OTA stream - the whole image in one body; answered once it is
+         * all programmed and checked */
+        char value[16];
+        size_t content_len = 0;
+        uint32_t crc = 0;
+        if (parse_http_header(request, "Content-Length", value, sizeof(value))) {
+            content_len = (size_t)strtoul(value, NULL, 10);
+        }
+        if (parse_http_header(request, "X-OTA-CRC", value, sizeof(value))) {
+            crc = (uint32_t)strtoul(value, NULL, 16);
+        }
+
+        const char *body = strstr(request, "\r\n\r\n");
+        if (body == NULL || content_len == 0) {
+            web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_TEXT, "No body or Content-Length");
+        } else if (ota_stream_conn != NULL) {
+            respond_ota_result(c, OTA_ERROR_ALREADY_IN_PROGRESS);
+        } else {
+            ota_error_t err = ota_stream_begin(content_len, crc);
+            if (err != OTA_OK) {
+                c->keep_alive = false;
+                respond_ota_result(c, err);
             } else {
-                snprintf(response, sizeof(response), "%s%s", HTTP_400_RESPONSE, ota_error_str(err));
+                ota_stream_conn = c;
+                ota_stream_remaining = content_len;
+                ota_stream_body_offset = (size_t)(body + 4 - request);
             }
-        } else {
-            snprintf(response, sizeof(response), "%sMissing X-OTA-Size header", HTTP_400_RESPONSE);
         }
 
     } else if (is_post && strstr(request, "/api/ota/chunk") != NULL) {
@@ -1464,46 +2146,30 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
 
             if (body_in_first_packet >= content_len) {
                 /* All data arrived in first packet */
-                ota_error_t err = ota_write_chunk((const uint8_t *)body, content_len);
-                if (err == OTA_OK) {
-                    snprintf(response, sizeof(response), "%sOK", HTTP_OK_TEXT);
-                } else {
-                    snprintf(response, sizeof(response), "%s%s", HTTP_400_RESPONSE, ota_error_str(err));
-                }
+                respond_ota_result(c, ota_write_chunk((const uint8_t *)body, content_len));
+            } else if (content_len > sizeof(ota_chunk_buf)) {
+                web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_TEXT, "Chunk too large");
             } else {
-                /* Need to buffer and wait for more data */
-                if (content_len > sizeof(ota_chunk_buf)) {
-                    snprintf(response, sizeof(response), "%sChunk too large", HTTP_400_RESPONSE);
-                } else {
-                    /* Copy what we have and wait for more */
-                    memcpy(ota_chunk_buf, body, body_in_first_packet);
-                    ota_chunk_received = body_in_first_packet;
-                    ota_chunk_expected = content_len;
-                    ota_chunk_pcb = tpcb;
-                    printf("[WEB] OTA chunk: buffering, need %zu more\n", content_len - body_in_first_packet);
-                    return ERR_OK;  /* Don't send response yet, wait for more data */
-                }
+                /* Copy what we have and wait for more */
+                memcpy(ota_chunk_buf, body, body_in_first_packet);
+                ota_chunk_received = body_in_first_packet;
+                ota_chunk_expected = content_len;
+                ota_chunk_conn = c;
+                printf("[WEB] OTA chunk: buffering, need %zu more\n", content_len - body_in_first_packet);
             }
         } else {
-            snprintf(response, sizeof(response), "%sNo body or Content-Length", HTTP_400_RESPONSE);
+            web_respond_text(c, HTTP_STATUS_BAD_REQUEST, HTTP_TYPE_TEXT, "No body or Content-Length");
         }
 
     } else if (is_post && strstr(request, "/api/ota/finish") != NULL) {
         /* OTA finish - validate and mark ready */
-        ota_error_t err = ota_finish();
-        if (err == OTA_OK) {
-            snprintf(response, sizeof(response), "%sOK", HTTP_OK_TEXT);
-        } else {
-            snprintf(response, sizeof(response), "%s%s", HTTP_400_RESPONSE, ota_error_str(err));
-        }
+        respond_ota_result(c, ota_finish());
 
     } else if (is_post && strstr(request, "/api/ota/apply") != NULL) {
-        /* OTA apply - reboot with new firmware */
-        snprintf(response, sizeof(response), "%sRebooting...", HTTP_OK_TEXT);
-        /* Send response first, then reboot */
-        size_t resp_len = strlen(response);
-        tcp_write(tpcb, response, resp_len, TCP_WRITE_FLAG_COPY);
-        tcp_output(tpcb);
+        /* OTA apply - send the response first, then reboot */
+        c->keep_alive = false;
+        web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_TEXT, "Rebooting...");
+        web_pump(c);
         sleep_ms(100);
         ota_apply_and_reboot();
         /* Won't return */
@@ -1511,33 +2177,233 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
     } else if (is_post && strstr(request, "/api/ota/abort") != NULL) {
         /* OTA abort - cancel current upload */
         ota_abort();
-        snprintf(response, sizeof(response), "%sAborted", HTTP_OK_TEXT);
+        web_respond_text(c, HTTP_STATUS_OK, HTTP_TYPE_TEXT, "Aborted");
 
     } else if (strstr(request, "/api/ota/status") != NULL) {
         /* OTA status JSON */
         const ota_status_t *ota = ota_get_status();
-        snprintf(response, sizeof(response),
-            "%s{\"state\":\"%s\",\"progress\":%d,\"total\":%u,\"received\":%u,\"error\":\"%s\"}",
-            HTTP_JSON_HEADER,
-            ota_state_str(ota->state),
-            ota_get_progress(),
-            (unsigned)ota->total_size,
-            (unsigned)ota->bytes_received,
-            ota_error_str(ota->last_error));
+        web_arg_str(c, ota_state_str(ota->state));
+        web_arg_int(c, ota_get_progress());
+        web_arg_uint(c, ota->total_size);
+        web_arg_uint(c, ota->bytes_received);
+        web_arg_str(c, ota_error_str(ota->last_error));
+        web_arg_str(c, ota->is_after_update ? "true" : "false");
+        web_arg_str(c, ota->is_after_rollback ? "true" : "false");
+        web_arg_str(c, CHRONOS_VERSION_STRING);
+        web_arg_str(c, CHRONOS_BUILD_DATE);
+        web_respond(c, HTTP_STATUS_OK, HTTP_TYPE_JSON,
+            "{\"state\":\"%s\",\"progress\":%d,\"total\":%u,\"received\":%u,\"error\":\"%s\","
+            "\"after_update\":%s,\"after_rollback\":%s,\"version\":\"%s\",\"build\":\"%s\"}");
 
     } else {
-        strcpy(response, HTTP_404_RESPONSE);
+        web_respond_text(c, HTTP_STATUS_NOT_FOUND, HTTP_TYPE_TEXT, "404 Not Found");
+    }
+}
+
+/*============================================================================
+ * TCP CALLBACKS
+ *============================================================================*/
+
+static err_t web_sent_callback(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    web_conn_t *c = (web_conn_t *)arg;
+    (void)tpcb;
+    (void)len;
+
+    if (c != NULL && c->state == WEB_CONN_STREAMING) {
+        c->idle_polls = 0;
+        web_pump(c);
+    } else if (c != NULL && c->state == WEB_CONN_EVENTS) {
+        c->idle_polls = 0;
+    }
+    return ERR_OK;
+}
+
+static err_t web_poll_callback(void *arg, struct tcp_pcb *tpcb) {
+    web_conn_t *c = (web_conn_t *)arg;
+
+    if (c == NULL) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+
+    switch (c->state) {
+        case WEB_CONN_STREAMING:
+            /* Retry after a failed tcp_write; give up on a stalled peer.
+             * Waiting for a CLI job's next line with everything acked
+             * is not a stall. */
+            if (c == cli_owner && tcp_sndbuf(tpcb) == TCP_SND_BUF) {
+                c->idle_polls = 0;
+            } else if (++c->idle_polls * WEB_POLL_INTERVAL / 2 >= WEB_STALL_S) {
+                tcp_abort(tpcb);
+                return ERR_ABRT;
+            }
+            web_pump(c);
+            break;
+
+        case WEB_CONN_EVENTS:
+            /* Idle between events is normal; unacked data is not */
+            if (tcp_sndbuf(tpcb) == TCP_SND_BUF) {
+                c->idle_polls = 0;
+            } else if (++c->idle_polls * WEB_POLL_INTERVAL / 2 >= WEB_STALL_S) {
+                tcp_abort(tpcb);
+                return ERR_ABRT;
+            }
+            if (c->head_len > 0) {
+                web_events_send(c, NULL, 0);
+            }
+            break;
+
+        case WEB_CONN_CLOSING:
+            web_close(c);
+            break;
+
+        default:
+            if (++c->idle_polls * WEB_POLL_INTERVAL / 2 >= WEB_KEEPALIVE_S) {
+                web_close(c);
+            }
+            break;
+    }
+    return ERR_OK;
+}
+
+static void web_err_callback(void *arg, err_t err) {
+    web_conn_t *c = (web_conn_t *)arg;
+    (void)err;
+
+    /* The pcb is already gone */
+    if (c != NULL) {
+        web_conn_free(c);
+    }
+}
+
+/**
+ * Hand a streaming OTA pbuf to the updater segment by segment, from
+ * offset. The last byte finishes the update and answers the request.
+ */
+static void ota_stream_feed(web_conn_t *c, struct pbuf *p, size_t offset) {
+    ota_error_t err = OTA_OK;
+
+    for (struct pbuf *q = p; q != NULL && err == OTA_OK && ota_stream_remaining > 0; q = q->next) {
+        if (offset >= q->len) {
+            offset -= q->len;
+            continue;
+        }
+        const uint8_t *data = (const uint8_t *)q->payload + offset;
+        size_t n = q->len - offset;
+        offset = 0;
+        if (n > ota_stream_remaining) {
+            n = ota_stream_remaining;
+        }
+
+        while (n > 0 && err == OTA_OK) {
+            size_t k = ota_stream_space();
+            if (k > n) k = n;
+            err = ota_stream_write(data, k);
+            data += k;
+            n -= k;
+            ota_stream_remaining -= k;
+        }
     }
 
-    /* Send response */
-    size_t resp_len = strlen(response);
-    err_t write_err = tcp_write(tpcb, response, resp_len, TCP_WRITE_FLAG_COPY);
+    if (err == OTA_OK && ota_stream_remaining > 0) {
+        return;
+    }
 
-    if (write_err == ERR_OK) {
-        tcp_output(tpcb);
-        tcp_sent(tpcb, web_sent_callback);
+    ota_stream_conn = NULL;
+    web_reset(c);
+    if (err == OTA_OK) {
+        err = ota_finish();
     } else {
-        tcp_close(tpcb);
+        c->keep_alive = false;     /* Rest of the body is not read */
+    }
+    respond_ota_result(c, err);
+    web_pump(c);
+}
+
+static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    web_conn_t *c = (web_conn_t *)arg;
+
+    if (c == NULL) {
+        if (p != NULL) pbuf_free(p);
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+
+    if (p == NULL || err != ERR_OK) {
+        if (p != NULL) pbuf_free(p);
+        web_close(c);
+        return ERR_OK;
+    }
+
+    /* Still sending the previous response: refuse, lwIP redelivers */
+    if (c->state == WEB_CONN_STREAMING) {
+        return ERR_MEM;
+    }
+    if (c->state == WEB_CONN_CLOSING || c->state == WEB_CONN_EVENTS) {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    c->idle_polls = 0;
+
+    /* Streaming OTA body: the window reopens only as flash is programmed */
+    if (c == ota_stream_conn) {
+        ota_stream_feed(c, p, 0);
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    tcp_recved(tpcb, p->tot_len);
+
+    /* Check if we're continuing to receive OTA chunk data */
+    if (c == ota_chunk_conn && ota_chunk_expected > 0) {
+        /* Append to buffer */
+        size_t to_copy = p->tot_len;
+        if (ota_chunk_received + to_copy > sizeof(ota_chunk_buf)) {
+            to_copy = sizeof(ota_chunk_buf) - ota_chunk_received;
+        }
+        pbuf_copy_partial(p, ota_chunk_buf + ota_chunk_received, to_copy, 0);
+        ota_chunk_received += to_copy;
+        pbuf_free(p);
+
+        /* Check if we have all the data */
+        if (ota_chunk_received >= ota_chunk_expected) {
+            printf("[WEB] OTA chunk complete: %zu bytes\n", ota_chunk_received);
+            ota_error_t ota_err = ota_write_chunk(ota_chunk_buf, ota_chunk_received);
+
+            ota_chunk_expected = 0;
+            ota_chunk_received = 0;
+            ota_chunk_conn = NULL;
+
+            web_reset(c);
+            respond_ota_result(c, ota_err);
+            web_pump(c);
+        }
+        return ERR_OK;
+    }
+
+    /* Copy request to buffer for parsing - use pbuf_copy_partial to handle chained pbufs */
+    static char request[2048];
+    size_t copy_len = p->tot_len < sizeof(request) - 1 ? p->tot_len : sizeof(request) - 1;
+    pbuf_copy_partial(p, request, copy_len, 0);
+    request[copy_len] = '\0';
+
+    web_reset(c);
+    parse_connection_mode(c, request);
+    web_handle_request(c, request, copy_len);
+
+    /* A stream upload starts in this pbuf, past the headers */
+    if (c == ota_stream_conn && ota_stream_body_offset > 0) {
+        size_t offset = ota_stream_body_offset;
+        ota_stream_body_offset = 0;
+        ota_stream_feed(c, p, offset);
+    }
+    pbuf_free(p);
+
+    if (c->state == WEB_CONN_STREAMING) {
+        web_pump(c);
     }
 
     led_blink_activity();
@@ -1546,15 +2412,50 @@ static err_t web_recv_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p,
 
 static err_t web_accept_callback(void *arg, struct tcp_pcb *newpcb, err_t err) {
     (void)arg;
-    
+
     if (err != ERR_OK || newpcb == NULL) {
         return ERR_VAL;
     }
-    
+
+    web_conn_t *c = NULL;
+    web_conn_t *idlest = NULL;
+    for (int i = 0; i < WEB_MAX_CONNECTIONS; i++) {
+        web_conn_t *w = &web_conns[i];
+        if (w->state == WEB_CONN_FREE) {
+            c = w;
+            break;
+        }
+        if (w->state == WEB_CONN_IDLE && w != ota_chunk_conn && w != ota_stream_conn &&
+            (idlest == NULL || w->idle_polls > idlest->idle_polls)) {
+            idlest = w;
+        }
+    }
+
+    /* All slots taken: drop the longest-idle keep-alive connection */
+    if (c == NULL && idlest != NULL) {
+        web_close(idlest);
+        if (idlest->state == WEB_CONN_FREE) {
+            c = idlest;
+        }
+    }
+    if (c == NULL) {
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->pcb = newpcb;
+    c->state = WEB_CONN_IDLE;
+
+    tcp_arg(newpcb, c);
     tcp_recv(newpcb, web_recv_callback);
+    tcp_sent(newpcb, web_sent_callback);
+    tcp_err(newpcb, web_err_callback);
+    tcp_poll(newpcb, web_poll_callback, WEB_POLL_INTERVAL);
     return ERR_OK;
 }
 
+
 /*============================================================================
  * INITIALIZATION
  *============================================================================*/
@@ -1598,13 +2499,23 @@ void web_init(void) {
     printf("[WEB] Server running on port %d\n", WEB_PORT);
     printf("[WEB] Status page: http://%s/\n", ip_str);
     printf("[WEB] JSON API: http://%s/api/status\n", ip_str);
+    printf("[WEB] Live events: http://%s/api/events\n", ip_str);
 }
 
 /**
  * Web server task
  */
 void web_task(void) {
-    /* Currently nothing needed - all handling is in callbacks */
+    /* Requests are handled in callbacks; only the event stream and the
+     * output of a CLI job are driven here */
+    if (web_running) {
+        web_events_task();
+        cyw43_arch_lwip_begin();
+        if (cli_owner != NULL && cli_owner->state == WEB_CONN_STREAMING) {
+            web_pump(cli_owner);
+        }
+        cyw43_arch_lwip_end();
+    }
 }
 
 /**
@@ -1618,6 +2529,13 @@ bool web_is_running(void) {
  * Shutdown web server
  */
 void web_shutdown(void) {
+    for (int i = 0; i < WEB_MAX_CONNECTIONS; i++) {
+        if (web_conns[i].state == WEB_CONN_IDLE || web_conns[i].state == WEB_CONN_STREAMING ||
+            web_conns[i].state == WEB_CONN_EVENTS) {
+            web_close(&web_conns[i]);
+        }
+    }
+
     if (web_pcb != NULL) {
         tcp_close(web_pcb);
         web_pcb = NULL;
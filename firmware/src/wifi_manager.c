@@ -2,6 +2,13 @@
  * CHRONOS-Rb WiFi Manager Module
  * 
  * Manages WiFi connectivity for the Pico 2-W.
+ *
+ * CYW43 power save holds frames at the AP until the chip wakes, which
+ * adds a variable and asymmetric delay to every NTP/PTP exchange. The
+ * power mode is therefore selectable (off, PM2, PM1 with a listen
+ * interval, or adaptive on client load), and a background link probe
+ * measures the latency and jitter between the driver timestamps and the
+ * air. Its filtered one-way latency corrects the NTP and PTP stamps.
  * 
  * Copyright (c) 2025 - Open Source Hardware Project
  * License: MIT
@@ -16,6 +23,35 @@
 
 #include "chronos_rb.h"
 #include "config.h"
+#include "net_timestamp.h"
+#include "metrics.h"
+
+/*============================================================================
+ * CONFIGURATION
+ *============================================================================*/
+
+/* Link probe. The driver TX stamp marks the frame reaching the CYW43;
+ * queueing, channel access and airtime follow. An ARP request to the
+ * gateway measures driver-to-driver round trip, of which half (less
+ * the AP's turnaround) is taken as the one-way latency in each direction.
+ * Queueing and power save only ever add delay, so each window keeps its
+ * minimum. */
+#define WIFI_PROBE_INTERVAL_MS  2000    /* Link probe period */
+#define WIFI_PROBE_WINDOW       8       /* Probes per minimum-filter window */
+#define WIFI_PROBE_TURNAROUND_NS 20000  /* Assumed AP ARP reply turnaround */
+#define WIFI_PROBE_EWMA_SHIFT   2       /* Window minima smoothing (1/4) */
+#define WIFI_PROBE_MAX_RTT_US   20000   /* Discard implausible round trips */
+#define WIFI_STAT_SHIFT         4       /* Mean and jitter gain (1/16) */
+
+/* Adaptive power mode: low latency from the first sign of clients, back
+ * to PM2 only after a quiet spell */
+#define WIFI_PM_LOAD_SHIFT      4       /* Request rate EWMA gain (1/16 per s) */
+#define WIFI_PM_LOAD_ON         0.05f   /* Requests/s that need low latency */
+#define WIFI_PM_LOAD_OFF        0.01f   /* ... and that allow power save */
+#define WIFI_PM_IDLE_HOLD_S     300     /* Quiet time before dozing again */
+#define WIFI_PM_LI_ASSOC        10      /* Listen interval announced at association */
+#define WIFI_PM2_SLEEP_MIN_MS   10
+#define WIFI_PM2_SLEEP_MAX_MS   2550
 
 /*============================================================================
  * PRIVATE VARIABLES
@@ -31,6 +67,40 @@ static uint32_t connection_attempts = 0;
 static uint32_t last_connection_time = 0;
 static uint32_t disconnection_count = 0;
 
+/* Power management */
+static uint8_t pm_mode = WIFI_PM_LOW_LATENCY;
+static uint8_t pm_applied = WIFI_PM_MODE_COUNT;     /* Nothing applied yet */
+static uint8_t pm_listen_dtim = WIFI_LISTEN_DTIM_DEFAULT;
+static uint16_t pm2_sleep_ms = WIFI_PM2_SLEEP_MS_DEFAULT;
+static float pm_load = 0.0f;
+static uint32_t pm_last_requests = 0;
+static uint32_t pm_quiet_s = 0;
+static uint32_t pm_switches = 0;
+
+/* Link latency probe */
+static struct {
+    bool enabled;               /* Probing active */
+    bool valid;                 /* one_way_ns has been measured */
+    int32_t one_way_ns;         /* Filtered one-way driver-to-air latency */
+    uint32_t window_min_us;     /* Minimum RTT in the current window */
+    uint8_t window_count;       /* Probes in the current window */
+    uint32_t last_rtt_us;
+    uint32_t samples;           /* Probes accepted */
+    uint64_t last_probe_us;
+    uint32_t rx_frames_seen;    /* Driver counter at the last sample */
+    uint32_t tx_frames_seen;
+} probe = { .enabled = true };
+
+/* Means and RFC 3550 style jitter, in 1/16 us */
+typedef struct {
+    bool primed;
+    uint32_t last_us;
+    uint32_t mean_x16;
+    uint32_t jitter_x16;
+} lat_stat_t;
+
+static lat_stat_t stat_rtt, stat_rx, stat_tx;
+
 /*============================================================================
  * INITIALIZATION
  *============================================================================*/
@@ -47,6 +117,19 @@ void wifi_init(void) {
     }
     
     cyw43_arch_enable_sta_mode();
+
+    /* Power mode, applied once joined */
+    config_t *cfg = config_get();
+    if (cfg->wifi_pm_mode < WIFI_PM_MODE_COUNT) {
+        pm_mode = cfg->wifi_pm_mode;
+    }
+    if (cfg->wifi_listen_dtim >= 1 && cfg->wifi_listen_dtim <= WIFI_LISTEN_DTIM_MAX) {
+        pm_listen_dtim = cfg->wifi_listen_dtim;
+    }
+    uint16_t sleep_ms = (uint16_t)cfg->wifi_pm2_sleep_10ms * 10;
+    if (sleep_ms >= WIFI_PM2_SLEEP_MIN_MS) {
+        pm2_sleep_ms = sleep_ms;
+    }
     
     wifi_initialized = true;
     printf("[WIFI] WiFi initialized successfully\n");
@@ -58,6 +141,238 @@ void wifi_init(void) {
            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
+/*============================================================================
+ * POWER MANAGEMENT
+ *============================================================================*/
+
+static const char *const pm_mode_names[WIFI_PM_MODE_COUNT] = {
+    "latency", "balanced", "powersave", "adaptive"
+};
+
+const char *wifi_pm_mode_name(uint8_t mode) {
+    return (mode < WIFI_PM_MODE_COUNT) ? pm_mode_names[mode] : "?";
+}
+
+/**
+ * Mode the driver should be in: adaptive picks low latency while the
+ * request rate says clients are being served
+ */
+static uint8_t pm_target(void) {
+    if (pm_mode != WIFI_PM_ADAPTIVE) {
+        return pm_mode;
+    }
+    if (pm_applied == WIFI_PM_BALANCED) {
+        return (pm_load >= WIFI_PM_LOAD_ON) ? WIFI_PM_LOW_LATENCY : WIFI_PM_BALANCED;
+    }
+    return (pm_quiet_s >= WIFI_PM_IDLE_HOLD_S) ? WIFI_PM_BALANCED : WIFI_PM_LOW_LATENCY;
+}
+
+/**
+ * Put the target mode into the driver when it differs
+ */
+static void pm_apply(void) {
+    if (!wifi_connected) {
+        return;
+    }
+    uint8_t target = pm_target();
+    if (target == pm_applied) {
+        return;
+    }
+
+    uint32_t value;
+    switch (target) {
+        case WIFI_PM_BALANCED:
+            value = cyw43_pm_value(CYW43_PM2_POWERSAVE_MODE, pm2_sleep_ms,
+                                   1, pm_listen_dtim, WIFI_PM_LI_ASSOC);
+            break;
+        case WIFI_PM_POWERSAVE:
+            value = cyw43_pm_value(CYW43_PM1_POWERSAVE_MODE, pm2_sleep_ms,
+                                   1, pm_listen_dtim, WIFI_PM_LI_ASSOC);
+            break;
+        default:
+            value = cyw43_pm_value(CYW43_NO_POWERSAVE_MODE, pm2_sleep_ms,
+                                   1, pm_listen_dtim, WIFI_PM_LI_ASSOC);
+            break;
+    }
+
+    int err = cyw43_wifi_pm(&cyw43_state, value);
+    if (err != 0) {
+        printf("[WIFI] Power mode %s failed (%d)\n", wifi_pm_mode_name(target), err);
+        return;
+    }
+    if (pm_applied < WIFI_PM_MODE_COUNT && pm_mode == WIFI_PM_ADAPTIVE) {
+        pm_switches++;
+    }
+    pm_applied = target;
+    printf("[WIFI] Power mode %s (listen %u DTIM, PM2 sleep %u ms)\n",
+           wifi_pm_mode_name(target), pm_listen_dtim, pm2_sleep_ms);
+}
+
+/**
+ * Track the client request rate once a second for the adaptive mode
+ */
+static void pm_load_update(void) {
+    uint32_t requests, errors;
+    ntp_get_statistics(&requests, &errors);
+    requests += ptp_get_delay_requests();
+
+    float delta = (float)(requests - pm_last_requests);
+    pm_last_requests = requests;
+    pm_load += (delta - pm_load) / (1 << WIFI_PM_LOAD_SHIFT);
+
+    if (pm_load >= WIFI_PM_LOAD_OFF) {
+        pm_quiet_s = 0;
+    } else if (pm_quiet_s < WIFI_PM_IDLE_HOLD_S) {
+        pm_quiet_s++;
+    }
+}
+
+bool wifi_set_power_mode(wifi_pm_mode_t mode) {
+    if (mode >= WIFI_PM_MODE_COUNT) {
+        return false;
+    }
+    pm_mode = (uint8_t)mode;
+    pm_quiet_s = 0;
+    pm_apply();
+    return true;
+}
+
+bool wifi_set_listen_interval(uint8_t dtims) {
+    if (dtims < 1 || dtims > WIFI_LISTEN_DTIM_MAX) {
+        return false;
+    }
+    pm_listen_dtim = dtims;
+    pm_applied = WIFI_PM_MODE_COUNT;
+    pm_apply();
+    return true;
+}
+
+bool wifi_set_pm2_sleep(uint16_t ms) {
+    if (ms < WIFI_PM2_SLEEP_MIN_MS || ms > WIFI_PM2_SLEEP_MAX_MS) {
+        return false;
+    }
+    pm2_sleep_ms = ms;
+    pm_applied = WIFI_PM_MODE_COUNT;
+    pm_apply();
+    return true;
+}
+
+/*============================================================================
+ * LATENCY PROBE
+ *============================================================================*/
+
+static void lat_stat_feed(lat_stat_t *st, uint32_t us) {
+    uint32_t x16 = us << WIFI_STAT_SHIFT;
+    if (!st->primed) {
+        st->mean_x16 = x16;
+        st->jitter_x16 = 0;
+        st->primed = true;
+    } else {
+        uint32_t d = (us > st->last_us) ? us - st->last_us : st->last_us - us;
+        int32_t dj = (int32_t)(d << WIFI_STAT_SHIFT) - (int32_t)st->jitter_x16;
+        int32_t dm = (int32_t)x16 - (int32_t)st->mean_x16;
+        st->jitter_x16 += dj >> WIFI_STAT_SHIFT;
+        st->mean_x16 += dm >> WIFI_STAT_SHIFT;
+    }
+    st->last_us = us;
+}
+
+/**
+ * Feed one link probe round trip into the one-way model
+ */
+static void probe_feed(uint32_t rtt_us) {
+    probe.last_rtt_us = rtt_us;
+    if (rtt_us == 0 || rtt_us > WIFI_PROBE_MAX_RTT_US) {
+        return;
+    }
+    probe.samples++;
+    lat_stat_feed(&stat_rtt, rtt_us);
+    metrics_observe(METRIC_WIFI_PROBE_RTT, (int32_t)rtt_us);
+
+    if (probe.window_count == 0 || rtt_us < probe.window_min_us) {
+        probe.window_min_us = rtt_us;
+    }
+    if (++probe.window_count < WIFI_PROBE_WINDOW) {
+        return;
+    }
+
+    int32_t one_way_ns = ((int32_t)probe.window_min_us * 1000 - WIFI_PROBE_TURNAROUND_NS) / 2;
+    if (one_way_ns < 0) {
+        one_way_ns = 0;
+    }
+
+    if (!probe.valid) {
+        probe.one_way_ns = one_way_ns;
+        probe.valid = true;
+    } else {
+        probe.one_way_ns += (one_way_ns - probe.one_way_ns) >> WIFI_PROBE_EWMA_SHIFT;
+    }
+    probe.window_count = 0;
+}
+
+/**
+ * Collect probe results and the driver's own RX/TX latencies, and send
+ * the next probe (task context)
+ */
+static void probe_task(uint64_t now) {
+    uint32_t rtt_us;
+    if (net_ts_probe_result(&rtt_us)) {
+        probe_feed(rtt_us);
+    }
+
+    /* Stack latencies of the frames since the last look */
+    net_ts_stats_t ts;
+    net_ts_get_stats(&ts);
+    if (ts.rx_wake_stamped != probe.rx_frames_seen) {
+        probe.rx_frames_seen = ts.rx_wake_stamped;
+        lat_stat_feed(&stat_rx, ts.wake_latency_us);
+    }
+    if (ts.tx_frames != probe.tx_frames_seen) {
+        probe.tx_frames_seen = ts.tx_frames;
+        lat_stat_feed(&stat_tx, ts.tx_latency_us);
+    }
+
+    if (probe.enabled && now - probe.last_probe_us >= WIFI_PROBE_INTERVAL_MS * 1000ULL) {
+        probe.last_probe_us = now;
+        net_ts_probe_start();
+    }
+}
+
+/**
+ * Enable/disable the link probe. The last measured latency stays in use.
+ */
+void wifi_set_latency_probe(bool enable) {
+    probe.enabled = enable;
+    printf("[WIFI] Latency probe %s\n", enable ? "enabled" : "disabled");
+}
+
+/**
+ * Filtered one-way latency for the NTP/PTP stamps
+ */
+int32_t wifi_latency_ns(void) {
+    return probe.valid ? probe.one_way_ns : 0;
+}
+
+void wifi_get_latency(wifi_latency_info_t *info) {
+    info->mode = pm_mode;
+    info->applied = pm_applied;
+    info->listen_dtim = pm_listen_dtim;
+    info->pm2_sleep_ms = pm2_sleep_ms;
+    info->load_per_s = pm_load;
+    info->switches = pm_switches;
+    info->probing = probe.enabled;
+    info->valid = probe.valid;
+    info->one_way_ns = probe.one_way_ns;
+    info->rtt_last_us = probe.last_rtt_us;
+    info->rtt_mean_us = stat_rtt.mean_x16 >> WIFI_STAT_SHIFT;
+    info->rtt_jitter_us = stat_rtt.jitter_x16 >> WIFI_STAT_SHIFT;
+    info->rx_wake_us = stat_rx.mean_x16 >> WIFI_STAT_SHIFT;
+    info->rx_jitter_us = stat_rx.jitter_x16 >> WIFI_STAT_SHIFT;
+    info->tx_driver_us = stat_tx.mean_x16 >> WIFI_STAT_SHIFT;
+    info->tx_jitter_us = stat_tx.jitter_x16 >> WIFI_STAT_SHIFT;
+    info->samples = probe.samples;
+}
+
 /*============================================================================
  * CONNECTION MANAGEMENT
  *============================================================================*/
@@ -102,6 +417,10 @@ bool wifi_connect(const char *ssid, const char *password) {
             wifi_connected = true;
             g_wifi_connected = true;
             last_connection_time = time_us_32() / 1000000;
+
+            /* The join resets the chip to the SDK default */
+            pm_applied = WIFI_PM_MODE_COUNT;
+            pm_apply();
             return true;
         }
 
@@ -188,15 +507,21 @@ void wifi_task(void) {
     static uint64_t last_reconnect_attempt = 0;
     uint64_t now = time_us_64();
 
-    /* Check connection status every second */
-    if (now - last_check < 1000000) {
+    if (!wifi_initialized) {
         return;
     }
-    last_check = now;
 
-    if (!wifi_initialized) {
+    /* Probe results are stamped on arrival, so polling them at the task
+     * period loses nothing */
+    if (wifi_connected) {
+        probe_task(now);
+    }
+
+    /* Check connection status every second */
+    if (now - last_check < 1000000) {
         return;
     }
+    last_check = now;
 
     /* Poll lwIP regardless of connection state */
     cyw43_arch_poll();
@@ -214,6 +539,11 @@ void wifi_task(void) {
         disconnection_count++;
     }
 
+    if (wifi_connected) {
+        pm_load_update();
+        pm_apply();
+    }
+
     /* Periodic reconnection if not connected and auto-connect enabled */
     if (!wifi_connected && config_wifi_auto_connect_enabled()) {
         /* Try every 30 seconds */
@@ -225,6 +555,9 @@ void wifi_task(void) {
             if (wifi_connect(cfg->wifi_ssid, cfg->wifi_pass)) {
                 printf("[WIFI] Reconnection successful!\n");
 
+                /* The driver may have re-installed its netif callbacks */
+                net_ts_attach();
+
                 /* Start network services if not already started */
                 if (!network_services_started) {
                     extern void ntp_server_init(void);
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+CHRONOS-Rb web asset embedder
+
+Gzips the static web pages and writes them as const C arrays, so they
+stay in XIP flash and web_interface.c can hand them to tcp_write()
+without copying. Each asset gets a strong ETag from its content hash.
+
+Usage: gen_web_assets.py <output.c> <asset>...
+
+index.html is served at "/", any other page at "/<name>" (extension
+dropped) and other files at "/<filename>".
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+    ".json": "application/json",
+}
+
+
+def url_path(filename):
+    name, ext = os.path.splitext(os.path.basename(filename))
+    if ext == ".html":
+        return "/" if name == "index" else "/" + name
+    return "/" + os.path.basename(filename)
+
+
+def c_ident(filename):
+    return "asset_" + "".join(c if c.isalnum() else "_" for c in os.path.basename(filename))
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit("usage: gen_web_assets.py <output.c> <asset>...")
+
+    out_path = sys.argv[1]
+    assets = sorted(sys.argv[2:], key=os.path.basename)
+    lines = [
+        "/* Generated by tools/gen_web_assets.py - do not edit */",
+        "",
+        "#include \"web_assets.h\"",
+        "",
+    ]
+    table = []
+
+    for filename in assets:
+        with open(filename, "rb") as f:
+            raw = f.read()
+        # mtime=0 keeps the output (and the ETag) reproducible
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        ext = os.path.splitext(filename)[1]
+        ident = c_ident(filename)
+        etag = hashlib.sha1(data).hexdigest()[:16]
+
+        lines.append("/* %s: %d -> %d bytes */" % (os.path.basename(filename), len(raw), len(data)))
+        lines.append("static const uint8_t %s[%d] = {" % (ident, len(data)))
+        for i in range(0, len(data), 16):
+            lines.append("    " + " ".join("0x%02x," % b for b in data[i:i + 16]))
+        lines.append("};")
+        lines.append("")
+        table.append('    { "%s", "%s", %s, sizeof(%s), "\\"%s\\"" },'
+                     % (url_path(filename), CONTENT_TYPES.get(ext, "application/octet-stream"),
+                        ident, ident, etag))
+
+    lines.append("const web_asset_t web_assets[] = {")
+    lines.extend(table)
+    lines.append("};")
+    lines.append("")
+    lines.append("const int web_asset_count = sizeof(web_assets) / sizeof(web_assets[0]);")
+
+    with open(out_path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
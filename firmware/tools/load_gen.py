@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""
+CHRONOS-Rb NTP/PTP load generator
+
+Sends NTP client requests and/or PTP Delay_Req messages at stepped rates
+and drives the device's load benchmark over /api/cli: "bench start" with
+this host's address (the one client the device then answers regardless
+of rate), one "bench step <rate>" per step, "bench stop", then "bench csv" for the
+device's view of each step (service time, unanswered requests, pbuf
+failures, PPS IRQ latency). The report adds what the client saw (replies
+lost, round trip p99) and the capacity: the highest answered rate of a
+step the device passed with at most 0.1% of the replies lost.
+
+Usage: load_gen.py <device-ip> [--rates 100,500,1000] [--step-s 10]
+                   [--proto ntp|ptp|both] [--p99-us 1000] [--csv FILE]
+
+--csv appends one row per step with the firmware version, so capacity can
+be tracked across releases. Delay_Resp goes to UDP port 320, which needs
+root to bind; without it PTP replies are counted on the device only.
+"""
+
+import argparse
+import csv
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+import urllib.parse
+import urllib.request
+
+NTP_PORT = 123
+PTP_EVENT_PORT = 319
+PTP_GENERAL_PORT = 320
+LOSS_MAX = 0.001
+DRAIN_S = 0.5
+
+
+def cli(host, port, cmd):
+    body = urllib.parse.urlencode({"cmd": cmd}).encode()
+    req = urllib.request.Request(f"http://{host}:{port}/api/cli", data=body, method="POST")
+    with urllib.request.urlopen(req, timeout=10) as r:
+        reply = json.loads(r.read().decode())
+    if not reply.get("ok"):
+        sys.exit(f"device: {cmd}: {reply.get('error')}")
+    return reply["output"]
+
+
+def source_ip(host):
+    """Address this host sends to the device from"""
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((host, NTP_PORT))
+        return s.getsockname()[0]
+
+
+class Receiver:
+    """Counts replies and their round trip times on one socket"""
+
+    def __init__(self, sock, parse):
+        self.sock = sock
+        self.parse = parse
+        self.sent_ns = {}
+        self.rtts_us = []
+        self.replies = 0
+        self.lock = threading.Lock()
+        self.stop = False
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def run(self):
+        self.sock.settimeout(0.2)
+        while not self.stop:
+            try:
+                data = self.sock.recv(256)
+            except socket.timeout:
+                continue
+            now = time.monotonic_ns()
+            key = self.parse(data)
+            with self.lock:
+                t0 = self.sent_ns.pop(key, None)
+                if t0 is not None:
+                    self.replies += 1
+                    self.rtts_us.append((now - t0) / 1000.0)
+
+    def reset(self):
+        with self.lock:
+            self.sent_ns.clear()
+            self.rtts_us = []
+            self.replies = 0
+
+
+def ntp_request(seq):
+    # v4 client; the transmit timestamp carries the sequence and comes back as origin
+    return struct.pack("!B39xQ", 0x23, seq)
+
+
+def ntp_key(data):
+    return struct.unpack_from("!Q", data, 24)[0] if len(data) >= 48 else None
+
+
+def ptp_delay_req(seq):
+    # Header (34 bytes) and a zero origin timestamp (10 bytes)
+    hdr = struct.pack("!BBHBB2xQ4x8sHHBb", 0x01, 0x02, 44, 0, 0, 0,
+                      b"CHRONLG\x00", 1, seq & 0xFFFF, 0x01, 0x7F)
+    return hdr + bytes(10)
+
+
+def ptp_key(data):
+    if len(data) < 34 or (data[0] & 0x0F) != 0x09:
+        return None
+    return struct.unpack_from("!H", data, 30)[0]
+
+
+def run_step(host, rate, secs, senders):
+    """Send at rate for secs, split across the senders; returns per sender sent count"""
+    sent = [0] * len(senders)
+    seq = 0
+    start = time.monotonic()
+    per_sender = rate / len(senders)
+    while True:
+        elapsed = time.monotonic() - start
+        if elapsed >= secs:
+            break
+        due = int(elapsed * per_sender) + 1
+        for i, (sock, dest, build, rx) in enumerate(senders):
+            while sent[i] < due:
+                seq += 1
+                key = seq & 0xFFFF if build is ptp_delay_req else seq
+                with rx.lock:
+                    rx.sent_ns[key] = time.monotonic_ns()
+                try:
+                    sock.sendto(build(seq), dest)
+                except OSError:
+                    pass
+                sent[i] += 1
+        time.sleep(0.0005)
+    time.sleep(DRAIN_S)
+    return sent
+
+
+def percentile(values, q):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def main():
+    ap = argparse.ArgumentParser(description="CHRONOS-Rb NTP/PTP load generator")
+    ap.add_argument("host")
+    ap.add_argument("--rates", default="50,100,200,500,1000,2000,3000,5000")
+    ap.add_argument("--step-s", type=float, default=10.0)
+    ap.add_argument("--proto", choices=("ntp", "ptp", "both"), default="ntp")
+    ap.add_argument("--p99-us", type=int, default=1000)
+    ap.add_argument("--http-port", type=int, default=80)
+    ap.add_argument("--csv", help="append results to this file")
+    args = ap.parse_args()
+    rates = [int(r) for r in args.rates.split(",")]
+
+    senders = []
+    if args.proto in ("ntp", "both"):
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        senders.append((s, (args.host, NTP_PORT), ntp_request, Receiver(s, ntp_key)))
+    if args.proto in ("ptp", "both"):
+        tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        rx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            rx.bind(("", PTP_GENERAL_PORT))
+        except OSError as e:
+            print(f"PTP replies not counted here (port {PTP_GENERAL_PORT}: {e})")
+        senders.append((tx, (args.host, PTP_EVENT_PORT), ptp_delay_req, Receiver(rx, ptp_key)))
+
+    start = f"bench start {args.p99_us} {source_ip(args.host)}"
+    print(cli(args.host, args.http_port, start).strip())
+    client = []
+    for rate in rates:
+        for s in senders:
+            s[3].reset()
+        cli(args.host, args.http_port, f"bench step {rate}")
+        print(f"step {rate} req/s for {args.step_s:.0f} s ...", flush=True)
+        sent = run_step(args.host, rate, args.step_s, senders)
+        replies = sum(s[3].replies for s in senders)
+        rtts = [v for s in senders for v in s[3].rtts_us]
+        client.append((sum(sent), replies, percentile(rtts, 0.99)))
+    cli(args.host, args.http_port, "bench stop")
+    for s in senders:
+        s[3].stop = True
+
+    rows = list(csv.DictReader(cli(args.host, args.http_port, "bench csv").splitlines()))
+    version = rows[0]["version"] if rows else "?"
+    print(f"\nFirmware {version}, {args.proto}, NTP p99 target {args.p99_us} us")
+    print(" Offered  Served/s   Sent  Lost%  RTT p99  NTP p99  PPS p99  Pbuf  Device  Step")
+    print(" (req/s)                         (us)     (us)     (ns)")
+    capacity = 0
+    for row, (sent, replies, rtt99) in zip(rows, client):
+        # Everything was sent within step_s; the device window also holds
+        # the drain and the HTTP round trips
+        served = (int(row["ntp_served"]) + int(row["ptp_served"])) / args.step_s
+        lost = 1.0 - replies / sent if sent else 0.0
+        # Without the PTP reply port only the device's count is known
+        if args.proto != "ntp" and replies == 0:
+            lost = 0.0
+        ok = row["passed"] == "1" and lost <= LOSS_MAX
+        if ok:
+            capacity = max(capacity, int(served))
+        row.update(sent=sent, replies=replies, lost_pct=f"{100 * lost:.3f}",
+                   rtt_p99_us=f"{rtt99:.0f}", step_ok=int(ok), proto=args.proto)
+        print(f" {int(row['offered']):7d} {served:9.0f} {sent:6d} {100 * lost:6.2f} "
+              f"{rtt99:8.0f} {float(row['ntp_p99_us']):8.0f} {float(row['pps_p99_ns']):8.0f} "
+              f"{int(row['pbuf_errors']):5d}  {'ok' if row['passed'] == '1' else 'FAIL':6s}  "
+              f"{'ok' if ok else 'FAIL'}")
+    print(f"\nCapacity: {capacity} req/s at NTP p99 <= {args.p99_us} us, "
+          f"loss <= {100 * LOSS_MAX:.1f}%")
+
+    if args.csv and rows:
+        new = not os.path.exists(args.csv)
+        with open(args.csv, "a", newline="") as f:
+            w = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+            if new:
+                w.writeheader()
+            w.writerows(rows)
+
+
+if __name__ == "__main__":
+    main()